@@ -29,6 +29,7 @@
 #include "itkFixedArray.h"
 #include "itkAdvancedTransform.h"
 #include "vnl/vnl_sparse_matrix.h"
+#include "itkCompressedSparseRowMatrix.h"
 
 #include "itkImageMaskSpatialObject.h"
 
@@ -37,6 +38,9 @@
 #include "itkAdvancedCombinationTransform.h"
 
 #include "itkPlatformMultiThreader.h"
+#include "itkMultiPositionCostFunctionInterface.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -66,6 +70,18 @@ namespace itk
  *   unless you have a good reason for it...
  * \li Some convenience functions are provided, such as the IsInsideMovingMask
  *   and CheckNumberOfSamples.
+ * \li Evaluation contexts, to compute the value and derivative at several
+ *   parameter vectors concurrently, see GetValuesAndDerivatives(). A context
+ *   bundles a view on one parameter vector, a clone of the transform set to
+ *   those parameters, a range of samples and scratch buffers. The images,
+ *   interpolators, masks and samples are shared by all contexts. Metrics
+ *   that support this implement ThreadedGetValueAndDerivativeInContext()
+ *   and AfterGetValueAndDerivativeInContext(), and return true in
+ *   GetSupportsConcurrentEvaluation(); currently AdvancedMeanSquares and
+ *   AdvancedNormalizedCorrelation.
+ * \li Central differences, see GetCentralDifferences(). For transforms with a
+ *   sparse Jacobian, such as the B-spline, the evaluation contexts recompute
+ *   only the samples in the support of each perturbed parameter.
  *
  * The parameters used in this class are:
  * \parameter MovingImageDerivativeScales: scale the moving image derivatives. Use\n
@@ -79,7 +95,8 @@ namespace itk
 
 template< class TFixedImage, class TMovingImage >
 class AdvancedImageToImageMetric :
-  public ImageToImageMetric< TFixedImage, TMovingImage >
+  public ImageToImageMetric< TFixedImage, TMovingImage >,
+  public MultiPositionCostFunctionInterface
 {
 public:
 
@@ -131,6 +148,11 @@ public:
   typedef typename DerivativeType::ValueType                DerivativeValueType;
   typedef typename Superclass::ParametersType               ParametersType;
 
+  /** Typedefs for the evaluation at several positions. */
+  typedef MultiPositionCostFunctionInterface::ParametersListType ParametersListType;
+  typedef MultiPositionCostFunctionInterface::MeasureListType    MeasureListType;
+  typedef MultiPositionCostFunctionInterface::DerivativeListType DerivativeListType;
+
   typedef ImageMaskSpatialObject< itkGetStaticConstMacro( FixedImageDimension ) > FixedImageMaskSpatialObject2Type;
   typedef ImageMaskSpatialObject< itkGetStaticConstMacro( MovingImageDimension ) > MovingImageMaskSpatialObject2Type;
 
@@ -171,6 +193,7 @@ public:
   /** Hessian type; for SelfHessian (experimental feature) */
   typedef typename DerivativeType::ValueType    HessianValueType;
   typedef vnl_sparse_matrix< HessianValueType > HessianType;
+  typedef CompressedSparseRowMatrix             CompressedHessianType;
 
   /** Typedefs for multi-threading. */
   typedef itk::PlatformMultiThreader                      ThreaderType;
@@ -269,6 +292,13 @@ public:
    */
   virtual void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const;
 
+  /** Experimental feature: compute SelfHessian in compressed sparse row format.
+   * This base class calls GetSelfHessian() and converts the result. Metrics
+   * that override this function assemble the matrix in parallel.
+   */
+  virtual void GetCompressedSelfHessian( const TransformParametersType & parameters,
+    CompressedHessianType * H ) const;
+
   /** Set number of threads to use for computations. */
   virtual void SetNumberOfWorkUnits( ThreadIdType numberOfThreads );
 
@@ -291,6 +321,44 @@ public:
   virtual void BeforeThreadedGetValueAndDerivative(
     const TransformParametersType & parameters ) const;
 
+  /** Whether GetValuesAndDerivatives() evaluates the positions concurrently.
+   * This base class returns false; metrics that implement the evaluation
+   * context functions return true.
+   */
+  bool GetSupportsConcurrentEvaluation( void ) const override { return false; }
+
+  /** Compute the value and derivative at several positions, with the same
+   * samples. If concurrent evaluation is supported, the image sampler is
+   * updated once, and the positions are evaluated concurrently by evaluation
+   * contexts, each with its own transform clone. The transform of the metric
+   * itself is not changed: it keeps the parameters of the last call to
+   * GetValue() or GetValueAndDerivative(), not those of any of the
+   * positions. Callers that need the transform at one of the positions,
+   * such as a line search that accepts one of them, should set its
+   * parameters themselves. Otherwise GetValueAndDerivative() is called for
+   * each position, which leaves the transform at the last position.
+   */
+  void GetValuesAndDerivatives( const ParametersListType & positions,
+    MeasureListType & values, DerivativeListType & derivatives ) const override;
+
+  /** Compute the value at several positions, like GetValuesAndDerivatives(),
+   * but without computing the derivatives. Otherwise GetValue() is called
+   * for each position.
+   */
+  void GetValues( const ParametersListType & positions,
+    MeasureListType & values ) const override;
+
+  /** Compute the central differences f(x + p_j e_j) - f(x - p_j e_j) with the
+   * same samples for all parameters j. If concurrent evaluation is supported
+   * and the transform has a sparse Jacobian, such as the B-spline, only the
+   * samples in the support of parameter j are evaluated at x and x +- p_j e_j,
+   * and their partial sums replace those in the sums over all samples at x.
+   * This costs O(support) per parameter instead of a full evaluation. With a
+   * dense Jacobian, blocks of perturbed positions are given to GetValues().
+   */
+  void GetCentralDifferences( const ParametersType & position,
+    const ParametersType & perturbations, DerivativeType & differences ) const override;
+
 protected:
 
   /** Constructor. */
@@ -458,6 +526,110 @@ protected:
   /** Initialize some multi-threading related parameters. */
   virtual void InitializeThreadingParameters( void ) const;
 
+  /** The state of one concurrent evaluation: the metric at the parameters
+   * st_Parameters, using the transform st_Transform, over the samples
+   * [ st_SampleBegin, st_SampleEnd [. If st_SampleIndices is not null, this
+   * range refers to that list of sample indices instead. The parameters, the
+   * transform and the indices are views; they are owned by the caller.
+   * The values and derivatives are partial sums, of which the number is
+   * chosen by the metric. The derivatives are only computed if
+   * st_ComputeDerivative is true.
+   */
+  struct EvaluationContextType
+  {
+    const TransformParametersType *      st_Parameters;
+    AdvancedTransformType *              st_Transform;
+    const std::vector< unsigned long > * st_SampleIndices;
+    unsigned long                        st_SampleBegin;
+    unsigned long                        st_SampleEnd;
+    bool                                 st_ComputeDerivative;
+    SizeValueType                        st_NumberOfPixelsCounted;
+    std::vector< MeasureType >           st_Values;
+    std::vector< DerivativeType >        st_Derivatives;
+    NonZeroJacobianIndicesType           st_NonZeroJacobianIndices;
+    DerivativeType                       st_ImageJacobian;
+  };
+
+  /** Set the number of partial values and derivatives of a context.
+   * This base class uses one of each.
+   */
+  virtual void InitializeEvaluationContext( EvaluationContextType & context ) const;
+
+  /** Add the contributions of the samples of a context to its partial sums.
+   * May only read shared state; called concurrently for different contexts.
+   */
+  virtual void ThreadedGetValueAndDerivativeInContext(
+    EvaluationContextType & itkNotUsed( context ) ) const {}
+
+  /** Compute the value and derivative from the partial sums of a context,
+   * which at that point hold the sums over all samples.
+   */
+  virtual void AfterGetValueAndDerivativeInContext(
+    const EvaluationContextType & itkNotUsed( context ),
+    MeasureType & itkNotUsed( value ), DerivativeType & itkNotUsed( derivative ) ) const {}
+
+  /** Evaluate the positions with one or more contexts each, and add the
+   * values and the number of pixels of the contexts of each position to its
+   * first context. The image sampler should be up to date.
+   */
+  void EvaluateInContexts( const ParametersListType & positions,
+    const bool computeDerivative ) const;
+
+  /** Reset the partial sums of a context and evaluate it. */
+  void ResetAndEvaluateContext( EvaluationContextType & context ) const;
+
+  /** Evaluate the contexts of one thread. */
+  void ThreadedGetValuesAndDerivatives( ThreadIdType threadId ) const;
+
+  /** Sum the derivatives of the contexts of each position, for the
+   * parameters of one thread.
+   */
+  void ThreadedAccumulateEvaluationContexts( ThreadIdType threadId ) const;
+
+  /** The threader callbacks of GetValuesAndDerivatives(). */
+  static ITK_THREAD_RETURN_TYPE GetValuesAndDerivativesThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE AccumulateEvaluationContextsThreaderCallback( void * arg );
+
+  /** The evaluation contexts, numberOfPositions times
+   * m_NumberOfEvaluationContextsPerPosition, and the transform clones.
+   */
+  mutable std::vector< EvaluationContextType >                    m_EvaluationContexts;
+  mutable std::vector< typename AdvancedTransformType::Pointer > m_EvaluationTransforms;
+  mutable unsigned int                                            m_NumberOfEvaluationContextsPerPosition;
+
+  /** For each sample, find the parameters with a nonzero Jacobian, and
+   * store for each parameter the samples in its support, as compressed
+   * rows in m_LocalSupportPointers and m_LocalSupportSamples. The nonzero
+   * Jacobian indices are computed by the threads, and then transposed.
+   */
+  void ComputeLocalSupportSamples( void ) const;
+
+  void ThreadedComputeLocalSupportSamples( ThreadIdType threadId ) const;
+
+  /** Compute the central differences of the parameters of one thread,
+   * with the evaluation context of that thread.
+   */
+  void ThreadedGetCentralDifferences( ThreadIdType threadId ) const;
+
+  /** The threader callbacks of GetCentralDifferences(). */
+  static ITK_THREAD_RETURN_TYPE ComputeLocalSupportSamplesThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE GetCentralDifferencesThreaderCallback( void * arg );
+
+  /** The state of GetCentralDifferences(): the samples in the support of
+   * each parameter, the nonzero Jacobian indices of each sample while these
+   * are computed, per thread a copy of the position, the sums over all
+   * samples at the position, and views on the input and output.
+   */
+  mutable std::vector< SizeValueType >           m_LocalSupportPointers;
+  mutable std::vector< unsigned long >           m_LocalSupportSamples;
+  mutable NonZeroJacobianIndicesType             m_SampleNonZeroJacobianIndices;
+  mutable std::vector< TransformParametersType > m_EvaluationParameters;
+  mutable EvaluationContextType                  m_CentralDifferencesBaseContext;
+  mutable const TransformParametersType *        m_CentralDifferencesPerturbations;
+  mutable DerivativeType *                       m_CentralDifferences;
+
   /** Protected methods ************** */
 
   /** Methods for image sampler support **********/
@@ -29,6 +29,8 @@
 
 #include "itkTimeProbe.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -106,6 +108,9 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   this->m_GetValuePerThreadVariablesSize              = 0;
   this->m_GetValueAndDerivativePerThreadVariables     = nullptr;
   this->m_GetValueAndDerivativePerThreadVariablesSize = 0;
+  this->m_NumberOfEvaluationContextsPerPosition       = 1;
+  this->m_CentralDifferencesPerturbations             = nullptr;
+  this->m_CentralDifferences                          = nullptr;
 
 } // end Constructor
 
@@ -839,6 +844,26 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetSelfHessian()
 
 
+/**
+ * *********************** GetCompressedSelfHessian ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetCompressedSelfHessian(
+  const TransformParametersType & parameters,
+  CompressedHessianType * H ) const
+{
+  itkDebugMacro( "GetCompressedSelfHessian()" );
+
+  HessianType tmpH;
+  this->GetSelfHessian( parameters, tmpH );
+  H->ConvertFromVnlSparseMatrix( tmpH );
+
+} // end GetCompressedSelfHessian()
+
+
 /**
  * *********************** BeforeThreadedGetValueAndDerivative ***********************
  */
@@ -1010,6 +1035,643 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end CheckNumberOfSamples()
 
 
+/**
+ * *********************** GetValuesAndDerivatives ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetValuesAndDerivatives( const ParametersListType & positions,
+  MeasureListType & values, DerivativeListType & derivatives ) const
+{
+  const unsigned int numberOfPositions = positions.size();
+  values.resize( numberOfPositions );
+  derivatives.resize( numberOfPositions );
+
+  /** Without support for evaluation contexts, evaluate one position after another. */
+  if( !this->GetSupportsConcurrentEvaluation() )
+  {
+    for( unsigned int k = 0; k < numberOfPositions; ++k )
+    {
+      this->GetValueAndDerivative( positions[ k ], values[ k ], derivatives[ k ] );
+    }
+    return;
+  }
+  if( numberOfPositions == 0 )
+  {
+    return;
+  }
+
+  /** Draw the samples once, for all positions. */
+  if( this->m_UseImageSampler )
+  {
+    this->GetImageSampler()->Update();
+  }
+  const unsigned long sampleContainerSize = this->GetImageSampler()->GetOutput()->Size();
+
+  this->EvaluateInContexts( positions, true );
+
+  /** Compute the value and derivative of each position. */
+  for( unsigned int k = 0; k < numberOfPositions; ++k )
+  {
+    const EvaluationContextType & context
+      = this->m_EvaluationContexts[ k * this->m_NumberOfEvaluationContextsPerPosition ];
+    this->CheckNumberOfSamples( sampleContainerSize, context.st_NumberOfPixelsCounted );
+    this->AfterGetValueAndDerivativeInContext( context, values[ k ], derivatives[ k ] );
+  }
+
+  /** Release the transform clones. */
+  this->m_EvaluationTransforms.clear();
+
+} // end GetValuesAndDerivatives()
+
+
+/**
+ * *********************** GetValues ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetValues( const ParametersListType & positions, MeasureListType & values ) const
+{
+  const unsigned int numberOfPositions = positions.size();
+  values.resize( numberOfPositions );
+
+  /** Without support for evaluation contexts, evaluate one position after another. */
+  if( !this->GetSupportsConcurrentEvaluation() )
+  {
+    for( unsigned int k = 0; k < numberOfPositions; ++k )
+    {
+      values[ k ] = this->GetValue( positions[ k ] );
+    }
+    return;
+  }
+  if( numberOfPositions == 0 )
+  {
+    return;
+  }
+
+  /** Draw the samples once, for all positions. */
+  if( this->m_UseImageSampler )
+  {
+    this->GetImageSampler()->Update();
+  }
+  const unsigned long sampleContainerSize = this->GetImageSampler()->GetOutput()->Size();
+
+  this->EvaluateInContexts( positions, false );
+
+  /** Compute the value of each position. */
+  DerivativeType dummyDerivative;
+  for( unsigned int k = 0; k < numberOfPositions; ++k )
+  {
+    const EvaluationContextType & context
+      = this->m_EvaluationContexts[ k * this->m_NumberOfEvaluationContextsPerPosition ];
+    this->CheckNumberOfSamples( sampleContainerSize, context.st_NumberOfPixelsCounted );
+    this->AfterGetValueAndDerivativeInContext( context, values[ k ], dummyDerivative );
+  }
+
+  /** Release the transform clones. */
+  this->m_EvaluationTransforms.clear();
+
+} // end GetValues()
+
+
+/**
+ * *********************** EvaluateInContexts ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateInContexts( const ParametersListType & positions,
+  const bool computeDerivative ) const
+{
+  const unsigned int  numberOfPositions   = positions.size();
+  const unsigned long sampleContainerSize = this->GetImageSampler()->GetOutput()->Size();
+
+  /** Clone the transform for each position. The clones of transforms that
+   * do not copy their parameters, such as the B-spline, refer to positions.
+   */
+  this->m_EvaluationTransforms.resize( numberOfPositions );
+  for( unsigned int k = 0; k < numberOfPositions; ++k )
+  {
+    typename AdvancedTransformType::Superclass::Pointer clone = this->m_AdvancedTransform->Clone();
+    this->m_EvaluationTransforms[ k ] = dynamic_cast< AdvancedTransformType * >( clone.GetPointer() );
+    if( this->m_EvaluationTransforms[ k ].IsNull() )
+    {
+      itkExceptionMacro( << "Cloning the transform failed." );
+    }
+    this->m_EvaluationTransforms[ k ]->SetParameters( positions[ k ] );
+  }
+
+  /** Split the samples of each position over the threads that are left. */
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  this->m_NumberOfEvaluationContextsPerPosition
+    = std::max( numberOfThreads / numberOfPositions, 1u );
+  const unsigned int numberOfContextsPerPosition = this->m_NumberOfEvaluationContextsPerPosition;
+  const unsigned long nrOfSamplesPerContext
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( numberOfContextsPerPosition ) ) );
+
+  /** Set up the contexts. Their buffers are kept for the next call. */
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  this->m_EvaluationContexts.resize( numberOfPositions * numberOfContextsPerPosition );
+  for( unsigned int k = 0; k < numberOfPositions; ++k )
+  {
+    for( unsigned int j = 0; j < numberOfContextsPerPosition; ++j )
+    {
+      EvaluationContextType & context
+        = this->m_EvaluationContexts[ k * numberOfContextsPerPosition + j ];
+      context.st_Parameters        = &positions[ k ];
+      context.st_Transform         = this->m_EvaluationTransforms[ k ].GetPointer();
+      context.st_SampleIndices     = nullptr;
+      context.st_SampleBegin       = std::min( nrOfSamplesPerContext * j, sampleContainerSize );
+      context.st_SampleEnd         = std::min( nrOfSamplesPerContext * ( j + 1 ), sampleContainerSize );
+      context.st_ComputeDerivative = computeDerivative;
+      context.st_NonZeroJacobianIndices.resize( nnzji );
+      context.st_ImageJacobian.SetSize( nnzji );
+      this->InitializeEvaluationContext( context );
+    }
+  }
+
+  /** Evaluate all contexts concurrently, and sum the contexts of each position. */
+  this->m_Threader->SetSingleMethod( this->GetValuesAndDerivativesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+  if( computeDerivative && numberOfContextsPerPosition > 1 )
+  {
+    this->m_Threader->SetSingleMethod( this->AccumulateEvaluationContextsThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+
+  for( unsigned int k = 0; k < numberOfPositions; ++k )
+  {
+    EvaluationContextType & context = this->m_EvaluationContexts[ k * numberOfContextsPerPosition ];
+    for( unsigned int j = 1; j < numberOfContextsPerPosition; ++j )
+    {
+      const EvaluationContextType & other
+        = this->m_EvaluationContexts[ k * numberOfContextsPerPosition + j ];
+      context.st_NumberOfPixelsCounted += other.st_NumberOfPixelsCounted;
+      for( unsigned int i = 0; i < context.st_Values.size(); ++i )
+      {
+        context.st_Values[ i ] += other.st_Values[ i ];
+      }
+    }
+  }
+
+} // end EvaluateInContexts()
+
+
+/**
+ * *********************** GetCentralDifferences ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetCentralDifferences( const ParametersType & position,
+  const ParametersType & perturbations, DerivativeType & differences ) const
+{
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  const ThreadIdType           numberOfThreads    = Self::GetNumberOfWorkUnits();
+
+  /** Without support for evaluation contexts, evaluate one position after another. */
+  if( !this->GetSupportsConcurrentEvaluation() )
+  {
+    this->ComputeCentralDifferencesFromValues( position, perturbations, differences, 1 );
+    return;
+  }
+
+  /** Draw the samples once, for all perturbations. */
+  if( this->m_UseImageSampler )
+  {
+    this->GetImageSampler()->Update();
+  }
+
+  /** With a dense Jacobian, every perturbation changes all samples: give
+   * the metric threads one position each. Note that GetValues() does not
+   * update the sampler again, since it has not been modified.
+   */
+  if( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() >= numberOfParameters )
+  {
+    this->ComputeCentralDifferencesFromValues( position, perturbations, differences,
+      std::max( numberOfThreads / 2, 1u ) );
+    return;
+  }
+
+  /** The sums over all samples at the position. */
+  ParametersListType positions( 1, position );
+  this->EvaluateInContexts( positions, false );
+  this->m_CentralDifferencesBaseContext = this->m_EvaluationContexts[ 0 ];
+  this->m_EvaluationTransforms.clear();
+  this->CheckNumberOfSamples( this->GetImageSampler()->GetOutput()->Size(),
+    this->m_CentralDifferencesBaseContext.st_NumberOfPixelsCounted );
+
+  /** The samples in the support of each parameter. */
+  this->ComputeLocalSupportSamples();
+
+  /** One context per thread, with a copy of the position. */
+  this->m_EvaluationContexts.resize( numberOfThreads );
+  this->m_EvaluationTransforms.resize( numberOfThreads );
+  this->m_EvaluationParameters.assign( numberOfThreads, position );
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  for( ThreadIdType t = 0; t < numberOfThreads; ++t )
+  {
+    typename AdvancedTransformType::Superclass::Pointer clone = this->m_AdvancedTransform->Clone();
+    this->m_EvaluationTransforms[ t ] = dynamic_cast< AdvancedTransformType * >( clone.GetPointer() );
+    if( this->m_EvaluationTransforms[ t ].IsNull() )
+    {
+      itkExceptionMacro( << "Cloning the transform failed." );
+    }
+
+    EvaluationContextType & context = this->m_EvaluationContexts[ t ];
+    context.st_Parameters        = &this->m_EvaluationParameters[ t ];
+    context.st_Transform         = this->m_EvaluationTransforms[ t ].GetPointer();
+    context.st_SampleIndices     = &this->m_LocalSupportSamples;
+    context.st_ComputeDerivative = false;
+    context.st_NonZeroJacobianIndices.resize( nnzji );
+    context.st_ImageJacobian.SetSize( nnzji );
+    this->InitializeEvaluationContext( context );
+  }
+
+  /** Compute the differences of the parameters concurrently. */
+  differences.SetSize( numberOfParameters );
+  this->m_CentralDifferencesPerturbations = &perturbations;
+  this->m_CentralDifferences              = &differences;
+  this->m_Threader->SetSingleMethod( this->GetCentralDifferencesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Release the transform clones and the views. */
+  this->m_EvaluationTransforms.clear();
+  this->m_EvaluationParameters.clear();
+  this->m_CentralDifferencesPerturbations = nullptr;
+  this->m_CentralDifferences              = nullptr;
+
+} // end GetCentralDifferences()
+
+
+/**
+ * *********************** ComputeLocalSupportSamples ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeLocalSupportSamples( void ) const
+{
+  const NumberOfParametersType numberOfParameters  = this->GetNumberOfParameters();
+  const NumberOfParametersType nnzji               = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  const unsigned long          sampleContainerSize = this->GetImageSampler()->GetOutput()->Size();
+
+  /** The nonzero Jacobian indices of all samples, computed concurrently. */
+  this->m_SampleNonZeroJacobianIndices.resize( sampleContainerSize * nnzji );
+  this->m_Threader->SetSingleMethod( this->ComputeLocalSupportSamplesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Transpose them: count the samples per parameter, and turn the counts
+   * into row pointers.
+   */
+  const NonZeroJacobianIndicesType & sampleIndices = this->m_SampleNonZeroJacobianIndices;
+  std::vector< SizeValueType > &     pointers      = this->m_LocalSupportPointers;
+  pointers.assign( numberOfParameters + 1, 0 );
+  for( std::size_t i = 0; i < sampleIndices.size(); ++i )
+  {
+    ++pointers[ sampleIndices[ i ] + 1 ];
+  }
+  for( NumberOfParametersType p = 0; p < numberOfParameters; ++p )
+  {
+    pointers[ p + 1 ] += pointers[ p ];
+  }
+
+  /** Fill the rows in the order of the samples, so that the samples of a
+   * row are sorted. pointers[ p ] serves as the fill position of row p,
+   * after which it equals the start of row p + 1, and is shifted back.
+   */
+  this->m_LocalSupportSamples.resize( pointers[ numberOfParameters ] );
+  for( unsigned long s = 0; s < sampleContainerSize; ++s )
+  {
+    for( NumberOfParametersType i = 0; i < nnzji; ++i )
+    {
+      this->m_LocalSupportSamples[ pointers[ sampleIndices[ s * nnzji + i ] ]++ ] = s;
+    }
+  }
+  for( NumberOfParametersType p = numberOfParameters; p > 0; --p )
+  {
+    pointers[ p ] = pointers[ p - 1 ];
+  }
+  pointers[ 0 ] = 0;
+
+  NonZeroJacobianIndicesType().swap( this->m_SampleNonZeroJacobianIndices );
+
+} // end ComputeLocalSupportSamples()
+
+
+/**
+ * **************** ComputeLocalSupportSamplesThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeLocalSupportSamplesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedComputeLocalSupportSamples( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeLocalSupportSamplesThreaderCallback()
+
+
+/**
+ * *********************** ThreadedComputeLocalSupportSamples ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeLocalSupportSamples( ThreadIdType threadId ) const
+{
+  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** The samples of this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+  const unsigned long pos_begin = std::min( nrOfSamplesPerThreads * threadId, sampleContainerSize );
+  const unsigned long pos_end   = std::min( nrOfSamplesPerThreads * ( threadId + 1 ), sampleContainerSize );
+
+  /** The nonzero Jacobian indices do not depend on the parameters. */
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  TransformJacobianType        jacobian;
+  NonZeroJacobianIndicesType   nzji( nnzji );
+  for( unsigned long s = pos_begin; s < pos_end; ++s )
+  {
+    const FixedImagePointType & fixedPoint = sampleContainer->ElementAt( s ).m_ImageCoordinates;
+    this->m_AdvancedTransform->GetJacobian( fixedPoint, jacobian, nzji );
+    std::copy( nzji.begin(), nzji.end(), this->m_SampleNonZeroJacobianIndices.begin() + s * nnzji );
+  }
+
+} // end ThreadedComputeLocalSupportSamples()
+
+
+/**
+ * **************** GetCentralDifferencesThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetCentralDifferencesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedGetCentralDifferences( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GetCentralDifferencesThreaderCallback()
+
+
+/**
+ * *********************** ThreadedGetCentralDifferences ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetCentralDifferences( ThreadIdType threadId ) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** The parameter range of this thread. */
+  const unsigned int numPar  = this->GetNumberOfParameters();
+  const unsigned int subSize = static_cast< unsigned int >(
+    std::ceil( static_cast< double >( numPar )
+    / static_cast< double >( numberOfThreads ) ) );
+  const unsigned int jmin = std::min( threadId * subSize, numPar );
+  const unsigned int jmax = std::min( ( threadId + 1 ) * subSize, numPar );
+
+  EvaluationContextType &       context       = this->m_EvaluationContexts[ threadId ];
+  TransformParametersType &     parameters    = this->m_EvaluationParameters[ threadId ];
+  const EvaluationContextType & base          = this->m_CentralDifferencesBaseContext;
+  const ParametersType &        perturbations = *this->m_CentralDifferencesPerturbations;
+  DerivativeType &              differences   = *this->m_CentralDifferences;
+  const unsigned int            numberOfSums  = base.st_Values.size();
+
+  /** The sums over all samples, and the values at x + p e_j and x - p e_j.
+   * The number of samples is only checked at x, since exceptions can not
+   * be thrown from the threads.
+   */
+  EvaluationContextType combined = base;
+  MeasureType           values[ 2 ];
+  DerivativeType        dummyDerivative;
+
+  for( unsigned int j = jmin; j < jmax; ++j )
+  {
+    context.st_SampleBegin = this->m_LocalSupportPointers[ j ];
+    context.st_SampleEnd   = this->m_LocalSupportPointers[ j + 1 ];
+
+    /** The sums over the support of parameter j at x. */
+    const double original = parameters[ j ];
+    context.st_Transform->SetParameters( parameters );
+    this->ResetAndEvaluateContext( context );
+    const SizeValueType        localNumberOfPixelsCounted = context.st_NumberOfPixelsCounted;
+    std::vector< MeasureType > localValues                = context.st_Values;
+
+    /** Replace them by the sums at x + p e_j and x - p e_j. */
+    for( unsigned int sign = 0; sign < 2; ++sign )
+    {
+      parameters[ j ] = sign == 0 ? original + perturbations[ j ] : original - perturbations[ j ];
+      context.st_Transform->SetParameters( parameters );
+      this->ResetAndEvaluateContext( context );
+
+      combined.st_NumberOfPixelsCounted = base.st_NumberOfPixelsCounted
+        - localNumberOfPixelsCounted + context.st_NumberOfPixelsCounted;
+      for( unsigned int i = 0; i < numberOfSums; ++i )
+      {
+        combined.st_Values[ i ] = base.st_Values[ i ] - localValues[ i ] + context.st_Values[ i ];
+      }
+      this->AfterGetValueAndDerivativeInContext( combined, values[ sign ], dummyDerivative );
+    }
+    parameters[ j ] = original;
+
+    differences[ j ] = values[ 0 ] - values[ 1 ];
+  }
+
+} // end ThreadedGetCentralDifferences()
+
+
+/**
+ * *********************** InitializeEvaluationContext ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeEvaluationContext( EvaluationContextType & context ) const
+{
+  context.st_Values.resize( 1 );
+  context.st_Derivatives.resize( 1 );
+
+} // end InitializeEvaluationContext()
+
+
+/**
+ * **************** GetValuesAndDerivativesThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetValuesAndDerivativesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedGetValuesAndDerivatives( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GetValuesAndDerivativesThreaderCallback()
+
+
+/**
+ * *********************** ThreadedGetValuesAndDerivatives ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValuesAndDerivatives( ThreadIdType threadId ) const
+{
+  const ThreadIdType numberOfThreads   = Self::GetNumberOfWorkUnits();
+  const unsigned int numberOfContexts = this->m_EvaluationContexts.size();
+
+  /** The contexts are dealt out over the threads. */
+  for( unsigned int c = threadId; c < numberOfContexts; c += numberOfThreads )
+  {
+    this->ResetAndEvaluateContext( this->m_EvaluationContexts[ c ] );
+  }
+
+} // end ThreadedGetValuesAndDerivatives()
+
+
+/**
+ * *********************** ResetAndEvaluateContext ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ResetAndEvaluateContext( EvaluationContextType & context ) const
+{
+  /** Reset the partial sums. */
+  context.st_NumberOfPixelsCounted = 0;
+  std::fill( context.st_Values.begin(), context.st_Values.end(),
+    NumericTraits< MeasureType >::Zero );
+  if( context.st_ComputeDerivative )
+  {
+    const unsigned int numberOfParameters = this->GetNumberOfParameters();
+    for( unsigned int i = 0; i < context.st_Derivatives.size(); ++i )
+    {
+      context.st_Derivatives[ i ].SetSize( numberOfParameters );
+      context.st_Derivatives[ i ].Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    }
+  }
+
+  this->ThreadedGetValueAndDerivativeInContext( context );
+
+} // end ResetAndEvaluateContext()
+
+
+/**
+ * **************** AccumulateEvaluationContextsThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::AccumulateEvaluationContextsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedAccumulateEvaluationContexts( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end AccumulateEvaluationContextsThreaderCallback()
+
+
+/**
+ * *********************** ThreadedAccumulateEvaluationContexts ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedAccumulateEvaluationContexts( ThreadIdType threadId ) const
+{
+  const ThreadIdType numberOfThreads             = Self::GetNumberOfWorkUnits();
+  const unsigned int numberOfContextsPerPosition = this->m_NumberOfEvaluationContextsPerPosition;
+  const unsigned int numberOfPositions
+    = this->m_EvaluationContexts.size() / numberOfContextsPerPosition;
+
+  /** The parameter range of this thread. */
+  const unsigned int numPar  = this->GetNumberOfParameters();
+  const unsigned int subSize = static_cast< unsigned int >(
+    std::ceil( static_cast< double >( numPar )
+    / static_cast< double >( numberOfThreads ) ) );
+  const unsigned int jmin = std::min( threadId * subSize, numPar );
+  const unsigned int jmax = std::min( ( threadId + 1 ) * subSize, numPar );
+
+  /** Add the derivatives of the other contexts of a position to the first one. */
+  for( unsigned int k = 0; k < numberOfPositions; ++k )
+  {
+    EvaluationContextType & context
+      = this->m_EvaluationContexts[ k * numberOfContextsPerPosition ];
+    for( unsigned int c = 1; c < numberOfContextsPerPosition; ++c )
+    {
+      const EvaluationContextType & other
+        = this->m_EvaluationContexts[ k * numberOfContextsPerPosition + c ];
+      for( unsigned int i = 0; i < context.st_Derivatives.size(); ++i )
+      {
+        DerivativeValueType *       sum  = context.st_Derivatives[ i ].data_block();
+        const DerivativeValueType * part = other.st_Derivatives[ i ].data_block();
+        for( unsigned int j = jmin; j < jmax; ++j )
+        {
+          sum[ j ] += part[ j ];
+        }
+      }
+    }
+  }
+
+} // end ThreadedAccumulateEvaluationContexts()
+
+
 /**
  * ********************* PrintSelf ****************************
  */
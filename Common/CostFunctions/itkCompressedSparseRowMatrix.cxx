@@ -0,0 +1,670 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkCompressedSparseRowMatrix.h"
+#include "itkNumericTraits.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+CompressedSparseRowMatrix
+::CompressedSparseRowMatrix()
+{
+  this->m_MaximumNumberOfChunkValues    = 1 << 23;
+  this->m_NumberOfSamples                = 0;
+  this->m_NumberOfNonZeroJacobianIndices = 0;
+  this->m_NumberOfComponents             = 0;
+  this->m_Threshold                      = 0.0;
+  this->m_NumberOfThreads                = 1;
+  this->m_RowsPerBlock                   = 0;
+
+} // end Constructor
+
+
+/**
+ * ******************* SetIdentity *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::SetIdentity( const SizeValueType numberOfRows )
+{
+  this->ReleaseAssembly();
+  this->m_RowPointers.resize( numberOfRows + 1 );
+  this->m_ColumnIndices.resize( numberOfRows );
+  this->m_Values.assign( numberOfRows, 1.0 );
+  for( SizeValueType r = 0; r < numberOfRows; ++r )
+  {
+    this->m_RowPointers[ r ]   = static_cast< IndexType >( r );
+    this->m_ColumnIndices[ r ] = static_cast< IndexType >( r );
+  }
+  this->m_RowPointers[ numberOfRows ] = static_cast< IndexType >( numberOfRows );
+
+} // end SetIdentity()
+
+
+/**
+ * ******************* InitializeAssembly *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::InitializeAssembly( const SizeValueType numberOfRows,
+  const unsigned int numberOfNonZeroJacobianIndices,
+  const unsigned int numberOfComponents,
+  const ThreadIdType numberOfThreads,
+  const ValueType threshold )
+{
+  if( numberOfRows >= static_cast< SizeValueType >( NumericTraits< IndexType >::max() ) )
+  {
+    itkExceptionMacro( << "ERROR: the number of rows (" << numberOfRows
+                       << ") is too large for a compressed sparse row matrix." );
+  }
+
+  this->m_NumberOfSamples                = 0;
+  this->m_NumberOfNonZeroJacobianIndices = numberOfNonZeroJacobianIndices;
+  this->m_NumberOfComponents             = numberOfComponents;
+  this->m_NumberOfThreads                = std::max< ThreadIdType >( 1, numberOfThreads );
+  this->m_Threshold                      = threshold;
+
+  /** The size of the matrix; the final arrays are filled by FinishAssembly(). */
+  this->m_RowPointers.assign( numberOfRows + 1, 0 );
+  this->m_ColumnIndices.clear();
+  this->m_Values.clear();
+
+  /** Divide the rows in blocks; more blocks than threads, to balance the work. */
+  const SizeValueType numberOfBlocks = std::max< SizeValueType >( 1,
+    std::min< SizeValueType >( numberOfRows, 8 * this->m_NumberOfThreads ) );
+  this->m_RowsPerBlock = ( numberOfRows + numberOfBlocks - 1 ) / numberOfBlocks;
+  this->m_Blocks.clear();
+  this->m_Blocks.resize( this->m_RowsPerBlock > 0
+    ? ( numberOfRows + this->m_RowsPerBlock - 1 ) / this->m_RowsPerBlock : 0 );
+
+  /** Start with the diagonal elements only; they are always present. */
+  for( SizeValueType b = 0; b < this->m_Blocks.size(); ++b )
+  {
+    const SizeValueType rowBegin = b * this->m_RowsPerBlock;
+    const SizeValueType rowEnd   = std::min( rowBegin + this->m_RowsPerBlock, numberOfRows );
+    BlockType &         block    = this->m_Blocks[ b ];
+    block.m_RowSizes.assign( rowEnd - rowBegin, 1 );
+    block.m_ColumnIndices.resize( rowEnd - rowBegin );
+    block.m_Values.assign( rowEnd - rowBegin, 0.0 );
+    for( SizeValueType r = rowBegin; r < rowEnd; ++r )
+    {
+      block.m_ColumnIndices[ r - rowBegin ] = static_cast< IndexType >( r );
+    }
+  }
+
+  /** The scratch space of the threads is allocated by the threads themselves,
+   * at the first chunk. */
+  this->m_ThreadScratch.clear();
+  this->m_ThreadScratch.resize( this->m_NumberOfThreads );
+
+  this->m_Threader = ThreaderType::New();
+  this->m_Threader->SetNumberOfWorkUnits( this->m_NumberOfThreads );
+
+} // end InitializeAssembly()
+
+
+/**
+ * ******************* GetNumberOfSamplesPerChunk *******************
+ */
+
+SizeValueType
+CompressedSparseRowMatrix
+::GetNumberOfSamplesPerChunk( void ) const
+{
+  const SizeValueType valuesPerSample = std::max< SizeValueType >( 1,
+    static_cast< SizeValueType >( this->m_NumberOfNonZeroJacobianIndices ) * this->m_NumberOfComponents );
+  return std::max< SizeValueType >( 1, this->m_MaximumNumberOfChunkValues / valuesPerSample );
+
+} // end GetNumberOfSamplesPerChunk()
+
+
+/**
+ * ******************* BeginChunk *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::BeginChunk( const SizeValueType numberOfSamples )
+{
+  if( numberOfSamples > this->GetNumberOfSamplesPerChunk() )
+  {
+    itkExceptionMacro( << "ERROR: a chunk of " << numberOfSamples
+                       << " samples is larger than the maximum of "
+                       << this->GetNumberOfSamplesPerChunk() << "." );
+  }
+
+  /** The storage is reused by the next chunks. */
+  this->m_NumberOfSamples = numberOfSamples;
+  const SizeValueType numberOfEntries = numberOfSamples * this->m_NumberOfNonZeroJacobianIndices;
+  this->m_SampleIndices.resize( numberOfEntries );
+  this->m_SampleJacobians.resize( numberOfEntries * this->m_NumberOfComponents );
+  this->m_SampleIsValid.assign( numberOfSamples, 0 );
+
+} // end BeginChunk()
+
+
+/**
+ * ******************* SetSampleJacobian *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::SetSampleJacobian( const SizeValueType sample,
+  const NonZeroJacobianIndicesType & nzji, const ValueType * jacobian )
+{
+  const SizeValueType k      = this->m_NumberOfNonZeroJacobianIndices;
+  const SizeValueType offset = sample * k;
+  for( SizeValueType i = 0; i < k; ++i )
+  {
+    this->m_SampleIndices[ offset + i ] = static_cast< IndexType >( nzji[ i ] );
+  }
+  std::copy( jacobian, jacobian + k * this->m_NumberOfComponents,
+    this->m_SampleJacobians.begin() + offset * this->m_NumberOfComponents );
+  this->m_SampleIsValid[ sample ] = 1;
+
+} // end SetSampleJacobian()
+
+
+/**
+ * ******************* AddChunk *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::AddChunk( void )
+{
+  const SizeValueType numberOfRows = this->GetNumberOfRows();
+  const SizeValueType k            = this->m_NumberOfNonZeroJacobianIndices;
+
+  /** For each row, list the entries of the valid samples that refer to it. */
+  this->m_ContributionPointers.assign( numberOfRows + 1, 0 );
+  for( SizeValueType s = 0; s < this->m_NumberOfSamples; ++s )
+  {
+    if( !this->m_SampleIsValid[ s ] )
+    {
+      continue;
+    }
+    for( SizeValueType i = s * k; i < ( s + 1 ) * k; ++i )
+    {
+      ++this->m_ContributionPointers[ this->m_SampleIndices[ i ] + 1 ];
+    }
+  }
+  for( SizeValueType r = 0; r < numberOfRows; ++r )
+  {
+    this->m_ContributionPointers[ r + 1 ] += this->m_ContributionPointers[ r ];
+  }
+  if( this->m_ContributionPointers[ numberOfRows ] == 0 )
+  {
+    return;
+  }
+  this->m_Contributions.resize( this->m_ContributionPointers[ numberOfRows ] );
+  std::vector< SizeValueType > fill( this->m_ContributionPointers.begin(),
+    this->m_ContributionPointers.end() - 1 );
+  for( SizeValueType s = 0; s < this->m_NumberOfSamples; ++s )
+  {
+    if( !this->m_SampleIsValid[ s ] )
+    {
+      continue;
+    }
+    for( SizeValueType i = s * k; i < ( s + 1 ) * k; ++i )
+    {
+      this->m_Contributions[ fill[ this->m_SampleIndices[ i ] ]++ ] = i;
+    }
+  }
+
+  /** Update the rows. */
+  MultiThreaderParameterType temp;
+  temp.t_Matrix          = this;
+  temp.t_NumberOfThreads = this->m_NumberOfThreads;
+
+  this->m_Threader->SetSingleMethod( AddChunkThreaderCallback, &temp );
+  this->m_Threader->SingleMethodExecute();
+
+} // end AddChunk()
+
+
+/**
+ * ******************* FinishAssembly *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::FinishAssembly( void )
+{
+  const SizeValueType numberOfRows = this->GetNumberOfRows();
+
+  /** Compute the row pointers, and check that the indices fit. */
+  SizeValueType numberOfNonZeros = 0;
+  for( SizeValueType b = 0; b < this->m_Blocks.size(); ++b )
+  {
+    const std::vector< IndexType > & rowSizes = this->m_Blocks[ b ].m_RowSizes;
+    for( SizeValueType r = 0; r < rowSizes.size(); ++r )
+    {
+      this->m_RowPointers[ b * this->m_RowsPerBlock + r ] = static_cast< IndexType >( numberOfNonZeros );
+      numberOfNonZeros += rowSizes[ r ];
+      if( numberOfNonZeros > static_cast< SizeValueType >( NumericTraits< IndexType >::max() ) )
+      {
+        this->ReleaseAssembly();
+        itkExceptionMacro( << "ERROR: the number of nonzero elements is too large "
+                           << "for a compressed sparse row matrix." );
+      }
+    }
+  }
+  this->m_RowPointers[ numberOfRows ] = static_cast< IndexType >( numberOfNonZeros );
+
+  /** Copy the blocks into the final arrays. */
+  this->m_ColumnIndices.resize( numberOfNonZeros );
+  this->m_Values.resize( numberOfNonZeros );
+
+  MultiThreaderParameterType temp;
+  temp.t_Matrix          = this;
+  temp.t_NumberOfThreads = this->m_NumberOfThreads;
+
+  this->m_Threader->SetSingleMethod( GatherThreaderCallback, &temp );
+  this->m_Threader->SingleMethodExecute();
+
+  this->ReleaseAssembly();
+
+} // end FinishAssembly()
+
+
+/**
+ * ******************* ReleaseAssembly *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::ReleaseAssembly( void )
+{
+  std::vector< IndexType >().swap( this->m_SampleIndices );
+  std::vector< ValueType >().swap( this->m_SampleJacobians );
+  std::vector< unsigned char >().swap( this->m_SampleIsValid );
+  std::vector< SizeValueType >().swap( this->m_ContributionPointers );
+  std::vector< SizeValueType >().swap( this->m_Contributions );
+  std::vector< BlockType >().swap( this->m_Blocks );
+  std::vector< ThreadScratchType >().swap( this->m_ThreadScratch );
+  this->m_NumberOfSamples = 0;
+  this->m_Threader        = nullptr;
+
+} // end ReleaseAssembly()
+
+
+/**
+ * ******************* AddChunkThreaderCallback *******************
+ */
+
+ITK_THREAD_RETURN_TYPE
+CompressedSparseRowMatrix
+::AddChunkThreaderCallback( void * arg )
+{
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                 threadID   = infoStruct->WorkUnitID;
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+  Self * matrix = temp->t_Matrix;
+
+  /** Scratch space of this thread: a dense row, and the row in which each
+   * column was last used. It is allocated at the first chunk, and reused by
+   * the next ones. */
+  ThreadScratchType & scratch = matrix->m_ThreadScratch[ threadID ];
+  if( scratch.m_Marker.empty() )
+  {
+    const SizeValueType numberOfRows = matrix->GetNumberOfRows();
+    scratch.m_Marker.assign( numberOfRows, -1 );
+    scratch.m_Accumulator.resize( numberOfRows );
+  }
+
+  for( SizeValueType b = threadID; b < matrix->m_Blocks.size(); b += temp->t_NumberOfThreads )
+  {
+    matrix->ThreadedAddChunkToBlock( b, scratch.m_Marker, scratch.m_Accumulator );
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end AddChunkThreaderCallback()
+
+
+/**
+ * ******************* ThreadedAddChunkToBlock *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::ThreadedAddChunkToBlock( const SizeValueType block,
+  std::vector< IndexType > & marker, std::vector< ValueType > & accumulator )
+{
+  const SizeValueType numberOfRows = this->GetNumberOfRows();
+  const SizeValueType k            = this->m_NumberOfNonZeroJacobianIndices;
+  const unsigned int  m            = this->m_NumberOfComponents;
+  const SizeValueType rowBegin     = block * this->m_RowsPerBlock;
+  const SizeValueType rowEnd       = std::min( rowBegin + this->m_RowsPerBlock, numberOfRows );
+
+  /** Nothing to do when no sample of the chunk refers to this block. */
+  if( this->m_ContributionPointers[ rowBegin ] == this->m_ContributionPointers[ rowEnd ] )
+  {
+    return;
+  }
+
+  /** The rows are merged into new arrays, which replace the old ones. */
+  BlockType &              input = this->m_Blocks[ block ];
+  std::vector< IndexType > outputColumnIndices;
+  std::vector< ValueType > outputValues;
+  outputColumnIndices.reserve( input.m_ColumnIndices.size() );
+  outputValues.reserve( input.m_Values.size() );
+
+  std::vector< IndexType > columns;
+  SizeValueType            inputOffset = 0;
+  for( SizeValueType r = rowBegin; r < rowEnd; ++r )
+  {
+    const IndexType     row          = static_cast< IndexType >( r );
+    const SizeValueType inputRowSize = input.m_RowSizes[ r - rowBegin ];
+    const IndexType *   inputColumns = input.m_ColumnIndices.data() + inputOffset;
+    const ValueType *   inputValues  = input.m_Values.data() + inputOffset;
+    inputOffset += inputRowSize;
+
+    /** Copy a row to which the chunk does not contribute. */
+    if( this->m_ContributionPointers[ r ] == this->m_ContributionPointers[ r + 1 ] )
+    {
+      outputColumnIndices.insert( outputColumnIndices.end(), inputColumns, inputColumns + inputRowSize );
+      outputValues.insert( outputValues.end(), inputValues, inputValues + inputRowSize );
+      continue;
+    }
+
+    /** Load the row; the diagonal element comes first. The markers that a
+     * previous chunk left for this row all belong to stored columns, which
+     * are loaded here again, so the scratch space needs no reset. */
+    columns.assign( inputColumns, inputColumns + inputRowSize );
+    for( SizeValueType c = 0; c < inputRowSize; ++c )
+    {
+      marker[ inputColumns[ c ] ]      = row;
+      accumulator[ inputColumns[ c ] ] = inputValues[ c ];
+    }
+
+    /** Add the contributions of all samples of the chunk that refer to this row. */
+    bool newColumns = false;
+    for( SizeValueType c = this->m_ContributionPointers[ r ];
+      c < this->m_ContributionPointers[ r + 1 ]; ++c )
+    {
+      const SizeValueType entry       = this->m_Contributions[ c ];
+      const SizeValueType sampleBegin = ( entry / k ) * k;
+      const ValueType *   jacobian_i  = &this->m_SampleJacobians[ entry * m ];
+
+      for( SizeValueType j = sampleBegin; j < sampleBegin + k; ++j )
+      {
+        const IndexType column = this->m_SampleIndices[ j ];
+        if( column < row )
+        {
+          continue;
+        }
+
+        const ValueType * jacobian_j = &this->m_SampleJacobians[ j * m ];
+        ValueType         value      = 0.0;
+        for( unsigned int l = 0; l < m; ++l )
+        {
+          value += jacobian_i[ l ] * jacobian_j[ l ];
+        }
+        if( std::abs( value ) < this->m_Threshold )
+        {
+          continue;
+        }
+
+        if( marker[ column ] != row )
+        {
+          marker[ column ]      = row;
+          accumulator[ column ] = value;
+          columns.push_back( column );
+          newColumns = true;
+        }
+        else
+        {
+          accumulator[ column ] += value;
+        }
+      }
+    }
+
+    /** Store the row, with sorted column indices. */
+    if( newColumns )
+    {
+      std::sort( columns.begin() + 1, columns.end() );
+    }
+    input.m_RowSizes[ r - rowBegin ] = static_cast< IndexType >( columns.size() );
+    for( std::size_t c = 0; c < columns.size(); ++c )
+    {
+      outputColumnIndices.push_back( columns[ c ] );
+      outputValues.push_back( accumulator[ columns[ c ] ] );
+    }
+  }
+
+  input.m_ColumnIndices.swap( outputColumnIndices );
+  input.m_Values.swap( outputValues );
+
+} // end ThreadedAddChunkToBlock()
+
+
+/**
+ * ******************* GatherThreaderCallback *******************
+ */
+
+ITK_THREAD_RETURN_TYPE
+CompressedSparseRowMatrix
+::GatherThreaderCallback( void * arg )
+{
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                 threadID   = infoStruct->WorkUnitID;
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+  Self * matrix = temp->t_Matrix;
+
+  for( SizeValueType b = threadID; b < matrix->m_Blocks.size(); b += temp->t_NumberOfThreads )
+  {
+    matrix->ThreadedGatherBlock( b );
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GatherThreaderCallback()
+
+
+/**
+ * ******************* ThreadedGatherBlock *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::ThreadedGatherBlock( const SizeValueType block )
+{
+  BlockType &         input  = this->m_Blocks[ block ];
+  const SizeValueType offset = this->m_RowPointers[ block * this->m_RowsPerBlock ];
+
+  std::copy( input.m_ColumnIndices.begin(), input.m_ColumnIndices.end(),
+    this->m_ColumnIndices.begin() + offset );
+  std::copy( input.m_Values.begin(), input.m_Values.end(),
+    this->m_Values.begin() + offset );
+
+  /** Release the memory of this block. */
+  std::vector< IndexType >().swap( input.m_ColumnIndices );
+  std::vector< ValueType >().swap( input.m_Values );
+
+} // end ThreadedGatherBlock()
+
+
+/**
+ * ******************* Scale *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::Scale( const ValueType factor )
+{
+  for( SizeValueType i = 0; i < this->m_Values.size(); ++i )
+  {
+    this->m_Values[ i ] *= factor;
+  }
+
+} // end Scale()
+
+
+/**
+ * ******************* Add *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::Add( const Self * other, const ValueType weight )
+{
+  const SizeValueType numberOfRows = other->GetNumberOfRows();
+
+  /** Adding to an empty matrix is a copy. */
+  if( this->GetNumberOfRows() == 0 )
+  {
+    this->m_RowPointers   = other->m_RowPointers;
+    this->m_ColumnIndices = other->m_ColumnIndices;
+    this->m_Values        = other->m_Values;
+    this->Scale( weight );
+    return;
+  }
+  if( this->GetNumberOfRows() != numberOfRows )
+  {
+    itkExceptionMacro( << "ERROR: matrices of different sizes can not be added." );
+  }
+
+  /** Merge the sorted rows. */
+  std::vector< IndexType > rowPointers( numberOfRows + 1 );
+  std::vector< IndexType > columnIndices;
+  std::vector< ValueType > values;
+  columnIndices.reserve( this->GetNumberOfNonZeros() + other->GetNumberOfNonZeros() );
+  values.reserve( this->GetNumberOfNonZeros() + other->GetNumberOfNonZeros() );
+  for( SizeValueType r = 0; r < numberOfRows; ++r )
+  {
+    rowPointers[ r ] = static_cast< IndexType >( columnIndices.size() );
+    IndexType       a    = this->m_RowPointers[ r ];
+    const IndexType aEnd = this->m_RowPointers[ r + 1 ];
+    IndexType       b    = other->m_RowPointers[ r ];
+    const IndexType bEnd = other->m_RowPointers[ r + 1 ];
+    while( a < aEnd || b < bEnd )
+    {
+      if( b == bEnd || ( a < aEnd && this->m_ColumnIndices[ a ] < other->m_ColumnIndices[ b ] ) )
+      {
+        columnIndices.push_back( this->m_ColumnIndices[ a ] );
+        values.push_back( this->m_Values[ a ] );
+        ++a;
+      }
+      else if( a == aEnd || other->m_ColumnIndices[ b ] < this->m_ColumnIndices[ a ] )
+      {
+        columnIndices.push_back( other->m_ColumnIndices[ b ] );
+        values.push_back( weight * other->m_Values[ b ] );
+        ++b;
+      }
+      else
+      {
+        columnIndices.push_back( this->m_ColumnIndices[ a ] );
+        values.push_back( this->m_Values[ a ] + weight * other->m_Values[ b ] );
+        ++a;
+        ++b;
+      }
+    }
+  }
+  rowPointers[ numberOfRows ] = static_cast< IndexType >( columnIndices.size() );
+
+  this->m_RowPointers.swap( rowPointers );
+  this->m_ColumnIndices.swap( columnIndices );
+  this->m_Values.swap( values );
+
+} // end Add()
+
+
+/**
+ * ******************* ConvertFromVnlSparseMatrix *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::ConvertFromVnlSparseMatrix( VnlSparseMatrixType & H )
+{
+  typedef VnlSparseMatrixType::row RowType;
+
+  const SizeValueType numberOfRows = H.rows();
+  this->m_RowPointers.resize( numberOfRows + 1 );
+  this->m_ColumnIndices.clear();
+  this->m_Values.clear();
+  for( SizeValueType r = 0; r < numberOfRows; ++r )
+  {
+    const IndexType row = static_cast< IndexType >( r );
+    this->m_RowPointers[ r ] = static_cast< IndexType >( this->m_Values.size() );
+
+    /** Skip a lower triangular part, if any, and make sure the diagonal is present. */
+    RowType &               rowVector = H.get_row( r );
+    RowType::const_iterator rowIt     = rowVector.begin();
+    for(; rowIt != rowVector.end() && static_cast< IndexType >( rowIt->first ) < row; ++rowIt )
+    {}
+    if( rowIt == rowVector.end() || static_cast< IndexType >( rowIt->first ) != row )
+    {
+      this->m_ColumnIndices.push_back( row );
+      this->m_Values.push_back( 0.0 );
+    }
+    for(; rowIt != rowVector.end(); ++rowIt )
+    {
+      this->m_ColumnIndices.push_back( static_cast< IndexType >( rowIt->first ) );
+      this->m_Values.push_back( rowIt->second );
+    }
+
+    /** Release the memory of this row. */
+    RowType().swap( rowVector );
+  }
+  this->m_RowPointers[ numberOfRows ] = static_cast< IndexType >( this->m_Values.size() );
+  H.set_size( 0, 0 );
+
+} // end ConvertFromVnlSparseMatrix()
+
+
+/**
+ * ******************* ConvertToVnlSparseMatrix *******************
+ */
+
+void
+CompressedSparseRowMatrix
+::ConvertToVnlSparseMatrix( VnlSparseMatrixType & H ) const
+{
+  typedef VnlSparseMatrixType::row    RowType;
+  typedef VnlSparseMatrixType::pair_t ElementType;
+
+  const SizeValueType numberOfRows = this->GetNumberOfRows();
+  H.set_size( numberOfRows, numberOfRows );
+  for( SizeValueType r = 0; r < numberOfRows; ++r )
+  {
+    RowType & rowVector = H.get_row( r );
+    rowVector.reserve( this->m_RowPointers[ r + 1 ] - this->m_RowPointers[ r ] );
+    for( IndexType i = this->m_RowPointers[ r ]; i < this->m_RowPointers[ r + 1 ]; ++i )
+    {
+      rowVector.push_back( ElementType( this->m_ColumnIndices[ i ], this->m_Values[ i ] ) );
+    }
+  }
+
+} // end ConvertToVnlSparseMatrix()
+
+
+} // end namespace itk
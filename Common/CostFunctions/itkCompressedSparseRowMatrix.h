@@ -0,0 +1,236 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCompressedSparseRowMatrix_h
+#define __itkCompressedSparseRowMatrix_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkIntTypes.h"
+#include "itkPlatformMultiThreader.h"
+#include "vnl/vnl_sparse_matrix.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class CompressedSparseRowMatrix
+ * \brief A symmetric sparse matrix in compressed sparse row format, used for the SelfHessian.
+ *
+ * Only the upper triangular part is stored. The column indices of each row
+ * are sorted, and the diagonal element is always present, as the first
+ * element of each row. Read as a compressed sparse column matrix, the arrays
+ * describe the lower triangular part, so that they can be handed to a
+ * cholmod_sparse with stype -1 without copying. For that reason the
+ * indices have the type of the int version of cholmod.
+ *
+ * The matrix is assembled as H = sum_s G_s G_s^T, where G_s is the
+ * (numberOfNonZeroJacobianIndices x numberOfComponents) Jacobian of a sample s.
+ * The samples are processed in chunks, so that only the Jacobians of one
+ * chunk are in memory at the same time:
+ * - InitializeAssembly() prepares an empty matrix;
+ * - for each chunk, BeginChunk() is called, then the Jacobians of the samples
+ *   of the chunk are stored with SetSampleJacobian(), which may be called from
+ *   multiple threads for different samples, and then AddChunk() adds the
+ *   contributions of the chunk to the matrix;
+ * - FinishAssembly() copies the rows into the final arrays.
+ *
+ * AddChunk() works in parallel on blocks of rows. Each thread owns a set of
+ * blocks, so no locking is needed. A row r is updated by visiting only the
+ * samples of the chunk that have r among their nonzero Jacobian indices, and
+ * by accumulating into a dense scratch row. The memory needed is therefore
+ * the size of the result, plus the Jacobians of one chunk.
+ */
+
+class CompressedSparseRowMatrix : public Object
+{
+public:
+
+  /** Standard ITK typedefs. */
+  typedef CompressedSparseRowMatrix  Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( CompressedSparseRowMatrix, Object );
+
+  /** Typedefs. */
+  typedef double                         ValueType;
+  typedef int                            IndexType;
+  typedef vnl_sparse_matrix< ValueType > VnlSparseMatrixType;
+  typedef std::vector< unsigned long >   NonZeroJacobianIndicesType;
+  typedef itk::PlatformMultiThreader     ThreaderType;
+  typedef ThreaderType::WorkUnitInfo     ThreadInfoType;
+
+  /** Make this an identity matrix of size numberOfRows. */
+  void SetIdentity( const SizeValueType numberOfRows );
+
+  /** Set/Get the maximum number of Jacobian values of a chunk. Default 2^23,
+   * which is 64 MB.
+   */
+  itkSetMacro( MaximumNumberOfChunkValues, SizeValueType );
+  itkGetConstMacro( MaximumNumberOfChunkValues, SizeValueType );
+
+  /** Prepare the assembly of an empty matrix of size numberOfRows, from
+   * sample Jacobians of (numberOfNonZeroJacobianIndices x numberOfComponents)
+   * values. Contributions of a sample to an element with a magnitude below
+   * threshold are skipped.
+   */
+  void InitializeAssembly( const SizeValueType numberOfRows,
+    const unsigned int numberOfNonZeroJacobianIndices,
+    const unsigned int numberOfComponents,
+    const ThreadIdType numberOfThreads,
+    const ValueType threshold );
+
+  /** The number of samples of a chunk. */
+  SizeValueType GetNumberOfSamplesPerChunk( void ) const;
+
+  /** Start a chunk of numberOfSamples samples, at most GetNumberOfSamplesPerChunk(). */
+  void BeginChunk( const SizeValueType numberOfSamples );
+
+  /** Store the Jacobian of a sample of the current chunk, (numberOfNonZeroJacobianIndices
+   * x numberOfComponents) values in row-major order. Samples for which this
+   * function is not called do not contribute.
+   */
+  void SetSampleJacobian( const SizeValueType sample,
+    const NonZeroJacobianIndicesType & nzji, const ValueType * jacobian );
+
+  /** Add sum_s G_s G_s^T of the samples of the current chunk. */
+  void AddChunk( void );
+
+  /** Copy the assembled rows into the final arrays, and release the memory
+   * used for the assembly.
+   */
+  void FinishAssembly( void );
+
+  /** Multiply all elements by factor. */
+  void Scale( const ValueType factor );
+
+  /** this = this + weight * other. */
+  void Add( const Self * other, const ValueType weight );
+
+  /** Copy from a vnl_sparse_matrix of which the upper triangle is stored.
+   * The input is destroyed, to save memory.
+   */
+  void ConvertFromVnlSparseMatrix( VnlSparseMatrixType & H );
+
+  /** Copy the upper triangle into a vnl_sparse_matrix. */
+  void ConvertToVnlSparseMatrix( VnlSparseMatrixType & H ) const;
+
+  /** Get the number of rows. */
+  SizeValueType GetNumberOfRows( void ) const
+  { return this->m_RowPointers.empty() ? 0 : this->m_RowPointers.size() - 1; }
+
+  /** Get the number of stored elements. */
+  SizeValueType GetNumberOfNonZeros( void ) const
+  { return this->m_Values.size(); }
+
+  /** Access the arrays; size numberOfRows + 1, and the number of nonzeros. */
+  IndexType * GetRowPointers( void ) { return this->m_RowPointers.data(); }
+  IndexType * GetColumnIndices( void ) { return this->m_ColumnIndices.data(); }
+  ValueType * GetValues( void ) { return this->m_Values.data(); }
+  const IndexType * GetRowPointers( void ) const { return this->m_RowPointers.data(); }
+  const IndexType * GetColumnIndices( void ) const { return this->m_ColumnIndices.data(); }
+  const ValueType * GetValues( void ) const { return this->m_Values.data(); }
+
+  /** Access the diagonal element of row r. */
+  ValueType & GetDiagonalElement( const SizeValueType r )
+  { return this->m_Values[ this->m_RowPointers[ r ] ]; }
+
+protected:
+
+  CompressedSparseRowMatrix();
+  ~CompressedSparseRowMatrix() override {}
+
+private:
+
+  CompressedSparseRowMatrix( const Self & ); // purposely not implemented
+  void operator=( const Self & );            // purposely not implemented
+
+  /** The threader callbacks of the assembly. */
+  static ITK_THREAD_RETURN_TYPE AddChunkThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE GatherThreaderCallback( void * arg );
+
+  /** Add the contributions of the current chunk to the rows of one block. */
+  void ThreadedAddChunkToBlock( const SizeValueType block,
+    std::vector< IndexType > & marker, std::vector< ValueType > & accumulator );
+
+  /** Release the memory used for the assembly. */
+  void ReleaseAssembly( void );
+
+  /** Copy the rows of one block into the final arrays. */
+  void ThreadedGatherBlock( const SizeValueType block );
+
+  /** The rows of a block, updated by one thread. */
+  struct BlockType
+  {
+    std::vector< IndexType > m_RowSizes;
+    std::vector< IndexType > m_ColumnIndices;
+    std::vector< ValueType > m_Values;
+  };
+
+  /** The scratch space of a thread, of size numberOfRows. */
+  struct ThreadScratchType
+  {
+    std::vector< IndexType > m_Marker;
+    std::vector< ValueType > m_Accumulator;
+  };
+
+  struct MultiThreaderParameterType
+  {
+    Self *       t_Matrix;
+    ThreadIdType t_NumberOfThreads;
+  };
+
+  /** The matrix. */
+  std::vector< IndexType > m_RowPointers;
+  std::vector< IndexType > m_ColumnIndices;
+  std::vector< ValueType > m_Values;
+
+  /** The sample Jacobians of the current chunk, and for each row the samples
+   * of the chunk that contribute to it.
+   */
+  SizeValueType                m_MaximumNumberOfChunkValues;
+  SizeValueType                m_NumberOfSamples;
+  unsigned int                 m_NumberOfNonZeroJacobianIndices;
+  unsigned int                 m_NumberOfComponents;
+  std::vector< IndexType >     m_SampleIndices;
+  std::vector< ValueType >     m_SampleJacobians;
+  std::vector< unsigned char > m_SampleIsValid;
+  std::vector< SizeValueType > m_ContributionPointers;
+  std::vector< SizeValueType > m_Contributions;
+
+  /** Assembly state. */
+  ValueType                m_Threshold;
+  ThreadIdType             m_NumberOfThreads;
+  ThreaderType::Pointer    m_Threader;
+  SizeValueType            m_RowsPerBlock;
+  std::vector< BlockType > m_Blocks;
+
+  std::vector< ThreadScratchType > m_ThreadScratch;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkCompressedSparseRowMatrix_h
@@ -0,0 +1,132 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkMultiPositionCostFunctionInterface_h
+#define __itkMultiPositionCostFunctionInterface_h
+
+#include "itkSingleValuedCostFunction.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+
+/** \class MultiPositionCostFunctionInterface
+ * \brief An interface for cost functions that can compute their value and
+ * derivative at several positions in one call.
+ *
+ * Optimizers that need the cost function at several positions that do not
+ * depend on each other, such as a speculative line search or a finite
+ * difference gradient, can check with a dynamic_cast whether their cost
+ * function implements this interface.
+ *
+ * All positions are evaluated with the same samples. If
+ * GetSupportsConcurrentEvaluation() returns true, the positions are
+ * evaluated concurrently. Otherwise they are evaluated one after another,
+ * and optimizers should not expect any gain from calling
+ * GetValuesAndDerivatives() or GetValues().
+ *
+ * GetCentralDifferences() computes the differences f(x + p_j e_j) - f(x - p_j e_j)
+ * for all parameters j. Cost functions may compute these without evaluating
+ * all 2N positions, for example by recomputing only the part of the cost
+ * function that depends on parameter j.
+ *
+ * This is an interface only: it does not derive from itk::Object, and is
+ * meant to be inherited next to a SingleValuedCostFunction.
+ */
+
+class MultiPositionCostFunctionInterface
+{
+public:
+
+  /** Typedefs. */
+  typedef SingleValuedCostFunction::MeasureType    MeasureType;
+  typedef SingleValuedCostFunction::DerivativeType DerivativeType;
+  typedef SingleValuedCostFunction::ParametersType ParametersType;
+  typedef std::vector< ParametersType >            ParametersListType;
+  typedef std::vector< MeasureType >               MeasureListType;
+  typedef std::vector< DerivativeType >            DerivativeListType;
+
+  /** Whether GetValuesAndDerivatives() evaluates the positions concurrently. */
+  virtual bool GetSupportsConcurrentEvaluation( void ) const = 0;
+
+  /** Compute the value and the derivative at each of the positions. */
+  virtual void GetValuesAndDerivatives(
+    const ParametersListType & positions,
+    MeasureListType & values,
+    DerivativeListType & derivatives ) const = 0;
+
+  /** Compute the value at each of the positions. */
+  virtual void GetValues(
+    const ParametersListType & positions,
+    MeasureListType & values ) const = 0;
+
+  /** Compute differences[ j ] = f( position + perturbations[ j ] e_j )
+   * - f( position - perturbations[ j ] e_j ) for each parameter j.
+   */
+  virtual void GetCentralDifferences(
+    const ParametersType & position,
+    const ParametersType & perturbations,
+    DerivativeType & differences ) const = 0;
+
+protected:
+
+  MultiPositionCostFunctionInterface() {}
+  virtual ~MultiPositionCostFunctionInterface() {}
+
+  /** Compute the central differences with GetValues(), for blocks of
+   * numberOfParametersPerBlock parameters at a time. Implementations can use
+   * this when they can not do better than evaluating all 2N positions.
+   */
+  void ComputeCentralDifferencesFromValues(
+    const ParametersType & position,
+    const ParametersType & perturbations,
+    DerivativeType & differences,
+    const unsigned int numberOfParametersPerBlock ) const
+  {
+    const unsigned int numberOfParameters = position.GetSize();
+    const unsigned int blockSize          = numberOfParametersPerBlock > 0 ? numberOfParametersPerBlock : 1;
+    differences.SetSize( numberOfParameters );
+
+    ParametersListType positions;
+    MeasureListType    values;
+    for( unsigned int first = 0; first < numberOfParameters; first += blockSize )
+    {
+      const unsigned int last = std::min( first + blockSize, numberOfParameters );
+
+      /** The positions x + p_j e_j and x - p_j e_j, for j in the block. */
+      positions.assign( 2 * ( last - first ), position );
+      for( unsigned int j = first; j < last; ++j )
+      {
+        positions[ 2 * ( j - first ) ][ j ]     += perturbations[ j ];
+        positions[ 2 * ( j - first ) + 1 ][ j ] -= perturbations[ j ];
+      }
+
+      this->GetValues( positions, values );
+      for( unsigned int j = first; j < last; ++j )
+      {
+        differences[ j ] = values[ 2 * ( j - first ) ] - values[ 2 * ( j - first ) + 1 ];
+      }
+    }
+  }
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkMultiPositionCostFunctionInterface_h
@@ -20,6 +20,7 @@
 
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkKernelFunctionBase2.h"
+#include "itkParzenWindowHistogramKernels.h"
 
 
 namespace itk
@@ -215,6 +216,24 @@ public:
   itkSetMacro( FiniteDifferencePerturbation, double );
   itkGetConstMacro( FiniteDifferencePerturbation, double );
 
+  /** Whether to cache the fixed Parzen window of each sample, i.e. the lowest
+   * affected fixed bin and the fixed Parzen values. The cache is only used for
+   * image samplers that do not select new samples on update, such as the full
+   * and grid samplers, and is built once per resolution. It requires memory for
+   * an index and FixedKernelBSplineOrder + 1 values per sample. Default: true.
+   */
+  itkSetMacro( UseFixedParzenValuesCache, bool );
+  itkGetConstMacro( UseFixedParzenValuesCache, bool );
+
+  /** Whether to compute the fixed marginal pdf once per resolution, from the
+   * cached fixed Parzen values of all samples, instead of every iteration from
+   * the joint pdf. Only used when the fixed Parzen values are cached. The result
+   * differs from the marginal of the joint pdf when samples map outside the
+   * moving image or mask. Default: false.
+   */
+  itkSetMacro( UsePrecomputedFixedImageMarginalPDF, bool );
+  itkGetConstMacro( UsePrecomputedFixedImageMarginalPDF, bool );
+
 protected:
 
   /** The constructor. */
@@ -300,6 +319,16 @@ protected:
   /** Threading related parameters. */
   mutable std::vector< JointPDFPointer > m_ThreaderJointPDFs;
 
+  /** The cached fixed Parzen windows: for each sample the lowest affected fixed
+   * bin, and the fixed Parzen values, m_JointPDFWindow.GetSize()[ 1 ] per sample.
+   */
+  mutable bool                             m_FixedParzenValuesCacheIsValid;
+  mutable const ImageSampleContainerType * m_FixedParzenValuesCacheSampleContainer;
+  mutable ModifiedTimeType                 m_FixedParzenValuesCacheUpdateMTime;
+  mutable std::vector< int >               m_FixedParzenWindowIndices;
+  mutable std::vector< PDFValueType >      m_FixedParzenValues;
+  mutable MarginalPDFType                  m_PrecomputedFixedImageMarginalPDF;
+
   /** Helper structs that multi-threads the computation of
    * the metric derivative using ITK threads.
    */
@@ -309,10 +338,14 @@ protected:
   };
   ParzenWindowHistogramMultiThreaderParameterType m_ParzenWindowHistogramThreaderParameters;
 
+  /** The joint PDF of a thread is a plain array, with the layout of the
+   * buffer of m_JointPDF, aligned to a cache line.
+   */
+  typedef ParzenWindowHistogramKernels::AlignedArrayType AlignedJointPDFArrayType;
   struct ParzenWindowHistogramGetValueAndDerivativePerThreadStruct
   {
-    SizeValueType   st_NumberOfPixelsCounted;
-    JointPDFPointer st_JointPDF;
+    SizeValueType            st_NumberOfPixelsCounted;
+    AlignedJointPDFArrayType st_JointPDF;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, ParzenWindowHistogramGetValueAndDerivativePerThreadStruct,
     PaddedParzenWindowHistogramGetValueAndDerivativePerThreadStruct );
@@ -357,6 +390,56 @@ protected:
     const NonZeroJacobianIndicesType * nzji,
     JointPDFType * jointPDF ) const;
 
+  /** Update the joint PDF and on demand the pdf derivatives, given the fixed
+   * Parzen window of the pixel pair: the lowest affected fixed bin and the
+   * fixed Parzen values.
+   */
+  void UpdateJointPDFAndDerivatives(
+    const OffsetValueType fixedParzenWindowIndex,
+    const PDFValueType * fixedParzenValues,
+    const RealType & movingImageValue,
+    const DerivativeType * imageJacobian,
+    const NonZeroJacobianIndicesType * nzji,
+    JointPDFType * jointPDF ) const;
+
+  /** Update a joint PDF buffer with a pixel pair, given the fixed Parzen window
+   * of the pixel pair. The buffer has the layout of the buffer of m_JointPDF.
+   */
+  void UpdateJointPDF(
+    const OffsetValueType fixedParzenWindowIndex,
+    const PDFValueType * fixedParzenValues,
+    const RealType & movingImageValue,
+    PDFValueType * jointPDF ) const;
+
+  /** Compute the fixed Parzen window of a fixed image value, that has already
+   * been passed through the fixed image limiter.
+   */
+  void ComputeFixedParzenValues(
+    const RealType & fixedImageValue,
+    OffsetValueType & fixedParzenWindowIndex,
+    PDFValueType * fixedParzenValues ) const;
+
+  /** Get the fixed Parzen window of sample sampleIndex. It is taken from the
+   * cache when that is valid, and otherwise computed from the fixed image value
+   * of the sample, into fixedParzenValuesBuffer. Returns the fixed Parzen values.
+   */
+  const PDFValueType * GetFixedParzenValues(
+    const SizeValueType sampleIndex,
+    const RealType & fixedImageValue,
+    OffsetValueType & fixedParzenWindowIndex,
+    ParzenValueContainerType & fixedParzenValuesBuffer ) const;
+
+  /** Build the cache of fixed Parzen windows, when it is used and not valid
+   * for the current samples. Should be called single-threadedly, after the
+   * image sampler has been updated.
+   */
+  void UpdateFixedParzenValuesCache( void ) const;
+
+  /** Compute m_FixedImageMarginalPDF of the normalized joint pdf, or copy the
+   * precomputed one when UsePrecomputedFixedImageMarginalPDF is true.
+   */
+  void ComputeFixedImageMarginalPDF( void ) const;
+
   /** Update the joint PDF and the incremental pdfs.
    * The input is a pixel pair (fixed, moving, moving mask) and
    * a set of moving image/mask values when using mu+delta*e_k, for
@@ -497,6 +580,8 @@ private:
   bool          m_UseExplicitPDFDerivatives;
   bool          m_UseFiniteDifferenceDerivative;
   double        m_FiniteDifferencePerturbation;
+  bool          m_UseFixedParzenValuesCache;
+  bool          m_UsePrecomputedFixedImageMarginalPDF;
 
 };
 
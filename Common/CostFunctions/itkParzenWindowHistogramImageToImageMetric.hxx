@@ -26,6 +26,8 @@
 #include "itkImageScanlineIterator.h"
 #include "vnl/vnl_math.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -69,6 +71,12 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 
   this->m_UseExplicitPDFDerivatives = true;
 
+  this->m_UseFixedParzenValuesCache             = true;
+  this->m_UsePrecomputedFixedImageMarginalPDF   = false;
+  this->m_FixedParzenValuesCacheIsValid         = false;
+  this->m_FixedParzenValuesCacheSampleContainer = nullptr;
+  this->m_FixedParzenValuesCacheUpdateMTime     = 0;
+
   /** Initialize the m_ParzenWindowHistogramThreaderParameters */
   this->m_ParzenWindowHistogramThreaderParameters.m_Metric = this;
 
@@ -112,6 +120,10 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
      << this->m_FixedKernelBSplineOrder << std::endl;
   os << indent << "MovingKernelBSplineOrder: "
      << this->m_MovingKernelBSplineOrder << std::endl;
+  os << indent << "UseFixedParzenValuesCache: "
+     << this->m_UseFixedParzenValuesCache << std::endl;
+  os << indent << "UsePrecomputedFixedImageMarginalPDF: "
+     << this->m_UsePrecomputedFixedImageMarginalPDF << std::endl;
 
   /*double m_MovingImageNormalizedMin;
   double m_FixedImageNormalizedMin;
@@ -147,6 +159,12 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Set up the Parzen windows. */
   this->InitializeKernels();
 
+  /** The fixed Parzen values are cached again for the new resolution. */
+  this->m_FixedParzenValuesCacheIsValid         = false;
+  this->m_FixedParzenValuesCacheSampleContainer = nullptr;
+  this->m_FixedParzenWindowIndices.clear();
+  this->m_FixedParzenValues.clear();
+
   /** If the user plans to use a finite difference derivative,
    * allocate some memory for the perturbed alpha variables.
    */
@@ -460,15 +478,9 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
    * which has performance benefits for larger vector sizes.
    */
 
-  /** Construct regions for the joint histograms. */
-  JointPDFRegionType jointPDFRegion;
-  JointPDFIndexType  jointPDFIndex;
-  JointPDFSizeType   jointPDFSize;
-  jointPDFIndex.Fill( 0 );
-  jointPDFSize[ 0 ] = this->m_NumberOfMovingHistogramBins;
-  jointPDFSize[ 1 ] = this->m_NumberOfFixedHistogramBins;
-  jointPDFRegion.SetIndex( jointPDFIndex );
-  jointPDFRegion.SetSize( jointPDFSize );
+  /** The size of the joint histograms. */
+  const SizeValueType jointPDFSize = static_cast< SizeValueType >( this->m_NumberOfFixedHistogramBins )
+    * static_cast< SizeValueType >( this->m_NumberOfMovingHistogramBins );
 
   const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
 
@@ -487,14 +499,8 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   {
     this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
 
-    // Initialize the joint pdf
-    JointPDFPointer & jointPDF = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF;
-    if( jointPDF.IsNull() ) { jointPDF = JointPDFType::New(); }
-    if( jointPDF->GetLargestPossibleRegion() != jointPDFRegion )
-    {
-      jointPDF->SetRegions( jointPDFRegion );
-      jointPDF->Allocate();
-    }
+    /** Size the joint pdf; resize() does not reallocate when the size is unchanged. */
+    this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF.resize( jointPDFSize );
   }
 
 } // end InitializeThreadingParameters()
@@ -568,89 +574,257 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   const NonZeroJacobianIndicesType * nzji,
   JointPDFType * jointPDF ) const
 {
-  typedef ImageScanlineIterator< JointPDFType > PDFIteratorType;
+  /** Make sure the values fall within the histogram range, and compute the
+   * fixed Parzen window.
+   */
+  OffsetValueType          fixedImageParzenWindowIndex;
+  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
+  this->ComputeFixedParzenValues( fixedImageValue,
+    fixedImageParzenWindowIndex, fixedParzenValues.data_block() );
+
+  this->UpdateJointPDFAndDerivatives( fixedImageParzenWindowIndex,
+    fixedParzenValues.data_block(), movingImageValue, imageJacobian, nzji, jointPDF );
+
+} // end UpdateJointPDFAndDerivatives()
+
+
+/**
+ * ********************** UpdateJointPDFAndDerivatives ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateJointPDFAndDerivatives(
+  const OffsetValueType fixedImageParzenWindowIndex,
+  const PDFValueType * fixedParzenValues,
+  const RealType & movingImageValue,
+  const DerivativeType * imageJacobian,
+  const NonZeroJacobianIndicesType * nzji,
+  JointPDFType * jointPDF ) const
+{
+  if( !imageJacobian )
+  {
+    this->UpdateJointPDF( fixedImageParzenWindowIndex, fixedParzenValues,
+      movingImageValue, jointPDF->GetBufferPointer() );
+    return;
+  }
 
   /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
-  const double fixedImageParzenWindowTerm
-    = fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
   const double movingImageParzenWindowTerm
     = movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
 
   /** The lowest bin numbers affected by this pixel: */
-  const OffsetValueType fixedImageParzenWindowIndex
-    = static_cast< OffsetValueType >( std::floor(
-    fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
   const OffsetValueType movingImageParzenWindowIndex
     = static_cast< OffsetValueType >( std::floor(
     movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
 
-  /** The Parzen values. */
-  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
-  ParzenValueContainerType movingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
-  this->EvaluateParzenValues(
-    fixedImageParzenWindowTerm, fixedImageParzenWindowIndex,
-    this->m_FixedKernel, fixedParzenValues );
-  this->EvaluateParzenValues(
-    movingImageParzenWindowTerm, movingImageParzenWindowIndex,
-    this->m_MovingKernel, movingParzenValues );
+  /** The moving Parzen values and their derivatives. */
+  const unsigned int fixedParzenWindowSize  = this->m_JointPDFWindow.GetSize()[ 1 ];
+  const unsigned int movingParzenWindowSize = this->m_JointPDFWindow.GetSize()[ 0 ];
+  const double       movingKernelArgument
+    = static_cast< double >( movingImageParzenWindowIndex ) - movingImageParzenWindowTerm;
+  PDFValueType movingParzenValues[ ParzenWindowHistogramKernels::MaximumWindowSize ];
+  PDFValueType derivativeMovingParzenValues[ ParzenWindowHistogramKernels::MaximumWindowSize ];
+  this->m_MovingKernel->Evaluate( movingKernelArgument, movingParzenValues );
+  this->m_DerivativeMovingKernel->Evaluate( movingKernelArgument, derivativeMovingParzenValues );
 
-  /** Position the JointPDFWindow. */
-  JointPDFIndexType pdfWindowIndex;
-  pdfWindowIndex[ 0 ] = movingImageParzenWindowIndex;
-  pdfWindowIndex[ 1 ] = fixedImageParzenWindowIndex;
+  const double et = static_cast< double >( this->m_MovingImageBinSize );
 
-  /** For thread-safety, make a local copy of the support region,
-   * and use that one. Because each thread will modify it.
+  /** Loop over the Parzen window region and increment the values
+   * Also update the pdf derivatives.
    */
-  JointPDFRegionType jointPDFWindow = this->m_JointPDFWindow;
-  jointPDFWindow.SetIndex( pdfWindowIndex );
-  PDFIteratorType it( jointPDF, jointPDFWindow );
-
-  if( !imageJacobian )
+  const OffsetValueType numberOfMovingBins = this->m_NumberOfMovingHistogramBins;
+  PDFValueType *        row                = jointPDF->GetBufferPointer()
+    + fixedImageParzenWindowIndex * numberOfMovingBins + movingImageParzenWindowIndex;
+  JointPDFIndexType pdfIndex;
+  for( unsigned int f = 0; f < fixedParzenWindowSize; ++f, row += numberOfMovingBins )
   {
-    /** Loop over the Parzen window region and increment the values. */
-    for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
+    const double fv    = fixedParzenValues[ f ];
+    const double fv_et = fv / et;
+    pdfIndex[ 1 ] = fixedImageParzenWindowIndex + f;
+    for( unsigned int m = 0; m < movingParzenWindowSize; ++m )
     {
-      const double fv = fixedParzenValues[ f ];
-      for( unsigned int m = 0; m < movingParzenValues.GetSize(); ++m )
-      {
-        it.Value() += static_cast< PDFValueType >( fv * movingParzenValues[ m ] );
-        ++it;
-      }
-      it.NextLine();
+      row[ m ]     += static_cast< PDFValueType >( fv * movingParzenValues[ m ] );
+      pdfIndex[ 0 ] = movingImageParzenWindowIndex + m;
+      this->UpdateJointPDFDerivatives(
+        pdfIndex, fv_et * derivativeMovingParzenValues[ m ],
+        *imageJacobian, *nzji );
     }
   }
-  else
+
+} // end UpdateJointPDFAndDerivatives()
+
+
+/**
+ * ********************** UpdateJointPDF ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateJointPDF(
+  const OffsetValueType fixedImageParzenWindowIndex,
+  const PDFValueType * fixedParzenValues,
+  const RealType & movingImageValue,
+  PDFValueType * jointPDF ) const
+{
+  /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
+  const double movingImageParzenWindowTerm
+    = movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
+
+  /** The lowest bin numbers affected by this pixel: */
+  const OffsetValueType movingImageParzenWindowIndex
+    = static_cast< OffsetValueType >( std::floor(
+    movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
+
+  /** The moving Parzen values, on the stack. */
+  PDFValueType movingParzenValues[ ParzenWindowHistogramKernels::MaximumWindowSize ];
+  this->m_MovingKernel->Evaluate(
+    static_cast< double >( movingImageParzenWindowIndex ) - movingImageParzenWindowTerm,
+    movingParzenValues );
+
+  /** Add the outer product of the fixed and moving Parzen values. */
+  ParzenWindowHistogramKernels::UpdateJointPDF( jointPDF,
+    this->m_NumberOfMovingHistogramBins,
+    fixedImageParzenWindowIndex, fixedParzenValues, this->m_JointPDFWindow.GetSize()[ 1 ],
+    movingImageParzenWindowIndex, movingParzenValues, this->m_JointPDFWindow.GetSize()[ 0 ] );
+
+} // end UpdateJointPDF()
+
+
+/**
+ * ********************** ComputeFixedParzenValues ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeFixedParzenValues(
+  const RealType & fixedImageValue,
+  OffsetValueType & fixedParzenWindowIndex,
+  PDFValueType * fixedParzenValues ) const
+{
+  /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
+  const double fixedImageParzenWindowTerm
+    = fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
+
+  /** The lowest bin number affected by this pixel. */
+  fixedParzenWindowIndex = static_cast< OffsetValueType >( std::floor(
+    fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
+
+  /** The Parzen values. */
+  this->m_FixedKernel->Evaluate(
+    static_cast< double >( fixedParzenWindowIndex ) - fixedImageParzenWindowTerm,
+    fixedParzenValues );
+
+} // end ComputeFixedParzenValues()
+
+
+/**
+ * ********************** GetFixedParzenValues ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+const typename ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >::PDFValueType *
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::GetFixedParzenValues(
+  const SizeValueType sampleIndex,
+  const RealType & fixedImageValue,
+  OffsetValueType & fixedParzenWindowIndex,
+  ParzenValueContainerType & fixedParzenValuesBuffer ) const
+{
+  if( this->m_FixedParzenValuesCacheIsValid )
   {
-    /** Compute the derivatives of the moving Parzen window. */
-    ParzenValueContainerType derivativeMovingParzenValues(
-    this->m_JointPDFWindow.GetSize()[ 0 ] );
-    this->EvaluateParzenValues(
-      movingImageParzenWindowTerm, movingImageParzenWindowIndex,
-      this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
+    fixedParzenWindowIndex = this->m_FixedParzenWindowIndices[ sampleIndex ];
+    return &this->m_FixedParzenValues[ sampleIndex * this->m_JointPDFWindow.GetSize()[ 1 ] ];
+  }
 
-    const double et = static_cast< double >( this->m_MovingImageBinSize );
+  /** Make sure the value falls within the histogram range. */
+  const RealType limitedFixedImageValue = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
+  this->ComputeFixedParzenValues( limitedFixedImageValue,
+    fixedParzenWindowIndex, fixedParzenValuesBuffer.data_block() );
+  return fixedParzenValuesBuffer.data_block();
 
-    /** Loop over the Parzen window region and increment the values
-     * Also update the pdf derivatives.
-     */
-    for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
+} // end GetFixedParzenValues()
+
+
+/**
+ * ********************** UpdateFixedParzenValuesCache ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateFixedParzenValuesCache( void ) const
+{
+  /** Only cache for samplers that keep their samples, such as the full and
+   * grid samplers. Other samplers may select new samples every iteration.
+   */
+  ImageSamplerType * sampler = this->GetImageSampler();
+  if( !this->m_UseFixedParzenValuesCache || sampler == nullptr
+    || sampler->SelectingNewSamplesOnUpdateSupported() )
+  {
+    this->m_FixedParzenValuesCacheIsValid = false;
+    return;
+  }
+
+  /** Check if the cache belongs to the current samples. The update time of
+   * the sample container changes each time the sampler generates samples.
+   */
+  ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
+  if( this->m_FixedParzenValuesCacheIsValid
+    && this->m_FixedParzenValuesCacheSampleContainer == sampleContainer.GetPointer()
+    && this->m_FixedParzenValuesCacheUpdateMTime == sampleContainer->GetUpdateMTime() )
+  {
+    return;
+  }
+
+  /** Compute the fixed Parzen window of each sample. */
+  const SizeValueType numberOfSamples       = sampleContainer->Size();
+  const unsigned int  fixedParzenWindowSize = this->m_JointPDFWindow.GetSize()[ 1 ];
+  this->m_FixedParzenWindowIndices.resize( numberOfSamples );
+  this->m_FixedParzenValues.resize( numberOfSamples * fixedParzenWindowSize );
+
+  OffsetValueType fixedParzenWindowIndex = 0;
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  for( fiter = fbegin; fiter != fend; ++fiter )
+  {
+    const SizeValueType sampleIndex     = fiter.Index();
+    const RealType      fixedImageValue = this->GetFixedImageLimiter()->Evaluate(
+      static_cast< RealType >( ( *fiter ).Value().m_ImageValue ) );
+    this->ComputeFixedParzenValues( fixedImageValue, fixedParzenWindowIndex,
+      &this->m_FixedParzenValues[ sampleIndex * fixedParzenWindowSize ] );
+    this->m_FixedParzenWindowIndices[ sampleIndex ] = static_cast< int >( fixedParzenWindowIndex );
+  }
+
+  /** Compute the fixed marginal pdf of all samples. */
+  if( this->m_UsePrecomputedFixedImageMarginalPDF )
+  {
+    this->m_PrecomputedFixedImageMarginalPDF.SetSize( this->m_NumberOfFixedHistogramBins );
+    this->m_PrecomputedFixedImageMarginalPDF.Fill( NumericTraits< PDFValueType >::ZeroValue() );
+    for( SizeValueType i = 0; i < numberOfSamples; ++i )
     {
-      const double fv    = fixedParzenValues[ f ];
-      const double fv_et = fv / et;
-      for( unsigned int m = 0; m < movingParzenValues.GetSize(); ++m )
+      const PDFValueType * fixedParzenValues = &this->m_FixedParzenValues[ i * fixedParzenWindowSize ];
+      for( unsigned int f = 0; f < fixedParzenWindowSize; ++f )
       {
-        it.Value() += static_cast< PDFValueType >( fv * movingParzenValues[ m ] );
-        this->UpdateJointPDFDerivatives(
-          it.GetIndex(), fv_et * derivativeMovingParzenValues[ m ],
-          *imageJacobian, *nzji );
-        ++it;
+        this->m_PrecomputedFixedImageMarginalPDF[ this->m_FixedParzenWindowIndices[ i ] + f ]
+          += fixedParzenValues[ f ];
       }
-      it.NextLine();
+    }
+    if( numberOfSamples > 0 )
+    {
+      this->m_PrecomputedFixedImageMarginalPDF /= static_cast< PDFValueType >( numberOfSamples );
     }
   }
 
-} // end UpdateJointPDFAndDerivatives()
+  this->m_FixedParzenValuesCacheIsValid         = true;
+  this->m_FixedParzenValuesCacheSampleContainer = sampleContainer.GetPointer();
+  this->m_FixedParzenValuesCacheUpdateMTime     = sampleContainer->GetUpdateMTime();
+
+} // end UpdateFixedParzenValuesCache()
 
 
 /**
@@ -778,6 +952,27 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 } // end ComputeMarginalPDFs()
 
 
+/**
+ * ************************ ComputeFixedImageMarginalPDF ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeFixedImageMarginalPDF( void ) const
+{
+  if( this->m_UsePrecomputedFixedImageMarginalPDF && this->m_FixedParzenValuesCacheIsValid )
+  {
+    this->m_FixedImageMarginalPDF = this->m_PrecomputedFixedImageMarginalPDF;
+  }
+  else
+  {
+    this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
+  }
+
+} // end ComputeFixedImageMarginalPDF()
+
+
 /**
  * ******************** ComputeIncrementalMarginalPDFs *******************
  */
@@ -1047,6 +1242,9 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
+  /** Cache the fixed Parzen values, if needed. */
+  this->UpdateFixedParzenValuesCache();
+
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
@@ -1055,6 +1253,9 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
   typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
 
+  /** Storage for the fixed Parzen values, when they are not cached. */
+  ParzenValueContainerType fixedParzenValuesBuffer( this->m_JointPDFWindow.GetSize()[ 1 ] );
+
   /** Loop over sample container and compute contribution of each sample to pdfs. */
   for( fiter = fbegin; fiter != fend; ++fiter )
   {
@@ -1085,16 +1286,18 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     {
       this->m_NumberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Get the fixed Parzen window of this sample. */
+      OffsetValueType      fixedParzenWindowIndex;
+      const PDFValueType * fixedParzenValues = this->GetFixedParzenValues( fiter.Index(),
+        static_cast< RealType >( ( *fiter ).Value().m_ImageValue ),
+        fixedParzenWindowIndex, fixedParzenValuesBuffer );
 
       /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
       movingImageValue = this->GetMovingImageLimiter()->Evaluate( movingImageValue );
 
       /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateJointPDFAndDerivatives(
-        fixedImageValue, movingImageValue, 0, 0, this->m_JointPDF.GetPointer() );
+      this->UpdateJointPDF( fixedParzenWindowIndex, fixedParzenValues,
+        movingImageValue, this->m_JointPDF->GetBufferPointer() );
     }
 
   } // end iterating over fixed image spatial sample container for loop
@@ -1138,6 +1341,9 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
+  /** Cache the fixed Parzen values, if needed. */
+  this->UpdateFixedParzenValuesCache();
+
   /** Launch multi-threading JointPDF computation. */
   this->LaunchComputePDFsThreaderCallback();
 
@@ -1160,8 +1366,8 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
    * The initialization is performed here, so that it is done multi-threadedly
    * instead of sequentially in InitializeThreadingParameters().
    */
-  JointPDFPointer & jointPDF = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_JointPDF;
-  jointPDF->FillBuffer( NumericTraits< PDFValueType >::ZeroValue() );
+  AlignedJointPDFArrayType & jointPDF = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_JointPDF;
+  std::fill( jointPDF.begin(), jointPDF.end(), NumericTraits< PDFValueType >::ZeroValue() );
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
@@ -1187,6 +1393,9 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
 
+  /** Storage for the fixed Parzen values, when they are not cached. */
+  ParzenValueContainerType fixedParzenValuesBuffer( this->m_JointPDFWindow.GetSize()[ 1 ] );
+
   /** Loop over sample container and compute contribution of each sample to pdfs. */
   for( fiter = fbegin; fiter != fend; ++fiter )
   {
@@ -1217,17 +1426,18 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     {
       numberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Get the fixed Parzen window of this sample. */
+      OffsetValueType      fixedParzenWindowIndex;
+      const PDFValueType * fixedParzenValues = this->GetFixedParzenValues( fiter.Index(),
+        static_cast< RealType >( ( *fiter ).Value().m_ImageValue ),
+        fixedParzenWindowIndex, fixedParzenValuesBuffer );
 
       /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
       movingImageValue = this->GetMovingImageLimiter()->Evaluate( movingImageValue );
 
       /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateJointPDFAndDerivatives(
-        fixedImageValue, movingImageValue, 0, 0,
-        jointPDF.GetPointer() );
+      this->UpdateJointPDF( fixedParzenWindowIndex, fixedParzenValues,
+        movingImageValue, jointPDF.data() );
     }
   } // end iterating over fixed image spatial sample container for loop
 
@@ -1268,38 +1478,15 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Compute alpha. */
   this->m_Alpha = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
 
-  /** Accumulate joint histogram. */
-  // could be multi-threaded too, by each thread updating only a part of the JointPDF.
-  typedef ImageScanlineIterator< JointPDFType > JointPDFIteratorType;
-  JointPDFIteratorType                it( this->m_JointPDF, this->m_JointPDF->GetBufferedRegion() );
-  std::vector< JointPDFIteratorType > itT( numberOfThreads );
+  /** Accumulate joint histogram, with a contiguous loop over the plain arrays. */
+  std::vector< const PDFValueType * > threadJointPDFs( numberOfThreads );
   for( ThreadIdType i = 0; i < numberOfThreads; ++i )
   {
-    itT[ i ] = JointPDFIteratorType(
-      this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF,
-      this->m_JointPDF->GetBufferedRegion() );
-  }
-
-  PDFValueType sum;
-  while( !it.IsAtEnd() )
-  {
-    while( !it.IsAtEndOfLine() )
-    {
-      sum = NumericTraits< PDFValueType >::Zero;
-      for( ThreadIdType i = 0; i < numberOfThreads; ++i )
-      {
-        sum += itT[ i ].Value();
-        ++itT[ i ];
-      }
-      it.Set( sum );
-      ++it;
-    }
-    it.NextLine();
-    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
-    {
-      itT[ i ].NextLine();
-    }
+    threadJointPDFs[ i ] = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF.data();
   }
+  ParzenWindowHistogramKernels::SumArrays( this->m_JointPDF->GetBufferPointer(),
+    threadJointPDFs.data(), numberOfThreads,
+    this->m_JointPDF->GetBufferedRegion().GetNumberOfPixels() );
 
 } // end AfterThreadedComputePDFs()
 
@@ -1381,6 +1568,9 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
+  /** Cache the fixed Parzen values, if needed. */
+  this->UpdateFixedParzenValuesCache();
+
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
@@ -1389,6 +1579,9 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
   typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
 
+  /** Storage for the fixed Parzen values, when they are not cached. */
+  ParzenValueContainerType fixedParzenValuesBuffer( this->m_JointPDFWindow.GetSize()[ 1 ] );
+
   /** Loop over sample container and compute contribution of each sample to pdfs. */
   for( fiter = fbegin; fiter != fend; ++fiter )
   {
@@ -1420,11 +1613,13 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     {
       this->m_NumberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Get the fixed Parzen window of this sample. */
+      OffsetValueType      fixedParzenWindowIndex;
+      const PDFValueType * fixedParzenValues = this->GetFixedParzenValues( fiter.Index(),
+        static_cast< RealType >( ( *fiter ).Value().m_ImageValue ),
+        fixedParzenWindowIndex, fixedParzenValuesBuffer );
 
       /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
       movingImageValue = this->GetMovingImageLimiter()->Evaluate(
         movingImageValue, movingImageDerivative );
 
@@ -1436,8 +1631,8 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
         jacobian, movingImageDerivative, imageJacobian );
 
       /** Update the joint pdf and the joint pdf derivatives. */
-      this->UpdateJointPDFAndDerivatives(
-        fixedImageValue, movingImageValue, &imageJacobian, &nzji, this->m_JointPDF.GetPointer() );
+      this->UpdateJointPDFAndDerivatives( fixedParzenWindowIndex, fixedParzenValues,
+        movingImageValue, &imageJacobian, &nzji, this->m_JointPDF.GetPointer() );
 
     } //end if-block check sampleOk
   } // end iterating over fixed image spatial sample container for loop
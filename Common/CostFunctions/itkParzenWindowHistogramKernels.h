@@ -0,0 +1,262 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkParzenWindowHistogramKernels_h
+#define __itkParzenWindowHistogramKernels_h
+
+#include "itkIntTypes.h"
+#include "itkMacro.h"
+
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace itk
+{
+
+/** \class ParzenWindowHistogramAlignedAllocator
+ * \brief A minimal allocator that aligns its arrays to ITK_CACHE_LINE_ALIGNMENT.
+ *
+ * The joint histograms are allocated with it, so that the arrays that the
+ * kernels below run over start at a cache line boundary, and arrays of
+ * different threads never share a cache line.
+ */
+
+template< class T >
+class ParzenWindowHistogramAlignedAllocator
+{
+public:
+
+  typedef T value_type;
+
+  ParzenWindowHistogramAlignedAllocator() {}
+  template< class U >
+  ParzenWindowHistogramAlignedAllocator( const ParzenWindowHistogramAlignedAllocator< U > & ) {}
+
+  /** Allocate room for the alignment and for the pointer to the original
+   * allocation, which is stored just in front of the aligned array.
+   */
+  T * allocate( const std::size_t n )
+  {
+    const std::size_t alignment = ITK_CACHE_LINE_ALIGNMENT;
+    void * const      original  = ::operator new( n * sizeof( T ) + alignment + sizeof( void * ) );
+    const std::uintptr_t begin  = reinterpret_cast< std::uintptr_t >( original ) + sizeof( void * );
+    void ** const     aligned   = reinterpret_cast< void ** >( ( begin + alignment - 1 ) & ~( alignment - 1 ) );
+    aligned[ -1 ] = original;
+    return reinterpret_cast< T * >( aligned );
+  }
+
+
+  void deallocate( T * p, const std::size_t )
+  {
+    ::operator delete( reinterpret_cast< void ** >( p )[ -1 ] );
+  }
+
+
+};
+
+template< class T, class U >
+bool operator==( const ParzenWindowHistogramAlignedAllocator< T > &, const ParzenWindowHistogramAlignedAllocator< U > & )
+{
+  return true;
+}
+
+template< class T, class U >
+bool operator!=( const ParzenWindowHistogramAlignedAllocator< T > &, const ParzenWindowHistogramAlignedAllocator< U > & )
+{
+  return false;
+}
+
+/** \class ParzenWindowHistogramKernels
+ * \brief The inner loops of the Parzen window joint histogram metrics.
+ *
+ * A joint histogram is stored as a plain array of numberOfFixedBins x
+ * numberOfMovingBins values, in which the moving bin runs fastest. This is the
+ * layout of the buffer of the JointPDFType image, and of the PRatio array of
+ * the mutual information metric. A sample affects a window of
+ * fixedWindowSize x movingWindowSize bins, with at most MaximumWindowSize
+ * bins in each direction (cubic B-spline kernels).
+ *
+ * The loops over the moving bins are instantiated for each window size, so
+ * that they have a fixed trip count, which the compiler unrolls and
+ * vectorizes. The loops over whole histograms and over the parameters are
+ * written on restricted raw pointers for the same reason.
+ */
+
+class ParzenWindowHistogramKernels
+{
+public:
+
+  /** Typedefs. */
+  typedef double          ValueType;
+  typedef OffsetValueType OffsetType;
+
+  /** A joint histogram, aligned to a cache line. */
+  typedef std::vector< ValueType, ParzenWindowHistogramAlignedAllocator< ValueType > > AlignedArrayType;
+
+  /** The largest Parzen window, of a cubic B-spline kernel. */
+  itkStaticConstMacro( MaximumWindowSize, unsigned int, 4 );
+
+  /** jointPDF( fixedIndex + f, movingIndex + m ) += fixedValues[ f ] * movingValues[ m ]. */
+  static void UpdateJointPDF( ValueType * jointPDF,
+    const SizeValueType numberOfMovingBins,
+    const OffsetType fixedIndex, const ValueType * fixedValues,
+    const unsigned int fixedWindowSize,
+    const OffsetType movingIndex, const ValueType * movingValues,
+    const unsigned int movingWindowSize )
+  {
+    ValueType * row = jointPDF + fixedIndex * static_cast< OffsetType >( numberOfMovingBins ) + movingIndex;
+    switch( movingWindowSize )
+    {
+      case 4:
+        UpdateJointPDFFixedSize< 4 >( row, numberOfMovingBins, fixedValues, fixedWindowSize, movingValues );
+        break;
+      case 3:
+        UpdateJointPDFFixedSize< 3 >( row, numberOfMovingBins, fixedValues, fixedWindowSize, movingValues );
+        break;
+      case 2:
+        UpdateJointPDFFixedSize< 2 >( row, numberOfMovingBins, fixedValues, fixedWindowSize, movingValues );
+        break;
+      default:
+        UpdateJointPDFFixedSize< 1 >( row, numberOfMovingBins, fixedValues, fixedWindowSize, movingValues );
+        break;
+    }
+  }
+
+
+  /** Compute sum_f fixedValues[ f ] sum_m pRatio( fixedIndex + f, movingIndex + m )
+   * derivativeMovingValues[ m ].
+   */
+  static ValueType ComputePRatioWeightedSum( const ValueType * pRatio,
+    const SizeValueType numberOfMovingBins,
+    const OffsetType fixedIndex, const ValueType * fixedValues,
+    const unsigned int fixedWindowSize,
+    const OffsetType movingIndex, const ValueType * derivativeMovingValues,
+    const unsigned int movingWindowSize )
+  {
+    const ValueType * row = pRatio + fixedIndex * static_cast< OffsetType >( numberOfMovingBins ) + movingIndex;
+    switch( movingWindowSize )
+    {
+      case 4:
+        return ComputePRatioWeightedSumFixedSize< 4 >( row, numberOfMovingBins, fixedValues, fixedWindowSize, derivativeMovingValues );
+      case 3:
+        return ComputePRatioWeightedSumFixedSize< 3 >( row, numberOfMovingBins, fixedValues, fixedWindowSize, derivativeMovingValues );
+      case 2:
+        return ComputePRatioWeightedSumFixedSize< 2 >( row, numberOfMovingBins, fixedValues, fixedWindowSize, derivativeMovingValues );
+      default:
+        return ComputePRatioWeightedSumFixedSize< 1 >( row, numberOfMovingBins, fixedValues, fixedWindowSize, derivativeMovingValues );
+    }
+  }
+
+
+  /** derivative[ i ] += factor * imageJacobian[ i ], for i = 0 ... size - 1. */
+  template< class TDerivativeValue, class TJacobianValue >
+  static void AddScaledJacobian( TDerivativeValue * __restrict derivative,
+    const TJacobianValue * __restrict imageJacobian,
+    const SizeValueType size, const ValueType factor )
+  {
+    for( SizeValueType i = 0; i < size; ++i )
+    {
+      derivative[ i ] += static_cast< TDerivativeValue >( factor * imageJacobian[ i ] );
+    }
+  }
+
+
+  /** sum[ i ] = sum_t arrays[ t ][ i ], for i = 0 ... size - 1. */
+  static void SumArrays( ValueType * __restrict sum,
+    const ValueType * const * arrays, const unsigned int numberOfArrays,
+    const SizeValueType size )
+  {
+    const ValueType * __restrict first = arrays[ 0 ];
+    for( SizeValueType i = 0; i < size; ++i )
+    {
+      sum[ i ] = first[ i ];
+    }
+    for( unsigned int t = 1; t < numberOfArrays; ++t )
+    {
+      const ValueType * __restrict array = arrays[ t ];
+      for( SizeValueType i = 0; i < size; ++i )
+      {
+        sum[ i ] += array[ i ];
+      }
+    }
+  }
+
+
+private:
+
+  template< unsigned int VMovingWindowSize >
+  static void UpdateJointPDFFixedSize( ValueType * row,
+    const SizeValueType numberOfMovingBins,
+    const ValueType * fixedValues, const unsigned int fixedWindowSize,
+    const ValueType * movingValues )
+  {
+    /** Copy the moving values, so that they stay in registers. */
+    ValueType mv[ VMovingWindowSize ];
+    for( unsigned int m = 0; m < VMovingWindowSize; ++m )
+    {
+      mv[ m ] = movingValues[ m ];
+    }
+
+    for( unsigned int f = 0; f < fixedWindowSize; ++f, row += numberOfMovingBins )
+    {
+      const ValueType fv = fixedValues[ f ];
+      for( unsigned int m = 0; m < VMovingWindowSize; ++m )
+      {
+        row[ m ] += fv * mv[ m ];
+      }
+    }
+  }
+
+
+  template< unsigned int VMovingWindowSize >
+  static ValueType ComputePRatioWeightedSumFixedSize( const ValueType * row,
+    const SizeValueType numberOfMovingBins,
+    const ValueType * fixedValues, const unsigned int fixedWindowSize,
+    const ValueType * derivativeMovingValues )
+  {
+    ValueType dmv[ VMovingWindowSize ];
+    for( unsigned int m = 0; m < VMovingWindowSize; ++m )
+    {
+      dmv[ m ] = derivativeMovingValues[ m ];
+    }
+
+    /** Accumulate per moving bin, and reduce once at the end. */
+    ValueType partialSums[ VMovingWindowSize ] = {};
+    for( unsigned int f = 0; f < fixedWindowSize; ++f, row += numberOfMovingBins )
+    {
+      const ValueType fv = fixedValues[ f ];
+      for( unsigned int m = 0; m < VMovingWindowSize; ++m )
+      {
+        partialSums[ m ] += fv * row[ m ] * dmv[ m ];
+      }
+    }
+
+    ValueType sum = 0.0;
+    for( unsigned int m = 0; m < VMovingWindowSize; ++m )
+    {
+      sum += partialSums[ m ];
+    }
+    return sum;
+  }
+
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkParzenWindowHistogramKernels_h
@@ -0,0 +1,247 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRayCastFiniteDifferenceImageToImageMetric_h
+#define __itkRayCastFiniteDifferenceImageToImageMetric_h
+
+#include "itkAdvancedImageToImageMetric.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkOptimizer.h"
+#include "itkResampleImageFilter.h"
+
+#include <exception>
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class RayCastFiniteDifferenceImageToImageMetric
+ * \brief A base class for 2D-3D metrics that compare the fixed image with a
+ * DRR of the moving image, and compute their derivative by central differences.
+ *
+ * This class generates the DRR with a resampler that uses the
+ * AdvancedRayCastInterpolateImageFunction set as the interpolator of the
+ * metric. The DRR is only regenerated when the parameters or the settings of
+ * the ray caster changed, see UpdateMovedImage().
+ *
+ * The derivative is computed by central differences, with a step of
+ * DerivativeDelta / sqrt( Scales[ i ] ) for parameter i. When multi-threading
+ * is switched on, the 2N perturbations are evaluated concurrently: every
+ * thread owns a perturbation pipeline, consisting of a clone of the ray-cast
+ * transform, a ray caster and a resampler, which is built once per resolution
+ * by InitializePerturbationPipelines(). Inheriting classes attach their own
+ * filters to the DRR of each pipeline, by overriding that function, and
+ * compute the metric value from it in ComputePerturbedValue().
+ *
+ * Inheriting classes should call Initialize() of this class before they use
+ * the DRR, and InitializePerturbationPipelines() once their own state is set
+ * up. They define GetValue().
+ *
+ * \ingroup Metrics
+ */
+
+template< class TFixedImage, class TMovingImage >
+class RayCastFiniteDifferenceImageToImageMetric :
+  public AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef RayCastFiniteDifferenceImageToImageMetric               Self;
+  typedef AdvancedImageToImageMetric< TFixedImage, TMovingImage > Superclass;
+  typedef SmartPointer< Self >                                    Pointer;
+  typedef SmartPointer< const Self >                              ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( RayCastFiniteDifferenceImageToImageMetric, AdvancedImageToImageMetric );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::CoordinateRepresentationType    CoordinateRepresentationType;
+  typedef typename Superclass::MovingImageType                 MovingImageType;
+  typedef typename Superclass::MovingImagePixelType            MovingImagePixelType;
+  typedef typename Superclass::MovingImagePointer              MovingImagePointer;
+  typedef typename Superclass::MovingImageConstPointer         MovingImageConstPointer;
+  typedef typename Superclass::FixedImageType                  FixedImageType;
+  typedef typename Superclass::FixedImageConstPointer          FixedImageConstPointer;
+  typedef typename Superclass::FixedImageRegionType            FixedImageRegionType;
+  typedef typename Superclass::TransformType                   TransformType;
+  typedef typename TransformType::ScalarType                   ScalarType;
+  typedef typename Superclass::TransformPointer                TransformPointer;
+  typedef typename Superclass::InputPointType                  InputPointType;
+  typedef typename Superclass::OutputPointType                 OutputPointType;
+  typedef typename Superclass::TransformParametersType         TransformParametersType;
+  typedef typename Superclass::TransformJacobianType           TransformJacobianType;
+  typedef typename Superclass::InterpolatorType                InterpolatorType;
+  typedef typename Superclass::InterpolatorPointer             InterpolatorPointer;
+  typedef typename Superclass::RealType                        RealType;
+  typedef typename Superclass::GradientPixelType               GradientPixelType;
+  typedef typename Superclass::GradientImageType               GradientImageType;
+  typedef typename Superclass::GradientImagePointer            GradientImagePointer;
+  typedef typename Superclass::GradientImageFilterType         GradientImageFilterType;
+  typedef typename Superclass::GradientImageFilterPointer      GradientImageFilterPointer;
+  typedef typename Superclass::FixedImageMaskType              FixedImageMaskType;
+  typedef typename Superclass::FixedImageMaskPointer           FixedImageMaskPointer;
+  typedef typename Superclass::MovingImageMaskType             MovingImageMaskType;
+  typedef typename Superclass::MovingImageMaskPointer          MovingImageMaskPointer;
+  typedef typename Superclass::MeasureType                     MeasureType;
+  typedef typename Superclass::DerivativeType                  DerivativeType;
+  typedef typename Superclass::ParametersType                  ParametersType;
+  typedef typename Superclass::FixedImagePixelType             FixedImagePixelType;
+  typedef typename Superclass::MovingImageRegionType           MovingImageRegionType;
+  typedef typename Superclass::ImageSamplerType                ImageSamplerType;
+  typedef typename Superclass::ImageSamplerPointer             ImageSamplerPointer;
+  typedef typename Superclass::ImageSampleContainerType        ImageSampleContainerType;
+  typedef typename Superclass::ImageSampleContainerPointer     ImageSampleContainerPointer;
+  typedef typename Superclass::FixedImageLimiterType           FixedImageLimiterType;
+  typedef typename Superclass::MovingImageLimiterType          MovingImageLimiterType;
+  typedef typename Superclass::FixedImageLimiterOutputType     FixedImageLimiterOutputType;
+  typedef typename Superclass::MovingImageLimiterOutputType    MovingImageLimiterOutputType;
+  typedef typename Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro( FixedImageDimension, unsigned int,
+    FixedImageType::ImageDimension );
+
+  /** The moving image dimension. */
+  itkStaticConstMacro( MovingImageDimension, unsigned int,
+    MovingImageType::ImageDimension );
+
+  /** Types for generating the DRR. */
+  typedef itk::Image< FixedImagePixelType,
+    itkGetStaticConstMacro( FixedImageDimension ) >        TransformedMovingImageType;
+  typedef itk::ResampleImageFilter<
+    MovingImageType, TransformedMovingImageType >          TransformMovingImageFilterType;
+  typedef typename TransformMovingImageFilterType::Pointer TransformMovingImageFilterPointer;
+  typedef typename itk::AdvancedCombinationTransform<
+    ScalarType, FixedImageDimension >                      CombinationTransformType;
+  typedef typename CombinationTransformType::Pointer       CombinationTransformPointer;
+  typedef typename itk::AdvancedRayCastInterpolateImageFunction<
+    MovingImageType, ScalarType >                          RayCastInterpolatorType;
+  typedef typename RayCastInterpolatorType::Pointer        RayCastInterpolatorPointer;
+  typedef typename RayCastInterpolatorType::TransformType  RayCastTransformType;
+  typedef typename RayCastTransformType::Pointer           RayCastTransformPointer;
+  typedef typename itk::Optimizer                          OptimizerType;
+  typedef typename OptimizerType::ScalesType               ScalesType;
+
+  /** Get the derivatives of the match measure, by central differences. */
+  void GetDerivative( const TransformParametersType & parameters,
+    DerivativeType & derivative ) const override;
+
+  /** Get the value and derivatives of the match measure. */
+  void GetValueAndDerivative( const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const override;
+
+  /** Initialize the metric: check that the interpolator is a ray caster,
+   * and set up the resampler that generates the DRR.
+   */
+  void Initialize( void ) override;
+
+  /** Set/Get the scales of the parameters, which scale the finite difference steps. */
+  itkSetMacro( Scales, ScalesType );
+  itkGetConstReferenceMacro( Scales, ScalesType );
+
+  /** Set/Get the finite difference step. */
+  itkSetMacro( DerivativeDelta, double );
+  itkGetConstReferenceMacro( DerivativeDelta, double );
+
+protected:
+
+  RayCastFiniteDifferenceImageToImageMetric();
+  ~RayCastFiniteDifferenceImageToImageMetric() override {}
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** The part of the pipeline of one thread that generates the DRR: a clone
+   * of the ray-cast transform, st_Transform pointing to the part of the clone
+   * that carries the parameters of this metric, a ray caster and a resampler.
+   */
+  struct PerturbationPipelineType
+  {
+    RayCastTransformPointer           st_RayCastTransform;
+    TransformPointer                  st_Transform;
+    RayCastInterpolatorPointer        st_RayCaster;
+    TransformMovingImageFilterPointer st_TransformMovingImageFilter;
+  };
+
+  /** Set the transform parameters and generate the DRR. The ray casting is
+   * skipped when neither the parameters nor the settings of the ray caster
+   * (focal point, threshold, traversal) changed since the previous DRR.
+   * The parameters must be exactly equal, so the cache only helps when the
+   * same parameters are evaluated repeatedly, e.g. GetValue() followed by
+   * GetDerivative() in one iteration, or the base value of the central
+   * differences; successive iterations of an optimizer always cast rays. */
+  void UpdateMovedImage( const TransformParametersType & parameters ) const;
+
+  /** Build one perturbation pipeline per thread, if multi-threading is on
+   * and the metric parameters can be related to the ray-cast transform.
+   * Inheriting classes call this function at the end of Initialize(), and
+   * override it to connect their filters to the output of each pipeline.
+   */
+  virtual void InitializePerturbationPipelines( void );
+
+  /** Compute the metric value from the DRR of the pipeline of a thread. The
+   * DRR is set up for the perturbed parameters, but not yet updated.
+   */
+  virtual MeasureType ComputePerturbedValue( const ThreadIdType threadId ) const = 0;
+
+  /** Compute the derivative by finite differences, single-threaded. */
+  void GetDerivativeSingleThreaded( const TransformParametersType & parameters,
+    DerivativeType & derivative ) const;
+
+  /** Evaluate the perturbations assigned to a thread. */
+  void ThreadedGetValueAndDerivative( ThreadIdType threadId ) override;
+
+  /** Gather the perturbed values into the derivative. */
+  void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const override;
+
+  /** The filter that generates the DRR, and the ray caster it uses. */
+  TransformMovingImageFilterPointer m_TransformMovingImageFilter;
+  RayCastInterpolatorPointer        m_RayCastInterpolator;
+
+  ScalesType m_Scales;
+  double     m_DerivativeDelta;
+
+  /** The perturbation pipelines, one per thread. */
+  std::vector< PerturbationPipelineType > m_PerturbationPipelines;
+
+private:
+
+  RayCastFiniteDifferenceImageToImageMetric( const Self & ); // purposely not implemented
+  void operator=( const Self & );                            // purposely not implemented
+
+  /** The settings for which the current DRR was computed. */
+  mutable bool                    m_MovedImageIsValid;
+  mutable TransformParametersType m_MovedImageParameters;
+  mutable ModifiedTimeType        m_MovedImageInterpolatorMTime;
+
+  /** Variables for evaluating the perturbations concurrently. Perturbation
+   * 2i (2i+1) decreases (increases) parameter i. */
+  mutable TransformParametersType           m_PerturbationParameters;
+  mutable std::vector< MeasureType >        m_PerturbationValues;
+  mutable std::vector< std::exception_ptr > m_PerturbationExceptions;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkRayCastFiniteDifferenceImageToImageMetric.hxx"
+#endif
+
+#endif // end #ifndef __itkRayCastFiniteDifferenceImageToImageMetric_h
@@ -0,0 +1,390 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRayCastFiniteDifferenceImageToImageMetric_hxx
+#define __itkRayCastFiniteDifferenceImageToImageMetric_hxx
+
+#include "itkRayCastFiniteDifferenceImageToImageMetric.h"
+#include "itkNumericTraits.h"
+
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::RayCastFiniteDifferenceImageToImageMetric()
+{
+  this->m_TransformMovingImageFilter  = TransformMovingImageFilterType::New();
+  this->m_DerivativeDelta             = 0.001;
+  this->m_MovedImageIsValid           = false;
+  this->m_MovedImageInterpolatorMTime = 0;
+
+} // end Constructor
+
+
+/**
+ * ********************* Initialize ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::Initialize( void )
+{
+  /** Initialize the base class. */
+  Superclass::Initialize();
+
+  /** Resampling for 3D->2D */
+  RayCastInterpolatorType * rayCaster = dynamic_cast< RayCastInterpolatorType * >(
+    const_cast< InterpolatorType * >( this->GetInterpolator() ) );
+  if( rayCaster != 0 )
+  {
+    this->m_TransformMovingImageFilter->SetTransform( rayCaster->GetTransform() );
+    this->m_RayCastInterpolator = rayCaster;
+  }
+  else
+  {
+    itkExceptionMacro( << "ERROR: the " << this->GetNameOfClass() << " is currently "
+                       << "only suitable for 2D-3D registration.\n"
+                       << "  Therefore it expects an interpolator of type RayCastInterpolator." );
+  }
+  this->m_TransformMovingImageFilter->SetInterpolator( this->m_Interpolator );
+  this->m_TransformMovingImageFilter->SetInput( this->m_MovingImage );
+  this->m_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
+  this->m_TransformMovingImageFilter->SetSize( this->m_FixedImage->GetLargestPossibleRegion().GetSize() );
+  this->m_TransformMovingImageFilter->SetOutputOrigin( this->m_FixedImage->GetOrigin() );
+  this->m_TransformMovingImageFilter->SetOutputSpacing( this->m_FixedImage->GetSpacing() );
+  this->m_TransformMovingImageFilter->SetOutputDirection( this->m_FixedImage->GetDirection() );
+  this->m_TransformMovingImageFilter->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  this->m_RayCastInterpolator->PrecomputeRayCastGeometry();
+  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+  this->m_MovedImageIsValid = false;
+
+  /** The pipelines are built by the inheriting classes, once their own
+   * filters are set up.
+   */
+  this->m_PerturbationPipelines.clear();
+
+} // end Initialize()
+
+
+/**
+ * ********************* InitializePerturbationPipelines ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::InitializePerturbationPipelines( void )
+{
+  this->m_PerturbationPipelines.clear();
+  if( !this->m_UseMultiThread )
+  {
+    return;
+  }
+
+  /** The parameters of this metric are either those of the ray-cast transform
+   * itself, or of the current transform of a ray-cast combination transform,
+   * as set up by the elastix RayCastInterpolator.
+   */
+  RayCastTransformType *     rayCastTransform = this->m_RayCastInterpolator->GetTransform();
+  CombinationTransformType * rayCastCombination
+    = dynamic_cast< CombinationTransformType * >( rayCastTransform );
+  const bool transformIsRayCastTransform = rayCastTransform == this->m_Transform.GetPointer();
+  const bool transformIsCurrentTransform = rayCastCombination != nullptr
+    && rayCastCombination->GetCurrentTransform() == this->m_Transform.GetPointer();
+  if( !transformIsRayCastTransform && !transformIsCurrentTransform )
+  {
+    itkWarningMacro( << "The parameters of the ray-cast transform cannot be "
+                     << "related to the metric parameters; the derivative is "
+                     << "computed single-threaded." );
+    return;
+  }
+
+  /** Share the image buffer with the pipelines, but not the pipeline that
+   * produced the moving image, since it may not be updated concurrently.
+   */
+  MovingImagePointer movingImage = MovingImageType::New();
+  movingImage->Graft( this->m_MovingImage );
+
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  this->m_PerturbationPipelines.resize( numberOfThreads );
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    PerturbationPipelineType & pipeline = this->m_PerturbationPipelines[ i ];
+
+    /** Clone the transform, and select the part carrying the parameters. */
+    pipeline.st_RayCastTransform = rayCastTransform->Clone();
+    if( transformIsRayCastTransform )
+    {
+      pipeline.st_Transform = dynamic_cast< TransformType * >( pipeline.st_RayCastTransform.GetPointer() );
+    }
+    else
+    {
+      CombinationTransformType * combinationClone
+        = dynamic_cast< CombinationTransformType * >( pipeline.st_RayCastTransform.GetPointer() );
+      if( combinationClone != nullptr )
+      {
+        pipeline.st_Transform = combinationClone->GetCurrentTransform();
+      }
+    }
+    if( pipeline.st_Transform.IsNull() )
+    {
+      itkExceptionMacro( << "Cloning the ray-cast transform failed." );
+    }
+
+    pipeline.st_RayCaster = RayCastInterpolatorType::New();
+    pipeline.st_RayCaster->SetTransform( pipeline.st_RayCastTransform );
+    pipeline.st_RayCaster->SetInputImage( movingImage );
+
+    /** Each thread runs its own pipeline single-threaded. */
+    pipeline.st_TransformMovingImageFilter = TransformMovingImageFilterType::New();
+    pipeline.st_TransformMovingImageFilter->SetNumberOfWorkUnits( 1 );
+    pipeline.st_TransformMovingImageFilter->SetTransform( pipeline.st_RayCastTransform );
+    pipeline.st_TransformMovingImageFilter->SetInterpolator( pipeline.st_RayCaster );
+    pipeline.st_TransformMovingImageFilter->SetInput( movingImage );
+    pipeline.st_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
+    pipeline.st_TransformMovingImageFilter->SetSize( this->m_FixedImage->GetLargestPossibleRegion().GetSize() );
+    pipeline.st_TransformMovingImageFilter->SetOutputOrigin( this->m_FixedImage->GetOrigin() );
+    pipeline.st_TransformMovingImageFilter->SetOutputSpacing( this->m_FixedImage->GetSpacing() );
+    pipeline.st_TransformMovingImageFilter->SetOutputDirection( this->m_FixedImage->GetDirection() );
+  }
+
+} // end InitializePerturbationPipelines()
+
+
+/**
+ * ********************* PrintSelf ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "DerivativeDelta: " << this->m_DerivativeDelta << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ********************* UpdateMovedImage ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateMovedImage( const TransformParametersType & parameters ) const
+{
+  this->SetTransformParameters( parameters );
+
+  /** The DRR only depends on the transform parameters and on the settings of
+   * the ray caster, such as the focal point and the threshold. Changing the
+   * latter modifies the ray caster, so reuse the DRR if none of these changed.
+   */
+  if( this->m_MovedImageIsValid
+    && this->m_MovedImageParameters == parameters
+    && this->m_MovedImageInterpolatorMTime == this->m_RayCastInterpolator->GetMTime() )
+  {
+    return;
+  }
+
+  /** Compute the ray geometry that is shared by all rays once, and let the
+   * multi-threaded resampler cast the rays.
+   */
+  this->m_RayCastInterpolator->PrecomputeRayCastGeometry();
+  this->m_TransformMovingImageFilter->Modified();
+  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+
+  this->m_MovedImageParameters        = parameters;
+  this->m_MovedImageInterpolatorMTime = this->m_RayCastInterpolator->GetMTime();
+  this->m_MovedImageIsValid           = true;
+
+} // end UpdateMovedImage()
+
+
+/**
+ * ********************* GetDerivative ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::GetDerivative( const TransformParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  /** Fall back to the single-threaded version if there is no pipeline per thread. */
+  if( !this->m_UseMultiThread
+    || this->m_PerturbationPipelines.size() != Self::GetNumberOfWorkUnits() )
+  {
+    this->GetDerivativeSingleThreaded( parameters, derivative );
+    return;
+  }
+
+  /** Evaluate all perturbations concurrently. */
+  this->m_PerturbationParameters = parameters;
+  this->m_PerturbationValues.resize( 2 * this->GetNumberOfParameters() );
+  this->m_PerturbationExceptions.assign( Self::GetNumberOfWorkUnits(), std::exception_ptr() );
+  this->LaunchGetValueAndDerivativeThreaderCallback();
+
+  /** Compute the derivative from the perturbed values. */
+  MeasureType dummyValue = NumericTraits< MeasureType >::Zero;
+  this->AfterThreadedGetValueAndDerivative( dummyValue, derivative );
+
+} // end GetDerivative()
+
+
+/**
+ * ********************* GetDerivativeSingleThreaded ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::GetDerivativeSingleThreaded( const TransformParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  TransformParametersType testPoint;
+  testPoint = parameters;
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  derivative = DerivativeType( numberOfParameters );
+
+  for( unsigned int i = 0; i < numberOfParameters; i++ )
+  {
+    testPoint[ i ] -= this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
+    const MeasureType valuep0 = this->GetValue( testPoint );
+    testPoint[ i ] += 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
+    const MeasureType valuep1 = this->GetValue( testPoint );
+    derivative[ i ] = ( valuep1 - valuep0 ) / ( 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] ) );
+    testPoint[ i ]  = parameters[ i ];
+  }
+
+} // end GetDerivativeSingleThreaded()
+
+
+/**
+ * ********************* ThreadedGetValueAndDerivative ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivative( ThreadIdType threadId )
+{
+  /** Divide the 2N perturbations over the threads. */
+  const unsigned long numberOfPerturbations = this->m_PerturbationValues.size();
+  const ThreadIdType  numberOfThreads       = Self::GetNumberOfWorkUnits();
+  const unsigned long nrOfPerturbationsPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( numberOfPerturbations )
+    / static_cast< double >( numberOfThreads ) ) );
+
+  unsigned long pos_begin = nrOfPerturbationsPerThreads * threadId;
+  unsigned long pos_end   = nrOfPerturbationsPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > numberOfPerturbations ) ? numberOfPerturbations : pos_begin;
+  pos_end   = ( pos_end > numberOfPerturbations ) ? numberOfPerturbations : pos_end;
+
+  /** Evaluate the perturbations on the pipeline of this thread. */
+  try
+  {
+    PerturbationPipelineType & pipeline  = this->m_PerturbationPipelines[ threadId ];
+    TransformParametersType    testPoint = this->m_PerturbationParameters;
+    for( unsigned long k = pos_begin; k < pos_end; ++k )
+    {
+      const unsigned int i     = k / 2;
+      const double       delta = this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
+      testPoint[ i ] = this->m_PerturbationParameters[ i ] + ( k % 2 == 0 ? -delta : delta );
+
+      /** Follow the settings of the ray caster of this metric, and set up
+       * the DRR for the perturbed parameters.
+       */
+      pipeline.st_RayCaster->SetFocalPoint( this->m_RayCastInterpolator->GetFocalPoint() );
+      pipeline.st_RayCaster->SetThreshold( this->m_RayCastInterpolator->GetThreshold() );
+      pipeline.st_RayCaster->SetUseSiddonRayTraversal( this->m_RayCastInterpolator->GetUseSiddonRayTraversal() );
+      pipeline.st_Transform->SetParameters( testPoint );
+      pipeline.st_RayCaster->PrecomputeRayCastGeometry();
+      pipeline.st_TransformMovingImageFilter->Modified();
+
+      this->m_PerturbationValues[ k ] = this->ComputePerturbedValue( threadId );
+      testPoint[ i ]                  = this->m_PerturbationParameters[ i ];
+    }
+  }
+  catch( ... )
+  {
+    this->m_PerturbationExceptions[ threadId ] = std::current_exception();
+  }
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ********************* AfterThreadedGetValueAndDerivative ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & itkNotUsed( value ), DerivativeType & derivative ) const
+{
+  /** Pass on errors that occurred in the threads. */
+  for( std::size_t i = 0; i < this->m_PerturbationExceptions.size(); ++i )
+  {
+    if( this->m_PerturbationExceptions[ i ] )
+    {
+      std::rethrow_exception( this->m_PerturbationExceptions[ i ] );
+    }
+  }
+
+  /** Central differences. */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  derivative = DerivativeType( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; i++ )
+  {
+    const double delta = this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
+    derivative[ i ] = ( this->m_PerturbationValues[ 2 * i + 1 ]
+      - this->m_PerturbationValues[ 2 * i ] ) / ( 2 * delta );
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
+/**
+ * ********************* GetValueAndDerivative ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivative( const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  value = this->GetValue( parameters );
+  this->GetDerivative( parameters, derivative );
+
+} // end GetValueAndDerivative()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkRayCastFiniteDifferenceImageToImageMetric_hxx
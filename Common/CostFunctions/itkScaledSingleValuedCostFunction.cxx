@@ -167,6 +167,206 @@ ScaledSingleValuedCostFunction
 } // end GetValueAndDerivative()
 
 
+/**
+ * **************** GetSupportsConcurrentEvaluation ************************
+ */
+
+bool
+ScaledSingleValuedCostFunction
+::GetSupportsConcurrentEvaluation( void ) const
+{
+  const MultiPositionCostFunctionInterface * multiPositionCostFunction
+    = dynamic_cast< const MultiPositionCostFunctionInterface * >(
+    this->m_UnscaledCostFunction.GetPointer() );
+  return multiPositionCostFunction != nullptr
+    && multiPositionCostFunction->GetSupportsConcurrentEvaluation();
+
+} // end GetSupportsConcurrentEvaluation()
+
+
+/**
+ * **************** GetValuesAndDerivatives ************************
+ */
+
+void
+ScaledSingleValuedCostFunction
+::GetValuesAndDerivatives( const ParametersListType & positions,
+  MeasureListType & values,
+  DerivativeListType & derivatives ) const
+{
+  /** This function also checks if the UnscaledCostFunction has been set */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  const std::size_t  numberOfPositions  = positions.size();
+  for( std::size_t k = 0; k < numberOfPositions; ++k )
+  {
+    if( positions[ k ].GetSize() != numberOfParameters )
+    {
+      itkExceptionMacro( << "Number of parameters is not like the unscaled cost function expects." );
+    }
+  }
+  values.resize( numberOfPositions );
+  derivatives.resize( numberOfPositions );
+
+  /** Evaluate one after another, if the unscaled cost function can not do better. */
+  const MultiPositionCostFunctionInterface * multiPositionCostFunction
+    = dynamic_cast< const MultiPositionCostFunctionInterface * >(
+    this->m_UnscaledCostFunction.GetPointer() );
+  if( multiPositionCostFunction == nullptr )
+  {
+    for( std::size_t k = 0; k < numberOfPositions; ++k )
+    {
+      this->GetValueAndDerivative( positions[ k ], values[ k ], derivatives[ k ] );
+    }
+    return;
+  }
+
+  /** F(y)= f(y/s), dF/dy(y)= 1/s * df/dx(y/s) */
+  if( this->m_UseScales )
+  {
+    ParametersListType scaledPositions = positions;
+    for( std::size_t k = 0; k < numberOfPositions; ++k )
+    {
+      this->ConvertScaledToUnscaledParameters( scaledPositions[ k ] );
+    }
+    multiPositionCostFunction->GetValuesAndDerivatives( scaledPositions, values, derivatives );
+
+    const ScalesType & scales = this->GetScales();
+    for( std::size_t k = 0; k < numberOfPositions; ++k )
+    {
+      for( unsigned int i = 0; i < numberOfParameters; ++i )
+      {
+        derivatives[ k ][ i ] /= scales[ i ];
+      }
+    }
+  }
+  else
+  {
+    multiPositionCostFunction->GetValuesAndDerivatives( positions, values, derivatives );
+  }
+
+  if( this->GetNegateCostFunction() )
+  {
+    for( std::size_t k = 0; k < numberOfPositions; ++k )
+    {
+      values[ k ]      = -values[ k ];
+      derivatives[ k ] = -derivatives[ k ];
+    }
+  }
+
+} // end GetValuesAndDerivatives()
+
+
+/**
+ * **************** GetValues ************************
+ */
+
+void
+ScaledSingleValuedCostFunction
+::GetValues( const ParametersListType & positions,
+  MeasureListType & values ) const
+{
+  /** This function also checks if the UnscaledCostFunction has been set */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  const std::size_t  numberOfPositions  = positions.size();
+  for( std::size_t k = 0; k < numberOfPositions; ++k )
+  {
+    if( positions[ k ].GetSize() != numberOfParameters )
+    {
+      itkExceptionMacro( << "Number of parameters is not like the unscaled cost function expects." );
+    }
+  }
+  values.resize( numberOfPositions );
+
+  /** Evaluate one after another, if the unscaled cost function can not do better. */
+  const MultiPositionCostFunctionInterface * multiPositionCostFunction
+    = dynamic_cast< const MultiPositionCostFunctionInterface * >(
+    this->m_UnscaledCostFunction.GetPointer() );
+  if( multiPositionCostFunction == nullptr )
+  {
+    for( std::size_t k = 0; k < numberOfPositions; ++k )
+    {
+      values[ k ] = this->GetValue( positions[ k ] );
+    }
+    return;
+  }
+
+  /** F(y)= f(y/s) */
+  if( this->m_UseScales )
+  {
+    ParametersListType scaledPositions = positions;
+    for( std::size_t k = 0; k < numberOfPositions; ++k )
+    {
+      this->ConvertScaledToUnscaledParameters( scaledPositions[ k ] );
+    }
+    multiPositionCostFunction->GetValues( scaledPositions, values );
+  }
+  else
+  {
+    multiPositionCostFunction->GetValues( positions, values );
+  }
+
+  if( this->GetNegateCostFunction() )
+  {
+    for( std::size_t k = 0; k < numberOfPositions; ++k )
+    {
+      values[ k ] = -values[ k ];
+    }
+  }
+
+} // end GetValues()
+
+
+/**
+ * **************** GetCentralDifferences ************************
+ */
+
+void
+ScaledSingleValuedCostFunction
+::GetCentralDifferences( const ParametersType & position,
+  const ParametersType & perturbations,
+  DerivativeType & differences ) const
+{
+  /** This function also checks if the UnscaledCostFunction has been set */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if( position.GetSize() != numberOfParameters
+    || perturbations.GetSize() != numberOfParameters )
+  {
+    itkExceptionMacro( << "Number of parameters is not like the unscaled cost function expects." );
+  }
+
+  /** Evaluate one position after another, if the unscaled cost function can not do better. */
+  const MultiPositionCostFunctionInterface * multiPositionCostFunction
+    = dynamic_cast< const MultiPositionCostFunctionInterface * >(
+    this->m_UnscaledCostFunction.GetPointer() );
+  if( multiPositionCostFunction == nullptr )
+  {
+    this->ComputeCentralDifferencesFromValues( position, perturbations, differences, 1 );
+    return;
+  }
+
+  /** F(y +- p e_j) = f(y/s +- p/s_j e_j), so the differences are unchanged. */
+  if( this->m_UseScales )
+  {
+    ParametersType scaledPosition      = position;
+    ParametersType scaledPerturbations = perturbations;
+    this->ConvertScaledToUnscaledParameters( scaledPosition );
+    this->ConvertScaledToUnscaledParameters( scaledPerturbations );
+    multiPositionCostFunction->GetCentralDifferences(
+      scaledPosition, scaledPerturbations, differences );
+  }
+  else
+  {
+    multiPositionCostFunction->GetCentralDifferences( position, perturbations, differences );
+  }
+
+  if( this->GetNegateCostFunction() )
+  {
+    differences = -differences;
+  }
+
+} // end GetCentralDifferences()
+
+
 /**
  * **************** GetNumberOfParameters ************************
  */
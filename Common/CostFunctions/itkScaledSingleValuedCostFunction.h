@@ -20,6 +20,7 @@
 #define __itkScaledSingleValuedCostFunction_h
 
 #include "itkSingleValuedCostFunction.h"
+#include "itkMultiPositionCostFunctionInterface.h"
 #include "itkIntTypes.h" //temp, needed for IdentifierType
 
 namespace itk
@@ -33,10 +34,16 @@ namespace itk
  * By default it does not apply any scaling. Use the method SetUseScales(true)
  * to enable the use of scales.
  *
+ * The MultiPositionCostFunctionInterface is forwarded to the unscaled cost
+ * function, if that implements it. Otherwise, the positions are evaluated
+ * one after another.
+ *
  * \ingroup Numerics
  */
 
-class ScaledSingleValuedCostFunction : public SingleValuedCostFunction
+class ScaledSingleValuedCostFunction :
+  public SingleValuedCostFunction,
+  public MultiPositionCostFunctionInterface
 {
 public:
 
@@ -63,6 +70,11 @@ public:
 
   typedef Array< double > ScalesType;
 
+  /** Typedefs from the MultiPositionCostFunctionInterface. */
+  typedef MultiPositionCostFunctionInterface::ParametersListType ParametersListType;
+  typedef MultiPositionCostFunctionInterface::MeasureListType    MeasureListType;
+  typedef MultiPositionCostFunctionInterface::DerivativeListType DerivativeListType;
+
   /** Divide the parameters by the scales and call the GetValue routine
    * of the unscaled cost function.
    */
@@ -82,6 +94,29 @@ public:
     MeasureType & value,
     DerivativeType & derivative ) const override;
 
+  /** True if the unscaled cost function evaluates several positions concurrently. */
+  bool GetSupportsConcurrentEvaluation( void ) const override;
+
+  /** Same procedure as in GetValueAndDerivative, for each of the positions. */
+  void GetValuesAndDerivatives(
+    const ParametersListType & positions,
+    MeasureListType & values,
+    DerivativeListType & derivatives ) const override;
+
+  /** Same procedure as in GetValue, for each of the positions. */
+  void GetValues(
+    const ParametersListType & positions,
+    MeasureListType & values ) const override;
+
+  /** Divide the position and the perturbations by the scales, and call the
+   * GetCentralDifferences routine of the unscaled cost function. Without
+   * one, GetValue is called for each perturbed position.
+   */
+  void GetCentralDifferences(
+    const ParametersType & position,
+    const ParametersType & perturbations,
+    DerivativeType & differences ) const override;
+
   /** Ask the UnscaledCostFunction how many parameters it has. */
   NumberOfParametersType GetNumberOfParameters( void ) const override;
 
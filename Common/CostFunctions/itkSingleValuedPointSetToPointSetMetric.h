@@ -40,6 +40,7 @@
 #include "itkMacro.h"
 #include "itkSpatialObject.h"
 #include "itkPointSet.h"
+#include "itkPlatformMultiThreader.h"
 
 namespace itk
 {
@@ -54,6 +55,11 @@ namespace itk
  * This class computes a value that measures the similarity between the fixed point-set
  * and the transformed moving point-set.
  *
+ * Subclasses can loop over the points with multiple threads, by implementing
+ * ThreadedGetValue() and ThreadedGetValueAndDerivative() and launching them
+ * with LaunchGetValueThreaderCallback() and LaunchGetValueAndDerivativeThreaderCallback().
+ * Each thread accumulates into its own GetValueAndDerivativePerThreadStruct.
+ *
  * \ingroup RegistrationMetrics
  *
  */
@@ -120,6 +126,10 @@ public:
   /** Typedefs for support of sparse Jacobians and compact support of transformations. */
   typedef typename TransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
+  /** Typedefs for multi-threading. */
+  typedef itk::PlatformMultiThreader          ThreaderType;
+  typedef typename ThreaderType::WorkUnitInfo ThreadInfoType;
+
   /** Connect the fixed pointset.  */
   itkSetConstObjectMacro( FixedPointSet, FixedPointSetType );
 
@@ -171,10 +181,16 @@ public:
   itkGetConstReferenceMacro( UseMetricSingleThreaded, bool );
   itkBooleanMacro( UseMetricSingleThreaded );
 
+  /** Set/Get the number of threads used to loop over the points. */
+  virtual void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
+  { this->m_Threader->SetNumberOfWorkUnits( numberOfThreads ); }
+  virtual ThreadIdType GetNumberOfWorkUnits( void ) const
+  { return this->m_Threader->GetNumberOfWorkUnits(); }
+
 protected:
 
   SingleValuedPointSetToPointSetMetric();
-  ~SingleValuedPointSetToPointSetMetric() override {}
+  ~SingleValuedPointSetToPointSetMetric() override;
 
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
@@ -191,6 +207,65 @@ protected:
   /** Variables for multi-threading. */
   bool m_UseMetricSingleThreaded;
 
+  /** Multi-threaded versions of GetValue() and GetValueAndDerivative(),
+   * over the part of the points that belongs to threadID.
+   */
+  virtual inline void ThreadedGetValue( ThreadIdType threadID ) const {}
+  virtual inline void ThreadedGetValueAndDerivative( ThreadIdType threadID ) const {}
+
+  /** GetValue threader callback function. */
+  static ITK_THREAD_RETURN_TYPE GetValueThreaderCallback( void * arg );
+
+  /** Launch MultiThread GetValue. */
+  void LaunchGetValueThreaderCallback( void ) const;
+
+  /** GetValueAndDerivative threader callback function. */
+  static ITK_THREAD_RETURN_TYPE GetValueAndDerivativeThreaderCallback( void * arg );
+
+  /** Launch MultiThread GetValueAndDerivative. */
+  void LaunchGetValueAndDerivativeThreaderCallback( void ) const;
+
+  /** AccumulateDerivatives threader callback function. */
+  static ITK_THREAD_RETURN_TYPE AccumulateDerivativesThreaderCallback( void * arg );
+
+  /** Sum the derivatives of all threads into derivative, divided by
+   * normalizationFactor, and reset them for the next evaluation.
+   */
+  void AccumulateDerivatives( DerivativeType & derivative,
+    const DerivativeValueType normalizationFactor ) const;
+
+  /** Get the range [ pointBegin, pointEnd [ of the points of thread threadID. */
+  void GetThreadPointRange( const ThreadIdType threadID,
+    unsigned long & pointBegin, unsigned long & pointEnd ) const;
+
+  /** Resize the per-thread variables when needed, and reset the values. */
+  virtual void InitializeThreadingParameters( void ) const;
+
+  typename ThreaderType::Pointer m_Threader;
+
+  /** Helper struct that gives the threads access to all members. */
+  struct MultiThreaderParameterType
+  {
+    SingleValuedPointSetToPointSetMetric * st_Metric;
+    DerivativeValueType *                  st_DerivativePointer;
+    DerivativeValueType                    st_NormalizationFactor;
+  };
+  mutable MultiThreaderParameterType m_ThreaderMetricParameters;
+
+  /** The partial results of each thread. */
+  struct GetValueAndDerivativePerThreadStruct
+  {
+    SizeValueType  st_NumberOfPointsCounted;
+    MeasureType    st_Value;
+    DerivativeType st_Derivative;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, GetValueAndDerivativePerThreadStruct,
+    PaddedGetValueAndDerivativePerThreadStruct );
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT, PaddedGetValueAndDerivativePerThreadStruct,
+    AlignedGetValueAndDerivativePerThreadStruct );
+  mutable AlignedGetValueAndDerivativePerThreadStruct * m_GetValueAndDerivativePerThreadVariables;
+  mutable ThreadIdType                                  m_GetValueAndDerivativePerThreadVariablesSize;
+
 private:
 
   SingleValuedPointSetToPointSetMetric( const Self & ); // purposely not implemented
@@ -36,6 +36,9 @@
 
 #include "itkSingleValuedPointSetToPointSetMetric.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace itk
 {
 
@@ -57,9 +60,28 @@ SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
 
   this->m_UseMetricSingleThreaded = true;
 
+  /** Multi-threading. */
+  this->m_Threader                                    = ThreaderType::New();
+  this->m_ThreaderMetricParameters.st_Metric          = this;
+  this->m_GetValueAndDerivativePerThreadVariables     = nullptr;
+  this->m_GetValueAndDerivativePerThreadVariablesSize = 0;
+
 } // end Constructor
 
 
+/**
+ * ******************* Destructor ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::~SingleValuedPointSetToPointSetMetric()
+{
+  delete[] this->m_GetValueAndDerivativePerThreadVariables;
+
+} // end Destructor
+
+
 /**
  * ******************* SetTransformParameters ***********************
  */
@@ -135,6 +157,213 @@ SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
 } // end BeforeThreadedGetValueAndDerivative()
 
 
+/**
+ * ******************* InitializeThreadingParameters ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::InitializeThreadingParameters( void ) const
+{
+  const ThreadIdType numberOfThreads = this->GetNumberOfWorkUnits();
+
+  /** Only resize the array of structs when needed. */
+  if( this->m_GetValueAndDerivativePerThreadVariablesSize != numberOfThreads )
+  {
+    delete[] this->m_GetValueAndDerivativePerThreadVariables;
+    this->m_GetValueAndDerivativePerThreadVariables     = new AlignedGetValueAndDerivativePerThreadStruct[ numberOfThreads ];
+    this->m_GetValueAndDerivativePerThreadVariablesSize = numberOfThreads;
+  }
+
+  /** The derivatives are only reset when they are resized. After that,
+   * they are reset by AccumulateDerivatives(), in a multi-threaded fashion.
+   */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPointsCounted = NumericTraits< SizeValueType >::Zero;
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value                 = NumericTraits< MeasureType >::Zero;
+    if( this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.GetSize() != numberOfParameters )
+    {
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.SetSize( numberOfParameters );
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    }
+  }
+
+} // end InitializeThreadingParameters()
+
+
+/**
+ * ******************* GetThreadPointRange ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::GetThreadPointRange( const ThreadIdType threadID,
+  unsigned long & pointBegin, unsigned long & pointEnd ) const
+{
+  const unsigned long numberOfPoints  = this->m_FixedPointSet->GetNumberOfPoints();
+  const ThreadIdType  numberOfThreads = this->GetNumberOfWorkUnits();
+  const unsigned long subSize         = static_cast< unsigned long >(
+    std::ceil( static_cast< double >( numberOfPoints )
+    / static_cast< double >( numberOfThreads ) ) );
+
+  pointBegin = std::min( threadID * subSize, numberOfPoints );
+  pointEnd   = std::min( ( threadID + 1 ) * subSize, numberOfPoints );
+
+} // end GetThreadPointRange()
+
+
+/**
+ * ******************* GetValueThreaderCallback ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+ITK_THREAD_RETURN_TYPE
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::GetValueThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedGetValue( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GetValueThreaderCallback()
+
+
+/**
+ * ******************* LaunchGetValueThreaderCallback ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::LaunchGetValueThreaderCallback( void ) const
+{
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->GetValueThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+
+  /** Launch. */
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchGetValueThreaderCallback()
+
+
+/**
+ * ******************* GetValueAndDerivativeThreaderCallback ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+ITK_THREAD_RETURN_TYPE
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::GetValueAndDerivativeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedGetValueAndDerivative( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GetValueAndDerivativeThreaderCallback()
+
+
+/**
+ * ******************* LaunchGetValueAndDerivativeThreaderCallback ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::LaunchGetValueAndDerivativeThreaderCallback( void ) const
+{
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->GetValueAndDerivativeThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+
+  /** Launch. */
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchGetValueAndDerivativeThreaderCallback()
+
+
+/**
+ * ******************* AccumulateDerivativesThreaderCallback ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+ITK_THREAD_RETURN_TYPE
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::AccumulateDerivativesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID    = infoStruct->WorkUnitID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfWorkUnits;
+
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  const unsigned int numPar  = temp->st_Metric->GetNumberOfParameters();
+  const unsigned int subSize = static_cast< unsigned int >(
+    std::ceil( static_cast< double >( numPar )
+    / static_cast< double >( nrOfThreads ) ) );
+  const unsigned int jmin = std::min( threadID * subSize, numPar );
+  const unsigned int jmax = std::min( ( threadID + 1 ) * subSize, numPar );
+
+  /** This thread accumulates all sub-derivatives into a single one, for the
+   * range [ jmin, jmax [. Additionally, the sub-derivatives are reset.
+   */
+  const DerivativeValueType zero          = NumericTraits< DerivativeValueType >::Zero;
+  const DerivativeValueType normalization = 1.0 / temp->st_NormalizationFactor;
+  for( unsigned int j = jmin; j < jmax; ++j )
+  {
+    DerivativeValueType tmp = zero;
+    for( ThreadIdType i = 0; i < nrOfThreads; ++i )
+    {
+      tmp += temp->st_Metric->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative[ j ];
+
+      /** Reset this variable for the next iteration. */
+      temp->st_Metric->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative[ j ] = zero;
+    }
+    temp->st_DerivativePointer[ j ] = tmp * normalization;
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end AccumulateDerivativesThreaderCallback()
+
+
+/**
+ * ******************* AccumulateDerivatives ***********************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
+::AccumulateDerivatives( DerivativeType & derivative,
+  const DerivativeValueType normalizationFactor ) const
+{
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = normalizationFactor;
+
+  this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end AccumulateDerivatives()
+
+
 /**
  * ******************* PrintSelf ***********************
  */
@@ -151,6 +380,7 @@ SingleValuedPointSetToPointSetMetric< TFixedPointSet, TMovingPointSet >
   os << "Fixed mask: " << this->m_FixedImageMask.GetPointer() << std::endl;
   os << "Moving mask: " << this->m_MovingImageMask.GetPointer() << std::endl;
   os << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << "NumberOfWorkUnits: " << this->GetNumberOfWorkUnits() << std::endl;
 
 } // end PrintSelf()
 
@@ -21,6 +21,7 @@
 
 #include "itkMoreThuenteLineSearchOptimizer.h"
 #include <cmath> // For abs.
+#include <algorithm> // For find.
 #include <limits>
 
 namespace itk
@@ -41,6 +42,7 @@ MoreThuenteLineSearchOptimizer
   this->m_ValueTolerance            = 1e-4;
   this->m_GradientTolerance         = 0.9;
   this->m_IntervalTolerance         = std::numeric_limits< double >::epsilon();
+  this->m_NumberOfSpeculativeSteps  = 1;
   this->SetMinimumStepLength( 1e-20 );
   this->SetMaximumStepLength( 1e20 );
 
@@ -157,14 +159,25 @@ MoreThuenteLineSearchOptimizer
     this->StopOptimization();
   }
 
+  const MultiPositionCostFunctionType * speculativeCostFunction
+    = this->GetSpeculativeCostFunction();
+
   while( !this->m_Stop )
   {
 
     this->UpdateIntervalMinimumAndMaximum();
     this->BoundStep( this->m_step );
     this->PrepareForUnusualTermination();
-    this->SetCurrentStepLength( this->m_step );
-    this->ComputeCurrentValueAndDerivative();
+    if( speculativeCostFunction )
+    {
+      this->ComputeSpeculativeValueAndDerivative( speculativeCostFunction );
+      this->SetCurrentStepLength( this->m_step );
+    }
+    else
+    {
+      this->SetCurrentStepLength( this->m_step );
+      this->ComputeCurrentValueAndDerivative();
+    }
     this->m_dg = this->DirectionalDerivative( this->m_g );
     this->TestConvergence( this->m_Stop );
     this->InvokeEvent( IterationEvent() );
@@ -433,6 +446,132 @@ MoreThuenteLineSearchOptimizer
 } // end ComputeCurrentValueAndDerivative()
 
 
+/**
+ * ***************** GetSpeculativeCostFunction ********************
+ */
+
+const MoreThuenteLineSearchOptimizer::MultiPositionCostFunctionType *
+MoreThuenteLineSearchOptimizer
+::GetSpeculativeCostFunction( void ) const
+{
+  if( this->m_NumberOfSpeculativeSteps < 2 )
+  {
+    return 0;
+  }
+
+  const MultiPositionCostFunctionType * costFunction
+    = dynamic_cast< const MultiPositionCostFunctionType * >( this->GetCostFunction() );
+  if( costFunction == 0 || !costFunction->GetSupportsConcurrentEvaluation() )
+  {
+    return 0;
+  }
+  return costFunction;
+
+} // end GetSpeculativeCostFunction()
+
+
+/**
+ * ***************** ComputeSpeculativeSteps ********************
+ *
+ * The candidates are m_step + fraction * ( end - m_step ), with fraction
+ * 1/2, 1/4, ..., alternately towards the far end of the interval of
+ * uncertainty (or the maximum step when the minimizer is not bracketed yet),
+ * and towards the best step so far.
+ */
+
+void
+MoreThuenteLineSearchOptimizer
+::ComputeSpeculativeSteps( std::vector< double > & steps ) const
+{
+  steps.clear();
+  steps.push_back( this->m_step );
+
+  /** No candidates if unusual termination is expected; see PrepareForUnusualTermination(). */
+  if( this->m_step == this->m_stepx )
+  {
+    return;
+  }
+
+  const double farEnd = this->m_brackt ? this->m_stepy : this->m_stepmax;
+  const double ends[ 2 ] = { farEnd, this->m_stepx };
+
+  /** Stop halving when the candidates are closer than the interval tolerance. */
+  double fraction = 0.5;
+  while( steps.size() < this->m_NumberOfSpeculativeSteps
+    && fraction > this->GetIntervalTolerance() )
+  {
+    for( unsigned int e = 0; e < 2 && steps.size() < this->m_NumberOfSpeculativeSteps; ++e )
+    {
+      double candidate = this->m_step + fraction * ( ends[ e ] - this->m_step );
+      this->BoundStep( candidate );
+      if( candidate > this->m_stepmin && candidate < this->m_stepmax
+        && std::find( steps.begin(), steps.end(), candidate ) == steps.end() )
+      {
+        steps.push_back( candidate );
+      }
+    }
+    fraction *= 0.5;
+  }
+
+} // end ComputeSpeculativeSteps()
+
+
+/**
+ * ***************** ComputeSpeculativeValueAndDerivative ********************
+ */
+
+void
+MoreThuenteLineSearchOptimizer
+::ComputeSpeculativeValueAndDerivative(
+  const MultiPositionCostFunctionType * costFunction )
+{
+  std::vector< double > steps;
+  this->ComputeSpeculativeSteps( steps );
+
+  const ParametersType & initialPosition = this->GetInitialPosition();
+  const ParametersType & direction       = this->GetLineSearchDirection();
+  ParametersListType     positions( steps.size() );
+  for( std::size_t k = 0; k < steps.size(); ++k )
+  {
+    positions[ k ] = initialPosition + steps[ k ] * direction;
+  }
+
+  MeasureListType    values;
+  DerivativeListType derivatives;
+  try
+  {
+    costFunction->GetValuesAndDerivatives( positions, values, derivatives );
+  }
+  catch( ExceptionObject & err )
+  {
+    this->m_StopCondition = MetricError;
+    this->StopOptimization();
+    throw err;
+  }
+
+  /** Take the first step that satisfies the Strong Wolfe Conditions.
+   * The proposed step comes first, so if it satisfies them, the result
+   * is the same as without candidates.
+   */
+  std::size_t chosen = 0;
+  for( std::size_t k = 0; k < steps.size(); ++k )
+  {
+    const double dg = this->DirectionalDerivative( derivatives[ k ] );
+    if( values[ k ] <= this->m_finit + steps[ k ] * this->m_dgtest
+      && std::abs( dg ) <= this->GetGradientTolerance() * ( -this->m_dginit ) )
+    {
+      chosen = k;
+      break;
+    }
+  }
+
+  this->m_step = steps[ chosen ];
+  this->m_f    = values[ chosen ];
+  this->m_g    = derivatives[ chosen ];
+
+} // end ComputeSpeculativeValueAndDerivative()
+
+
 /**
  * ************************** TestConvergence ****************************
  *
@@ -1016,6 +1155,8 @@ MoreThuenteLineSearchOptimizer
      << this->m_GradientTolerance << std::endl;
   os << indent << "m_IntervalTolerance: "
      << this->m_IntervalTolerance << std::endl;
+  os << indent << "m_NumberOfSpeculativeSteps: "
+     << this->m_NumberOfSpeculativeSteps << std::endl;
 
 } // end PrintSelf()
 
@@ -20,6 +20,7 @@
 #define __itkMoreThuenteLineSearchOptimizer_h
 
 #include "itkLineSearchOptimizer.h"
+#include "itkMultiPositionCostFunctionInterface.h"
 
 namespace itk
 {
@@ -64,6 +65,21 @@ namespace itk
  * when rounding errors prevent further progress. In this case stp only
  * satisfies the sufficient decrease condition.
  *
+ * If NumberOfSpeculativeSteps is larger than 1, and the cost function
+ * implements the MultiPositionCostFunctionInterface and supports concurrent
+ * evaluation, each iteration evaluates the step proposed by the algorithm
+ * together with a few extra candidate steps in one call. The candidates lie
+ * between the proposed step and the ends of the interval of uncertainty.
+ * The first candidate that satisfies the Strong Wolfe Conditions is taken;
+ * the proposed step is always the first candidate. If none satisfies them,
+ * the algorithm continues with the proposed step, as usual. Otherwise the
+ * candidates are skipped, and the results are identical to the serial line
+ * search. Note that the candidates are evaluated without setting the
+ * parameters of the cost function, so an image metric keeps the transform
+ * parameters of the last serial evaluation, not those of the accepted step.
+ * The optimizers that use the line search only use its current position,
+ * value and derivative, and elastix sets the transform parameters from the
+ * position of the optimizer where it needs them (SetFinalParameters()).
  *
  * \ingroup Numerics Optimizers
  */
@@ -85,6 +101,11 @@ public:
   typedef Superclass::DerivativeType   DerivativeType;
   typedef Superclass::CostFunctionType CostFunctionType;
 
+  typedef MultiPositionCostFunctionInterface                    MultiPositionCostFunctionType;
+  typedef MultiPositionCostFunctionType::ParametersListType     ParametersListType;
+  typedef MultiPositionCostFunctionType::MeasureListType        MeasureListType;
+  typedef MultiPositionCostFunctionType::DerivativeListType     DerivativeListType;
+
   typedef enum {
     StrongWolfeConditionsSatisfied,
     MetricError,
@@ -166,6 +187,13 @@ public:
   itkSetClampMacro( IntervalTolerance, double, 0.0, NumericTraits< double >::max() );
   itkGetConstMacro( IntervalTolerance, double );
 
+  /** Setting: the number of step lengths that are evaluated at once.
+   * By default 1, which disables the speculative candidate steps.
+   */
+  itkSetClampMacro( NumberOfSpeculativeSteps, unsigned int,
+    1, NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( NumberOfSpeculativeSteps, unsigned int );
+
 protected:
 
   MoreThuenteLineSearchOptimizer();
@@ -204,6 +232,23 @@ protected:
   /** Ask the cost function to compute m_f and m_g at the current position. */
   virtual void ComputeCurrentValueAndDerivative( void );
 
+  /** Return the cost function as a MultiPositionCostFunctionInterface if
+   * speculative steps are requested and the cost function supports
+   * concurrent evaluation, and 0 otherwise.
+   */
+  virtual const MultiPositionCostFunctionType * GetSpeculativeCostFunction( void ) const;
+
+  /** Fill steps with m_step, followed by the candidate steps. */
+  virtual void ComputeSpeculativeSteps( std::vector< double > & steps ) const;
+
+  /** Compute the value and derivative at m_step and at the candidate steps,
+   * in one call to the cost function. Set m_step to the first step that
+   * satisfies the Strong Wolfe Conditions, or leave it unchanged if none does,
+   * and set m_f and m_g accordingly.
+   */
+  virtual void ComputeSpeculativeValueAndDerivative(
+    const MultiPositionCostFunctionType * costFunction );
+
   /** Check for convergence */
   virtual void TestConvergence( bool & stop );
 
@@ -257,6 +302,7 @@ private:
   double        m_ValueTolerance;
   double        m_GradientTolerance;
   double        m_IntervalTolerance;
+  unsigned int  m_NumberOfSpeculativeSteps;
 
 };
 
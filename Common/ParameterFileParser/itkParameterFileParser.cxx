@@ -20,9 +20,13 @@
 #define __itkParameterFileParser_cxx
 
 #include "itkParameterFileParser.h"
+#include "itkParameterMapInterface.h"
 
 #include <itksys/SystemTools.hxx>
-#include <itksys/RegularExpression.hxx>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 namespace itk
 {
@@ -36,6 +40,8 @@ ParameterFileParser
 {
   this->m_ParameterFileName = "";
   this->m_ParameterMap.clear();
+  this->m_NumericParameterMap.clear();
+  this->m_LargeParameterThreshold = 1024;
 
 } // end Constructor()
 
@@ -63,6 +69,17 @@ const ParameterFileParser::ParameterMapType &
 ParameterFileParser
 ::GetParameterMap( void ) const
 {
+  /** Convert the numeric entries that are not yet available as text. */
+  NumericParameterMapType::const_iterator it = this->m_NumericParameterMap.begin();
+  for( ; it != this->m_NumericParameterMap.end(); ++it )
+  {
+    if( this->m_ParameterMap.count( it->first ) == 0 )
+    {
+      ParameterMapInterface::ConvertNumericParameterToText( *it->second,
+        this->m_ParameterMap[ it->first ] );
+    }
+  }
+
   return this->m_ParameterMap;
 
 } // end GetParameterMap()
@@ -75,6 +92,61 @@ ParameterFileParser
 void
 ParameterFileParser
 ::ReadParameterFile( void )
+{
+  /** Read the complete file at once. */
+  std::string buffer;
+  this->ReadFileIntoBuffer( buffer );
+
+  /** Clear the maps. */
+  this->m_ParameterMap.clear();
+  this->m_NumericParameterMap.clear();
+
+  /** Replace tabs with spaces. */
+  std::replace( buffer.begin(), buffer.end(), '\t', ' ' );
+
+  /** Loop over the buffer, line by line. */
+  const char * current   = buffer.data();
+  const char * bufferEnd = current + buffer.size();
+  while( current < bufferEnd )
+  {
+    /** Extract a line, without the end-of-line characters. */
+    const char * lineBegin = current;
+    const char * lineEnd   = static_cast< const char * >(
+      std::memchr( lineBegin, '\n', bufferEnd - lineBegin ) );
+    if( lineEnd == nullptr )
+    {
+      lineEnd = bufferEnd;
+    }
+    current = lineEnd + 1;
+    if( lineEnd > lineBegin && *( lineEnd - 1 ) == '\r' )
+    {
+      --lineEnd;
+    }
+
+    /** Check this line. */
+    const char * begin = nullptr;
+    const char * end   = nullptr;
+    bool validLine = this->CheckLine( lineBegin, lineEnd, begin, end );
+
+    if( validLine )
+    {
+      /** Get the parameter name from this line and store it. */
+      this->GetParameterFromLine( lineBegin, lineEnd, begin, end );
+    }
+    // Otherwise, we simply ignore this line
+
+  }
+
+} // end ReadParameterFile()
+
+
+/**
+ * **************** ReadFileIntoBuffer ***************
+ */
+
+void
+ParameterFileParser
+::ReadFileIntoBuffer( std::string & buffer )
 {
   /** Perform some basic checks. */
   this->BasicFileChecking();
@@ -85,7 +157,8 @@ ParameterFileParser
     this->m_ParameterFile.clear();
     this->m_ParameterFile.close();
   }
-  this->m_ParameterFile.open( this->m_ParameterFileName.c_str(), std::fstream::in );
+  this->m_ParameterFile.open( this->m_ParameterFileName.c_str(),
+    std::fstream::in | std::fstream::binary );
 
   /** Check if it opened. */
   if( !this->m_ParameterFile.is_open() )
@@ -95,34 +168,22 @@ ParameterFileParser
                        << " for reading." );
   }
 
-  /** Clear the map. */
-  this->m_ParameterMap.clear();
-
-  /** Loop over the parameter file, line by line. */
-  std::string lineIn  = "";
-  std::string lineOut = "";
-  while( this->m_ParameterFile.good() )
+  /** Read the file with a single read operation. */
+  this->m_ParameterFile.seekg( 0, std::ios::end );
+  const std::streamoff fileSize = this->m_ParameterFile.tellg();
+  this->m_ParameterFile.seekg( 0, std::ios::beg );
+  buffer.resize( fileSize > 0 ? static_cast< std::size_t >( fileSize ) : 0 );
+  if( !buffer.empty() )
   {
-    /** Extract a line. */
-    itksys::SystemTools::GetLineFromStream( this->m_ParameterFile, lineIn );
-
-    /** Check this line. */
-    bool validLine = this->CheckLine( lineIn, lineOut );
-
-    if( validLine )
-    {
-      /** Get the parameter name from this line and store it. */
-      this->GetParameterFromLine( lineIn, lineOut );
-    }
-    // Otherwise, we simply ignore this line
-
+    this->m_ParameterFile.read( &buffer[ 0 ], buffer.size() );
+    buffer.resize( static_cast< std::size_t >( this->m_ParameterFile.gcount() ) );
   }
 
   /** Close the parameter file. */
   this->m_ParameterFile.clear();
   this->m_ParameterFile.close();
 
-} // end ReadParameterFile()
+} // end ReadFileIntoBuffer()
 
 
 /**
@@ -178,77 +239,73 @@ ParameterFileParser
 
 bool
 ParameterFileParser
-::CheckLine( const std::string & lineIn, std::string & lineOut ) const
+::CheckLine( const char * lineBegin, const char * lineEnd,
+  const char * & begin, const char * & end ) const
 {
-  /** Preprocessing of lineIn:
-   * 1) Replace tabs with spaces
-   * 2) Remove everything after comment sign //
-   * 3) Remove leading spaces
-   * 4) Remove trailing spaces
+  /** Preprocessing of the line (tabs have already been replaced):
+   * 1) Remove everything after comment sign //
+   * 2) Remove leading spaces
+   * 3) Remove trailing spaces
    */
-  lineOut = lineIn;
-  itksys::SystemTools::ReplaceString( lineOut, "\t", " " );
-
-  itksys::RegularExpression commentPart( "//" );
-  if( commentPart.find( lineOut ) )
+  begin = lineBegin;
+  end   = lineEnd;
+  for( const char * it = begin; it + 1 < end; ++it )
   {
-    lineOut = lineOut.substr( 0, commentPart.start() );
+    if( it[ 0 ] == '/' && it[ 1 ] == '/' )
+    {
+      end = it;
+      break;
+    }
   }
 
-  itksys::RegularExpression leadingSpaces( "^[ ]*(.*)" );
-  leadingSpaces.find( lineOut );
-  lineOut = leadingSpaces.match( 1 );
-
-  itksys::RegularExpression trailingSpaces( "[ \t]+$" );
-  if( trailingSpaces.find( lineOut ) )
+  while( begin < end && *begin == ' ' )
+  {
+    ++begin;
+  }
+  while( end > begin && *( end - 1 ) == ' ' )
   {
-    lineOut = lineOut.substr( 0, trailingSpaces.start() );
+    --end;
   }
 
   /**
    * Checks:
-   * 1. Empty line -> false
-   * 2. Comment (line starts with "//") -> false
-   * 3. Line is not between brackets (...) -> exception
-   * 4. Line contains less than two words -> exception
+   * 1. Empty line or comment -> false
+   * 2. Line is not between brackets (...) -> exception
+   * 3. Line contains less than two words -> exception
    *
    * Otherwise return true.
    */
 
-  /** 1. Check for non-empty lines. */
-  itksys::RegularExpression reNonEmptyLine( "[^ ]+" );
-  bool                      match1 = reNonEmptyLine.find( lineOut );
-  if( !match1 )
-  {
-    return false;
-  }
-
-  /** 2. Check for comments. */
-  itksys::RegularExpression reComment( "^//" );
-  bool                      match2 = reComment.find( lineOut );
-  if( match2 )
+  /** 1. Check for non-empty lines; comments have been removed already. */
+  if( begin == end )
   {
     return false;
   }
 
-  /** 3. Check if line is between brackets. */
-  if( !itksys::SystemTools::StringStartsWith( lineOut.c_str(), "(" )
-    || !itksys::SystemTools::StringEndsWith( lineOut.c_str(), ")" ) )
+  /** 2. Check if line is between brackets. */
+  if( *begin != '(' || *( end - 1 ) != ')' || end - begin < 2 )
   {
     std::string hint = "Line is not between brackets: \"(...)\".";
-    this->ThrowException( lineIn, hint );
+    this->ThrowException( std::string( lineBegin, lineEnd ), hint );
   }
 
   /** Remove brackets. */
-  lineOut = lineOut.substr( 1, lineOut.size() - 2 );
+  ++begin;
+  --end;
 
-  /** 4. Check: the line should contain at least two words. */
-  itksys::RegularExpression reTwoWords( "([ ]+)([^ ]+)" );
-  bool                      match4 = reTwoWords.find( lineOut );
-  if( !match4 )
+  /** 3. Check: the line should contain at least two words, i.e. a space
+   * that is followed by a non-space character.
+   */
+  const char * firstSpace = std::find( begin, end, ' ' );
+  const char * nextWord   = firstSpace;
+  while( nextWord < end && *nextWord == ' ' )
+  {
+    ++nextWord;
+  }
+  if( firstSpace == end || nextWord == end )
   {
     std::string hint = "Line does not contain a parameter name and value.";
-    this->ThrowException( lineIn, hint );
+    this->ThrowException( std::string( lineBegin, lineEnd ), hint );
   }
 
   /** At this point we know its at least a line containing a parameter.
@@ -268,72 +325,101 @@ ParameterFileParser
 
 void
 ParameterFileParser
-::GetParameterFromLine( const std::string & fullLine,
-  const std::string & line )
+::GetParameterFromLine( const char * lineBegin, const char * lineEnd,
+  const char * begin, const char * end )
 {
   /** A line has a parameter name followed by one or more parameters.
    * They are all separated by one or more spaces (all tabs have been
    * removed previously) or by quotes in case of strings. So,
    * 1) we split the line at the spaces or quotes
    * 2) the first one is the parameter name
-   * 3) the other strings that are not a series of spaces, are parameter values
+   * 3) the other tokens that are not empty, are parameter values
    */
 
   /** 1) Split the line. */
-  std::vector< std::string > splittedLine;
-  this->SplitLine( fullLine, line, splittedLine );
+  std::vector< TokenType > & splittedLine = this->m_SplittedLine;
+  this->SplitLine( lineBegin, lineEnd, begin, end, splittedLine );
 
-  /** 2) Get the parameter name. */
-  std::string parameterName = splittedLine[ 0 ];
-  itksys::SystemTools::ReplaceString( parameterName, " ", "" );
-  splittedLine.erase( splittedLine.begin() );
+  /** 2) Get the parameter name. The first token never contains a space. */
+  const std::string parameterName( splittedLine[ 0 ].first, splittedLine[ 0 ].second );
 
-  /** 3) Get the parameter values. */
-  std::vector< std::string > parameterValues;
-  for( unsigned int i = 0; i < splittedLine.size(); ++i )
+  /** 3) Get the parameter values: remove the empty tokens. */
+  std::size_t numberOfValues = 0;
+  bool        allNumbers     = true;
+  for( std::size_t i = 1; i < splittedLine.size(); ++i )
   {
-    if( splittedLine[ i ] != "" )
+    if( splittedLine[ i ].first != splittedLine[ i ].second )
     {
-      parameterValues.push_back( splittedLine[ i ] );
+      splittedLine[ numberOfValues++ ] = splittedLine[ i ];
+      allNumbers &= IsPlainNumber( splittedLine[ i ].first, splittedLine[ i ].second );
     }
   }
+  splittedLine.resize( numberOfValues );
 
-  /** 4) Perform some checks on the parameter name. */
-  itksys::RegularExpression reInvalidCharacters1( "[.,:;!@#$%^&-+|<>?]" );
-  bool                      match = reInvalidCharacters1.find( parameterName );
-  if( match )
+  /** 4) Perform some checks on the parameter name. The character set
+   * corresponds to the regular expression "[.,:;!@#$%^&-+|<>?]".
+   */
+  if( parameterName.find_first_of( ".,:;!@#$%^&'()*+|<>?" ) != std::string::npos )
   {
     std::string hint = "The parameter \""
       + parameterName
       + "\" contains invalid characters (.,:;!@#$%^&-+|<>?).";
-    this->ThrowException( fullLine, hint );
+    this->ThrowException( std::string( lineBegin, lineEnd ), hint );
   }
 
-  /** 5) Perform checks on the parameter values. */
-  itksys::RegularExpression reInvalidCharacters2( "[,;!@#$%&|<>?]" );
-  for( unsigned int i = 0; i < parameterValues.size(); ++i )
+  /** 5) Perform checks on the parameter values. Plain numbers can not
+   * contain any of the invalid characters.
+   */
+  if( !allNumbers )
   {
-    /** For all entries some characters are not allowed. */
-    if( reInvalidCharacters2.find( parameterValues[ i ] ) )
+    static const char invalidCharacters[] = ",;!@#$%&|<>?";
+    for( std::size_t i = 0; i < numberOfValues; ++i )
     {
-      std::string hint = "The parameter value \""
-        + parameterValues[ i ]
-        + "\" contains invalid characters (,;!@#$%&|<>?).";
-      this->ThrowException( fullLine, hint );
+      const char * invalid = std::find_first_of(
+        splittedLine[ i ].first, splittedLine[ i ].second,
+        invalidCharacters, invalidCharacters + sizeof( invalidCharacters ) - 1 );
+      if( invalid != splittedLine[ i ].second )
+      {
+        std::string hint = "The parameter value \""
+          + std::string( splittedLine[ i ].first, splittedLine[ i ].second )
+          + "\" contains invalid characters (,;!@#$%&|<>?).";
+        this->ThrowException( std::string( lineBegin, lineEnd ), hint );
+      }
     }
   }
 
   /** 6) Insert this combination in the parameter map. */
-  if( this->m_ParameterMap.count( parameterName ) )
+  if( this->m_ParameterMap.count( parameterName )
+    || this->m_NumericParameterMap.count( parameterName ) )
   {
     std::string hint = "The parameter \""
       + parameterName
       + "\" is specified more than once.";
-    this->ThrowException( fullLine, hint );
+    this->ThrowException( std::string( lineBegin, lineEnd ), hint );
+  }
+  else if( allNumbers && this->m_LargeParameterThreshold > 0
+    && numberOfValues >= this->m_LargeParameterThreshold )
+  {
+    /** Parse large numeric entries directly, without creating strings.
+     * The tokens are validated and always followed by a delimiter, so
+     * strtod consumes exactly one token.
+     */
+    std::shared_ptr< NumericParameterValuesType > values
+      = std::make_shared< NumericParameterValuesType >( numberOfValues );
+    for( std::size_t i = 0; i < numberOfValues; ++i )
+    {
+      ( *values )[ i ] = std::strtod( splittedLine[ i ].first, nullptr );
+    }
+    this->m_NumericParameterMap.insert( std::make_pair( parameterName, values ) );
   }
   else
   {
-    this->m_ParameterMap.insert( make_pair( parameterName, parameterValues ) );
+    ParameterValuesType parameterValues( numberOfValues );
+    for( std::size_t i = 0; i < numberOfValues; ++i )
+    {
+      parameterValues[ i ].assign( splittedLine[ i ].first, splittedLine[ i ].second );
+    }
+    this->m_ParameterMap.insert( std::make_pair( parameterName, parameterValues ) );
   }
 
 } // end GetParameterFromLine()
@@ -345,60 +431,101 @@ ParameterFileParser
 
 void
 ParameterFileParser
-::SplitLine( const std::string & fullLine, const std::string & line,
-  std::vector< std::string > & splittedLine ) const
+::SplitLine( const char * lineBegin, const char * lineEnd,
+  const char * begin, const char * end,
+  std::vector< TokenType > & splittedLine ) const
 {
   splittedLine.clear();
-  splittedLine.resize( 1 );
 
   /** Count the number of quotes in the line. If it is an odd value, the
    * line contains an error; strings should start and end with a quote, so
    * the total number of quotes is even.
    */
-  std::size_t numQuotes = itksys::SystemTools::CountChar( line.c_str(), '"' );
+  std::size_t numQuotes = std::count( begin, end, '"' );
   if( numQuotes % 2 == 1 )
   {
     /** An invalid parameter line. */
     std::string hint = "This line has an odd number of quotes (\").";
-    this->ThrowException( fullLine, hint );
+    this->ThrowException( std::string( lineBegin, lineEnd ), hint );
   }
 
-  /** Loop over the line. */
-  std::string::const_iterator it;
-  unsigned int                index = 0;
-  numQuotes = 0;
-  for( it = line.begin(); it < line.end(); ++it )
+  /** Loop over the line. A quote, or a space outside quotes, ends the
+   * current token and starts a new one. Tokens may be empty.
+   */
+  const char * tokenBegin = begin;
+  bool         inQuotes   = false;
+  for( const char * it = begin; it < end; ++it )
   {
-    if( *it == '"' )
-    {
-      /** Start a new element. */
-      splittedLine.push_back( "" );
-      index++;
-      numQuotes++;
-    }
-    else if( *it == ' ' )
+    if( *it == '"' || ( *it == ' ' && !inQuotes ) )
     {
-      /** Only start a new element if it is not a quote, otherwise just add
-       * the space to the string.
-       */
-      if( numQuotes % 2 == 0 )
+      splittedLine.push_back( TokenType( tokenBegin, it ) );
+      tokenBegin = it + 1;
+      if( *it == '"' )
       {
-        splittedLine.push_back( "" );
-        index++;
-      }
-      else
-      {
-        splittedLine[ index ].push_back( *it );
+        inQuotes = !inQuotes;
       }
     }
-    else
+  }
+  splittedLine.push_back( TokenType( tokenBegin, end ) );
+
+} // end SplitLine()
+
+
+/**
+ * **************** IsPlainNumber ***************
+ */
+
+bool
+ParameterFileParser
+::IsPlainNumber( const char * begin, const char * end )
+{
+  const char * it = begin;
+  if( it < end && ( *it == '-' || *it == '+' ) )
+  {
+    ++it;
+  }
+
+  /** Mantissa: digits, optionally with a decimal point. */
+  std::size_t numberOfDigits = 0;
+  while( it < end && *it >= '0' && *it <= '9' )
+  {
+    ++it; ++numberOfDigits;
+  }
+  if( it < end && *it == '.' )
+  {
+    ++it;
+    while( it < end && *it >= '0' && *it <= '9' )
     {
-      /** Add this character to the element. */
-      splittedLine[ index ].push_back( *it );
+      ++it; ++numberOfDigits;
     }
   }
+  if( numberOfDigits == 0 )
+  {
+    return false;
+  }
 
-} // end SplitLine()
+  /** Optional exponent. */
+  if( it < end && ( *it == 'e' || *it == 'E' ) )
+  {
+    ++it;
+    if( it < end && ( *it == '-' || *it == '+' ) )
+    {
+      ++it;
+    }
+    const char * exponentBegin = it;
+    while( it < end && *it >= '0' && *it <= '9' )
+    {
+      ++it;
+    }
+    if( it == exponentBegin )
+    {
+      return false;
+    }
+  }
+
+  return it == end;
+
+} // end IsPlainNumber()
 
 
 /**
@@ -431,40 +558,16 @@ std::string
 ParameterFileParser
 ::ReturnParameterFileAsString( void )
 {
-  /** Perform some basic checks. */
-  this->BasicFileChecking();
-
-  /** Open the parameter file for reading. */
-  if( this->m_ParameterFile.is_open() )
-  {
-    this->m_ParameterFile.clear();
-    this->m_ParameterFile.close();
-  }
-  this->m_ParameterFile.open( this->m_ParameterFileName.c_str(), std::fstream::in );
-
-  /** Check if it opened. */
-  if( !this->m_ParameterFile.is_open() )
-  {
-    itkExceptionMacro( << "ERROR: could not open "
-                       << this->m_ParameterFileName
-                       << " for reading." );
-  }
-
-  /** Loop over the parameter file, line by line. */
-  std::string line = "";
+  /** Read the complete file at once. */
   std::string output;
-  while( this->m_ParameterFile.good() )
-  {
-    /** Extract a line. */
-    itksys::SystemTools::GetLineFromStream( this->m_ParameterFile, line ); // \todo: returns bool
+  this->ReadFileIntoBuffer( output );
 
-    output += line + "\n";
+  /** Make sure the last line is terminated. */
+  if( !output.empty() && output[ output.size() - 1 ] != '\n' )
+  {
+    output += "\n";
   }
 
-  /** Close the parameter file. */
-  this->m_ParameterFile.clear();
-  this->m_ParameterFile.close();
-
   /** Return the string. */
   return output;
 
@@ -23,6 +23,7 @@
 #include "itkMacro.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <fstream>
@@ -51,6 +52,12 @@ namespace itk
  * The parameter file is read, and parameter name-value combinations are
  * stored in an std::map< std::string, std::vector<std:string> >, where the
  * string is the parameter name, and the vector of strings are the values.
+ * Large entries that only contain numbers, such as the TransformParameters
+ * of a B-spline transform, are parsed directly into a numeric buffer and
+ * only converted to strings when GetParameterMap() is called. See
+ * SetLargeParameterThreshold().
+ *
+ * The file is read at once and tokenized in a single pass.
  * Exceptions are raised in case:\n
  * - the parameter text file cannot be opened,\n
  * - rule 2 or 3 is not satisfied,\n
@@ -98,13 +105,49 @@ public:
     std::string,
     ParameterValuesType >                 ParameterMapType;
 
+  /** Typedefs for parameters that are kept as typed binary buffers instead
+   * of text, such as the TransformParameters. The buffers are shared, so
+   * copying a map does not copy the numbers.
+   */
+  typedef std::vector< double >                       NumericParameterValuesType;
+  typedef std::shared_ptr< const NumericParameterValuesType >
+    NumericParameterValuesPointer;
+  typedef std::map<
+    std::string,
+    NumericParameterValuesPointer >       NumericParameterMapType;
+
   /** Set the name of the file containing the parameters. */
   itkSetStringMacro( ParameterFileName );
   itkGetStringMacro( ParameterFileName );
 
-  /** Return the parameter map. */
+  /** Return the parameter map. Numeric entries are converted to text
+   * the first time this function is called.
+   */
   virtual const ParameterMapType & GetParameterMap( void ) const;
 
+  /** Return the text parameters, without converting the numeric entries.
+   * Use together with GetNumericParameterMap().
+   */
+  const ParameterMapType & GetTextParameterMap( void ) const
+  {
+    return this->m_ParameterMap;
+  }
+
+
+  /** Return the entries that are stored as numeric buffers. */
+  const NumericParameterMapType & GetNumericParameterMap( void ) const
+  {
+    return this->m_NumericParameterMap;
+  }
+
+
+  /** Entries with at least this many values, all of them plain numbers,
+   * are stored as numeric buffers instead of strings. A value of zero
+   * disables this. The default is 1024.
+   */
+  itkSetMacro( LargeParameterThreshold, std::size_t );
+  itkGetConstMacro( LargeParameterThreshold, std::size_t );
+
   /** Read the parameters in the parameter map. */
   void ReadParameterFile( void );
 
@@ -131,20 +174,34 @@ private:
    */
   void BasicFileChecking( void ) const;
 
-  /** Checks a line.
+  /** Reads the complete parameter file into a buffer. */
+  void ReadFileIntoBuffer( std::string & buffer );
+
+  /** A token of a line, referring to characters in the file buffer. */
+  typedef std::pair< const char *, const char * > TokenType;
+
+  /** Checks a line, given by [lineBegin, lineEnd).
    * - Returns  true if it is a valid line: containing a parameter.
+   *   In that case [begin, end) is set to the part between the brackets.
    * - Returns false if it is a valid line: empty or comment.
    * - Throws an exception if it is not a valid line.
    */
-  bool CheckLine( const std::string & line, std::string & lineOut ) const;
+  bool CheckLine( const char * lineBegin, const char * lineEnd,
+    const char * & begin, const char * & end ) const;
 
-  /** Fills m_ParameterMap with valid entries. */
-  void GetParameterFromLine( const std::string & fullLine,
-    const std::string & line );
+  /** Fills m_ParameterMap or m_NumericParameterMap with valid entries. */
+  void GetParameterFromLine( const char * lineBegin, const char * lineEnd,
+    const char * begin, const char * end );
 
   /** Splits a line in parameter name and values. */
-  void SplitLine( const std::string & fullLine, const std::string & line,
-    std::vector< std::string > & splittedLine ) const;
+  void SplitLine( const char * lineBegin, const char * lineEnd,
+    const char * begin, const char * end,
+    std::vector< TokenType > & splittedLine ) const;
+
+  /** Returns true if [begin, end) is a plain decimal number, like
+   * -1.5e-3, that can be parsed with strtod.
+   */
+  static bool IsPlainNumber( const char * begin, const char * end );
 
   /** Uniform way to throw exceptions when the parameter file appears to be
    * invalid.
@@ -152,9 +209,14 @@ private:
   void ThrowException( const std::string & line, const std::string & hint ) const;
 
   /** Member variables. */
-  std::string      m_ParameterFileName;
-  std::ifstream    m_ParameterFile;
-  ParameterMapType m_ParameterMap;
+  std::string              m_ParameterFileName;
+  std::ifstream            m_ParameterFile;
+  mutable ParameterMapType m_ParameterMap;
+  NumericParameterMapType  m_NumericParameterMap;
+  std::size_t              m_LargeParameterThreshold;
+
+  /** Reused between lines, to avoid reallocation. */
+  std::vector< TokenType > m_SplittedLine;
 
 };
 
@@ -18,6 +18,10 @@
 
 #include "itkParameterMapInterface.h"
 
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
 namespace itk
 {
 
@@ -29,6 +33,7 @@ ParameterMapInterface
 ::ParameterMapInterface()
 {
   this->m_ParameterMap.clear();
+  this->m_NumericParameterMap.clear();
   this->m_PrintErrorMessages = true;
 
 } // end Constructor()
@@ -61,6 +66,84 @@ ParameterMapInterface
 } // end SetParameterMap()
 
 
+/**
+ * **************** SetNumericParameterMap ***************
+ */
+
+void
+ParameterMapInterface
+::SetNumericParameterMap( const NumericParameterMapType & parMap )
+{
+  this->m_NumericParameterMap = parMap;
+
+} // end SetNumericParameterMap()
+
+
+/**
+ * **************** GetNumericParameterValues ***************
+ */
+
+ParameterMapInterface::NumericParameterValuesPointer
+ParameterMapInterface
+::GetNumericParameterValues( const std::string & parameterName ) const
+{
+  NumericParameterMapType::const_iterator it
+    = this->m_NumericParameterMap.find( parameterName );
+  if( it != this->m_NumericParameterMap.end() )
+  {
+    return it->second;
+  }
+  return NumericParameterValuesPointer();
+
+} // end GetNumericParameterValues()
+
+
+/**
+ * **************** ConvertNumericParametersToText ***************
+ */
+
+void
+ParameterMapInterface
+::ConvertNumericParametersToText(
+  const NumericParameterMapType & numericMap, ParameterMapType & textMap )
+{
+  NumericParameterMapType::const_iterator it = numericMap.begin();
+  for( ; it != numericMap.end(); ++it )
+  {
+    if( !it->second || textMap.count( it->first ) )
+    {
+      continue;
+    }
+
+    ConvertNumericParameterToText( *it->second, textMap[ it->first ] );
+  }
+
+} // end ConvertNumericParametersToText()
+
+
+/**
+ * **************** ConvertNumericParameterToText ***************
+ */
+
+void
+ParameterMapInterface
+::ConvertNumericParameterToText(
+  const ParameterFileParser::NumericParameterValuesType & numericValues,
+  ParameterValuesType & textValues )
+{
+  std::ostringstream tmpStream;
+  tmpStream << std::setprecision( std::numeric_limits< double >::max_digits10 );
+
+  textValues.resize( numericValues.size() );
+  for( std::size_t i = 0; i < numericValues.size(); ++i )
+  {
+    tmpStream.str( "" ); tmpStream << numericValues[ i ];
+    textValues[ i ] = tmpStream.str();
+  }
+
+} // end ConvertNumericParameterToText()
+
+
 /**
  * **************** CountNumberOfParameterEntries ***************
  */
@@ -74,6 +157,18 @@ ParameterMapInterface
   {
     return this->m_ParameterMap.find( parameterName )->second.size();
   }
+
+  /** Parameters that are only available as a numeric buffer are converted
+   * to text here, so that the ReadParameter() functions can use them.
+   */
+  NumericParameterValuesPointer numericValues
+    = this->GetNumericParameterValues( parameterName );
+  if( numericValues )
+  {
+    ConvertNumericParameterToText( *numericValues,
+      this->m_ParameterMap[ parameterName ] );
+    return numericValues->size();
+  }
   return 0;
 
 } // end CountNumberOfParameterEntries()
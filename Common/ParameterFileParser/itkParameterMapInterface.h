@@ -89,10 +89,39 @@ public:
   /** Typedefs. */
   typedef ParameterFileParser::ParameterValuesType ParameterValuesType;
   typedef ParameterFileParser::ParameterMapType    ParameterMapType;
+  typedef ParameterFileParser::NumericParameterValuesPointer
+    NumericParameterValuesPointer;
+  typedef ParameterFileParser::NumericParameterMapType
+    NumericParameterMapType;
 
   /** Set the parameter map. */
   void SetParameterMap( const ParameterMapType & parMap );
 
+  /** Set the numeric parameter map. This map holds parameters that are
+   * passed as typed binary buffers instead of strings. An entry in this map
+   * takes precedence over a text entry with the same name. The text API
+   * (CountNumberOfParameterEntries(), ReadParameter()) still sees these
+   * entries; they are converted to text on first access.
+   */
+  void SetNumericParameterMap( const NumericParameterMapType & parMap );
+
+  /** Get the numeric buffer of a parameter, or a null pointer when the
+   * parameter is not available as a numeric buffer.
+   */
+  NumericParameterValuesPointer GetNumericParameterValues(
+    const std::string & parameterName ) const;
+
+  /** Add the numeric parameters to a text parameter map, converting the
+   * values to strings. Entries already present in the text map are kept.
+   * The values are written with enough digits to be read back exactly.
+   */
+  static void ConvertNumericParametersToText(
+    const NumericParameterMapType & numericMap, ParameterMapType & textMap );
+
+  static void ConvertNumericParameterToText(
+    const ParameterFileParser::NumericParameterValuesType & numericValues,
+    ParameterValuesType & textValues );
+
   /** Option to print error and warning messages to a stream.
    * The default is true. If set to false no messages are printed.
    */
@@ -395,7 +424,9 @@ private:
   void operator=( const Self & );        // purposely not implemented
 
   /** Member variable to store the parameters. */
-  ParameterMapType m_ParameterMap;
+  /** Mutable, since numeric entries are converted to text on demand. */
+  mutable ParameterMapType m_ParameterMap;
+  NumericParameterMapType  m_NumericParameterMap;
 
   bool m_PrintErrorMessages;
 
@@ -335,6 +335,14 @@ protected:
   /** Destructor. */
   ~AdvancedCombinationTransform() override{}
 
+  /** Clone the combination for use in another thread. The result is always a
+   * plain AdvancedCombinationTransform, also when called on a derived class.
+   * The initial transform is shared, since it is not changed during a
+   * registration, while the current transform is cloned, so that the clone
+   * can be given other parameters than this transform.
+   */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** Declaration of members. */
   InitialTransformPointer m_InitialTransform;
   CurrentTransformPointer m_CurrentTransform;
@@ -64,6 +64,37 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end Constructor
 
 
+/**
+ * ************************ InternalClone *************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+LightObject::Pointer
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  clone->SetUseComposition( this->m_UseComposition );
+  clone->SetInitialTransform( this->m_InitialTransform.GetPointer() );
+
+  if( this->m_CurrentTransform.IsNotNull() )
+  {
+    typename Superclass::Superclass::Pointer currentClone = this->m_CurrentTransform->Clone();
+    CurrentTransformType * advancedCurrentClone
+      = dynamic_cast< CurrentTransformType * >( currentClone.GetPointer() );
+    if( advancedCurrentClone == nullptr )
+    {
+      itkExceptionMacro( << "Cloning the current transform failed." );
+    }
+    clone->SetCurrentTransform( advancedCurrentClone );
+  }
+
+  LightObject::Pointer loPtr = clone.GetPointer();
+  return loPtr;
+
+} // end InternalClone()
+
+
 /**
  *
  * ***********************************************************
@@ -152,6 +152,9 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Clone the transform, including the order of the computation. */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** Set values of angles directly without recomputing other parameters. */
   void SetVarRotation( ScalarType angleX, ScalarType angleY, ScalarType angleZ );
 
@@ -403,6 +403,26 @@ AdvancedEuler3DTransform< TScalarType >::PrintSelf( std::ostream & os, Indent in
 }
 
 
+// Clone
+template< class TScalarType >
+LightObject::Pointer
+AdvancedEuler3DTransform< TScalarType >::InternalClone( void ) const
+{
+  LightObject::Pointer loPtr = Superclass::InternalClone();
+  Self *               clone = dynamic_cast< Self * >( loPtr.GetPointer() );
+  if( clone == nullptr )
+  {
+    itkExceptionMacro( << "Downcast to type " << this->GetNameOfClass() << " failed." );
+  }
+
+  // The order of the computation is not part of the (fixed) parameters.
+  clone->SetComputeZYX( this->m_ComputeZYX );
+  clone->SetParameters( this->GetParameters() );
+
+  return loPtr;
+}
+
+
 } // namespace
 
 #endif
@@ -25,6 +25,7 @@
 #include "itkSpatialObject.h"
 #include "itkImageGridSampler.h"
 #include "itkImageFullSampler.h"
+#include "itkImageRandomSampler.h"
 
 #include "vnl/vnl_vector_fixed.h"
 #include "vnl/vnl_matrix_fixed.h"
@@ -175,6 +176,14 @@ public:
    * moments are computed in physical coordinates. */
   MatrixType GetCentralMoments() const;
 
+  /** Return the estimated standard error of the center of gravity, in
+   * physical coordinates, per dimension. It is computed from the voxels that
+   * the center of gravity is computed from, as if they were drawn
+   * independently. No finite-population correction is applied, so the
+   * estimate is not zero when all voxels are used.
+   */
+  VectorType GetCenterOfGravityStandardError() const;
+
   /** Return principal moments, in physical coordinates.
    * This method returns the principal moments of the image whose
    * moments were last computed by this object.  The moments are
@@ -225,6 +234,9 @@ public:
     ::ImageSampleContainerType                   ImageSampleContainerType;
   typedef typename ImageSampleContainerType::Pointer ImageSampleContainerPointer;
 
+  typedef itk::ImageRandomSampler< ImageType >     ImageRandomSamplerType;
+  typedef typename ImageRandomSamplerType::Pointer ImageRandomSamplerPointer;
+
   virtual void SampleImage(ImageSampleContainerPointer & sampleContainer);
 
   typedef itk::BinaryThresholdImageFilter < TImage, TImage >             BinaryThresholdImageFilterType;
@@ -235,6 +247,11 @@ public:
   itkSetMacro( LowerThresholdForCenterGravity, InputPixelType );
   itkSetMacro( CenterOfGravityUsesLowerThreshold, bool );
 
+  /** Use a random subsample of the image instead of a regular grid. */
+  itkSetMacro( UseRandomSampling, bool );
+  itkGetConstMacro( UseRandomSampling, bool );
+  itkGetConstMacro( NumberOfSamplesForCenteredTransformInitialization, SizeValueType );
+
 protected:
   AdvancedImageMomentsCalculator();
   ~AdvancedImageMomentsCalculator() override;
@@ -257,6 +274,11 @@ protected:
   /** Initialize some multi-threading related parameters. */
   virtual void InitializeThreadingParameters(void);
 
+  /** Compute m_CgError from the sums of the squared values w^2, w^2 x and
+   * w^2 x^2 over the counted voxels. Requires m_M0 and m_Cg. */
+  void ComputeCenterOfGravityStandardError(const ScalarType W2, const VectorType & W2X,
+    const VectorType & W2XX, const SizeValueType numberOfPixelsCounted);
+
   /** To give the threads access to all member variables and functions. */
   struct MultiThreaderParameterType
   {
@@ -272,6 +294,9 @@ protected:
     MatrixType st_M2;                   // Second moments about origin for threading
     VectorType st_Cg;                   // Center of gravity (physical units) for threading
     MatrixType st_Cm;                   // Second central moments (physical) for threading
+    ScalarType st_W2;                   // Sum of squared values, for the standard error
+    VectorType st_W2X;                  // Sum of squared values times position
+    VectorType st_W2XX;                 // Sum of squared values times squared position
     SizeValueType st_NumberOfPixelsCounted;
   };
   itkPadStruct(ITK_CACHE_LINE_ALIGNMENT, ComputePerThreadStruct,
@@ -289,6 +314,7 @@ protected:
   SizeValueType  m_NumberOfSamplesForCenteredTransformInitialization;
   InputPixelType m_LowerThresholdForCenterGravity;
   bool           m_CenterOfGravityUsesLowerThreshold;
+  bool           m_UseRandomSampling;
   ImageSampleContainerPointer m_SampleContainer;
 
 private:
@@ -300,6 +326,7 @@ private:
   VectorType m_M1;                   // First moments about origin
   MatrixType m_M2;                   // Second moments about origin
   VectorType m_Cg;                   // Center of gravity (physical units)
+  VectorType m_CgError;              // Standard error of the center of gravity
   MatrixType m_Cm;                   // Second central moments (physical)
   VectorType m_Pm;                   // Principal moments (physical)
   MatrixType m_Pa;                   // Principal axes (physical)
@@ -24,6 +24,8 @@
 #include "vnl/algo/vnl_symmetric_eigensystem.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 
+#include <algorithm>
+
 namespace itk
 {
 class InvalidImageMomentsError:public ExceptionObject
@@ -60,6 +62,7 @@ AdvancedImageMomentsCalculator< TImage >::AdvancedImageMomentsCalculator(void)
   m_M1.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
   m_M2.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
   m_Cg.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
+  m_CgError.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
   m_Cm.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
   m_Pm.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
   m_Pa.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
@@ -75,6 +78,7 @@ AdvancedImageMomentsCalculator< TImage >::AdvancedImageMomentsCalculator(void)
   this->m_ComputePerThreadVariables = nullptr;
   this->m_ComputePerThreadVariablesSize = 0;
   this->m_CenterOfGravityUsesLowerThreshold = false;
+  this->m_UseRandomSampling = false;
   this->m_NumberOfSamplesForCenteredTransformInitialization = 10000;
   this->m_LowerThresholdForCenterGravity = 500;
 }
@@ -124,6 +128,9 @@ AdvancedImageMomentsCalculator< TImage >
     this->m_ComputePerThreadVariables[i].st_M2.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
     this->m_ComputePerThreadVariables[i].st_Cg = NumericTraits< typename VectorType::ValueType >::Zero;
     this->m_ComputePerThreadVariables[i].st_Cm.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
+    this->m_ComputePerThreadVariables[i].st_W2 = NumericTraits< ScalarType >::Zero;
+    this->m_ComputePerThreadVariables[i].st_W2X.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
+    this->m_ComputePerThreadVariables[i].st_W2XX.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
     this->m_ComputePerThreadVariables[i].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
   }
 
@@ -136,23 +143,12 @@ void
 AdvancedImageMomentsCalculator< TImage >
 ::ComputeSingleThreaded()
 {
-  if ( this->m_CenterOfGravityUsesLowerThreshold )
-  {
-    typename BinaryThresholdImageFilterType::Pointer thresholdFilter
-      = BinaryThresholdImageFilterType::New();
-    thresholdFilter->SetInput(this->m_Image);
-    thresholdFilter->SetLowerThreshold(this->m_LowerThresholdForCenterGravity);
-    thresholdFilter->SetInsideValue(1);
-    thresholdFilter->SetOutsideValue(0);
-    thresholdFilter->Update();
-    this->SetImage(thresholdFilter->GetOutput());
-  }
-
   m_M0 = NumericTraits< ScalarType >::ZeroValue();
   m_M1.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
   m_M2.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
   m_Cg.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
   m_Cm.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
+  m_CgError.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
 
   typedef typename ImageType::IndexType IndexType;
 
@@ -161,6 +157,12 @@ AdvancedImageMomentsCalculator< TImage >
     return;
     }
 
+  ScalarType    W2 = 0;
+  VectorType    W2X,W2XX;
+  SizeValueType numberOfPixelsCounted = 0;
+  W2X.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
+  W2XX.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
+
   ImageRegionConstIteratorWithIndex< ImageType > it( m_Image,
                                                      m_Image->GetRequestedRegion() );
 
@@ -168,6 +170,12 @@ AdvancedImageMomentsCalculator< TImage >
     {
     double value = it.Value();
 
+    /** Threshold on the fly, instead of creating a thresholded image. */
+    if ( this->m_CenterOfGravityUsesLowerThreshold )
+      {
+      value = ( it.Value() >= this->m_LowerThresholdForCenterGravity ) ? 1.0 : 0.0;
+      }
+
     IndexType indexPosition = it.GetIndex();
 
     Point< double, ImageDimension > physicalPosition;
@@ -177,6 +185,8 @@ AdvancedImageMomentsCalculator< TImage >
          || m_SpatialObjectMask->IsInsideInWorldSpace(physicalPosition) )
       {
       m_M0 += value;
+      W2 += value * value;
+      ++numberOfPixelsCounted;
 
       for ( unsigned int i = 0; i < ImageDimension; i++ )
         {
@@ -192,6 +202,8 @@ AdvancedImageMomentsCalculator< TImage >
       for ( unsigned int i = 0; i < ImageDimension; i++ )
         {
         m_Cg[i] += physicalPosition[i] * value;
+        W2X[i] += value * value * physicalPosition[i];
+        W2XX[i] += value * value * physicalPosition[i] * physicalPosition[i];
         for ( unsigned int j = 0; j < ImageDimension; j++ )
           {
           double weight = value * physicalPosition[i] * physicalPosition[j];
@@ -232,6 +244,8 @@ AdvancedImageMomentsCalculator< TImage >
       }
     }
 
+  this->ComputeCenterOfGravityStandardError(W2, W2X, W2XX, numberOfPixelsCounted);
+
   // Compute principal moments and axes
   vnl_symmetric_eigensystem< double > eigen( m_Cm.GetVnlMatrix() );
   vnl_diag_matrix< double >           pm = eigen.D;
@@ -301,26 +315,16 @@ AdvancedImageMomentsCalculator< TImage >
   m_M2.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
   m_Cg.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
   m_Cm.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
-
-  typedef typename ImageType::IndexType IndexType;
+  m_CgError.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
 
   if (!m_Image)
   {
     return;
   }
 
-  if ( this->m_CenterOfGravityUsesLowerThreshold )
-  {
-    typename BinaryThresholdImageFilterType::Pointer thresholdFilter
-      = BinaryThresholdImageFilterType::New();
-    thresholdFilter->SetInput(this->m_Image);
-    thresholdFilter->SetLowerThreshold(this->m_LowerThresholdForCenterGravity);
-    thresholdFilter->SetInsideValue(1);
-    thresholdFilter->SetOutsideValue(0);
-    thresholdFilter->Update();
-    this->SetImage(thresholdFilter->GetOutput());
-  }
-
+  /** The lower threshold is applied to the samples in ThreadedCompute(),
+   * so that no thresholded copy of the full image is needed.
+   */
   this->SampleImage(this->m_SampleContainer);
 } // end BeforeThreadedCompute()
 
@@ -386,6 +390,10 @@ AdvancedImageMomentsCalculator< TImage >
   MatrixType M2,Cm;
   M2.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
   Cm.Fill(NumericTraits< typename MatrixType::ValueType >::ZeroValue());
+  ScalarType W2 = 0;
+  VectorType W2X,W2XX;
+  W2X.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
+  W2XX.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
   unsigned long  numberOfPixelsCounted = 0;
 
   /** Get sample container size, number of threads, and output space dimension. */
@@ -416,14 +424,22 @@ AdvancedImageMomentsCalculator< TImage >
     //IndexType indexPosition = (*threader_fiter).GetIndex();
     Point< double, ImageDimension > physicalPosition = (*threader_fiter).Value().m_ImageCoordinates;
 
+    if (this->m_CenterOfGravityUsesLowerThreshold)
+    {
+      value = (value >= this->m_LowerThresholdForCenterGravity) ? 1.0 : 0.0;
+    }
+
     if (m_SpatialObjectMask.IsNull()
       || m_SpatialObjectMask->IsInsideInWorldSpace(physicalPosition))
     {
       M0 += value;
+      W2 += value * value;
 
       for (unsigned int i = 0; i < ImageDimension; i++)
       {
         Cg[i] += physicalPosition[i] * value;
+        W2X[i] += value * value * physicalPosition[i];
+        W2XX[i] += value * value * physicalPosition[i] * physicalPosition[i];
         for (unsigned int j = 0; j < ImageDimension; j++)
         {
           double weight = value * physicalPosition[i] * physicalPosition[j];
@@ -439,6 +455,9 @@ AdvancedImageMomentsCalculator< TImage >
   this->m_ComputePerThreadVariables[threadId].st_M2 = M2;
   this->m_ComputePerThreadVariables[threadId].st_Cg = Cg;
   this->m_ComputePerThreadVariables[threadId].st_Cm = Cm;
+  this->m_ComputePerThreadVariables[threadId].st_W2 = W2;
+  this->m_ComputePerThreadVariables[threadId].st_W2X = W2X;
+  this->m_ComputePerThreadVariables[threadId].st_W2XX = W2XX;
   this->m_ComputePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
 
 }// end ThreadedCompute()
@@ -453,16 +472,30 @@ AdvancedImageMomentsCalculator< TImage >
 ::AfterThreadedCompute()
 {
   const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+  ScalarType    W2 = 0;
+  VectorType    W2X,W2XX;
+  SizeValueType numberOfPixelsCounted = 0;
+  W2X.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
+  W2XX.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
+
   /** Accumulate thread results. */
   for (ThreadIdType k = 0; k < numberOfThreads; ++k)
   {
     this->m_M0 += this->m_ComputePerThreadVariables[k].st_M0;
+    W2 += this->m_ComputePerThreadVariables[k].st_W2;
+    numberOfPixelsCounted += this->m_ComputePerThreadVariables[k].st_NumberOfPixelsCounted;
+    this->m_ComputePerThreadVariables[k].st_W2 = 0;
+    this->m_ComputePerThreadVariables[k].st_NumberOfPixelsCounted = 0;
     for (unsigned int i = 0; i < ImageDimension; ++i)
     {
       this->m_M1[i] += this->m_ComputePerThreadVariables[k].st_M1[i];
       this->m_Cg[i] += this->m_ComputePerThreadVariables[k].st_Cg[i];
+      W2X[i] += this->m_ComputePerThreadVariables[k].st_W2X[i];
+      W2XX[i] += this->m_ComputePerThreadVariables[k].st_W2XX[i];
       this->m_ComputePerThreadVariables[k].st_M1[i] = 0;
       this->m_ComputePerThreadVariables[k].st_Cg[i] = 0;
+      this->m_ComputePerThreadVariables[k].st_W2X[i] = 0;
+      this->m_ComputePerThreadVariables[k].st_W2XX[i] = 0;
       for (unsigned int j = 0; j < ImageDimension; ++j)
       {
         this->m_M2[i][j] += this->m_ComputePerThreadVariables[k].st_M2[i][j];
@@ -503,6 +536,8 @@ AdvancedImageMomentsCalculator< TImage >
     }
   }
 
+  this->ComputeCenterOfGravityStandardError(W2, W2X, W2XX, numberOfPixelsCounted);
+
   // Compute principal moments and axes
   vnl_symmetric_eigensystem< double > eigen(m_Cm.GetVnlMatrix());
   vnl_diag_matrix< double >           pm = eigen.D;
@@ -584,6 +619,44 @@ AdvancedImageMomentsCalculator< TImage >::GetCenterOfGravity() const
   return m_Cg;
 }
 
+//--------------------------------------------------------------------
+// Estimate the standard error of the center of gravity, which is a ratio
+// estimator sum( w x ) / sum( w ) over the samples:
+// var( Cg ) = n / ( n - 1 ) * sum( w^2 ( x - Cg )^2 ) / sum( w )^2
+template< typename TImage >
+void
+AdvancedImageMomentsCalculator< TImage >
+::ComputeCenterOfGravityStandardError(const ScalarType W2, const VectorType & W2X,
+  const VectorType & W2XX, const SizeValueType numberOfPixelsCounted)
+{
+  m_CgError.Fill(NumericTraits< typename VectorType::ValueType >::ZeroValue());
+  if (numberOfPixelsCounted < 2)
+  {
+    return;
+  }
+
+  const double n = static_cast< double >(numberOfPixelsCounted);
+  for (unsigned int i = 0; i < ImageDimension; i++)
+  {
+    const double sumOfSquares = W2XX[i] - 2.0 * m_Cg[i] * W2X[i] + m_Cg[i] * m_Cg[i] * W2;
+    const double variance = n / (n - 1.0) * sumOfSquares / (m_M0 * m_M0);
+    m_CgError[i] = std::sqrt(std::max(variance, 0.0));
+  }
+}
+
+//--------------------------------------------------------------------
+// Get the standard error of the center of gravity, in physical coordinates
+template< typename TImage >
+typename AdvancedImageMomentsCalculator< TImage >::VectorType
+AdvancedImageMomentsCalculator< TImage >::GetCenterOfGravityStandardError() const
+{
+  if ( !m_Valid )
+    {
+    itkExceptionMacro(<< "GetCenterOfGravityStandardError() invoked, but the moments have not been computed. Call Compute() first.");
+    }
+  return m_CgError;
+}
+
 //--------------------------------------------------------------------
 // Get second central moments, in physical coordinates
 template< typename TImage >
@@ -684,6 +757,25 @@ void
 AdvancedImageMomentsCalculator< TInputImage >
 ::SampleImage( ImageSampleContainerPointer & sampleContainer )
 {
+  /** Draw a random subsample of the image, if desired. */
+  if (this->m_UseRandomSampling)
+  {
+    ImageRandomSamplerPointer randomSampler = ImageRandomSamplerType::New();
+    randomSampler->SetInput(this->m_Image);
+    randomSampler->SetInputImageRegion(this->m_Image->GetRequestedRegion());
+    randomSampler->SetNumberOfSamples(this->m_NumberOfSamplesForCenteredTransformInitialization);
+    randomSampler->Update();
+    sampleContainer = randomSampler->GetOutput();
+
+    if (sampleContainer->Size() == 0)
+    {
+      itkExceptionMacro(
+        << "No valid voxels (0/" << this->m_NumberOfSamplesForCenteredTransformInitialization
+        << ") found to estimate the AutomaticTransformInitialization parameters.");
+    }
+    return;
+  }
+
   /** Set up grid sampler. */
   ImageGridSamplerPointer sampler = ImageGridSamplerType::New();
   //  ImageFullSamplerPointer sampler = ImageFullSamplerType::New();
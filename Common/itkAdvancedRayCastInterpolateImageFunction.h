@@ -46,7 +46,17 @@ namespace itk
  *
  * AdvancedRayCastInterpolateImageFunction casts rays through a 3-dimensional
  * image and uses bilinear interpolation to integrate each plane of
- * voxels traversed.
+ * voxels traversed. Alternatively, a Siddon-style traversal can be selected,
+ * which incrementally visits every voxel cut by the ray and weights its
+ * intensity by the intersection length. Both integrate over the same part of
+ * the ray and return intensity x mm; they differ only in the interpolation
+ * (bilinear versus nearest voxel).
+ *
+ * Evaluate() is thread-safe, so a DRR can be generated in parallel, for
+ * example with the multi-threaded ResampleImageFilter. When many rays are
+ * cast with the same transform, call PrecomputeRayCastGeometry() once before
+ * generating the DRR. This caches the transformed focal point and the
+ * bounding planes of the volume, which otherwise are recomputed for every ray.
  *
  * \warning This interpolator works for 3-dimensional images only.
  *
@@ -118,6 +128,17 @@ public:
   /** ContinuousIndex typedef support. */
   typedef typename Superclass::ContinuousIndexType ContinuousIndexType;
 
+  /** The geometry of the volume that is shared by all rays: the number of
+   * voxels, the voxel size, and the bounding planes and corners of the volume.
+   */
+  struct RayCastGeometryType
+  {
+    int    st_NumberOfVoxels[ 3 ];
+    double st_VoxelDimension[ 3 ];
+    double st_BoundingPlane[ 6 ][ 4 ];
+    double st_BoundingCorner[ 8 ][ 3 ];
+  };
+
   /** \brief
    * Interpolate the image at a point position.
    *
@@ -164,6 +185,27 @@ public:
   /** Get a pointer to the Transform.  */
   itkGetConstMacro( Threshold, double );
 
+  /** Select the Siddon-style voxel traversal instead of the default
+   * plane-by-plane bilinear interpolation. Default: false. */
+  itkSetMacro( UseSiddonRayTraversal, bool );
+  itkGetConstMacro( UseSiddonRayTraversal, bool );
+  itkBooleanMacro( UseSiddonRayTraversal );
+
+  /** Precompute the transformed focal point and the volume geometry, which
+   * are shared by all rays. Call this method (single-threaded) every time
+   * the transform parameters or the input image change, before generating a
+   * new DRR. Evaluate() only uses the precomputed values as long as the
+   * input image and the transform are not modified afterwards.
+   */
+  virtual void PrecomputeRayCastGeometry( void );
+
+  /** Discard the precomputed values, so that Evaluate() computes the ray
+   * geometry per ray again. */
+  virtual void ResetRayCastGeometry( void );
+
+  /** Returns true if the precomputed ray geometry can be used. */
+  bool GetRayCastGeometryIsValid( void ) const;
+
   /** Check if a point is inside the image buffer.
    * \warning For efficiency, no validity checking of
    * the input image pointer is done. */
@@ -208,6 +250,17 @@ protected:
   /// Pointer to the interpolator
   InterpolatorPointer m_Interpolator;
 
+  /// Use the Siddon-style traversal instead of the bilinear plane traversal.
+  bool m_UseSiddonRayTraversal;
+
+  /// The precomputed focal point and volume geometry, see PrecomputeRayCastGeometry().
+  bool                   m_RayCastGeometryIsPrecomputed;
+  OutputPointType        m_TransformedFocalPoint;
+  RayCastGeometryType    m_RayCastGeometry;
+  const InputImageType * m_RayCastGeometryImage;
+  ModifiedTimeType       m_RayCastGeometryImageMTime;
+  ModifiedTimeType       m_RayCastGeometryTransformMTime;
+
 private:
 
   AdvancedRayCastInterpolateImageFunction( const Self & ); // purposely not implemented
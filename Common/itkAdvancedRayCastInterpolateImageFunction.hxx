@@ -38,6 +38,8 @@ PURPOSE.  See the above copyright notices for more information.
 
 #include "vnl/vnl_math.h"
 
+#include <algorithm>
+
 // Put the helper class in an anonymous namespace so that it is not
 // exposed to the user
 namespace
@@ -75,6 +77,9 @@ public:
   typedef typename InputImageType::PixelType PixelType;
   typedef typename InputImageType::IndexType IndexType;
 
+  typedef typename itk::AdvancedRayCastInterpolateImageFunction<
+    TInputImage, TCoordRep >::RayCastGeometryType RayCastGeometryType;
+
   /**
    * Set the image class
    */
@@ -94,6 +99,17 @@ public:
    */
   bool SetRay( OutputPointType RayPosn, DirectionType RayDirn );
 
+  /**
+   *  Only compute where the ray enters and leaves the volume. This is all
+   *  that is needed by IntegrateAboveThresholdSiddon().
+   *
+   *  \param RayPosn       The position of the ray in 3D (mm).
+   *  \param RayDirn       The direction of the ray in 3D (mm).
+   *
+   *  \return True if this is a valid ray.
+   */
+  bool SetRayIntercepts( OutputPointType RayPosn, DirectionType RayDirn );
+
   /** \brief
    *  Integrate the interpolated intensities along the ray and
    *  return the result.
@@ -129,6 +145,23 @@ public:
    */
   bool IntegrateAboveThreshold( double & integral, double threshold );
 
+  /** \brief
+   * Integrate the voxel intensities above a given threshold along the ray,
+   * using a Siddon-style incremental traversal: every voxel cut by the ray
+   * contributes its intensity weighted by the intersection length in mm.
+   * Like IntegrateAboveThreshold(), it integrates over the part of the ray
+   * between the centres of the outer voxels, so both give the integral in
+   * intensity x mm, and they agree for a constant volume.
+   *
+   * This routine can be called after SetRayIntercepts() or SetRay().
+   *
+   * \param integral      The integrated intensities along the ray.
+   * \param threshold     The integration threshold
+   *
+   * \return True if a valid ray was specified.
+   */
+  bool IntegrateAboveThresholdSiddon( double & integral, double threshold );
+
   /** \brief
    * Increment each of the intensities of the 4 planar voxels
    * surrounding the current ray point.
@@ -167,6 +200,12 @@ public:
   /// Initialise the object
   void Initialise( void );
 
+  /// Initialise the object from a geometry that was computed before
+  void Initialise( const RayCastGeometryType & geometry );
+
+  /// Copy the geometry of the volume, as computed by Initialise()
+  void GetGeometry( RayCastGeometryType & geometry ) const;
+
 protected:
 
   /// Calculate the endpoint coordinats of the ray in voxels.
@@ -349,6 +388,54 @@ RayCastHelper< TInputImage, TCoordRep >
 }
 
 
+/* -----------------------------------------------------------------------
+   Initialise() - Initialise the object from a precomputed geometry
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+RayCastHelper< TInputImage, TCoordRep >
+::Initialise( const RayCastGeometryType & geometry )
+{
+  m_NumberOfVoxelsInX = geometry.st_NumberOfVoxels[ 0 ];
+  m_NumberOfVoxelsInY = geometry.st_NumberOfVoxels[ 1 ];
+  m_NumberOfVoxelsInZ = geometry.st_NumberOfVoxels[ 2 ];
+
+  m_VoxelDimensionInX = geometry.st_VoxelDimension[ 0 ];
+  m_VoxelDimensionInY = geometry.st_VoxelDimension[ 1 ];
+  m_VoxelDimensionInZ = geometry.st_VoxelDimension[ 2 ];
+
+  std::copy( &geometry.st_BoundingPlane[ 0 ][ 0 ],
+    &geometry.st_BoundingPlane[ 0 ][ 0 ] + 6 * 4, &m_BoundingPlane[ 0 ][ 0 ] );
+  std::copy( &geometry.st_BoundingCorner[ 0 ][ 0 ],
+    &geometry.st_BoundingCorner[ 0 ][ 0 ] + 8 * 3, &m_BoundingCorner[ 0 ][ 0 ] );
+}
+
+
+/* -----------------------------------------------------------------------
+   GetGeometry() - Copy the geometry of the volume
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+RayCastHelper< TInputImage, TCoordRep >
+::GetGeometry( RayCastGeometryType & geometry ) const
+{
+  geometry.st_NumberOfVoxels[ 0 ] = m_NumberOfVoxelsInX;
+  geometry.st_NumberOfVoxels[ 1 ] = m_NumberOfVoxelsInY;
+  geometry.st_NumberOfVoxels[ 2 ] = m_NumberOfVoxelsInZ;
+
+  geometry.st_VoxelDimension[ 0 ] = m_VoxelDimensionInX;
+  geometry.st_VoxelDimension[ 1 ] = m_VoxelDimensionInY;
+  geometry.st_VoxelDimension[ 2 ] = m_VoxelDimensionInZ;
+
+  std::copy( &m_BoundingPlane[ 0 ][ 0 ],
+    &m_BoundingPlane[ 0 ][ 0 ] + 6 * 4, &geometry.st_BoundingPlane[ 0 ][ 0 ] );
+  std::copy( &m_BoundingCorner[ 0 ][ 0 ],
+    &m_BoundingCorner[ 0 ][ 0 ] + 8 * 3, &geometry.st_BoundingCorner[ 0 ][ 0 ] );
+}
+
+
 /* -----------------------------------------------------------------------
    RecordVolumeDimensions() - Record volume dimensions and resolution
    ----------------------------------------------------------------------- */
@@ -727,36 +814,9 @@ bool
 RayCastHelper< TInputImage, TCoordRep >
 ::SetRay( OutputPointType RayPosn, DirectionType RayDirn )
 {
-
-  // Store the position and direction of the ray
-  typename TInputImage::SpacingType spacing = this->m_Image->GetSpacing();
-  SizeType dim = this->m_Image->GetLargestPossibleRegion().GetSize();
-
-  // we need to translate the _center_ of the volume to the origin
-  m_NumberOfVoxelsInX = dim[ 0 ];
-  m_NumberOfVoxelsInY = dim[ 1 ];
-  m_NumberOfVoxelsInZ = dim[ 2 ];
-
-  m_VoxelDimensionInX = spacing[ 0 ];
-  m_VoxelDimensionInY = spacing[ 1 ];
-  m_VoxelDimensionInZ = spacing[ 2 ];
-
-  m_CurrentRayPositionInMM[ 0 ]
-    = RayPosn[ 0 ] + 0.5 * m_VoxelDimensionInX * (double)m_NumberOfVoxelsInX;
-
-  m_CurrentRayPositionInMM[ 1 ]
-    = RayPosn[ 1 ] + 0.5 * m_VoxelDimensionInY * (double)m_NumberOfVoxelsInY;
-
-  m_CurrentRayPositionInMM[ 2 ]
-    = RayPosn[ 2 ] + 0.5 * m_VoxelDimensionInZ * (double)m_NumberOfVoxelsInZ;
-
-  m_RayDirectionInMM[ 0 ] = RayDirn[ 0 ];
-  m_RayDirectionInMM[ 1 ] = RayDirn[ 1 ];
-  m_RayDirectionInMM[ 2 ] = RayDirn[ 2 ];
-
   // Compute the ray path for this coordinate in mm
 
-  m_ValidRay = this->CalcRayIntercepts();
+  m_ValidRay = this->SetRayIntercepts( RayPosn, RayDirn );
 
   if( !m_ValidRay )
   {
@@ -791,6 +851,37 @@ RayCastHelper< TInputImage, TCoordRep >
 }
 
 
+/* -----------------------------------------------------------------------
+   SetRayIntercepts() - Set the ray and compute where it cuts the volume
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+bool
+RayCastHelper< TInputImage, TCoordRep >
+::SetRayIntercepts( OutputPointType RayPosn, DirectionType RayDirn )
+{
+  // Store the position and direction of the ray. The volume dimensions
+  // have been recorded by Initialise().
+  // we need to translate the _center_ of the volume to the origin
+  m_CurrentRayPositionInMM[ 0 ]
+    = RayPosn[ 0 ] + 0.5 * m_VoxelDimensionInX * (double)m_NumberOfVoxelsInX;
+
+  m_CurrentRayPositionInMM[ 1 ]
+    = RayPosn[ 1 ] + 0.5 * m_VoxelDimensionInY * (double)m_NumberOfVoxelsInY;
+
+  m_CurrentRayPositionInMM[ 2 ]
+    = RayPosn[ 2 ] + 0.5 * m_VoxelDimensionInZ * (double)m_NumberOfVoxelsInZ;
+
+  m_RayDirectionInMM[ 0 ] = RayDirn[ 0 ];
+  m_RayDirectionInMM[ 1 ] = RayDirn[ 1 ];
+  m_RayDirectionInMM[ 2 ] = RayDirn[ 2 ];
+
+  m_ValidRay = this->CalcRayIntercepts();
+
+  return m_ValidRay;
+}
+
+
 /* -----------------------------------------------------------------------
    EndPointsInVoxels() - Convert the endpoints to voxels
    ----------------------------------------------------------------------- */
@@ -1440,6 +1531,155 @@ RayCastHelper< TInputImage, TCoordRep >
 }
 
 
+/* -----------------------------------------------------------------------
+   IntegrateAboveThresholdSiddon() - Integrate intensities above a
+   threshold, visiting each voxel cut by the ray.
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+bool
+RayCastHelper< TInputImage, TCoordRep >
+::IntegrateAboveThresholdSiddon( double & integral, double threshold )
+{
+  integral = 0.;
+
+  // Check if this is a valid ray
+
+  if( !m_ValidRay )
+  {
+    return false;
+  }
+
+  const int    numberOfVoxels[ 3 ] = { m_NumberOfVoxelsInX, m_NumberOfVoxelsInY, m_NumberOfVoxelsInZ };
+  const double voxelDimension[ 3 ] = { m_VoxelDimensionInX, m_VoxelDimensionInY, m_VoxelDimensionInZ };
+  const typename InputImageType::OffsetValueType * offsetTable = this->m_Image->GetOffsetTable();
+
+  /* The ray is parameterised as start + alpha * ( end - start ),
+     with alpha in [0,1]. */
+
+  double delta[ 3 ];
+  double rayLength = 0.;
+  for( unsigned int i = 0; i < 3; i++ )
+  {
+    delta[ i ]  = m_RayEndCoordInMM[ i ] - m_RayStartCoordInMM[ i ];
+    rayLength  += delta[ i ] * delta[ i ];
+  }
+  rayLength = std::sqrt( rayLength );
+  if( rayLength == 0. )
+  {
+    return true;
+  }
+
+  /* Clip the ray to the part of the volume between the centres of the
+     outer voxels. The plane traversal of IntegrateAboveThreshold()
+     interpolates between voxel centres, so it integrates over the same
+     part of the ray, and both integrals then have the same scale. */
+
+  double alphaMin = 0.;
+  double alphaMax = 1.;
+  for( unsigned int i = 0; i < 3; i++ )
+  {
+    const double lower = 0.5 * voxelDimension[ i ];
+    const double upper = ( numberOfVoxels[ i ] - 0.5 ) * voxelDimension[ i ];
+    if( delta[ i ] != 0. )
+    {
+      const double alpha0 = ( lower - m_RayStartCoordInMM[ i ] ) / delta[ i ];
+      const double alpha1 = ( upper - m_RayStartCoordInMM[ i ] ) / delta[ i ];
+      alphaMin = std::max( alphaMin, std::min( alpha0, alpha1 ) );
+      alphaMax = std::min( alphaMax, std::max( alpha0, alpha1 ) );
+    }
+    else if( m_RayStartCoordInMM[ i ] < lower || m_RayStartCoordInMM[ i ] > upper )
+    {
+      return true;
+    }
+  }
+  if( alphaMin >= alphaMax )
+  {
+    return true;
+  }
+
+  /* Find the voxel in which the clipped ray starts, the value of alpha at
+     which the ray crosses the next voxel boundary in each direction, and
+     the increment of alpha between two successive boundaries. */
+
+  int    voxelIndex[ 3 ];
+  int    voxelStep[ 3 ];
+  double alphaNext[ 3 ];
+  double alphaIncrement[ 3 ];
+  const double maxAlpha = itk::NumericTraits< double >::max();
+
+  for( unsigned int i = 0; i < 3; i++ )
+  {
+    const double position = m_RayStartCoordInMM[ i ] + alphaMin * delta[ i ];
+    voxelIndex[ i ] = static_cast< int >( std::floor( position / voxelDimension[ i ] ) );
+    voxelIndex[ i ] = std::max( 0, std::min( voxelIndex[ i ], numberOfVoxels[ i ] - 1 ) );
+
+    if( delta[ i ] > 0. )
+    {
+      voxelStep[ i ]      = 1;
+      alphaIncrement[ i ] = voxelDimension[ i ] / delta[ i ];
+      alphaNext[ i ]      = ( ( voxelIndex[ i ] + 1 ) * voxelDimension[ i ] - m_RayStartCoordInMM[ i ] ) / delta[ i ];
+    }
+    else if( delta[ i ] < 0. )
+    {
+      voxelStep[ i ]      = -1;
+      alphaIncrement[ i ] = -voxelDimension[ i ] / delta[ i ];
+      alphaNext[ i ]      = ( voxelIndex[ i ] * voxelDimension[ i ] - m_RayStartCoordInMM[ i ] ) / delta[ i ];
+    }
+    else
+    {
+      voxelStep[ i ]      = 0;
+      alphaIncrement[ i ] = maxAlpha;
+      alphaNext[ i ]      = maxAlpha;
+    }
+
+    // The start may lie exactly on a boundary.
+    if( alphaNext[ i ] <= alphaMin )
+    {
+      voxelIndex[ i ] += voxelStep[ i ];
+      alphaNext[ i ]  += alphaIncrement[ i ];
+    }
+  }
+
+  IndexType index;
+  index[ 0 ] = voxelIndex[ 0 ];
+  index[ 1 ] = voxelIndex[ 1 ];
+  index[ 2 ] = voxelIndex[ 2 ];
+  const PixelType * voxel = this->m_Image->GetBufferPointer() + this->m_Image->ComputeOffset( index );
+
+  /* Step from voxel boundary to voxel boundary, always crossing the
+     nearest one, until the end of the clipped ray. */
+
+  double alpha = alphaMin;
+  while( alpha < alphaMax )
+  {
+    unsigned int d = 0;
+    if( alphaNext[ 1 ] < alphaNext[ d ] ) { d = 1; }
+    if( alphaNext[ 2 ] < alphaNext[ d ] ) { d = 2; }
+
+    const double alphaEnd  = std::min( alphaNext[ d ], alphaMax );
+    const double intensity = static_cast< double >( *voxel );
+    if( intensity > threshold )
+    {
+      integral += ( intensity - threshold ) * ( alphaEnd - alpha );
+    }
+    alpha = alphaEnd;
+
+    voxelIndex[ d ] += voxelStep[ d ];
+    if( voxelIndex[ d ] < 0 || voxelIndex[ d ] >= numberOfVoxels[ d ] )
+    {
+      break;
+    }
+    voxel          += voxelStep[ d ] * offsetTable[ d ];
+    alphaNext[ d ] += alphaIncrement[ d ];
+  }
+
+  integral *= rayLength;
+
+  return true;
+}
+
+
 /* -----------------------------------------------------------------------
    ZeroState() - Set the default (zero) state of the object
    ----------------------------------------------------------------------- */
@@ -1524,6 +1764,13 @@ AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
   m_FocalPoint[ 0 ] = 0.;
   m_FocalPoint[ 1 ] = 0.;
   m_FocalPoint[ 2 ] = 0.;
+
+  m_UseSiddonRayTraversal = false;
+
+  m_RayCastGeometryIsPrecomputed  = false;
+  m_RayCastGeometryImage          = nullptr;
+  m_RayCastGeometryImageMTime     = 0;
+  m_RayCastGeometryTransformMTime = 0;
 }
 
 
@@ -1542,10 +1789,78 @@ AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
   os << indent << "FocalPoint: " << m_FocalPoint << std::endl;
   os << indent << "Transform: " << m_Transform.GetPointer() << std::endl;
   os << indent << "Interpolator: " << m_Interpolator.GetPointer() << std::endl;
+  os << indent << "UseSiddonRayTraversal: " << m_UseSiddonRayTraversal << std::endl;
+  os << indent << "RayCastGeometryIsPrecomputed: " << m_RayCastGeometryIsPrecomputed << std::endl;
 
 }
 
 
+/* -----------------------------------------------------------------------
+   PrecomputeRayCastGeometry
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::PrecomputeRayCastGeometry( void )
+{
+  if( this->m_Image.IsNull() )
+  {
+    itkExceptionMacro( << "Input image required!" );
+  }
+  if( m_Transform.IsNull() )
+  {
+    itkExceptionMacro( << "Transform required!" );
+  }
+
+  m_TransformedFocalPoint = m_Transform->TransformPoint( m_FocalPoint );
+
+  RayCastHelper< TInputImage, TCoordRep > ray;
+  ray.SetImage( this->m_Image );
+  ray.ZeroState();
+  ray.Initialise();
+  ray.GetGeometry( m_RayCastGeometry );
+
+  m_RayCastGeometryImage          = this->m_Image.GetPointer();
+  m_RayCastGeometryImageMTime     = this->m_Image->GetMTime();
+  m_RayCastGeometryTransformMTime = m_Transform->GetMTime();
+  m_RayCastGeometryIsPrecomputed  = true;
+
+} // end PrecomputeRayCastGeometry()
+
+
+/* -----------------------------------------------------------------------
+   ResetRayCastGeometry
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::ResetRayCastGeometry( void )
+{
+  m_RayCastGeometryIsPrecomputed = false;
+  m_RayCastGeometryImage         = nullptr;
+
+} // end ResetRayCastGeometry()
+
+
+/* -----------------------------------------------------------------------
+   GetRayCastGeometryIsValid
+   ----------------------------------------------------------------------- */
+
+template< class TInputImage, class TCoordRep >
+bool
+AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
+::GetRayCastGeometryIsValid( void ) const
+{
+  return m_RayCastGeometryIsPrecomputed
+         && m_RayCastGeometryImage == this->m_Image.GetPointer()
+         && m_RayCastGeometryImageMTime == this->m_Image->GetMTime()
+         && m_RayCastGeometryTransformMTime == m_Transform->GetMTime();
+
+} // end GetRayCastGeometryIsValid()
+
+
 /* -----------------------------------------------------------------------
    Evaluate at image index position
    ----------------------------------------------------------------------- */
@@ -1558,18 +1873,36 @@ AdvancedRayCastInterpolateImageFunction< TInputImage, TCoordRep >
 {
   double integral = 0;
 
-  OutputPointType transformedFocalPoint
-    = m_Transform->TransformPoint( m_FocalPoint );
-
-  DirectionType direction = transformedFocalPoint - point;
+  OutputPointType transformedFocalPoint;
 
   RayCastHelper< TInputImage, TCoordRep > ray;
   ray.SetImage( this->m_Image );
   ray.ZeroState();
-  ray.Initialise();
 
-  ray.SetRay( point, direction );
-  ray.IntegrateAboveThreshold( integral, m_Threshold );
+  /** Use the precomputed focal point and volume geometry if possible. */
+  if( this->GetRayCastGeometryIsValid() )
+  {
+    transformedFocalPoint = m_TransformedFocalPoint;
+    ray.Initialise( m_RayCastGeometry );
+  }
+  else
+  {
+    transformedFocalPoint = m_Transform->TransformPoint( m_FocalPoint );
+    ray.Initialise();
+  }
+
+  DirectionType direction = transformedFocalPoint - point;
+
+  if( m_UseSiddonRayTraversal )
+  {
+    ray.SetRayIntercepts( point, direction );
+    ray.IntegrateAboveThresholdSiddon( integral, m_Threshold );
+  }
+  else
+  {
+    ray.SetRay( point, direction );
+    ray.IntegrateAboveThreshold( integral, m_Threshold );
+  }
 
   return ( static_cast< OutputType >( integral ) );
 }
@@ -125,6 +125,12 @@ public:
     this->m_Threader->SetNumberOfWorkUnits( numberOfThreads );
   }
 
+  /** Get the number of threads. */
+  ThreadIdType GetNumberOfWorkUnits( void ) const
+  {
+    return this->m_Threader->GetNumberOfWorkUnits();
+  }
+
 
   virtual void BeforeThreadedCompute( const ParametersType & mu );
 
@@ -22,6 +22,12 @@
 #include "itkImageRandomSamplerBase.h"
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkPlatformMultiThreader.h"
+#include "vnl/vnl_diag_matrix.h"
+#include "vnl/vnl_sparse_matrix.h"
+
+#include <unordered_map>
+#include <vector>
 
 namespace itk
 {
@@ -31,6 +37,14 @@ namespace itk
  * More specifically this class computes the Jacobian terms related to the automatic
  * parameter estimation for the adaptive stochastic gradient descent optimizer.
  * Details can be found in the paper.
+ *
+ * Compute() distributes the samples over the threads. Each thread computes
+ * a partial covariance matrix over its samples, with the band elements in
+ * dense rows that are allocated only for the parameters the thread
+ * encounters, and the remaining elements as a sorted list. The partial
+ * matrices are then summed, with each thread handling a range of rows.
+ * The maxima of terms 3 and 4 are computed per thread as well.
+ * ComputeSingleThreaded() performs the original serial computation.
  */
 
 template< class TFixedImage, class TTransform >
@@ -103,15 +117,35 @@ public:
   /** Get the region over which the metric will be computed. */
   itkGetConstReferenceMacro( FixedImageRegion, FixedImageRegionType );
 
-  /** The main functions that performs the computation. */
+  /** The main function that performs the multi-threaded computation. */
   virtual void Compute( double & TrC, double & TrCC,
     double & maxJJ, double & maxJCJ );
 
+  /** The main function that performs the single-threaded computation. */
+  virtual void ComputeSingleThreaded( double & TrC, double & TrCC,
+    double & maxJJ, double & maxJCJ );
+
+  /** Set the number of threads. */
+  void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfWorkUnits( numberOfThreads );
+  }
+
+  /** Get the number of threads. */
+  ThreadIdType GetNumberOfWorkUnits( void ) const
+  {
+    return this->m_Threader->GetNumberOfWorkUnits();
+  }
+
 protected:
 
   ComputeJacobianTerms();
   ~ComputeJacobianTerms() override {}
 
+  /** Typedefs for multi-threading. */
+  typedef itk::PlatformMultiThreader ThreaderType;
+  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
+
   typename FixedImageType::ConstPointer m_FixedImage;
   FixedImageRegionType       m_FixedImageRegion;
   FixedImageMaskConstPointer m_FixedImageMask;
@@ -123,6 +157,8 @@ protected:
   unsigned int  m_NumberOfBandStructureSamples;
   SizeValueType m_NumberOfJacobianMeasurements;
 
+  ThreaderType::Pointer m_Threader;
+
   typedef typename  FixedImageType::IndexType   FixedImageIndexType;
   typedef typename  FixedImageType::PointType   FixedImagePointType;
   typedef typename  TransformType::JacobianType JacobianType;
@@ -145,12 +181,85 @@ protected:
   typedef typename TransformType::ScalarType             CoordinateRepresentationType;
   typedef typename TransformType::NumberOfParametersType NumberOfParametersType;
 
+  /** Typedefs for the covariance matrix. */
+  typedef double                                   CovarianceValueType;
+  typedef itk::Array2D< CovarianceValueType >      CovarianceMatrixType;
+  typedef vnl_sparse_matrix< CovarianceValueType > SparseCovarianceMatrixType;
+  typedef typename SparseCovarianceMatrixType::row SparseRowType;
+  typedef itk::Array< SizeValueType >              NonZeroJacobianIndicesExpandedType;
+  typedef vnl_diag_matrix< CovarianceValueType >   DiagCovarianceMatrixType;
+
   /** Sample the fixed image to compute the Jacobian terms. */
   // \todo: note that this is an exact copy of itk::ComputeDisplacementDistribution
   // in the future it would be better to refactoring this part of the code.
   virtual void SampleFixedImageForJacobianTerms(
     ImageSampleContainerPointer & sampleContainer );
 
+  /** Guess the band structure of the covariance matrix from a few samples.
+   * Returns the number of bands; see ComputeSingleThreaded() for details.
+   */
+  virtual unsigned int EstimateBandStructure(
+    const ImageSampleContainerType * sampleContainer,
+    std::vector< unsigned int > & bandcovMap,
+    std::vector< unsigned int > & bandcovMap2 ) const;
+
+  /** Apply the scales to the covariance matrix, and compute TrC, TrCC,
+   * and the diagonal of the covariance matrix.
+   */
+  virtual void ComputeTraces( SparseCovarianceMatrixType & cov,
+    DiagCovarianceMatrixType & diagcov, double & TrC, double & TrCC ) const;
+
+  /** Threader callback functions. */
+  static ITK_THREAD_RETURN_TYPE CovarianceThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE ReduceCovarianceThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE MaximaThreaderCallback( void * arg );
+
+  /** Compute the partial covariance matrix over the samples of a thread. */
+  virtual void ThreadedComputeCovariance( ThreadIdType threadId );
+
+  /** Sum the partial covariance matrices, for a range of rows. */
+  virtual void ThreadedReduceCovariance( ThreadIdType threadId );
+
+  /** Compute maxJJ and maxJCJ over the samples of a thread. */
+  virtual void ThreadedComputeMaxima( ThreadIdType threadId );
+
+  /** An element of a partial covariance matrix that is not in a band. */
+  struct CovarianceElementType
+  {
+    unsigned int        st_Row;
+    unsigned int        st_Column;
+    CovarianceValueType st_Value;
+  };
+
+  struct ComputePerThreadStruct
+  {
+    /** The band elements of the rows this thread encountered: row p is
+     * stored at st_BandRows[ slot * bandcovsize ], with slot = st_BandRowSlots[ p ].
+     */
+    std::unordered_map< unsigned int, unsigned int > st_BandRowSlots;
+    std::vector< CovarianceValueType >               st_BandRows;
+    /** The other elements, sorted by row and column after the loop. */
+    std::vector< CovarianceElementType > st_Elements;
+    double                               st_MaxJJ;
+    double                               st_MaxJCJ;
+  };
+
+  /** Add J_j^T J_j, summed over a run of samples, to the partial covariance of a thread. */
+  void UpdatePartialCovariance( ComputePerThreadStruct & perThread,
+    const NonZeroJacobianIndicesType & jacind,
+    const CovarianceMatrixType & jactjac, const double n ) const;
+
+  /** Variables that are shared by the threads. */
+  ImageSampleContainerPointer           m_SampleContainer;
+  std::vector< unsigned int >           m_BandCovMap;
+  std::vector< unsigned int >           m_BandCovMap2;
+  unsigned int                          m_BandCovSize;
+  SparseCovarianceMatrixType            m_Covariance;
+  DiagCovarianceMatrixType              m_DiagCovariance;
+  std::vector< ComputePerThreadStruct > m_ComputePerThreadVariables;
+
 private:
 
   ComputeJacobianTerms( const Self & ); // purposely not implemented
@@ -25,6 +25,8 @@
 #include "vnl/vnl_diag_matrix.h"
 #include "vnl/vnl_sparse_matrix.h"
 
+#include <algorithm>
+
 namespace itk
 {
 /**
@@ -45,6 +47,10 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   this->m_NumberOfBandStructureSamples = 0;
   this->m_NumberOfJacobianMeasurements = 0;
 
+  /** Threading related variables. */
+  this->m_Threader    = ThreaderType::New();
+  this->m_BandCovSize = 0;
+
 } // end Constructor
 
 
@@ -57,58 +63,174 @@ void
 ComputeJacobianTerms< TFixedImage, TTransform >
 ::Compute( double & TrC, double & TrCC, double & maxJJ, double & maxJCJ )
 {
-  /** This function computes four terms needed for the automatic parameter
-   * estimation. The equation number refers to the IJCV paper.
-   * Term 1: TrC, which is the trace of the covariance matrix, needed in (34):
-   *    C = 1/n \sum_{i=1}^n J_i^T J_i    (25)
-   *    with n the number of samples, J_i the Jacobian of the i-th sample.
-   * Term 2: TrCC, which is the Frobenius norm of C, needed in (60):
-   *    ||C||_F^2 = trace( C^T C )
-   * To compute equations (47) and (54) we need the four sub-terms:
-   *    A: trace( J_j C J_j^T )  in (47)
-   *    B: || J_j C J_j^T ||_F   in (47)
-   *    C: || J_j ||_F^2         in (54)
-   *    D: || J_j J_j^T ||_F     in (54)
-   * Term 3: maxJJ, see (47)
-   * Term 4: maxJCJ, see (54)
+  /** This function computes the same four terms as ComputeSingleThreaded(),
+   * see there for their definition. The loops over the samples are
+   * distributed over the threads.
    */
 
-  typedef double                                   CovarianceValueType;
-  typedef itk::Array2D< CovarianceValueType >      CovarianceMatrixType;
-  typedef vnl_sparse_matrix< CovarianceValueType > SparseCovarianceMatrixType;
-  typedef SparseCovarianceMatrixType::row          SparseRowType;
-  typedef itk::Array< SizeValueType >              NonZeroJacobianIndicesExpandedType;
-  typedef vnl_diag_matrix< CovarianceValueType >   DiagCovarianceMatrixType;
-
   /** Initialize. */
   TrC = TrCC = maxJJ = maxJCJ = 0.0;
 
   /** Get samples. */
-  ImageSampleContainerPointer sampleContainer; // default-constructed (null)
-  SampleFixedImageForJacobianTerms( sampleContainer );
-  const SizeValueType nrofsamples = sampleContainer->Size();
-  const double        n           = static_cast< double >( nrofsamples );
+  SampleFixedImageForJacobianTerms( this->m_SampleContainer );
 
   /** Get the number of parameters. */
   const unsigned int P = static_cast< unsigned int >(
     this->m_Transform->GetNumberOfParameters() );
 
-  /** Get transform and set current position. */
-  typename TransformType::Pointer transform
-    = this->m_Transform;
-  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
+  /** Guess the band structure of the covariance matrix. */
+  this->m_BandCovSize = this->EstimateBandStructure(
+    this->m_SampleContainer, this->m_BandCovMap, this->m_BandCovMap2 );
 
-  /** Get scales vector */
-  const ScalesType & scales = this->m_Scales;
+  /** Initialize the per thread variables. */
+  const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+  this->m_ComputePerThreadVariables.clear();
+  this->m_ComputePerThreadVariables.resize( numberOfThreads );
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_ComputePerThreadVariables[ i ].st_MaxJJ  = 0.0;
+    this->m_ComputePerThreadVariables[ i ].st_MaxJCJ = 0.0;
+  }
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
-  unsigned int samplenr = 0;
+  /**
+   *    TERM 1
+   *
+   * Compute C = 1/n \sum_i J_i^T J_i. Each thread computes the sum over
+   * its samples, and then the partial sums are added, per range of rows.
+   */
+  this->m_Threader->SetSingleMethod( this->CovarianceThreaderCallback, this );
+  this->m_Threader->SingleMethodExecute();
+
+  this->m_Covariance = SparseCovarianceMatrixType( P, P );
+  this->m_Threader->SetSingleMethod( this->ReduceCovarianceThreaderCallback, this );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Release the partial covariance matrices. */
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    ComputePerThreadStruct & perThread = this->m_ComputePerThreadVariables[ i ];
+    std::unordered_map< unsigned int, unsigned int >().swap( perThread.st_BandRowSlots );
+    std::vector< CovarianceValueType >().swap( perThread.st_BandRows );
+    std::vector< CovarianceElementType >().swap( perThread.st_Elements );
+  }
+
+  /**
+   *    TERM 2
+   *
+   * Compute TrC = trace(C) and TrCC = ||C||_F^2, after applying the scales.
+   */
+  this->ComputeTraces( this->m_Covariance, this->m_DiagCovariance, TrC, TrCC );
+
+  /**
+   *    TERM 3 and 4
+   *
+   * Compute maxJJ and maxJCJ, as the maximum over the threads.
+   */
+  this->m_Threader->SetSingleMethod( this->MaximaThreaderCallback, this );
+  this->m_Threader->SingleMethodExecute();
+
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    maxJJ  = std::max( maxJJ, this->m_ComputePerThreadVariables[ i ].st_MaxJJ );
+    maxJCJ = std::max( maxJCJ, this->m_ComputePerThreadVariables[ i ].st_MaxJCJ );
+  }
+
+  /** Release memory. */
+  this->m_Covariance     = SparseCovarianceMatrixType();
+  this->m_DiagCovariance = DiagCovarianceMatrixType();
+  this->m_SampleContainer = nullptr;
+  this->m_ComputePerThreadVariables.clear();
+
+} // end Compute()
+
+
+/**
+ * ************************* CovarianceThreaderCallback ************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_TYPE
+ComputeJacobianTerms< TFixedImage, TTransform >
+::CovarianceThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+  Self *           self       = static_cast< Self * >( infoStruct->UserData );
+
+  self->ThreadedComputeCovariance( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end CovarianceThreaderCallback()
+
+
+/**
+ * ************************* ReduceCovarianceThreaderCallback ************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_TYPE
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ReduceCovarianceThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+  Self *           self       = static_cast< Self * >( infoStruct->UserData );
+
+  self->ThreadedReduceCovariance( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ReduceCovarianceThreaderCallback()
+
+
+/**
+ * ************************* MaximaThreaderCallback ************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_TYPE
+ComputeJacobianTerms< TFixedImage, TTransform >
+::MaximaThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+  Self *           self       = static_cast< Self * >( infoStruct->UserData );
+
+  self->ThreadedComputeMaxima( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end MaximaThreaderCallback()
+
+
+/**
+ * ************************* ThreadedComputeCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ThreadedComputeCovariance( ThreadIdType threadId )
+{
+  /** Get sample container size, number of threads, and output space dimension. */
+  const SizeValueType sampleContainerSize = this->m_SampleContainer->Size();
+  const ThreadIdType  numberOfThreads     = this->m_Threader->GetNumberOfWorkUnits();
+  const unsigned int  outdim              = this->m_Transform->GetOutputSpaceDimension();
+  const double        n                   = static_cast< double >( sampleContainerSize );
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( numberOfThreads ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
 
   /** Variables for nonzerojacobian indices and the Jacobian. */
-  NumberOfParametersType sizejacind
+  const NumberOfParametersType sizejacind
     = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
   JacobianType jacj( outdim, sizejacind );
   jacj.Fill( 0.0 );
@@ -117,53 +239,21 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
   NonZeroJacobianIndicesType prevjacind = jacind;
 
-  /** Initialize covariance matrix. Sparse, diagonal, and band form. */
-  SparseCovarianceMatrixType cov( P, P );
-  DiagCovarianceMatrixType   diagcov( P, 0.0 );
-  CovarianceMatrixType       bandcov;
-
-  /** For temporary storage of J'J. */
+  /** For temporary storage of J'J, summed over a run of samples with the
+   * same nonzero Jacobian indices.
+   */
   CovarianceMatrixType jactjac( sizejacind, sizejacind );
   jactjac.Fill( 0.0 );
+  bool runStarted = false;
 
-  typedef std::vector< unsigned int >             DifHistType;
-  typedef std::pair< unsigned int, unsigned int > FreqPairType;
-  typedef std::vector< FreqPairType >             DifHist2Type;
-  DifHist2Type difHist2;
-
-  /** DifHist is a histogram of absolute parameterNrDifferences that
-   * occur in the nonzerojacobianindex vectors.
-   * DifHist2 is another way of storing the histogram, as a vector
-   * of pairs. pair.first = Frequency, pair.second = parameterNrDifference.
-   * This is useful for sorting.
-   */
-  DifHistType difHist( P, 0 );
+  ComputePerThreadStruct & perThread = this->m_ComputePerThreadVariables[ threadId ];
 
-  /** Try to guess the band structure of the covariance matrix.
-   * A 'band' is a series of elements cov(p,q) with constant q-p.
-   * In the loop below, on a few positions in the image the Jacobian
-   * is computed. The nonzerojacobianindices are inspected to figure out
-   * which values of q-p occur often. This is done by making a histogram.
-   * The histogram is then sorted and the most occurring bands
-   * are determined. The covariance elements in these bands will not
-   * be stored in the sparse matrix structure 'cov', but in the band
-   * matrix 'bandcov', which is much faster.
-   * Only after the bandcov and cov have been filled (by looping over
-   * all Jacobian measurements in the sample container, the bandcov
-   * matrix is injected in the cov matrix, for easy further calculations,
-   * and the bandcov matrix is deleted.
-   */
-  unsigned int onezero = 0;
-  for( unsigned int s = 0; s < this->m_NumberOfBandStructureSamples; ++s )
+  /** Loop over the samples of this thread. */
+  for( unsigned long pos = pos_begin; pos < pos_end; ++pos )
   {
-    /** Semi-randomly get some samples from the sample container. */
-    const unsigned int samplenr = ( s + 1 ) * nrofsamples
-      / ( this->m_NumberOfBandStructureSamples + 2 + onezero );
-    onezero = 1 - onezero; // introduces semi-randomness
-
     /** Read fixed coordinates and get Jacobian J_j. */
     const FixedImagePointType & point
-      = sampleContainer->GetElement( samplenr ).m_ImageCoordinates;
+      = this->m_SampleContainer->ElementAt( pos ).m_ImageCoordinates;
     this->m_Transform->GetJacobian( point, jacj, jacind );
 
     /** Skip invalid Jacobians in the beginning, if any. */
@@ -172,49 +262,444 @@ ComputeJacobianTerms< TFixedImage, TTransform >
       if( jacind[ 0 ] == jacind[ 1 ] ) { continue; }
     }
 
-    /** Fill the histogram of parameter nr differences. */
-    for( unsigned int i = 0; i < sizejacind; ++i )
+    if( runStarted && jacind == prevjacind )
     {
-      const int jacindi = static_cast< int >( jacind[ i ] );
-      for( unsigned int j = i; j < sizejacind; ++j )
+      /** Update sum of J_j^T J_j. */
+      vnl_fastops::inc_X_by_AtA( jactjac, jacj );
+    }
+    else
+    {
+      /** Add the previous run to the partial covariance matrix. */
+      if( runStarted )
       {
-        const int jacindj = static_cast< int >( jacind[ j ] );
-        difHist[ static_cast< unsigned int >( std::abs( jacindj - jacindi ) ) ]++;
+        this->UpdatePartialCovariance( perThread, prevjacind, jactjac, n );
       }
+
+      /** Initialize jactjac by J_j^T J_j. */
+      vnl_fastops::AtA( jactjac, jacj );
+
+      /** Remember nonzerojacobian indices. */
+      prevjacind = jacind;
+      runStarted = true;
     }
+  } // end loop over samples
+
+  /** Add the last run. */
+  if( runStarted )
+  {
+    this->UpdatePartialCovariance( perThread, prevjacind, jactjac, n );
   }
 
-  /** Copy the nonzero elements of the difHist to a vector pairs. */
-  for( unsigned int p = 0; p < P; ++p )
-  {
-    const unsigned int freq = difHist[ p ];
-    if( freq != 0 )
-    {
-      difHist2.push_back( FreqPairType( freq, p ) );
-    }
-  }
-  difHist.resize( 0 );
+  /** Sort the elements that are not in a band, and merge duplicates. */
+  std::vector< CovarianceElementType > & elements = perThread.st_Elements;
+  std::sort( elements.begin(), elements.end(),
+    []( const CovarianceElementType & a, const CovarianceElementType & b )
+    {
+      return a.st_Row < b.st_Row || ( a.st_Row == b.st_Row && a.st_Column < b.st_Column );
+    } );
+  std::size_t last = 0;
+  for( std::size_t i = 1; i < elements.size(); ++i )
+  {
+    if( elements[ i ].st_Row == elements[ last ].st_Row
+      && elements[ i ].st_Column == elements[ last ].st_Column )
+    {
+      elements[ last ].st_Value += elements[ i ].st_Value;
+    }
+    else
+    {
+      elements[ ++last ] = elements[ i ];
+    }
+  }
+  if( !elements.empty() ) { elements.resize( last + 1 ); }
+
+} // end ThreadedComputeCovariance()
+
+
+/**
+ * ************************* UpdatePartialCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::UpdatePartialCovariance( ComputePerThreadStruct & perThread,
+  const NonZeroJacobianIndicesType & jacind,
+  const CovarianceMatrixType & jactjac, const double n ) const
+{
+  const unsigned int sizejacind  = jacind.size();
+  const unsigned int bandcovsize = this->m_BandCovSize;
+
+  for( unsigned int pi = 0; pi < sizejacind; ++pi )
+  {
+    const unsigned int    p       = jacind[ pi ];
+    CovarianceValueType * bandrow = nullptr;
+    for( unsigned int qi = 0; qi < sizejacind; ++qi )
+    {
+      const unsigned int q = jacind[ qi ];
+      if( q >= p )
+      {
+        const double tempval = jactjac( pi, qi ) / n;
+        if( std::abs( tempval ) > 1e-14 )
+        {
+          const unsigned int bandindex = this->m_BandCovMap[ q - p ];
+          if( bandindex < bandcovsize )
+          {
+            /** Look up the band row of p, or allocate it. */
+            if( bandrow == nullptr )
+            {
+              const unsigned int newSlot = static_cast< unsigned int >(
+                perThread.st_BandRowSlots.size() );
+              const std::pair< std::unordered_map< unsigned int, unsigned int >::iterator, bool >
+                inserted = perThread.st_BandRowSlots.insert( std::make_pair( p, newSlot ) );
+              if( inserted.second )
+              {
+                perThread.st_BandRows.resize( perThread.st_BandRows.size() + bandcovsize, 0.0 );
+              }
+              bandrow = &perThread.st_BandRows[ inserted.first->second * bandcovsize ];
+            }
+            bandrow[ bandindex ] += tempval;
+          }
+          else
+          {
+            CovarianceElementType element;
+            element.st_Row    = p;
+            element.st_Column = q;
+            element.st_Value  = tempval;
+            perThread.st_Elements.push_back( element );
+          }
+        }
+      }
+    } // qi
+  }   // pi
+
+} // end UpdatePartialCovariance()
+
+
+/**
+ * ************************* ThreadedReduceCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ThreadedReduceCovariance( ThreadIdType threadId )
+{
+  const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+  const unsigned int P               = this->m_Covariance.rows();
+  const unsigned int bandcovsize     = this->m_BandCovSize;
+
+  /** Get the rows for this thread. Different threads write different rows
+   * of the sparse covariance matrix, so no locking is needed.
+   */
+  const unsigned int nrOfRowsPerThread = static_cast< unsigned int >(
+    std::ceil( static_cast< double >( P ) / static_cast< double >( numberOfThreads ) ) );
+
+  unsigned int p_begin = nrOfRowsPerThread * threadId;
+  unsigned int p_end   = nrOfRowsPerThread * ( threadId + 1 );
+  p_begin = ( p_begin > P ) ? P : p_begin;
+  p_end   = ( p_end > P ) ? P : p_end;
+
+  /** Find the first element of this range of rows in each partial matrix. */
+  typedef typename std::vector< CovarianceElementType >::const_iterator ElementIteratorType;
+  std::vector< ElementIteratorType > elementIts( numberOfThreads );
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    const std::vector< CovarianceElementType > & elements
+      = this->m_ComputePerThreadVariables[ i ].st_Elements;
+    elementIts[ i ] = std::lower_bound( elements.begin(), elements.end(), p_begin,
+      []( const CovarianceElementType & a, const unsigned int row )
+      {
+        return a.st_Row < row;
+      } );
+  }
+
+  std::vector< CovarianceValueType > bandrow( bandcovsize );
+  for( unsigned int p = p_begin; p < p_end; ++p )
+  {
+    std::fill( bandrow.begin(), bandrow.end(), 0.0 );
+    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+    {
+      const ComputePerThreadStruct & perThread = this->m_ComputePerThreadVariables[ i ];
+
+      /** Sum the band elements. */
+      const typename std::unordered_map< unsigned int, unsigned int >::const_iterator slot
+        = perThread.st_BandRowSlots.find( p );
+      if( slot != perThread.st_BandRowSlots.end() )
+      {
+        const CovarianceValueType * partialrow
+          = &perThread.st_BandRows[ slot->second * bandcovsize ];
+        for( unsigned int b = 0; b < bandcovsize; ++b )
+        {
+          bandrow[ b ] += partialrow[ b ];
+        }
+      }
+
+      /** Add the other elements. */
+      ElementIteratorType & it = elementIts[ i ];
+      while( it != perThread.st_Elements.end() && it->st_Row == p )
+      {
+        this->m_Covariance( p, it->st_Column ) += it->st_Value;
+        ++it;
+      }
+    }
+
+    /** Copy the band elements into the sparse matrix. */
+    for( unsigned int b = 0; b < bandcovsize; ++b )
+    {
+      const double tempval = bandrow[ b ];
+      if( std::abs( tempval ) > 1e-14 )
+      {
+        const unsigned int q = p + this->m_BandCovMap2[ b ];
+        this->m_Covariance( p, q ) = tempval;
+      }
+    }
+  }
+
+} // end ThreadedReduceCovariance()
+
+
+/**
+ * ************************* ThreadedComputeMaxima ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ThreadedComputeMaxima( ThreadIdType threadId )
+{
+  /** Get sample container size, number of threads, and output space dimension. */
+  const SizeValueType sampleContainerSize = this->m_SampleContainer->Size();
+  const ThreadIdType  numberOfThreads     = this->m_Threader->GetNumberOfWorkUnits();
+  const unsigned int  outdim              = this->m_Transform->GetOutputSpaceDimension();
+  const unsigned int  P                   = this->m_Covariance.rows();
+
+  /** Get scales vector */
+  const ScalesType & scales = this->m_Scales;
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( numberOfThreads ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  const NumberOfParametersType sizejacind
+    = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+
+  /** Temporaries. */
+  double       maxJJ  = 0.0;
+  double       maxJCJ = 0.0;
+  const double sqrt2  = std::sqrt( static_cast< double >( 2.0 ) );
+
+  JacobianType                       jacjjacj( outdim, outdim );
+  JacobianType                       jacjcov( outdim, sizejacind );
+  DiagCovarianceMatrixType           diagcovsparse( sizejacind );
+  JacobianType                       jacjdiagcov( outdim, sizejacind );
+  JacobianType                       jacjdiagcovjacj( outdim, outdim );
+  JacobianType                       jacjcovjacj( outdim, outdim );
+  NonZeroJacobianIndicesExpandedType jacindExpanded( P );
+
+  /** Only the entries of the nonzero Jacobian indices of a sample are set
+   * below, and they are reset afterwards, to avoid a fill of size P per sample.
+   */
+  jacindExpanded.Fill( sizejacind );
+
+  /** Loop over the samples of this thread. */
+  for( unsigned long pos = pos_begin; pos < pos_end; ++pos )
+  {
+    /** Read fixed coordinates and get Jacobian. */
+    const FixedImagePointType & point
+      = this->m_SampleContainer->ElementAt( pos ).m_ImageCoordinates;
+    this->m_Transform->GetJacobian( point, jacj, jacind );
+
+    /** Apply scales, if necessary. */
+    if( this->m_UseScales )
+    {
+      for( unsigned int pi = 0; pi < sizejacind; ++pi )
+      {
+        const unsigned int p = jacind[ pi ];
+        jacj.scale_column( pi, 1.0 / scales[ p ] );
+      }
+    }
+
+    /** Compute 1st part of JJ: ||J_j||_F^2. */
+    double JJ_j = vnl_math::sqr( jacj.frobenius_norm() );
+
+    /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
+    vnl_fastops::ABt( jacjjacj, jacj, jacj );
+    JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
+
+    /** Max_j [JJ_j]. */
+    maxJJ = std::max( maxJJ, JJ_j );
+
+    /** Compute JCJ_j. */
+    double JCJ_j = 0.0;
+
+    /** J_j C = jacjC. */
+    jacjcov.Fill( 0.0 );
+
+    /** Store the nonzero Jacobian indices in a different format
+     * and create the sparse diagcov.
+     */
+    for( unsigned int pi = 0; pi < sizejacind; ++pi )
+    {
+      const unsigned int p = jacind[ pi ];
+      jacindExpanded[ p ] = pi;
+      diagcovsparse[ pi ] = this->m_DiagCovariance[ p ];
+    }
+
+    /** We below calculate jacjC = J_j cov^T, see ComputeSingleThreaded().
+     * The covariance matrix is only read here, so it is safely shared.
+     */
+    for( unsigned int pi = 0; pi < sizejacind; ++pi )
+    {
+      const unsigned int p = jacind[ pi ];
+      if( !this->m_Covariance.empty_row( p ) )
+      {
+        const SparseRowType & covrowp = this->m_Covariance.get_row( p );
+        typename SparseRowType::const_iterator covrowpit;
+
+        /** Loop over row p of the sparse cov matrix. */
+        for( covrowpit = covrowp.begin(); covrowpit != covrowp.end(); ++covrowpit )
+        {
+          const unsigned int q  = ( *covrowpit ).first;
+          const unsigned int qi = jacindExpanded[ q ];
+
+          if( qi < sizejacind )
+          {
+            /** If found, update the jacjC matrix. */
+            const CovarianceValueType covElement = ( *covrowpit ).second;
+            for( unsigned int dx = 0; dx < outdim; ++dx )
+            {
+              jacjcov[ dx ][ pi ] += jacj[ dx ][ qi ] * covElement;
+            } //dx
+          }   // if qi < sizejacind
+        }     // for covrow
+
+      } // if not empty row
+    }   // pi
+
+    /** J_j C J_j^T  = jacjCjacj.
+     * But note that we actually compute J_j cov' J_j^T
+     */
+    vnl_fastops::ABt( jacjcovjacj, jacjcov, jacj );
+
+    /** jacjCjacj = jacjCjacj+ jacjCjacj' - jacjdiagcovjacj */
+    jacjdiagcov = jacj * diagcovsparse;
+    vnl_fastops::ABt( jacjdiagcovjacj, jacjdiagcov, jacj );
+    jacjcovjacj += jacjcovjacj.transpose();
+    jacjcovjacj -= jacjdiagcovjacj;
+
+    /** Compute 1st part of JCJ: Tr( J_j C J_j^T ). */
+    for( unsigned int d = 0; d < outdim; ++d )
+    {
+      JCJ_j += jacjcovjacj[ d ][ d ];
+    }
+
+    /** Compute 2nd part of JCJ_j: 2 \sqrt{2} || J_j C J_j^T ||_F. */
+    JCJ_j += 2.0 * sqrt2 * jacjcovjacj.frobenius_norm();
+
+    /** Max_j [JCJ_j]. */
+    maxJCJ = std::max( maxJCJ, JCJ_j );
+
+    /** Reset jacindExpanded. */
+    for( unsigned int pi = 0; pi < sizejacind; ++pi )
+    {
+      jacindExpanded[ jacind[ pi ] ] = sizejacind;
+    }
+
+  } // end loop over samples
+
+  /** Store the maxima of this thread. */
+  this->m_ComputePerThreadVariables[ threadId ].st_MaxJJ  = maxJJ;
+  this->m_ComputePerThreadVariables[ threadId ].st_MaxJCJ = maxJCJ;
+
+} // end ThreadedComputeMaxima()
+
+
+/**
+ * ************************* ComputeSingleThreaded ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ComputeSingleThreaded( double & TrC, double & TrCC, double & maxJJ, double & maxJCJ )
+{
+  /** This function computes four terms needed for the automatic parameter
+   * estimation. The equation number refers to the IJCV paper.
+   * Term 1: TrC, which is the trace of the covariance matrix, needed in (34):
+   *    C = 1/n \sum_{i=1}^n J_i^T J_i    (25)
+   *    with n the number of samples, J_i the Jacobian of the i-th sample.
+   * Term 2: TrCC, which is the Frobenius norm of C, needed in (60):
+   *    ||C||_F^2 = trace( C^T C )
+   * To compute equations (47) and (54) we need the four sub-terms:
+   *    A: trace( J_j C J_j^T )  in (47)
+   *    B: || J_j C J_j^T ||_F   in (47)
+   *    C: || J_j ||_F^2         in (54)
+   *    D: || J_j J_j^T ||_F     in (54)
+   * Term 3: maxJJ, see (47)
+   * Term 4: maxJCJ, see (54)
+   */
+
+  /** Initialize. */
+  TrC = TrCC = maxJJ = maxJCJ = 0.0;
+
+  /** Get samples. */
+  ImageSampleContainerPointer sampleContainer; // default-constructed (null)
+  SampleFixedImageForJacobianTerms( sampleContainer );
+  const SizeValueType nrofsamples = sampleContainer->Size();
+  const double        n           = static_cast< double >( nrofsamples );
+
+  /** Get the number of parameters. */
+  const unsigned int P = static_cast< unsigned int >(
+    this->m_Transform->GetNumberOfParameters() );
+
+  /** Get transform and set current position. */
+  typename TransformType::Pointer transform
+    = this->m_Transform;
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
+
+  /** Get scales vector */
+  const ScalesType & scales = this->m_Scales;
 
-  /** Compute the number of bands. */
-  const unsigned int bandcovsize = std::min( this->m_MaxBandCovSize,
-    static_cast< unsigned int >( difHist2.size() ) );
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator iter;
+  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
+  unsigned int samplenr = 0;
 
-  /** Maps parameterNrDifference (q-p) to colnr in bandcov. */
-  std::vector< unsigned int > bandcovMap( P, bandcovsize );
-  /** Maps colnr in bandcov to parameterNrDifference (q-p). */
-  std::vector< unsigned int > bandcovMap2( bandcovsize, P );
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  NumberOfParametersType sizejacind
+    = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+  jacind[ 0 ] = 0;
+  if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
+  NonZeroJacobianIndicesType prevjacind = jacind;
 
-  /** Sort the difHist2 based on the frequencies. */
-  std::sort( difHist2.begin(), difHist2.end() );
+  /** Initialize covariance matrix. Sparse, diagonal, and band form. */
+  SparseCovarianceMatrixType cov( P, P );
+  DiagCovarianceMatrixType   diagcov( P, 0.0 );
+  CovarianceMatrixType       bandcov;
 
-  /** Determine the bands that are expected to be most dominant. */
-  DifHist2Type::iterator difHist2It = difHist2.end();
-  for( unsigned int b = 0; b < bandcovsize; ++b )
-  {
-    --difHist2It;
-    bandcovMap[ difHist2It->second ] = b;
-    bandcovMap2[ b ]                 = difHist2It->second;
-  }
+  /** For temporary storage of J'J. */
+  CovarianceMatrixType jactjac( sizejacind, sizejacind );
+  jactjac.Fill( 0.0 );
+
+  /** Guess the band structure of the covariance matrix. */
+  std::vector< unsigned int > bandcovMap;
+  std::vector< unsigned int > bandcovMap2;
+  const unsigned int          bandcovsize = this->EstimateBandStructure(
+    sampleContainer, bandcovMap, bandcovMap2 );
 
   /** Initialize band matrix. */
   bandcov = CovarianceMatrixType( P, bandcovsize );
@@ -336,52 +821,12 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   }
   bandcov.set_size( 0, 0 );
 
-  /** Apply scales. the use of m_Scales maybe something wrong. */
-  if( this->m_UseScales )
-  {
-    for( unsigned int p = 0; p < P; ++p )
-    {
-      cov.scale_row( p, 1.0 / this->m_Scales[ p ] );
-    }
-    /**  \todo: this might be faster with get_row instead of the iterator */
-    cov.reset();
-    bool notfinished = cov.next();
-    while( notfinished )
-    {
-      const int col = cov.getcolumn();
-      cov( cov.getrow(), col ) /= scales[ col ];
-      notfinished               = cov.next();
-    }
-  }
-
-  /** Compute TrC = trace(C), and diagcov. */
-  for( unsigned int p = 0; p < P; ++p )
-  {
-    if( !cov.empty_row( p ) )
-    {
-      //avoid creation of element if the row is empty
-      CovarianceValueType & covpp = cov( p, p );
-      TrC         += covpp;
-      diagcov[ p ] = covpp;
-    }
-  }
-
   /**
    *    TERM 2
    *
-   * Compute TrCC = ||C||_F^2.
+   * Compute TrC = trace(C) and TrCC = ||C||_F^2, after applying the scales.
    */
-  cov.reset();
-  bool notfinished2 = cov.next();
-  while( notfinished2 )
-  {
-    TrCC        += vnl_math::sqr( cov.value() );
-    notfinished2 = cov.next();
-  }
-
-  /** Symmetry: multiply by 2 and subtract sumsqr(diagcov). */
-  TrCC *= 2.0;
-  TrCC -= diagcov.diagonal().squared_magnitude();
+  this->ComputeTraces( cov, diagcov, TrC, TrCC );
 
   /**
    *    TERM 3 and 4
@@ -511,7 +956,189 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   /** Finalize progress information. */
   //progressObserver->PrintProgress( 1.0 );
 
-} // end Compute()
+} // end ComputeSingleThreaded()
+
+
+/**
+ * ************************* EstimateBandStructure ************************
+ */
+
+template< class TFixedImage, class TTransform >
+unsigned int
+ComputeJacobianTerms< TFixedImage, TTransform >
+::EstimateBandStructure(
+  const ImageSampleContainerType * sampleContainer,
+  std::vector< unsigned int > & bandcovMap,
+  std::vector< unsigned int > & bandcovMap2 ) const
+{
+  const SizeValueType nrofsamples = sampleContainer->Size();
+  const unsigned int  P           = static_cast< unsigned int >(
+    this->m_Transform->GetNumberOfParameters() );
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  const NumberOfParametersType sizejacind
+    = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+
+  typedef std::vector< unsigned int >             DifHistType;
+  typedef std::pair< unsigned int, unsigned int > FreqPairType;
+  typedef std::vector< FreqPairType >             DifHist2Type;
+  DifHist2Type difHist2;
+
+  /** DifHist is a histogram of absolute parameterNrDifferences that
+   * occur in the nonzerojacobianindex vectors.
+   * DifHist2 is another way of storing the histogram, as a vector
+   * of pairs. pair.first = Frequency, pair.second = parameterNrDifference.
+   * This is useful for sorting.
+   */
+  DifHistType difHist( P, 0 );
+
+  /** Try to guess the band structure of the covariance matrix.
+   * A 'band' is a series of elements cov(p,q) with constant q-p.
+   * In the loop below, on a few positions in the image the Jacobian
+   * is computed. The nonzerojacobianindices are inspected to figure out
+   * which values of q-p occur often. This is done by making a histogram.
+   * The histogram is then sorted and the most occurring bands
+   * are determined. The covariance elements in these bands will not
+   * be stored in the sparse matrix structure 'cov', but in the band
+   * matrix 'bandcov', which is much faster.
+   * Only after the bandcov and cov have been filled (by looping over
+   * all Jacobian measurements in the sample container, the bandcov
+   * matrix is injected in the cov matrix, for easy further calculations,
+   * and the bandcov matrix is deleted.
+   */
+  unsigned int onezero = 0;
+  for( unsigned int s = 0; s < this->m_NumberOfBandStructureSamples; ++s )
+  {
+    /** Semi-randomly get some samples from the sample container. */
+    const unsigned int samplenr = ( s + 1 ) * nrofsamples
+      / ( this->m_NumberOfBandStructureSamples + 2 + onezero );
+    onezero = 1 - onezero; // introduces semi-randomness
+
+    /** Read fixed coordinates and get Jacobian J_j. */
+    const FixedImagePointType & point
+      = sampleContainer->GetElement( samplenr ).m_ImageCoordinates;
+    this->m_Transform->GetJacobian( point, jacj, jacind );
+
+    /** Skip invalid Jacobians in the beginning, if any. */
+    if( sizejacind > 1 )
+    {
+      if( jacind[ 0 ] == jacind[ 1 ] ) { continue; }
+    }
+
+    /** Fill the histogram of parameter nr differences. */
+    for( unsigned int i = 0; i < sizejacind; ++i )
+    {
+      const int jacindi = static_cast< int >( jacind[ i ] );
+      for( unsigned int j = i; j < sizejacind; ++j )
+      {
+        const int jacindj = static_cast< int >( jacind[ j ] );
+        difHist[ static_cast< unsigned int >( std::abs( jacindj - jacindi ) ) ]++;
+      }
+    }
+  }
+
+  /** Copy the nonzero elements of the difHist to a vector pairs. */
+  for( unsigned int p = 0; p < P; ++p )
+  {
+    const unsigned int freq = difHist[ p ];
+    if( freq != 0 )
+    {
+      difHist2.push_back( FreqPairType( freq, p ) );
+    }
+  }
+  difHist.resize( 0 );
+
+  /** Compute the number of bands. */
+  const unsigned int bandcovsize = std::min( this->m_MaxBandCovSize,
+    static_cast< unsigned int >( difHist2.size() ) );
+
+  /** Maps parameterNrDifference (q-p) to colnr in bandcov. */
+  bandcovMap.assign( P, bandcovsize );
+  /** Maps colnr in bandcov to parameterNrDifference (q-p). */
+  bandcovMap2.assign( bandcovsize, P );
+
+  /** Sort the difHist2 based on the frequencies. */
+  std::sort( difHist2.begin(), difHist2.end() );
+
+  /** Determine the bands that are expected to be most dominant. */
+  DifHist2Type::iterator difHist2It = difHist2.end();
+  for( unsigned int b = 0; b < bandcovsize; ++b )
+  {
+    --difHist2It;
+    bandcovMap[ difHist2It->second ] = b;
+    bandcovMap2[ b ]                 = difHist2It->second;
+  }
+
+  return bandcovsize;
+
+} // end EstimateBandStructure()
+
+
+/**
+ * ************************* ComputeTraces ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ComputeTraces( SparseCovarianceMatrixType & cov,
+  DiagCovarianceMatrixType & diagcov, double & TrC, double & TrCC ) const
+{
+  const unsigned int P      = cov.rows();
+  const ScalesType & scales = this->m_Scales;
+
+  TrC = TrCC = 0.0;
+  diagcov.set_size( P );
+  diagcov.fill( 0.0 );
+
+  /** Apply scales. the use of m_Scales maybe something wrong. */
+  if( this->m_UseScales )
+  {
+    for( unsigned int p = 0; p < P; ++p )
+    {
+      cov.scale_row( p, 1.0 / this->m_Scales[ p ] );
+    }
+    /**  \todo: this might be faster with get_row instead of the iterator */
+    cov.reset();
+    bool notfinished = cov.next();
+    while( notfinished )
+    {
+      const int col = cov.getcolumn();
+      cov( cov.getrow(), col ) /= scales[ col ];
+      notfinished               = cov.next();
+    }
+  }
+
+  /** Compute TrC = trace(C), and diagcov. */
+  for( unsigned int p = 0; p < P; ++p )
+  {
+    if( !cov.empty_row( p ) )
+    {
+      //avoid creation of element if the row is empty
+      CovarianceValueType & covpp = cov( p, p );
+      TrC         += covpp;
+      diagcov[ p ] = covpp;
+    }
+  }
+
+  /** Compute TrCC = ||C||_F^2. */
+  cov.reset();
+  bool notfinished2 = cov.next();
+  while( notfinished2 )
+  {
+    TrCC        += vnl_math::sqr( cov.value() );
+    notfinished2 = cov.next();
+  }
+
+  /** Symmetry: multiply by 2 and subtract sumsqr(diagcov). */
+  TrCC *= 2.0;
+  TrCC -= diagcov.diagonal().squared_magnitude();
+
+} // end ComputeTraces()
 
 
 /**
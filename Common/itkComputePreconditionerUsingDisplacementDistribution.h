@@ -20,6 +20,9 @@
 
 #include "itkComputeDisplacementDistribution.h"
 
+#include <unordered_map>
+#include <vector>
+
 
 namespace itk
 {
@@ -116,6 +119,13 @@ public:
   /** Interpolate the preconditioner, for the non-visited entries. */
   virtual void PreconditionerInterpolation( ParametersType & preconditioner );
 
+  /** Get the time in seconds spent on the exact gradient, and on the
+   * multi-threaded loop over the Jacobians of the samples, during the last
+   * computation of the preconditioner.
+   */
+  itkGetConstMacro( GradientComputationTime, double );
+  itkGetConstMacro( JacobianComputationTime, double );
+
 protected:
 
   ComputePreconditionerUsingDisplacementDistribution();
@@ -143,11 +153,55 @@ protected:
   double m_RegularizationKappa;
   double m_ConditionNumber;
 
+  /** The preconditioner estimation methods. */
+  typedef enum {
+    DisplacementDistributionMethod,
+    BSplineOnlyMethod,
+    JacobiTypeMethod } PreconditionerMethodType;
+
+  /** The accumulated terms of the preconditioner for one parameter. */
+  struct PreconditionerTermsType
+  {
+    double st_Sum;
+    double st_SumSquared;
+    double st_Count;
+  };
+
+  /** The terms accumulated by one thread. Only the parameters that are
+   * touched by the samples of the thread are stored, so that the memory
+   * does not scale with the number of threads times the number of parameters.
+   */
+  struct PreconditionerPerThreadStruct
+  {
+    std::unordered_map< unsigned long, unsigned int > st_Slots;
+    std::vector< PreconditionerTermsType >            st_Terms;
+    double                                            st_MaxJJ;
+  };
+
+  /** Compute the terms of all samples multi-threaded, and gather them in
+   * preconditioner (the sums), sumSquared and count.
+   */
+  virtual void ComputePreconditionerTerms( const ParametersType & mu,
+    const PreconditionerMethodType method, double & maxJJ,
+    ParametersType & preconditioner, std::vector< double > & sumSquared,
+    std::vector< double > & count );
+
+  /** ComputePreconditionerTerms threader callback function. */
+  static ITK_THREAD_RETURN_TYPE ComputePreconditionerTermsThreaderCallback( void * arg );
+
+  /** The threaded implementation of ComputePreconditionerTerms(). */
+  virtual void ThreadedComputePreconditionerTerms( ThreadIdType threadID );
+
 private:
 
   ComputePreconditionerUsingDisplacementDistribution( const Self & ); // purposely not implemented
   void operator=( const Self & );                  // purposely not implemented
 
+  PreconditionerMethodType                     m_PreconditionerMethod;
+  std::vector< PreconditionerPerThreadStruct > m_PreconditionerPerThreadVariables;
+  double                                       m_GradientComputationTime;
+  double                                       m_JacobianComputationTime;
+
 };
 
 } // end namespace itk
@@ -28,6 +28,7 @@
 #include "itkMirrorPadImageFilter.h"
 #include "itkZeroFluxNeumannPadImageFilter.h"
 #include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkTimeProbe.h"
 
 #include <cmath> // For abs.
 
@@ -42,9 +43,12 @@ template< class TFixedImage, class TTransform >
 ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
 ::ComputePreconditionerUsingDisplacementDistribution()
 {
-  this->m_RegularizationKappa = 0.8;
-  this->m_MaximumStepLength   = 1.0;
-  this->m_ConditionNumber     = 2.0;
+  this->m_RegularizationKappa     = 0.8;
+  this->m_MaximumStepLength       = 1.0;
+  this->m_ConditionNumber         = 2.0;
+  this->m_PreconditionerMethod    = DisplacementDistributionMethod;
+  this->m_GradientComputationTime = 0.0;
+  this->m_JacobianComputationTime = 0.0;
 } // end Constructor
 
 
@@ -86,206 +90,25 @@ ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
 ::ComputeForBSplineOnly( const ParametersType & mu,
   const double & delta, double & maxJJ, ParametersType & preconditioner )
 {
-  // Select one of the following:
-  //#define METHOD_BSPLINE 1 // weights method: 1's in middle, 0's on the outside (original code by Yuchuan)
-  //#define METHOD_BSPLINE 2 // weights method: 1's everywhere
-  #define METHOD_BSPLINE 3 // weights method: Use the Jacobian
-
   /** This function computes four terms needed for the automatic parameter
    * estimation using voxel displacement distribution estimation method.
    * The equation number refers to the SPIE paper.
    * Term 1: jacg = mean( J_j * g ) + var( J_j * g ).
+   * The Jacobian is used as weights for the displacements.
    */
 
   /** Get the number of parameters. */
   const unsigned int P = static_cast< unsigned int >(
     this->m_Transform->GetNumberOfParameters() );
 
-  /** Get the exact gradient. Uses a random coordinate sampler with
-   * NumberOfSamplesForPrecondition samples, which equals P.
-   */
-  DerivativeType exactgradient( P );
-  this->GetScaledDerivative( mu, exactgradient );
-
-  /** Get samples. Uses a grid sampler with m_NumberOfJacobianMeasurements samples. */
-  ImageSampleContainerPointer sampleContainer;
-  this->SampleFixedImageForJacobianTerms( sampleContainer );
-  const SizeValueType nrofsamples = sampleContainer->Size();
-
-  /** Get transform and set current position. */
-  typename TransformType::Pointer transform = this->m_Transform;
-  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
-
-  /** Variables for nonzerojacobian indices and the Jacobian. */
-  const SizeValueType sizejacind
-    = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
-  JacobianType jacj( outdim, sizejacind );
-  jacj.Fill( 0.0 );
-  NonZeroJacobianIndicesType jacind( sizejacind );
-
-  /**
-   * Compute jac * gradient
+  /** Accumulate the weighted displacements of all samples, multi-threaded.
+   * maxJJ is not computed by this method.
    */
-  DerivativeType jacj_g( outdim );
-  jacj_g.Fill( 0.0 );
-  double                globalDeformation = 0.0;
-  double                globalDeformationSquare = 0.0;
-
-  std::vector< double > localStepSizeSquared( P, 0.0 );
-
-  /** Create a compact region. */
-  // MS: Better cast transform to a B-spline transform and ask for
-  // spline order, which implicates support region size
-  // MS: why is all this needed?
-  // MS: ok, to have 1's in the middle and 0 in outer rim
-#if METHOD_BSPLINE == 1
-  typename FixedImageType::Pointer compactImage = FixedImageType::New();
-  FixedImageRegionType supportRegion;
-  FixedImageRegionType compactRegion;
-
-  typename FixedImageRegionType::SizeType size;
-  unsigned int supportRegionSize = sizejacind / outdim;
-  double supportRegionDimension = 1;
-  if( outdim == 3 )
-  {
-    supportRegionDimension = std::cbrt( double(supportRegionSize) );
-  }
-  else if( outdim == 2 )
-  {
-    supportRegionDimension = vnl_math::sqr( double(supportRegionSize) );
-  }
-  size.Fill( supportRegionDimension );
-
-  typename FixedImageRegionType::IndexType startIndex;
-  startIndex.Fill(0);
-  supportRegion.SetSize( size );
-  supportRegion.SetIndex( startIndex );
-
-  compactImage->SetRegions( supportRegion );
-  compactImage->Allocate();
-  compactImage->FillBuffer(0);
-
-  typename FixedImageRegionType::IndexType compactIndex;
-  compactIndex.Fill(1);
-  SizeValueType compactRegionDimension;
-  if ( supportRegionDimension == 4 )
-  {
-    compactRegionDimension = 2;
-  }
-  else
-  {
-    compactRegionDimension = supportRegionDimension - 1;
-  }
-  size.Fill(compactRegionDimension);
-  compactRegion.SetSize( size );
-  compactRegion.SetIndex( compactIndex );
-
-  itk::ImageRegionIterator< FixedImageType > compactImageIterator( compactImage,compactRegion );
-  int testIter = 0;
-  while( !compactImageIterator.IsAtEnd() )
-  {
-    compactImageIterator.Set( 1 );
-    ++compactImageIterator;
-  }
-  const FixedImagePixelType * compactSupportVector = compactImage->GetBufferPointer();
-#endif
-
-  /** Loop over all voxels in the sample container. */
-  ParametersType binCount( P );
-  binCount.Fill( 0.0 );
-  unsigned int samplenr = 0; // needed for global value only
-
-  for( iter = begin; iter != end; ++iter )
-  {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind );
-
-    /** Compute the product jac_j * gradient. */
-    for( unsigned int i = 0; i < outdim; ++i )
-    {
-      double temp = 0.0;
-      for( unsigned int j = 0; j < sizejacind; ++j )
-      {
-        int pj = jacind[ j ];
-        temp += jacj( i, j ) * exactgradient( pj );
-      }
-
-      // Use the absolute value
-      jacj_g( i ) = std::abs( temp );
-    }
-
-    /** A support region is where this voxel has the affect on the B-Spline
-     * grid mesh, which means each voxel has an influence on multiple grid
-     * control point, or means each control point is determined by multiple
-     * voxels.
-     */
-    for( unsigned int j = 0; j < sizejacind; ++j )
-    {
-      /** Select the only nonzero entry of the displacement jacj_g (B-spline specific). */
-      //const unsigned int nonzerodim = j / ( sizejacind / outdim );
-      //double displacement = jacj_g[ nonzerodim ];
-      // For the affine transform the nonzero dim would be different
-      // For a generic transform we would need the norm over all dimensions
-
-      unsigned int nonzerodim = j / outdim;                         // Affine, first 9 parameters
-      if( j >= outdim * outdim ) nonzerodim = j - outdim * outdim;  // Affine, last 3
-      if( P > 13 ) nonzerodim = j / ( sizejacind / outdim );        // B-spline
-
-      double displacement = jacj_g[nonzerodim];
-
-#if METHOD_BSPLINE == 1
-      /** Add the deformations on the compact support region. */
-      /** Count the numbers of the contributed voxels. */
-      if( compactSupportVector[ j % supportRegionSize ] > 0 )
-      {
-        int pj = jacind[ j ];
-        preconditioner[ pj ] += displacement;
-        localStepSizeSquared[ pj ] += displacement * displacement;
-        binCount[ pj ] += 1;
-      }
-      // MS: as far as I understand the above code compactSupportVector[.] will
-      // be 1 in the middle and 0 in the outer rim.
-#elif METHOD_BSPLINE == 2
-      // MS: the following will be all 1 in the complete support region
-      int pj = jacind[ j ];
-      preconditioner[ pj ] += displacement;
-      localStepSizeSquared[ pj ] += displacement * displacement;
-      binCount[ pj ] += 1;
-#elif METHOD_BSPLINE == 3
-      // MS: the following will use the Jacobian as weights
-      const unsigned int pj = jacind[ j ];
-      const double weight = std::abs( jacj( nonzerodim, j ) );
-      // YQ: the weight is positive.
-
-      /** localStepSize keeps track of the mean displacement.
-       * localStepSizeSquared keeps track of the standard deviation.
-       */
-      preconditioner[ pj ] += weight * displacement;
-      localStepSizeSquared[ pj ] += weight * displacement * displacement;
-      binCount[ pj ] += weight;
-#endif
-    }
-
-    /** Add them for global step size. */
-    double voxelDeformationTmp = jacj_g.magnitude();
-    globalDeformation += voxelDeformationTmp;
-    globalDeformationSquare += voxelDeformationTmp * voxelDeformationTmp;
-
-    ++samplenr;
-  } // end loop over sample container
-
-  /** Compute the sigma of the distribution of JGG_k.
-  double meanGlobalDeformation = globalDeformation / samplenr;
-  double global_sigma = globalDeformationSquare - meanGlobalDeformation * globalDeformation;
-  global_sigma /= ( nrofsamples - 1 ); // unbiased estimation
-  globalStepSize = meanGlobalDeformation + 2.0 * std::sqrt( global_sigma );
-  */
+  double                maxJJ_unused = 0.0;
+  std::vector< double > localStepSizeSquared;
+  std::vector< double > binCount;
+  this->ComputePreconditionerTerms( mu, BSplineOnlyMethod, maxJJ_unused,
+    preconditioner, localStepSizeSquared, binCount );
 
   /** Convert the local step sizes to a scaling factor. */
   unsigned int counter_tmp = 0;
@@ -311,15 +134,6 @@ ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
     {
       ++counter_tmp;
     }
-
-#if 0
-    elxout << std::scientific;
-    elxout << "The preconditioner before interpolation: [ ";
-    //elxout << sigma << " ";
-    elxout << preconditioner[i] << " ";
-    elxout << "]" << std::endl;
-    elxout << std::fixed;
-#endif
   } // end loop over localStepSize vector
 
   if( counter_tmp > 0 )
@@ -340,9 +154,6 @@ ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
 ::Compute( const ParametersType & mu,
   double & maxJJ, ParametersType & preconditioner )
 {
-  /** Initialize. */
-  maxJJ = 0.0;
-
   /** Get the number of parameters. */
   const unsigned int P = static_cast< unsigned int >(
     this->m_Transform->GetNumberOfParameters() );
@@ -351,177 +162,11 @@ ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
   bool transformIsBSpline = false;
   if( P > 13 ) transformIsBSpline = true; // assume B-spline
 
-  /** Get the exact gradient. Uses a random coordinate sampler with
-   * NumberOfSamplesForPrecondition samples, which equals P.
-   */
-  DerivativeType exactgradient( P );
-  this->GetScaledDerivative( mu, exactgradient );
-
-  /** Get samples. Uses a grid sampler with m_NumberOfJacobianMeasurements samples. */
-  ImageSampleContainerPointer sampleContainer;
-  this->SampleFixedImageForJacobianTerms( sampleContainer );
-  const SizeValueType nrofsamples = sampleContainer->Size();
-
-  /** Get transform and set current position. */
-  typename TransformType::Pointer transform = this->m_Transform;
-  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
-
-  /** Variables for nonzerojacobian indices and the Jacobian. */
-  const SizeValueType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
-  JacobianType jacj( outdim, sizejacind );
-  jacj.Fill( 0.0 );
-  NonZeroJacobianIndicesType jacind( sizejacind );
-
-  /** Declare temporary variables. Not needed for all methods. check later */
-  DerivativeType jacj_g( outdim );
-  jacj_g.Fill( 0.0 );
-  JacobianType          jacjjacj( outdim, outdim );
-  const double          sqrt2 = std::sqrt( static_cast< double >( 2.0 ) );
-  std::vector< double > localStepSizeSquared( P, 0.0 );
-  ParametersType binCount( P );
-  binCount.Fill( 0.0 );
-
-  /** Loop over all voxels in the sample container. */
-  for( iter = begin; iter != end; ++iter )
-  {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind );
-
-    /** Compute 1st part of JJ: ||J_j||_F^2. */
-    double JJ_j = vnl_math::sqr( jacj.frobenius_norm() );
-
-    /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
-    vnl_fastops::ABt( jacjjacj, jacj, jacj );
-    JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
-
-    /** Max_j [JJ_j]. */
-    maxJJ = std::max( maxJJ, JJ_j );
-
-    double displacement2_j = 0.0;
-    if( transformIsBSpline )
-    {
-      for( unsigned int i = 0; i < outdim; ++i )
-      {
-        double temp = 0.0;
-        for( unsigned int j = 0; j < sizejacind; ++j )
-        {
-          int pj = jacind[ j ];
-          temp += jacj( i, j ) * exactgradient( pj );
-        }
-
-        // Use the absolute value
-        jacj_g( i ) = std::abs( temp );
-      }
-      displacement2_j = jacj_g.magnitude();
-    }
-
-    /** Update all entries of the pre-conditioner. */
-    for( unsigned int j = 0; j < sizejacind; ++j )
-    {
-      const unsigned int pj = jacind[ j ];
-      double displacement_j = 0.0;
-      double jacj_current = 0.0;
-      for( unsigned int i = 0; i < outdim; ++i )
-      {
-        jacj_current += std::abs( jacj( i, j ) );
-      }
-      displacement_j = std::abs( jacj_current * exactgradient( pj ) );
-
-      if( transformIsBSpline )
-      {
-        displacement_j = displacement_j * this->m_RegularizationKappa
-          + ( 1.0 - this->m_RegularizationKappa ) * displacement2_j;
-      }
-      else
-      { // else for affine and rigid
-        double diff_jacobian = 0;
-        double weight = 0;
-        double sum_displacement = 0;
-        double sum_weight = 0;
-        double weight_sigma = 0.01;
-        double maxdiff = 0.0;
-        double mindiff = 0.0;
-        bool   mindiffCheck = true;
-
-        /** Obtain the maximum and minimum difference of absolute jacobian. */
-        for( unsigned int k = 0; k < sizejacind; ++k )
-        {
-          if( k != j )
-          {
-            double jacj_k = 0.0;
-            for( unsigned int i = 0; i < outdim; ++i )
-            {
-              jacj_k += std::abs( jacj( i, k ) );
-            }
-            diff_jacobian = std::abs( jacj_k - jacj_current );
-            if( diff_jacobian > 0 && mindiffCheck )
-            {
-              mindiff = diff_jacobian;
-              mindiffCheck = false;
-            }
-            if( diff_jacobian > 0 && !mindiffCheck )
-            {
-              mindiff = diff_jacobian < mindiff ? diff_jacobian : mindiff;
-            }
-            maxdiff = diff_jacobian > maxdiff ? diff_jacobian : maxdiff;
-          } // end if
-        } // end for
-
-        if( maxdiff > 0 )
-        {
-          weight_sigma = mindiff / maxdiff;
-        }
-        else
-        {
-          weight_sigma = 1e-9;
-        }
-
-        /** To regularize the other entries using the neighborhood information. */
-        for( unsigned int k = 0; k < sizejacind; ++k )
-        {
-          const unsigned int pk = jacind[ k ];
-          if( k != j )
-          {
-            double jacj_k = 0.0;
-            for( unsigned int i = 0; i < outdim; ++i )
-            {
-              jacj_k += std::abs( jacj( i, k ) );
-            }
-
-            diff_jacobian = std::abs( jacj_k - jacj_current );
-            weight = std::exp( -( vnl_math::sqr( diff_jacobian / weight_sigma ) / 2.0 ) );
-
-            sum_displacement += std::abs( jacj_k * exactgradient( pk ) ) * weight;
-            sum_weight += weight;
-          } // end if
-        } // end for loop regularization
-
-        if( sum_weight > 0.0 )
-        {
-          sum_displacement /= sum_weight;
-
-          /** regularize. */
-          displacement_j = displacement_j * this->m_RegularizationKappa
-            + ( 1.0 - this->m_RegularizationKappa ) * sum_displacement;
-        }
-      } // end else for affine and rigid
-
-      /** Compute the displacement due to a change in this parameter. */
-      /** localStepSize keeps track of the mean displacement.
-        * localStepSizeSquared keeps track of the standard deviation.
-        */
-      preconditioner[ pj ] += displacement_j;
-      localStepSizeSquared[ pj ] += displacement_j * displacement_j;
-      binCount[ pj ] += 1.0;
-    }
-  } // end loop over sample container
-
+  /** Accumulate the displacements of all samples, multi-threaded. */
+  std::vector< double > localStepSizeSquared;
+  std::vector< double > binCount;
+  this->ComputePreconditionerTerms( mu, DisplacementDistributionMethod, maxJJ,
+    preconditioner, localStepSizeSquared, binCount );
 
   /** Compute the mean local step sizes and apply the 2 sigma rule. */
   double maxEigenvalue = -1e+9;
@@ -591,68 +236,20 @@ ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
 ::ComputeJacobiTypePreconditioner( const ParametersType & mu,
   double & maxJJ, ParametersType & preconditioner )
 {
-  /** Initialize. */
-  maxJJ = 0.0;
-
   /** Get the number of parameters. */
   const unsigned int P = static_cast< unsigned int >(
     this->m_Transform->GetNumberOfParameters() );
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
 
   // Replace by a general check later.
   bool transformIsBSpline = false;
   if( P > 13 ) transformIsBSpline = true; // assume B-spline
 
-  /** Get samples. Uses a grid sampler with m_NumberOfJacobianMeasurements samples. */
-  ImageSampleContainerPointer sampleContainer;
-  this->SampleFixedImageForJacobianTerms( sampleContainer );
-  const SizeValueType nrofsamples = sampleContainer->Size();
-
-  /** Get transform and set current position. */
-  typename TransformType::Pointer transform = this->m_Transform;
-  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end = sampleContainer->End();
-
-  /** Variables for nonzerojacobian indices and the Jacobian. */
-  const SizeValueType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
-  JacobianType jacj( outdim, sizejacind );
-  jacj.Fill( 0.0 );
-  JacobianType          jacjjacj( outdim, outdim );
-  const double          sqrt2 = std::sqrt( static_cast< double >( 2.0 ) );
-  NonZeroJacobianIndicesType jacind( sizejacind );
-  ParametersType binCount( P );
-  binCount.Fill( 0.0 );
-
-  /** Loop over all voxels in the sample container. */
-  for( iter = begin; iter != end; ++iter )
-  {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind );
-
-    /** Compute 1st part of JJ: ||J_j||_F^2. */
-    double JJ_j = vnl_math::sqr( jacj.frobenius_norm() );
-
-    /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
-    vnl_fastops::ABt( jacjjacj, jacj, jacj );
-    JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
-
-    /** Max_j [JJ_j]. */
-    maxJJ = std::max( maxJJ, JJ_j );
-
-    for( unsigned int i = 0; i < outdim; ++i )
-    {
-      for( unsigned int j = 0; j < sizejacind; ++j )
-      {
-        const unsigned int pj = jacind[ j ];
-        preconditioner[ pj ] += vnl_math::sqr( jacj( i, j ) );
-        binCount[ pj ] += 1;
-      }
-    }
-  }
+  /** Accumulate the squared Jacobians of all samples, multi-threaded. */
+  std::vector< double > sumSquared_unused;
+  std::vector< double > binCount;
+  this->ComputePreconditionerTerms( mu, JacobiTypeMethod, maxJJ,
+    preconditioner, sumSquared_unused, binCount );
 
   double maxEigenvalue = -1e+9;
   double minEigenvalue = 1e+9;
@@ -703,6 +300,345 @@ ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
 } // end ComputeJacobiTypePreconditioner()
 
 
+/**
+ * ************************* ComputePreconditionerTerms ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
+::ComputePreconditionerTerms( const ParametersType & mu,
+  const PreconditionerMethodType method, double & maxJJ,
+  ParametersType & preconditioner, std::vector< double > & sumSquared,
+  std::vector< double > & count )
+{
+  /** Get the number of parameters. */
+  const unsigned int P = static_cast< unsigned int >(
+    this->m_Transform->GetNumberOfParameters() );
+  this->m_NumberOfParameters   = P;
+  this->m_PreconditionerMethod = method;
+
+  /** Get the exact gradient. Uses a random coordinate sampler with
+   * NumberOfSamplesForPrecondition samples, which equals P.
+   */
+  itk::TimeProbe timer;
+  timer.Start();
+  if( method != JacobiTypeMethod )
+  {
+    this->m_ExactGradient = DerivativeType( P );
+    this->GetScaledDerivative( mu, this->m_ExactGradient );
+  }
+  timer.Stop();
+  this->m_GradientComputationTime = timer.GetMean();
+
+  /** Get samples. Uses a grid sampler with m_NumberOfJacobianMeasurements samples. */
+  itk::TimeProbe timer2;
+  timer2.Start();
+  this->SampleFixedImageForJacobianTerms( this->m_SampleContainer );
+
+  /** Accumulate the terms per thread. */
+  const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+  this->m_PreconditionerPerThreadVariables.clear();
+  this->m_PreconditionerPerThreadVariables.resize( numberOfThreads );
+
+  this->m_Threader->SetSingleMethod( this->ComputePreconditionerTermsThreaderCallback, this );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Gather the terms of all threads, and release the thread buffers. */
+  maxJJ = 0.0;
+  preconditioner.Fill( 0.0 );
+  sumSquared.assign( P, 0.0 );
+  count.assign( P, 0.0 );
+  for( ThreadIdType t = 0; t < numberOfThreads; ++t )
+  {
+    PreconditionerPerThreadStruct & perThread = this->m_PreconditionerPerThreadVariables[ t ];
+    maxJJ = std::max( maxJJ, perThread.st_MaxJJ );
+
+    typename std::unordered_map< unsigned long, unsigned int >::const_iterator it;
+    for( it = perThread.st_Slots.begin(); it != perThread.st_Slots.end(); ++it )
+    {
+      const PreconditionerTermsType & terms = perThread.st_Terms[ it->second ];
+      preconditioner[ it->first ] += terms.st_Sum;
+      sumSquared[ it->first ]     += terms.st_SumSquared;
+      count[ it->first ]          += terms.st_Count;
+    }
+  }
+  this->m_PreconditionerPerThreadVariables.clear();
+  this->m_SampleContainer = nullptr;
+
+  timer2.Stop();
+  this->m_JacobianComputationTime = timer2.GetMean();
+
+} // end ComputePreconditionerTerms()
+
+
+/**
+ * ************ ComputePreconditionerTermsThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_TYPE
+ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
+::ComputePreconditionerTermsThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+  Self *           self       = static_cast< Self * >( infoStruct->UserData );
+
+  /** Call the real implementation. */
+  self->ThreadedComputePreconditionerTerms( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputePreconditionerTermsThreaderCallback()
+
+
+/**
+ * ************************* ThreadedComputePreconditionerTerms ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
+::ThreadedComputePreconditionerTerms( ThreadIdType threadId )
+{
+  /** Get sample container size, number of threads, and output space dimension. */
+  const SizeValueType sampleContainerSize = this->m_SampleContainer->Size();
+  const ThreadIdType  numberOfThreads     = this->m_Threader->GetNumberOfWorkUnits();
+  const unsigned int  outdim              = this->m_Transform->GetOutputSpaceDimension();
+  const unsigned int  P                   = this->m_NumberOfParameters;
+  const DerivativeType & exactgradient = this->m_ExactGradient;
+
+  // Replace by a general check later.
+  const bool transformIsBSpline = P > 13; // assume B-spline
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( numberOfThreads ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  const SizeValueType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+  NonZeroJacobianIndicesType previousJacind;
+
+  /** Temporaries. */
+  DerivativeType jacj_g( outdim );
+  jacj_g.Fill( 0.0 );
+  JacobianType                jacjjacj( outdim, outdim );
+  const double                sqrt2 = std::sqrt( static_cast< double >( 2.0 ) );
+  double                      maxJJ = 0.0;
+  std::vector< double >       jacj_abs( sizejacind );
+  std::vector< unsigned int > slots( sizejacind );
+
+  /** The terms of this thread. */
+  PreconditionerPerThreadStruct & perThread = this->m_PreconditionerPerThreadVariables[ threadId ];
+  const PreconditionerTermsType   zeroTerms = { 0.0, 0.0, 0.0 };
+
+  /** Loop over the samples of this thread. */
+  for( unsigned long pos = pos_begin; pos < pos_end; ++pos )
+  {
+    /** Read fixed coordinates and get Jacobian. */
+    const FixedImagePointType & point = this->m_SampleContainer->ElementAt( pos ).m_ImageCoordinates;
+    this->m_Transform->GetJacobian( point, jacj, jacind );
+
+    /** Look up the terms of the nonzero Jacobian indices. Neighbouring
+     * samples often share their indices, in which case the lookup is skipped.
+     */
+    if( jacind != previousJacind )
+    {
+      for( unsigned int j = 0; j < sizejacind; ++j )
+      {
+        std::pair< typename std::unordered_map< unsigned long, unsigned int >::iterator, bool > inserted
+          = perThread.st_Slots.insert( std::make_pair( jacind[ j ],
+          static_cast< unsigned int >( perThread.st_Terms.size() ) ) );
+        if( inserted.second )
+        {
+          perThread.st_Terms.push_back( zeroTerms );
+        }
+        slots[ j ] = inserted.first->second;
+      }
+      previousJacind = jacind;
+    }
+
+    if( this->m_PreconditionerMethod != BSplineOnlyMethod )
+    {
+      /** Compute 1st part of JJ: ||J_j||_F^2. */
+      double JJ_j = vnl_math::sqr( jacj.frobenius_norm() );
+
+      /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
+      vnl_fastops::ABt( jacjjacj, jacj, jacj );
+      JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
+
+      /** Max_j [JJ_j]. */
+      maxJJ = std::max( maxJJ, JJ_j );
+    }
+
+    if( this->m_PreconditionerMethod == JacobiTypeMethod )
+    {
+      for( unsigned int j = 0; j < sizejacind; ++j )
+      {
+        PreconditionerTermsType & terms = perThread.st_Terms[ slots[ j ] ];
+        for( unsigned int i = 0; i < outdim; ++i )
+        {
+          terms.st_Sum += vnl_math::sqr( jacj( i, j ) );
+        }
+        terms.st_Count += outdim;
+      }
+      continue;
+    }
+
+    /** Compute the displacement jac * gradient, if needed. */
+    double displacement2_j = 0.0;
+    if( this->m_PreconditionerMethod == BSplineOnlyMethod || transformIsBSpline )
+    {
+      for( unsigned int i = 0; i < outdim; ++i )
+      {
+        double temp = 0.0;
+        for( unsigned int j = 0; j < sizejacind; ++j )
+        {
+          int pj = jacind[ j ];
+          temp += jacj( i, j ) * exactgradient( pj );
+        }
+
+        // Use the absolute value
+        jacj_g( i ) = std::abs( temp );
+      }
+      displacement2_j = jacj_g.magnitude();
+    }
+
+    if( this->m_PreconditionerMethod == BSplineOnlyMethod )
+    {
+      /** Use the Jacobian as weights for the displacement. */
+      for( unsigned int j = 0; j < sizejacind; ++j )
+      {
+        unsigned int nonzerodim = j / outdim;                         // Affine, first 9 parameters
+        if( j >= outdim * outdim ) nonzerodim = j - outdim * outdim;  // Affine, last 3
+        if( P > 13 ) nonzerodim = j / ( sizejacind / outdim );        // B-spline
+
+        const double displacement = jacj_g[ nonzerodim ];
+        const double weight       = std::abs( jacj( nonzerodim, j ) );
+
+        /** localStepSize keeps track of the mean displacement.
+         * localStepSizeSquared keeps track of the standard deviation.
+         */
+        PreconditionerTermsType & terms = perThread.st_Terms[ slots[ j ] ];
+        terms.st_Sum        += weight * displacement;
+        terms.st_SumSquared += weight * displacement * displacement;
+        terms.st_Count      += weight;
+      }
+      continue;
+    }
+
+    /** Update all entries of the pre-conditioner. */
+    for( unsigned int j = 0; j < sizejacind; ++j )
+    {
+      double jacj_current = 0.0;
+      for( unsigned int i = 0; i < outdim; ++i )
+      {
+        jacj_current += std::abs( jacj( i, j ) );
+      }
+      jacj_abs[ j ] = jacj_current;
+    }
+
+    for( unsigned int j = 0; j < sizejacind; ++j )
+    {
+      const unsigned int pj           = jacind[ j ];
+      const double       jacj_current = jacj_abs[ j ];
+      double             displacement_j = std::abs( jacj_current * exactgradient( pj ) );
+
+      if( transformIsBSpline )
+      {
+        displacement_j = displacement_j * this->m_RegularizationKappa
+          + ( 1.0 - this->m_RegularizationKappa ) * displacement2_j;
+      }
+      else
+      { // else for affine and rigid
+        double diff_jacobian = 0;
+        double weight = 0;
+        double sum_displacement = 0;
+        double sum_weight = 0;
+        double weight_sigma = 0.01;
+        double maxdiff = 0.0;
+        double mindiff = 0.0;
+        bool   mindiffCheck = true;
+
+        /** Obtain the maximum and minimum difference of absolute jacobian. */
+        for( unsigned int k = 0; k < sizejacind; ++k )
+        {
+          if( k != j )
+          {
+            diff_jacobian = std::abs( jacj_abs[ k ] - jacj_current );
+            if( diff_jacobian > 0 && mindiffCheck )
+            {
+              mindiff = diff_jacobian;
+              mindiffCheck = false;
+            }
+            if( diff_jacobian > 0 && !mindiffCheck )
+            {
+              mindiff = diff_jacobian < mindiff ? diff_jacobian : mindiff;
+            }
+            maxdiff = diff_jacobian > maxdiff ? diff_jacobian : maxdiff;
+          } // end if
+        } // end for
+
+        if( maxdiff > 0 )
+        {
+          weight_sigma = mindiff / maxdiff;
+        }
+        else
+        {
+          weight_sigma = 1e-9;
+        }
+
+        /** To regularize the other entries using the neighborhood information. */
+        for( unsigned int k = 0; k < sizejacind; ++k )
+        {
+          const unsigned int pk = jacind[ k ];
+          if( k != j )
+          {
+            diff_jacobian = std::abs( jacj_abs[ k ] - jacj_current );
+            weight = std::exp( -( vnl_math::sqr( diff_jacobian / weight_sigma ) / 2.0 ) );
+
+            sum_displacement += std::abs( jacj_abs[ k ] * exactgradient( pk ) ) * weight;
+            sum_weight += weight;
+          } // end if
+        } // end for loop regularization
+
+        if( sum_weight > 0.0 )
+        {
+          sum_displacement /= sum_weight;
+
+          /** regularize. */
+          displacement_j = displacement_j * this->m_RegularizationKappa
+            + ( 1.0 - this->m_RegularizationKappa ) * sum_displacement;
+        }
+      } // end else for affine and rigid
+
+      /** Compute the displacement due to a change in this parameter. */
+      /** localStepSize keeps track of the mean displacement.
+        * localStepSizeSquared keeps track of the standard deviation.
+        */
+      PreconditionerTermsType & terms = perThread.st_Terms[ slots[ j ] ];
+      terms.st_Sum        += displacement_j;
+      terms.st_SumSquared += displacement_j * displacement_j;
+      terms.st_Count      += 1.0;
+    }
+  } // end loop over sample container
+
+  perThread.st_MaxJJ = maxJJ;
+
+} // end ThreadedComputePreconditionerTerms()
+
+
 /**
  * ************************* PreconditionerInterpolation ************************
  */
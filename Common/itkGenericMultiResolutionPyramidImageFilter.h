@@ -20,6 +20,11 @@
 
 #include "itkMultiResolutionPyramidImageFilter.h"
 #include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkPlatformMultiThreader.h"
+
+#include <exception>
+#include <mutex>
+#include <vector>
 
 namespace itk
 {
@@ -98,6 +103,18 @@ namespace itk
  * compute only single level of the pyramid via SetCurrentLevel() and
  * SetComputeOnlyForCurrentLevel() methods.
  *
+ * When all levels are computed at once, SetUseCascadedLevels() allows a
+ * level to be derived from the next finer level instead of from the full
+ * resolution input. This is done only when, for each dimension, the shrink
+ * factor of the coarser level is a multiple of that of the finer level, and
+ * its sigma is not smaller. Since Gaussian variances add up, the coarser
+ * level is smoothed with the residual sigma sqrt( s_coarse^2 - s_fine^2 ).
+ * The result is a close, but not bit-exact, approximation of the
+ * non-cascaded pyramid. Levels that have to be computed from the input are
+ * independent of each other, and are computed concurrently when
+ * SetComputeLevelsInParallel() is set. The peak amount of image memory
+ * allocated during the last update can be obtained with GetPeakMemoryUsage().
+ *
  * \author Denis P. Shamonin and Marius Staring. Division of Image Processing,
  * Department of Radiology, Leiden, The Netherlands
  *
@@ -220,6 +237,26 @@ public:
   itkGetConstMacro( ComputeOnlyForCurrentLevel, bool );
   itkBooleanMacro( ComputeOnlyForCurrentLevel );
 
+  /** Set/Get whether a level may be computed from the next finer level.
+   * Only used when all levels are computed at once. Default false.
+   */
+  itkSetMacro( UseCascadedLevels, bool );
+  itkGetConstMacro( UseCascadedLevels, bool );
+  itkBooleanMacro( UseCascadedLevels );
+
+  /** Set/Get whether levels that are computed from the input are computed
+   * concurrently. Only used when all levels are computed at once. Default false.
+   */
+  itkSetMacro( ComputeLevelsInParallel, bool );
+  itkGetConstMacro( ComputeLevelsInParallel, bool );
+  itkBooleanMacro( ComputeLevelsInParallel );
+
+  /** Get the peak amount of image memory in bytes, that was allocated
+   * during the last call to GenerateData(). This includes the outputs and
+   * the intermediate smoothed images.
+   */
+  itkGetConstMacro( PeakMemoryUsage, SizeValueType );
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro( SameDimensionCheck,
@@ -266,6 +303,8 @@ protected:
   unsigned int          m_CurrentLevel;
   bool                  m_ComputeOnlyForCurrentLevel;
   bool                  m_SmoothingScheduleDefined;
+  bool                  m_UseCascadedLevels;
+  bool                  m_ComputeLevelsInParallel;
 
 private:
 
@@ -284,6 +323,60 @@ private:
   typedef ImageToImageFilter< InputImageType, OutputImageType >
     ImageToImageFilterDifferentTypes;
 
+  /** Typedef for the smoother that is used when a level is computed from
+   * the next finer level.
+   */
+  typedef SmoothingRecursiveGaussianImageFilter<
+    OutputImageType, OutputImageType > CascadeSmootherType;
+
+  /** Typedefs for computing the levels that are computed from the input in
+   * parallel.
+   */
+  typedef PlatformMultiThreader      ThreaderType;
+  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
+
+  struct MultiThreaderParameterType
+  {
+    Self *                      st_Self;
+    InputImageConstPointer      st_Input;
+    std::vector< unsigned int > st_Levels;
+    ThreadIdType                st_NumberOfWorkUnitsPerLevel;
+    std::vector< std::exception_ptr > st_Exceptions;
+  };
+
+  /** Compute all levels at once, using cascading and/or
+   * computing independent levels in parallel.
+   */
+  void GenerateAllLevels( const InputImageConstPointer & input );
+
+  /** Compute a single level from the input. Contrary to the pipeline in
+   * GenerateData(), all filters are local, so that it can be called
+   * concurrently for different levels.
+   */
+  void GenerateLevelFromInput( const unsigned int level,
+    const InputImageConstPointer & input,
+    const ThreadIdType numberOfWorkUnits );
+
+  /** Compute a level from the output of the finer level finerLevel. */
+  void GenerateLevelFromFinerLevel( const unsigned int level,
+    const unsigned int finerLevel );
+
+  /** Returns true if level can be derived from finerLevel. */
+  bool CanBeCascaded( const unsigned int level,
+    const unsigned int finerLevel ) const;
+
+  /** Threader callback that computes the levels from the input. */
+  static ITK_THREAD_RETURN_TYPE GenerateLevelsThreaderCallback( void * arg );
+
+  /** Memory bookkeeping. */
+  void IncreaseMemoryUsage( const SizeValueType bytes );
+
+  void DecreaseMemoryUsage( const SizeValueType bytes );
+
+  /** Returns the size in bytes of an image with the given region. */
+  template< class TImage >
+  static SizeValueType ComputeImageSizeInBytes( const TImage * image );
+
   /** Smooth image at current level. Returns true if performed.
    * This method does not perform execution.
    */
@@ -348,6 +441,10 @@ private:
   /** Returns true if rescale has been used in pipeline, otherwise return false. */
   bool IsRescaleUsed( void ) const;
 
+  SizeValueType m_CurrentMemoryUsage;
+  SizeValueType m_PeakMemoryUsage;
+  std::mutex    m_MemoryUsageMutex;
+
 private:
 
   GenericMultiResolutionPyramidImageFilter( const Self & ); // purposely not implemented
@@ -23,6 +23,9 @@
 #include "itkResampleImageFilter.h"
 #include "itkShrinkImageFilter.h"
 #include "itkImageAlgorithm.h"
+#include "vnl/vnl_math.h"
+
+#include <algorithm>
 
 namespace // anonymous namespace
 {
@@ -65,6 +68,10 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
   temp.Fill( NumericTraits< ScalarRealType >::ZeroValue() );
   this->m_SmoothingSchedule        = temp;
   this->m_SmoothingScheduleDefined = false;
+  this->m_UseCascadedLevels        = false;
+  this->m_ComputeLevelsInParallel  = false;
+  this->m_CurrentMemoryUsage       = 0;
+  this->m_PeakMemoryUsage          = 0;
 } // end Constructor
 
 
@@ -298,6 +305,10 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
   // Get the input and output pointers
   InputImageConstPointer input = this->GetInput();
 
+  // Reset the memory bookkeeping
+  this->m_CurrentMemoryUsage = 0;
+  this->m_PeakMemoryUsage    = 0;
+
   // Check if we have to do anything at all
   if( !this->IsSmoothingUsed() && !this->IsRescaleUsed() )
   {
@@ -315,6 +326,7 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
         OutputImagePointer outputPtr = this->GetOutput( level );
         outputPtr->SetBufferedRegion( input->GetLargestPossibleRegion() );
         outputPtr->Allocate();
+        this->IncreaseMemoryUsage( ComputeImageSizeInBytes( outputPtr.GetPointer() ) );
 
         ImageAlgorithm::Copy( input.GetPointer(), outputPtr.GetPointer(),
           input->GetLargestPossibleRegion(), outputPtr->GetLargestPossibleRegion() );
@@ -329,9 +341,19 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
     this->SetSmoothingScheduleToDefault();
   }
 
+  // Cascading and parallel computation of the levels are only possible
+  // when all levels are computed at once
+  if( !this->m_ComputeOnlyForCurrentLevel
+    && ( this->m_UseCascadedLevels || this->m_ComputeLevelsInParallel ) )
+  {
+    this->GenerateAllLevels( input );
+    return;
+  }
+
   typename SmootherType::Pointer smoother;
   typename ImageToImageFilterSameTypes::Pointer rescaleSameTypes;
   typename ImageToImageFilterDifferentTypes::Pointer rescaleDifferentTypes;
+  bool smootherBufferCounted = false;
 
   for( unsigned int level = 0; level < this->m_NumberOfLevels; ++level )
   {
@@ -347,6 +369,7 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
       OutputImagePointer outputPtr = this->GetOutput( level );
       outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
       outputPtr->Allocate();
+      this->IncreaseMemoryUsage( ComputeImageSizeInBytes( outputPtr.GetPointer() ) );
 
       // Setup the smoother
       const bool smootherIsUsed = this->SetupSmoother( level, smoother, input );
@@ -356,6 +379,15 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
         smoother, smootherIsUsed, input, outputPtr,
         rescaleSameTypes, rescaleDifferentTypes );
 
+      // The smoother output is an intermediate image, which is kept
+      // until the end of this function
+      if( shrinkerOrResamplerIsUsed == 1 && !smootherBufferCounted )
+      {
+        this->IncreaseMemoryUsage( input->GetLargestPossibleRegion().GetNumberOfPixels()
+          * sizeof( typename OutputImageType::PixelType ) );
+        smootherBufferCounted = true;
+      }
+
       // Update the pipeline and graft or copy results to this filters output
       if( shrinkerOrResamplerIsUsed == 0 && smootherIsUsed )
       {
@@ -384,6 +416,365 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
 } // end GenerateData()
 
 
+/**
+ * ******************* GenerateAllLevels ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::GenerateAllLevels( const InputImageConstPointer & input )
+{
+  /** Determine for each level whether it is computed from the input (-1),
+   * or from the next finer level. The finest level is the last one.
+   */
+  const unsigned int numberOfLevels = this->m_NumberOfLevels;
+  std::vector< int > sourceLevel( numberOfLevels, -1 );
+  if( this->m_UseCascadedLevels )
+  {
+    for( unsigned int level = 0; level + 1 < numberOfLevels; ++level )
+    {
+      if( this->CanBeCascaded( level, level + 1 ) )
+      {
+        sourceLevel[ level ] = static_cast< int >( level + 1 );
+      }
+    }
+  }
+
+  std::vector< unsigned int > levelsFromInput;
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
+  {
+    if( sourceLevel[ level ] < 0 ) { levelsFromInput.push_back( level ); }
+  }
+
+  /** Compute the levels that depend on the input only. These are
+   * independent of each other, so they can be computed concurrently.
+   */
+  const ThreadIdType numberOfThreads = this->GetNumberOfWorkUnits();
+  const ThreadIdType numberOfConcurrentLevels = std::min( numberOfThreads,
+    static_cast< ThreadIdType >( levelsFromInput.size() ) );
+  if( this->m_ComputeLevelsInParallel && numberOfConcurrentLevels > 1 )
+  {
+    MultiThreaderParameterType parameters;
+    parameters.st_Self                      = this;
+    parameters.st_Input                     = input;
+    parameters.st_Levels                    = levelsFromInput;
+    parameters.st_NumberOfWorkUnitsPerLevel = std::max(
+      numberOfThreads / numberOfConcurrentLevels, static_cast< ThreadIdType >( 1 ) );
+    parameters.st_Exceptions.resize( numberOfConcurrentLevels );
+
+    ThreaderType::Pointer threader = ThreaderType::New();
+    threader->SetNumberOfWorkUnits( numberOfConcurrentLevels );
+    threader->SetSingleMethod( GenerateLevelsThreaderCallback, &parameters );
+    threader->SingleMethodExecute();
+
+    /** Pass on exceptions thrown in one of the threads. */
+    for( ThreadIdType i = 0; i < numberOfConcurrentLevels; ++i )
+    {
+      if( parameters.st_Exceptions[ i ] )
+      {
+        std::rethrow_exception( parameters.st_Exceptions[ i ] );
+      }
+    }
+  }
+  else
+  {
+    for( unsigned int i = 0; i < levelsFromInput.size(); ++i )
+    {
+      this->UpdateProgress( static_cast< float >( i )
+        / static_cast< float >( numberOfLevels ) );
+      this->GenerateLevelFromInput( levelsFromInput[ i ], input, numberOfThreads );
+    }
+  }
+
+  /** Compute the cascaded levels, from fine to coarse. */
+  for( unsigned int level = numberOfLevels; level-- > 0; )
+  {
+    if( sourceLevel[ level ] >= 0 )
+    {
+      this->UpdateProgress( static_cast< float >( numberOfLevels - 1 - level )
+        / static_cast< float >( numberOfLevels ) );
+      this->GenerateLevelFromFinerLevel( level,
+        static_cast< unsigned int >( sourceLevel[ level ] ) );
+    }
+  }
+
+} // end GenerateAllLevels()
+
+
+/**
+ * ******************* GenerateLevelsThreaderCallback ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+ITK_THREAD_RETURN_TYPE
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::GenerateLevelsThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct      = static_cast< ThreadInfoType * >( arg );
+  const ThreadIdType           threadId        = infoStruct->WorkUnitID;
+  const ThreadIdType           numberOfThreads = infoStruct->NumberOfWorkUnits;
+  MultiThreaderParameterType * parameters
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  try
+  {
+    /** Each thread works on a shallow copy of the input, so that the
+     * threads do not concurrently modify the requested region of the
+     * shared input when their pipelines update.
+     */
+    InputImagePointer localInput = InputImageType::New();
+    localInput->Graft( parameters->st_Input.GetPointer() );
+    const InputImageConstPointer localInputConst = localInput.GetPointer();
+
+    for( std::size_t i = threadId; i < parameters->st_Levels.size(); i += numberOfThreads )
+    {
+      parameters->st_Self->GenerateLevelFromInput( parameters->st_Levels[ i ],
+        localInputConst, parameters->st_NumberOfWorkUnitsPerLevel );
+    }
+  }
+  catch( ... )
+  {
+    parameters->st_Exceptions[ threadId ] = std::current_exception();
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GenerateLevelsThreaderCallback()
+
+
+/**
+ * ******************* GenerateLevelFromInput ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::GenerateLevelFromInput( const unsigned int level,
+  const InputImageConstPointer & input,
+  const ThreadIdType numberOfWorkUnits )
+{
+  // Allocate memory for the output
+  OutputImagePointer outputPtr = this->GetOutput( level );
+  outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
+  outputPtr->Allocate();
+  this->IncreaseMemoryUsage( ComputeImageSizeInBytes( outputPtr.GetPointer() ) );
+
+  // Local filters, so that this function can be run concurrently
+  typename SmootherType::Pointer smoother;
+  typename ImageToImageFilterSameTypes::Pointer rescaleSameTypes;
+  typename ImageToImageFilterDifferentTypes::Pointer rescaleDifferentTypes;
+
+  // Setup the smoother, and the shrinker or resampler
+  const bool smootherIsUsed = this->SetupSmoother( level, smoother, input );
+  const int shrinkerOrResamplerIsUsed = this->SetupShrinkerOrResampler( level,
+    smoother, smootherIsUsed, input, outputPtr,
+    rescaleSameTypes, rescaleDifferentTypes );
+
+  if( smootherIsUsed ) { smoother->SetNumberOfWorkUnits( numberOfWorkUnits ); }
+  if( rescaleSameTypes.IsNotNull() ) { rescaleSameTypes->SetNumberOfWorkUnits( numberOfWorkUnits ); }
+  if( rescaleDifferentTypes.IsNotNull() ) { rescaleDifferentTypes->SetNumberOfWorkUnits( numberOfWorkUnits ); }
+
+  // The smoother output is an intermediate image
+  SizeValueType intermediateSize = 0;
+  if( shrinkerOrResamplerIsUsed == 1 )
+  {
+    intermediateSize = input->GetLargestPossibleRegion().GetNumberOfPixels()
+      * sizeof( typename OutputImageType::PixelType );
+    this->IncreaseMemoryUsage( intermediateSize );
+  }
+
+  // Update the pipeline and graft or copy results to this filters output
+  if( shrinkerOrResamplerIsUsed == 0 && smootherIsUsed )
+  {
+    UpdateAndGraft< Self, SmootherType, OutputImageType >(
+      this, smoother, outputPtr, level );
+  }
+  else if( shrinkerOrResamplerIsUsed == 0 )
+  {
+    ImageAlgorithm::Copy( input.GetPointer(), outputPtr.GetPointer(),
+      input->GetLargestPossibleRegion(), outputPtr->GetLargestPossibleRegion() );
+  }
+  else if( shrinkerOrResamplerIsUsed == 1 )
+  {
+    UpdateAndGraft< Self, ImageToImageFilterSameTypes, OutputImageType >(
+      this, rescaleSameTypes, outputPtr, level );
+  }
+  else if( shrinkerOrResamplerIsUsed == 2 )
+  {
+    UpdateAndGraft< Self, ImageToImageFilterDifferentTypes, OutputImageType >(
+      this, rescaleDifferentTypes, outputPtr, level );
+  }
+
+  // The intermediate image is released together with the local smoother
+  this->DecreaseMemoryUsage( intermediateSize );
+
+} // end GenerateLevelFromInput()
+
+
+/**
+ * ******************* GenerateLevelFromFinerLevel ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::GenerateLevelFromFinerLevel( const unsigned int level,
+  const unsigned int finerLevel )
+{
+  // Allocate memory for the output
+  OutputImagePointer outputPtr = this->GetOutput( level );
+  outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
+  outputPtr->Allocate();
+  this->IncreaseMemoryUsage( ComputeImageSizeInBytes( outputPtr.GetPointer() ) );
+
+  // Work on a shallow copy of the finer level, to leave its pipeline untouched
+  OutputImagePointer source = OutputImageType::New();
+  source->Graft( this->GetOutput( finerLevel ) );
+
+  // Compute the residual sigma and the relative shrink factors.
+  // Smoothing with s_fine followed by s_residual equals smoothing with
+  // s_coarse, since the variances of Gaussian kernels add up.
+  SigmaArrayType         sigma, finerSigma, residualSigma;
+  RescaleFactorArrayType shrinkFactors, finerShrinkFactors, relativeShrinkFactors;
+  this->GetSigma( level, sigma );
+  this->GetSigma( finerLevel, finerSigma );
+  this->GetShrinkFactors( level, shrinkFactors );
+  this->GetShrinkFactors( finerLevel, finerShrinkFactors );
+  for( unsigned int dim = 0; dim < ImageDimension; ++dim )
+  {
+    const double variance = vnl_math::sqr( static_cast< double >( sigma[ dim ] ) )
+      - vnl_math::sqr( static_cast< double >( finerSigma[ dim ] ) );
+    residualSigma[ dim ]         = std::sqrt( std::max( variance, 0.0 ) );
+    relativeShrinkFactors[ dim ] = shrinkFactors[ dim ] / finerShrinkFactors[ dim ];
+  }
+
+  // Setup the pipeline: finer level -> smoother -> shrinker/resampler -> output
+  typename ImageToImageFilterSameTypes::Pointer lastFilter;
+  typename CascadeSmootherType::Pointer smoother;
+  if( !this->AreSigmasAllZeros( residualSigma ) )
+  {
+    smoother = CascadeSmootherType::New();
+    smoother->InPlaceOff(); // the finer level should not be overwritten
+    smoother->SetInput( source );
+    smoother->SetSigmaArray( residualSigma );
+    lastFilter = smoother.GetPointer();
+  }
+
+  SizeValueType intermediateSize = 0;
+  if( !this->AreRescaleFactorsAllOnes( relativeShrinkFactors ) )
+  {
+    typename ImageToImageFilterSameTypes::Pointer rescaler;
+    typename ImageToImageFilterDifferentTypes::Pointer dummy;
+    this->DefineShrinkerOrResampler( true, relativeShrinkFactors, outputPtr,
+      rescaler, dummy );
+    if( smoother.IsNotNull() )
+    {
+      rescaler->SetInput( smoother->GetOutput() );
+      intermediateSize = ComputeImageSizeInBytes( source.GetPointer() );
+      this->IncreaseMemoryUsage( intermediateSize );
+    }
+    else
+    {
+      rescaler->SetInput( source );
+    }
+    lastFilter = rescaler;
+  }
+
+  // Update the pipeline and graft or copy results to this filters output
+  if( lastFilter.IsNull() )
+  {
+    ImageAlgorithm::Copy( source.GetPointer(), outputPtr.GetPointer(),
+      source->GetLargestPossibleRegion(), outputPtr->GetLargestPossibleRegion() );
+  }
+  else
+  {
+    UpdateAndGraft< Self, ImageToImageFilterSameTypes, OutputImageType >(
+      this, lastFilter, outputPtr, level );
+  }
+
+  this->DecreaseMemoryUsage( intermediateSize );
+
+} // end GenerateLevelFromFinerLevel()
+
+
+/**
+ * ******************* CanBeCascaded ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+bool
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::CanBeCascaded( const unsigned int level, const unsigned int finerLevel ) const
+{
+  for( unsigned int dim = 0; dim < ImageDimension; ++dim )
+  {
+    const unsigned int factor      = this->m_Schedule[ level ][ dim ];
+    const unsigned int finerFactor = this->m_Schedule[ finerLevel ][ dim ];
+    const ScalarRealType sigma      = this->m_SmoothingSchedule[ level ][ dim ];
+    const ScalarRealType finerSigma = this->m_SmoothingSchedule[ finerLevel ][ dim ];
+
+    /** The finer grid has to be a refinement of the coarser grid. */
+    if( finerFactor == 0 || factor % finerFactor != 0 ) { return false; }
+
+    /** The residual smoothing should be non-negative. */
+    if( sigma < finerSigma ) { return false; }
+
+    /** A downsampled finer level that is not smoothed contains aliasing,
+     * which would propagate to the coarser level.
+     */
+    if( finerFactor > 1 && finerSigma <= 0.0 ) { return false; }
+  }
+
+  return true;
+} // end CanBeCascaded()
+
+
+/**
+ * ******************* IncreaseMemoryUsage ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::IncreaseMemoryUsage( const SizeValueType bytes )
+{
+  std::lock_guard< std::mutex > mutexHolder( this->m_MemoryUsageMutex );
+  this->m_CurrentMemoryUsage += bytes;
+  this->m_PeakMemoryUsage     = std::max( this->m_PeakMemoryUsage, this->m_CurrentMemoryUsage );
+} // end IncreaseMemoryUsage()
+
+
+/**
+ * ******************* DecreaseMemoryUsage ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+void
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::DecreaseMemoryUsage( const SizeValueType bytes )
+{
+  std::lock_guard< std::mutex > mutexHolder( this->m_MemoryUsageMutex );
+  this->m_CurrentMemoryUsage -= std::min( bytes, this->m_CurrentMemoryUsage );
+} // end DecreaseMemoryUsage()
+
+
+/**
+ * ******************* ComputeImageSizeInBytes ***********************
+ */
+
+template< class TInputImage, class TOutputImage, class TPrecisionType >
+template< class TImage >
+SizeValueType
+GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
+::ComputeImageSizeInBytes( const TImage * image )
+{
+  return image->GetBufferedRegion().GetNumberOfPixels()
+         * sizeof( typename TImage::PixelType );
+} // end ComputeImageSizeInBytes()
+
+
 /**
  * ******************* SetupSmoother ***********************
  */
@@ -916,6 +1307,12 @@ GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionT
      << ( this->m_ComputeOnlyForCurrentLevel ? "true" : "false" ) << std::endl;
   os << indent << "SmoothingScheduleDefined: "
      << ( this->m_SmoothingScheduleDefined ? "true" : "false" ) << std::endl;
+  os << indent << "UseCascadedLevels: "
+     << ( this->m_UseCascadedLevels ? "true" : "false" ) << std::endl;
+  os << indent << "ComputeLevelsInParallel: "
+     << ( this->m_ComputeLevelsInParallel ? "true" : "false" ) << std::endl;
+  os << indent << "PeakMemoryUsage: "
+     << this->m_PeakMemoryUsage << " bytes" << std::endl;
   os << indent << "Smoothing Schedule: ";
   if( this->m_SmoothingSchedule.size() == 0 )
   {
@@ -0,0 +1,388 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkTransformParametersBinaryFile_cxx
+#define __itkTransformParametersBinaryFile_cxx
+
+#include "itkTransformParametersBinaryFile.h"
+
+#include <itksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined( _WIN32 ) && !defined( __CYGWIN__ )
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace
+{
+
+/** The header of the binary file; see the class documentation. */
+struct BinaryFileHeader
+{
+  char     Magic[ 8 ];
+  uint32_t Version;
+  uint32_t ByteOrderMark;
+  uint32_t ValueSize;
+  uint32_t ValueType;
+  uint64_t NumberOfValues;
+  uint64_t Checksum;
+  char     Padding[ 24 ];
+};
+
+const char     HeaderMagic[ 8 ]  = { 'E', 'L', 'X', 'T', 'P', 'A', 'R', '\0' };
+const uint32_t HeaderVersion     = 1;
+const uint32_t ByteOrderMark     = 0x01020304;
+const uint32_t SwappedOrderMark  = 0x04030201;
+const uint32_t ValueTypeDouble   = 1;
+const std::size_t HeaderSize     = 64;
+
+template< class T >
+T
+SwapBytes( T value )
+{
+  char * bytes = reinterpret_cast< char * >( &value );
+  std::reverse( bytes, bytes + sizeof( T ) );
+  return value;
+}
+
+} // end namespace
+
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+TransformParametersBinaryFile
+::TransformParametersBinaryFile()
+{
+  static_assert( sizeof( BinaryFileHeader ) == HeaderSize,
+    "The header of the binary transform parameter file should be 64 bytes." );
+
+  this->m_MappedRegion   = nullptr;
+  this->m_MappedSize     = 0;
+  this->m_Values         = nullptr;
+  this->m_NumberOfValues = 0;
+
+} // end Constructor
+
+
+/**
+ * ******************* Destructor *******************
+ */
+
+TransformParametersBinaryFile
+::~TransformParametersBinaryFile()
+{
+  this->Release();
+
+} // end Destructor
+
+
+/**
+ * ******************* ComputeChecksum *******************
+ */
+
+uint64_t
+TransformParametersBinaryFile
+::ComputeChecksum( const void * data, const std::size_t numberOfBytes )
+{
+  /** 64-bit FNV-1a. */
+  const unsigned char * bytes = static_cast< const unsigned char * >( data );
+  uint64_t              hash  = 14695981039346656037ULL;
+  for( std::size_t i = 0; i < numberOfBytes; ++i )
+  {
+    hash ^= bytes[ i ];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+
+} // end ComputeChecksum()
+
+
+/**
+ * ******************* Write *******************
+ */
+
+void
+TransformParametersBinaryFile
+::Write( const std::string & fileName,
+  const ValueType * values, const SizeValueType numberOfValues )
+{
+  const std::size_t numberOfBytes = numberOfValues * sizeof( ValueType );
+
+  /** Fill the header. */
+  BinaryFileHeader header;
+  std::memset( &header, 0, sizeof( header ) );
+  std::memcpy( header.Magic, HeaderMagic, sizeof( HeaderMagic ) );
+  header.Version        = HeaderVersion;
+  header.ByteOrderMark  = ByteOrderMark;
+  header.ValueSize      = sizeof( ValueType );
+  header.ValueType      = ValueTypeDouble;
+  header.NumberOfValues = numberOfValues;
+  header.Checksum       = ComputeChecksum( values, numberOfBytes );
+
+  /** Write to a temporary file, and rename it afterwards. */
+  const std::string tmpFileName = fileName + ".tmp";
+  std::ofstream     outfile( tmpFileName.c_str(), std::ios::out | std::ios::binary );
+  if( !outfile.is_open() )
+  {
+    itkGenericExceptionMacro( << "ERROR: could not open " << tmpFileName << " for writing." );
+  }
+  outfile.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+  outfile.write( reinterpret_cast< const char * >( values ), numberOfBytes );
+  outfile.close();
+  if( outfile.fail() )
+  {
+    itksys::SystemTools::RemoveFile( tmpFileName );
+    itkGenericExceptionMacro( << "ERROR: could not write " << tmpFileName << "." );
+  }
+
+  if( !itksys::SystemTools::RenameFile( tmpFileName.c_str(), fileName.c_str() ) )
+  {
+    itksys::SystemTools::RemoveFile( tmpFileName );
+    itkGenericExceptionMacro( << "ERROR: could not rename " << tmpFileName
+                              << " to " << fileName << "." );
+  }
+
+} // end Write()
+
+
+/**
+ * ******************* Read *******************
+ */
+
+void
+TransformParametersBinaryFile
+::Read( const std::string & fileName, const SizeValueType expectedNumberOfValues )
+{
+  this->Release();
+
+  std::ifstream infile( fileName.c_str(), std::ios::in | std::ios::binary );
+  if( !infile.is_open() )
+  {
+    itkExceptionMacro( << "ERROR: could not open " << fileName << " for reading." );
+  }
+  infile.seekg( 0, std::ios::end );
+  const std::size_t fileSize = static_cast< std::size_t >( infile.tellg() );
+  infile.seekg( 0, std::ios::beg );
+
+  /** Read the header, if any. */
+  BinaryFileHeader header;
+  std::memset( &header, 0, sizeof( header ) );
+  if( fileSize >= HeaderSize )
+  {
+    infile.read( reinterpret_cast< char * >( &header ), sizeof( header ) );
+  }
+
+  if( std::memcmp( header.Magic, HeaderMagic, sizeof( HeaderMagic ) ) != 0 )
+  {
+    /** A raw file, as written by older versions: only the size can be checked. */
+    this->m_NumberOfValues = fileSize / sizeof( ValueType );
+    if( this->m_NumberOfValues != expectedNumberOfValues
+      || fileSize % sizeof( ValueType ) != 0 )
+    {
+      return;
+    }
+    infile.seekg( 0, std::ios::beg );
+    this->m_Buffer.resize( this->m_NumberOfValues );
+    infile.read( reinterpret_cast< char * >( this->m_Buffer.data() ), fileSize );
+    this->m_Values = this->m_Buffer.data();
+    return;
+  }
+
+  /** Check the header. */
+  const bool swapped = header.ByteOrderMark == SwappedOrderMark;
+  if( swapped )
+  {
+    header.Version        = SwapBytes( header.Version );
+    header.ValueSize      = SwapBytes( header.ValueSize );
+    header.ValueType      = SwapBytes( header.ValueType );
+    header.NumberOfValues = SwapBytes( header.NumberOfValues );
+    header.Checksum       = SwapBytes( header.Checksum );
+  }
+  else if( header.ByteOrderMark != ByteOrderMark )
+  {
+    itkExceptionMacro( << "ERROR: " << fileName << " has an invalid byte order mark." );
+  }
+  if( header.Version != HeaderVersion
+    || header.ValueSize != sizeof( ValueType )
+    || header.ValueType != ValueTypeDouble )
+  {
+    itkExceptionMacro( << "ERROR: " << fileName << " has an unsupported format (version "
+                       << header.Version << ", value size " << header.ValueSize
+                       << ", value type " << header.ValueType << ")." );
+  }
+
+  /** Check the size. */
+  const std::size_t numberOfBytes = header.NumberOfValues * sizeof( ValueType );
+  if( fileSize != HeaderSize + numberOfBytes )
+  {
+    itkExceptionMacro( << "ERROR: " << fileName << " is truncated or corrupt: it should contain "
+                       << header.NumberOfValues << " values, but its size is "
+                       << fileSize << " bytes." );
+  }
+  this->m_NumberOfValues = header.NumberOfValues;
+  if( this->m_NumberOfValues != expectedNumberOfValues )
+  {
+    return;
+  }
+
+  /** Map the file, or read it when it can not be mapped or needs swapping. */
+  const char * data = nullptr;
+  if( !swapped && this->MapFile( fileName ) )
+  {
+    data = static_cast< const char * >( this->m_MappedRegion ) + HeaderSize;
+    this->m_Values = reinterpret_cast< ValueType * >(
+      static_cast< char * >( this->m_MappedRegion ) + HeaderSize );
+  }
+  else
+  {
+    this->m_Buffer.resize( this->m_NumberOfValues );
+    infile.seekg( HeaderSize, std::ios::beg );
+    infile.read( reinterpret_cast< char * >( this->m_Buffer.data() ), numberOfBytes );
+    data = reinterpret_cast< const char * >( this->m_Buffer.data() );
+    this->m_Values = this->m_Buffer.data();
+  }
+
+  /** Verify the checksum, over the bytes as stored in the file. */
+  if( ComputeChecksum( data, numberOfBytes ) != header.Checksum )
+  {
+    this->Release();
+    itkExceptionMacro( << "ERROR: the checksum of " << fileName << " does not match." );
+  }
+
+  if( swapped )
+  {
+    for( SizeValueType i = 0; i < this->m_NumberOfValues; ++i )
+    {
+      this->m_Buffer[ i ] = SwapBytes( this->m_Buffer[ i ] );
+    }
+  }
+
+} // end Read()
+
+
+/**
+ * ******************* MapFile *******************
+ */
+
+bool
+TransformParametersBinaryFile
+::MapFile( const std::string & fileName )
+{
+#if defined( _WIN32 ) && !defined( __CYGWIN__ )
+  /** FILE_SHARE_DELETE allows Write() to rename a new file over this one
+   * while it is mapped, as on POSIX systems.
+   */
+  HANDLE fileHandle = CreateFileA( fileName.c_str(), GENERIC_READ,
+    FILE_SHARE_READ | FILE_SHARE_DELETE,
+    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+  if( fileHandle == INVALID_HANDLE_VALUE )
+  {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if( !GetFileSizeEx( fileHandle, &fileSize ) )
+  {
+    CloseHandle( fileHandle );
+    return false;
+  }
+  HANDLE mappingHandle = CreateFileMappingA( fileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr );
+  CloseHandle( fileHandle );
+  if( mappingHandle == nullptr )
+  {
+    return false;
+  }
+
+  /** Copy-on-write, since transforms expect writable parameters. */
+  void * region = MapViewOfFile( mappingHandle, FILE_MAP_COPY, 0, 0, 0 );
+  CloseHandle( mappingHandle );
+  if( region == nullptr )
+  {
+    return false;
+  }
+  this->m_MappedSize = static_cast< std::size_t >( fileSize.QuadPart );
+#else
+  const int fileDescriptor = open( fileName.c_str(), O_RDONLY );
+  if( fileDescriptor < 0 )
+  {
+    return false;
+  }
+  struct stat fileStatus;
+  if( fstat( fileDescriptor, &fileStatus ) != 0 || fileStatus.st_size <= 0 )
+  {
+    close( fileDescriptor );
+    return false;
+  }
+
+  /** Copy-on-write, since transforms expect writable parameters. */
+  const std::size_t mappedSize = static_cast< std::size_t >( fileStatus.st_size );
+  void *            region     = mmap( nullptr, mappedSize,
+    PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0 );
+  close( fileDescriptor );
+  if( region == MAP_FAILED )
+  {
+    return false;
+  }
+  this->m_MappedSize = mappedSize;
+#endif
+
+  this->m_MappedRegion = region;
+  return true;
+
+} // end MapFile()
+
+
+/**
+ * ******************* Release *******************
+ */
+
+void
+TransformParametersBinaryFile
+::Release( void )
+{
+  if( this->m_MappedRegion != nullptr )
+  {
+#if defined( _WIN32 ) && !defined( __CYGWIN__ )
+    UnmapViewOfFile( this->m_MappedRegion );
+#else
+    munmap( this->m_MappedRegion, this->m_MappedSize );
+#endif
+  }
+  this->m_MappedRegion = nullptr;
+  this->m_MappedSize   = 0;
+  this->m_Buffer.clear();
+  this->m_Values         = nullptr;
+  this->m_NumberOfValues = 0;
+
+} // end Release()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkTransformParametersBinaryFile_cxx
@@ -0,0 +1,136 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkTransformParametersBinaryFile_h
+#define __itkTransformParametersBinaryFile_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkIntTypes.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class TransformParametersBinaryFile
+ * \brief Reads and writes transform parameters in a self-describing binary file.
+ *
+ * This class implements the data file that is written next to a transform
+ * parameter file when UseBinaryFormatForTransformationParameters is true.
+ * The file consists of a header of 64 bytes, followed by the parameter
+ * values as IEEE 754 doubles:
+ *
+ * \li char[8]  magic string "ELXTPAR"
+ * \li uint32   format version (1)
+ * \li uint32   byte order mark 0x01020304, in the byte order of the writer
+ * \li uint32   size of a value in bytes (8)
+ * \li uint32   value type (1 = IEEE 754 double)
+ * \li uint64   number of values
+ * \li uint64   64-bit FNV-1a checksum of the value bytes
+ * \li padding up to 64 bytes
+ *
+ * When reading, the file is memory-mapped copy-on-write, and GetValues()
+ * points into the mapping. No copy is made, and processes that read the
+ * same file share the pages. Files that cannot be mapped, files with a
+ * different byte order, and raw files written by older versions of elastix
+ * (without a header) are read into memory instead.
+ *
+ * The values remain valid as long as this object exists.
+ */
+
+class TransformParametersBinaryFile : public Object
+{
+public:
+
+  /** Standard ITK typedefs. */
+  typedef TransformParametersBinaryFile Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( TransformParametersBinaryFile, Object );
+
+  /** Typedefs. */
+  typedef double ValueType;
+
+  /** Write the values to a file. The file is first written under a
+   * temporary name and then renamed, so that a mapping of an existing
+   * file with the same name stays valid.
+   */
+  static void Write( const std::string & fileName,
+    const ValueType * values, const SizeValueType numberOfValues );
+
+  /** Read a file. The header, the file size and the checksum are verified.
+   * An exception is thrown when the file is invalid. When the number of
+   * values differs from expectedNumberOfValues, only GetNumberOfValues()
+   * is set, and GetValues() returns null.
+   *
+   * Verifying the checksum reads every byte of the file once, which
+   * costs about a millisecond per MB. So memory mapping avoids the copy of
+   * the values, but not reading them: all pages of the file are touched.
+   * For legacy files without header only the size is checked.
+   */
+  void Read( const std::string & fileName,
+    const SizeValueType expectedNumberOfValues );
+
+  /** Get the values that were read. */
+  ValueType * GetValues( void ) { return this->m_Values; }
+  const ValueType * GetValues( void ) const { return this->m_Values; }
+
+  /** Get the number of values that were read. */
+  itkGetConstMacro( NumberOfValues, SizeValueType );
+
+  /** True, if the values point into a memory-mapped file. */
+  bool GetIsMemoryMapped( void ) const { return this->m_MappedRegion != nullptr; }
+
+  /** The checksum that is stored in the header. */
+  static uint64_t ComputeChecksum( const void * data, const std::size_t numberOfBytes );
+
+protected:
+
+  TransformParametersBinaryFile();
+  ~TransformParametersBinaryFile() override;
+
+private:
+
+  TransformParametersBinaryFile( const Self & ); // purposely not implemented
+  void operator=( const Self & );                // purposely not implemented
+
+  /** Map the file into memory. Returns false if mapping is not possible. */
+  bool MapFile( const std::string & fileName );
+
+  /** Release the mapping and the buffer. */
+  void Release( void );
+
+  /** Member variables. */
+  void *                   m_MappedRegion;
+  std::size_t              m_MappedSize;
+  std::vector< ValueType > m_Buffer;
+  ValueType *              m_Values;
+  SizeValueType            m_NumberOfValues;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkTransformParametersBinaryFile_h
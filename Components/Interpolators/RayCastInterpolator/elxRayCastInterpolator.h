@@ -36,6 +36,10 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Interpolator: Select this interpolator as follows:\n
  *    <tt>(Interpolator "RayCastInterpolator")</tt>
+ * \parameter UseSiddonRayTraversal: Integrate along the rays by visiting every voxel
+ *    cut by the ray (Siddon), instead of interpolating bilinearly in each plane of voxels.\n
+ *    example: <tt>(UseSiddonRayTraversal "true" "false")</tt>\n
+ *    Can be given for each resolution. Default false.
  *
  * \ingroup Interpolators
  */
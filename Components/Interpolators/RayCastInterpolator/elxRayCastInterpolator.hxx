@@ -116,6 +116,11 @@ RayCastInterpolator< TElastix >
   this->GetConfiguration()->ReadParameter( threshold, "Threshold", this->GetComponentLabel(), level, 0 );
   this->SetThreshold( threshold );
 
+  bool useSiddonRayTraversal = false;
+  this->GetConfiguration()->ReadParameter( useSiddonRayTraversal,
+    "UseSiddonRayTraversal", this->GetComponentLabel(), level, 0 );
+  this->SetUseSiddonRayTraversal( useSiddonRayTraversal );
+
 } // end BeforeEachResolution()
 
 
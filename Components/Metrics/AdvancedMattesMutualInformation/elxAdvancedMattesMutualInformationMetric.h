@@ -91,6 +91,14 @@ namespace elastix
  *    B-spline grids.
  *    example: <tt>(UseFastAndLowMemoryVersion "false")</tt> \n
  *    The default is "true".
+ * \parameter UsePrecomputedFixedImageMarginalPDF: Whether to compute the
+ *    fixed marginal pdf once per resolution, from all samples, instead of every
+ *    iteration from the joint histogram. Only has effect for samplers that keep
+ *    their samples, such as the Full and Grid samplers. The result differs
+ *    slightly when samples map outside the moving image or mask.\n
+ *    example: <tt>(UsePrecomputedFixedImageMarginalPDF "true")</tt> \n
+ *    The default is "false". Can be given for each resolution, or for
+ *    all resolutions at once.
  *
  * \sa ParzenWindowMutualInformationImageToImageMetric
  * \ingroup Metrics
@@ -125,6 +125,12 @@ AdvancedMattesMutualInformationMetric< TElastix >
     "UseFastAndLowMemoryVersion", this->GetComponentLabel(), level, 0 );
   this->SetUseExplicitPDFDerivatives( !useFastAndLowMemoryVersion );
 
+  /** Set whether the fixed marginal pdf should be computed once per resolution. */
+  bool usePrecomputedFixedImageMarginalPDF = false;
+  this->GetConfiguration()->ReadParameter( usePrecomputedFixedImageMarginalPDF,
+    "UsePrecomputedFixedImageMarginalPDF", this->GetComponentLabel(), level, 0 );
+  this->SetUsePrecomputedFixedImageMarginalPDF( usePrecomputedFixedImageMarginalPDF );
+
   /** Set whether to use Nick Tustison's preconditioning technique. */
   bool useJacobianPreconditioning = false;
   this->GetConfiguration()->ReadParameter( useJacobianPreconditioning,
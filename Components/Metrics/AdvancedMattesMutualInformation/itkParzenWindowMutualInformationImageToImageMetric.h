@@ -170,6 +170,7 @@ protected:
   /** Typedefs inherited from superclass */
   typedef typename Superclass::FixedImageIndexType                 FixedImageIndexType;
   typedef typename Superclass::FixedImageIndexValueType            FixedImageIndexValueType;
+  typedef typename Superclass::OffsetValueType                     OffsetValueType;
   typedef typename Superclass::MovingImageIndexType                MovingImageIndexType;
   typedef typename Superclass::FixedImagePointType                 FixedImagePointType;
   typedef typename Superclass::MovingImagePointType                MovingImagePointType;
@@ -276,9 +277,12 @@ private:
 
   void ComputeDerivativeLowMemory( DerivativeType & derivative ) const;
 
-  /** Helper function to update the derivative for the low memory variant. */
+  /** Helper function to update the derivative for the low memory variant,
+   * given the fixed Parzen window of the sample.
+   */
   void UpdateDerivativeLowMemory(
-    const RealType & fixedImageValue,
+    const OffsetValueType fixedParzenWindowIndex,
+    const PDFValueType * fixedParzenValues,
     const RealType & movingImageValue,
     const DerivativeType & imageJacobian,
     const NonZeroJacobianIndicesType & nzji,
@@ -21,7 +21,6 @@
 #include "itkParzenWindowMutualInformationImageToImageMetric.h"
 
 #include "itkImageLinearConstIteratorWithIndex.h"
-#include "itkImageScanlineConstIterator.h"
 #include "vnl/vnl_math.h"
 #include "itkMatrix.h"
 #include "vnl/vnl_inverse.h"
@@ -89,7 +88,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
 
   /** Compute the fixed and moving marginal pdfs, by summing over the joint pdf. */
-  this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
+  this->ComputeFixedImageMarginalPDF();
   this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
 
   /** Compute the metric by double summation over histogram. */
@@ -170,7 +169,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
 
   /** Compute the fixed and moving marginal pdf by summing over the histogram. */
-  this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
+  this->ComputeFixedImageMarginalPDF();
   this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
 
   /** Compute the metric and derivatives by double summation over histogram. */
@@ -263,7 +262,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
 
   /** Compute the fixed and moving marginal pdf by summing over the histogram. */
-  this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
+  this->ComputeFixedImageMarginalPDF();
   this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
 
   // \todo: the last three loops over the joint histogram can be done in
@@ -319,6 +318,9 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
   typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
 
+  /** Storage for the fixed Parzen values, when they are not cached. */
+  ParzenValueContainerType fixedParzenValuesBuffer( this->m_JointPDFWindow.GetSize()[ 1 ] );
+
   /** Loop over sample container and compute contribution of each sample to pdfs. */
   for( fiter = fbegin; fiter != fend; ++fiter )
   {
@@ -348,12 +350,13 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
     if( sampleOk )
     {
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Get the fixed Parzen window of this sample. */
+      OffsetValueType      fixedParzenWindowIndex;
+      const PDFValueType * fixedParzenValues = this->GetFixedParzenValues( fiter.Index(),
+        static_cast< RealType >( ( *fiter ).Value().m_ImageValue ),
+        fixedParzenWindowIndex, fixedParzenValuesBuffer );
 
       /** Make sure the values fall within the histogram range. */
-      fixedImageValue = this->GetFixedImageLimiter()
-        ->Evaluate( fixedImageValue );
       movingImageValue = this->GetMovingImageLimiter()
         ->Evaluate( movingImageValue, movingImageDerivative );
 
@@ -383,8 +386,8 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       }
 
       /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateDerivativeLowMemory(
-        fixedImageValue, movingImageValue, imageJacobian, nzji, derivative );
+      this->UpdateDerivativeLowMemory( fixedParzenWindowIndex, fixedParzenValues,
+        movingImageValue, imageJacobian, nzji, derivative );
 
     } // end sampleOk
   } // end loop over sample container
@@ -485,6 +488,9 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   fbegin                                                 += (int)pos_begin;
   fend                                                   += (int)pos_end;
 
+  /** Storage for the fixed Parzen values, when they are not cached. */
+  ParzenValueContainerType fixedParzenValuesBuffer( this->m_JointPDFWindow.GetSize()[ 1 ] );
+
   /** Loop over sample container and compute contribution of each sample to pdfs. */
   for( fiter = fbegin; fiter != fend; ++fiter )
   {
@@ -514,11 +520,13 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
     if( sampleOk )
     {
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Get the fixed Parzen window of this sample. */
+      OffsetValueType      fixedParzenWindowIndex;
+      const PDFValueType * fixedParzenValues = this->GetFixedParzenValues( fiter.Index(),
+        static_cast< RealType >( ( *fiter ).Value().m_ImageValue ),
+        fixedParzenWindowIndex, fixedParzenValuesBuffer );
 
       /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
       movingImageValue = this->GetMovingImageLimiter()
         ->Evaluate( movingImageValue, movingImageDerivative );
 
@@ -557,9 +565,8 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       }
 
       /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateDerivativeLowMemory(
-        fixedImageValue, movingImageValue, imageJacobian, nzji,
-        derivative );
+      this->UpdateDerivativeLowMemory( fixedParzenWindowIndex, fixedParzenValues,
+        movingImageValue, imageJacobian, nzji, derivative );
 
     } // end sampleOk
   } // end loop over sample container
@@ -689,67 +696,54 @@ void
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputeValueAndPRatioArray( double & MI ) const
 {
-  /** Setup iterators. */
-  typedef ImageScanlineConstIterator< JointPDFType > JointPDFIteratorType;
-  typedef typename MarginalPDFType::const_iterator   MarginalPDFIteratorType;
-
-  JointPDFIteratorType jointPDFit(
-    this->m_JointPDF, this->m_JointPDF->GetLargestPossibleRegion() );
-  MarginalPDFIteratorType       fixedPDFit  = this->m_FixedImageMarginalPDF.begin();
-  const MarginalPDFIteratorType fixedPDFend = this->m_FixedImageMarginalPDF.end();
-  MarginalPDFIteratorType       movingPDFit;
-  const MarginalPDFIteratorType movingPDFbegin = this->m_MovingImageMarginalPDF.begin();
-  const MarginalPDFIteratorType movingPDFend   = this->m_MovingImageMarginalPDF.end();
+  /** The joint histogram and the PRatio array are both plain arrays of
+   * numberOfFixedBins x numberOfMovingBins values, with the moving bin
+   * running fastest, so they can be traversed with raw pointers.
+   */
+  const unsigned int   numberOfFixedBins  = this->m_FixedImageMarginalPDF.size();
+  const unsigned int   numberOfMovingBins = this->m_MovingImageMarginalPDF.size();
+  const PDFValueType * jointPDFRow        = this->m_JointPDF->GetBufferPointer();
+  const PDFValueType * movingPDF          = this->m_MovingImageMarginalPDF.data_block();
+  PRatioType *         pRatioRow          = this->m_PRatioArray.data_block();
 
   /** Initialize */
   this->m_PRatioArray.Fill( itk::NumericTraits< PRatioType >::ZeroValue() );
 
   /** Loop over the joint histogram. */
-  PDFValueType sum         = 0.0;
-  unsigned int fixedIndex  = 0;
-  unsigned int movingIndex = 0;
-  while( fixedPDFit != fixedPDFend )
+  PDFValueType sum = 0.0;
+  for( unsigned int f = 0; f < numberOfFixedBins;
+    ++f, jointPDFRow += numberOfMovingBins, pRatioRow += numberOfMovingBins )
   {
-    const double fixedPDFValue    = *fixedPDFit;
+    const double fixedPDFValue    = this->m_FixedImageMarginalPDF[ f ];
     double       logFixedPDFValue = 0.0;
     if( fixedPDFValue > 1e-16 )
     {
       logFixedPDFValue = std::log( fixedPDFValue );
     }
-    movingPDFit = movingPDFbegin;
-    movingIndex = 0;
 
-    while( movingPDFit != movingPDFend )
+    PDFValueType rowSum = 0.0;
+    for( unsigned int m = 0; m < numberOfMovingBins; ++m )
     {
-      const PDFValueType movingPDFValue = *movingPDFit;
-      const PDFValueType jointPDFValue  = jointPDFit.Value();
+      const PDFValueType movingPDFValue = movingPDF[ m ];
+      const PDFValueType jointPDFValue  = jointPDFRow[ m ];
 
       /** Check for non-zero bin contribution. */
       if( jointPDFValue > 1e-16 && movingPDFValue > 1e-16 )
       {
         const PDFValueType pRatio = std::log( jointPDFValue / movingPDFValue );
-        this->m_PRatioArray[ fixedIndex ][ movingIndex ] = static_cast< PRatioType >(
-          this->m_Alpha * pRatio );
-
-        if( fixedPDFValue > 1e-16 )
-        {
-          sum += jointPDFValue * ( pRatio - logFixedPDFValue );
-        }
+        pRatioRow[ m ] = static_cast< PRatioType >( this->m_Alpha * pRatio );
+        rowSum        += jointPDFValue * ( pRatio - logFixedPDFValue );
       } // end if-block to check non-zero bin contribution
 
-      /** Update iterators. */
-      ++movingPDFit;
-      ++jointPDFit;
-      ++movingIndex;
-
-    } // end while-loop over moving index
+    } // end for-loop over moving index
 
-    /** Update iterators. */
-    ++fixedPDFit;
-    jointPDFit.NextLine();
-    ++fixedIndex;
+    /** A row with an empty fixed bin does not contribute to the value. */
+    if( fixedPDFValue > 1e-16 )
+    {
+      sum += rowSum;
+    }
 
-  } // end while-loop over fixed index
+  } // end for-loop over fixed index
 
   // Assign
   MI = sum;
@@ -765,7 +759,8 @@ template< class TFixedImage, class TMovingImage >
 void
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::UpdateDerivativeLowMemory(
-  const RealType & fixedImageValue,
+  const OffsetValueType fixedParzenWindowIndex,
+  const PDFValueType * fixedParzenValues,
   const RealType & movingImageValue,
   const DerivativeType & imageJacobian,
   const NonZeroJacobianIndicesType & nzji,
@@ -783,58 +778,36 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * Note (2) that imageJacobian may be sparse.
    */
 
-  /** Determine the affected region. */
-
   /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
-  const double fixedImageParzenWindowTerm
-    = fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
   const double movingImageParzenWindowTerm
     = movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
 
-  /** The lowest bin numbers affected by this pixel: */
-  const int fixedParzenWindowIndex
-    = static_cast< int >( std::floor(
-    fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
-  const int movingParzenWindowIndex
-    = static_cast< int >( std::floor(
+  /** The lowest bin number affected by this pixel: */
+  const OffsetValueType movingParzenWindowIndex
+    = static_cast< OffsetValueType >( std::floor(
     movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
 
-  /** Compute the fixed Parzen values. */
-  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
-  this->EvaluateParzenValues(
-    fixedImageParzenWindowTerm, fixedParzenWindowIndex,
-    this->m_FixedKernel, fixedParzenValues );
-
-  /** Compute the derivatives of the moving Parzen window. */
-  ParzenValueContainerType derivativeMovingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
-  this->EvaluateParzenValues(
-    movingImageParzenWindowTerm, movingParzenWindowIndex,
-    this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
+  /** Compute the derivatives of the moving Parzen window, on the stack. */
+  PDFValueType derivativeMovingParzenValues[ ParzenWindowHistogramKernels::MaximumWindowSize ];
+  this->m_DerivativeMovingKernel->Evaluate(
+    static_cast< double >( movingParzenWindowIndex ) - movingImageParzenWindowTerm,
+    derivativeMovingParzenValues );
 
   /** Get the moving image bin size. */
   const double et = static_cast< double >( this->m_MovingImageBinSize );
 
-  /** Loop over the Parzen window region and increment sum. */
-  PDFValueType sum = 0.0;
-  for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
-  {
-    const double fv_et = fixedParzenValues[ f ] / et;
-    for( unsigned int m = 0; m < derivativeMovingParzenValues.GetSize(); ++m )
-    {
-      sum += this->m_PRatioArray[ f + fixedParzenWindowIndex ][ m + movingParzenWindowIndex ]
-        * fv_et * derivativeMovingParzenValues[ m ];
-    }
-  }
+  /** Sum over the Parzen window region. */
+  const PDFValueType sum = ParzenWindowHistogramKernels::ComputePRatioWeightedSum(
+    this->m_PRatioArray.data_block(), this->m_PRatioArray.cols(),
+    fixedParzenWindowIndex, fixedParzenValues, this->m_JointPDFWindow.GetSize()[ 1 ],
+    movingParzenWindowIndex, derivativeMovingParzenValues, this->m_JointPDFWindow.GetSize()[ 0 ] ) / et;
 
   /** Now compute derivative -= sum * imageJacobian. */
   if( nzji.size() == this->GetNumberOfParameters() )
   {
     /** Loop over all Jacobians. */
-    for( unsigned int mu = 0; mu < this->GetNumberOfParameters(); ++mu )
-    {
-      derivative[ mu ] += static_cast< DerivativeValueType >(
-        imageJacobian[ mu ] * sum );
-    }
+    ParzenWindowHistogramKernels::AddScaledJacobian( derivative.data_block(),
+      imageJacobian.data_block(), this->GetNumberOfParameters(), sum );
   }
   else
   {
@@ -118,10 +118,11 @@ public:
     Superclass::MovingImageLimiterOutputType MovingImageLimiterOutputType;
   typedef typename
     Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
-  typedef typename Superclass::HessianValueType HessianValueType;
-  typedef typename Superclass::HessianType      HessianType;
-  typedef typename Superclass::ThreaderType     ThreaderType;
-  typedef typename Superclass::ThreadInfoType   ThreadInfoType;
+  typedef typename Superclass::HessianValueType      HessianValueType;
+  typedef typename Superclass::HessianType           HessianType;
+  typedef typename Superclass::CompressedHessianType CompressedHessianType;
+  typedef typename Superclass::ThreaderType          ThreaderType;
+  typedef typename Superclass::ThreadInfoType        ThreadInfoType;
 
   typedef typename Superclass::FixedImageMaskSpatialObject2Type    FixedImageMaskSpatialObject2Type;
   typedef typename Superclass::MovingImageMaskSpatialObject2Type   MovingImageMaskSpatialObject2Type;
@@ -150,9 +151,19 @@ public:
   void GetValueAndDerivative( const TransformParametersType & parameters,
     MeasureType & value, DerivativeType & derivative ) const override;
 
+  /** This metric can be evaluated at several positions concurrently. */
+  bool GetSupportsConcurrentEvaluation( void ) const override
+  { return this->m_AdvancedTransform.IsNotNull(); }
+
   /** Experimental feature: compute SelfHessian */
   void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const override;
 
+  /** Experimental feature: compute SelfHessian in compressed sparse row format.
+   * The samples are processed, and the matrix is assembled, multi-threaded.
+   */
+  void GetCompressedSelfHessian( const TransformParametersType & parameters,
+    CompressedHessianType * H ) const override;
+
   /** Default: 1.0 mm */
   itkSetMacro( SelfHessianSmoothingSigma, double );
   itkGetConstMacro( SelfHessianSmoothingSigma, double );
@@ -208,6 +219,7 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::EvaluationContextType               EvaluationContextType;
 
   /** Protected typedefs for SelfHessian */
   typedef SmoothingRecursiveGaussianImageFilter<
@@ -230,12 +242,26 @@ protected:
     MeasureType & measure,
     DerivativeType & deriv ) const;
 
-  /** Compute a pixel's contribution to the SelfHessian;
-   * Called by GetSelfHessian(). */
-  void UpdateSelfHessianTerms(
-    const DerivativeType & imageJacobian,
-    const NonZeroJacobianIndicesType & nzji,
-    HessianType & H ) const;
+  /** Helper struct that multi-threads the computation of the SelfHessian. */
+  struct SelfHessianThreaderParameterType
+  {
+    const Self *                       st_Metric;
+    const ImageSampleContainerType *   st_SampleContainer;
+    const FixedImageInterpolatorType * st_FixedInterpolator;
+    const std::vector< double > *      st_Noise;
+    CompressedHessianType *            st_Hessian;
+    SizeValueType                      st_ChunkBegin;
+    SizeValueType                      st_ChunkEnd;
+    std::vector< SizeValueType >       st_NumberOfPixelsCounted;
+  };
+
+  /** SelfHessian threader callback function. */
+  static ITK_THREAD_RETURN_TYPE SelfHessianThreaderCallback( void * arg );
+
+  /** Compute the Jacobians of the SelfHessian samples of one thread, in the
+   * current chunk; Called by GetCompressedSelfHessian(). */
+  void ThreadedComputeSelfHessianTerms( ThreadIdType threadId,
+    SelfHessianThreaderParameterType * parameters ) const;
 
   /** Get value for each thread. */
   inline void ThreadedGetValue( ThreadIdType threadID ) override;
@@ -250,6 +276,14 @@ protected:
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & value, DerivativeType & derivative ) const override;
 
+  /** Get value and derivatives for the samples of an evaluation context. */
+  void ThreadedGetValueAndDerivativeInContext(
+    EvaluationContextType & context ) const override;
+
+  /** Compute value and derivatives from the sums of an evaluation context. */
+  void AfterGetValueAndDerivativeInContext( const EvaluationContextType & context,
+    MeasureType & value, DerivativeType & derivative ) const override;
+
 private:
 
   AdvancedMeanSquaresImageToImageMetric( const Self & ); // purposely not implemented
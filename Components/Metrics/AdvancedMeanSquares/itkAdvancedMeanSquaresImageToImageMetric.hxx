@@ -825,6 +825,113 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 } // end AfterThreadedGetValueAndDerivative()
 
 
+/**
+ * ******************* ThreadedGetValueAndDerivativeInContext *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivativeInContext( EvaluationContextType & context ) const
+{
+  /** The transform and the buffers of this context. */
+  const typename Superclass::AdvancedTransformType * transform = context.st_Transform;
+  const std::vector< unsigned long > * sampleIndices     = context.st_SampleIndices;
+  const bool                           computeDerivative = context.st_ComputeDerivative;
+  NonZeroJacobianIndicesType &         nzji              = context.st_NonZeroJacobianIndices;
+  DerivativeType &                     imageJacobian     = context.st_ImageJacobian;
+
+  /** The samples of this context. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure               = NumericTraits< MeasureType >::Zero;
+
+  /** Loop over the fixed image to calculate the mean squares. */
+  for( unsigned long s = context.st_SampleBegin; s < context.st_SampleEnd; ++s )
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const typename ImageSampleContainerType::Element & sample
+      = sampleContainer->ElementAt( sampleIndices ? ( *sampleIndices )[ s ] : s );
+    const FixedImagePointType & fixedPoint = sample.m_ImageCoordinates;
+    RealType                    movingImageValue;
+    MovingImageDerivativeType   movingImageDerivative;
+
+    /** Transform point, with the transform of this context. */
+    const MovingImagePointType mappedPoint = transform->TransformPoint( fixedPoint );
+
+    /** Check if point is inside mask, and compute the moving image value
+     * M(T(x)) and, if needed, the derivative dM/dx.
+     */
+    bool sampleOk = this->IsInsideMovingMask( mappedPoint );
+    if( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative( mappedPoint,
+        movingImageValue, computeDerivative ? &movingImageDerivative : 0 );
+    }
+
+    if( sampleOk )
+    {
+      numberOfPixelsCounted++;
+
+      /** Get the fixed image value. */
+      const RealType & fixedImageValue = static_cast< RealType >( sample.m_ImageValue );
+
+      if( !computeDerivative )
+      {
+        /** The difference squared. */
+        const RealType diff = movingImageValue - fixedImageValue;
+        measure += diff * diff;
+        continue;
+      }
+
+      /** Compute the inner product of the transform Jacobian and the moving image gradient. */
+      transform->EvaluateJacobianWithImageGradientProduct(
+        fixedPoint, movingImageDerivative, imageJacobian, nzji );
+
+      /** Compute this pixel's contribution to the measure and derivatives. */
+      this->UpdateValueAndDerivativeTerms(
+        fixedImageValue, movingImageValue,
+        imageJacobian, nzji,
+        measure, context.st_Derivatives[ 0 ] );
+
+    } // end if sampleOk
+
+  } // end for loop over the samples of this context
+
+  context.st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  context.st_Values[ 0 ]           = measure;
+
+} // end ThreadedGetValueAndDerivativeInContext()
+
+
+/**
+ * ******************* AfterGetValueAndDerivativeInContext *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::AfterGetValueAndDerivativeInContext( const EvaluationContextType & context,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** The normalization factor. */
+  double normal_sum = 0.0;
+  if( context.st_NumberOfPixelsCounted > 0 )
+  {
+    normal_sum = this->m_NormalizationFactor
+      / static_cast< double >( context.st_NumberOfPixelsCounted );
+  }
+
+  value = context.st_Values[ 0 ] * normal_sum;
+  if( context.st_ComputeDerivative )
+  {
+    derivative = context.st_Derivatives[ 0 ] * normal_sum;
+  }
+
+} // end AfterGetValueAndDerivativeInContext()
+
+
 /**
  * *************** UpdateValueAndDerivativeTerms ***************************
  */
@@ -881,6 +988,25 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const
 {
   itkDebugMacro( "GetSelfHessian()" );
+
+  typename CompressedHessianType::Pointer compressedH = CompressedHessianType::New();
+  this->GetCompressedSelfHessian( parameters, compressedH );
+  compressedH->ConvertToVnlSparseMatrix( H );
+
+} // end GetSelfHessian()
+
+
+/**
+ * ******************* GetCompressedSelfHessian *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetCompressedSelfHessian( const TransformParametersType & parameters,
+  CompressedHessianType * H ) const
+{
+  itkDebugMacro( "GetCompressedSelfHessian()" );
   typedef Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
 
   /** Initialize some variables. */
@@ -888,20 +1014,9 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
   randomGenerator->Initialize();
 
-  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
-  NonZeroJacobianIndicesType nzji(
-  this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  DerivativeType        imageJacobian( nzji.size() );
-  TransformJacobianType jacobian;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0); // done by set_size if sparse matrix
-
   /** Smooth fixed image */
   typename SmootherType::Pointer smoother = SmootherType::New();
   smoother->SetInput( this->GetFixedImage() );
@@ -924,28 +1039,136 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
    * Actually we could do without a sampler, but it's easy like this.
    */
   typename SelfHessianSamplerType::Pointer sampler = SelfHessianSamplerType::New();
-  //typename DummyFixedImageInterpolatorType::Pointer dummyInterpolator =
-  //  DummyFixedImageInterpolatorType::New();
   sampler->SetInputImageRegion( this->GetImageSampler()->GetInputImageRegion() );
   sampler->SetMask( this->GetImageSampler()->GetMask() );
   sampler->SetInput( smoother->GetInput() );
   sampler->SetNumberOfSamples( this->m_NumberOfSamplesForSelfHessian );
-  //sampler->SetInterpolator( dummyInterpolator );
 
   /** Update the imageSampler and get a handle to the sample container. */
   sampler->Update();
-  ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
+  ImageSampleContainerPointer sampleContainer     = sampler->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  /** Draw the noise that is added to the fixed image derivatives beforehand,
+   * so that the result does not depend on the number of threads.
+   */
+  std::vector< double > noise( sampleContainerSize * FixedImageDimension );
+  for( std::size_t i = 0; i < noise.size(); ++i )
+  {
+    noise[ i ] = randomGenerator->GetVariateWithClosedRange(
+      this->m_SelfHessianNoiseRange ) - this->m_SelfHessianNoiseRange / 2.0;
+  }
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  /** Assemble the SelfHessian from chunks of samples; the Jacobians of the
+   * samples of a chunk are computed multi-threaded.
+   */
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  H->InitializeAssembly( this->GetNumberOfParameters(),
+    this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices(), 1,
+    numberOfThreads, 1e-14 );
+
+  SelfHessianThreaderParameterType threaderParameters;
+  threaderParameters.st_Metric            = this;
+  threaderParameters.st_SampleContainer   = sampleContainer.GetPointer();
+  threaderParameters.st_FixedInterpolator = fixedInterpolator.GetPointer();
+  threaderParameters.st_Noise             = &noise;
+  threaderParameters.st_Hessian           = H;
+  threaderParameters.st_NumberOfPixelsCounted.assign( numberOfThreads, 0 );
+
+  const SizeValueType numberOfSamplesPerChunk = H->GetNumberOfSamplesPerChunk();
+  for( SizeValueType chunkBegin = 0; chunkBegin < sampleContainerSize; chunkBegin += numberOfSamplesPerChunk )
+  {
+    threaderParameters.st_ChunkBegin = chunkBegin;
+    threaderParameters.st_ChunkEnd   = std::min< SizeValueType >( chunkBegin + numberOfSamplesPerChunk, sampleContainerSize );
+    H->BeginChunk( threaderParameters.st_ChunkEnd - chunkBegin );
+
+    this->m_Threader->SetSingleMethod( Self::SelfHessianThreaderCallback, &threaderParameters );
+    this->m_Threader->SingleMethodExecute();
+
+    H->AddChunk();
+  }
+
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_NumberOfPixelsCounted += threaderParameters.st_NumberOfPixelsCounted[ i ];
+  }
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(
+    sampleContainerSize, this->m_NumberOfPixelsCounted );
+
+  /** Assemble and scale the SelfHessian. */
+  if( this->m_NumberOfPixelsCounted > 0 )
+  {
+    H->FinishAssembly();
+    H->Scale( 2.0 * this->m_NormalizationFactor
+      / static_cast< double >( this->m_NumberOfPixelsCounted ) );
+  }
+  else
+  {
+    H->SetIdentity( this->GetNumberOfParameters() );
+  }
+
+} // end GetCompressedSelfHessian()
+
+
+/**
+ * ******************* SelfHessianThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::SelfHessianThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  SelfHessianThreaderParameterType * temp
+    = static_cast< SelfHessianThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedComputeSelfHessianTerms( threadID, temp );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end SelfHessianThreaderCallback()
+
+
+/**
+ * *************** ThreadedComputeSelfHessianTerms ***************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeSelfHessianTerms( ThreadIdType threadId,
+  SelfHessianThreaderParameterType * parameters ) const
+{
+  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
+  NonZeroJacobianIndicesType nzji(
+    this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  DerivativeType        imageJacobian( nzji.size() );
+  TransformJacobianType jacobian;
+
+  /** Get the samples of the current chunk for this thread. */
+  const ImageSampleContainerType * sampleContainer = parameters->st_SampleContainer;
+  const unsigned long              chunkBegin      = parameters->st_ChunkBegin;
+  const unsigned long              chunkEnd        = parameters->st_ChunkEnd;
+  const unsigned long              nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( chunkEnd - chunkBegin )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  unsigned long pos_begin = chunkBegin + nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = chunkBegin + nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > chunkEnd ) ? chunkEnd : pos_begin;
+  pos_end   = ( pos_end > chunkEnd ) ? chunkEnd : pos_end;
+
+  /** Loop over the samples of this thread. */
+  unsigned long numberOfPixelsCounted = 0;
+  for( unsigned long pos = pos_begin; pos < pos_end; ++pos )
   {
     /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    const FixedImagePointType & fixedPoint = sampleContainer->ElementAt( pos ).m_ImageCoordinates;
     MovingImagePointType        mappedPoint;
     MovingImageDerivativeType   movingImageDerivative;
 
@@ -970,18 +1193,13 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 
     if( sampleOk )
     {
-      this->m_NumberOfPixelsCounted++;
+      ++numberOfPixelsCounted;
 
-      /** Use the derivative of the fixed image for the self Hessian!
-       * \todo: we can do this more efficient without the interpolation,
-       * without the sampler, and with a precomputed gradient image,
-       * but is this the bottleneck?
-       */
-      movingImageDerivative = fixedInterpolator->EvaluateDerivative( fixedPoint );
+      /** Use the derivative of the fixed image for the self Hessian! */
+      movingImageDerivative = parameters->st_FixedInterpolator->EvaluateDerivative( fixedPoint );
       for( unsigned int d = 0; d < FixedImageDimension; ++d )
       {
-        movingImageDerivative[ d ] += randomGenerator->GetVariateWithClosedRange(
-          this->m_SelfHessianNoiseRange ) - this->m_SelfHessianNoiseRange / 2.0;
+        movingImageDerivative[ d ] += ( *parameters->st_Noise )[ pos * FixedImageDimension + d ];
       }
 
       /** Get the TransformJacobian dT/dmu. */
@@ -991,109 +1209,16 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
       this->EvaluateTransformJacobianInnerProduct(
         jacobian, movingImageDerivative, imageJacobian );
 
-      /** Compute this pixel's contribution to the SelfHessian. */
-      this->UpdateSelfHessianTerms( imageJacobian, nzji, H );
+      /** Store this pixel's contribution to the SelfHessian. */
+      parameters->st_Hessian->SetSampleJacobian( pos - chunkBegin, nzji, imageJacobian.data_block() );
 
     } // end if sampleOk
 
   } // end for loop over the image sample container
 
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
-
-  /** Compute the measure value and derivative. */
-  if( this->m_NumberOfPixelsCounted > 0 )
-  {
-    const double normal_sum = 2.0 * this->m_NormalizationFactor
-      / static_cast< double >( this->m_NumberOfPixelsCounted );
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H.scale_row( i, normal_sum );
-    }
-  }
-  else
-  {
-    //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H( i, i ) = 1.0;
-    }
-  }
-
-} // end GetSelfHessian()
-
-
-/**
- * *************** UpdateSelfHessianTerms ***************************
- */
-
-template< class TFixedImage, class TMovingImage >
-void
-AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
-::UpdateSelfHessianTerms(
-  const DerivativeType & imageJacobian,
-  const NonZeroJacobianIndicesType & nzji,
-  HessianType & H ) const
-{
-  typedef typename HessianType::row    RowType;
-  typedef typename RowType::iterator   RowIteratorType;
-  typedef typename HessianType::pair_t ElementType;
-
-  // does not work for sparse matrix. \todo: distinguish between sparse and nonsparse
-  ///** Do rank-1 update of H */
-  //if ( nzji.size() == this->GetNumberOfParameters() )
-  //{
-  //  /** Loop over all Jacobians. */
-  //  vnl_matrix_update( H, imageJacobian, imageJacobian );
-  //}
-  //else
-  //{
-  /** Only pick the nonzero Jacobians.
-  * Save only upper triangular part of the matrix */
-  const unsigned int imjacsize = imageJacobian.GetSize();
-  for( unsigned int i = 0; i < imjacsize; ++i )
-  {
-    const unsigned int row      = nzji[ i ];
-    const double       imjacrow = imageJacobian[ i ];
-
-    RowType &       rowVector = H.get_row( row );
-    RowIteratorType rowIt     = rowVector.begin();
-
-    for( unsigned int j = i; j < imjacsize; ++j )
-    {
-      const unsigned int col = nzji[ j ];
-      const double       val = imjacrow * imageJacobian[ j ];
-      if( ( val < 1e-14 ) && ( val > -1e-14 ) )
-      {
-        continue;
-      }
-
-      /** The following implements:
-       * H(row,col) += imjacrow * imageJacobian[ j ];
-       * But more efficient.
-       */
-
-      /** Go to next element */
-      for(; ( rowIt != rowVector.end() ) && ( ( *rowIt ).first < col ); ++rowIt )
-      {}
-
-      if( ( rowIt == rowVector.end() ) || ( ( *rowIt ).first != col ) )
-      {
-        /** Add new column to the row and set iterator to that column. */
-        rowIt = rowVector.insert( rowIt, ElementType( col, val ) );
-      }
-      else
-      {
-        /** Add to existing value */
-        ( *rowIt ).second += val;
-      }
-    }
-  }
-
-  //} // end else
+  parameters->st_NumberOfPixelsCounted[ threadId ] += numberOfPixelsCounted;
 
-} // end UpdateSelfHessianTerms()
+} // end ThreadedComputeSelfHessianTerms()
 
 
 } // end namespace itk
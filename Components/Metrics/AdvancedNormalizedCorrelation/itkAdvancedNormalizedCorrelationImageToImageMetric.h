@@ -180,6 +180,10 @@ public:
     const TransformParametersType & parameters,
     MeasureType & value, DerivativeType & derivative ) const override;
 
+  /** This metric can be evaluated at several positions concurrently. */
+  bool GetSupportsConcurrentEvaluation( void ) const override
+  { return this->m_AdvancedTransform.IsNotNull(); }
+
   /** Set/Get SubtractMean boolean. If true, the sample mean is subtracted
    * from the sample values in the cross-correlation formula and
    * typically results in narrower valleys in the cost function.
@@ -209,6 +213,7 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::EvaluationContextType               EvaluationContextType;
 
   /** Compute a pixel's contribution to the derivative terms;
    * Called by GetValueAndDerivative().
@@ -238,6 +243,19 @@ protected:
   /** AccumulateDerivatives threader callback function */
   static ITK_THREAD_RETURN_TYPE AccumulateDerivativesThreaderCallback( void * arg );
 
+  /** An evaluation context holds the sums sff, smm, sfm, sf and sm, and
+   * the derivative terms derivativeF, derivativeM and differential.
+   */
+  void InitializeEvaluationContext( EvaluationContextType & context ) const override;
+
+  /** Get the sums and derivative terms for the samples of an evaluation context. */
+  void ThreadedGetValueAndDerivativeInContext(
+    EvaluationContextType & context ) const override;
+
+  /** Compute value and derivatives from the sums of an evaluation context. */
+  void AfterGetValueAndDerivativeInContext( const EvaluationContextType & context,
+    MeasureType & value, DerivativeType & derivative ) const override;
+
 private:
 
   AdvancedNormalizedCorrelationImageToImageMetric( const Self & ); // purposely not implemented
@@ -816,6 +816,178 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 } // end AfterThreadedGetValueAndDerivative()
 
 
+/**
+ * ******************* InitializeEvaluationContext *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeEvaluationContext( EvaluationContextType & context ) const
+{
+  context.st_Values.resize( 5 );
+  context.st_Derivatives.resize( 3 );
+
+} // end InitializeEvaluationContext()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivativeInContext *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivativeInContext( EvaluationContextType & context ) const
+{
+  /** The transform and the buffers of this context. */
+  const typename Superclass::AdvancedTransformType * transform = context.st_Transform;
+  const std::vector< unsigned long > * sampleIndices     = context.st_SampleIndices;
+  const bool                           computeDerivative = context.st_ComputeDerivative;
+  NonZeroJacobianIndicesType &         nzji              = context.st_NonZeroJacobianIndices;
+  DerivativeType &                     imageJacobian     = context.st_ImageJacobian;
+
+  /** The samples of this context. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+
+  /** Create variables to store intermediate results. */
+  AccumulateType sff                   = NumericTraits< AccumulateType >::Zero;
+  AccumulateType smm                   = NumericTraits< AccumulateType >::Zero;
+  AccumulateType sfm                   = NumericTraits< AccumulateType >::Zero;
+  AccumulateType sf                    = NumericTraits< AccumulateType >::Zero;
+  AccumulateType sm                    = NumericTraits< AccumulateType >::Zero;
+  unsigned long  numberOfPixelsCounted = 0;
+
+  /** Loop over the samples of this context. */
+  for( unsigned long s = context.st_SampleBegin; s < context.st_SampleEnd; ++s )
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const typename ImageSampleContainerType::Element & sample
+      = sampleContainer->ElementAt( sampleIndices ? ( *sampleIndices )[ s ] : s );
+    const FixedImagePointType & fixedPoint = sample.m_ImageCoordinates;
+    RealType                    movingImageValue;
+    MovingImageDerivativeType   movingImageDerivative;
+
+    /** Transform point, with the transform of this context. */
+    const MovingImagePointType mappedPoint = transform->TransformPoint( fixedPoint );
+
+    /** Check if point is inside mask, and compute the moving image value
+     * M(T(x)) and, if needed, the derivative dM/dx.
+     */
+    bool sampleOk = this->IsInsideMovingMask( mappedPoint );
+    if( sampleOk )
+    {
+      sampleOk = this->EvaluateMovingImageValueAndDerivative( mappedPoint,
+        movingImageValue, computeDerivative ? &movingImageDerivative : 0 );
+    }
+
+    if( sampleOk )
+    {
+      numberOfPixelsCounted++;
+
+      /** Get the fixed image value. */
+      const RealType & fixedImageValue = static_cast< RealType >( sample.m_ImageValue );
+
+      /** Update some sums needed to calculate the value of NC. */
+      sff += fixedImageValue  * fixedImageValue;
+      smm += movingImageValue * movingImageValue;
+      sfm += fixedImageValue  * movingImageValue;
+      sf  += fixedImageValue;  // Only needed when m_SubtractMean == true
+      sm  += movingImageValue; // Only needed when m_SubtractMean == true
+
+      if( computeDerivative )
+      {
+        /** Compute the inner product of the transform Jacobian and the moving image gradient. */
+        transform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, movingImageDerivative, imageJacobian, nzji );
+
+        /** Compute this voxel's contribution to the derivative terms. */
+        this->UpdateDerivativeTerms(
+          fixedImageValue, movingImageValue, imageJacobian, nzji,
+          context.st_Derivatives[ 0 ], context.st_Derivatives[ 1 ], context.st_Derivatives[ 2 ] );
+      }
+
+    } // end if sampleOk
+
+  } // end for loop over the samples of this context
+
+  context.st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  context.st_Values[ 0 ]           = sff;
+  context.st_Values[ 1 ]           = smm;
+  context.st_Values[ 2 ]           = sfm;
+  context.st_Values[ 3 ]           = sf;
+  context.st_Values[ 4 ]           = sm;
+
+} // end ThreadedGetValueAndDerivativeInContext()
+
+
+/**
+ * ******************* AfterGetValueAndDerivativeInContext *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::AfterGetValueAndDerivativeInContext( const EvaluationContextType & context,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  AccumulateType sff = context.st_Values[ 0 ];
+  AccumulateType smm = context.st_Values[ 1 ];
+  AccumulateType sfm = context.st_Values[ 2 ];
+  AccumulateType sf  = context.st_Values[ 3 ];
+  AccumulateType sm  = context.st_Values[ 4 ];
+
+  /** If SubtractMean, then subtract things from sff, smm and sfm. */
+  const RealType N = static_cast< RealType >( context.st_NumberOfPixelsCounted );
+  if( this->m_SubtractMean && N > 0 )
+  {
+    sff -= ( sf * sf / N );
+    smm -= ( sm * sm / N );
+    sfm -= ( sf * sm / N );
+  }
+
+  /** The denominator of the value and the derivative. */
+  const RealType denom = -1.0 * std::sqrt( sff * smm );
+
+  /** Check for sufficiently large denominator. */
+  if( denom > -1e-14 )
+  {
+    value = NumericTraits< MeasureType >::Zero;
+    if( context.st_ComputeDerivative )
+    {
+      derivative.SetSize( this->GetNumberOfParameters() );
+      derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    }
+    return;
+  }
+
+  /** Calculate the metric value. */
+  value = sfm / denom;
+  if( !context.st_ComputeDerivative )
+  {
+    return;
+  }
+
+  /** Calculate the metric derivative. */
+  const DerivativeType & derivativeF  = context.st_Derivatives[ 0 ];
+  const DerivativeType & derivativeM  = context.st_Derivatives[ 1 ];
+  const DerivativeType & differential = context.st_Derivatives[ 2 ];
+  derivative.SetSize( this->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
+  {
+    double derF = derivativeF[ i ];
+    double derM = derivativeM[ i ];
+    if( this->m_SubtractMean )
+    {
+      derF -= ( sf / N ) * differential[ i ];
+      derM -= ( sm / N ) * differential[ i ];
+    }
+    derivative[ i ] = ( derF - ( sfm / smm ) * derM ) / denom;
+  }
+
+} // end AfterGetValueAndDerivativeInContext()
+
+
 /**
  *********** AccumulateDerivativesThreaderCallback *************
  */
@@ -121,9 +121,10 @@ public:
   typedef typename Superclass::SpatialHessianType SpatialHessianType;
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
-  typedef typename Superclass::InternalMatrixType InternalMatrixType;
-  typedef typename Superclass::HessianValueType   HessianValueType;
-  typedef typename Superclass::HessianType        HessianType;
+  typedef typename Superclass::InternalMatrixType    InternalMatrixType;
+  typedef typename Superclass::HessianValueType      HessianValueType;
+  typedef typename Superclass::HessianType           HessianType;
+  typedef typename Superclass::CompressedHessianType CompressedHessianType;
 
   /** Define the dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int, FixedImageType::ImageDimension );
@@ -156,6 +157,12 @@ public:
   /** Experimental feature: compute SelfHessian */
   void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const override;
 
+  /** Experimental feature: compute SelfHessian in compressed sparse row format.
+   * The samples are processed, and the matrix is assembled, multi-threaded.
+   */
+  void GetCompressedSelfHessian( const TransformParametersType & parameters,
+    CompressedHessianType * H ) const override;
+
   /** Default: 100000 */
   itkSetMacro( NumberOfSamplesForSelfHessian, unsigned int );
   itkGetConstMacro( NumberOfSamplesForSelfHessian, unsigned int );
@@ -174,6 +181,25 @@ protected:
   /** Typedefs for SelfHessian */
   typedef ImageGridSampler< FixedImageType > SelfHessianSamplerType;
 
+  /** Helper struct that multi-threads the computation of the SelfHessian. */
+  struct SelfHessianThreaderParameterType
+  {
+    const Self *                     st_Metric;
+    const ImageSampleContainerType * st_SampleContainer;
+    CompressedHessianType *          st_Hessian;
+    SizeValueType                    st_ChunkBegin;
+    SizeValueType                    st_ChunkEnd;
+    std::vector< SizeValueType >     st_NumberOfPixelsCounted;
+  };
+
+  /** SelfHessian threader callback function. */
+  static ITK_THREAD_RETURN_TYPE SelfHessianThreaderCallback( void * arg );
+
+  /** Compute the Jacobians of the SelfHessian samples of one thread, in the
+   * current chunk; Called by GetCompressedSelfHessian(). */
+  void ThreadedComputeSelfHessianTerms( ThreadIdType threadId,
+    SelfHessianThreaderParameterType * parameters ) const;
+
   /** The constructor. */
   TransformBendingEnergyPenaltyTerm();
 
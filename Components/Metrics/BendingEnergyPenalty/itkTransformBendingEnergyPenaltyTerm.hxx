@@ -679,32 +679,34 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 {
   itkDebugMacro( "GetSelfHessian()" );
 
-  typedef typename HessianType::row    RowType;
-  typedef typename RowType::iterator   RowIteratorType;
-  typedef typename HessianType::pair_t ElementType;
+  typename CompressedHessianType::Pointer compressedH = CompressedHessianType::New();
+  this->GetCompressedSelfHessian( parameters, compressedH );
+  compressedH->ConvertToVnlSparseMatrix( H );
+
+} // end GetSelfHessian()
+
+
+/**
+ * ******************* GetCompressedSelfHessian *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::GetCompressedSelfHessian( const TransformParametersType & parameters,
+  CompressedHessianType * H ) const
+{
+  itkDebugMacro( "GetCompressedSelfHessian()" );
 
   /** Initialize some variables. */
   this->m_NumberOfPixelsCounted = 0;
 
-  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
-  NonZeroJacobianIndicesType nonZeroJacobianIndices(
-  this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  JacobianOfSpatialHessianType jacobianOfSpatialHessian;
-
   /** Make sure the transform parameters are up to date. */
   //this->SetTransformParameters( parameters );
 
-  /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0); //done by set_size for sparse matrix
   if( !this->m_AdvancedTransform->GetHasNonZeroJacobianOfSpatialHessian() )
   {
-    //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H( i, i ) = 1.0;
-    }
+    H->SetIdentity( this->GetNumberOfParameters() );
     return;
   }
 
@@ -719,23 +721,122 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   sampler->Update();
   ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  /** Assemble the SelfHessian from chunks of samples; the Jacobians of spatial
+   * Hessian of the samples of a chunk are computed multi-threaded.
+   * Per nonzero Jacobian index they are stored as a flat vector of
+   * FixedImageDimension^3 values, so that the inner product of two of these
+   * vectors equals \sum_k \sum_i \sum_j A_kij B_kij.
+   */
+  const ThreadIdType  numberOfThreads     = Self::GetNumberOfWorkUnits();
+  const SizeValueType sampleContainerSize = sampleContainer->Size();
+  H->InitializeAssembly( this->GetNumberOfParameters(),
+    this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices(),
+    FixedImageDimension * FixedImageDimension * FixedImageDimension,
+    numberOfThreads, 0.0 );
+
+  SelfHessianThreaderParameterType threaderParameters;
+  threaderParameters.st_Metric          = this;
+  threaderParameters.st_SampleContainer = sampleContainer.GetPointer();
+  threaderParameters.st_Hessian         = H;
+  threaderParameters.st_NumberOfPixelsCounted.assign( numberOfThreads, 0 );
+
+  const SizeValueType numberOfSamplesPerChunk = H->GetNumberOfSamplesPerChunk();
+  for( SizeValueType chunkBegin = 0; chunkBegin < sampleContainerSize; chunkBegin += numberOfSamplesPerChunk )
+  {
+    threaderParameters.st_ChunkBegin = chunkBegin;
+    threaderParameters.st_ChunkEnd   = std::min< SizeValueType >( chunkBegin + numberOfSamplesPerChunk, sampleContainerSize );
+    H->BeginChunk( threaderParameters.st_ChunkEnd - chunkBegin );
+
+    this->m_Threader->SetSingleMethod( Self::SelfHessianThreaderCallback, &threaderParameters );
+    this->m_Threader->SingleMethodExecute();
+
+    H->AddChunk();
+  }
+
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_NumberOfPixelsCounted += threaderParameters.st_NumberOfPixelsCounted[ i ];
+  }
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(
+    sampleContainerSize, this->m_NumberOfPixelsCounted );
+
+  /** Assemble and scale the SelfHessian: H = 2/N \sum_x (d/dmu dT/dxdx)^2. */
+  if( this->m_NumberOfPixelsCounted > 0 )
+  {
+    H->FinishAssembly();
+    H->Scale( 2.0 / static_cast< double >( this->m_NumberOfPixelsCounted ) );
+  }
+  else
+  {
+    H->SetIdentity( this->GetNumberOfParameters() );
+  }
+
+} // end GetCompressedSelfHessian()
+
+
+/**
+ * ******************* SelfHessianThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_TYPE
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::SelfHessianThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  SelfHessianThreaderParameterType * temp
+    = static_cast< SelfHessianThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedComputeSelfHessianTerms( threadID, temp );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end SelfHessianThreaderCallback()
+
+
+/**
+ * ******************* ThreadedComputeSelfHessianTerms *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedComputeSelfHessianTerms( ThreadIdType threadId,
+  SelfHessianThreaderParameterType * parameters ) const
+{
+  /** Array that stores the sparse jacobian of spatial Hessian + indices. */
+  NonZeroJacobianIndicesType nonZeroJacobianIndices(
+    this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  JacobianOfSpatialHessianType jacobianOfSpatialHessian;
+  const unsigned int           numberOfComponents
+    = FixedImageDimension * FixedImageDimension * FixedImageDimension;
+  std::vector< double > flatJacobian( nonZeroJacobianIndices.size() * numberOfComponents );
+
+  /** Get the samples of the current chunk for this thread. */
+  const ImageSampleContainerType * sampleContainer = parameters->st_SampleContainer;
+  const unsigned long              chunkBegin      = parameters->st_ChunkBegin;
+  const unsigned long              chunkEnd        = parameters->st_ChunkEnd;
+  const unsigned long              nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( chunkEnd - chunkBegin )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  unsigned long pos_begin = chunkBegin + nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = chunkBegin + nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > chunkEnd ) ? chunkEnd : pos_begin;
+  pos_end   = ( pos_end > chunkEnd ) ? chunkEnd : pos_end;
 
   /** Loop over the fixed image to calculate the d/dmu dT/dxdx terms. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  unsigned long numberOfPixelsCounted = 0;
+  for( unsigned long pos = pos_begin; pos < pos_end; ++pos )
   {
     /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    const FixedImagePointType & fixedPoint = sampleContainer->ElementAt( pos ).m_ImageCoordinates;
     MovingImagePointType        mappedPoint;
 
-    /** Although the mapped point is not needed to compute the penalty term,
-     * we compute in order to check if it maps inside the support region of
-     * the B-spline and if it maps inside the moving image mask.
-     */
-
     /** Transform point and check if it is inside the B-spline support region. */
     bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
 
@@ -747,100 +848,31 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 
     if( sampleOk )
     {
-      this->m_NumberOfPixelsCounted++;
+      ++numberOfPixelsCounted;
 
       this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
         jacobianOfSpatialHessian, nonZeroJacobianIndices );
 
-      /** Compute the contribution to the metric derivative of this point. */
-      for( unsigned int muA = 0; muA < nonZeroJacobianIndices.size(); ++muA )
+      /** Flatten the Jacobian of spatial Hessian. */
+      std::vector< double >::iterator flatIt = flatJacobian.begin();
+      for( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
       {
-        const unsigned int nmA       = nonZeroJacobianIndices[ muA ];
-        RowType &          rowVector = H.get_row( nmA );
-        RowIteratorType    rowIt     = rowVector.begin();
-
-        for( unsigned int muB = muA; muB < nonZeroJacobianIndices.size(); ++muB )
+        for( unsigned int k = 0; k < FixedImageDimension; ++k )
         {
-          const unsigned int nmB = nonZeroJacobianIndices[ muB ];
-
-          RealType matrixProduct = 0.0;
-          for( unsigned int k = 0; k < FixedImageDimension; ++k )
-          {
-            /** This computes:
-             * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
-             */
-            const InternalMatrixType & A
-              = jacobianOfSpatialHessian[ muA ][ k ].GetVnlMatrix();
-            const InternalMatrixType & B
-              = jacobianOfSpatialHessian[ muB ][ k ].GetVnlMatrix();
-
-            typename InternalMatrixType::const_iterator itA    = A.begin();
-            typename InternalMatrixType::const_iterator itB    = B.begin();
-            typename InternalMatrixType::const_iterator itAend = A.end();
-            while( itA != itAend )
-            {
-              matrixProduct += ( *itA ) * ( *itB );
-              ++itA;
-              ++itB;
-            }
-
-          }
-
-          /** Store at the right location in the H matrix.
-          * Only upper triangular part is stored */
-
-          /** Update hessian element */
-          if( ( matrixProduct > 1e-12 ) || ( matrixProduct < 1e-12 ) )
-          {
-            /**
-            * H( nmA, nmB ) += 2.0 * matrixProduct;
-            * But more efficient
-            */
-            const double val = 2.0 * matrixProduct;
-
-            /** Go to next element */
-            for(; ( rowIt != rowVector.end() ) && ( ( *rowIt ).first < nmB ); ++rowIt )
-            {}
-
-            if( ( rowIt == rowVector.end() ) || ( ( *rowIt ).first != nmB ) )
-            {
-              /** Add new column to the row and set iterator to that column. */
-              rowIt = rowVector.insert( rowIt, ElementType( nmB, val ) );
-            }
-            else
-            {
-              /** Add to existing value */
-              ( *rowIt ).second += val;
-            }
-          }
+          const InternalMatrixType & A = jacobianOfSpatialHessian[ mu ][ k ].GetVnlMatrix();
+          flatIt = std::copy( A.begin(), A.end(), flatIt );
         }
       }
+
+      /** Store this pixel's contribution to the SelfHessian. */
+      parameters->st_Hessian->SetSampleJacobian( pos - chunkBegin, nonZeroJacobianIndices, flatJacobian.data() );
+
     } // end if sampleOk
   } // end for loop over the image sample container
 
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+  parameters->st_NumberOfPixelsCounted[ threadId ] += numberOfPixelsCounted;
 
-  /** Compute the measure value and derivative. */
-  if( this->m_NumberOfPixelsCounted > 0 )
-  {
-    const double normal_sum = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H.scale_row( i, normal_sum );
-    }
-  }
-  else
-  {
-    //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
-    {
-      H( i, i ) = 1.0;
-    }
-  }
-
-} // end GetSelfHessian()
+} // end ThreadedComputeSelfHessianTerms()
 
 
 } // end namespace itk
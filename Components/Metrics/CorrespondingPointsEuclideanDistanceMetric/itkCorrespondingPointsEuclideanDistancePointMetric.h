@@ -31,6 +31,9 @@ namespace itk
  *  and a fixed point-set.
  *  Correspondence is needed.
  *
+ *  The corresponding points are divided over the threads; each thread sums
+ *  the distances and derivatives of its own points.
+ *
  *
  * \ingroup RegistrationMetrics
  */
@@ -95,6 +98,12 @@ protected:
   CorrespondingPointsEuclideanDistancePointMetric();
   ~CorrespondingPointsEuclideanDistancePointMetric() override {}
 
+  /** Sum the distances of the points of thread threadID. */
+  void ThreadedGetValue( ThreadIdType threadID ) const override;
+
+  /** Sum the distances and their derivatives of the points of thread threadID. */
+  void ThreadedGetValueAndDerivative( ThreadIdType threadID ) const override;
+
 private:
 
   CorrespondingPointsEuclideanDistancePointMetric( const Self & ); // purposely not implemented
@@ -54,55 +54,21 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
     itkExceptionMacro( << "Moving point set has not been assigned" );
   }
 
-  /** Initialize some variables. */
-  this->m_NumberOfPointsCounted = 0;
-  MeasureType     measure = NumericTraits< MeasureType >::Zero;
-  InputPointType  movingPoint;
-  OutputPointType fixedPoint, mappedPoint;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
-  /** Create iterators. */
-  PointIterator pointItFixed  = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointItMoving = movingPointSet->GetPoints()->Begin();
-  PointIterator pointEnd      = fixedPointSet->GetPoints()->End();
+  /** Loop over the corresponding points, multi-threaded. */
+  this->InitializeThreadingParameters();
+  this->LaunchGetValueThreaderCallback();
 
-  /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
+  /** Sum the contributions of the threads. */
+  this->m_NumberOfPointsCounted = 0;
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType i = 0; i < this->m_GetValueAndDerivativePerThreadVariablesSize; ++i )
   {
-    /** Get the current corresponding points. */
-    fixedPoint  = pointItFixed.Value();
-    movingPoint = pointItMoving.Value();
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    //bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-    mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
-
-    /** Check if point is inside mask. */
-    bool sampleOk = true;
-    if( sampleOk )
-    {
-      //sampleOk = this->IsInsideMovingMask( mappedPoint );
-      if( this->m_MovingImageMask.IsNotNull() )
-      {
-        sampleOk = this->m_MovingImageMask->IsInsideInWorldSpace( mappedPoint );
-      }
-    }
-
-    if( sampleOk )
-    {
-      this->m_NumberOfPointsCounted++;
-
-      VnlVectorType diffPoint = ( movingPoint - mappedPoint ).GetVnlVector();
-      measure += diffPoint.magnitude();
-
-    } // end if sampleOk
-
-    ++pointItFixed;
-    ++pointItMoving;
-
-  } // end loop over all corresponding points
+    this->m_NumberOfPointsCounted += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPointsCounted;
+    measure                       += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+  }
 
   return measure / this->m_NumberOfPointsCounted;
 
@@ -154,16 +120,7 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
   }
 
   /** Initialize some variables */
-  this->m_NumberOfPointsCounted = 0;
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
   derivative = DerivativeType( this->GetNumberOfParameters() );
-  derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
-  NonZeroJacobianIndicesType nzji(
-  this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
-  TransformJacobianType jacobian;
-
-  InputPointType  movingPoint;
-  OutputPointType fixedPoint, mappedPoint;
 
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
@@ -180,39 +137,148 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  /** Create iterators. */
-  PointIterator pointItFixed  = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointItMoving = movingPointSet->GetPoints()->Begin();
-  PointIterator pointEnd      = fixedPointSet->GetPoints()->End();
+  /** Loop over the corresponding points, multi-threaded. */
+  this->InitializeThreadingParameters();
+  this->LaunchGetValueAndDerivativeThreaderCallback();
+
+  /** Sum the contributions of the threads. */
+  this->m_NumberOfPointsCounted = 0;
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType i = 0; i < this->m_GetValueAndDerivativePerThreadVariablesSize; ++i )
+  {
+    this->m_NumberOfPointsCounted += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPointsCounted;
+    measure                       += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+  }
+
+  /** Check if enough samples were valid. */
+//   this->CheckNumberOfSamples(
+//     fixedPointSet->GetNumberOfPoints(), this->m_NumberOfPointsCounted );
+
+  /** Copy the measure to value, and accumulate the derivatives of the threads. */
+  value = measure;
+  DerivativeValueType normalization = 1.0;
+  if( this->m_NumberOfPointsCounted > 0 )
+  {
+    normalization = this->m_NumberOfPointsCounted;
+    value         = measure / this->m_NumberOfPointsCounted;
+  }
+  this->AccumulateDerivatives( derivative, normalization );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValue *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::ThreadedGetValue( ThreadIdType threadID ) const
+{
+  /** The points of this thread. */
+  unsigned long pointBegin = 0;
+  unsigned long pointEnd   = 0;
+  this->GetThreadPointRange( threadID, pointBegin, pointEnd );
+
+  const typename FixedPointSetType::PointsContainer * fixedPoints
+    = this->GetFixedPointSet()->GetPoints();
+  const typename MovingPointSetType::PointsContainer * movingPoints
+    = this->GetMovingPointSet()->GetPoints();
+
+  /** Initialize some variables. */
+  SizeValueType   numberOfPointsCounted = NumericTraits< SizeValueType >::Zero;
+  MeasureType     measure               = NumericTraits< MeasureType >::Zero;
+  InputPointType  movingPoint;
+  OutputPointType fixedPoint, mappedPoint;
 
   /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
+  for( unsigned long p = pointBegin; p < pointEnd; ++p )
   {
     /** Get the current corresponding points. */
-    fixedPoint  = pointItFixed.Value();
-    movingPoint = pointItMoving.Value();
+    fixedPoint  = fixedPoints->ElementAt( p );
+    movingPoint = movingPoints->ElementAt( p );
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    //bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    /** Transform point. */
     mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
 
     /** Check if point is inside mask. */
     bool sampleOk = true;
+    if( this->m_MovingImageMask.IsNotNull() )
+    {
+      sampleOk = this->m_MovingImageMask->IsInsideInWorldSpace( mappedPoint );
+    }
+
     if( sampleOk )
     {
-      //sampleOk = this->IsInsideMovingMask( mappedPoint );
-      if( this->m_MovingImageMask.IsNotNull() )
-      {
-        sampleOk = this->m_MovingImageMask->IsInsideInWorldSpace( mappedPoint );
-      }
+      numberOfPointsCounted++;
+
+      VnlVectorType diffPoint = ( movingPoint - mappedPoint ).GetVnlVector();
+      measure += diffPoint.magnitude();
+
+    } // end if sampleOk
+
+  } // end loop over the corresponding points of this thread
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadID ].st_NumberOfPointsCounted = numberOfPointsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[ threadID ].st_Value                 = measure;
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet >
+::ThreadedGetValueAndDerivative( ThreadIdType threadID ) const
+{
+  /** The points of this thread. */
+  unsigned long pointBegin = 0;
+  unsigned long pointEnd   = 0;
+  this->GetThreadPointRange( threadID, pointBegin, pointEnd );
+
+  const typename FixedPointSetType::PointsContainer * fixedPoints
+    = this->GetFixedPointSet()->GetPoints();
+  const typename MovingPointSetType::PointsContainer * movingPoints
+    = this->GetMovingPointSet()->GetPoints();
+
+  /** Initialize some variables. */
+  SizeValueType    numberOfPointsCounted = NumericTraits< SizeValueType >::Zero;
+  MeasureType      measure               = NumericTraits< MeasureType >::Zero;
+  DerivativeType & derivative            = this->m_GetValueAndDerivativePerThreadVariables[ threadID ].st_Derivative;
+  NonZeroJacobianIndicesType nzji(
+  this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
+  TransformJacobianType jacobian;
+
+  InputPointType  movingPoint;
+  OutputPointType fixedPoint, mappedPoint;
+
+  /** Loop over the corresponding points. */
+  for( unsigned long p = pointBegin; p < pointEnd; ++p )
+  {
+    /** Get the current corresponding points. */
+    fixedPoint  = fixedPoints->ElementAt( p );
+    movingPoint = movingPoints->ElementAt( p );
+
+    /** Transform point. */
+    mappedPoint = this->m_Transform->TransformPoint( fixedPoint );
+
+    /** Check if point is inside mask. */
+    bool sampleOk = true;
+    if( this->m_MovingImageMask.IsNotNull() )
+    {
+      sampleOk = this->m_MovingImageMask->IsInsideInWorldSpace( mappedPoint );
     }
 
     if( sampleOk )
     {
-      this->m_NumberOfPointsCounted++;
+      numberOfPointsCounted++;
 
       /** Get the TransformJacobian dT/dmu. */
-      //this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
       this->m_Transform->GetJacobian( fixedPoint, jacobian, nzji );
 
       VnlVectorType diffPoint = ( movingPoint - mappedPoint ).GetVnlVector();
@@ -242,24 +308,13 @@ CorrespondingPointsEuclideanDistancePointMetric< TFixedPointSet, TMovingPointSet
 
     } // end if sampleOk
 
-    ++pointItFixed;
-    ++pointItMoving;
-
-  } // end loop over all corresponding points
-
-  /** Check if enough samples were valid. */
-//   this->CheckNumberOfSamples(
-//     fixedPointSet->GetNumberOfPoints(), this->m_NumberOfPointsCounted );
+  } // end loop over the corresponding points of this thread
 
-  /** Copy the measure to value. */
-  value = measure;
-  if( this->m_NumberOfPointsCounted > 0 )
-  {
-    derivative /= this->m_NumberOfPointsCounted;
-    value       = measure / this->m_NumberOfPointsCounted;
-  }
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadID ].st_NumberOfPointsCounted = numberOfPointsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[ threadID ].st_Value                 = measure;
 
-} // end GetValueAndDerivative()
+} // end ThreadedGetValueAndDerivative()
 
 
 } // end namespace itk
@@ -33,6 +33,8 @@
 #include "itkImageRegionIterator.h"
 #include "itkMultiResolutionPyramidImageFilter.h"
 
+#include <vector>
+
 namespace itk
 {
 /**
@@ -63,6 +65,11 @@ namespace itk
  *  resolutions.
  *  - In the publication above, the grid spacing was set as [4, 4, 1].
  *
+ * The point pairs of which the distance is preserved, i.e. the penalty grid points
+ * and their neighbours with the same rigidity index, are found once per resolution
+ * in Initialize(), and stored in compressed sparse row format. The penalty and its
+ * derivative are then computed multi-threaded over the pairs and the points.
+ *
  * \author Jihun Kim, University of Michigan, Ann Arbor
  * \author Martha M. Matuszak, University of Michigan, Ann Arbor
  * \author Kazuhiro Saitou, University of Michigan, Ann Arbor
@@ -126,6 +133,7 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::ScalarType                   ScalarType;
+  typedef typename Superclass::ThreadInfoType               ThreadInfoType;
 
   /** Typedefs from the AdvancedTransform. */
   typedef typename Superclass::SpatialJacobianType           SpatialJacobianType;
@@ -194,6 +202,10 @@ public:
 
   itkGetMacro( NumberOfRigidGrids, unsigned int );
 
+  /** Get the number of point pairs of which the distance is preserved. */
+  SizeValueType GetNumberOfPointPairs( void ) const
+  { return this->m_PairNeighbors.size(); }
+
 protected:
 
   /** The constructor. */
@@ -205,6 +217,9 @@ protected:
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Sum the derivative contributions of the points of thread threadID. */
+  void ThreadedGetValueAndDerivative( ThreadIdType threadID ) override;
+
 private:
 
   /** The private constructor. */
@@ -213,18 +228,76 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                        // purposely not implemented
 
+  /** Find the point pairs in the penalty grid, and store them. */
+  void InitializePointPairs( void );
+
+  /** Transform the points [ pointBegin, pointEnd [. */
+  void TransformPoints( const SizeValueType pointBegin, const SizeValueType pointEnd ) const;
+
+  /** Compute the penalty of the pairs of the centers [ centerBegin, centerEnd [,
+   * and, if requested, the derivative of each pair with respect to its distance.
+   */
+  MeasureType ComputePointPairs( const SizeValueType centerBegin, const SizeValueType centerEnd,
+    const bool computeDerivative ) const;
+
+  /** Add the derivative contributions of the points [ pointBegin, pointEnd [ to derivative. */
+  void AccumulatePointDerivatives( const SizeValueType pointBegin, const SizeValueType pointEnd,
+    DerivativeType & derivative ) const;
+
+  /** Get the part [ begin, end [ of [ 0, size [ of thread threadID. */
+  void GetThreadRange( const ThreadIdType threadID, const SizeValueType size,
+    SizeValueType & begin, SizeValueType & end ) const;
+
+  /** The threader callbacks. */
+  static ITK_THREAD_RETURN_TYPE TransformPointsThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE ComputePointPairsThreaderCallback( void * arg );
+
+  struct PointPairsMultiThreaderParameterType
+  {
+    const Self * st_Self;
+    bool         st_ComputeDerivative;
+  };
+
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform;
 
   mutable MeasureType m_RigidityPenaltyTermValue;
 
-  BSplineKnotImagePointer m_BSplineKnotImage;
   PenaltyGridImagePointer m_PenaltyGridImage;
   SegmentedImagePointer   m_SegmentedImage;
   SegmentedImagePointer   m_SampledSegmentedImage;
 
   unsigned int m_NumberOfRigidGrids;
 
+  /** The penalty grid points that are part of a pair. */
+  std::vector< InputPointType > m_PairPoints;
+
+  /** The pairs, in compressed sparse row format. Center c is point m_PairCenters[ c ],
+   * its pairs are [ m_PairPointers[ c ], m_PairPointers[ c + 1 ] [, and they all have
+   * weight m_PairWeights[ c ]. For each pair, m_PairNeighbors is the neighbouring point,
+   * and m_PairReferenceDistances the squared distance in the fixed image.
+   */
+  std::vector< SizeValueType > m_PairCenters;
+  std::vector< SizeValueType > m_PairPointers;
+  std::vector< MeasureType >   m_PairWeights;
+  std::vector< SizeValueType > m_PairNeighbors;
+  std::vector< MeasureType >   m_PairReferenceDistances;
+
+  /** For each point, the pairs in which it is the neighbour, in compressed sparse
+   * row format, and the center that it is, or -1.
+   */
+  std::vector< SizeValueType >   m_NeighborPairPointers;
+  std::vector< SizeValueType >   m_NeighborPairs;
+  std::vector< OffsetValueType > m_PointCenters;
+
+  /** The transformed points, and the derivative of each pair with respect to
+   * the difference of its transformed points, of the current evaluation.
+   */
+  mutable std::vector< OutputPointType >       m_TransformedPoints;
+  mutable std::vector< MeasureType >           m_PairDerivatives;
+  mutable PointPairsMultiThreaderParameterType m_PointPairsThreaderParameters;
+
 };
 
 // end class DistancePreservingRigidityPenaltyTerm
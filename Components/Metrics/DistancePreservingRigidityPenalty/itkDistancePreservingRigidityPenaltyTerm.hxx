@@ -20,8 +20,11 @@
 
 #include "itkDistancePreservingRigidityPenaltyTerm.h"
 
-#include "itkZeroFluxNeumannBoundaryCondition.h"
-#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
 
 namespace itk
 {
@@ -38,7 +41,6 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
   this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
 
   /** Images required for penalty calculation */
-  this->m_BSplineKnotImage      = 0;
   this->m_PenaltyGridImage      = 0;
   this->m_SegmentedImage        = 0;
   this->m_SampledSegmentedImage = 0;
@@ -49,6 +51,10 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
   /** We don't use an image sampler for this advanced metric. */
   this->SetUseImageSampler( false );
 
+  /** Multi-threading. */
+  this->m_PointPairsThreaderParameters.st_Self              = this;
+  this->m_PointPairsThreaderParameters.st_ComputeDerivative = false;
+
 } // end Constructor
 
 
@@ -77,35 +83,6 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
     itkExceptionMacro( << "ERROR: this metric expects a B-spline transform." );
   }
 
-  /** Initialize BSplineKnotImage. */
-  this->m_BSplineKnotImage = BSplineKnotImageType::New();
-
-  typename TransformType::ParametersType fixedParameters = this->m_Transform->GetFixedParameters();
-
-  typename FixedImageType::SizeType bSplineKnotSize;
-  bSplineKnotSize[ 0 ] = static_cast< unsigned int >( fixedParameters[ 0 ] );
-  bSplineKnotSize[ 1 ] = static_cast< unsigned int >( fixedParameters[ 1 ] );
-  bSplineKnotSize[ 2 ] = static_cast< unsigned int >( fixedParameters[ 2 ] );
-
-  typename FixedImageType::PointType bSplineKnotOrigin;
-  bSplineKnotOrigin[ 0 ] = fixedParameters[ 3 ];
-  bSplineKnotOrigin[ 1 ] = fixedParameters[ 4 ];
-  bSplineKnotOrigin[ 2 ] = fixedParameters[ 5 ];
-
-  typename FixedImageType::SpacingType bSplineKnotSpacing;
-  bSplineKnotSpacing[ 0 ] = fixedParameters[ 6 ];
-  bSplineKnotSpacing[ 1 ] = fixedParameters[ 7 ];
-  bSplineKnotSpacing[ 2 ] = fixedParameters[ 8 ];
-
-  typename FixedImageType::RegionType bSplineKnotRegion;
-  bSplineKnotRegion.SetSize( bSplineKnotSize );
-
-  this->m_BSplineKnotImage->SetRegions( bSplineKnotRegion );
-  this->m_BSplineKnotImage->SetSpacing( bSplineKnotSpacing );
-  this->m_BSplineKnotImage->SetOrigin( bSplineKnotOrigin );
-  this->m_BSplineKnotImage->SetDirection( this->m_FixedImage->GetDirection() );
-  this->m_BSplineKnotImage->Update();
-
   /** Initialize PenaltyGridImage. */
   this->m_PenaltyGridImage = PenaltyGridImageType::New();
 
@@ -120,154 +97,217 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
   this->m_PenaltyGridImage->SetDirection( sampledSegmentedImageDirection );
   this->m_PenaltyGridImage->Update();
 
-  /** compute number of knots in rigid regions */
-  this->m_NumberOfRigidGrids = 0;
-
-  typedef itk::ImageRegionIterator< PenaltyGridImageType > PenaltyGridIteratorType;
-  PenaltyGridIteratorType ki( this->m_PenaltyGridImage, this->m_PenaltyGridImage->GetBufferedRegion() );
-
-  typename PenaltyGridImageType::IndexType penaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint;
-
-  //typedef itk::LinearInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
-  typedef itk::NearestNeighborInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
-  typename SegmentedImageInterpolatorType::Pointer segmentedImageInterpolator = SegmentedImageInterpolatorType::New();
+  /** Find the point pairs, once per resolution. */
+  this->InitializePointPairs();
 
-  segmentedImageInterpolator->SetInputImage( this->m_SampledSegmentedImage );
-
-  unsigned int PixelValue;
-
-  ki.GoToBegin();
-
-  while( !ki.IsAtEnd() )
-  {
-    penaltyGridIndex = ki.GetIndex();
-
-    this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
-
-    PixelValue =  static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
-
-    if( PixelValue > 0 )
-    {
-      this->m_NumberOfRigidGrids++;
-    }
-    ++ki;
-  }
 } // end Initialize()
 
 
 /**
- * *********************** GetValue *****************************
+ * *********************** InitializePointPairs *****************************
  */
 
 template< class TFixedImage, class TScalarType >
-typename DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >::MeasureType
+void
 DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
-::GetValue( const ParametersType & parameters ) const
+::InitializePointPairs( void )
 {
-  /** Set output values to zero. */
-  this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
-
-  //this->SetTransformParameters( parameters );
-  this->m_BSplineTransform->SetParameters( parameters );
-
-  /** distance-preserving penalty computation */
-  MeasureType penaltyTerm       = 0.0;
-  MeasureType penaltyTermBuffer = 0.0;
+  /** The penalty grid has the geometry of the sampled segmented image,
+   * so the rigidity index of a grid point is the pixel value at its index.
+   */
+  const PenaltyGridImageRegionType region         = this->m_PenaltyGridImage->GetBufferedRegion();
+  const SizeValueType              numberOfGrids  = region.GetNumberOfPixels();
+  std::vector< unsigned int >      rigidityIndices( numberOfGrids );
+
+  /** Compute the rigidity index of each grid point, and the number of grid points in rigid regions. */
+  this->m_NumberOfRigidGrids = 0;
+  typedef ImageRegionConstIterator< SegmentedImageType > SegmentedImageIteratorType;
+  SegmentedImageIteratorType si( this->m_SampledSegmentedImage, region );
+  for( SizeValueType g = 0; !si.IsAtEnd(); ++si, ++g )
+  {
+    rigidityIndices[ g ] = static_cast< unsigned int >( si.Get() );
+    if( rigidityIndices[ g ] > 0 )
+    {
+      this->m_NumberOfRigidGrids++;
+    }
+  }
 
-  MeasureType dx = 0.0;
-  MeasureType dX = 0.0;
+  /** The offsets of the 3x3x3 neighbourhood, the center included. */
+  std::vector< typename PenaltyGridImageType::OffsetType > neighborOffsets;
+  unsigned int numberOfNeighborhood = 1;
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+  {
+    numberOfNeighborhood *= 3;
+  }
+  for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
+  {
+    typename PenaltyGridImageType::OffsetType offset;
+    unsigned int                              rest = kk;
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      offset[ d ] = static_cast< OffsetValueType >( rest % 3 ) - 1;
+      rest       /= 3;
+    }
+    neighborOffsets.push_back( offset );
+  }
 
-  typedef itk::ImageRegionConstIteratorWithIndex< PenaltyGridImageType > PenaltyGridIteratorType;
-  PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
+  /** Clear the previous pairs. */
+  this->m_PairPoints.clear();
+  this->m_PairCenters.clear();
+  this->m_PairPointers.assign( 1, 0 );
+  this->m_PairWeights.clear();
+  this->m_PairNeighbors.clear();
+  this->m_PairReferenceDistances.clear();
 
-  PenaltyGridIteratorType pgi( this->m_PenaltyGridImage, penaltyGridImageRegion );
+  /** The index in m_PairPoints of each grid point, or -1. */
+  std::vector< OffsetValueType > pointIndices( numberOfGrids, -1 );
 
   typename PenaltyGridImageType::IndexType penaltyGridIndex, neighborPenaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint, neighborPenaltyGridPoint, xn, xf;
-
-  typedef itk::ConstNeighborhoodIterator< PenaltyGridImageType > NeighborhoodIteratorType;
-  typename NeighborhoodIteratorType::RadiusType radius;
-  radius.Fill( 1 );
-  NeighborhoodIteratorType ni( radius, this->m_PenaltyGridImage, penaltyGridImageRegion );
-  unsigned int             numberOfNeighborhood = ni.Size();
-
-  unsigned int numberOfRigidGridsNeighbor;
-
-  // interpolation of segmented image
-  typedef itk::NearestNeighborInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
-  typename SegmentedImageInterpolatorType::Pointer segmentedImageInterpolator = SegmentedImageInterpolatorType::New();
+  typename PenaltyGridImageType::PointType penaltyGridPoint, neighborPenaltyGridPoint;
+  std::vector< SizeValueType > sameIndexNeighbors;
 
-  segmentedImageInterpolator->SetInputImage( this->m_SampledSegmentedImage );
-
-  unsigned int pixelValue, pixelValueNeighbor;
-
-  /** Penalty term computation */
-  if( MovingImageDimension == 3 )
+  typedef ImageRegionConstIteratorWithIndex< PenaltyGridImageType > PenaltyGridIteratorType;
+  PenaltyGridIteratorType pgi( this->m_PenaltyGridImage, region );
+  for( SizeValueType g = 0; !pgi.IsAtEnd(); ++pgi, ++g )
   {
-    for( pgi.GoToBegin(), ni.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++ni )
+    const unsigned int pixelValue = rigidityIndices[ g ];
+    if( pixelValue == 0 || pixelValue >= 6 )
     {
-      penaltyGridIndex = pgi.GetIndex();
-
-      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
-
-      ni.SetLocation( penaltyGridIndex );
-
-      pixelValue = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
+      continue;
+    }
 
-      if( pixelValue > 0 && pixelValue < 6 )
+    /** Find the neighbours with the same rigidity index. Grid points outside
+     * the grid are background.
+     */
+    penaltyGridIndex = pgi.GetIndex();
+    sameIndexNeighbors.clear();
+    unsigned int numberOfRigidGridsNeighbor = 0;
+    for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
+    {
+      neighborPenaltyGridIndex = penaltyGridIndex + neighborOffsets[ kk ];
+      if( !region.IsInside( neighborPenaltyGridIndex ) )
+      {
+        continue;
+      }
+      const SizeValueType neighborGrid = this->m_PenaltyGridImage->ComputeOffset( neighborPenaltyGridIndex );
+      if( rigidityIndices[ neighborGrid ] == pixelValue )
       {
-        numberOfRigidGridsNeighbor = 0;
+        numberOfRigidGridsNeighbor++;
 
-        for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
+        /** The center itself is counted, but its pair does not contribute. */
+        if( neighborGrid != g )
         {
-          neighborPenaltyGridIndex = ni.GetIndex( kk );
+          sameIndexNeighbors.push_back( neighborGrid );
+        }
+      }
+    }
+    if( numberOfRigidGridsNeighbor <= 1 )
+    {
+      continue;
+    }
 
-          this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
+    /** Store the center and its pairs. */
+    sameIndexNeighbors.insert( sameIndexNeighbors.begin(), g );
+    for( std::size_t i = 0; i < sameIndexNeighbors.size(); ++i )
+    {
+      const SizeValueType grid = sameIndexNeighbors[ i ];
+      if( pointIndices[ grid ] < 0 )
+      {
+        pointIndices[ grid ] = this->m_PairPoints.size();
+        this->m_PenaltyGridImage->TransformIndexToPhysicalPoint(
+          this->m_PenaltyGridImage->ComputeIndex( grid ), penaltyGridPoint );
+        this->m_PairPoints.push_back( penaltyGridPoint );
+      }
+    }
 
-          pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
+    const SizeValueType center = pointIndices[ g ];
+    penaltyGridPoint = this->m_PairPoints[ center ];
+    this->m_PairCenters.push_back( center );
+    this->m_PairWeights.push_back( 1.0 / numberOfRigidGridsNeighbor / this->m_NumberOfRigidGrids );
+    for( std::size_t i = 1; i < sameIndexNeighbors.size(); ++i )
+    {
+      const SizeValueType neighbor = pointIndices[ sameIndexNeighbors[ i ] ];
+      neighborPenaltyGridPoint = this->m_PairPoints[ neighbor ];
+      this->m_PairNeighbors.push_back( neighbor );
+      this->m_PairReferenceDistances.push_back(
+        neighborPenaltyGridPoint.SquaredEuclideanDistanceTo( penaltyGridPoint ) );
+    }
+    this->m_PairPointers.push_back( this->m_PairNeighbors.size() );
+  }
 
-          if( pixelValue == pixelValueNeighbor )
-          {
-            numberOfRigidGridsNeighbor++;
-          }
-        }
+  /** For each point, the pairs in which it is the neighbour, and the center that it is. */
+  const SizeValueType numberOfPoints = this->m_PairPoints.size();
+  this->m_NeighborPairPointers.assign( numberOfPoints + 1, 0 );
+  for( SizeValueType k = 0; k < this->m_PairNeighbors.size(); ++k )
+  {
+    this->m_NeighborPairPointers[ this->m_PairNeighbors[ k ] + 1 ]++;
+  }
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    this->m_NeighborPairPointers[ i + 1 ] += this->m_NeighborPairPointers[ i ];
+  }
+  this->m_NeighborPairs.resize( this->m_PairNeighbors.size() );
+  std::vector< SizeValueType > fill( this->m_NeighborPairPointers.begin(), this->m_NeighborPairPointers.end() - 1 );
+  for( SizeValueType k = 0; k < this->m_PairNeighbors.size(); ++k )
+  {
+    this->m_NeighborPairs[ fill[ this->m_PairNeighbors[ k ] ]++ ] = k;
+  }
 
-        if( numberOfRigidGridsNeighbor > 1 )
-        {
-          for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
-          {
-            neighborPenaltyGridIndex = ni.GetIndex( kk );
+  this->m_PointCenters.assign( numberOfPoints, -1 );
+  for( SizeValueType c = 0; c < this->m_PairCenters.size(); ++c )
+  {
+    this->m_PointCenters[ this->m_PairCenters[ c ] ] = c;
+  }
 
-            this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
+  this->m_TransformedPoints.resize( numberOfPoints );
+  this->m_PairDerivatives.resize( this->m_PairNeighbors.size() * ImageDimension );
 
-            pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
+} // end InitializePointPairs()
 
-            if( pixelValue == pixelValueNeighbor )
-            {
-              xn = this->m_Transform->TransformPoint( neighborPenaltyGridPoint );
-              xf = this->m_Transform->TransformPoint( penaltyGridPoint );
 
-              dX = ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] ) * ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] )
-                + ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] ) * ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] )
-                + ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] ) * ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] );
+/**
+ * *********************** GetValue *****************************
+ */
 
-              dx = ( xn[ 0 ] - xf[ 0 ] ) * ( xn[ 0 ] - xf[ 0 ] )
-                + ( xn[ 1 ] - xf[ 1 ] ) * ( xn[ 1 ] - xf[ 1 ] )
-                + ( xn[ 2 ] - xf[ 2 ] ) * ( xn[ 2 ] - xf[ 2 ] );
+template< class TFixedImage, class TScalarType >
+typename DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >::MeasureType
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::GetValue( const ParametersType & parameters ) const
+{
+  //this->SetTransformParameters( parameters );
+  this->m_BSplineTransform->SetParameters( parameters );
 
-              penaltyTermBuffer = ( dx - dX ) * ( dx - dX );
+  const SizeValueType numberOfPoints  = this->m_PairPoints.size();
+  const SizeValueType numberOfCenters = this->m_PairCenters.size();
 
-              penaltyTerm += penaltyTermBuffer / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-            }
-          } // end for
-        } // end if
-      }     // end if
-    }       // end for
-  }         // end if ( dimension = 3 )
+  /** Option for now to still use the single threaded code. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  if( !this->m_UseMultiThread )
+  {
+    this->TransformPoints( 0, numberOfPoints );
+    value = this->ComputePointPairs( 0, numberOfCenters, false );
+  }
+  else
+  {
+    /** Transform the points, and compute the penalty of the pairs. */
+    this->m_PointPairsThreaderParameters.st_ComputeDerivative = false;
+    this->m_Threader->SetSingleMethod( this->TransformPointsThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_PointPairsThreaderParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+    this->m_Threader->SetSingleMethod( this->ComputePointPairsThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_PointPairsThreaderParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+
+    /** Accumulate the values of the threads. */
+    for( ThreadIdType i = 0; i < this->m_GetValueAndDerivativePerThreadVariablesSize; ++i )
+    {
+      value += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+    }
+  }
 
   /** Return the rigidity penalty term value. */
-  return penaltyTerm;
+  this->m_RigidityPenaltyTermValue = value;
+  return value;
 
 } // end GetValue()
 
@@ -298,197 +338,261 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
   MeasureType & value, DerivativeType & derivative ) const
 {
   /** Set output values to zero. */
-  value                            = NumericTraits< MeasureType >::Zero;
-  this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
-
-  /** Set output values to zero. */
+  value      = NumericTraits< MeasureType >::Zero;
   derivative = DerivativeType( this->GetNumberOfParameters() );
-  derivative.Fill( NumericTraits< MeasureType >::ZeroValue() );
 
   this->m_BSplineTransform->SetParameters( parameters );
 
-  /** Distance-preserving penalty */
-  MeasureType penaltyTermBuffer   = 0.0;
-  MeasureType derivativeTermTemp1 = 0.0, derivativeTermTemp2 = 0.0, derivativeTermTemp3 = 0.0;
+  const SizeValueType numberOfPoints  = this->m_PairPoints.size();
+  const SizeValueType numberOfCenters = this->m_PairCenters.size();
 
-  unsigned int par1, par2;
+  /** Option for now to still use the single threaded code. */
+  if( !this->m_UseMultiThread )
+  {
+    derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    this->TransformPoints( 0, numberOfPoints );
+    value = this->ComputePointPairs( 0, numberOfCenters, true );
+    this->AccumulatePointDerivatives( 0, numberOfPoints, derivative );
+    this->m_RigidityPenaltyTermValue = value;
+    return;
+  }
 
-  MeasureType dX = 0.0;
-  MeasureType dx = 0.0;
+  /** Transform the points, and compute the penalty and derivative of the pairs. */
+  this->m_PointPairsThreaderParameters.st_ComputeDerivative = true;
+  this->m_Threader->SetSingleMethod( this->TransformPointsThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_PointPairsThreaderParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+  this->m_Threader->SetSingleMethod( this->ComputePointPairsThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_PointPairsThreaderParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
 
-  typename PenaltyGridImageType::IndexType penaltyGridIndex, neighborPenaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint, neighborPenaltyGridPoint, xn, xf;
+  /** Sum the derivative contributions of the points, each thread in its own derivative. */
+  this->LaunchGetValueAndDerivativeThreaderCallback();
 
-  typedef itk::BSplineKernelFunction< 3 > BSplineKernelFunctionType;
-  BSplineKernelFunctionType::Pointer bSplineKernel = BSplineKernelFunctionType::New();
+  /** Accumulate the values of the threads. */
+  for( ThreadIdType i = 0; i < this->m_GetValueAndDerivativePerThreadVariablesSize; ++i )
+  {
+    value += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+  }
+  this->m_RigidityPenaltyTermValue = value;
 
-  typedef itk::BSplineInterpolationWeightFunction< double, ImageDimension, 3 > WeightsFunctionType;
-  typedef typename WeightsFunctionType::ContinuousIndexType                    ContinuousIndexType;
-  typedef double                                                               ContinuousIndexValueType;
+  /** Accumulate the derivatives of the threads, multi-threaded. */
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
+  this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
 
-  ContinuousIndexType      tindex;
-  ContinuousIndexValueType tx, ty, tz;
+} // end GetValueAndDerivative()
 
-  ContinuousIndexValueType m, n, p, neighbor_m, neighbor_n, neighbor_p;
 
-  typedef itk::ImageRegionConstIteratorWithIndex< PenaltyGridImageType > PenaltyGridIteratorType;
-  PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
-  PenaltyGridIteratorType    pgi( this->m_PenaltyGridImage, penaltyGridImageRegion );
+/**
+ * *********************** ThreadedGetValueAndDerivative ****************
+ */
 
-  // neighborhood iterator
-  typedef itk::ConstNeighborhoodIterator< PenaltyGridImageType > NeighborhoodIteratorType;
-  typename NeighborhoodIteratorType::RadiusType radius;
-  radius.Fill( 1 );
-  NeighborhoodIteratorType ni( radius, this->m_PenaltyGridImage, penaltyGridImageRegion );
-  unsigned int             numberOfNeighborhood = ni.Size();
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedGetValueAndDerivative( ThreadIdType threadID )
+{
+  SizeValueType pointBegin = 0;
+  SizeValueType pointEnd   = 0;
+  this->GetThreadRange( threadID, this->m_PairPoints.size(), pointBegin, pointEnd );
 
-  ContinuousIndexType      tindex_neighbor, ntindex_start, ntindex_neighbor_start;
-  ContinuousIndexValueType tx_neighbor, ty_neighbor, tz_neighbor;
+  this->AccumulatePointDerivatives( pointBegin, pointEnd,
+    this->m_GetValueAndDerivativePerThreadVariables[ threadID ].st_Derivative );
 
-  typename BSplineKnotImageType::SizeType bSplineKnotImageSize = this->m_BSplineKnotImage->GetBufferedRegion().GetSize();
+} // end ThreadedGetValueAndDerivative()
 
-  MeasureType du_dC, du_dC_neighbor;
 
-  unsigned int numberOfRigidGridsNeighbor;
+/**
+ * *********************** TransformPoints ****************
+ */
 
-  const unsigned int parametersDimension            = this->GetNumberOfParameters();
-  unsigned int       numberOfParametersPerDimension = parametersDimension / ImageDimension;
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::TransformPoints( const SizeValueType pointBegin, const SizeValueType pointEnd ) const
+{
+  for( SizeValueType i = pointBegin; i < pointEnd; ++i )
+  {
+    this->m_TransformedPoints[ i ] = this->m_Transform->TransformPoint( this->m_PairPoints[ i ] );
+  }
 
-  // interpolation of segmented image
-  typedef itk::NearestNeighborInterpolateImageFunction< SegmentedImageType, double > SegmentedImageInterpolatorType;
-  typename SegmentedImageInterpolatorType::Pointer segmentedImageInterpolator = SegmentedImageInterpolatorType::New();
+} // end TransformPoints()
 
-  segmentedImageInterpolator->SetInputImage( this->m_SampledSegmentedImage );
 
-  unsigned int pixelValue, pixelValueNeighbor;
+/**
+ * *********************** ComputePointPairs ****************
+ */
 
-  if( MovingImageDimension == 3 )
+template< class TFixedImage, class TScalarType >
+typename DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >::MeasureType
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputePointPairs( const SizeValueType centerBegin, const SizeValueType centerEnd,
+  const bool computeDerivative ) const
+{
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  for( SizeValueType c = centerBegin; c < centerEnd; ++c )
   {
-    for( pgi.GoToBegin(), ni.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++ni )
+    const OutputPointType & xf     = this->m_TransformedPoints[ this->m_PairCenters[ c ] ];
+    const MeasureType       weight = this->m_PairWeights[ c ];
+
+    for( SizeValueType k = this->m_PairPointers[ c ]; k < this->m_PairPointers[ c + 1 ]; ++k )
     {
-      penaltyGridIndex = pgi.GetIndex();
+      const OutputPointType & xn = this->m_TransformedPoints[ this->m_PairNeighbors[ k ] ];
 
-      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( penaltyGridIndex, penaltyGridPoint );
+      /** The difference of the squared distances after and before the deformation. */
+      const MeasureType dx   = xn.SquaredEuclideanDistanceTo( xf );
+      const MeasureType diff = dx - this->m_PairReferenceDistances[ k ];
+      value += diff * diff * weight;
 
-      pixelValue = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( penaltyGridPoint ) );
+      /** The derivative with respect to xn - xf. */
+      if( computeDerivative )
+      {
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          this->m_PairDerivatives[ k * ImageDimension + d ] = 4.0 * diff * ( xn[ d ] - xf[ d ] ) * weight;
+        }
+      }
+    }
+  }
 
-      ni.SetLocation( penaltyGridIndex );
+  return value;
 
-      /** Penalty term calculation */
-      if( pixelValue > 0 && pixelValue < 6 )
-      {
-        numberOfRigidGridsNeighbor = 0;
+} // end ComputePointPairs()
 
-        for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
-        {
-          neighborPenaltyGridIndex = ni.GetIndex( kk );
 
-          this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
+/**
+ * *********************** AccumulatePointDerivatives ****************
+ */
 
-          pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::AccumulatePointDerivatives( const SizeValueType pointBegin, const SizeValueType pointEnd,
+  DerivativeType & derivative ) const
+{
+  typedef typename BSplineTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  NonZeroJacobianIndicesType nzji( this->m_BSplineTransform->GetNumberOfNonZeroJacobianIndices() );
+  TransformJacobianType      jacobian;
 
-          if( pixelValue == pixelValueNeighbor )
-          {
-            numberOfRigidGridsNeighbor++;
-          }
+  for( SizeValueType i = pointBegin; i < pointEnd; ++i )
+  {
+    /** The derivative with respect to the transformed point: the point is
+     * xn in the pairs of which it is the neighbour, and xf in its own pairs.
+     */
+    MeasureType pointDerivative[ ImageDimension ];
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      pointDerivative[ d ] = NumericTraits< MeasureType >::Zero;
+    }
+    for( SizeValueType j = this->m_NeighborPairPointers[ i ]; j < this->m_NeighborPairPointers[ i + 1 ]; ++j )
+    {
+      const MeasureType * pairDerivative = &this->m_PairDerivatives[ this->m_NeighborPairs[ j ] * ImageDimension ];
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        pointDerivative[ d ] += pairDerivative[ d ];
+      }
+    }
+    const OffsetValueType c = this->m_PointCenters[ i ];
+    if( c >= 0 )
+    {
+      for( SizeValueType k = this->m_PairPointers[ c ]; k < this->m_PairPointers[ c + 1 ]; ++k )
+      {
+        const MeasureType * pairDerivative = &this->m_PairDerivatives[ k * ImageDimension ];
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+          pointDerivative[ d ] -= pairDerivative[ d ];
         }
+      }
+    }
 
-        if( numberOfRigidGridsNeighbor > 1 )
-        {
-          for( unsigned int kk = 0; kk < numberOfNeighborhood; ++kk )
-          {
-            neighborPenaltyGridIndex = ni.GetIndex( kk );
-
-            this->m_PenaltyGridImage->TransformIndexToPhysicalPoint( neighborPenaltyGridIndex, neighborPenaltyGridPoint );
-
-            pixelValueNeighbor = static_cast< unsigned int >( segmentedImageInterpolator->Evaluate( neighborPenaltyGridPoint ) );
-
-            if( pixelValue == pixelValueNeighbor )
-            {
-              xn = this->m_Transform->TransformPoint( neighborPenaltyGridPoint );
-              xf = this->m_Transform->TransformPoint( penaltyGridPoint );
-
-              dX = ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] ) * ( neighborPenaltyGridPoint[ 0 ] - penaltyGridPoint[ 0 ] )
-                + ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] ) * ( neighborPenaltyGridPoint[ 1 ] - penaltyGridPoint[ 1 ] )
-                + ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] ) * ( neighborPenaltyGridPoint[ 2 ] - penaltyGridPoint[ 2 ] );
-
-              dx = ( xn[ 0 ] - xf[ 0 ] ) * ( xn[ 0 ] - xf[ 0 ] )
-                + ( xn[ 1 ] - xf[ 1 ] ) * ( xn[ 1 ] - xf[ 1 ] )
-                + ( xn[ 2 ] - xf[ 2 ] ) * ( xn[ 2 ] - xf[ 2 ] );
-
-              penaltyTermBuffer = ( dx - dX ) * ( dx - dX );
-
-              value += penaltyTermBuffer / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-
-              // find neighboring B-Spline control points
-              this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex( penaltyGridPoint, tindex );
-              this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex( neighborPenaltyGridPoint, tindex_neighbor );
-
-              tx = tindex[ 0 ];
-              ty = tindex[ 1 ];
-              tz = tindex[ 2 ];
-
-              tx_neighbor = tindex_neighbor[ 0 ];
-              ty_neighbor = tindex_neighbor[ 1 ];
-              tz_neighbor = tindex_neighbor[ 2 ];
-
-              for( unsigned dd = 0; dd < ImageDimension; dd++ )
-              {
-                ntindex_start[ dd ]          = static_cast< ContinuousIndexValueType >( floor( tindex[ dd ] ) ) - 1.0;
-                ntindex_neighbor_start[ dd ] = static_cast< ContinuousIndexValueType >( floor( tindex_neighbor[ dd ] ) ) - 1.0;
-              }
-
-              derivativeTermTemp1 = 4 * ( dx - dX ) * ( xn[ 0 ] - xf[ 0 ] ) / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-              derivativeTermTemp2 = 4 * ( dx - dX ) * ( xn[ 1 ] - xf[ 1 ] ) / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-              derivativeTermTemp3 = 4 * ( dx - dX ) * ( xn[ 2 ] - xf[ 2 ] ) / numberOfRigidGridsNeighbor / ( this->m_NumberOfRigidGrids );
-
-              for( unsigned int kk = 0; kk < 4; ++kk )
-              {
-                p          = ntindex_start[ 2 ] + kk;
-                neighbor_p = ntindex_neighbor_start[ 2 ] + kk;
-
-                for( unsigned int jj = 0; jj < 4; ++jj )
-                {
-                  n          = ntindex_start[ 1 ] + jj;
-                  neighbor_n = ntindex_neighbor_start[ 1 ] + jj;
-
-                  for( unsigned int ii = 0; ii < 4; ++ii )
-                  {
-                    m          = ntindex_start[ 0 ] + ii;
-                    neighbor_m = ntindex_neighbor_start[ 0 ] + ii;
-
-                    // neighborhood of (i',j',k')
-                    du_dC_neighbor = ( bSplineKernel->Evaluate( tx_neighbor - neighbor_m ) ) * ( bSplineKernel->Evaluate( ty_neighbor - neighbor_n ) )
-                      * ( bSplineKernel->Evaluate( tz_neighbor - neighbor_p ) );
-
-                    par1 = static_cast< unsigned int >( neighbor_m ) + bSplineKnotImageSize[ 0 ] * static_cast< unsigned int >( neighbor_n )
-                      + bSplineKnotImageSize[ 0 ] * bSplineKnotImageSize[ 1 ] * static_cast< unsigned int >( neighbor_p );
-
-                    derivative[ par1 ]                                      += derivativeTermTemp1 * du_dC_neighbor;
-                    derivative[ par1 + numberOfParametersPerDimension ]     += derivativeTermTemp2 * du_dC_neighbor;
-                    derivative[ par1 + 2 * numberOfParametersPerDimension ] += derivativeTermTemp3 * du_dC_neighbor;
-
-                    // neighborhood of (i,j,k)
-                    du_dC = ( bSplineKernel->Evaluate( tx - m ) ) * ( bSplineKernel->Evaluate( ty - n ) )
-                      * ( bSplineKernel->Evaluate( tz - p ) );
-
-                    par2 = static_cast< unsigned int >( m ) + bSplineKnotImageSize[ 0 ] * static_cast< unsigned int >( n )
-                      + bSplineKnotImageSize[ 0 ] * bSplineKnotImageSize[ 1 ] * static_cast< unsigned int >( p );
-
-                    derivative[ par2 ]                                      -= derivativeTermTemp1 * du_dC;
-                    derivative[ par2 + numberOfParametersPerDimension ]     -= derivativeTermTemp2 * du_dC;
-                    derivative[ par2 + 2 * numberOfParametersPerDimension ] -= derivativeTermTemp3 * du_dC;
-                  }
-                }
-              }
-            }
-          } // end for
-        } // end if
+    /** Multiply with the B-spline weights of the point. */
+    this->m_BSplineTransform->GetJacobian( this->m_PairPoints[ i ], jacobian, nzji );
+    for( unsigned int j = 0; j < nzji.size(); ++j )
+    {
+      DerivativeValueType sum = NumericTraits< DerivativeValueType >::ZeroValue();
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        sum += jacobian( d, j ) * pointDerivative[ d ];
       }
-    } // end for
-  } // end if ( dimension = 3 )
+      derivative[ nzji[ j ] ] += sum;
+    }
+  }
 
-} // end GetValueAndDerivative()
+} // end AccumulatePointDerivatives()
+
+
+/**
+ * *********************** GetThreadRange ****************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::GetThreadRange( const ThreadIdType threadID, const SizeValueType size,
+  SizeValueType & begin, SizeValueType & end ) const
+{
+  const ThreadIdType  numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+  const SizeValueType subSize         = static_cast< SizeValueType >(
+    std::ceil( static_cast< double >( size ) / static_cast< double >( numberOfThreads ) ) );
+
+  begin = std::min( threadID * subSize, size );
+  end   = std::min( ( threadID + 1 ) * subSize, size );
+
+} // end GetThreadRange()
+
+
+/**
+ * *********************** TransformPointsThreaderCallback ****************
+ */
+
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_TYPE
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::TransformPointsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  PointPairsMultiThreaderParameterType * temp
+    = static_cast< PointPairsMultiThreaderParameterType * >( infoStruct->UserData );
+
+  SizeValueType pointBegin = 0;
+  SizeValueType pointEnd   = 0;
+  temp->st_Self->GetThreadRange( threadID, temp->st_Self->m_PairPoints.size(), pointBegin, pointEnd );
+  temp->st_Self->TransformPoints( pointBegin, pointEnd );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end TransformPointsThreaderCallback()
+
+
+/**
+ * *********************** ComputePointPairsThreaderCallback ****************
+ */
+
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_TYPE
+DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputePointPairsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  PointPairsMultiThreaderParameterType * temp
+    = static_cast< PointPairsMultiThreaderParameterType * >( infoStruct->UserData );
+
+  SizeValueType centerBegin = 0;
+  SizeValueType centerEnd   = 0;
+  temp->st_Self->GetThreadRange( threadID, temp->st_Self->m_PairCenters.size(), centerBegin, centerEnd );
+  temp->st_Self->m_GetValueAndDerivativePerThreadVariables[ threadID ].st_Value
+    = temp->st_Self->ComputePointPairs( centerBegin, centerEnd, temp->st_ComputeDerivative );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputePointPairsThreaderCallback()
 
 
 /**
@@ -506,6 +610,8 @@ DistancePreservingRigidityPenaltyTerm< TFixedImage, TScalarType >
   /** Add debugging information. */
   os << indent << "BSplineTransform: " << this->m_BSplineTransform << std::endl;
   os << indent << "RigidityPenaltyTermValue: " << this->m_RigidityPenaltyTermValue << std::endl;
+  os << indent << "NumberOfRigidGrids: " << this->m_NumberOfRigidGrids << std::endl;
+  os << indent << "NumberOfPointPairs: " << this->GetNumberOfPointPairs() << std::endl;
 
 } // end PrintSelf()
 
@@ -34,16 +34,14 @@
 #ifndef __itkGradientDifferenceImageToImageMetric2_h
 #define __itkGradientDifferenceImageToImageMetric2_h
 
-#include "itkAdvancedImageToImageMetric.h"
+#include "itkRayCastFiniteDifferenceImageToImageMetric.h"
 
 #include "itkSobelOperator.h"
 #include "itkNeighborhoodOperatorImageFilter.h"
 #include "itkPoint.h"
 #include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
-#include "itkOptimizer.h"
-#include "itkAdvancedCombinationTransform.h"
-#include "itkAdvancedRayCastInterpolateImageFunction.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -69,17 +67,22 @@ namespace itk
  * Cerebral Angiograms,", IEEE Transactions on Medical Imaging,
  * 22(11):1417-1426.
  *
+ * The derivative is computed by central finite differences, see
+ * RayCastFiniteDifferenceImageToImageMetric. When multi-threading is switched
+ * on, every thread also owns its own Sobel filters.
+ *
  * \ingroup RegistrationMetrics
  */
 template< class TFixedImage, class TMovingImage >
 class GradientDifferenceImageToImageMetric :
-  public AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+  public RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 {
 public:
 
   /** Standard class typedefs. */
-  typedef GradientDifferenceImageToImageMetric                    Self;
-  typedef AdvancedImageToImageMetric< TFixedImage, TMovingImage > Superclass;
+  typedef GradientDifferenceImageToImageMetric Self;
+  typedef RayCastFiniteDifferenceImageToImageMetric<
+    TFixedImage, TMovingImage >                Superclass;
 
   typedef SmartPointer< Self >       Pointer;
   typedef SmartPointer< const Self > ConstPointer;
@@ -111,27 +114,24 @@ public:
   typedef typename Superclass::MovingImageType         MovingImageType;
   typedef typename Superclass::FixedImageConstPointer  FixedImageConstPointer;
   typedef typename Superclass::MovingImageConstPointer MovingImageConstPointer;
+  typedef typename Superclass::MovingImagePointer      MovingImagePointer;
   typedef typename TFixedImage::PixelType              FixedImagePixelType;
   typedef typename TMovingImage::PixelType             MovedImagePixelType;
   typedef typename MovingImageType::RegionType         MovingImageRegionType;
-  typedef typename itk::Optimizer                      OptimizerType;
-  typedef typename OptimizerType::ScalesType           ScalesType;
+  typedef typename Superclass::ScalesType              ScalesType;
 
   itkStaticConstMacro( FixedImageDimension, unsigned int,
     FixedImageType::ImageDimension );
   itkStaticConstMacro( MovedImageDimension, unsigned int,
     MovingImageType::ImageDimension );
 
-  typedef typename itk::AdvancedCombinationTransform< ScalarType, FixedImageDimension >
-    CombinationTransformType;
-  typedef typename CombinationTransformType::Pointer CombinationTransformPointer;
-  typedef itk::Image< FixedImagePixelType, itkGetStaticConstMacro( FixedImageDimension ) >
-    TransformedMovingImageType;
-  typedef itk::ResampleImageFilter< MovingImageType, TransformedMovingImageType >
-    TransformMovingImageFilterType;
-  typedef typename itk::AdvancedRayCastInterpolateImageFunction<
-    MovingImageType, ScalarType >             RayCastInterpolatorType;
-  typedef typename RayCastInterpolatorType::Pointer RayCastInterpolatorPointer;
+  typedef typename Superclass::CombinationTransformType          CombinationTransformType;
+  typedef typename Superclass::CombinationTransformPointer       CombinationTransformPointer;
+  typedef typename Superclass::TransformedMovingImageType        TransformedMovingImageType;
+  typedef typename Superclass::TransformMovingImageFilterType    TransformMovingImageFilterType;
+  typedef typename Superclass::TransformMovingImageFilterPointer TransformMovingImageFilterPointer;
+  typedef typename Superclass::RayCastInterpolatorType           RayCastInterpolatorType;
+  typedef typename Superclass::RayCastInterpolatorPointer        RayCastInterpolatorPointer;
   typedef itk::Image< RealType, itkGetStaticConstMacro( FixedImageDimension ) >
     FixedGradientImageType;
   typedef itk::CastImageFilter< FixedImageType, FixedGradientImageType >
@@ -145,40 +145,43 @@ public:
   typedef typename CastMovedImageFilterType::Pointer CastMovedImageFilterPointer;
   typedef typename MovedGradientImageType::PixelType MovedGradientPixelType;
 
-  /** Get the derivatives of the match measure. */
-  void GetDerivative( const TransformParametersType & parameters,
-    DerivativeType  & derivative ) const override;
-
   /**  Get the value for single valued optimizers. */
   MeasureType GetValue( const TransformParametersType & parameters ) const override;
 
-  /**  Get value and derivatives for multiple valued optimizers. */
-  void GetValueAndDerivative( const TransformParametersType & parameters,
-    MeasureType & Value, DerivativeType & derivative ) const override;
-
   void Initialize( void ) override;
 
   /** Write gradient images to a files for debugging purposes. */
   void WriteGradientImagesToFiles( void ) const;
 
-  /** Set/Get Scales  */
-  itkSetMacro( Scales, ScalesType );
-  itkGetConstReferenceMacro( Scales, ScalesType );
-
-  /** Set/Get the value of Delta used for computing derivatives by finite
-  * differences in the GetDerivative() method */
-  itkSetMacro( DerivativeDelta, double );
-  itkGetConstReferenceMacro( DerivativeDelta, double );
-
 protected:
 
   GradientDifferenceImageToImageMetric();
   ~GradientDifferenceImageToImageMetric() override {}
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  typedef NeighborhoodOperatorImageFilter<
+    FixedGradientImageType, FixedGradientImageType > FixedSobelFilter;
+
+  typedef NeighborhoodOperatorImageFilter<
+    MovedGradientImageType, MovedGradientImageType > MovedSobelFilter;
+  typedef typename MovedSobelFilter::Pointer MovedSobelFilterPointer;
+
+  /** The filters that compute the gradients of the DRR of the perturbation
+   * pipeline of one thread.
+   */
+  struct PerturbationFiltersType
+  {
+    CastMovedImageFilterPointer st_CastMovedImageFilter;
+    MovedSobelFilterPointer     st_MovedSobelFilters[ MovedImageDimension ];
+  };
+
   /** Compute the range of the moved image gradients. */
   void ComputeMovedGradientRange( void ) const;
 
+  void ComputeMovedGradientRange( const MovedSobelFilterPointer * movedSobelFilters,
+    MovedGradientPixelType * minMovedGradient,
+    MovedGradientPixelType * maxMovedGradient ) const;
+
   /** Compute the variance and range of the moving image gradients. */
   void ComputeVariance( void ) const;
 
@@ -186,11 +189,15 @@ protected:
   MeasureType ComputeMeasure( const TransformParametersType & parameters,
     const double * subtractionFactor ) const;
 
-  typedef NeighborhoodOperatorImageFilter<
-    FixedGradientImageType, FixedGradientImageType > FixedSobelFilter;
+  /** Compute the similarity measure from up-to-date moved image gradients. */
+  MeasureType ComputeMeasure( const MovedSobelFilterPointer * movedSobelFilters,
+    const double * subtractionFactor ) const;
 
-  typedef NeighborhoodOperatorImageFilter<
-    MovedGradientImageType, MovedGradientImageType > MovedSobelFilter;
+  /** Connect the Sobel filters to the perturbation pipelines. */
+  void InitializePerturbationPipelines( void ) override;
+
+  /** Compute the metric value from the DRR of the pipeline of a thread. */
+  MeasureType ComputePerturbedValue( const ThreadIdType threadId ) const override;
 
 private:
 
@@ -208,9 +215,6 @@ private:
   mutable FixedGradientPixelType m_MinFixedGradient[ FixedImageDimension ];
   mutable FixedGradientPixelType m_MaxFixedGradient[ FixedImageDimension ];
 
-  /** The filter for transforming the moving image. */
-  typename TransformMovingImageFilterType::Pointer m_TransformMovingImageFilter;
-
   /** The Sobel gradients of the fixed image */
   CastFixedImageFilterPointer m_CastFixedImageFilter;
 
@@ -234,11 +238,12 @@ private:
   typename MovedSobelFilter::Pointer m_MovedSobelFilters[ itkGetStaticConstMacro
     ( MovedImageDimension ) ];
 
-  ScalesType                  m_Scales;
-  double                      m_DerivativeDelta;
   double                      m_Rescalingfactor;
   CombinationTransformPointer m_CombinationTransform;
 
+  /** The Sobel filters of the perturbation pipelines, one per thread. */
+  std::vector< PerturbationFiltersType > m_PerturbationFilters;
+
 };
 
 } // end namespace itk
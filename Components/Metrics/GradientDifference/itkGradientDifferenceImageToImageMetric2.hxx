@@ -40,6 +40,7 @@
 #include "itkRescaleIntensityImageFilter.h"
 #include "itkImageFileWriter.h"
 
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <stdio.h>
@@ -61,7 +62,6 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
   this->m_CastMovedImageFilter       = CastMovedImageFilterType::New();
   this->m_CastFixedImageFilter       = CastFixedImageFilterType::New();
   this->m_CombinationTransform       = CombinationTransformType::New();
-  this->m_TransformMovingImageFilter = TransformMovingImageFilterType::New();
 
   for( iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
   {
@@ -76,7 +76,6 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
     this->m_MaxMovedGradient[ iDimension ] = 0;
   }
 
-  this->m_DerivativeDelta = 0.001;
   this->m_Rescalingfactor = 1.0;
 }
 
@@ -90,7 +89,7 @@ void
 GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 ::Initialize( void )
 {
-  /** Initialise the base class */
+  /** Initialise the base class, which sets up the DRR generation */
   Superclass::Initialize();
 
   unsigned int iFilter;
@@ -110,28 +109,6 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
     this->m_FixedSobelFilters[ iFilter ]->UpdateLargestPossibleRegion();
   }
 
-  /** Resampling for 3D->2D */
-  RayCastInterpolatorType * rayCaster = dynamic_cast< RayCastInterpolatorType * >(
-    const_cast< InterpolatorType * >( this->GetInterpolator() ) );
-  if( rayCaster != 0 )
-  {
-    this->m_TransformMovingImageFilter->SetTransform( rayCaster->GetTransform() );
-  }
-  else
-  {
-    itkExceptionMacro( << "ERROR: the NormalizedGradientCorrelationImageToImageMetric is currently "
-                       << "only suitable for 2D-3D registration.\n"
-                       << "  Therefore it expects an interpolator of type RayCastInterpolator." );
-  }
-  this->m_TransformMovingImageFilter->SetInterpolator( this->m_Interpolator );
-  this->m_TransformMovingImageFilter->SetInput( this->m_MovingImage );
-  this->m_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
-  this->m_TransformMovingImageFilter->SetSize( this->m_FixedImage->GetLargestPossibleRegion().GetSize() );
-  this->m_TransformMovingImageFilter->SetOutputOrigin( this->m_FixedImage->GetOrigin() );
-  this->m_TransformMovingImageFilter->SetOutputSpacing( this->m_FixedImage->GetSpacing() );
-  this->m_TransformMovingImageFilter->SetOutputDirection( this->m_FixedImage->GetDirection() );
-  this->m_TransformMovingImageFilter->Update();
-
   this->m_CastMovedImageFilter->SetInput(
     this->m_TransformMovingImageFilter->GetOutput() );
 
@@ -157,9 +134,46 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
     this->m_Rescalingfactor *= 10;
   }
 
+  /** Prepare the concurrent evaluation of the finite differences. */
+  this->InitializePerturbationPipelines();
+
 } // end Initialize()
 
 
+/**
+ * ********************* InitializePerturbationPipelines ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::InitializePerturbationPipelines( void )
+{
+  Superclass::InitializePerturbationPipelines();
+
+  this->m_PerturbationFilters.resize( this->m_PerturbationPipelines.size() );
+  for( std::size_t i = 0; i < this->m_PerturbationPipelines.size(); ++i )
+  {
+    PerturbationFiltersType & filters = this->m_PerturbationFilters[ i ];
+
+    filters.st_CastMovedImageFilter = CastMovedImageFilterType::New();
+    filters.st_CastMovedImageFilter->SetNumberOfWorkUnits( 1 );
+    filters.st_CastMovedImageFilter->SetInput(
+      this->m_PerturbationPipelines[ i ].st_TransformMovingImageFilter->GetOutput() );
+
+    for( unsigned int iFilter = 0; iFilter < MovedImageDimension; iFilter++ )
+    {
+      filters.st_MovedSobelFilters[ iFilter ] = MovedSobelFilter::New();
+      filters.st_MovedSobelFilters[ iFilter ]->SetNumberOfWorkUnits( 1 );
+      filters.st_MovedSobelFilters[ iFilter ]->OverrideBoundaryCondition( &this->m_MovedBoundCond );
+      filters.st_MovedSobelFilters[ iFilter ]->SetOperator( this->m_MovedSobelOperators[ iFilter ] );
+      filters.st_MovedSobelFilters[ iFilter ]->SetInput( filters.st_CastMovedImageFilter->GetOutput() );
+    }
+  }
+
+} // end InitializePerturbationPipelines()
+
+
 /**
  * ********************* PrintSelf ******************************
  */
@@ -170,7 +184,6 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 ::PrintSelf( std::ostream & os, Indent indent ) const
 {
   Superclass::PrintSelf( os, indent );
-  os << indent << "DerivativeDelta: " << this->m_DerivativeDelta << std::endl;
 
 }
 
@@ -183,6 +196,22 @@ template< class TFixedImage, class TMovingImage >
 void
 GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputeMovedGradientRange( void ) const
+{
+  this->ComputeMovedGradientRange( this->m_MovedSobelFilters,
+    this->m_MinMovedGradient, this->m_MaxMovedGradient );
+}
+
+
+/**
+ * ******************** ComputeMovedGradientRange ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMovedGradientRange( const MovedSobelFilterPointer * movedSobelFilters,
+  MovedGradientPixelType * minMovedGradient,
+  MovedGradientPixelType * maxMovedGradient ) const
 {
   unsigned int           iDimension;
   MovedGradientPixelType gradient;
@@ -192,26 +221,26 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
     typedef itk::ImageRegionConstIteratorWithIndex<
       MovedGradientImageType > IteratorType;
 
-    IteratorType iterate( m_MovedSobelFilters[ iDimension ]->GetOutput(),
+    IteratorType iterate( movedSobelFilters[ iDimension ]->GetOutput(),
     this->GetFixedImageRegion() );
 
     gradient = iterate.Get();
 
-    m_MinMovedGradient[ iDimension ] = gradient;
-    m_MaxMovedGradient[ iDimension ] = gradient;
+    minMovedGradient[ iDimension ] = gradient;
+    maxMovedGradient[ iDimension ] = gradient;
 
     while( !iterate.IsAtEnd() )
     {
       gradient = iterate.Get();
 
-      if( gradient > m_MaxMovedGradient[ iDimension ] )
+      if( gradient > maxMovedGradient[ iDimension ] )
       {
-        m_MaxMovedGradient[ iDimension ] = gradient;
+        maxMovedGradient[ iDimension ] = gradient;
       }
 
-      if( gradient < m_MinMovedGradient[ iDimension ] )
+      if( gradient < minMovedGradient[ iDimension ] )
       {
-        m_MinMovedGradient[ iDimension ] = gradient;
+        minMovedGradient[ iDimension ] = gradient;
       }
 
       ++iterate;
@@ -369,10 +398,34 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
   this->BeforeThreadedGetValueAndDerivative( parameters );
   //this->SetTransformParameters( parameters );
 
+  this->UpdateMovedImage( parameters );
+
+  for( unsigned int iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
+  {
+    this->m_FixedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+    this->m_MovedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+  }
+
+  return this->ComputeMeasure( this->m_MovedSobelFilters, subtractionFactor );
+
+} // end ComputeMeasure()
+
+
+/**
+ * ******************** ComputeMeasure ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMeasure( const MovedSobelFilterPointer * movedSobelFilters,
+  const double * subtractionFactor ) const
+{
+  /** This function only reads the (fixed) gradient images, so that it
+   * can be called concurrently for different perturbation pipelines.
+   */
   unsigned int iDimension;
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  MeasureType  measure = NumericTraits< MeasureType >::Zero;
 
   typename FixedImageType::IndexType currentIndex;
   typename FixedImageType::PointType point;
@@ -402,12 +455,9 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
     typedef  itk::ImageRegionConstIteratorWithIndex< MovedGradientImageType >
       MovedIteratorType;
 
-    MovedIteratorType movedIterator( this->m_MovedSobelFilters[ iDimension ]->GetOutput(),
+    MovedIteratorType movedIterator( movedSobelFilters[ iDimension ]->GetOutput(),
     this->GetFixedImageRegion() );
 
-    this->m_FixedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
-    this->m_MovedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
-
     bool sampleOK = false;
 
     if( this->m_FixedImageMask.IsNull() )
@@ -466,9 +516,7 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 {
   unsigned int iFilter;
   unsigned int iDimension;
-  this->SetTransformParameters( parameters );
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+  this->UpdateMovedImage( parameters );
 
   /** Update the gradient images */
   for( iFilter = 0; iFilter < MovedImageDimension; iFilter++ )
@@ -496,47 +544,37 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 
 
 /**
- * ******************** GetDerivative ******************************
+ * ******************** ComputePerturbedValue ******************************
  */
 
 template< class TFixedImage, class TMovingImage >
-void
+typename GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
 GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
-::GetDerivative( const TransformParametersType & parameters,
-  DerivativeType & derivative ) const
+::ComputePerturbedValue( const ThreadIdType threadId ) const
 {
-  TransformParametersType testPoint;
-  testPoint = parameters;
-  const unsigned int numberOfParameters = this->GetNumberOfParameters();
-  derivative = DerivativeType( numberOfParameters );
+  const PerturbationFiltersType & filters = this->m_PerturbationFilters[ threadId ];
 
-  for( unsigned int i = 0; i < numberOfParameters; i++ )
+  /** Compute the gradients of the DRR. */
+  for( unsigned int iFilter = 0; iFilter < MovedImageDimension; iFilter++ )
   {
-    testPoint[ i ] -= this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
-    const MeasureType valuep0 = this->GetValue( testPoint );
-    testPoint[ i ] += 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
-    const MeasureType valuep1 = this->GetValue( testPoint );
-    derivative[ i ] = ( valuep1 - valuep0 ) / ( 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] ) );
-    testPoint[ i ]  = parameters[ i ];
+    filters.st_MovedSobelFilters[ iFilter ]->UpdateLargestPossibleRegion();
   }
 
-} // end GetDerivative()
-
+  /** Compute the subtraction factor as in GetValue(). */
+  MovedGradientPixelType minMovedGradient[ MovedImageDimension ];
+  MovedGradientPixelType maxMovedGradient[ MovedImageDimension ];
+  this->ComputeMovedGradientRange( filters.st_MovedSobelFilters, minMovedGradient, maxMovedGradient );
 
-/**
- * ******************** GetValueAndDerivative ******************************
- */
+  MovedGradientPixelType subtractionFactor[ FixedImageDimension ];
+  for( unsigned int iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
+  {
+    subtractionFactor[ iDimension ] = this->m_MaxFixedGradient[ iDimension ]
+      / maxMovedGradient[ iDimension ];
+  }
 
-template< class TFixedImage, class TMovingImage >
-void
-GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
-::GetValueAndDerivative( const TransformParametersType & parameters,
-  MeasureType & Value, DerivativeType & derivative ) const
-{
-  Value = this->GetValue( parameters );
-  this->GetDerivative( parameters, derivative );
+  return this->ComputeMeasure( filters.st_MovedSobelFilters, subtractionFactor );
 
-} // end GetValueAndDerivative()
+} // end ComputePerturbedValue()
 
 
 } // end namespace itk
@@ -32,6 +32,7 @@
 #include "kd_split.h"					// kd-tree splitting rules
 #include "kd_util.h"					// kd-tree utilities
 #include <ANN/ANNperf.h>				// performance evaluation
+#include <mutex>						// guards KD_TRIVIAL
 
 //----------------------------------------------------------------------
 //	Global data
@@ -45,10 +46,20 @@
 //	KD_TRIVIAL is allocated when the first kd-tree is created.  It
 //	must *never* deallocated (since it may be shared by more than
 //	one tree).
+//
+//	Trees may be built concurrently (and in parallel with searches in
+//	other trees), so the allocation of KD_TRIVIAL, and its deletion by
+//	annClose(), are guarded by annMutex().
 //----------------------------------------------------------------------
 static int				IDX_TRIVIAL[] = {0};	// trivial point index
 ANNkd_leaf				*KD_TRIVIAL = NULL;		// trivial leaf node
 
+std::recursive_mutex& annMutex()		// guards KD_TRIVIAL
+{
+	static std::recursive_mutex mutex;
+	return mutex;
+}
+
 //----------------------------------------------------------------------
 //	Printing the kd-tree 
 //		These routines print a kd-tree in reverse inorder (high then
@@ -220,6 +231,7 @@ ANNkd_tree::~ANNkd_tree()				// tree destructor
 //----------------------------------------------------------------------
 void annClose()				// close use of ANN
 {
+	std::lock_guard<std::recursive_mutex> lock(annMutex());
 	if (KD_TRIVIAL != NULL) {
 		delete KD_TRIVIAL;
 		KD_TRIVIAL = NULL;
@@ -266,6 +278,7 @@ void ANNkd_tree::SkeletonTree(			// construct skeleton tree
 	}
 
 	bnd_box_lo = bnd_box_hi = NULL;		// bounding box is nonexistent
+	std::lock_guard<std::recursive_mutex> lock(annMutex());
 	if (KD_TRIVIAL == NULL)				// no trivial leaf node yet?
 		KD_TRIVIAL = new ANNkd_leaf(0, IDX_TRIVIAL);	// allocate it
 }
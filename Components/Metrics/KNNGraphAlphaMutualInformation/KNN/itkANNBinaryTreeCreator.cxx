@@ -106,6 +106,7 @@ ANNBinaryTreeCreator::DeleteANNBruteForceTree( ANNBruteForceTreeType * & tree )
 void
 ANNBinaryTreeCreator::IncreaseReferenceCount( void )
 {
+  std::lock_guard< std::recursive_mutex > lock( annMutex() );
   m_NumberOfANNBinaryTrees++;
 } // end IncreaseReferenceCount
 
@@ -117,6 +118,12 @@ ANNBinaryTreeCreator::IncreaseReferenceCount( void )
 void
 ANNBinaryTreeCreator::DecreaseReferenceCount( void )
 {
+  /** Trees may be created and deleted from several threads simultaneously.
+   * Guard the reference count with the mutex that ANN uses for the trivial
+   * leaf node, so that no tree can allocate or use that node while annClose()
+   * deletes it.
+   */
+  std::lock_guard< std::recursive_mutex > lock( annMutex() );
   m_NumberOfANNBinaryTrees--;
   if( m_NumberOfANNBinaryTrees == 0 )
   {
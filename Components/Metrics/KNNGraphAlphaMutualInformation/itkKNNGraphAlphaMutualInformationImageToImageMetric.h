@@ -40,6 +40,9 @@
 /** Include for the spatial derivatives. */
 #include "itkArray2D.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace itk
 {
 /**
@@ -67,6 +70,12 @@ namespace itk
  * IEEE Transactions on Medical Imaging, vol. 28, no. 9, pp. 1412 - 1421,
  * September 2009.
  *
+ * When multi-threading is switched on, the moving and joint trees (and the
+ * fixed tree, if needed) are generated concurrently, and the k-NN queries are
+ * distributed over the threads. The fixed tree and the fixed graph lengths are
+ * reused as long as the fixed samples do not change, for example when a
+ * full or grid sampler is used.
+ *
  * \ingroup RegistrationMetrics
  */
 
@@ -258,6 +267,55 @@ protected:
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Typedef's for multi-threading. */
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+
+  /** Generate the kNN trees from the list samples, and connect them to the
+   * searchers. The fixed tree is only regenerated when the fixed samples changed.
+   */
+  void GenerateTrees( const ListSamplePointer & listSampleFixed,
+    const ListSamplePointer & listSampleMoving,
+    const ListSamplePointer & listSampleJoint ) const;
+
+  /** Check if the fixed list sample equals the one of the fixed tree. */
+  bool IsFixedListSampleUnchanged( const ListSamplePointer & listSampleFixed ) const;
+
+  /** Compute the sum of the G's for the query points [begin, end). */
+  MeasureType ComputeSumOfG( unsigned long begin, unsigned long end ) const;
+
+  /** Compute the sum of the G's and the contribution to the derivative
+   * for the query points [begin, end).
+   */
+  MeasureType ComputeSumOfGAndContribution( unsigned long begin, unsigned long end,
+    DerivativeType & contribution ) const;
+
+  /** Get the range of query points of a thread. */
+  void GetQueryRange( ThreadIdType threadId,
+    unsigned long & pos_begin, unsigned long & pos_end ) const;
+
+  /** Multi-threaded versions of GetValue() and GetValueAndDerivative(). */
+  inline void ThreadedGetValue( ThreadIdType threadId ) override;
+
+  inline void AfterThreadedGetValue( MeasureType & value ) const override;
+
+  inline void ThreadedGetValueAndDerivative( ThreadIdType threadId ) override;
+
+  inline void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const override;
+
+  /** Threading related parameters. */
+  struct KNNGraphAlphaMutualInformationMultiThreaderParameterType
+  {
+    Self * m_Metric;
+  };
+  KNNGraphAlphaMutualInformationMultiThreaderParameterType m_KNNGraphAlphaMutualInformationThreaderParameters;
+
+  /** Multi-threaded generation of the trees. */
+  inline void ThreadedGenerateTrees( ThreadIdType threadId );
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_TYPE GenerateTreesThreaderCallback( void * arg );
+
   /** Member variables. */
   BinaryKNNTreePointer m_BinaryKNNTreeFixed;
   BinaryKNNTreePointer m_BinaryKNNTreeMoving;
@@ -286,6 +344,26 @@ private:
   typedef Array2D< double >                         SpatialDerivativeType;
   typedef std::vector< SpatialDerivativeType >      SpatialDerivativeContainerType;
 
+  /** The list samples, Jacobians and spatial derivatives of the current
+   * iteration, shared with the threads that do the k-NN queries.
+   */
+  mutable ListSamplePointer                     m_ListSampleFixed;
+  mutable ListSamplePointer                     m_ListSampleMoving;
+  mutable ListSamplePointer                     m_ListSampleJoint;
+  mutable TransformJacobianContainerType        m_JacobianContainer;
+  mutable TransformJacobianIndicesContainerType m_JacobianIndicesContainer;
+  mutable SpatialDerivativeContainerType        m_SpatialDerivativesContainer;
+
+  /** The trees that are (re)generated in this iteration. */
+  mutable std::vector< BinaryKNNTreeType * > m_TreesToGenerate;
+
+  /** The fixed tree and the fixed graph lengths only depend on the fixed
+   * samples, so they are reused as long as these do not change.
+   */
+  mutable bool                  m_FixedTreeIsValid;
+  mutable bool                  m_FixedGammasAreValid;
+  mutable std::vector< double > m_FixedGammas;
+
   /** This function takes the fixed image samples from the ImageSampler
    * and puts them in the listSampleFixed, together with the fixed feature
    * image samples. Also the corresponding moving image values and moving
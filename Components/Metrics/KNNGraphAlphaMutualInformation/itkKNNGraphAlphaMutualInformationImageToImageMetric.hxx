@@ -44,6 +44,12 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_BinaryKNNTreeSearcherMoving = 0;
   this->m_BinaryKNNTreeSearcherJoint  = 0;
 
+  this->m_FixedTreeIsValid    = false;
+  this->m_FixedGammasAreValid = false;
+
+  /** Initialize the m_KNNGraphAlphaMutualInformationThreaderParameters. */
+  this->m_KNNGraphAlphaMutualInformationThreaderParameters.m_Metric = this;
+
 } // end Constructor()
 
 
@@ -289,6 +295,10 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     itkExceptionMacro( << "ERROR: The kNN tree searcher is not set. " );
   }
 
+  /** The trees or searchers may have been replaced, so regenerate the fixed tree. */
+  this->m_FixedTreeIsValid    = false;
+  this->m_FixedGammasAreValid = false;
+
 } // end Initialize()
 
 
@@ -317,13 +327,10 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   ListSamplePointer listSampleJoint  = ListSampleType::New();
 
   /** Compute the three list samples. */
-  TransformJacobianContainerType        dummyJacobianContainer;
-  TransformJacobianIndicesContainerType dummyJacobianIndicesContainer;
-  SpatialDerivativeContainerType        dummySpatialDerivativesContainer;
   this->ComputeListSampleValuesAndDerivativePlusJacobian(
     listSampleFixed, listSampleMoving, listSampleJoint,
-    false, dummyJacobianContainer, dummyJacobianIndicesContainer,
-    dummySpatialDerivativesContainer );
+    false, this->m_JacobianContainer, this->m_JacobianIndicesContainer,
+    this->m_SpatialDerivativesContainer );
 
   /** Check if enough samples were valid. */
   unsigned long size = this->GetImageSampler()->GetOutput()->Size();
@@ -336,25 +343,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
-  this->m_BinaryKNNTreeSearcherMoving
-  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
-  this->m_BinaryKNNTreeSearcherJoint
-  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+  this->GenerateTrees( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /**
    * *************** Estimate the \alpha MI ******************
@@ -389,6 +378,91 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
+  /** Loop over all query points, i.e. all samples. */
+  MeasureType sumG = NumericTraits< MeasureType >::Zero;
+  if( !this->m_UseMultiThread )
+  {
+    sumG = this->ComputeSumOfG( 0, this->m_NumberOfPixelsCounted );
+  }
+  else
+  {
+    this->LaunchGetValueThreaderCallback();
+    this->AfterThreadedGetValue( sumG );
+  }
+
+  /** The fixed graph lengths are now known for all samples. */
+  this->m_FixedGammasAreValid = true;
+
+  /**
+   * *************** Finally, calculate the metric value \alpha MI ******************
+   */
+
+  double n, number;
+  if( sumG > this->m_AvoidDivisionBy )
+  {
+    /** Compute the measure. */
+    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
+    number  = std::pow( n, this->m_Alpha );
+    measure = std::log( sumG / number ) / ( this->m_Alpha - 1.0 );
+  }
+
+  /** Return the negative alpha - mutual information. */
+  return -measure;
+
+} // end GetValue()
+
+
+/**
+ * ******************* ThreadedGetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValue( ThreadIdType threadId )
+{
+  /** Get the query points for this thread. */
+  unsigned long pos_begin, pos_end;
+  this->GetQueryRange( threadId, pos_begin, pos_end );
+
+  /** Store the partial sum of G. */
+  this->m_GetValuePerThreadVariables[ threadId ].st_Value
+    = this->ComputeSumOfG( pos_begin, pos_end );
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValue( MeasureType & value ) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Accumulate the partial sums of G, and reset. */
+  value = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    value += this->m_GetValuePerThreadVariables[ i ].st_Value;
+    this->m_GetValuePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
+  }
+
+} // end AfterThreadedGetValue()
+
+
+/**
+ * ************************ ComputeSumOfG *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeSumOfG( unsigned long begin, unsigned long end ) const
+{
   /** Temporary variables. */
   typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
   MeasurementVectorType z_F, z_M, z_J;
@@ -407,16 +481,17 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   unsigned int k        = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
   double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
 
-  /** Loop over all query points, i.e. all samples. */
-  for( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
+  /** The fixed graph lengths may be known from a previous iteration. */
+  const bool useFixedGammas = this->m_FixedGammasAreValid;
+
+  /** Loop over the query points. */
+  for( unsigned long i = begin; i < end; i++ )
   {
     /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(  i, z_F );
-    listSampleMoving->GetMeasurementVector( i, z_M );
-    listSampleJoint->GetMeasurementVector(  i, z_J );
+    this->m_ListSampleMoving->GetMeasurementVector( i, z_M );
+    this->m_ListSampleJoint->GetMeasurementVector(  i, z_J );
 
     /** Search for the K nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
     this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
     this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
 
@@ -443,10 +518,25 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
     AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
 
+    /** The fixed graph length only depends on the fixed samples. */
+    if( useFixedGammas )
+    {
+      Gamma_F = this->m_FixedGammas[ i ];
+    }
+    else
+    {
+      this->m_ListSampleFixed->GetMeasurementVector( i, z_F );
+      this->m_BinaryKNNTreeSearcherFixed->Search( z_F, indices_F, distances_F );
+      for( unsigned int p = 0; p < k; p++ )
+      {
+        Gamma_F += std::sqrt( distances_F[ p ] );
+      }
+      this->m_FixedGammas[ i ] = Gamma_F;
+    }
+
     /** Loop over the neighbours. */
     for( unsigned int p = 0; p < k; p++ )
     {
-      Gamma_F += std::sqrt( distances_F[ p ] );
       Gamma_M += std::sqrt( distances_M[ p ] );
       Gamma_J += std::sqrt( distances_J[ p ] );
     } // end loop over the k neighbours
@@ -459,25 +549,11 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       G     = Gamma_J / H;
       sumG += std::pow( G, twoGamma );
     }
-  } // end looping over all query points
-
-  /**
-   * *************** Finally, calculate the metric value \alpha MI ******************
-   */
-
-  double n, number;
-  if( sumG > this->m_AvoidDivisionBy )
-  {
-    /** Compute the measure. */
-    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
-    number  = std::pow( n, this->m_Alpha );
-    measure = std::log( sumG / number ) / ( this->m_Alpha - 1.0 );
-  }
+  } // end looping over the query points
 
-  /** Return the negative alpha - mutual information. */
-  return -measure;
+  return sumG;
 
-} // end GetValue()
+} // end ComputeSumOfG()
 
 
 /**
@@ -544,12 +620,10 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   ListSamplePointer listSampleJoint  = ListSampleType::New();
 
   /** Compute the three list samples and the derivatives. */
-  TransformJacobianContainerType        jacobianContainer;
-  TransformJacobianIndicesContainerType jacobianIndicesContainer;
-  SpatialDerivativeContainerType        spatialDerivativesContainer;
   this->ComputeListSampleValuesAndDerivativePlusJacobian(
     listSampleFixed, listSampleMoving, listSampleJoint,
-    true, jacobianContainer, jacobianIndicesContainer, spatialDerivativesContainer );
+    true, this->m_JacobianContainer, this->m_JacobianIndicesContainer,
+    this->m_SpatialDerivativesContainer );
 
   /** Check if enough samples were valid. */
   unsigned long size = this->GetImageSampler()->GetOutput()->Size();
@@ -561,25 +635,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
-  this->m_BinaryKNNTreeSearcherMoving
-  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
-  this->m_BinaryKNNTreeSearcherJoint
-  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+  this->GenerateTrees( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /**
    * *************** Estimate the \alpha MI and its derivatives ******************
@@ -614,18 +670,119 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
+  /** Loop over all query points, i.e. all samples. */
+  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
+  MeasureType    sumG = NumericTraits< MeasureType >::Zero;
+  DerivativeType contribution( this->GetNumberOfParameters() );
+  contribution.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  if( !this->m_UseMultiThread )
+  {
+    sumG = this->ComputeSumOfGAndContribution(
+      0, this->m_NumberOfPixelsCounted, contribution );
+  }
+  else
+  {
+    this->LaunchGetValueAndDerivativeThreaderCallback();
+    this->AfterThreadedGetValueAndDerivative( sumG, contribution );
+  }
+
+  /** The fixed graph lengths are now known for all samples. */
+  this->m_FixedGammasAreValid = true;
+
+  /**
+   * *************** Finally, calculate the metric value and derivative ******************
+   */
+
+  /** Get the size of the feature vectors. */
+  unsigned int fixedSize  = this->GetNumberOfFixedImages();
+  unsigned int movingSize = this->GetNumberOfMovingImages();
+  unsigned int jointSize  = fixedSize + movingSize;
+
+  /** Compute the value. */
+  double n, number;
+  if( sumG > this->m_AvoidDivisionBy )
+  {
+    /** Compute the measure. */
+    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
+    number  = std::pow( n, this->m_Alpha );
+    measure = std::log( sumG / number ) / ( this->m_Alpha - 1.0 );
+
+    /** Compute the derivative (-2.0 * d = -jointSize). */
+    derivative = ( static_cast< AccumulateType >( jointSize ) / sumG ) * contribution;
+  }
+  value = -measure;
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivative( ThreadIdType threadId )
+{
+  /** Get the query points for this thread. */
+  unsigned long pos_begin, pos_end;
+  this->GetQueryRange( threadId, pos_begin, pos_end );
+
+  /** Store the partial sum of G and the partial contribution to the derivative. */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value
+    = this->ComputeSumOfGAndContribution( pos_begin, pos_end,
+    this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative );
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Accumulate the partial sums of G and the contributions, and reset. */
+  value = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    value      += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+    derivative += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative;
+
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Fill(
+      NumericTraits< DerivativeValueType >::ZeroValue() );
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
+/**
+ * ************************ ComputeSumOfGAndContribution *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeSumOfGAndContribution( unsigned long begin, unsigned long end,
+  DerivativeType & contribution ) const
+{
   /** Temporary variables. */
   typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
   MeasurementVectorType z_F, z_M, z_J, z_M_ip, z_J_ip, diff_M, diff_J;
   IndexArrayType        indices_F,   indices_M,   indices_J;
   DistanceArrayType     distances_F, distances_M, distances_J;
-  MeasureType           distance_F,  distance_M,  distance_J;
+  MeasureType           distance_M,  distance_J;
 
   MeasureType    H, G, Gpow;
   AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
 
-  DerivativeType contribution( this->GetNumberOfParameters() );
-  contribution.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
   DerivativeType dGamma_M( this->GetNumberOfParameters() );
   DerivativeType dGamma_J( this->GetNumberOfParameters() );
 
@@ -638,16 +795,17 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   unsigned int k        = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
   double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
 
-  /** Loop over all query points, i.e. all samples. */
-  for( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
+  /** The fixed graph lengths may be known from a previous iteration. */
+  const bool useFixedGammas = this->m_FixedGammasAreValid;
+
+  /** Loop over the query points. */
+  for( unsigned long i = begin; i < end; i++ )
   {
     /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(  i, z_F );
-    listSampleMoving->GetMeasurementVector( i, z_M );
-    listSampleJoint->GetMeasurementVector(  i, z_J );
+    this->m_ListSampleMoving->GetMeasurementVector( i, z_M );
+    this->m_ListSampleJoint->GetMeasurementVector(  i, z_J );
 
     /** Search for the k nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
     this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
     this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
 
@@ -656,8 +814,24 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
     AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
 
+    /** The fixed graph length only depends on the fixed samples. */
+    if( useFixedGammas )
+    {
+      Gamma_F = this->m_FixedGammas[ i ];
+    }
+    else
+    {
+      this->m_ListSampleFixed->GetMeasurementVector( i, z_F );
+      this->m_BinaryKNNTreeSearcherFixed->Search( z_F, indices_F, distances_F );
+      for( unsigned int p = 0; p < k; p++ )
+      {
+        Gamma_F += std::sqrt( distances_F[ p ] );
+      }
+      this->m_FixedGammas[ i ] = Gamma_F;
+    }
+
     SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
-    D1sparse = spatialDerivativesContainer[ i ] * jacobianContainer[ i ];
+    D1sparse = this->m_SpatialDerivativesContainer[ i ] * this->m_JacobianContainer[ i ];
 
     dGamma_M.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
     dGamma_J.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
@@ -666,16 +840,14 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     for( unsigned int p = 0; p < k; p++ )
     {
       /** Get the neighbour point z_ip^M. */
-      listSampleMoving->GetMeasurementVector( indices_M[ p ], z_M_ip );
-      listSampleMoving->GetMeasurementVector( indices_J[ p ], z_J_ip );
+      this->m_ListSampleMoving->GetMeasurementVector( indices_M[ p ], z_M_ip );
+      this->m_ListSampleMoving->GetMeasurementVector( indices_J[ p ], z_J_ip );
 
       /** Get the distances. */
-      distance_F = std::sqrt( distances_F[ p ] );
       distance_M = std::sqrt( distances_M[ p ] );
       distance_J = std::sqrt( distances_J[ p ] );
 
       /** Compute Gamma's. */
-      Gamma_F += distance_F;
       Gamma_M += distance_M;
       Gamma_J += distance_J;
 
@@ -684,17 +856,17 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       diff_J = z_M - z_J_ip;
 
       /** Compute derivatives. */
-      D2sparse_M = spatialDerivativesContainer[ indices_M[ p ] ]
-        * jacobianContainer[ indices_M[ p ] ];
-      D2sparse_J = spatialDerivativesContainer[ indices_J[ p ] ]
-        * jacobianContainer[ indices_J[ p ] ];
+      D2sparse_M = this->m_SpatialDerivativesContainer[ indices_M[ p ] ]
+        * this->m_JacobianContainer[ indices_M[ p ] ];
+      D2sparse_J = this->m_SpatialDerivativesContainer[ indices_J[ p ] ]
+        * this->m_JacobianContainer[ indices_J[ p ] ];
 
       /** Update the dGamma's. */
       this->UpdateDerivativeOfGammas(
         D1sparse, D2sparse_M, D2sparse_J,
-        jacobianIndicesContainer[ i ],
-        jacobianIndicesContainer[ indices_M[ p ] ],
-        jacobianIndicesContainer[ indices_J[ p ] ],
+        this->m_JacobianIndicesContainer[ i ],
+        this->m_JacobianIndicesContainer[ indices_M[ p ] ],
+        this->m_JacobianIndicesContainer[ indices_J[ p ] ],
         diff_M, diff_J,
         distance_M, distance_J,
         dGamma_M, dGamma_J );
@@ -714,27 +886,185 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       contribution += ( Gpow / H ) * ( dGamma_J - ( 0.5 * Gamma_J / Gamma_M ) * dGamma_M );
     }
 
-  } // end looping over all query points
+  } // end looping over the query points
 
-  /**
-   * *************** Finally, calculate the metric value and derivative ******************
+  return sumG;
+
+} // end ComputeSumOfGAndContribution()
+
+
+/**
+ * ************************ GetQueryRange *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GetQueryRange( ThreadIdType threadId,
+  unsigned long & pos_begin, unsigned long & pos_end ) const
+{
+  const unsigned long numberOfQueryPoints = this->m_NumberOfPixelsCounted;
+
+  /** Get the query points for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( numberOfQueryPoints )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  pos_begin = nrOfSamplesPerThreads * threadId;
+  pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > numberOfQueryPoints ) ? numberOfQueryPoints : pos_begin;
+  pos_end   = ( pos_end > numberOfQueryPoints ) ? numberOfQueryPoints : pos_end;
+
+} // end GetQueryRange()
+
+
+/**
+ * ************************ GenerateTrees *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GenerateTrees(
+  const ListSamplePointer & listSampleFixed,
+  const ListSamplePointer & listSampleMoving,
+  const ListSamplePointer & listSampleJoint ) const
+{
+  /** Store the list samples, for the query threads. */
+  this->m_ListSampleFixed  = listSampleFixed;
+  this->m_ListSampleMoving = listSampleMoving;
+  this->m_ListSampleJoint  = listSampleJoint;
+
+  /** Collect the trees that need to be (re)generated. The fixed tree is
+   * kept when the fixed samples did not change, which saves a tree
+   * construction and all fixed searches.
    */
+  this->m_TreesToGenerate.clear();
+  if( !this->m_FixedTreeIsValid || !this->IsFixedListSampleUnchanged( listSampleFixed ) )
+  {
+    this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
+    this->m_TreesToGenerate.push_back( this->m_BinaryKNNTreeFixed.GetPointer() );
 
-  /** Compute the value. */
-  double n, number;
-  if( sumG > this->m_AvoidDivisionBy )
+    this->m_FixedGammas.resize( this->m_NumberOfPixelsCounted );
+    this->m_FixedGammasAreValid = false;
+  }
+
+  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
+  this->m_TreesToGenerate.push_back( this->m_BinaryKNNTreeMoving.GetPointer() );
+  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
+  this->m_TreesToGenerate.push_back( this->m_BinaryKNNTreeJoint.GetPointer() );
+
+  /** Generate the trees. The construction of a single tree is recursive
+   * and serial, but the trees are independent and can be built concurrently.
+   */
+  if( !this->m_UseMultiThread )
   {
-    /** Compute the measure. */
-    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
-    number  = std::pow( n, this->m_Alpha );
-    measure = std::log( sumG / number ) / ( this->m_Alpha - 1.0 );
+    for( unsigned int i = 0; i < this->m_TreesToGenerate.size(); ++i )
+    {
+      this->m_TreesToGenerate[ i ]->GenerateTree();
+    }
+  }
+  else
+  {
+    /** Setup threader. */
+    this->m_Threader->SetSingleMethod( this->GenerateTreesThreaderCallback,
+      const_cast< void * >( static_cast< const void * >(
+        &this->m_KNNGraphAlphaMutualInformationThreaderParameters ) ) );
 
-    /** Compute the derivative (-2.0 * d = -jointSize). */
-    derivative = ( static_cast< AccumulateType >( jointSize ) / sumG ) * contribution;
+    /** Launch. */
+    this->m_Threader->SingleMethodExecute();
   }
-  value = -measure;
+  this->m_FixedTreeIsValid = true;
 
-} // end GetValueAndDerivative()
+  /** Initialize tree searchers. */
+  this->m_BinaryKNNTreeSearcherFixed
+  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
+  this->m_BinaryKNNTreeSearcherMoving
+  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
+  this->m_BinaryKNNTreeSearcherJoint
+  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+
+} // end GenerateTrees()
+
+
+/**
+ * **************** GenerateTreesThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GenerateTreesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  KNNGraphAlphaMutualInformationMultiThreaderParameterType * temp
+    = static_cast< KNNGraphAlphaMutualInformationMultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedGenerateTrees( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GenerateTreesThreaderCallback()
+
+
+/**
+ * ******************* ThreadedGenerateTrees *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGenerateTrees( ThreadIdType threadId )
+{
+  /** Thread t generates the trees t, t + T, t + 2T, ... */
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  for( std::size_t i = threadId; i < this->m_TreesToGenerate.size(); i += numberOfThreads )
+  {
+    this->m_TreesToGenerate[ i ]->GenerateTree();
+  }
+
+} // end ThreadedGenerateTrees()
+
+
+/**
+ * ************************ IsFixedListSampleUnchanged *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::IsFixedListSampleUnchanged( const ListSamplePointer & listSampleFixed ) const
+{
+  /** Compare with the samples from which the fixed tree was generated. */
+  const ListSampleType * treeSample = this->m_BinaryKNNTreeFixed->GetSample();
+  if( treeSample == nullptr )
+  {
+    return false;
+  }
+
+  const unsigned long numberOfPoints = listSampleFixed->GetActualSize();
+  const unsigned int  dimension      = listSampleFixed->GetMeasurementVectorSize();
+  if( this->m_BinaryKNNTreeFixed->GetActualNumberOfDataPoints() != numberOfPoints
+    || this->m_BinaryKNNTreeFixed->GetDataDimension() != dimension )
+  {
+    return false;
+  }
+
+  typename ListSampleType::InternalDataContainerType oldPoints = treeSample->GetInternalContainer();
+  typename ListSampleType::InternalDataContainerType newPoints = listSampleFixed->GetInternalContainer();
+  for( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    if( !std::equal( newPoints[ i ], newPoints[ i ] + dimension, oldPoints[ i ] ) )
+    {
+      return false;
+    }
+  }
+
+  return true;
+
+} // end IsFixedListSampleUnchanged()
 
 
 /**
@@ -18,15 +18,13 @@
 #ifndef __itkNormalizedGradientCorrelationImageToImageMetric_h
 #define __itkNormalizedGradientCorrelationImageToImageMetric_h
 
-#include "itkAdvancedImageToImageMetric.h"
+#include "itkRayCastFiniteDifferenceImageToImageMetric.h"
 #include "itkSobelOperator.h"
 #include "itkNeighborhoodOperatorImageFilter.h"
 #include "itkPoint.h"
 #include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
-#include "itkOptimizer.h"
-#include "itkAdvancedCombinationTransform.h"
-#include "itkAdvancedRayCastInterpolateImageFunction.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -35,6 +33,10 @@ namespace itk
  * \class NormalizedGradientCorrelationImageToImageMetric
  * \brief An metric based on the itk::NormalizedGradientCorrelationImageToImageMetric.
  *
+ * The derivative is computed by central finite differences, see
+ * RayCastFiniteDifferenceImageToImageMetric. When multi-threading is switched
+ * on, every thread also owns its own Sobel filters.
+ *
  *
  * \ingroup Metrics
  *
@@ -42,21 +44,22 @@ namespace itk
 
 template< class TFixedImage, class TMovingImage >
 class NormalizedGradientCorrelationImageToImageMetric :
-  public AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+  public RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 {
 public:
 
   /** Standard class typedefs. */
-  typedef NormalizedGradientCorrelationImageToImageMetric         Self;
-  typedef AdvancedImageToImageMetric< TFixedImage, TMovingImage > Superclass;
-  typedef SmartPointer< Self >                                    Pointer;
-  typedef SmartPointer< const Self >                              ConstPointer;
+  typedef NormalizedGradientCorrelationImageToImageMetric Self;
+  typedef RayCastFiniteDifferenceImageToImageMetric<
+    TFixedImage, TMovingImage >                           Superclass;
+  typedef SmartPointer< Self >                            Pointer;
+  typedef SmartPointer< const Self >                      ConstPointer;
 
   /** Method for creation through the object factory. */
   itkNewMacro( Self );
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro( NormalizedGradientCorrelationImageToImageMetric, AdvancedImageToImageMetric );
+  itkTypeMacro( NormalizedGradientCorrelationImageToImageMetric, RayCastFiniteDifferenceImageToImageMetric );
 
   /** Types transferred from the base class */
   /** Work around a Visual Studio .NET bug */
@@ -85,26 +88,21 @@ public:
   typedef typename Superclass::MovingImagePointer      MovingImagePointer;
   typedef typename TFixedImage::PixelType              FixedImagePixelType;
   typedef typename TMovingImage::PixelType             MovedImagePixelType;
-  typedef typename itk::Optimizer                      OptimizerType;
-  typedef typename OptimizerType::ScalesType           ScalesType;
+  typedef typename Superclass::ScalesType              ScalesType;
 
   itkStaticConstMacro( FixedImageDimension, unsigned int, TFixedImage::ImageDimension );
 
   /** Types for transforming the moving image */
-  typedef typename itk::AdvancedCombinationTransform<
-    ScalarType, FixedImageDimension >                    CombinationTransformType;
-  typedef typename CombinationTransformType::Pointer CombinationTransformPointer;
-  typedef itk::Image< FixedImagePixelType,
-    itkGetStaticConstMacro( FixedImageDimension ) >   TransformedMovingImageType;
+  typedef typename Superclass::CombinationTransformType    CombinationTransformType;
+  typedef typename Superclass::CombinationTransformPointer CombinationTransformPointer;
+  typedef typename Superclass::TransformedMovingImageType  TransformedMovingImageType;
   typedef itk::Image< unsigned char,
     itkGetStaticConstMacro( FixedImageDimension ) >   MaskImageType;
   typedef typename MaskImageType::Pointer MaskImageTypePointer;
-  typedef itk::ResampleImageFilter<
-    MovingImageType, TransformedMovingImageType >       TransformMovingImageFilterType;
-  typedef typename TransformMovingImageFilterType::Pointer TransformMovingImageFilterPointer;
-  typedef typename itk::AdvancedRayCastInterpolateImageFunction
-    < MovingImageType, ScalarType >                     RayCastInterpolatorType;
-  typedef typename RayCastInterpolatorType::Pointer RayCastInterpolatorPointer;
+  typedef typename Superclass::TransformMovingImageFilterType    TransformMovingImageFilterType;
+  typedef typename Superclass::TransformMovingImageFilterPointer TransformMovingImageFilterPointer;
+  typedef typename Superclass::RayCastInterpolatorType           RayCastInterpolatorType;
+  typedef typename Superclass::RayCastInterpolatorPointer        RayCastInterpolatorPointer;
 
   /** Sobel filters to compute the gradients of the Fixed Image */
   typedef itk::Image< RealType,
@@ -123,17 +121,9 @@ public:
   typedef typename CastMovedImageFilterType::Pointer CastMovedImageFilterPointer;
   typedef typename MovedGradientImageType::PixelType MovedGradientPixelType;
 
-  /** Get the derivatives of the match measure. */
-  void GetDerivative( const TransformParametersType & parameters,
-    DerivativeType  & derivative ) const override;
-
   /**  Get the value for single valued optimizers. */
   MeasureType GetValue( const TransformParametersType & parameters ) const override;
 
-  /**  Get value and derivatives for multiple valued optimizers. */
-  void GetValueAndDerivative( const TransformParametersType & parameters,
-    MeasureType & Value, DerivativeType & derivative ) const override;
-
   /** Initialize the Metric by making sure that all the components
    *  are present and plugged together correctly.
    */
@@ -142,16 +132,6 @@ public:
   /** Write gradient images to a files for debugging purposes. */
   void WriteGradientImagesToFiles( void ) const;
 
-  /** Set/Get Scales  */
-  itkSetMacro( Scales, ScalesType );
-  itkGetConstReferenceMacro( Scales, ScalesType );
-
-  /** Set/Get the value of Delta used for computing derivatives by finite
-   * differences in the GetDerivative() method.
-   */
-  itkSetMacro( DerivativeDelta, double );
-  itkGetConstReferenceMacro( DerivativeDelta, double );
-
   /** Set the parameters defining the Transform. */
   void SetTransformParameters( const TransformParametersType & parameters ) const;
 
@@ -161,37 +141,58 @@ protected:
   ~NormalizedGradientCorrelationImageToImageMetric() override {}
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  typedef NeighborhoodOperatorImageFilter<
+    FixedGradientImageType, FixedGradientImageType >        FixedSobelFilter;
+  typedef NeighborhoodOperatorImageFilter<
+    MovedGradientImageType, MovedGradientImageType >        MovedSobelFilter;
+  typedef typename MovedSobelFilter::Pointer MovedSobelFilterPointer;
+
+  /** The filters that compute the gradients of the DRR of the perturbation
+   * pipeline of one thread.
+   */
+  struct PerturbationFiltersType
+  {
+    CastMovedImageFilterPointer st_CastMovedImageFilter;
+    MovedSobelFilterPointer     st_MovedSobelFilters[ MovedImageDimension ];
+  };
+
   /** Compute the mean of the fixed and moved image gradients. */
   void ComputeMeanMovedGradient( void ) const;
 
+  void ComputeMeanMovedGradient( const MovedSobelFilterPointer * movedSobelFilters,
+    MovedGradientPixelType * meanMovedGradient ) const;
+
   void ComputeMeanFixedGradient( void ) const;
 
   /** Compute the similarity measure  */
   MeasureType ComputeMeasure( const TransformParametersType & parameters ) const;
 
-  typedef NeighborhoodOperatorImageFilter<
-    FixedGradientImageType, FixedGradientImageType >        FixedSobelFilter;
-  typedef NeighborhoodOperatorImageFilter<
-    MovedGradientImageType, MovedGradientImageType >        MovedSobelFilter;
+  /** Compute the similarity measure from up-to-date moved image gradients. */
+  MeasureType ComputeMeasure( const MovedSobelFilterPointer * movedSobelFilters,
+    const MovedGradientPixelType * meanMovedGradient ) const;
+
+  /** Connect the Sobel filters to the perturbation pipelines. */
+  void InitializePerturbationPipelines( void ) override;
+
+  /** Compute the metric value from the DRR of the pipeline of a thread. */
+  MeasureType ComputePerturbedValue( const ThreadIdType threadId ) const override;
 
 private:
 
   NormalizedGradientCorrelationImageToImageMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );                                  // purposely not implemented
 
-  ScalesType                  m_Scales;
-  double                      m_DerivativeDelta;
   CombinationTransformPointer m_CombinationTransform;
 
+  /** The Sobel filters of the perturbation pipelines, one per thread. */
+  std::vector< PerturbationFiltersType > m_PerturbationFilters;
+
   /** The mean of the moving image gradients. */
   mutable MovedGradientPixelType m_MeanMovedGradient[ MovedImageDimension ];
 
   /** The mean of the fixed image gradients. */
   mutable FixedGradientPixelType m_MeanFixedGradient[ FixedImageDimension ];
 
-  /** The filter for transforming the moving images. */
-  TransformMovingImageFilterPointer m_TransformMovingImageFilter;
-
   /** The Sobel gradients of the fixed image */
   CastFixedImageFilterPointer m_CastFixedImageFilter;
 
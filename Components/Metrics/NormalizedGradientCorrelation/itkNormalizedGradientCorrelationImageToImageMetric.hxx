@@ -23,6 +23,7 @@
 #include "itkNumericTraits.h"
 #include "itkSimpleFilterWatcher.h"
 
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <stdio.h>
@@ -41,8 +42,6 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_CastFixedImageFilter       = CastFixedImageFilterType::New();
   this->m_CastMovedImageFilter       = CastMovedImageFilterType::New();
   this->m_CombinationTransform       = CombinationTransformType::New();
-  this->m_TransformMovingImageFilter = TransformMovingImageFilterType::New();
-  this->m_DerivativeDelta            = 0.001;
 
   for( unsigned int iDimension = 0; iDimension < MovedImageDimension; iDimension++ )
   {
@@ -62,7 +61,7 @@ void
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::Initialize( void )
 {
-  /** Initialize the base class */
+  /** Initialize the base class, which sets up the DRR generation */
   Superclass::Initialize();
 
   unsigned int iFilter;
@@ -84,28 +83,6 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 
   this->ComputeMeanFixedGradient();
 
-  /** Resampling for 3D->2D */
-  RayCastInterpolatorType * rayCaster = dynamic_cast< RayCastInterpolatorType * >(
-    const_cast< InterpolatorType * >( this->GetInterpolator() ) );
-  if( rayCaster != 0 )
-  {
-    this->m_TransformMovingImageFilter->SetTransform( rayCaster->GetTransform() );
-  }
-  else
-  {
-    itkExceptionMacro( << "ERROR: the NormalizedGradientCorrelationImageToImageMetric is currently "
-                       << "only suitable for 2D-3D registration.\n"
-                       << "  Therefore it expects an interpolator of type RayCastInterpolator." );
-  }
-  this->m_TransformMovingImageFilter->SetInterpolator( this->m_Interpolator );
-  this->m_TransformMovingImageFilter->SetInput( this->m_MovingImage );
-  this->m_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
-  this->m_TransformMovingImageFilter->SetSize( this->m_FixedImage->GetLargestPossibleRegion().GetSize() );
-  this->m_TransformMovingImageFilter->SetOutputOrigin( this->m_FixedImage->GetOrigin() );
-  this->m_TransformMovingImageFilter->SetOutputSpacing( this->m_FixedImage->GetSpacing() );
-  this->m_TransformMovingImageFilter->SetOutputDirection( this->m_FixedImage->GetDirection() );
-  this->m_TransformMovingImageFilter->Update();
-
   this->m_CastMovedImageFilter->SetInput(
     this->m_TransformMovingImageFilter->GetOutput() );
 
@@ -120,9 +97,46 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     this->m_MovedSobelFilters[ iFilter ]->UpdateLargestPossibleRegion();
   }
 
+  /** Prepare the concurrent evaluation of the finite differences. */
+  this->InitializePerturbationPipelines();
+
 } // end Initialize()
 
 
+/**
+ * ***************** InitializePerturbationPipelines *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::InitializePerturbationPipelines( void )
+{
+  Superclass::InitializePerturbationPipelines();
+
+  this->m_PerturbationFilters.resize( this->m_PerturbationPipelines.size() );
+  for( std::size_t i = 0; i < this->m_PerturbationPipelines.size(); ++i )
+  {
+    PerturbationFiltersType & filters = this->m_PerturbationFilters[ i ];
+
+    filters.st_CastMovedImageFilter = CastMovedImageFilterType::New();
+    filters.st_CastMovedImageFilter->SetNumberOfWorkUnits( 1 );
+    filters.st_CastMovedImageFilter->SetInput(
+      this->m_PerturbationPipelines[ i ].st_TransformMovingImageFilter->GetOutput() );
+
+    for( unsigned int iFilter = 0; iFilter < MovedImageDimension; iFilter++ )
+    {
+      filters.st_MovedSobelFilters[ iFilter ] = MovedSobelFilter::New();
+      filters.st_MovedSobelFilters[ iFilter ]->SetNumberOfWorkUnits( 1 );
+      filters.st_MovedSobelFilters[ iFilter ]->OverrideBoundaryCondition( &this->m_MovedBoundCond );
+      filters.st_MovedSobelFilters[ iFilter ]->SetOperator( this->m_MovedSobelOperators[ iFilter ] );
+      filters.st_MovedSobelFilters[ iFilter ]->SetInput( filters.st_CastMovedImageFilter->GetOutput() );
+    }
+  }
+
+} // end InitializePerturbationPipelines()
+
+
 /**
  * ***************** PrintSelf *****************
  */
@@ -133,7 +147,6 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::PrintSelf( std::ostream & os, Indent indent ) const
 {
   Superclass::PrintSelf( os, indent );
-  os << indent << "DerivativeDelta: " << this->m_DerivativeDelta << std::endl;
 } // end PrintSelf()
 
 
@@ -222,21 +235,36 @@ template< class TFixedImage, class TMovingImage >
 void
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputeMeanMovedGradient( void ) const
+{
+  this->ComputeMeanMovedGradient( this->m_MovedSobelFilters, this->m_MeanMovedGradient );
+
+} // end ComputeMeanMovedGradient()
+
+
+/**
+ * ***************** ComputeMeanMovedGradient *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMeanMovedGradient( const MovedSobelFilterPointer * movedSobelFilters,
+  MovedGradientPixelType * meanMovedGradient ) const
 {
   typename MovedGradientImageType::IndexType currentIndex;
   typename MovedGradientImageType::PointType point;
 
   for( int iDimension = 0; iDimension < MovedImageDimension; iDimension++ )
   {
-    this->m_MovedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+    movedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
   }
 
   typedef  itk::ImageRegionConstIteratorWithIndex< MovedGradientImageType >
     MovedIteratorType;
 
-  MovedIteratorType movedIteratorx( this->m_MovedSobelFilters[ 0 ]->GetOutput(),
+  MovedIteratorType movedIteratorx( movedSobelFilters[ 0 ]->GetOutput(),
   this->GetFixedImageRegion() );
-  MovedIteratorType movedIteratory( this->m_MovedSobelFilters[ 1 ]->GetOutput(),
+  MovedIteratorType movedIteratory( movedSobelFilters[ 1 ]->GetOutput(),
   this->GetFixedImageRegion() );
 
   movedIteratorx.GoToBegin();
@@ -288,8 +316,8 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     ++movedIteratory;
   } // end while
 
-  this->m_MeanMovedGradient[ 0 ] = movedGradient[ 0 ] / nPixels;
-  this->m_MeanMovedGradient[ 1 ] = movedGradient[ 1 ] / nPixels;
+  meanMovedGradient[ 0 ] = movedGradient[ 0 ] / nPixels;
+  meanMovedGradient[ 1 ] = movedGradient[ 1 ] / nPixels;
 
 } // end ComputeMeanMovedGradient()
 
@@ -303,10 +331,35 @@ typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingIm
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputeMeasure( const TransformParametersType & parameters ) const
 {
-  this->SetTransformParameters( parameters );
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+  this->UpdateMovedImage( parameters );
 
+  /** Make sure all is updated */
+  for( int iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
+  {
+    this->m_FixedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+    this->m_MovedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+  }
+
+  this->m_NumberOfPixelsCounted = 0;
+
+  return this->ComputeMeasure( this->m_MovedSobelFilters, this->m_MeanMovedGradient );
+
+} // end ComputeMeasure()
+
+
+/**
+ * ***************** ComputeMeasure *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMeasure( const MovedSobelFilterPointer * movedSobelFilters,
+  const MovedGradientPixelType * meanMovedGradient ) const
+{
+  /** This function only reads the (fixed) gradient images, so that it
+   * can be called concurrently for different perturbation pipelines.
+   */
   typename FixedImageType::IndexType currentIndex;
   typename FixedImageType::PointType point;
 
@@ -319,13 +372,6 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   MeasureType NGautocorrelationfixed  = NumericTraits< MeasureType >::Zero;
   MeasureType NGautocorrelationmoving = NumericTraits< MeasureType >::Zero;
 
-  /** Make sure all is updated */
-  for( int iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
-  {
-    this->m_FixedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
-    this->m_MovedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
-  }
-
   typedef  itk::ImageRegionConstIteratorWithIndex< FixedGradientImageType >
     FixedIteratorType;
 
@@ -340,15 +386,14 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   typedef  itk::ImageRegionConstIteratorWithIndex< MovedGradientImageType >
     MovedIteratorType;
 
-  MovedIteratorType movedIteratorx( this->m_MovedSobelFilters[ 0 ]->GetOutput(),
+  MovedIteratorType movedIteratorx( movedSobelFilters[ 0 ]->GetOutput(),
   this->GetFixedImageRegion() );
-  MovedIteratorType movedIteratory( this->m_MovedSobelFilters[ 1 ]->GetOutput(),
+  MovedIteratorType movedIteratory( movedSobelFilters[ 1 ]->GetOutput(),
   this->GetFixedImageRegion() );
 
   movedIteratorx.GoToBegin();
   movedIteratory.GoToBegin();
 
-  this->m_NumberOfPixelsCounted = 0;
   bool sampleOK = false;
 
   if( this->m_FixedImageMask.IsNull() )
@@ -376,9 +421,9 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 
     if( sampleOK )
     {
-      NmovedGradient[ 0 ]      = movedIteratorx.Get() - this->m_MeanMovedGradient[ 0 ];
+      NmovedGradient[ 0 ]      = movedIteratorx.Get() - meanMovedGradient[ 0 ];
       NfixedGradient[ 0 ]      = fixedIteratorx.Get() - this->m_MeanFixedGradient[ 0 ];
-      NmovedGradient[ 1 ]      = movedIteratory.Get() - this->m_MeanMovedGradient[ 1 ];
+      NmovedGradient[ 1 ]      = movedIteratory.Get() - meanMovedGradient[ 1 ];
       NfixedGradient[ 1 ]      = fixedIteratory.Get() - this->m_MeanFixedGradient[ 1 ];
       NGcrosscorrelation      += NmovedGradient[ 0 ] * NfixedGradient[ 0 ] + NmovedGradient[ 1 ] * NfixedGradient[ 1 ];
       NGautocorrelationmoving += NmovedGradient[ 0 ] * NmovedGradient[ 0 ] + NmovedGradient[ 1 ] * NmovedGradient[ 1 ];
@@ -426,8 +471,7 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   //this->SetTransformParameters( parameters );
 
   unsigned int iFilter;
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+  this->UpdateMovedImage( parameters );
 
   for( iFilter = 0; iFilter < MovedImageDimension; iFilter++ )
   {
@@ -461,47 +505,22 @@ NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 
 
 /**
- * ***************** GetDerivative *****************
+ * ***************** ComputePerturbedValue *****************
  */
 
 template< class TFixedImage, class TMovingImage >
-void
+typename NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
 NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
-::GetDerivative( const TransformParametersType & parameters,
-  DerivativeType & derivative ) const
+::ComputePerturbedValue( const ThreadIdType threadId ) const
 {
-  TransformParametersType testPoint;
-  testPoint = parameters;
-  const unsigned int numberOfParameters = this->GetNumberOfParameters();
-  derivative = DerivativeType( numberOfParameters );
+  const PerturbationFiltersType & filters = this->m_PerturbationFilters[ threadId ];
 
-  for( unsigned int i = 0; i < numberOfParameters; i++ )
-  {
-    testPoint[ i ] -= this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
-    const MeasureType valuep0 = this->GetValue( testPoint );
-    testPoint[ i ] += 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
-    const MeasureType valuep1 = this->GetValue( testPoint );
-    derivative[ i ] = ( valuep1 - valuep0 ) / ( 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] ) );
-    testPoint[ i ]  = parameters[ i ];
-  }
+  MovedGradientPixelType meanMovedGradient[ MovedImageDimension ];
+  this->ComputeMeanMovedGradient( filters.st_MovedSobelFilters, meanMovedGradient );
 
-} // end GetDerivative()
-
-
-/**
- * ***************** GetValueAndDerivative *****************
- */
-
-template< class TFixedImage, class TMovingImage >
-void
-NormalizedGradientCorrelationImageToImageMetric< TFixedImage, TMovingImage >
-::GetValueAndDerivative( const TransformParametersType & parameters,
-  MeasureType & value, DerivativeType & derivative ) const
-{
-  value = this->GetValue( parameters );
-  this->GetDerivative( parameters, derivative );
+  return this->ComputeMeasure( filters.st_MovedSobelFilters, meanMovedGradient );
 
-} // end GetValueAndDerivative()
+} // end ComputePerturbedValue()
 
 
 } // end namespace itk
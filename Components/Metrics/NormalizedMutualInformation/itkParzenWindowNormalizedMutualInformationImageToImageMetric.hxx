@@ -152,7 +152,7 @@ ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingI
   this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha  );
 
   /** Compute the fixed and moving marginal pdfs, by summing over the joint pdf */
-  this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
+  this->ComputeFixedImageMarginalPDF();
   this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
 
   /** Replace the probabilities by log(probabilities) */
@@ -193,7 +193,7 @@ ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingI
   this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha  );
 
   /** Compute the fixed and moving marginal pdf by summing over the histogram */
-  this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
+  this->ComputeFixedImageMarginalPDF();
   this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
 
   /** Replace the probabilities by log(probabilities) */
@@ -170,6 +170,11 @@ protected:
   struct PCAMetricMultiThreaderParameterType
   {
     Self * m_Metric;
+
+    /** The derivative that is written directly by the threads when they
+     * are partitioned over the last dimension, or nullptr.
+     */
+    DerivativeValueType * m_DerivativePointer;
   };
 
   PCAMetricMultiThreaderParameterType m_PCAMetricThreaderParameters;
@@ -197,6 +202,20 @@ protected:
 
   inline void ThreadedComputeDerivative( ThreadIdType threadID );
 
+  /** Compute the derivative for the last dimension positions of a thread,
+   * over all approved samples. Used when UseSlicePartitioning() is true.
+   */
+  inline void ThreadedComputeSliceDerivative( ThreadIdType threadID );
+
+  /** True if the derivative should be partitioned over the last dimension
+   * positions instead of over the samples. This is the case when the
+   * transform is a StackTransform: the parameters of each position are then
+   * only written by the thread that handles that position, so no reduction
+   * over the threads is needed, and each thread only evaluates the
+   * sub-transforms of its own positions.
+   */
+  bool UseSlicePartitioning( void ) const;
+
   /** Gather the values and derivatives from all threads */
   inline void AfterThreadedGetSamples( MeasureType & value ) const;
 
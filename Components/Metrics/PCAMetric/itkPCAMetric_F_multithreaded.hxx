@@ -55,7 +55,8 @@ PCAMetric< TFixedImage, TMovingImage >
   this->m_PCAMetricGetSamplesPerThreadVariablesSize = 0;
 
   /** Initialize the m_ParzenWindowHistogramThreaderParameters. */
-  this->m_PCAMetricThreaderParameters.m_Metric = this;
+  this->m_PCAMetricThreaderParameters.m_Metric            = this;
+  this->m_PCAMetricThreaderParameters.m_DerivativePointer = nullptr;
 } // end constructor
 
 
@@ -722,6 +723,17 @@ PCAMetric< TFixedImage, TMovingImage >
   /** Get the metric value contributions from all threads. */
   this->AfterThreadedGetSamples( value );
 
+  /** For a StackTransform, let each thread handle whole time points, and
+   * write directly into the derivative.
+   */
+  this->m_PCAMetricThreaderParameters.m_DerivativePointer = nullptr;
+  if( this->UseSlicePartitioning() )
+  {
+    derivative.SetSize( this->GetNumberOfParameters() );
+    derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    this->m_PCAMetricThreaderParameters.m_DerivativePointer = derivative.begin();
+  }
+
   /** Launch multi-threading ComputeDerivative */
   this->LaunchComputeDerivativeThreaderCallback();
 
@@ -982,6 +994,12 @@ void
 PCAMetric< TFixedImage, TMovingImage >
 ::ThreadedComputeDerivative( ThreadIdType threadId )
 {
+  if( this->m_PCAMetricThreaderParameters.m_DerivativePointer != nullptr )
+  {
+    this->ThreadedComputeSliceDerivative( threadId );
+    return;
+  }
+
   /** Create variables to store intermediate results in. */
   DerivativeType & derivative = this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_Derivative;
   derivative.Fill( 0.0 );
@@ -1047,6 +1065,103 @@ PCAMetric< TFixedImage, TMovingImage >
 } // end ThreadedGetValueAndDerivative()
 
 
+/**
+ * ******************* UseSlicePartitioning *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+PCAMetric< TFixedImage, TMovingImage >
+::UseSlicePartitioning( void ) const
+{
+  /** With fewer positions than threads some threads would be idle. */
+  return this->m_TransformIsStackTransform
+         && this->m_G >= Self::GetNumberOfWorkUnits();
+
+} // end UseSlicePartitioning()
+
+
+/**
+ * ******************* ThreadedComputeSliceDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric< TFixedImage, TMovingImage >
+::ThreadedComputeSliceDerivative( ThreadIdType threadId )
+{
+  /** Get the last dimension positions for this thread. */
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  const unsigned int nrOfPositionsPerThreads
+    = static_cast< unsigned int >( std::ceil( static_cast< double >( this->m_G )
+    / static_cast< double >( numberOfThreads ) ) );
+  unsigned int d_begin = nrOfPositionsPerThreads * threadId;
+  unsigned int d_end   = nrOfPositionsPerThreads * ( threadId + 1 );
+  d_begin = ( d_begin > this->m_G ) ? this->m_G : d_begin;
+  d_end   = ( d_end > this->m_G ) ? this->m_G : d_end;
+
+  DerivativeValueType * derivative = this->m_PCAMetricThreaderParameters.m_DerivativePointer;
+
+  /** Initialize some variables. */
+  RealType                  movingImageValue;
+  MovingImagePointType      mappedPoint;
+  MovingImageDerivativeType movingImageDerivative;
+
+  TransformJacobianType      jacobian;
+  DerivativeType             imageJacobian( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  NonZeroJacobianIndicesType nzjis( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+
+  /** Loop over the positions of this thread, and for each position over the
+   * approved samples of all threads, so that only the sub-transform of that
+   * position is evaluated.
+   */
+  for( unsigned int d = d_begin; d < d_end; ++d )
+  {
+    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+    {
+      const std::vector< FixedImagePointType > & approvedSamples
+        = this->m_PCAMetricGetSamplesPerThreadVariables[ i ].st_ApprovedSamples;
+      unsigned int pixelIndex = this->m_PixelStartIndex[ i ];
+      for( unsigned int s = 0; s < approvedSamples.size(); ++s, ++pixelIndex )
+      {
+        /** Set fixed point's last dimension to lastDimPosition. */
+        FixedImagePointType           fixedPoint = approvedSamples[ s ];
+        FixedImageContinuousIndexType voxelCoord;
+        this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
+        voxelCoord[ this->m_LastDimIndex ] = d;
+        this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
+
+        this->TransformPoint( fixedPoint, mappedPoint );
+        this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &movingImageDerivative );
+
+        /** Get the TransformJacobian dT/dmu */
+        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzjis );
+
+        /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          jacobian, movingImageDerivative, imageJacobian );
+
+        /** The eigenvector terms only depend on the sample and the position. */
+        DerivativeValueType weight = 0.0;
+        for( unsigned int z = 0; z < this->m_NumEigenValues; z++ )
+        {
+          weight += this->m_vSAtmm[ z ][ pixelIndex ] * this->m_Sv[ d ][ z ]
+            + this->m_vdSdmu_part1[ z ][ d ] * this->m_Atmm[ d ][ pixelIndex ] * this->m_CSv[ d ][ z ];
+        }
+
+        /** build metric derivative components */
+        for( unsigned int p = 0; p < nzjis.size(); ++p )
+        {
+          derivative[ nzjis[ p ] ] += weight * imageJacobian[ p ];
+        }
+      }
+    }
+  }
+
+} // end ThreadedComputeSliceDerivative()
+
+
 /**
  * ******************* AfterThreadedComputeDerivative *******************
  */
@@ -1059,10 +1174,16 @@ PCAMetric< TFixedImage, TMovingImage >
 {
   const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
 
-  derivative = this->m_PCAMetricGetSamplesPerThreadVariables[ 0 ].st_Derivative;
-  for( ThreadIdType i = 1; i < numberOfThreads; ++i )
+  /** Sum the derivatives of the threads, unless they were partitioned over
+   * the last dimension and wrote directly into the derivative.
+   */
+  if( this->m_PCAMetricThreaderParameters.m_DerivativePointer == nullptr )
   {
-    derivative += this->m_PCAMetricGetSamplesPerThreadVariables[ i ].st_Derivative;
+    derivative = this->m_PCAMetricGetSamplesPerThreadVariables[ 0 ].st_Derivative;
+    for( ThreadIdType i = 1; i < numberOfThreads; ++i )
+    {
+      derivative += this->m_PCAMetricGetSamplesPerThreadVariables[ i ].st_Derivative;
+    }
   }
 
   derivative *= -( 2.0 / ( DerivativeValueType( this->m_NumberOfPixelsCounted ) - 1.0 ) ); //normalize
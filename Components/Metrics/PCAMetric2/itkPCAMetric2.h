@@ -100,6 +100,12 @@ public:
     Superclass::MovingImageLimiterOutputType              MovingImageLimiterOutputType;
   typedef typename
     Superclass::MovingImageDerivativeScalesType           MovingImageDerivativeScalesType;
+  typedef typename DerivativeType::ValueType              DerivativeValueType;
+  typedef typename Superclass::ThreaderType               ThreaderType;
+  typedef typename Superclass::ThreadInfoType             ThreadInfoType;
+
+  typedef vnl_matrix< RealType >            MatrixType;
+  typedef vnl_matrix< DerivativeValueType > DerivativeMatrixType;
 
   /** The fixed image dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int,
@@ -129,7 +135,7 @@ public:
 protected:
 
   PCAMetric2();
-  ~PCAMetric2() override {}
+  ~PCAMetric2() override;
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
   /** Protected Typedefs ******************/
@@ -147,6 +153,7 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::NumberOfParametersType              NumberOfParametersType;
 
   /** Computes the innerproduct of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
@@ -157,6 +164,63 @@ protected:
     const MovingImageDerivativeType & movingImageDerivative,
     DerivativeType & imageJacobian ) const override;
 
+  struct PCAMetric2MultiThreaderParameterType
+  {
+    Self * m_Metric;
+  };
+
+  PCAMetric2MultiThreaderParameterType m_PCAMetric2ThreaderParameters;
+
+  /** Per thread: the approved samples and their intensities over the last
+   * dimension, plus the mean and the centered G x G cross-product matrix of
+   * these rows, which are combined into the covariance matrix afterwards.
+   */
+  struct PCAMetric2GetSamplesPerThreadStruct
+  {
+    SizeValueType                      st_NumberOfPixelsCounted;
+    MatrixType                         st_DataBlock;
+    std::vector< FixedImagePointType > st_ApprovedSamples;
+    vnl_vector< RealType >             st_Mean;
+    MatrixType                         st_CrossProducts;
+  };
+
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, PCAMetric2GetSamplesPerThreadStruct,
+    PaddedPCAMetric2GetSamplesPerThreadStruct );
+
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT,
+    PaddedPCAMetric2GetSamplesPerThreadStruct,
+    AlignedPCAMetric2GetSamplesPerThreadStruct );
+
+  mutable AlignedPCAMetric2GetSamplesPerThreadStruct * m_PCAMetric2GetSamplesPerThreadVariables;
+  mutable ThreadIdType                                 m_PCAMetric2GetSamplesPerThreadVariablesSize;
+
+  /** Get the samples and their statistics for each thread. */
+  inline void ThreadedGetSamples( ThreadIdType threadID );
+
+  /** Get the derivative contributions for each thread. */
+  inline void ThreadedComputeDerivative( ThreadIdType threadID );
+
+  /** Combine the statistics of all threads, and compute the value and,
+   * optionally, the terms needed for the derivative.
+   */
+  inline void AfterThreadedGetSamples( MeasureType & value, const bool computeDerivativeTerms ) const;
+
+  /** Gather the derivatives from all threads. */
+  inline void AfterThreadedComputeDerivative( DerivativeType & derivative ) const;
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_TYPE GetSamplesThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE ComputeDerivativeThreaderCallback( void * arg );
+
+  /** Helper functions to launch the threads. */
+  void LaunchGetSamplesThreaderCallback( void ) const;
+
+  void LaunchComputeDerivativeThreaderCallback( void ) const;
+
+  /** Initialize some multi-threading related parameters. */
+  void InitializeThreadingParameters( void ) const override;
+
 private:
 
   PCAMetric2( const Self & );      // purposely not implemented
@@ -165,6 +229,17 @@ private:
   /** Sample n random numbers from 0..m and add them to the vector. */
   void SampleRandom( const int n, const int m, std::vector< int > & numbers ) const;
 
+  /** Compute the eigenvalues, in ascending order, and optionally the
+   * corresponding eigenvectors of the symmetric matrix K. Uses Eigen when
+   * available, and vnl_symmetric_eigensystem otherwise.
+   */
+  void ComputeSymmetricEigenSystem( const MatrixType & K,
+    vnl_vector< RealType > & eigenValues, MatrixType & eigenVectors,
+    const bool computeEigenVectors ) const;
+
+  /** Subtract the mean over the last dimension from the derivative elements. */
+  void SubtractMeanFromDerivative( DerivativeType & derivative ) const;
+
   /** Variables to control random sampling in last dimension. */
   unsigned int m_NumAdditionalSamplesFixed;
   unsigned int m_ReducedDimensionIndex;
@@ -178,6 +253,14 @@ private:
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform;
 
+  /** Terms needed for the threaded derivative computation. Per sample, the
+   * derivative coefficient of time point d is ( Q a + b .* a )[ d ], with a
+   * the sample's intensities minus the mean over all samples.
+   */
+  mutable vnl_vector< RealType >            m_Mean;
+  mutable DerivativeMatrixType              m_DerivativeCoefficientMatrix;
+  mutable vnl_vector< DerivativeValueType > m_DerivativeCoefficientDiagonal;
+
 };
 
 } // end namespace itk
@@ -29,6 +29,11 @@
 #include <numeric>
 #include <fstream>
 
+#ifdef ELASTIX_USE_EIGEN
+#include <Eigen/Dense>
+#include <Eigen/Core>
+#endif
+
 namespace itk
 {
 /**
@@ -44,9 +49,28 @@ PCAMetric2< TFixedImage, TMovingImage >
   this->SetUseImageSampler( true );
   this->SetUseFixedImageLimiter( false );
   this->SetUseMovingImageLimiter( false );
+
+  // Multi-threading structs
+  this->m_PCAMetric2GetSamplesPerThreadVariables     = nullptr;
+  this->m_PCAMetric2GetSamplesPerThreadVariablesSize = 0;
+
+  /** Initialize the m_PCAMetric2ThreaderParameters. */
+  this->m_PCAMetric2ThreaderParameters.m_Metric = this;
 } // end constructor
 
 
+/**
+ * ******************* Destructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+PCAMetric2< TFixedImage, TMovingImage >
+::~PCAMetric2()
+{
+  delete[] this->m_PCAMetric2GetSamplesPerThreadVariables;
+} // end Destructor
+
+
 /**
  * ******************* Initialize *******************
  */
@@ -59,9 +83,13 @@ PCAMetric2< TFixedImage, TMovingImage >
   /** Initialize transform, interpolator, etc. */
   Superclass::Initialize();
 
-  /** Retrieve slowest varying dimension and its size. */
-  //const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
-  //const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+  /** Without multi-threading the parts of all threads are processed one
+   * after the other, so the per-thread variables are needed as well.
+   */
+  if( !this->m_UseMultiThread )
+  {
+    this->InitializeThreadingParameters();
+  }
 
 } // end Initialize()
 
@@ -79,6 +107,38 @@ PCAMetric2< TFixedImage, TMovingImage >
 } // end PrintSelf()
 
 
+/**
+ * ********************* InitializeThreadingParameters ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::InitializeThreadingParameters( void ) const
+{
+  /** Initialize the per-thread derivatives of the superclass. */
+  Superclass::InitializeThreadingParameters();
+
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Only resize the array of structs when needed. */
+  if( this->m_PCAMetric2GetSamplesPerThreadVariablesSize != numberOfThreads )
+  {
+    delete[] this->m_PCAMetric2GetSamplesPerThreadVariables;
+    this->m_PCAMetric2GetSamplesPerThreadVariables
+      = new AlignedPCAMetric2GetSamplesPerThreadStruct[ numberOfThreads ];
+    this->m_PCAMetric2GetSamplesPerThreadVariablesSize = numberOfThreads;
+  }
+
+  /** Some initialization. The data blocks are sized in each thread. */
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_PCAMetric2GetSamplesPerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
+  }
+
+} // end InitializeThreadingParameters()
+
+
 /**
  * ******************* SampleRandom *******************
  */
@@ -115,225 +175,214 @@ PCAMetric2< TFixedImage, TMovingImage >
 
 
 /**
- * *************** EvaluateTransformJacobianInnerProduct ****************
+ * ******************* ComputeSymmetricEigenSystem *******************
  */
 
 template< class TFixedImage, class TMovingImage >
 void
 PCAMetric2< TFixedImage, TMovingImage >
-::EvaluateTransformJacobianInnerProduct(
-  const TransformJacobianType & jacobian,
-  const MovingImageDerivativeType & movingImageDerivative,
-  DerivativeType & imageJacobian ) const
+::ComputeSymmetricEigenSystem( const MatrixType & K,
+  vnl_vector< RealType > & eigenValues, MatrixType & eigenVectors,
+  const bool computeEigenVectors ) const
 {
-  typedef typename TransformJacobianType::const_iterator JacobianIteratorType;
-  typedef typename DerivativeType::iterator              DerivativeIteratorType;
-  JacobianIteratorType jac = jacobian.begin();
-  imageJacobian.Fill( 0.0 );
-  const unsigned int sizeImageJacobian = imageJacobian.GetSize();
-  for( unsigned int dim = 0; dim < FixedImageDimension; dim++ )
-  {
-    const double           imDeriv = movingImageDerivative[ dim ];
-    DerivativeIteratorType imjac   = imageJacobian.begin();
+  const unsigned int G = K.rows();
+  eigenValues.set_size( G );
 
-    for( unsigned int mu = 0; mu < sizeImageJacobian; mu++ )
+#ifdef ELASTIX_USE_EIGEN
+  /** The self-adjoint solver of Eigen is considerably faster than vnl for
+   * the small dense matrices we have here, and skips the eigenvectors when
+   * only the value is needed. Its eigenvalues are sorted ascending as well.
+   */
+  typedef Eigen::Matrix< RealType, Eigen::Dynamic, Eigen::Dynamic > EigenMatrixType;
+  EigenMatrixType eigenK( G, G );
+  for( unsigned int i = 0; i < G; ++i )
+  {
+    for( unsigned int j = 0; j < G; ++j )
     {
-      ( *imjac ) += ( *jac ) * imDeriv;
-      ++imjac;
-      ++jac;
+      eigenK( i, j ) = K( i, j );
     }
   }
-} // end EvaluateTransformJacobianInnerProduct()
 
+  Eigen::SelfAdjointEigenSolver< EigenMatrixType > eig( eigenK,
+    computeEigenVectors ? Eigen::ComputeEigenvectors : Eigen::EigenvaluesOnly );
 
-/**
- * ******************* GetValue *******************
- */
-
-template< class TFixedImage, class TMovingImage >
-typename PCAMetric2< TFixedImage, TMovingImage >::MeasureType
-PCAMetric2< TFixedImage, TMovingImage >
-::GetValue( const TransformParametersType & parameters ) const
-{
-  itkDebugMacro( "GetValue( " << parameters << " ) " );
-  bool UseGetValueAndDerivative = false;
+  for( unsigned int i = 0; i < G; ++i )
+  {
+    eigenValues[ i ] = eig.eigenvalues()[ i ];
+  }
 
-  if( UseGetValueAndDerivative )
+  if( computeEigenVectors )
   {
-    typedef typename DerivativeType::ValueType DerivativeValueType;
-    const unsigned int P               = this->GetNumberOfParameters();
-    MeasureType        dummymeasure    = NumericTraits< MeasureType >::Zero;
-    DerivativeType     dummyderivative = DerivativeType( P );
-    dummyderivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+    eigenVectors.set_size( G, G );
+    for( unsigned int i = 0; i < G; ++i )
+    {
+      for( unsigned int j = 0; j < G; ++j )
+      {
+        eigenVectors( i, j ) = eig.eigenvectors()( i, j );
+      }
+    }
+  }
+#else
+  vnl_symmetric_eigensystem< RealType > eig( K );
 
-    this->GetValueAndDerivative( parameters, dummymeasure, dummyderivative );
-    return dummymeasure;
+  for( unsigned int i = 0; i < G; ++i )
+  {
+    eigenValues[ i ] = eig.get_eigenvalue( i );
   }
 
-  /** Make sure the transform parameters are up to date. */
-  this->SetTransformParameters( parameters );
+  if( computeEigenVectors )
+  {
+    eigenVectors = eig.V;
+  }
+#endif
 
-  /** Initialize some variables */
-  this->m_NumberOfPixelsCounted = 0;
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
+} // end ComputeSymmetricEigenSystem()
 
-  /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+/**
+ * ******************* SubtractMeanFromDerivative *******************
+ */
 
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::SubtractMeanFromDerivative( DerivativeType & derivative ) const
+{
   /** Retrieve slowest varying dimension and its size. */
   const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
   const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
 
-  typedef vnl_matrix< RealType > MatrixType;
-
-  /** The rows of the ImageSampleMatrix contain the samples of the images of the stack */
-  const unsigned int numberOfSamples = sampleContainer->Size();
-  MatrixType         datablock( numberOfSamples, G );
-
-  /** Vector containing last dimension positions to use: initialize on all positions when random sampling turned off. */
-  std::vector< int > lastDimPositions;
-
-  /** Determine random last dimension positions if needed. */
-  for( unsigned int i = 0; i < G; ++i )
+  if( !this->m_TransformIsStackTransform )
   {
-    lastDimPositions.push_back( i );
-  }
-
-  /** Initialize dummy loop variable */
-  unsigned int pixelIndex = 0;
-
-  /** Initialize image sample matrix . */
-  datablock.fill( itk::NumericTraits< RealType >::Zero );
-
-  for( fiter = fbegin; fiter != fend; ++fiter )
-  {
-    /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-
-    /** Transform sampled point to voxel coordinates. */
-    FixedImageContinuousIndexType voxelCoord;
-    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
-
-    unsigned int numSamplesOk = 0;
-
-    /** Loop over t */
-    for( unsigned int d = 0; d < G; ++d )
+    /** Update derivative per dimension.
+     * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
+     * per dimension xyz.
+     */
+    const unsigned int lastDimGridSize = this->m_GridSize[ lastDim ];
+    const unsigned int numParametersPerDimension
+      = this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
+    const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
+    DerivativeType     mean( numControlPointsPerDimension );
+    for( unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d )
     {
-      /** Initialize some variables. */
-      RealType             movingImageValue;
-      MovingImagePointType mappedPoint;
-
-      /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[ lastDim ] = lastDimPositions[ d ];
-
-      /** Transform sampled point back to world coordinates. */
-      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
-
-      /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-      /** Check if point is inside mask. */
-      if( sampleOk )
+      /** Compute mean per dimension. */
+      mean.Fill( 0.0 );
+      const unsigned int starti = numParametersPerDimension * d;
+      for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
       {
-        sampleOk = this->IsInsideMovingMask( mappedPoint );
+        const unsigned int index = i % numControlPointsPerDimension;
+        mean[ index ] += derivative[ i ];
       }
+      mean /= static_cast< RealType >( lastDimGridSize );
 
-      if( sampleOk )
+      /** Update derivative for every control point per dimension. */
+      for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
       {
-        sampleOk = this->EvaluateMovingImageValueAndDerivative(
-          mappedPoint, movingImageValue, 0 );
+        const unsigned int index = i % numControlPointsPerDimension;
+        derivative[ i ] -= mean[ index ];
       }
-
-      if( sampleOk )
+    }
+  }
+  else
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
+     * the number the time point index.
+     */
+    const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / G;
+    DerivativeType     mean( numParametersPerLastDimension );
+    mean.Fill( 0.0 );
+
+    /** Compute mean per control point. */
+    for( unsigned int t = 0; t < G; ++t )
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
       {
-        numSamplesOk++;
-        datablock( pixelIndex, d ) = movingImageValue;
+        const unsigned int index = c % numParametersPerLastDimension;
+        mean[ index ] += derivative[ c ];
       }
-
-    } /** end loop over t */
-
-    if( numSamplesOk == G )
-    {
-      pixelIndex++;
-      this->m_NumberOfPixelsCounted++;
     }
+    mean /= static_cast< RealType >( G );
 
-  } /** end first loop over image sample container */
-
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples( numberOfSamples, this->m_NumberOfPixelsCounted );
-  const unsigned int N = this->m_NumberOfPixelsCounted;
-  MatrixType         A( datablock.extract( N, G ) );
-
-  /** Calculate mean of from columns */
-  vnl_vector< RealType > mean( G );
-  mean.fill( NumericTraits< RealType >::Zero );
-  for( unsigned int i = 0; i < N; i++ )
-  {
-    for( unsigned int j = 0; j < G; j++ )
+    /** Update derivative per control point. */
+    for( unsigned int t = 0; t < G; ++t )
     {
-      mean( j ) += A( i, j );
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        derivative[ c ] -= mean[ index ];
+      }
     }
   }
-  mean /= RealType( N );
 
-  MatrixType Amm( N, G );
-  Amm.fill( NumericTraits< RealType >::Zero );
+} // end SubtractMeanFromDerivative()
 
-  for( unsigned int i = 0; i < N; i++ )
-  {
-    for( unsigned int j = 0; j < G; j++ )
-    {
-      Amm( i, j ) = A( i, j ) - mean( j );
-    }
-  }
 
-  /** Compute covariancematrix C */
-  MatrixType C( Amm.transpose() * Amm );
-  C /= static_cast< RealType >( RealType( N ) - 1.0 );
+/**
+ * *************** EvaluateTransformJacobianInnerProduct ****************
+ */
 
-  MatrixType S( G, G );
-  S.fill( NumericTraits< RealType >::Zero );
-  for( unsigned int j = 0; j < G; j++ )
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::EvaluateTransformJacobianInnerProduct(
+  const TransformJacobianType & jacobian,
+  const MovingImageDerivativeType & movingImageDerivative,
+  DerivativeType & imageJacobian ) const
+{
+  typedef typename TransformJacobianType::const_iterator JacobianIteratorType;
+  typedef typename DerivativeType::iterator              DerivativeIteratorType;
+  JacobianIteratorType jac = jacobian.begin();
+  imageJacobian.Fill( 0.0 );
+  const unsigned int sizeImageJacobian = imageJacobian.GetSize();
+  for( unsigned int dim = 0; dim < FixedImageDimension; dim++ )
   {
-    S( j, j ) = 1.0 / sqrt( C( j, j ) );
-  }
-
-  /** Compute correlation matrix K */
-  MatrixType K( S * C * S );
+    const double           imDeriv = movingImageDerivative[ dim ];
+    DerivativeIteratorType imjac   = imageJacobian.begin();
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem< RealType > eig( K );
+    for( unsigned int mu = 0; mu < sizeImageJacobian; mu++ )
+    {
+      ( *imjac ) += ( *jac ) * imDeriv;
+      ++imjac;
+      ++jac;
+    }
+  }
+} // end EvaluateTransformJacobianInnerProduct()
 
-  // The measure is the sum of weighted eigenvalues of the correlation matrix.
-  // measure = sum_{i=1}^G i*lambda_i
 
-  // Note that the system does NOT crash when you violate the number of possible
-  // eigenvalues, i.e. when K is of size 30x30, eigenvalues > 30 also exist and have
-  // a value.
+/**
+ * ******************* GetValue *******************
+ */
 
-  // The eigenvalues of vnl_symmetric_eigensystem are in ascending order, meaning that
-  // when K is of size 30x30, eigenvalue 29 is the highest, and eigenvalue 0 is the lowest.
-  // We want the low eigenvalue to get the highest weight and the highest eigenvalue to get
-  // the lowest weight, i.e. for K of size 30x30:
-  // eigenvalue 29 has a weight of 1 and eigenvalue 0 has a weight of 30
+template< class TFixedImage, class TMovingImage >
+typename PCAMetric2< TFixedImage, TMovingImage >::MeasureType
+PCAMetric2< TFixedImage, TMovingImage >
+::GetValue( const TransformParametersType & parameters ) const
+{
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValue itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before calling GetValue
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValue multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  RealType sumWeightedEigenValues = itk::NumericTraits< RealType >::Zero;
-  for( unsigned int i = 0; i < G; i++ )
-  {
-    sumWeightedEigenValues += ( i + 1 ) * eig.get_eigenvalue( G - i - 1 );
-  }
+  /** Launch multi-threading GetSamples */
+  this->LaunchGetSamplesThreaderCallback();
 
-  measure = sumWeightedEigenValues;
+  /** Combine the sample statistics of all threads and compute the value. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  this->AfterThreadedGetSamples( value, false );
 
-  /** Return the measure value. */
-  return measure;
+  return value;
 
 } // end GetValue()
 
@@ -369,63 +418,86 @@ PCAMetric2< TFixedImage, TMovingImage >
 ::GetValueAndDerivative( const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
-  itkDebugMacro( "GetValueAndDerivative( " << parameters << " ) " );
-  /** Define derivative and Jacobian types. */
-  typedef typename DerivativeType::ValueType DerivativeValueType;
-  //typedef typename TransformJacobianType::ValueType TransformJacobianValueType;
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValueAndDerivative itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
+   *   calling GetValueAndDerivative
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValueAndDerivative multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  /** Initialize some variables */
-  const unsigned int P = this->GetNumberOfParameters();
-  this->m_NumberOfPixelsCounted = 0;
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
-  derivative = DerivativeType( P );
-  derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+  /** Launch multi-threading GetSamples */
+  this->LaunchGetSamplesThreaderCallback();
 
-  /** Make sure the transform parameters are up to date. */
-  this->SetTransformParameters( parameters );
+  /** Combine the sample statistics of all threads and compute the value. */
+  this->AfterThreadedGetSamples( value, true );
 
-  /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  /** Launch multi-threading ComputeDerivative */
+  this->LaunchComputeDerivativeThreaderCallback();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  /** Sum derivative contributions from all threads */
+  this->AfterThreadedComputeDerivative( derivative );
 
-  /** Retrieve slowest varying dimension and its size. */
-  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
-  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+} // end GetValueAndDerivative()
 
-  typedef vnl_matrix< RealType >            MatrixType;
-  typedef vnl_matrix< DerivativeValueType > DerivativeMatrixType;
 
-  std::vector< FixedImagePointType > SamplesOK;
+/**
+ * ******************* ThreadedGetSamples *******************
+ */
 
-  /** The rows of the ImageSampleMatrix contain the samples of the images of the stack */
-  const unsigned int numberOfSamples = sampleContainer->Size();
-  MatrixType         datablock( numberOfSamples, G );
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::ThreadedGetSamples( ThreadIdType threadId )
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
 
-  /** Initialize dummy loop variables */
-  unsigned int pixelIndex = 0;
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
 
-  /** Initialize image sample matrix . */
-  datablock.fill( itk::NumericTraits< RealType >::Zero );
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
 
-  /** Determine random last dimension positions if needed. */
-  /** Vector containing last dimension positions to use: initialize on all positions when random sampling turned off. */
-  /** Vector containing last dimension positions to use: initialize on all positions when random sampling turned off. */
-  std::vector< int > lastDimPositions;
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator threader_fiter;
+  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
 
-  for( unsigned int i = 0; i < G; ++i )
-  {
-    lastDimPositions.push_back( i );
-  }
+  threader_fbegin += (int)pos_begin;
+  threader_fend   += (int)pos_end;
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
 
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  /** Get handles to the pre-allocated containers of this thread.
+   * set_size() only re-allocates when the size changed.
+   */
+  AlignedPCAMetric2GetSamplesPerThreadStruct & threadVariables
+    = this->m_PCAMetric2GetSamplesPerThreadVariables[ threadId ];
+  MatrixType &                         datablock = threadVariables.st_DataBlock;
+  std::vector< FixedImagePointType > & SamplesOK = threadVariables.st_ApprovedSamples;
+  datablock.set_size( nrOfSamplesPerThreads, G );
+  SamplesOK.clear();
+
+  unsigned int pixelIndex = 0;
+  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
   {
     /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    FixedImagePointType fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
 
     /** Transform sampled point to voxel coordinates. */
     FixedImageContinuousIndexType voxelCoord;
@@ -441,7 +513,7 @@ PCAMetric2< TFixedImage, TMovingImage >
       MovingImagePointType mappedPoint;
 
       /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[ lastDim ] = lastDimPositions[ d ];
+      voxelCoord[ lastDim ] = d;
 
       /** Transform sampled point back to world coordinates. */
       this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
@@ -456,7 +528,6 @@ PCAMetric2< TFixedImage, TMovingImage >
       }
 
       if( sampleOk )
-
       {
         sampleOk = this->EvaluateMovingImageValueAndDerivative(
           mappedPoint, movingImageValue, 0 );
@@ -468,47 +539,132 @@ PCAMetric2< TFixedImage, TMovingImage >
         datablock( pixelIndex, d ) = movingImageValue;
       } // end if sampleOk
 
-    } // end loop over gradient images
+    } // end loop over t
+
     if( numSamplesOk == G )
     {
       SamplesOK.push_back( fixedPoint );
       pixelIndex++;
-      this->m_NumberOfPixelsCounted++;
+    }
+
+  } // end first loop over image sample container
+
+  /** Compute the mean of the rows of this thread. */
+  vnl_vector< RealType > & mean = threadVariables.st_Mean;
+  mean.set_size( G );
+  mean.fill( NumericTraits< RealType >::Zero );
+  for( unsigned int i = 0; i < pixelIndex; ++i )
+  {
+    for( unsigned int j = 0; j < G; ++j )
+    {
+      mean[ j ] += datablock( i, j );
+    }
+  }
+  if( pixelIndex > 0 )
+  {
+    mean /= static_cast< RealType >( pixelIndex );
+  }
+
+  /** Compute the cross-products of the centered rows of this thread.
+   * Only the upper triangle is accumulated, the matrix is symmetric.
+   */
+  MatrixType & crossProducts = threadVariables.st_CrossProducts;
+  crossProducts.set_size( G, G );
+  crossProducts.fill( NumericTraits< RealType >::Zero );
+  vnl_vector< RealType > centered( G );
+  for( unsigned int i = 0; i < pixelIndex; ++i )
+  {
+    for( unsigned int j = 0; j < G; ++j )
+    {
+      centered[ j ] = datablock( i, j ) - mean[ j ];
+    }
+    for( unsigned int j = 0; j < G; ++j )
+    {
+      const RealType centered_j = centered[ j ];
+      for( unsigned int k = j; k < G; ++k )
+      {
+        crossProducts( j, k ) += centered_j * centered[ k ];
+      }
     }
   }
+  for( unsigned int j = 0; j < G; ++j )
+  {
+    for( unsigned int k = 0; k < j; ++k )
+    {
+      crossProducts( j, k ) = crossProducts( k, j );
+    }
+  }
+
+  /** Only update this variable at the end to prevent unnecessary "false sharing". */
+  threadVariables.st_NumberOfPixelsCounted = pixelIndex;
+
+} // end ThreadedGetSamples()
+
+
+/**
+ * ******************* AfterThreadedGetSamples *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::AfterThreadedGetSamples( MeasureType & value, const bool computeDerivativeTerms ) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+
+  /** Accumulate the number of pixels. */
+  this->m_NumberOfPixelsCounted = 0;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_NumberOfPixelsCounted += this->m_PCAMetric2GetSamplesPerThreadVariables[ i ].st_NumberOfPixelsCounted;
+  }
 
   /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   this->CheckNumberOfSamples( sampleContainer->Size(), this->m_NumberOfPixelsCounted );
-  unsigned int N = this->m_NumberOfPixelsCounted;
-
-  MatrixType A( datablock.extract( N, G ) );
+  const unsigned int N = this->m_NumberOfPixelsCounted;
 
-  /** Calculate mean of columns */
-  vnl_vector< RealType > mean( G );
-  mean.fill( NumericTraits< RealType >::Zero );
-  for( unsigned int i = 0; i < N; i++ )
+  /** Combine the means of the threads into the mean of all samples. */
+  this->m_Mean.set_size( G );
+  this->m_Mean.fill( NumericTraits< RealType >::Zero );
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
   {
-    for( unsigned int j = 0; j < G; j++ )
+    const SizeValueType n_i = this->m_PCAMetric2GetSamplesPerThreadVariables[ i ].st_NumberOfPixelsCounted;
+    if( n_i > 0 )
     {
-      mean( j ) += A( i, j );
+      this->m_Mean += this->m_PCAMetric2GetSamplesPerThreadVariables[ i ].st_Mean * static_cast< RealType >( n_i );
     }
   }
-  mean /= RealType( N );
+  this->m_Mean /= static_cast< RealType >( N );
 
-  /** Calculate standard deviation of columns */
-  MatrixType Amm( N, G );
-  Amm.fill( NumericTraits< RealType >::Zero );
-  for( unsigned int i = 0; i < N; i++ )
+  /** Combine the centered cross-products of the threads into the covariance
+   * matrix C, correcting for the difference between the thread means and the
+   * mean of all samples: ( N - 1 ) C = sum_i M_i + n_i ( m_i - m ) ( m_i - m )^T.
+   */
+  MatrixType             C( G, G, NumericTraits< RealType >::Zero );
+  vnl_vector< RealType > delta( G );
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
   {
-    for( unsigned int j = 0; j < G; j++ )
+    const SizeValueType n_i = this->m_PCAMetric2GetSamplesPerThreadVariables[ i ].st_NumberOfPixelsCounted;
+    if( n_i == 0 )
     {
-      Amm( i, j ) = A( i, j ) - mean( j );
+      continue;
     }
-  }
 
-  /** Compute covariance matrix C */
-  MatrixType Atmm = Amm.transpose();
-  MatrixType C( Atmm * Amm );
+    C    += this->m_PCAMetric2GetSamplesPerThreadVariables[ i ].st_CrossProducts;
+    delta = this->m_PCAMetric2GetSamplesPerThreadVariables[ i ].st_Mean - this->m_Mean;
+    for( unsigned int j = 0; j < G; ++j )
+    {
+      for( unsigned int k = 0; k < G; ++k )
+      {
+        C( j, k ) += static_cast< RealType >( n_i ) * delta[ j ] * delta[ k ];
+      }
+    }
+  }
   C /= static_cast< RealType >( RealType( N ) - 1.0 );
 
   vnl_diag_matrix< RealType > S( G );
@@ -521,35 +677,36 @@ PCAMetric2< TFixedImage, TMovingImage >
   /** Compute correlation matrix K */
   MatrixType K( S * C * S );
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem< RealType > eig( K );
+  /** Compute the eigenvalues and, if needed, the eigenvectors of K */
+  vnl_vector< RealType > eigenValues;
+  MatrixType             eigenVectors;
+  this->ComputeSymmetricEigenSystem( K, eigenValues, eigenVectors, computeDerivativeTerms );
 
+  /** The measure is the sum of the eigenvalues, weighted by their rank:
+   * the largest eigenvalue has weight 1, the smallest weight G.
+   */
   RealType sumWeightedEigenValues = itk::NumericTraits< RealType >::Zero;
   for( unsigned int i = 0; i < G; i++ )
   {
-    sumWeightedEigenValues += ( i + 1 ) * eig.get_eigenvalue( G - i - 1 );
+    sumWeightedEigenValues += ( i + 1 ) * eigenValues[ G - i - 1 ];
+  }
+  value = sumWeightedEigenValues;
+
+  if( !computeDerivativeTerms )
+  {
+    return;
   }
 
   MatrixType eigenVectorMatrix( G, G );
   for( unsigned int i = 0; i < G; i++ )
   {
-    eigenVectorMatrix.set_column( i, ( eig.get_eigenvector( G - i - 1 ) ).normalize() );
+    eigenVectorMatrix.set_column( i, ( eigenVectors.get_column( G - i - 1 ) ).normalize() );
   }
 
   MatrixType eigenVectorMatrixTranspose( eigenVectorMatrix.transpose() );
 
-  /** Create variables to store intermediate results in. */
-  TransformJacobianType                     jacobian;
-  DerivativeType                            dMTdmu;
-  DerivativeType                            imageJacobian( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  std::vector< NonZeroJacobianIndicesType > nzjis( G, NonZeroJacobianIndicesType() );
-
   /** Sub components of metric derivative */
   vnl_diag_matrix< DerivativeValueType > dSdmu_part1( G );
-
-  unsigned int startSamplesOK;
-  startSamplesOK = 0;
-
   for( unsigned int d = 0; d < G; d++ )
   {
     double S_sqr = S( d, d ) * S( d, d );
@@ -557,24 +714,147 @@ PCAMetric2< TFixedImage, TMovingImage >
     dSdmu_part1( d, d ) = -S_qub;
   }
 
-  DerivativeMatrixType vSAtmm( eigenVectorMatrixTranspose * S * Atmm );
   DerivativeMatrixType CSv( C * S * eigenVectorMatrix );
   DerivativeMatrixType Sv( S * eigenVectorMatrix );
   DerivativeMatrixType vdSdmu_part1( eigenVectorMatrixTranspose * dSdmu_part1 );
 
+  /** The derivative sums for every sample i, time point d and
+   * eigenvector z:
+   *   z * ( vSAtmm[ z ][ i ] * Sv[ d ][ z ] + vdSdmu_part1[ z ][ d ] * Atmm[ d ][ i ] * CSv[ d ][ z ] ),
+   * with vSAtmm = v^T S Atmm. Summing over z up front gives per sample the
+   * coefficient ( Q a + b .* a )[ d ], with a the centered sample,
+   * Q = Sv diag( z ) Sv^T and b[ d ] = sum_z z * vdSdmu_part1[ z ][ d ] * CSv[ d ][ z ].
+   */
+  DerivativeMatrixType SvWeighted( Sv );
+  for( unsigned int z = 0; z < G; z++ )
+  {
+    SvWeighted.scale_column( z, static_cast< DerivativeValueType >( z ) );
+  }
+  this->m_DerivativeCoefficientMatrix = SvWeighted * Sv.transpose();
+
+  this->m_DerivativeCoefficientDiagonal.set_size( G );
+  this->m_DerivativeCoefficientDiagonal.fill( NumericTraits< DerivativeValueType >::Zero );
+  for( unsigned int d = 0; d < G; d++ )
+  {
+    for( unsigned int z = 0; z < G; z++ )
+    {
+      this->m_DerivativeCoefficientDiagonal[ d ] += z * vdSdmu_part1[ z ][ d ] * CSv[ d ][ z ];
+    }
+  }
+
+} // end AfterThreadedGetSamples()
+
+
+/**
+ * **************** GetSamplesThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+PCAMetric2< TFixedImage, TMovingImage >
+::GetSamplesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  PCAMetric2MultiThreaderParameterType * temp
+    = static_cast< PCAMetric2MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedGetSamples( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GetSamplesThreaderCallback()
+
+
+/**
+ * *********************** LaunchGetSamplesThreaderCallback***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::LaunchGetSamplesThreaderCallback( void ) const
+{
+  /** Without multi-threading, process the parts of all threads here. */
+  if( !this->m_UseMultiThread )
+  {
+    for( ThreadIdType i = 0; i < Self::GetNumberOfWorkUnits(); ++i )
+    {
+      this->m_PCAMetric2ThreaderParameters.m_Metric->ThreadedGetSamples( i );
+    }
+    return;
+  }
+
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->GetSamplesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >(
+      &this->m_PCAMetric2ThreaderParameters ) ) );
+
+  /** Launch. */
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchGetSamplesThreaderCallback()
+
+
+/**
+ * ******************* ThreadedComputeDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::ThreadedComputeDerivative( ThreadIdType threadId )
+{
+  /** Get a handle to the pre-allocated derivative for the current thread.
+   * The initialization is performed at the beginning of each resolution in
+   * InitializeThreadingParameters(), and at the end of each iteration in
+   * the accumulate functions.
+   */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+
+  /** Get handles to the samples of this thread. */
+  const AlignedPCAMetric2GetSamplesPerThreadStruct & threadVariables
+    = this->m_PCAMetric2GetSamplesPerThreadVariables[ threadId ];
+  const MatrixType &                         datablock = threadVariables.st_DataBlock;
+  const std::vector< FixedImagePointType > & SamplesOK = threadVariables.st_ApprovedSamples;
+
+  /** Create variables to store intermediate results in. */
+  const NumberOfParametersType      nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType        nzji( nnzji );
+  DerivativeType                    imageJacobian( nnzji );
+  vnl_vector< DerivativeValueType > centered( G );
+  vnl_vector< DerivativeValueType > coefficients( G );
+
   /** Second loop over fixed image samples. */
-  for( pixelIndex = 0; pixelIndex < SamplesOK.size(); ++pixelIndex )
+  for( unsigned int pixelIndex = 0; pixelIndex < SamplesOK.size(); ++pixelIndex )
   {
+    /** Compute the derivative coefficient of every time point of this sample. */
+    for( unsigned int d = 0; d < G; ++d )
+    {
+      centered[ d ] = datablock( pixelIndex, d ) - this->m_Mean[ d ];
+    }
+    for( unsigned int d = 0; d < G; ++d )
+    {
+      DerivativeValueType coefficient = this->m_DerivativeCoefficientDiagonal[ d ] * centered[ d ];
+      for( unsigned int g = 0; g < G; ++g )
+      {
+        coefficient += this->m_DerivativeCoefficientMatrix( d, g ) * centered[ g ];
+      }
+      coefficients[ d ] = coefficient;
+    }
+
     /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = SamplesOK[ startSamplesOK ];
-    startSamplesOK++;
+    FixedImagePointType fixedPoint = SamplesOK[ pixelIndex ];
 
     /** Transform sampled point to voxel coordinates. */
     FixedImageContinuousIndexType voxelCoord;
     this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
 
-    const unsigned int G = lastDimPositions.size();
-
     for( unsigned int d = 0; d < G; ++d )
     {
       /** Initialize some variables. */
@@ -583,7 +863,7 @@ PCAMetric2< TFixedImage, TMovingImage >
       MovingImageDerivativeType movingImageDerivative;
 
       /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[ lastDim ] = lastDimPositions[ d ];
+      voxelCoord[ lastDim ] = d;
 
       /** Transform sampled point back to world coordinates. */
       this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
@@ -592,107 +872,121 @@ PCAMetric2< TFixedImage, TMovingImage >
       this->EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, &movingImageDerivative );
 
-      /** Get the TransformJacobian dT/dmu */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzjis[ d ] );
-
-      /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-
-      /** Store values. */
-      dMTdmu = imageJacobian;
+      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+        fixedPoint, movingImageDerivative, imageJacobian, nzji );
 
       /** build metric derivative components */
-      for( unsigned int p = 0; p < nzjis[ d ].size(); ++p )
+      const DerivativeValueType coefficient = coefficients[ d ];
+      for( unsigned int p = 0; p < nzji.size(); ++p )
       {
-        for( unsigned int z = 0; z < G; z++ )
-        {
-          derivative[ nzjis[ d ][ p ] ] += z * ( vSAtmm[ z ][ pixelIndex ] * dMTdmu[ p ] * Sv[ d ][ z ]
-            + vdSdmu_part1[ z ][ d ] * Atmm[ d ][ pixelIndex ] * dMTdmu[ p ] * CSv[ d ][ z ] );
-        } //end loop over eigenvalues
-
-      } //end loop over non-zero jacobian indices
+        derivative[ nzji[ p ] ] += coefficient * imageJacobian[ p ];
+      }
 
-    } //end loop over last dimension
+    } // end loop over t
 
   } // end second for loop over sample container
 
-  derivative *= ( 2.0 / ( DerivativeValueType( N ) - 1.0 ) ); //normalize
-  measure     = sumWeightedEigenValues;
+} // end ThreadedComputeDerivative()
 
-  /** Subtract mean from derivative elements. */
-  if( this->m_SubtractMean )
+
+/**
+ * ******************* AfterThreadedComputeDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::AfterThreadedComputeDerivative( DerivativeType & derivative ) const
+{
+  /** Accumulate and normalize the derivatives of all threads. */
+  derivative.SetSize( this->GetNumberOfParameters() );
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor
+    = ( DerivativeValueType( this->m_NumberOfPixelsCounted ) - 1.0 ) / 2.0;
+
+  if( this->m_UseMultiThread )
+  {
+    this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+  else
   {
-    if( !this->m_TransformIsStackTransform )
+    /** Accumulate in the same order as the threads do, and reset the
+     * per-thread derivatives for the next iteration.
+     */
+    const DerivativeValueType normalization
+      = 1.0 / this->m_ThreaderMetricParameters.st_NormalizationFactor;
+    derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    for( ThreadIdType i = 0; i < Self::GetNumberOfWorkUnits(); ++i )
     {
-      /** Update derivative per dimension.
-   * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
-   * per dimension xyz.
-   */
-      const unsigned int lastDimGridSize = this->m_GridSize[ lastDim ];
-      const unsigned int numParametersPerDimension
-        = this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
-      const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
-      DerivativeType     mean( numControlPointsPerDimension );
-      for( unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d )
-      {
-        /** Compute mean per dimension. */
-        mean.Fill( 0.0 );
-        const unsigned int starti = numParametersPerDimension * d;
-        for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          mean[ index ] += derivative[ i ];
-        }
-        mean /= static_cast< RealType >( lastDimGridSize );
-
-        /** Update derivative for every control point per dimension. */
-        for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          derivative[ i ] -= mean[ index ];
-        }
-      }
+      derivative += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative;
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Fill(
+        NumericTraits< DerivativeValueType >::ZeroValue() );
     }
-    else
-    {
-      /** Update derivative per dimension.
-   * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
-   * the number the time point index.
-   */
-      const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / G;
-      DerivativeType     mean( numParametersPerLastDimension );
-      mean.Fill( 0.0 );
+    derivative *= normalization;
+  }
 
-      /** Compute mean per control point. */
-      for( unsigned int t = 0; t < G; ++t )
-      {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
-        {
-          const unsigned int index = c % numParametersPerLastDimension;
-          mean[ index ] += derivative[ c ];
-        }
-      }
-      mean /= static_cast< RealType >( G );
+  /** Subtract mean from derivative elements. */
+  if( this->m_SubtractMean )
+  {
+    this->SubtractMeanFromDerivative( derivative );
+  }
 
-      /** Update derivative per control point. */
-      for( unsigned int t = 0; t < G; ++t )
-      {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
-        {
-          const unsigned int index = c % numParametersPerLastDimension;
-          derivative[ c ] -= mean[ index ];
-        }
-      }
+} // end AfterThreadedComputeDerivative()
+
+
+/**
+ * **************** ComputeDerivativeThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+PCAMetric2< TFixedImage, TMovingImage >
+::ComputeDerivativeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  PCAMetric2MultiThreaderParameterType * temp
+    = static_cast< PCAMetric2MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedComputeDerivative( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeDerivativeThreaderCallback()
+
+
+/**
+ * ************** LaunchComputeDerivativeThreaderCallback **********
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PCAMetric2< TFixedImage, TMovingImage >
+::LaunchComputeDerivativeThreaderCallback( void ) const
+{
+  /** Without multi-threading, process the parts of all threads here. */
+  if( !this->m_UseMultiThread )
+  {
+    for( ThreadIdType i = 0; i < Self::GetNumberOfWorkUnits(); ++i )
+    {
+      this->m_PCAMetric2ThreaderParameters.m_Metric->ThreadedComputeDerivative( i );
     }
+    return;
   }
 
-  /** Return the measure value. */
-  value = measure;
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->ComputeDerivativeThreaderCallback,
+    const_cast< void * >( static_cast< const void * >(
+      &this->m_PCAMetric2ThreaderParameters ) ) );
 
-} // end GetValueAndDerivative()
+  /** Launch. */
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchComputeDerivativeThreaderCallback()
 
 
 } // end namespace itk
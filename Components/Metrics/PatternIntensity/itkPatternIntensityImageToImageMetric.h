@@ -18,17 +18,15 @@
 #ifndef __itkPatternIntensityImageToImageMetric_h
 #define __itkPatternIntensityImageToImageMetric_h
 
-#include "itkAdvancedImageToImageMetric.h"
+#include "itkRayCastFiniteDifferenceImageToImageMetric.h"
 
 #include "itkPoint.h"
 #include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
 #include "itkMultiplyImageFilter.h"
 #include "itkSubtractImageFilter.h"
-#include "itkOptimizer.h"
 #include "itkRescaleIntensityImageFilter.h"
-#include "itkAdvancedCombinationTransform.h"
-#include "itkAdvancedRayCastInterpolateImageFunction.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -36,20 +34,22 @@ namespace itk
 /** \class PatternIntensityImageToImageMetric
  * \brief Computes similarity between two objects to be registered
  *
- *
+ * The derivative is computed by central finite differences, see
+ * RayCastFiniteDifferenceImageToImageMetric. When multi-threading is switched
+ * on, every thread also owns its own difference filters.
  *
  * \ingroup RegistrationMetrics
  */
 
 template< class TFixedImage, class TMovingImage >
 class PatternIntensityImageToImageMetric :
-  public AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+  public RayCastFiniteDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 {
 public:
 
   /** Standard class typedefs. */
   typedef PatternIntensityImageToImageMetric Self;
-  typedef AdvancedImageToImageMetric<
+  typedef RayCastFiniteDifferenceImageToImageMetric<
     TFixedImage, TMovingImage >                 Superclass;
   typedef SmartPointer< Self >       Pointer;
   typedef SmartPointer< const Self > ConstPointer;
@@ -107,24 +107,19 @@ public:
     Superclass::MovingImageLimiterOutputType MovingImageLimiterOutputType;
   typedef typename
     Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
-  typedef typename itk::Optimizer            OptimizerType;
-  typedef typename OptimizerType::ScalesType ScalesType;
+  typedef typename Superclass::ScalesType ScalesType;
 
   /** The fixed image dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int,
     FixedImageType::ImageDimension );
 
-  typedef itk::Image< FixedImagePixelType,
-    itkGetStaticConstMacro( FixedImageDimension ) >       TransformedMovingImageType;
-  typedef typename itk::AdvancedCombinationTransform<
-    ScalarType, FixedImageDimension >                      CombinationTransformType;
-  typedef typename CombinationTransformType::Pointer CombinationTransformPointer;
-  typedef typename itk::AdvancedRayCastInterpolateImageFunction<
-    MovingImageType, ScalarType >                         RayCastInterpolatorType;
-  typedef typename RayCastInterpolatorType::Pointer RayCastInterpolatorPointer;
-  typedef itk::ResampleImageFilter<
-    MovingImageType, TransformedMovingImageType >         TransformMovingImageFilterType;
-  typedef typename TransformMovingImageFilterType::Pointer TransformMovingImageFilterPointer;
+  typedef typename Superclass::TransformedMovingImageType        TransformedMovingImageType;
+  typedef typename Superclass::CombinationTransformType          CombinationTransformType;
+  typedef typename Superclass::CombinationTransformPointer       CombinationTransformPointer;
+  typedef typename Superclass::RayCastInterpolatorType           RayCastInterpolatorType;
+  typedef typename Superclass::RayCastInterpolatorPointer        RayCastInterpolatorPointer;
+  typedef typename Superclass::TransformMovingImageFilterType    TransformMovingImageFilterType;
+  typedef typename Superclass::TransformMovingImageFilterPointer TransformMovingImageFilterPointer;
   typedef itk::RescaleIntensityImageFilter<
     TransformedMovingImageType, TransformedMovingImageType > RescaleIntensityImageFilterType;
   typedef typename RescaleIntensityImageFilterType::Pointer RescaleIntensityImageFilterPointer;
@@ -147,14 +142,6 @@ public:
   /** Get the value for single valued optimizers. */
   MeasureType GetValue( const TransformParametersType & parameters ) const override;
 
-  /** Get the derivatives of the match measure. */
-  void GetDerivative( const TransformParametersType & parameters,
-    DerivativeType & derivative ) const override;
-
-  /** Get value and derivatives for multiple valued optimizers. */
-  void GetValueAndDerivative( const TransformParametersType & parameters,
-    MeasureType & Value, DerivativeType & Derivative ) const override;
-
   /** Initialize the Metric by making sure that all the components
    *  are present and plugged together correctly.
    * \li Call the superclass' implementation
@@ -162,10 +149,6 @@ public:
    */
   void Initialize( void ) override;
 
-  /** Set/Get Scales  */
-  itkSetMacro( Scales, ScalesType );
-  itkGetConstReferenceMacro( Scales, ScalesType );
-
   /** Set/Get m_NoiseConstant  */
   itkSetMacro( NoiseConstant, double );
   itkGetConstReferenceMacro( NoiseConstant, double );
@@ -180,31 +163,51 @@ protected:
   ~PatternIntensityImageToImageMetric() override {}
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** The filters that compute the difference image from the DRR of the
+   * perturbation pipeline of one thread.
+   */
+  struct PerturbationFiltersType
+  {
+    MultiplyImageFilterPointer   st_MultiplyImageFilter;
+    DifferenceImageFilterPointer st_DifferenceImageFilter;
+  };
+
   /** Compute the pattern intensity fixed image*/
   MeasureType ComputePIFixed( void ) const;
 
-  /** Compute the pattern intensity difference image. */
-  MeasureType ComputePIDiff( const TransformParametersType & parameters, float scalingfactor ) const;
+  /** Compute the pattern intensity difference image, given an up-to-date DRR. */
+  MeasureType ComputePIDiff( MultiplyImageFilterType * multiplyImageFilter,
+    DifferenceImageFilterType * differenceImageFilter, float scalingfactor ) const;
+
+  /** Compute the metric value, given an up-to-date DRR. */
+  MeasureType ComputeValue( MultiplyImageFilterType * multiplyImageFilter,
+    DifferenceImageFilterType * differenceImageFilter ) const;
+
+  /** Connect the difference filters to the perturbation pipelines. */
+  void InitializePerturbationPipelines( void ) override;
+
+  /** Compute the metric value from the DRR of the pipeline of a thread. */
+  MeasureType ComputePerturbedValue( const ThreadIdType threadId ) const override;
 
 private:
 
   PatternIntensityImageToImageMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );                     // purposely not implemented
 
-  TransformMovingImageFilterPointer  m_TransformMovingImageFilter;
   DifferenceImageFilterPointer       m_DifferenceImageFilter;
   RescaleIntensityImageFilterPointer m_RescaleImageFilter;
   MultiplyImageFilterPointer         m_MultiplyImageFilter;
   double                             m_NoiseConstant;
   unsigned int                       m_NeighborhoodRadius;
-  double                             m_DerivativeDelta;
   double                             m_NormalizationFactor;
   double                             m_Rescalingfactor;
   bool                               m_OptimizeNormalizationFactor;
-  ScalesType                         m_Scales;
   MeasureType                        m_FixedMeasure;
   CombinationTransformPointer        m_CombinationTransform;
 
+  /** The difference filters of the perturbation pipelines, one per thread. */
+  std::vector< PerturbationFiltersType > m_PerturbationFilters;
+
 };
 
 } // end namespace itk
@@ -41,12 +41,10 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 {
   this->m_NormalizationFactor         = 1.0;
   this->m_Rescalingfactor             = 1.0;
-  this->m_DerivativeDelta             = 0.001;
   this->m_NoiseConstant               = 10000; // = sigma * sigma = 100*100 if not specified
   this->m_NeighborhoodRadius          = 3;
   this->m_FixedMeasure                = 0;
   this->m_OptimizeNormalizationFactor = false;
-  this->m_TransformMovingImageFilter  = TransformMovingImageFilterType::New();
   this->m_CombinationTransform        = CombinationTransformType::New();
   this->m_RescaleImageFilter          = RescaleIntensityImageFilterType::New();
   this->m_DifferenceImageFilter       = DifferenceImageFilterType::New();
@@ -64,35 +62,9 @@ void
 PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 ::Initialize( void )
 {
+  /** Initialize the base class, which sets up the DRR generation. */
   Superclass::Initialize();
 
-  /** Resampling for 3D->2D */
-  RayCastInterpolatorType * rayCaster = dynamic_cast< RayCastInterpolatorType * >(
-    const_cast< InterpolatorType * >( this->GetInterpolator() ) );
-  if( rayCaster != 0 )
-  {
-    this->m_TransformMovingImageFilter->SetTransform( rayCaster->GetTransform() );
-  }
-  else
-  {
-    itkExceptionMacro( << "ERROR: the NormalizedGradientCorrelationImageToImageMetric is currently "
-                       << "only suitable for 2D-3D registration.\n"
-                       << "  Therefore it expects an interpolator of type RayCastInterpolator." );
-  }
-  this->m_TransformMovingImageFilter->SetInterpolator( this->m_Interpolator );
-  this->m_TransformMovingImageFilter->SetInput( this->m_MovingImage );
-  this->m_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
-
-  this->m_TransformMovingImageFilter->SetSize(
-    this->m_FixedImage->GetLargestPossibleRegion().GetSize() );
-  this->m_TransformMovingImageFilter->SetOutputOrigin(
-    this->m_FixedImage->GetOrigin() );
-  this->m_TransformMovingImageFilter->SetOutputSpacing(
-    this->m_FixedImage->GetSpacing() );
-  this->m_TransformMovingImageFilter->SetOutputDirection(
-    this->m_FixedImage->GetDirection() );
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
-
   //this->InitializeLimiters();
 
   this->m_NormalizationFactor = this->m_FixedImageTrueMax / this->m_MovingImageTrueMax;
@@ -113,9 +85,49 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
     this->m_Rescalingfactor *= 10;
   }
 
+  /** Prepare the concurrent evaluation of the finite differences. */
+  this->InitializePerturbationPipelines();
+
 } // end Initialize()
 
 
+/**
+ * ********************* InitializePerturbationPipelines ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::InitializePerturbationPipelines( void )
+{
+  Superclass::InitializePerturbationPipelines();
+
+  /** Share the fixed image buffer with the pipelines, but not the pipeline
+   * that produced the fixed image, since it may not be updated concurrently.
+   */
+  typename FixedImageType::Pointer fixedImage = FixedImageType::New();
+  fixedImage->Graft( this->m_FixedImage );
+
+  this->m_PerturbationFilters.resize( this->m_PerturbationPipelines.size() );
+  for( std::size_t i = 0; i < this->m_PerturbationPipelines.size(); ++i )
+  {
+    PerturbationFiltersType & filters = this->m_PerturbationFilters[ i ];
+
+    filters.st_MultiplyImageFilter = MultiplyImageFilterType::New();
+    filters.st_MultiplyImageFilter->SetNumberOfWorkUnits( 1 );
+    filters.st_MultiplyImageFilter->SetInput(
+      this->m_PerturbationPipelines[ i ].st_TransformMovingImageFilter->GetOutput() );
+    filters.st_MultiplyImageFilter->SetConstant( this->m_NormalizationFactor );
+
+    filters.st_DifferenceImageFilter = DifferenceImageFilterType::New();
+    filters.st_DifferenceImageFilter->SetNumberOfWorkUnits( 1 );
+    filters.st_DifferenceImageFilter->SetInput1( fixedImage );
+    filters.st_DifferenceImageFilter->SetInput2( filters.st_MultiplyImageFilter->GetOutput() );
+  }
+
+} // end InitializePerturbationPipelines()
+
+
 /**
  * ********************* PrintSelf ******************************
  */
@@ -126,7 +138,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 ::PrintSelf( std::ostream & os, Indent indent ) const
 {
   Superclass::PrintSelf( os, indent );
-  os << indent << "DerivativeDelta: " << this->m_DerivativeDelta << std::endl;
+  os << indent << "NoiseConstant: " << this->m_NoiseConstant << std::endl;
 
 } // end PrintSelf()
 
@@ -149,7 +161,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   typename FixedImageType::SizeType neighborIterationSize;
   typename FixedImageType::PointType point;
 
-  iterationSize.Fill( 1 ); neighborIterationSize.Fill( 1 ); iterationStartIndex.Fill( 0 );
+  neighborIterationSize.Fill( 1 ); iterationStartIndex.Fill( 0 );
   for( unsigned int i = 0; i < 2; ++i ) // Only 2D
   {
     iterationSize[ i ]        -= static_cast< int >( 2 * this->m_NeighborhoodRadius );
@@ -231,27 +243,11 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 template< class TFixedImage, class TMovingImage >
 typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
 PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
-::ComputePIDiff( const TransformParametersType & parameters, float scalingfactor ) const
+::ComputePIDiff( MultiplyImageFilterType * multiplyImageFilter,
+  DifferenceImageFilterType * differenceImageFilter, float scalingfactor ) const
 {
-  /** Call non-thread-safe stuff, such as:
-   *   this->SetTransformParameters( parameters );
-   *   this->GetImageSampler()->Update();
-   * Because of these calls GetValueAndDerivative itself is not thread-safe,
-   * so cannot be called multiple times simultaneously.
-   * This is however needed in the CombinationImageToImageMetric.
-   * In that case, you need to:
-   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
-   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
-   *   calling GetValueAndDerivative
-   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
-   * - Now you can call GetValueAndDerivative multi-threaded.
-   */
-  this->BeforeThreadedGetValueAndDerivative( parameters );
-  //this->SetTransformParameters( parameters );
-
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_MultiplyImageFilter->SetConstant( scalingfactor );
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
+  multiplyImageFilter->SetConstant( scalingfactor );
+  differenceImageFilter->UpdateLargestPossibleRegion();
   MeasureType measure = NumericTraits< MeasureType >::Zero;
   MeasureType diff    = NumericTraits< MeasureType >::Zero;
 
@@ -261,7 +257,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   typename FixedImageType::SizeType neighborIterationSize;
   typename FixedImageType::PointType point;
 
-  iterationSize.Fill( 1 ); neighborIterationSize.Fill( 1 ); iterationStartIndex.Fill( 0 );
+  neighborIterationSize.Fill( 1 ); iterationStartIndex.Fill( 0 );
   for( unsigned int i = 0; i < 2; ++i ) // Only 2D
   {
     iterationSize[ i ]        -= static_cast< int >( 2 * this->m_NeighborhoodRadius );
@@ -276,7 +272,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   typedef itk::ImageRegionConstIteratorWithIndex< TransformedMovingImageType >
     DifferenceImageIteratorType;
   DifferenceImageIteratorType differenceImageIt(
-  this->m_DifferenceImageFilter->GetOutput(), iterationRegion );
+  differenceImageFilter->GetOutput(), iterationRegion );
   differenceImageIt.GoToBegin();
 
   neighboriterationRegion.SetSize( neighborIterationSize );
@@ -317,7 +313,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 
       neighboriterationRegion.SetIndex( neighborIndex );
       DifferenceImageIteratorType neighborIt(
-      this->m_DifferenceImageFilter->GetOutput(), neighboriterationRegion );
+      differenceImageFilter->GetOutput(), neighboriterationRegion );
       neighborIt.GoToBegin();
 
       while( !neighborIt.IsAtEnd() )
@@ -362,8 +358,23 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   this->BeforeThreadedGetValueAndDerivative( parameters );
   //this->SetTransformParameters( parameters );
 
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
+  this->UpdateMovedImage( parameters );
+
+  return this->ComputeValue( this->m_MultiplyImageFilter, this->m_DifferenceImageFilter );
+
+} // end GetValue()
+
+
+/**
+ * ********************* ComputeValue ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValue( MultiplyImageFilterType * multiplyImageFilter,
+  DifferenceImageFilterType * differenceImageFilter ) const
+{
   MeasureType measure        = 1e10;
   MeasureType currentMeasure = 1e10;
 
@@ -376,7 +387,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 
     while( tmpfactor <=  this->m_NormalizationFactor * 1.0 )
     {
-      measure    = this->ComputePIDiff( parameters, tmpfactor );
+      measure    = this->ComputePIDiff( multiplyImageFilter, differenceImageFilter, tmpfactor );
       tmpMeasure = ( measure - this->m_FixedMeasure ) / -this->m_Rescalingfactor;
 
       if( tmpMeasure < currentMeasure )
@@ -390,57 +401,29 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   }
   else
   {
-    measure        = this->ComputePIDiff( parameters, this->m_NormalizationFactor );
+    measure        = this->ComputePIDiff( multiplyImageFilter, differenceImageFilter, this->m_NormalizationFactor );
     currentMeasure = -( measure - this->m_FixedMeasure ) / this->m_Rescalingfactor;
   }
 
   return currentMeasure;
 
-} // end GetValue()
+} // end ComputeValue()
 
 
 /**
- * ********************* GetDerivative ******************************
+ * ********************* ComputePerturbedValue ******************************
  */
 
 template< class TFixedImage, class TMovingImage >
-void
+typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
 PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
-::GetDerivative( const TransformParametersType & parameters,
-  DerivativeType & derivative ) const
+::ComputePerturbedValue( const ThreadIdType threadId ) const
 {
-  TransformParametersType testPoint;
-  testPoint = parameters;
-  const unsigned int numberOfParameters = this->GetNumberOfParameters();
-  derivative = DerivativeType( numberOfParameters );
-
-  for( unsigned int i = 0; i < numberOfParameters; i++ )
-  {
-    testPoint[ i ] -= this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
-    const MeasureType valuep0 = this->GetValue( testPoint );
-    testPoint[ i ] += 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
-    const MeasureType valuep1 = this->GetValue( testPoint );
-    derivative[ i ] = ( valuep1 - valuep0 ) / ( 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] ) );
-    testPoint[ i ]  = parameters[ i ];
-  }
-
-} // end GetDerivative()
+  const PerturbationFiltersType & filters = this->m_PerturbationFilters[ threadId ];
 
+  return this->ComputeValue( filters.st_MultiplyImageFilter, filters.st_DifferenceImageFilter );
 
-/**
- * ********************* GetValueAndDerivative ******************************
- */
-
-template< class TFixedImage, class TMovingImage >
-void
-PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
-::GetValueAndDerivative( const TransformParametersType & parameters,
-  MeasureType & Value, DerivativeType & derivative ) const
-{
-  Value = this->GetValue( parameters );
-  this->GetDerivative( parameters, derivative );
-
-} // end GetValueAndDerivative()
+} // end ComputePerturbedValue()
 
 
 } // end namespace itk
@@ -49,6 +49,10 @@ namespace itk
  * application to organ segmentation in cervical MR, Comput. Vis. Image Understand. (2013),
  * http://dx.doi.org/10.1016/j.cviu.2012.12.006
  *
+ * The points are transformed with multiple threads. The derivative is computed by
+ * propagating the derivative with respect to the shape vector back to the points,
+ * so that each point only needs its sparse transform Jacobian.
+ *
  * \ingroup RegistrationMetrics
  */
 
@@ -96,10 +100,7 @@ public:
   typedef typename OutputPointType::CoordRepType CoordRepType;
   typedef vnl_vector< CoordRepType >             VnlVectorType;
   typedef vnl_matrix< CoordRepType >             VnlMatrixType;
-  //typedef itk::Array<VnlVectorType *> ProposalDerivativeType;
-  typedef typename std::vector< VnlVectorType * > ProposalDerivativeType;
-  //typedef typename vnl_vector<VnlVectorType *> ProposalDerivativeType; //Cannot be linked
-  typedef vnl_svd_economy< CoordRepType > PCACovarianceType;
+  typedef vnl_svd_economy< CoordRepType >        PCACovarianceType;
 
   /** Initialization. */
   void Initialize( void ) override;
@@ -178,6 +179,12 @@ protected:
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Copy the transformed points of thread threadID in the proposal vector. */
+  void ThreadedGetValue( ThreadIdType threadID ) const override;
+
+  /** Sum the derivative contributions of the points of thread threadID. */
+  void ThreadedGetValueAndDerivative( ThreadIdType threadID ) const override;
+
 private:
 
   StatisticalShapePointPenalty( const Self & );  // purposely not implemented
@@ -186,20 +193,18 @@ private:
   void FillProposalVector( const OutputPointType & fixedPoint,
     const unsigned int vertexindex ) const;
 
-  void FillProposalDerivative( const OutputPointType & fixedPoint,
-    const unsigned int vertexindex ) const;
-
   void UpdateCentroidAndAlignProposalVector(
     const unsigned int shapeLength ) const;
 
-  void UpdateCentroidAndAlignProposalDerivative(
-    const unsigned int shapeLength ) const;
-
   void UpdateL2( const unsigned int shapeLength ) const;
 
   void NormalizeProposalVector( const unsigned int shapeLength ) const;
 
-  void UpdateL2AndNormalizeProposalDerivative( const unsigned int shapeLength ) const;
+  /** Propagate a gradient with respect to the normalized proposal vector
+   * back to the point positions, and store it in m_PointGradient.
+   */
+  void BackPropagateNormalization( const VnlVectorType & proposalGradient,
+    const unsigned int shapeLength ) const;
 
   void CalculateValue( MeasureType & value, VnlVectorType & differenceVector,
     VnlVectorType & centerrotated, VnlVectorType & eigrot ) const;
@@ -235,16 +240,17 @@ private:
   bool m_VariancesNeedsUpdate;
 
   VnlVectorType * m_EigenValuesRegularized;
-
-  mutable ProposalDerivativeType * m_ProposalDerivative;
-  unsigned int                     m_ProposalLength;
-  bool                             m_NormalizedShapeModel;
-  int                              m_ShapeModelCalculation;
-  double                           m_ShrinkageIntensity;
-  double                           m_BaseVariance;
-  double                           m_BaseStd;
-  mutable VnlVectorType            m_ProposalVector;
-  mutable VnlVectorType            m_MeanValues;
+  VnlMatrixType   m_EigenVectorsTransposed;
+
+  unsigned int          m_ProposalLength;
+  bool                  m_NormalizedShapeModel;
+  int                   m_ShapeModelCalculation;
+  double                m_ShrinkageIntensity;
+  double                m_BaseVariance;
+  double                m_BaseStd;
+  mutable VnlVectorType m_ProposalVector;
+  mutable VnlVectorType m_MeanValues;
+  mutable VnlVectorType m_PointGradient;
 
   double m_CutOffValue;
   double m_CutOffSharpness;
@@ -35,7 +35,6 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   this->m_EigenVectors            = nullptr;
   this->m_EigenValues             = nullptr;
   this->m_EigenValuesRegularized  = nullptr;
-  this->m_ProposalDerivative      = nullptr;
   this->m_InverseCovarianceMatrix = nullptr;
 
   this->m_ShrinkageIntensityNeedsUpdate = true;
@@ -78,11 +77,6 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
     delete this->m_EigenValuesRegularized;
     this->m_EigenValuesRegularized = nullptr;
   }
-  if( this->m_ProposalDerivative != nullptr )
-  {
-    delete this->m_ProposalDerivative;
-    this->m_ProposalDerivative = nullptr;
-  }
   if( this->m_InverseCovarianceMatrix != nullptr )
   {
     delete this->m_InverseCovarianceMatrix;
@@ -344,6 +338,18 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
       this->m_EigenValuesRegularized  = nullptr;
   }
 
+  /** The projection of a shape on the eigenvectors is computed in every
+   * evaluation. With V^T stored row by row, it is a product with contiguous rows.
+   */
+  if( this->m_ShapeModelCalculation == 1 || this->m_ShapeModelCalculation == 2 )
+  {
+    this->m_EigenVectorsTransposed = this->m_EigenVectors->transpose();
+  }
+  else
+  {
+    this->m_EigenVectorsTransposed.clear();
+  }
+
 } // end Initialize()
 
 
@@ -364,12 +370,8 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   }
 
   /** Initialize some variables */
-  //this->m_NumberOfPointsCounted = 0;
   MeasureType value = NumericTraits< MeasureType >::Zero;
 
-  //InputPointType movingPoint;
-  OutputPointType fixedPoint;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
@@ -378,24 +380,10 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   this->m_ProposalVector.set_size( this->m_ProposalLength );
 
   /** Part 1:
-   * - Copy point positions in proposal vector
+   * - Copy point positions in proposal vector, multi-threaded
    */
-
-  /** Create iterators. */
-  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointEnd     = fixedPointSet->GetPoints()->End();
-
-  unsigned int vertexindex = 0;
-  /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
-  {
-    fixedPoint = pointItFixed.Value();
-    this->FillProposalVector( fixedPoint, vertexindex );
-
-    this->m_NumberOfPointsCounted++;
-    ++pointItFixed;
-    vertexindex += Self::FixedPointSetDimension;
-  } // end loop over all corresponding points
+  this->LaunchGetValueThreaderCallback();
+  this->m_NumberOfPointsCounted = fixedPointSet->GetNumberOfPoints();
 
   if( this->m_NormalizedShapeModel )
   {
@@ -465,44 +453,21 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   }
 
   /** Initialize some variables */
-  //this->m_NumberOfPointsCounted = 0;
   value      = NumericTraits< MeasureType >::Zero;
   derivative = DerivativeType( this->GetNumberOfParameters() );
-  derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
-
-  //InputPointType movingPoint;
-  OutputPointType fixedPoint;
 
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
   const unsigned int shapeLength = Self::FixedPointSetDimension
     * fixedPointSet->GetNumberOfPoints();
-
   this->m_ProposalVector.set_size( this->m_ProposalLength );
-  this->m_ProposalDerivative = new ProposalDerivativeType( this->GetNumberOfParameters(), nullptr );
 
   /** Part 1:
-   * - Copy point positions in proposal vector
-   * - Copy point derivatives in proposal derivative vector
+   * - Copy point positions in proposal vector, multi-threaded
    */
-
-  /** Create iterators. */
-  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointEnd     = fixedPointSet->GetPoints()->End();
-
-  unsigned int vertexindex = 0;
-  /** Loop over the corresponding points. */
-  while( pointItFixed != pointEnd )
-  {
-    fixedPoint = pointItFixed.Value();
-    this->FillProposalVector( fixedPoint, vertexindex );
-    this->FillProposalDerivative( fixedPoint, vertexindex );
-
-    this->m_NumberOfPointsCounted++;
-    ++pointItFixed;
-    vertexindex += Self::FixedPointSetDimension;
-  } // end loop over all corresponding points
+  this->LaunchGetValueThreaderCallback();
+  this->m_NumberOfPointsCounted = fixedPointSet->GetNumberOfPoints();
 
   if( this->m_NormalizedShapeModel )
   {
@@ -510,23 +475,15 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
      * - Calculate shape centroid
      * - put centroid values in proposal
      * - update proposal vector with aligned shape
-     * - Calculate centroid derivatives and update proposal derivative vectors
-     * - put centroid derivatives values in proposal derivatives
-     * - update proposal derivatives
      */
     this->UpdateCentroidAndAlignProposalVector( shapeLength );
-    this->UpdateCentroidAndAlignProposalDerivative( shapeLength );
 
     /** Part 3:
      * - Calculate l2-norm from aligned shapes
      * - put l2-norm value in proposal vector
      * - update proposal vector with size normalized shape
-     * - Calculate l2-norm derivatice from updated proposal vector
-     * - put l2-norm derivative value in proposal derivative vectors
-     * - update proposal derivatives
      */
     this->UpdateL2( shapeLength );
-    this->UpdateL2AndNormalizeProposalDerivative( shapeLength );
     this->NormalizeProposalVector( shapeLength );
 
   } // end if(m_NormalizedShapeModel)
@@ -538,24 +495,18 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
 
   this->CalculateValue( value, differenceVector, centerrotated, eigrot );
 
+  /** Part 4:
+   * - Calculate the derivative, from the derivative of the value
+   *   with respect to the point positions, multi-threaded
+   */
   if( value != 0.0 )
   {
     this->CalculateDerivative( derivative, value, differenceVector, centerrotated, eigrot, shapeLength );
   }
   else
   {
-    typename ProposalDerivativeType::iterator proposalDerivativeIt  = this->m_ProposalDerivative->begin();
-    typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
-    for(; proposalDerivativeIt != proposalDerivativeEnd; ++proposalDerivativeIt )
-    {
-      if( *proposalDerivativeIt != nullptr )
-      {
-        delete ( *proposalDerivativeIt );
-      }
-    }
+    derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
   }
-  delete this->m_ProposalDerivative;
-  this->m_ProposalDerivative = nullptr;
 
   this->CalculateCutOffValue( value );
 
@@ -585,53 +536,73 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
 
 
 /**
- * ******************* FillProposalDerivative *******************
+ * ******************* ThreadedGetValue *******************
  */
 
 template< class TFixedPointSet, class TMovingPointSet >
 void
 StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::FillProposalDerivative( const OutputPointType & fixedPoint,
-  const unsigned int vertexindex ) const
+::ThreadedGetValue( ThreadIdType threadID ) const
 {
-  /**
-   * A (column) vector is constructed for each mu, only if that mu affects the shape penalty.
-   * I.e. if there is at least one point of the mesh with non-zero derivatives,
-   * a full column vector is instantiated (which can contain zeros for many other points)
-   *
-   * m_ProposalDerivative is a container with either full shape-vector-sized derivative vectors or NULL-s. Example:
-   *
-   * mu1: [ [ dx1/dmu1 , dy1/dmu1 , dz1/dmu1 ] , [ 0 , 0 , 0 ] , [ dx3/dmu1 , dy3/dmu1 , dz3/dmu1 ] , [...] ]^T
-   * mu2: Null
-   * mu3: [ [ 0 , 0 , 0 ] , [ dx2/dmu3 , dy2/dmu3 , dz2/dmu3 ] , [ dx3/dmu3 , dy3/dmu3 , dz3/dmu3 ] , [...] ]^T
-   *
-   */
+  /** The points of this thread. */
+  unsigned long pointBegin = 0;
+  unsigned long pointEnd   = 0;
+  this->GetThreadPointRange( threadID, pointBegin, pointEnd );
+
+  const typename FixedPointSetType::PointsContainer * fixedPoints
+    = this->GetFixedPointSet()->GetPoints();
+
+  /** Each thread fills its own part of the proposal vector. */
+  for( unsigned long p = pointBegin; p < pointEnd; ++p )
+  {
+    this->FillProposalVector( fixedPoints->ElementAt( p ), p * Self::FixedPointSetDimension );
+  }
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
 
+template< class TFixedPointSet, class TMovingPointSet >
+void
+StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
+::ThreadedGetValueAndDerivative( ThreadIdType threadID ) const
+{
+  /** The points of this thread. */
+  unsigned long pointBegin = 0;
+  unsigned long pointEnd   = 0;
+  this->GetThreadPointRange( threadID, pointBegin, pointEnd );
+
+  const typename FixedPointSetType::PointsContainer * fixedPoints
+    = this->GetFixedPointSet()->GetPoints();
+
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadID ].st_Derivative;
   NonZeroJacobianIndicesType nzji(
   this->m_Transform->GetNumberOfNonZeroJacobianIndices() );
-
-  /** Get the TransformJacobian dT/dmu. */
   TransformJacobianType jacobian;
-  this->m_Transform->GetJacobian( fixedPoint, jacobian, nzji );
 
-  for( unsigned int i = 0; i < nzji.size(); ++i )
+  /** Each point contributes (dx/dmu)^T * dvalue/dx to the derivative. */
+  for( unsigned long p = pointBegin; p < pointEnd; ++p )
   {
-    const unsigned int mu = nzji[ i ];
-    if( ( *this->m_ProposalDerivative )[ mu ] == nullptr )
-    {
-      /** Create the big column vector if it does not yet exist for this mu*/
-      ( *this->m_ProposalDerivative )[ mu ] = new VnlVectorType( this->m_ProposalLength, 0.0 );
-      // memory will be freed in CalculateDerivative()
-    }
+    /** Get the TransformJacobian dT/dmu. */
+    this->m_Transform->GetJacobian( fixedPoints->ElementAt( p ), jacobian, nzji );
 
-    /** The column vector exists for this mu, so copy the jacobians for this point into the big vector. */
-    for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+    const CoordRepType * pointGradient
+      = this->m_PointGradient.data_block() + p * Self::FixedPointSetDimension;
+    for( unsigned int i = 0; i < nzji.size(); ++i )
     {
-      ( *( *this->m_ProposalDerivative )[ mu ] )[ vertexindex + d ] = jacobian.get_column( i )[ d ];
+      DerivativeValueType sum = NumericTraits< DerivativeValueType >::ZeroValue();
+      for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+      {
+        sum += jacobian( d, i ) * pointGradient[ d ];
+      }
+      derivative[ nzji[ i ] ] += sum;
     }
   }
 
-} // end FillProposalVector()
+} // end ThreadedGetValueAndDerivative()
 
 
 /**
@@ -670,44 +641,6 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
 } // end UpdateCentroidAndAlignProposalVector()
 
 
-/**
- * ******************* UpdateCentroidAndAlignProposalDerivative *******************
- */
-
-template< class TFixedPointSet, class TMovingPointSet >
-void
-StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::UpdateCentroidAndAlignProposalDerivative( const unsigned int shapeLength ) const
-{
-  typename ProposalDerivativeType::iterator proposalDerivativeIt  = m_ProposalDerivative->begin();
-  typename ProposalDerivativeType::iterator proposalDerivativeEnd = m_ProposalDerivative->end();
-  while( proposalDerivativeIt != proposalDerivativeEnd )
-  {
-    if( *proposalDerivativeIt != nullptr )
-    {
-      for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
-      {
-        double & centroid_dDerivative = ( **proposalDerivativeIt )[ shapeLength + d ];
-        centroid_dDerivative = 0; // initialize accumulators to zero
-
-        for( unsigned int index = 0; index < shapeLength; index += Self::FixedPointSetDimension )
-        {
-          centroid_dDerivative += ( **proposalDerivativeIt )[ index + d ]; // sum all x derivatives
-        }
-
-        centroid_dDerivative /= this->GetFixedPointSet()->GetNumberOfPoints(); // divide sum to get average
-
-        for( unsigned int index = 0; index < shapeLength; index += Self::FixedPointSetDimension )
-        {
-          ( **proposalDerivativeIt )[ index + d ] -= centroid_dDerivative; // subtract average
-        }
-      }
-    }
-    ++proposalDerivativeIt;
-  }
-} // end UpdateCentroidAndAlignProposalDerivative()
-
-
 /**
  * ******************* UpdateL2 *******************
  */
@@ -752,47 +685,6 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
 } // end NormalizeProposalVector()
 
 
-/**
- * ******************* UpdateL2AndNormalizeProposalDerivative *******************
- */
-
-template< class TFixedPointSet, class TMovingPointSet >
-void
-StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
-::UpdateL2AndNormalizeProposalDerivative( const unsigned int shapeLength ) const
-{
-  double & l2norm = this->m_ProposalVector[ shapeLength + Self::FixedPointSetDimension ];
-
-  typename ProposalDerivativeType::iterator proposalDerivativeIt  = this->m_ProposalDerivative->begin();
-  typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
-
-  while( proposalDerivativeIt != proposalDerivativeEnd )
-  {
-    if( *proposalDerivativeIt != nullptr )
-    {
-      double & l2normDerivative = ( **proposalDerivativeIt )[ shapeLength + Self::FixedPointSetDimension ];
-      l2normDerivative = 0; // initialize to zero
-      // loop over all shape coordinates of the aligned shape
-      for( unsigned int index = 0; index < shapeLength; index++ )
-      {
-        l2normDerivative += this->m_ProposalVector[ index ] * ( **proposalDerivativeIt )[ index ];
-      }
-      l2normDerivative /= ( l2norm * sqrt( (double)( this->GetFixedPointSet()->GetNumberOfPoints() ) ) );
-
-      // loop over all shape coordinates of the aligned shape
-      for( unsigned int index = 0; index < shapeLength; index++ )
-      {
-        // update normalized shape derivatives
-        ( **proposalDerivativeIt )[ index ] = ( **proposalDerivativeIt )[ index ]
-          / l2norm - this->m_ProposalVector[ index ] * l2normDerivative / ( l2norm * l2norm );
-      }
-    }
-    ++proposalDerivativeIt;
-  }
-
-} //end UpdateL2AndNormalizeProposalDerivative()
-
-
 /**
  * ******************* CalculateValue *******************
  */
@@ -811,12 +703,14 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   {
     case 0: // full covariance
     {
-      value = sqrt( bracket( differenceVector, *this->m_InverseCovarianceMatrix, differenceVector ) );
+      /** eigrot = Sigma^-1 * diff, which is reused by CalculateDerivative(). */
+      eigrot = ( *this->m_InverseCovarianceMatrix ) * differenceVector;
+      value  = sqrt( dot_product( differenceVector, eigrot ) );
       break;
     }
     case 1: // decomposed covariance (uniform regularization)
     {
-      centerrotated = differenceVector * ( *m_EigenVectors );                       /** diff^T * V */
+      centerrotated = this->m_EigenVectorsTransposed * differenceVector;            /** diff^T * V */
       eigrot        = element_quotient( centerrotated, *m_EigenValuesRegularized ); /** diff^T * V * Lambda^-1 */
       if( this->m_ShrinkageIntensity != 0 )
       {
@@ -845,7 +739,7 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
       differenceVector[ shapeLength + 2 ] /= this->m_CentroidZStd;
       differenceVector[ shapeLength + 3 ] /= this->m_SizeStd;
 
-      centerrotated = differenceVector * ( *this->m_EigenVectors );                       /** diff^T * V */
+      centerrotated = this->m_EigenVectorsTransposed * differenceVector;                  /** diff^T * V */
       eigrot        = element_quotient( centerrotated, *this->m_EigenValuesRegularized ); /** diff^T * V * Lambda^-1 */
       if( this->m_ShrinkageIntensity != 0 )
       {
@@ -882,90 +776,146 @@ StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
   const VnlVectorType & eigrot,
   const unsigned int shapeLength ) const
 {
-  typename ProposalDerivativeType::iterator proposalDerivativeIt  = this->m_ProposalDerivative->begin();
-  typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
-
-  typename DerivativeType::iterator derivativeIt = derivative.begin();
-
-  for(; proposalDerivativeIt != proposalDerivativeEnd; ++proposalDerivativeIt, ++derivativeIt )
+  /** Instead of computing d/dmu(diff) for each mu, and multiplying it with the
+   * (inverse) covariance model, value * d(value)/d(proposal) is computed once,
+   * and propagated back to the point positions. The derivative then only requires the sparse Jacobian of each
+   * point, and no products with the eigenvectors per mu.
+   */
+  VnlVectorType proposalGradient;
+  switch( this->m_ShapeModelCalculation )
   {
-    if( *proposalDerivativeIt != nullptr )
+    case 0: // full covariance
     {
-      switch( this->m_ShapeModelCalculation )
+      /** Sigma^-1 * diff, computed by CalculateValue(). */
+      proposalGradient = eigrot;
+      break;
+    }
+    case 1: // decomposed covariance (uniform regularization)
+    {
+      /** V * Lambda^-1 * V^T * diff + 1/(Beta*sigma_0^2) * diff */
+      proposalGradient = ( *this->m_EigenVectors ) * eigrot;
+      if( this->m_ShrinkageIntensity != 0 )
       {
-        case 0: // full covariance
-        {
-          /**innerproduct diff^T * Sigma^-1 * d/dmu (diff), where iterated over mu-s*/
-          *derivativeIt = bracket( differenceVector, *m_InverseCovarianceMatrix, ( **proposalDerivativeIt ) ) / value;
-          this->CalculateCutOffDerivative( *derivativeIt, value );
-          break;
-        }
-        case 1: // decomposed covariance (uniform regularization)
-        {
-          if( this->m_ShrinkageIntensity != 0 )
-          {
-            /** Innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu(diff)
-             * + 1/(Beta*sigma_0^2)*diff^T* d/dmu(diff), where iterated over mu-s
-             */
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose() * ( **proposalDerivativeIt ) )
-              + dot_product( differenceVector, **proposalDerivativeIt )
-              / ( this->m_ShrinkageIntensity * this->m_BaseVariance ) ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          else //m_ShrinkageIntensity==0
-          {
-            /**innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu (diff), where iterated over mu-s*/
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose()
-              * ( **proposalDerivativeIt ) ) ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          break;
-        }
-        case 2: // decomposed scaled covariance (element specific regularization)
-        {
-          // first scale proposalDerivatives with their sigma's in order to evaluate
-          // with the EigenValues and EigenVectors of the scaled CovarianceMatrix
-          typename VnlVectorType::iterator propDerivElementIt = ( *proposalDerivativeIt )->begin();
-          for( unsigned int propDerivElementIndex = 0; propDerivElementIndex < shapeLength;
-            ++propDerivElementIndex, ++propDerivElementIt )
-          {
-            ( *propDerivElementIt ) /= this->m_BaseStd;
-          }
-          ( **proposalDerivativeIt )[ shapeLength     ] /= this->m_CentroidXStd;
-          ( **proposalDerivativeIt )[ shapeLength + 1 ] /= this->m_CentroidYStd;
-          ( **proposalDerivativeIt )[ shapeLength + 2 ] /= this->m_CentroidZStd;
-          ( **proposalDerivativeIt )[ shapeLength + 3 ] /= this->m_SizeStd;
-          if( this->m_ShrinkageIntensity != 0 )
-          {
-            /** innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu(diff)
-             * + 1/(Beta*sigma_0^2)*diff^T* d/dmu(diff), where iterated over mu-s
-             */
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose() * ( **proposalDerivativeIt ) )
-              + dot_product( differenceVector, **proposalDerivativeIt )
-              / this->m_ShrinkageIntensity ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          else //m_ShrinkageIntensity==0
-          {
-            /**innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu (diff), where iterated over mu-s*/
-            *derivativeIt = ( dot_product( eigrot, this->m_EigenVectors->transpose()
-              * ( **proposalDerivativeIt ) ) ) / value;
-            this->CalculateCutOffDerivative( *derivativeIt, value );
-          }
-          break;
-        }
-        default:
-        {}
-
-          delete ( *proposalDerivativeIt );
-          // nzjacs++;
+        proposalGradient += differenceVector / ( this->m_ShrinkageIntensity * this->m_BaseVariance );
+      }
+      break;
+    }
+    case 2: // decomposed scaled covariance (element specific regularization)
+    {
+      /** S^-1 * ( V * Lambda^-1 * V^T * diff + 1/Beta * diff ), where diff is
+       * already scaled with the sigma's, and S are the sigma's.
+       */
+      proposalGradient = ( *this->m_EigenVectors ) * eigrot;
+      if( this->m_ShrinkageIntensity != 0 )
+      {
+        proposalGradient += differenceVector / this->m_ShrinkageIntensity;
+      }
+      typename VnlVectorType::iterator gradientElementIt = proposalGradient.begin();
+      for( unsigned int gradientElementIndex = 0; gradientElementIndex < shapeLength;
+        ++gradientElementIndex, ++gradientElementIt )
+      {
+        ( *gradientElementIt ) /= this->m_BaseStd;
       }
+      proposalGradient[ shapeLength     ] /= this->m_CentroidXStd;
+      proposalGradient[ shapeLength + 1 ] /= this->m_CentroidYStd;
+      proposalGradient[ shapeLength + 2 ] /= this->m_CentroidZStd;
+      proposalGradient[ shapeLength + 3 ] /= this->m_SizeStd;
+      break;
+    }
+    default:
+      derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+      return;
+  }
+
+  /** Propagate back to the point positions. */
+  if( this->m_NormalizedShapeModel )
+  {
+    this->BackPropagateNormalization( proposalGradient, shapeLength );
+  }
+  else
+  {
+    this->m_PointGradient = proposalGradient.extract( shapeLength );
+  }
+
+  /** Sum the contributions of the points, multi-threaded. */
+  this->InitializeThreadingParameters();
+  this->LaunchGetValueAndDerivativeThreaderCallback();
+  this->AccumulateDerivatives( derivative, value );
+
+  if( this->m_CutOffValue > 0.0 )
+  {
+    typename DerivativeType::iterator derivativeIt = derivative.begin();
+    for(; derivativeIt != derivative.end(); ++derivativeIt )
+    {
+      this->CalculateCutOffDerivative( *derivativeIt, value );
     }
   }
 
 } // end CalculateDerivative()
 
 
+/**
+ * ******************* BackPropagateNormalization *******************
+ */
+
+template< class TFixedPointSet, class TMovingPointSet >
+void
+StatisticalShapePointPenalty< TFixedPointSet, TMovingPointSet >
+::BackPropagateNormalization( const VnlVectorType & proposalGradient,
+  const unsigned int shapeLength ) const
+{
+  /** The proposal vector contains the normalized shape q = a / l, the centroid c
+   * and the l2-norm l, where a = x - c is the aligned shape. With the l2-norm
+   * derivative l' = a^T a' / ( l * sqrt(n) ), as used before, the derivative of
+   * g^T * proposal' with respect to the point positions x is
+   *   w = h + ( g_c - sum_i h_i ) / n,  with  h = g_q / l + kappa * a,
+   *   kappa = ( g_l - g_q^T a / l^2 ) / ( l * sqrt(n) ).
+   */
+  const unsigned int  numberOfPoints = this->GetFixedPointSet()->GetNumberOfPoints();
+  const double        l2norm         = this->m_ProposalVector[ shapeLength + Self::FixedPointSetDimension ];
+  const double        l2normGradient = proposalGradient[ shapeLength + Self::FixedPointSetDimension ];
+  const CoordRepType * q             = this->m_ProposalVector.data_block();
+  const CoordRepType * gq            = proposalGradient.data_block();
+
+  /** g_q^T a / l^2 = g_q^T q / l */
+  double gqDotQ = 0.0;
+  for( unsigned int index = 0; index < shapeLength; ++index )
+  {
+    gqDotQ += gq[ index ] * q[ index ];
+  }
+  const double kappa = ( l2normGradient - gqDotQ / l2norm )
+    / ( l2norm * sqrt( static_cast< double >( numberOfPoints ) ) );
+
+  /** h = g_q / l + kappa * l * q, and its sum over the points. */
+  this->m_PointGradient.set_size( shapeLength );
+  double hSum[ Self::FixedPointSetDimension ];
+  for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+  {
+    hSum[ d ] = 0.0;
+  }
+  for( unsigned int index = 0; index < shapeLength; index += Self::FixedPointSetDimension )
+  {
+    for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+    {
+      const double h = gq[ index + d ] / l2norm + kappa * l2norm * q[ index + d ];
+      this->m_PointGradient[ index + d ] = h;
+      hSum[ d ] += h;
+    }
+  }
+
+  /** The centroid: every point contributes 1/n to it. */
+  for( unsigned int d = 0; d < Self::FixedPointSetDimension; ++d )
+  {
+    const double centroidTerm = ( proposalGradient[ shapeLength + d ] - hSum[ d ] ) / numberOfPoints;
+    for( unsigned int index = 0; index < shapeLength; index += Self::FixedPointSetDimension )
+    {
+      this->m_PointGradient[ index + d ] += centroidTerm;
+    }
+  }
+
+} // end BackPropagateNormalization()
+
+
 /**
  * ******************* CalculateCutOffValue *******************
  */
@@ -102,6 +102,12 @@ public:
     Superclass::MovingImageLimiterOutputType              MovingImageLimiterOutputType;
   typedef typename
     Superclass::MovingImageDerivativeScalesType           MovingImageDerivativeScalesType;
+  typedef typename DerivativeType::ValueType              DerivativeValueType;
+  typedef typename Superclass::ThreaderType               ThreaderType;
+  typedef typename Superclass::ThreadInfoType             ThreadInfoType;
+
+  typedef vnl_matrix< RealType >            MatrixType;
+  typedef vnl_matrix< DerivativeValueType > DerivativeMatrixType;
 
   /** The fixed image dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int,
@@ -131,7 +137,7 @@ public:
 protected:
 
   SumOfPairwiseCorrelationCoefficientsMetric();
-  ~SumOfPairwiseCorrelationCoefficientsMetric() override {}
+  ~SumOfPairwiseCorrelationCoefficientsMetric() override;
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
   /** Protected Typedefs ******************/
@@ -149,6 +155,7 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::NumberOfParametersType              NumberOfParametersType;
 
   /** Computes the innerproduct of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
@@ -158,6 +165,63 @@ protected:
     const MovingImageDerivativeType & movingImageDerivative,
     DerivativeType & imageJacobian ) const override;
 
+  struct SumOfPairwiseCorrelationCoefficientsMultiThreaderParameterType
+  {
+    Self * m_Metric;
+  };
+
+  SumOfPairwiseCorrelationCoefficientsMultiThreaderParameterType m_SumOfPairwiseCorrelationCoefficientsThreaderParameters;
+
+  /** Per thread: the approved samples and their intensities over the last
+   * dimension, plus the mean and the centered G x G cross-product matrix of
+   * these rows, which are combined into the covariance matrix afterwards.
+   */
+  struct SumOfPairwiseCorrelationCoefficientsGetSamplesPerThreadStruct
+  {
+    SizeValueType                      st_NumberOfPixelsCounted;
+    MatrixType                         st_DataBlock;
+    std::vector< FixedImagePointType > st_ApprovedSamples;
+    vnl_vector< RealType >             st_Mean;
+    MatrixType                         st_CrossProducts;
+  };
+
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, SumOfPairwiseCorrelationCoefficientsGetSamplesPerThreadStruct,
+    PaddedSumOfPairwiseCorrelationCoefficientsGetSamplesPerThreadStruct );
+
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT,
+    PaddedSumOfPairwiseCorrelationCoefficientsGetSamplesPerThreadStruct,
+    AlignedSumOfPairwiseCorrelationCoefficientsGetSamplesPerThreadStruct );
+
+  mutable AlignedSumOfPairwiseCorrelationCoefficientsGetSamplesPerThreadStruct * m_GetSamplesPerThreadVariables;
+  mutable ThreadIdType                                                           m_GetSamplesPerThreadVariablesSize;
+
+  /** Get the samples and their statistics for each thread. */
+  inline void ThreadedGetSamples( ThreadIdType threadID );
+
+  /** Get the derivative contributions for each thread. */
+  inline void ThreadedComputeDerivative( ThreadIdType threadID );
+
+  /** Combine the statistics of all threads, and compute the value and,
+   * optionally, the terms needed for the derivative.
+   */
+  inline void AfterThreadedGetSamples( MeasureType & value, const bool computeDerivativeTerms ) const;
+
+  /** Gather the derivatives from all threads. */
+  inline void AfterThreadedComputeDerivative( DerivativeType & derivative ) const;
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_TYPE GetSamplesThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE ComputeDerivativeThreaderCallback( void * arg );
+
+  /** Helper functions to launch the threads. */
+  void LaunchGetSamplesThreaderCallback( void ) const;
+
+  void LaunchComputeDerivativeThreaderCallback( void ) const;
+
+  /** Initialize some multi-threading related parameters. */
+  void InitializeThreadingParameters( void ) const override;
+
 private:
 
   SumOfPairwiseCorrelationCoefficientsMetric( const Self & ); // purposely not implemented
@@ -166,6 +230,9 @@ private:
   /** Sample n random numbers from 0..m and add them to the vector. */
   void SampleRandom( const int n, const int m, std::vector< int > & numbers ) const;
 
+  /** Subtract the mean over the last dimension from the derivative elements. */
+  void SubtractMeanFromDerivative( DerivativeType & derivative ) const;
+
   /** Variables to control random sampling in last dimension. */
   unsigned int m_NumAdditionalSamplesFixed;
   unsigned int m_ReducedDimensionIndex;
@@ -179,6 +246,14 @@ private:
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform;
 
+  /** Terms needed for the threaded derivative computation. Per sample, the
+   * derivative coefficient of time point d is ( Q a + b .* a )[ d ], with a
+   * the sample's intensities minus the mean over all samples.
+   */
+  mutable vnl_vector< RealType >            m_Mean;
+  mutable DerivativeMatrixType              m_DerivativeCoefficientMatrix;
+  mutable vnl_vector< DerivativeValueType > m_DerivativeCoefficientDiagonal;
+
 };
 
 } // end namespace itk
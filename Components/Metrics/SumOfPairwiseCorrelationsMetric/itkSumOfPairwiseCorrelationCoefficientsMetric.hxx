@@ -40,9 +40,28 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
   this->SetUseImageSampler( true );
   this->SetUseFixedImageLimiter( false );
   this->SetUseMovingImageLimiter( false );
+
+  // Multi-threading structs
+  this->m_GetSamplesPerThreadVariables     = nullptr;
+  this->m_GetSamplesPerThreadVariablesSize = 0;
+
+  /** Initialize the m_SumOfPairwiseCorrelationCoefficientsThreaderParameters. */
+  this->m_SumOfPairwiseCorrelationCoefficientsThreaderParameters.m_Metric = this;
 } // end constructor
 
 
+/**
+ * ******************* Destructor *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::~SumOfPairwiseCorrelationCoefficientsMetric()
+{
+  delete[] this->m_GetSamplesPerThreadVariables;
+} // end Destructor
+
+
 /**
  * ******************* Initialize *******************
  */
@@ -54,6 +73,15 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 {
   /** Initialize transform, interpolator, etc. */
   Superclass::Initialize();
+
+  /** Without multi-threading the parts of all threads are processed one
+   * after the other, so the per-thread variables are needed as well.
+   */
+  if( !this->m_UseMultiThread )
+  {
+    this->InitializeThreadingParameters();
+  }
+
 } // end Initialize()
 
 
@@ -70,6 +98,38 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 } // end PrintSelf()
 
 
+/**
+ * ********************* InitializeThreadingParameters ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::InitializeThreadingParameters( void ) const
+{
+  /** Initialize the per-thread derivatives of the superclass. */
+  Superclass::InitializeThreadingParameters();
+
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Only resize the array of structs when needed. */
+  if( this->m_GetSamplesPerThreadVariablesSize != numberOfThreads )
+  {
+    delete[] this->m_GetSamplesPerThreadVariables;
+    this->m_GetSamplesPerThreadVariables
+      = new AlignedSumOfPairwiseCorrelationCoefficientsGetSamplesPerThreadStruct[ numberOfThreads ];
+    this->m_GetSamplesPerThreadVariablesSize = numberOfThreads;
+  }
+
+  /** Some initialization. The data blocks are sized in each thread. */
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_GetSamplesPerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
+  }
+
+} // end InitializeThreadingParameters()
+
+
 /**
  * ******************* SampleRandom *******************
  */
@@ -106,6 +166,87 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 } // end SampleRandom()
 
 
+/**
+ * ******************* SubtractMeanFromDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::SubtractMeanFromDerivative( DerivativeType & derivative ) const
+{
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+
+  if( !this->m_TransformIsStackTransform )
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
+     * per dimension xyz.
+     */
+    const unsigned int lastDimGridSize = this->m_GridSize[ lastDim ];
+    const unsigned int numParametersPerDimension
+      = this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
+    const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
+    DerivativeType     mean( numControlPointsPerDimension );
+    for( unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d )
+    {
+      /** Compute mean per dimension. */
+      mean.Fill( 0.0 );
+      const unsigned int starti = numParametersPerDimension * d;
+      for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        mean[ index ] += derivative[ i ];
+      }
+      mean /= static_cast< double >( lastDimGridSize );
+
+      /** Update derivative for every control point per dimension. */
+      for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        derivative[ i ] -= mean[ index ];
+      }
+    }
+  }
+  else
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
+     * the number the time point index.
+     */
+    const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / G;
+    DerivativeType     mean( numParametersPerLastDimension );
+    mean.Fill( 0.0 );
+
+    /** Compute mean per control point. */
+    for( unsigned int t = 0; t < G; ++t )
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        mean[ index ] += derivative[ c ];
+      }
+    }
+    mean /= static_cast< double >( G );
+
+    /** Update derivative per control point. */
+    for( unsigned int t = 0; t < G; ++t )
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        derivative[ c ] -= mean[ index ];
+      }
+    }
+  }
+
+} // end SubtractMeanFromDerivative()
+
+
 /**
  * *************** EvaluateTransformJacobianInnerProduct ****************
  */
@@ -147,142 +288,28 @@ typename SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 ::GetValue( const TransformParametersType & parameters ) const
 {
-  itkDebugMacro( "GetValue( " << parameters << " ) " );
-
-  /** Make sure the transform parameters are up to date. */
-  this->SetTransformParameters( parameters );
-
-  /** Initialize some variables */
-  this->m_NumberOfPixelsCounted = 0;
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
-
-  /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
-
-  /** Retrieve slowest varying dimension and its size. */
-  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
-  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
-
-  typedef vnl_matrix< RealType > MatrixType;
-
-  /** The rows of the ImageSampleMatrix contain the samples of the images of the stack */
-  unsigned int NumberOfSamples = sampleContainer->Size();
-  MatrixType   datablock( NumberOfSamples, G );
-
-  /** Initialize dummy loop variable */
-  unsigned int pixelIndex = 0;
-
-  /** Initialize image sample matrix . */
-  datablock.fill( itk::NumericTraits< RealType >::Zero );
-
-  for( fiter = fbegin; fiter != fend; ++fiter )
-  {
-    /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-
-    /** Transform sampled point to voxel coordinates. */
-    FixedImageContinuousIndexType voxelCoord;
-    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
-
-    unsigned int numSamplesOk = 0;
-
-    /** Loop over t */
-    for( unsigned int d = 0; d < G; ++d )
-    {
-      /** Initialize some variables. */
-      RealType             movingImageValue;
-      MovingImagePointType mappedPoint;
-
-      /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[ lastDim ] = d;
-
-      /** Transform sampled point back to world coordinates. */
-      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
-
-      /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-      /** Check if point is inside mask. */
-      if( sampleOk )
-      {
-        sampleOk = this->IsInsideMovingMask( mappedPoint );
-      }
-
-      if( sampleOk )
-      {
-        sampleOk = this->EvaluateMovingImageValueAndDerivative(
-          mappedPoint, movingImageValue, 0 );
-      }
-
-      if( sampleOk )
-      {
-        numSamplesOk++;
-        datablock( pixelIndex, d ) = movingImageValue;
-      }
-
-    } /** end loop over t */
-
-    if( numSamplesOk == G )
-    {
-      pixelIndex++;
-      this->m_NumberOfPixelsCounted++;
-    }
-
-  } /** end first loop over image sample container */
-
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    NumberOfSamples, this->m_NumberOfPixelsCounted );
-  unsigned int N = this->m_NumberOfPixelsCounted;
-
-  MatrixType A( datablock.extract( N, G ) );
-
-  /** Calculate mean of from columns */
-  vnl_vector< RealType > mean( G );
-  mean.fill( NumericTraits< RealType >::Zero );
-  for( unsigned int i = 0; i < N; i++ )
-  {
-    for( unsigned int j = 0; j < G; j++ )
-    {
-      mean( j ) += A( i, j );
-    }
-  }
-  mean /= RealType( N );
-
-  MatrixType Amm( N, G );
-  Amm.fill( NumericTraits< RealType >::Zero );
-  for( unsigned int i = 0; i < N; i++ )
-  {
-    for( unsigned int j = 0; j < G; j++ )
-    {
-      Amm( i, j ) = A( i, j ) - mean( j );
-    }
-  }
-
-  MatrixType Atmm = Amm.transpose();
-
-  MatrixType C( Atmm * Amm );
-  C /= static_cast< RealType >( RealType( N ) - 1.0 );
-
-  vnl_diag_matrix< RealType > S( G );
-  S.fill( NumericTraits< RealType >::Zero );
-  for( unsigned int j = 0; j < G; j++ )
-  {
-    S( j, j ) = 1.0 / sqrt( C( j, j ) );
-  }
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValue itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before calling GetValue
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValue multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  MatrixType K( S * C * S );
+  /** Launch multi-threading GetSamples */
+  this->LaunchGetSamplesThreaderCallback();
 
-  measure = 1.0 - ( K.fro_norm() / RealType( G ) );
+  /** Combine the sample statistics of all threads and compute the value. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  this->AfterThreadedGetSamples( value, false );
 
-  /** Return the measure value. */
-  return measure;
+  return value;
 
 } // end GetValue()
 
@@ -319,54 +346,86 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
 ::GetValueAndDerivative( const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
-  itkDebugMacro( "GetValueAndDerivative( " << parameters << " ) " );
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValueAndDerivative itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
+   *   calling GetValueAndDerivative
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValueAndDerivative multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  /** Define derivative and Jacobian types. */
-  typedef typename DerivativeType::ValueType DerivativeValueType;
-  //typedef typename TransformJacobianType::ValueType TransformJacobianValueType;
+  /** Launch multi-threading GetSamples */
+  this->LaunchGetSamplesThreaderCallback();
 
-  /** Initialize some variables */
-  const unsigned int P = this->GetNumberOfParameters();
-  this->m_NumberOfPixelsCounted = 0;
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
-  derivative = DerivativeType( P );
-  derivative.Fill( NumericTraits< DerivativeValueType >::Zero );
+  /** Combine the sample statistics of all threads and compute the value. */
+  this->AfterThreadedGetSamples( value, true );
 
-  /** Make sure the transform parameters are up to date. */
-  this->SetTransformParameters( parameters );
+  /** Launch multi-threading ComputeDerivative */
+  this->LaunchComputeDerivativeThreaderCallback();
 
-  /** Update the imageSampler and get a handle to the sample container. */
-  this->GetImageSampler()->Update();
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  /** Sum derivative contributions from all threads */
+  this->AfterThreadedComputeDerivative( derivative );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetSamples *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::ThreadedGetSamples( ThreadIdType threadId )
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
 
   /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  typename ImageSampleContainerType::ConstIterator threader_fiter;
+  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
+
+  threader_fbegin += (int)pos_begin;
+  threader_fend   += (int)pos_end;
 
   /** Retrieve slowest varying dimension and its size. */
   const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
   const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
 
-  typedef vnl_matrix< RealType >            MatrixType;
-  typedef vnl_matrix< DerivativeValueType > DerivativeMatrixType;
-
-  std::vector< FixedImagePointType > SamplesOK;
-
-  /** The rows of the ImageSampleMatrix contain the samples of the images of the stack */
-  unsigned int NumberOfSamples = sampleContainer->Size();
-  MatrixType   datablock( NumberOfSamples, G );
+  /** Get handles to the pre-allocated containers of this thread.
+   * set_size() only re-allocates when the size changed.
+   */
+  AlignedSumOfPairwiseCorrelationCoefficientsGetSamplesPerThreadStruct & threadVariables
+    = this->m_GetSamplesPerThreadVariables[ threadId ];
+  MatrixType &                         datablock = threadVariables.st_DataBlock;
+  std::vector< FixedImagePointType > & SamplesOK = threadVariables.st_ApprovedSamples;
+  datablock.set_size( nrOfSamplesPerThreads, G );
+  SamplesOK.clear();
 
-  /** Initialize dummy loop variables */
   unsigned int pixelIndex = 0;
-
-  /** Initialize image sample matrix . */
-  datablock.fill( itk::NumericTraits< double >::Zero );
-
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
   {
     /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    FixedImagePointType fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
 
     /** Transform sampled point to voxel coordinates. */
     FixedImageContinuousIndexType voxelCoord;
@@ -406,7 +465,6 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
       {
         numSamplesOk++;
         datablock( pixelIndex, d ) = movingImageValue;
-
       } // end if sampleOk
 
     } // end loop over t
@@ -415,42 +473,126 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
     {
       SamplesOK.push_back( fixedPoint );
       pixelIndex++;
-      this->m_NumberOfPixelsCounted++;
     }
 
-  } /** end first loop over image sample container */
-
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples( sampleContainer->Size(), this->m_NumberOfPixelsCounted );
-  unsigned int N = this->m_NumberOfPixelsCounted;
-
-  MatrixType A( datablock.extract( N, G ) );
+  } // end first loop over image sample container
 
-  /** Calculate mean of from columns */
-  vnl_vector< RealType > mean( G );
+  /** Compute the mean of the rows of this thread. */
+  vnl_vector< RealType > & mean = threadVariables.st_Mean;
+  mean.set_size( G );
   mean.fill( NumericTraits< RealType >::Zero );
-  for( unsigned int i = 0; i < N; i++ )
+  for( unsigned int i = 0; i < pixelIndex; ++i )
   {
-    for( unsigned int j = 0; j < G; j++ )
+    for( unsigned int j = 0; j < G; ++j )
     {
-      mean( j ) += A( i, j );
+      mean[ j ] += datablock( i, j );
     }
   }
-  mean /= RealType( N );
+  if( pixelIndex > 0 )
+  {
+    mean /= static_cast< RealType >( pixelIndex );
+  }
 
-  MatrixType Amm( N, G );
-  Amm.fill( NumericTraits< RealType >::Zero );
-  for( unsigned int i = 0; i < N; i++ )
+  /** Compute the cross-products of the centered rows of this thread.
+   * Only the upper triangle is accumulated, the matrix is symmetric.
+   */
+  MatrixType & crossProducts = threadVariables.st_CrossProducts;
+  crossProducts.set_size( G, G );
+  crossProducts.fill( NumericTraits< RealType >::Zero );
+  vnl_vector< RealType > centered( G );
+  for( unsigned int i = 0; i < pixelIndex; ++i )
+  {
+    for( unsigned int j = 0; j < G; ++j )
+    {
+      centered[ j ] = datablock( i, j ) - mean[ j ];
+    }
+    for( unsigned int j = 0; j < G; ++j )
+    {
+      const RealType centered_j = centered[ j ];
+      for( unsigned int k = j; k < G; ++k )
+      {
+        crossProducts( j, k ) += centered_j * centered[ k ];
+      }
+    }
+  }
+  for( unsigned int j = 0; j < G; ++j )
   {
-    for( unsigned int j = 0; j < G; j++ )
+    for( unsigned int k = 0; k < j; ++k )
     {
-      Amm( i, j ) = A( i, j ) - mean( j );
+      crossProducts( j, k ) = crossProducts( k, j );
     }
   }
 
-  MatrixType Atmm = Amm.transpose();
+  /** Only update this variable at the end to prevent unnecessary "false sharing". */
+  threadVariables.st_NumberOfPixelsCounted = pixelIndex;
+
+} // end ThreadedGetSamples()
+
+
+/**
+ * ******************* AfterThreadedGetSamples *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetSamples( MeasureType & value, const bool computeDerivativeTerms ) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
 
-  MatrixType C( Atmm * Amm );
+  /** Accumulate the number of pixels. */
+  this->m_NumberOfPixelsCounted = 0;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_NumberOfPixelsCounted += this->m_GetSamplesPerThreadVariables[ i ].st_NumberOfPixelsCounted;
+  }
+
+  /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamples( sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+  const unsigned int N = this->m_NumberOfPixelsCounted;
+
+  /** Combine the means of the threads into the mean of all samples. */
+  this->m_Mean.set_size( G );
+  this->m_Mean.fill( NumericTraits< RealType >::Zero );
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    const SizeValueType n_i = this->m_GetSamplesPerThreadVariables[ i ].st_NumberOfPixelsCounted;
+    if( n_i > 0 )
+    {
+      this->m_Mean += this->m_GetSamplesPerThreadVariables[ i ].st_Mean * static_cast< RealType >( n_i );
+    }
+  }
+  this->m_Mean /= static_cast< RealType >( N );
+
+  /** Combine the centered cross-products of the threads into the covariance
+   * matrix C, correcting for the difference between the thread means and the
+   * mean of all samples: ( N - 1 ) C = sum_i M_i + n_i ( m_i - m ) ( m_i - m )^T.
+   */
+  MatrixType             C( G, G, NumericTraits< RealType >::Zero );
+  vnl_vector< RealType > delta( G );
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    const SizeValueType n_i = this->m_GetSamplesPerThreadVariables[ i ].st_NumberOfPixelsCounted;
+    if( n_i == 0 )
+    {
+      continue;
+    }
+
+    C    += this->m_GetSamplesPerThreadVariables[ i ].st_CrossProducts;
+    delta = this->m_GetSamplesPerThreadVariables[ i ].st_Mean - this->m_Mean;
+    for( unsigned int j = 0; j < G; ++j )
+    {
+      for( unsigned int k = 0; k < G; ++k )
+      {
+        C( j, k ) += static_cast< RealType >( n_i ) * delta[ j ] * delta[ k ];
+      }
+    }
+  }
   C /= static_cast< RealType >( RealType( N ) - 1.0 );
 
   vnl_diag_matrix< RealType > S( G );
@@ -460,35 +602,145 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
     S( j, j ) = 1.0 / sqrt( C( j, j ) );
   }
 
-  DerivativeMatrixType K( S * C * S );
+  /** Compute correlation matrix K */
+  MatrixType K( S * C * S );
 
-  /** Create variables to store intermediate results in. */
-  TransformJacobianType                     jacobian;
-  DerivativeType                            imageJacobian( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  std::vector< NonZeroJacobianIndicesType > nzjis( G, NonZeroJacobianIndicesType() );
+  /** The measure is one minus the normalized Frobenius norm of K. */
+  const RealType KFrobeniusNorm = K.fro_norm();
+  value = RealType( 1.0 - ( KFrobeniusNorm / RealType( G ) ) );
 
-  DerivativeType dMTdmu;
+  if( !computeDerivativeTerms )
+  {
+    return;
+  }
 
-  /** Sub components of metric derivative */
-  vnl_diag_matrix< DerivativeValueType > dSdmu_part1( G );
+  /** The derivative sums for every sample i and time point d:
+   *   KAtZscore[ d ][ i ] * S( d, d ) + dSdmu_part1( d, d ) * Atmm[ d ][ i ] * KAtZscoreAmm[ d ][ d ],
+   * with KAtZscore = K S Atmm, dSdmu_part1 = -S^3 / ( N - 1 ) and KAtZscoreAmm = K S C ( N - 1 ).
+   * This gives per sample the coefficient ( Q a + b .* a )[ d ], with a the
+   * centered sample, Q = S K S and b[ d ] = -S( d, d )^3 ( K S C )( d, d ).
+   * The final normalization -2 / ( ( N - 1 ) |K|_F G ) is folded into Q and b.
+   */
+  const DerivativeValueType normalization = -static_cast< DerivativeValueType >( 2.0 )
+    / ( ( DerivativeValueType( N ) - 1.0 ) * ( KFrobeniusNorm * RealType( G ) ) );
 
-  /** initialize */
-  dSdmu_part1.fill( itk::NumericTraits< DerivativeValueType >::Zero );
+  DerivativeMatrixType KSC( K * S * C );
+  this->m_DerivativeCoefficientMatrix = S * K * S;
+  this->m_DerivativeCoefficientMatrix *= normalization;
 
+  this->m_DerivativeCoefficientDiagonal.set_size( G );
   for( unsigned int d = 0; d < G; d++ )
   {
-    double S_sqr = S( d, d ) * S( d, d );
-    double S_qub = S_sqr * S( d, d );
-    dSdmu_part1( d, d ) = -S_qub / ( DerivativeValueType( N ) - 1.0 );
+    const double S_qub = S( d, d ) * S( d, d ) * S( d, d );
+    this->m_DerivativeCoefficientDiagonal[ d ] = -S_qub * KSC( d, d ) * normalization;
   }
 
-  //DerivativeMatrixType CS( C*S );
-  DerivativeMatrixType KAtZscore( K * ( Amm * S ).transpose() );
-  DerivativeMatrixType KAtZscoreAmm( K * ( Amm * S ).transpose() * Amm );
+} // end AfterThreadedGetSamples()
+
+
+/**
+ * **************** GetSamplesThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::GetSamplesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  SumOfPairwiseCorrelationCoefficientsMultiThreaderParameterType * temp
+    = static_cast< SumOfPairwiseCorrelationCoefficientsMultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedGetSamples( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GetSamplesThreaderCallback()
+
+
+/**
+ * *********************** LaunchGetSamplesThreaderCallback***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::LaunchGetSamplesThreaderCallback( void ) const
+{
+  /** Without multi-threading, process the parts of all threads here. */
+  if( !this->m_UseMultiThread )
+  {
+    for( ThreadIdType i = 0; i < Self::GetNumberOfWorkUnits(); ++i )
+    {
+      this->m_SumOfPairwiseCorrelationCoefficientsThreaderParameters.m_Metric->ThreadedGetSamples( i );
+    }
+    return;
+  }
+
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->GetSamplesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >(
+      &this->m_SumOfPairwiseCorrelationCoefficientsThreaderParameters ) ) );
+
+  /** Launch. */
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchGetSamplesThreaderCallback()
+
+
+/**
+ * ******************* ThreadedComputeDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::ThreadedComputeDerivative( ThreadIdType threadId )
+{
+  /** Get a handle to the pre-allocated derivative for the current thread.
+   * The initialization is performed at the beginning of each resolution in
+   * InitializeThreadingParameters(), and at the end of each iteration in
+   * the accumulate functions.
+   */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+
+  /** Get handles to the samples of this thread. */
+  const AlignedSumOfPairwiseCorrelationCoefficientsGetSamplesPerThreadStruct & threadVariables
+    = this->m_GetSamplesPerThreadVariables[ threadId ];
+  const MatrixType &                         datablock = threadVariables.st_DataBlock;
+  const std::vector< FixedImagePointType > & SamplesOK = threadVariables.st_ApprovedSamples;
+
+  /** Create variables to store intermediate results in. */
+  const NumberOfParametersType      nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType        nzji( nnzji );
+  DerivativeType                    imageJacobian( nnzji );
+  vnl_vector< DerivativeValueType > centered( G );
+  vnl_vector< DerivativeValueType > coefficients( G );
 
   /** Second loop over fixed image samples. */
-  for( pixelIndex = 0; pixelIndex < SamplesOK.size(); ++pixelIndex )
+  for( unsigned int pixelIndex = 0; pixelIndex < SamplesOK.size(); ++pixelIndex )
   {
+    /** Compute the derivative coefficient of every time point of this sample. */
+    for( unsigned int d = 0; d < G; ++d )
+    {
+      centered[ d ] = datablock( pixelIndex, d ) - this->m_Mean[ d ];
+    }
+    for( unsigned int d = 0; d < G; ++d )
+    {
+      DerivativeValueType coefficient = this->m_DerivativeCoefficientDiagonal[ d ] * centered[ d ];
+      for( unsigned int g = 0; g < G; ++g )
+      {
+        coefficient += this->m_DerivativeCoefficientMatrix( d, g ) * centered[ g ];
+      }
+      coefficients[ d ] = coefficient;
+    }
+
     /** Read fixed coordinates. */
     FixedImagePointType fixedPoint = SamplesOK[ pixelIndex ];
 
@@ -513,106 +765,117 @@ SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
       this->EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, &movingImageDerivative );
 
-      /** Get the TransformJacobian dT/dmu */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzjis[ d ] );
-
-      /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-
-      /** Store values. */
-      dMTdmu = imageJacobian;
+      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+        fixedPoint, movingImageDerivative, imageJacobian, nzji );
 
       /** build metric derivative components */
-      for( unsigned int p = 0; p < nzjis[ d ].size(); ++p )
+      const DerivativeValueType coefficient = coefficients[ d ];
+      for( unsigned int p = 0; p < nzji.size(); ++p )
       {
-        derivative[ nzjis[ d ][ p ] ] += KAtZscore[ d ][ pixelIndex ] * dMTdmu[ p ] * S( d, d );
-        derivative[ nzjis[ d ][ p ] ] += dSdmu_part1( d, d ) * Atmm[ d ][ pixelIndex ] * dMTdmu[ p ] * KAtZscoreAmm[ d ][ d ];
-      } //end loop over non-zero jacobian indices
+        derivative[ nzji[ p ] ] += coefficient * imageJacobian[ p ];
+      }
 
     } // end loop over t
 
   } // end second for loop over sample container
 
-  derivative *= -static_cast< DerivativeValueType >( 2.0 )
-    / ( static_cast< DerivativeValueType >( N
-    - static_cast< DerivativeValueType >( 1.0 ) ) * ( K.fro_norm() * RealType( G ) ) ); //normalize
+} // end ThreadedComputeDerivative()
 
-  measure = RealType( 1.0 - ( K.fro_norm() / RealType( G ) ) );
 
-  /** Subtract mean from derivative elements. */
-  if( this->m_SubtractMean )
+/**
+ * ******************* AfterThreadedComputeDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::AfterThreadedComputeDerivative( DerivativeType & derivative ) const
+{
+  /** Accumulate the derivatives of all threads. These are already normalized. */
+  derivative.SetSize( this->GetNumberOfParameters() );
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
+
+  if( this->m_UseMultiThread )
   {
-    if( !this->m_TransformIsStackTransform )
+    this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+  else
+  {
+    /** Accumulate in the same order as the threads do, and reset the
+     * per-thread derivatives for the next iteration.
+     */
+    derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    for( ThreadIdType i = 0; i < Self::GetNumberOfWorkUnits(); ++i )
     {
-      /** Update derivative per dimension.
-       * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
-       * per dimension xyz.
-       */
-      const unsigned int lastDimGridSize = this->m_GridSize[ lastDim ];
-      const unsigned int numParametersPerDimension
-        = this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
-      const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
-      DerivativeType     mean( numControlPointsPerDimension );
-      for( unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d )
-      {
-        /** Compute mean per dimension. */
-        mean.Fill( 0.0 );
-        const unsigned int starti = numParametersPerDimension * d;
-        for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          mean[ index ] += derivative[ i ];
-        }
-        mean /= static_cast< double >( lastDimGridSize );
-
-        /** Update derivative for every control point per dimension. */
-        for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          derivative[ i ] -= mean[ index ];
-        }
-      }
+      derivative += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative;
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Fill(
+        NumericTraits< DerivativeValueType >::ZeroValue() );
     }
-    else
-    {
-      /** Update derivative per dimension.
-       * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
-       * the number the time point index.
-       */
-      const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / G;
-      DerivativeType     mean( numParametersPerLastDimension );
-      mean.Fill( 0.0 );
+  }
 
-      /** Compute mean per control point. */
-      for( unsigned int t = 0; t < G; ++t )
-      {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
-        {
-          const unsigned int index = c % numParametersPerLastDimension;
-          mean[ index ] += derivative[ c ];
-        }
-      }
-      mean /= static_cast< double >( G );
+  /** Subtract mean from derivative elements. */
+  if( this->m_SubtractMean )
+  {
+    this->SubtractMeanFromDerivative( derivative );
+  }
 
-      /** Update derivative per control point. */
-      for( unsigned int t = 0; t < G; ++t )
-      {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
-        {
-          const unsigned int index = c % numParametersPerLastDimension;
-          derivative[ c ] -= mean[ index ];
-        }
-      }
+} // end AfterThreadedComputeDerivative()
+
+
+/**
+ * **************** ComputeDerivativeThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::ComputeDerivativeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  SumOfPairwiseCorrelationCoefficientsMultiThreaderParameterType * temp
+    = static_cast< SumOfPairwiseCorrelationCoefficientsMultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedComputeDerivative( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeDerivativeThreaderCallback()
+
+
+/**
+ * ************** LaunchComputeDerivativeThreaderCallback **********
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+SumOfPairwiseCorrelationCoefficientsMetric< TFixedImage, TMovingImage >
+::LaunchComputeDerivativeThreaderCallback( void ) const
+{
+  /** Without multi-threading, process the parts of all threads here. */
+  if( !this->m_UseMultiThread )
+  {
+    for( ThreadIdType i = 0; i < Self::GetNumberOfWorkUnits(); ++i )
+    {
+      this->m_SumOfPairwiseCorrelationCoefficientsThreaderParameters.m_Metric->ThreadedComputeDerivative( i );
     }
+    return;
   }
 
-  /** Return the measure value. */
-  value = measure;
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->ComputeDerivativeThreaderCallback,
+    const_cast< void * >( static_cast< const void * >(
+      &this->m_SumOfPairwiseCorrelationCoefficientsThreaderParameters ) ) );
 
-} // end GetValueAndDerivative()
+  /** Launch. */
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchComputeDerivativeThreaderCallback()
 
 
 } // end namespace itk
@@ -173,6 +173,8 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::NumberOfParametersType              NumberOfParametersType;
+  typedef typename Superclass::ThreadInfoType                      ThreadInfoType;
 
   /** Computes the innerproduct of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
@@ -182,6 +184,19 @@ protected:
     const MovingImageDerivativeType & movingImageDerivative,
     DerivativeType & imageJacobian ) const override;
 
+  /** Get value for each thread. */
+  inline void ThreadedGetValue( ThreadIdType threadID ) override;
+
+  /** Gather the values from all threads. */
+  inline void AfterThreadedGetValue( MeasureType & value ) const override;
+
+  /** Get value and derivatives for each thread. */
+  inline void ThreadedGetValueAndDerivative( ThreadIdType threadID ) override;
+
+  /** Gather the values and derivatives from all threads. */
+  inline void AfterThreadedGetValueAndDerivative(
+    MeasureType & value, DerivativeType & derivative ) const override;
+
 private:
 
   VarianceOverLastDimensionImageMetric( const Self & ); // purposely not implemented
@@ -190,6 +205,51 @@ private:
   /** Sample n random numbers from 0..m and add them to the vector. */
   void SampleRandom( const int n, const int m, std::vector< int > & numbers ) const;
 
+  /** Draw the random last dimension positions of all samples up front, so
+   * that the threads do not share the random generator and the sequence
+   * does not depend on the number of threads.
+   */
+  void SampleRandomLastDimensionPositions( void ) const;
+
+  /** Get the last dimension positions to use for sample number sampleIndex. */
+  const std::vector< int > & GetLastDimensionPositions( const unsigned long sampleIndex ) const;
+
+  /** Subtract the mean over the last dimension from the derivative elements. */
+  void SubtractMeanFromDerivative( DerivativeType & derivative ) const;
+
+  /** Run a threader callback for all threads, with m_ThreaderMetricParameters
+   * as user data: concurrently with multi-threading, and one thread after
+   * the other without.
+   */
+  typedef ITK_THREAD_RETURN_TYPE ( *ThreaderCallbackType )( void * );
+  void ExecuteThreaderCallback( ThreaderCallbackType callback ) const;
+
+  /** True if the threads should be partitioned over the last dimension
+   * positions instead of over the samples. This is the case when the
+   * transform is a StackTransform and all positions are used: the
+   * parameters of each position are then only written by the thread that
+   * handles that position, so no reduction over the threads is needed, and
+   * each thread only evaluates the sub-transforms of its own positions.
+   */
+  bool UseSlicePartitioning( void ) const;
+
+  /** GetValueAndDerivative, partitioned over the last dimension positions.
+   * First the moving image values and derivatives of all samples and
+   * positions are computed per sample, then the derivative per position.
+   */
+  void GetValueAndDerivativePerSlice( MeasureType & value, DerivativeType & derivative ) const;
+
+  /** Compute the moving image values and derivatives for the samples of a thread. */
+  void ThreadedGetSliceSampleValues( ThreadIdType threadId );
+
+  /** Compute the derivative for the last dimension positions of a thread. */
+  void ThreadedComputeSliceDerivative( ThreadIdType threadId );
+
+  /** Helper functions to launch the threads. */
+  static ITK_THREAD_RETURN_TYPE GetSliceSampleValuesThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE ComputeSliceDerivativeThreaderCallback( void * arg );
+
   /** Variables to control random sampling in last dimension. */
   bool         m_SampleLastDimensionRandomly;
   unsigned int m_NumSamplesLastDimension;
@@ -208,6 +268,20 @@ private:
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform;
 
+  /** Last dimension positions: all positions, or per sample when sampled randomly. */
+  std::vector< int >                        m_LastDimPositions;
+  mutable std::vector< std::vector< int > > m_RandomLastDimPositions;
+
+  /** Per sample and last dimension position (sample major): the moving
+   * image value and derivative, and whether the position is valid. Per
+   * sample: the mean value and the number of valid positions.
+   */
+  mutable std::vector< RealType >                  m_SliceSampleValues;
+  mutable std::vector< MovingImageDerivativeType > m_SliceSampleDerivatives;
+  mutable std::vector< unsigned char >             m_SliceSampleIsValid;
+  mutable std::vector< float >                     m_SampleMeans;
+  mutable std::vector< unsigned int >              m_SampleNumberOfValidPositions;
+
 };
 
 } // end namespace itk
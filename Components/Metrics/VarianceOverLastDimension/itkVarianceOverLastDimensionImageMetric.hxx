@@ -57,6 +57,14 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
   /** Initialize transform, interpolator, etc. */
   Superclass::Initialize();
 
+  /** Without multi-threading the parts of all threads are processed one
+   * after the other, so the per-thread variables are needed as well.
+   */
+  if( !this->m_UseMultiThread )
+  {
+    this->InitializeThreadingParameters();
+  }
+
   /** Retrieve slowest varying dimension and its size. */
   const unsigned int lastDim     = this->GetFixedImage()->GetImageDimension() - 1;
   const unsigned int lastDimSize = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
@@ -67,6 +75,13 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
     this->m_NumSamplesLastDimension = lastDimSize;
   }
 
+  /** All last dimension positions, used when random sampling is turned off. */
+  this->m_LastDimPositions.resize( lastDimSize );
+  for( unsigned int i = 0; i < lastDimSize; ++i )
+  {
+    this->m_LastDimPositions[ i ] = i;
+  }
+
   /** Compute variance over last dimension for complete image to use as normalization factor. */
   ImageLinearConstIteratorWithIndex< MovingImageType > it( this->GetMovingImage(),
   this->GetMovingImage()->GetLargestPossibleRegion() );
@@ -160,6 +175,133 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
 } // end SampleRandom()
 
 
+/**
+ * ******************* SampleRandomLastDimensionPositions *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::SampleRandomLastDimensionPositions( void ) const
+{
+  if( !this->m_SampleLastDimensionRandomly )
+  {
+    return;
+  }
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim     = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int lastDimSize = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+
+  /** Draw the positions in sample order, independent of the threads. */
+  const unsigned long numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  this->m_RandomLastDimPositions.resize( numberOfSamples );
+  for( unsigned long i = 0; i < numberOfSamples; ++i )
+  {
+    this->SampleRandom( this->m_NumSamplesLastDimension, lastDimSize, this->m_RandomLastDimPositions[ i ] );
+  }
+
+} // end SampleRandomLastDimensionPositions()
+
+
+/**
+ * ******************* GetLastDimensionPositions *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+const std::vector< int > &
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::GetLastDimensionPositions( const unsigned long sampleIndex ) const
+{
+  if( this->m_SampleLastDimensionRandomly )
+  {
+    return this->m_RandomLastDimPositions[ sampleIndex ];
+  }
+  return this->m_LastDimPositions;
+
+} // end GetLastDimensionPositions()
+
+
+/**
+ * ******************* SubtractMeanFromDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::SubtractMeanFromDerivative( DerivativeType & derivative ) const
+{
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim     = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int lastDimSize = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+
+  if( !this->m_TransformIsStackTransform )
+  {
+    /** Update derivative per dimension.
+    * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
+    * per dimension xyz.
+    */
+    const unsigned int lastDimGridSize              = this->m_GridSize[ lastDim ];
+    const unsigned int numParametersPerDimension    = this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
+    const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
+    DerivativeType     mean( numControlPointsPerDimension );
+    for( unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d )
+    {
+      /** Compute mean per dimension. */
+      mean.Fill( 0.0 );
+      const unsigned int starti = numParametersPerDimension * d;
+      for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        mean[ index ] += derivative[ i ];
+      }
+      mean /= static_cast< double >( lastDimGridSize );
+
+      /** Update derivative for every control point per dimension. */
+      for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        derivative[ i ] -= mean[ index ];
+      }
+    }
+  }
+  else
+  {
+    /** Update derivative per dimension.
+    * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
+    * the number the time point index.
+    */
+    const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / lastDimSize;
+    DerivativeType     mean( numParametersPerLastDimension );
+    mean.Fill( 0.0 );
+
+    /** Compute mean per control point. */
+    for( unsigned int t = 0; t < lastDimSize; ++t )
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        mean[ index ] += derivative[ c ];
+      }
+    }
+    mean /= static_cast< double >( lastDimSize );
+
+    /** Update derivative per control point. */
+    for( unsigned int t = 0; t < lastDimSize; ++t )
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        derivative[ c ] -= mean[ index ];
+      }
+    }
+  }
+
+} // end SubtractMeanFromDerivative()
+
+
 /**
  * *************** EvaluateTransformJacobianInnerProduct ****************
  */
@@ -201,63 +343,116 @@ typename VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >::Meas
 VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
 ::GetValue( const TransformParametersType & parameters ) const
 {
-  itkDebugMacro( "GetValue( " << parameters << " ) " );
-
-  /** Initialize some variables */
-  this->m_NumberOfPixelsCounted = 0;
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
-
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
    *   this->GetImageSampler()->Update();
-   * Because of these calls GetValueAndDerivative itself is not thread-safe,
+   * Because of these calls GetValue itself is not thread-safe,
    * so cannot be called multiple times simultaneously.
    * This is however needed in the CombinationImageToImageMetric.
    * In that case, you need to:
    * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
-   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
-   *   calling GetValueAndDerivative
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before calling GetValue
    * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
-   * - Now you can call GetValueAndDerivative multi-threaded.
+   * - Now you can call GetValue multi-threaded.
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  /** The random generator is not thread-safe, so draw the positions here. */
+  this->SampleRandomLastDimensionPositions();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  /** Launch multi-threading metric */
+  this->ExecuteThreaderCallback( this->GetValueThreaderCallback );
+
+  /** Gather the metric values from all threads. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  this->AfterThreadedGetValue( value );
+
+  return value;
+
+} // end GetValue()
 
-  /** Retrieve slowest varying dimension and its size. */
-  const unsigned int lastDim           = this->GetFixedImage()->GetImageDimension() - 1;
-  const unsigned int lastDimSize       = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
-  const unsigned int numLastDimSamples = this->m_NumSamplesLastDimension;
 
-  /** Vector containing last dimension positions to use:
-   * initialize on all positions when random sampling turned off.
+/**
+ * ******************* ExecuteThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::ExecuteThreaderCallback( ThreaderCallbackType callback ) const
+{
+  void * userData = const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) );
+
+  /** Without multi-threading, run the parts of all threads one after the
+   * other, so that both settings share the same code and partitioning.
    */
-  std::vector< int > lastDimPositions;
-  if( !this->m_SampleLastDimensionRandomly )
+  if( !this->m_UseMultiThread )
   {
-    for( unsigned int i = 0; i < lastDimSize; ++i )
+    ThreadInfoType threadInfo;
+    threadInfo.NumberOfWorkUnits = Self::GetNumberOfWorkUnits();
+    threadInfo.UserData          = userData;
+    for( ThreadIdType i = 0; i < threadInfo.NumberOfWorkUnits; ++i )
     {
-      lastDimPositions.push_back( i );
+      threadInfo.WorkUnitID = i;
+      callback( &threadInfo );
     }
+    return;
   }
 
+  /** Setup threader and launch. */
+  this->m_Threader->SetSingleMethod( callback, userData );
+  this->m_Threader->SingleMethodExecute();
+
+} // end ExecuteThreaderCallback()
+
+
+/**
+ * ******************* ThreadedGetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValue( ThreadIdType threadId )
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator threader_fiter;
+  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
+
+  threader_fbegin += (int)pos_begin;
+  threader_fend   += (int)pos_end;
+
+  /** Retrieve slowest varying dimension. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure               = NumericTraits< MeasureType >::Zero;
+
   /** Loop over the fixed image samples to calculate the variance over time for every sample position. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  unsigned long sampleIndex = pos_begin;
+  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter, ++sampleIndex )
   {
     /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    FixedImagePointType fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
 
-    /** Determine random last dimension positions if needed. */
-    if( this->m_SampleLastDimensionRandomly )
-    {
-      this->SampleRandom( numLastDimSamples, lastDimSize, lastDimPositions );
-    }
+    /** Get the last dimension positions for this sample. */
+    const std::vector< int > & lastDimPositions = this->GetLastDimensionPositions( sampleIndex );
 
     /** Transform sampled point to voxel coordinates. */
     FixedImageContinuousIndexType voxelCoord;
@@ -308,7 +503,7 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
 
     if( numSamplesOk > 0 )
     {
-      this->m_NumberOfPixelsCounted++;
+      numberOfPixelsCounted++;
 
       /** Add this variance to the variance sum. */
       const float expectedValue        = sumValues / static_cast< float >( numSamplesOk );
@@ -318,19 +513,46 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
 
   } // end for loop over the image sample container
 
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 = measure;
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ******************* AfterThreadedGetValue *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValue( MeasureType & value ) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Accumulate the number of pixels and the sum of variances. */
+  this->m_NumberOfPixelsCounted = 0;
+  value                         = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted;
+    value                         += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+
+    /** Reset these variables for the next iteration. */
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = 0;
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value                 = NumericTraits< MeasureType >::Zero;
+  }
+
   /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
   this->CheckNumberOfSamples(
     sampleContainer->Size(), this->m_NumberOfPixelsCounted );
 
-  /** Compute average over variances. */
-  measure /= static_cast< float >( this->m_NumberOfPixelsCounted );
-  /** Normalize with initial variance. */
-  measure /= this->m_InitialVariance;
-
-  /** Return the mean squares measure value. */
-  return measure;
+  /** Compute average over variances and normalize with initial variance. */
+  value /= static_cast< float >( this->m_NumberOfPixelsCounted * this->m_InitialVariance );
 
-} // end GetValue()
+} // end AfterThreadedGetValue()
 
 
 /**
@@ -364,17 +586,6 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
 ::GetValueAndDerivative( const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
-  itkDebugMacro( "GetValueAndDerivative( " << parameters << " ) " );
-
-  /** Define derivative and Jacobian types. */
-  typedef typename DerivativeType::ValueType DerivativeValueType;
-
-  /** Initialize some variables */
-  this->m_NumberOfPixelsCounted = 0;
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
-  derivative = DerivativeType( this->GetNumberOfParameters() );
-  derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
-
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
    *   this->GetImageSampler()->Update();
@@ -390,40 +601,78 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
+  /** The random generator is not thread-safe, so draw the positions here. */
+  this->SampleRandomLastDimensionPositions();
+
+  /** For a StackTransform, let each thread handle whole time points. */
+  if( this->UseSlicePartitioning() )
+  {
+    return this->GetValueAndDerivativePerSlice( value, derivative );
+  }
+
+  /** Launch multi-threading metric */
+  this->ExecuteThreaderCallback( this->GetValueAndDerivativeThreaderCallback );
+
+  /** Gather the metric values and derivatives from all threads. */
+  this->AfterThreadedGetValueAndDerivative( value, derivative );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivative( ThreadIdType threadId )
+{
+  /** Define derivative and Jacobian types. */
+  typedef typename DerivativeType::ValueType DerivativeValueType;
+
+  /** Get a handle to the pre-allocated derivative for the current thread.
+   * The initialization is performed at the beginning of each resolution in
+   * InitializeThreadingParameters(), and at the end of each iteration in
+   * AfterThreadedGetValueAndDerivative() and the accumulate functions.
+   */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
+
   /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
 
   /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  typename ImageSampleContainerType::ConstIterator threader_fiter;
+  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
 
-  /** Retrieve slowest varying dimension and its size. */
-  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
-  const unsigned int lastDimSize
-    = this->GetFixedImage()->GetLargestPossibleRegion().GetSize( lastDim );
+  threader_fbegin += (int)pos_begin;
+  threader_fend   += (int)pos_end;
 
-  /** Vector containing last dimension positions to use:
-   * initialize on all positions when random sampling turned off.
-   */
-  std::vector< int > lastDimPositions;
-  if( !this->m_SampleLastDimensionRandomly )
-  {
-    for( unsigned int i = 0; i < lastDimSize; ++i )
-    {
-      lastDimPositions.push_back( i );
-    }
-  }
+  /** Retrieve slowest varying dimension. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
 
   /** Create variables to store intermediate results in. */
-  TransformJacobianType jacobian;
-  DerivativeType        imageJacobian( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  TransformJacobianType        jacobian;
+  DerivativeType               imageJacobian( nnzji );
 
   /** Get real last dim samples. */
   const unsigned int realNumLastDimPositions
     = this->m_SampleLastDimensionRandomly
     ? this->m_NumSamplesLastDimension + this->m_NumAdditionalSamplesFixed
-    : lastDimSize;
+    : this->m_LastDimPositions.size();
 
   /** Variable to store and nzjis. */
   std::vector< NonZeroJacobianIndicesType > nzjis(
@@ -432,17 +681,19 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
   std::vector< RealType >       MT( realNumLastDimPositions );
   std::vector< DerivativeType > dMTdmu( realNumLastDimPositions );
 
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure               = NumericTraits< MeasureType >::Zero;
+
   /** Loop over the fixed image samples to calculate the variance over time for every sample position. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  unsigned long sampleIndex = pos_begin;
+  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter, ++sampleIndex )
   {
     /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    FixedImagePointType fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
 
-    /** Determine random last dimension positions if needed. */
-    if( this->m_SampleLastDimensionRandomly )
-    {
-      this->SampleRandom( this->m_NumSamplesLastDimension, lastDimSize, lastDimPositions );
-    }
+    /** Get the last dimension positions for this sample. */
+    const std::vector< int > & lastDimPositions = this->GetLastDimensionPositions( sampleIndex );
 
     /** Initialize MT vector. */
     std::fill( MT.begin(), MT.end(), itk::NumericTraits< RealType >::ZeroValue() );
@@ -505,15 +756,15 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
       }
       else
       {
-        dMTdmu[ d ] = DerivativeType( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+        dMTdmu[ d ] = DerivativeType( nnzji );
         dMTdmu[ d ].Fill( itk::NumericTraits< DerivativeValueType >::ZeroValue() );
-        nzjis[ d ] = NonZeroJacobianIndicesType( this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices(), 0 );
+        nzjis[ d ] = NonZeroJacobianIndicesType( nnzji, 0 );
       } // end if sampleOk
     }
 
     if( numSamplesOk > 0 )
     {
-      this->m_NumberOfPixelsCounted++;
+      numberOfPixelsCounted++;
 
       /** Compute average intensity value. */
       const float expectedValue = sumValues / static_cast< float >( numSamplesOk );
@@ -524,96 +775,360 @@ VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
       /** Second loop over t: update derivative. */
       for( unsigned int d = 0; d < realNumLastDimPositions; ++d )
       {
+        const DerivativeValueType factor = 2.0 * ( MT[ d ] - expectedValue ) / static_cast< float >( numSamplesOk );
         for( unsigned int j = 0; j < nzjis[ d ].size(); ++j )
         {
-          derivative[ nzjis[ d ][ j ] ] += ( 2.0 * ( MT[ d ] - expectedValue ) * dMTdmu[ d ][ j ] )
-            / static_cast< float >( numSamplesOk );
+          derivative[ nzjis[ d ][ j ] ] += factor * dMTdmu[ d ][ j ];
         }
       }
-
     }
   } // end for loop over the image sample container
 
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 = measure;
 
-  /** Compute average over variances and normalize with initial variance. */
-  measure    /= static_cast< float >( this->m_NumberOfPixelsCounted * this->m_InitialVariance );
-  derivative /= static_cast< float >( this->m_NumberOfPixelsCounted * this->m_InitialVariance );
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::AfterThreadedGetValueAndDerivative(
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Gather the number of pixels and the value, and check the number of samples. */
+  this->AfterThreadedGetValue( value );
+
+  /** Accumulate derivatives and normalize with the same factor as the value. */
+  derivative.SetSize( this->GetNumberOfParameters() );
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor
+    = static_cast< float >( this->m_NumberOfPixelsCounted * this->m_InitialVariance );
+
+  this->ExecuteThreaderCallback( this->AccumulateDerivativesThreaderCallback );
+
+  /** Subtract mean from derivative elements. */
+  if( this->m_SubtractMean )
+  {
+    this->SubtractMeanFromDerivative( derivative );
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* UseSlicePartitioning *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::UseSlicePartitioning( void ) const
+{
+  /** With random sampling the positions differ per sample, and with fewer
+   * positions than threads some threads would be idle.
+   */
+  return this->m_TransformIsStackTransform
+         && !this->m_SampleLastDimensionRandomly
+         && this->m_LastDimPositions.size() >= Self::GetNumberOfWorkUnits();
+
+} // end UseSlicePartitioning()
+
+
+/**
+ * ******************* GetValueAndDerivativePerSlice *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivativePerSlice( MeasureType & value, DerivativeType & derivative ) const
+{
+  /** Allocate the per sample and position buffers. */
+  const unsigned long numberOfSamples      = this->GetImageSampler()->GetOutput()->Size();
+  const std::size_t   numberOfSliceSamples = numberOfSamples * this->m_LastDimPositions.size();
+  this->m_SliceSampleValues.resize( numberOfSliceSamples );
+  this->m_SliceSampleDerivatives.resize( numberOfSliceSamples );
+  this->m_SliceSampleIsValid.resize( numberOfSliceSamples );
+  this->m_SampleMeans.resize( numberOfSamples );
+  this->m_SampleNumberOfValidPositions.resize( numberOfSamples );
+
+  /** Compute the values, partitioned over the samples. */
+  this->ExecuteThreaderCallback( this->GetSliceSampleValuesThreaderCallback );
+
+  /** Gather the number of pixels and the value, and check the number of samples. */
+  this->AfterThreadedGetValue( value );
+
+  /** Compute the derivative, partitioned over the positions. The threads
+   * write directly into disjoint parts of the derivative.
+   */
+  derivative.SetSize( this->GetNumberOfParameters() );
+  derivative.Fill( NumericTraits< typename DerivativeType::ValueType >::ZeroValue() );
+  this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor
+    = static_cast< float >( this->m_NumberOfPixelsCounted * this->m_InitialVariance );
+
+  this->ExecuteThreaderCallback( this->ComputeSliceDerivativeThreaderCallback );
 
   /** Subtract mean from derivative elements. */
   if( this->m_SubtractMean )
   {
-    if( !this->m_TransformIsStackTransform )
+    this->SubtractMeanFromDerivative( derivative );
+  }
+
+} // end GetValueAndDerivativePerSlice()
+
+
+/**
+ * ******************* ThreadedGetSliceSampleValues *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetSliceSampleValues( ThreadIdType threadId )
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Get the samples for this thread. */
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
+  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator threader_fiter;
+  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
+
+  threader_fbegin += (int)pos_begin;
+  threader_fend   += (int)pos_end;
+
+  /** Retrieve slowest varying dimension and the positions. */
+  const unsigned int         lastDim          = this->GetFixedImage()->GetImageDimension() - 1;
+  const std::vector< int > & lastDimPositions = this->m_LastDimPositions;
+  const unsigned int         numPositions     = lastDimPositions.size();
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure               = NumericTraits< MeasureType >::Zero;
+
+  /** Loop over the fixed image samples to compute the values and moving image
+   * derivatives over time for every sample position.
+   */
+  unsigned long sampleIndex = pos_begin;
+  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter, ++sampleIndex )
+  {
+    /** Read fixed coordinates. */
+    FixedImagePointType fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
+
+    /** Transform sampled point to voxel coordinates. */
+    FixedImageContinuousIndexType voxelCoord;
+    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
+
+    /** Loop over the slowest varying dimension. */
+    float        sumValues        = 0.0;
+    float        sumValuesSquared = 0.0;
+    unsigned int numSamplesOk     = 0;
+    std::size_t  k                = sampleIndex * numPositions;
+    for( unsigned int d = 0; d < numPositions; ++d, ++k )
     {
-      /** Update derivative per dimension.
-      * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
-      * per dimension xyz.
-      */
-      const unsigned int lastDimGridSize              = this->m_GridSize[ lastDim ];
-      const unsigned int numParametersPerDimension    = this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
-      const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
-      DerivativeType     mean( numControlPointsPerDimension );
-      for( unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d )
+      /** Initialize some variables. */
+      RealType             movingImageValue;
+      MovingImagePointType mappedPoint;
+
+      /** Set fixed point's last dimension to lastDimPosition. */
+      voxelCoord[ lastDim ] = lastDimPositions[ d ];
+
+      /** Transform sampled point back to world coordinates. */
+      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
+
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+
+      /** Check if point is inside mask. */
+      if( sampleOk )
       {
-        /** Compute mean per dimension. */
-        mean.Fill( 0.0 );
-        const unsigned int starti = numParametersPerDimension * d;
-        for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          mean[ index ] += derivative[ i ];
-        }
-        mean /= static_cast< double >( lastDimGridSize );
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
 
-        /** Update derivative for every control point per dimension. */
-        for( unsigned int i = starti; i < starti + numParametersPerDimension; ++i )
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          derivative[ i ] -= mean[ index ];
-        }
+      /** Compute the moving image value and derivative, and check if the
+       * point is inside the moving image buffer.
+       */
+      if( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(
+          mappedPoint, movingImageValue, &this->m_SliceSampleDerivatives[ k ] );
       }
-    }
-    else
+
+      this->m_SliceSampleIsValid[ k ] = sampleOk;
+      if( sampleOk )
+      {
+        numSamplesOk++;
+        sumValues                      += movingImageValue;
+        sumValuesSquared               += movingImageValue * movingImageValue;
+        this->m_SliceSampleValues[ k ]  = movingImageValue;
+      } // end if sampleOk
+    } // end for loop over last dimension
+
+    this->m_SampleNumberOfValidPositions[ sampleIndex ] = numSamplesOk;
+    if( numSamplesOk > 0 )
     {
-      /** Update derivative per dimension.
-      * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
-      * the number the time point index.
-      */
-      const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / lastDimSize;
-      DerivativeType     mean( numParametersPerLastDimension );
-      mean.Fill( 0.0 );
+      numberOfPixelsCounted++;
 
-      /** Compute mean per control point. */
-      for( unsigned int t = 0; t < lastDimSize; ++t )
+      /** Add this variance to the variance sum. */
+      const float expectedValue        = sumValues / static_cast< float >( numSamplesOk );
+      const float expectedSquaredValue = sumValuesSquared / static_cast< float >( numSamplesOk );
+      measure                         += expectedSquaredValue - expectedValue * expectedValue;
+      this->m_SampleMeans[ sampleIndex ] = expectedValue;
+    }
+
+  } // end for loop over the image sample container
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value                 = measure;
+
+} // end ThreadedGetSliceSampleValues()
+
+
+/**
+ * ******************* ThreadedComputeSliceDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeSliceDerivative( ThreadIdType threadId )
+{
+  typedef typename DerivativeType::ValueType DerivativeValueType;
+
+  /** Get the positions for this thread. */
+  const std::vector< int > & lastDimPositions = this->m_LastDimPositions;
+  const unsigned int         numPositions     = lastDimPositions.size();
+  const unsigned int         nrOfPositionsPerThreads
+    = static_cast< unsigned int >( std::ceil( static_cast< double >( numPositions )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  unsigned int d_begin = nrOfPositionsPerThreads * threadId;
+  unsigned int d_end   = nrOfPositionsPerThreads * ( threadId + 1 );
+  d_begin = ( d_begin > numPositions ) ? numPositions : d_begin;
+  d_end   = ( d_end > numPositions ) ? numPositions : d_end;
+
+  /** Get a handle to the sample container and the derivative. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+
+  DerivativeValueType *     derivative    = this->m_ThreaderMetricParameters.st_DerivativePointer;
+  const DerivativeValueType normalization = 1.0 / this->m_ThreaderMetricParameters.st_NormalizationFactor;
+
+  /** Retrieve slowest varying dimension. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+
+  /** Create variables to store intermediate results in. */
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  TransformJacobianType        jacobian;
+  NonZeroJacobianIndicesType   nzji( nnzji );
+  DerivativeType               imageJacobian( nnzji );
+
+  /** Loop over the positions of this thread, and for each position over all
+   * samples, so that only the sub-transform of that position is evaluated.
+   */
+  for( unsigned int d = d_begin; d < d_end; ++d )
+  {
+    unsigned long sampleIndex = 0;
+    for( fiter = fbegin; fiter != fend; ++fiter, ++sampleIndex )
+    {
+      const unsigned int numSamplesOk = this->m_SampleNumberOfValidPositions[ sampleIndex ];
+      const std::size_t  k            = sampleIndex * numPositions + d;
+      if( numSamplesOk == 0 || !this->m_SliceSampleIsValid[ k ] )
       {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
-        {
-          const unsigned int index = c % numParametersPerLastDimension;
-          mean[ index ] += derivative[ c ];
-        }
+        continue;
       }
-      mean /= static_cast< double >( lastDimSize );
 
-      /** Update derivative per control point. */
-      for( unsigned int t = 0; t < lastDimSize; ++t )
+      /** Set fixed point's last dimension to lastDimPosition. */
+      FixedImagePointType           fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+      FixedImageContinuousIndexType voxelCoord;
+      this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
+      voxelCoord[ lastDim ] = lastDimPositions[ d ];
+      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
+
+      /** Get the TransformJacobian dT/dmu. */
+      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+
+      /** Compute the innerproduct (dM/dx)^T (dT/dmu). */
+      this->EvaluateTransformJacobianInnerProduct(
+        jacobian, this->m_SliceSampleDerivatives[ k ], imageJacobian );
+
+      /** Update the derivative, including the normalization. */
+      const DerivativeValueType factor
+        = 2.0 * ( this->m_SliceSampleValues[ k ] - this->m_SampleMeans[ sampleIndex ] )
+        / static_cast< float >( numSamplesOk ) * normalization;
+      for( unsigned int j = 0; j < nzji.size(); ++j )
       {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for( unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c )
-        {
-          const unsigned int index = c % numParametersPerLastDimension;
-          derivative[ c ] -= mean[ index ];
-        }
+        derivative[ nzji[ j ] ] += factor * imageJacobian[ j ];
       }
     }
   }
 
-  /** Return the measure value. */
-  value = measure;
+} // end ThreadedComputeSliceDerivative()
 
-} // end GetValueAndDerivative()
+
+/**
+ * ******************* GetSliceSampleValuesThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::GetSliceSampleValuesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  typename Superclass::MultiThreaderParameterType * temp
+    = static_cast< typename Superclass::MultiThreaderParameterType * >( infoStruct->UserData );
+
+  static_cast< Self * >( temp->st_Metric )->ThreadedGetSliceSampleValues( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GetSliceSampleValuesThreaderCallback()
+
+
+/**
+ * ******************* ComputeSliceDerivativeThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+VarianceOverLastDimensionImageMetric< TFixedImage, TMovingImage >
+::ComputeSliceDerivativeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  typename Superclass::MultiThreaderParameterType * temp
+    = static_cast< typename Superclass::MultiThreaderParameterType * >( infoStruct->UserData );
+
+  static_cast< Self * >( temp->st_Metric )->ThreadedComputeSliceDerivative( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeSliceDerivativeThreaderCallback()
 
 
 } // end namespace itk
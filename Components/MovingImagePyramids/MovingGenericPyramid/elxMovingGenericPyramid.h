@@ -65,6 +65,18 @@ namespace elastix
  *    for rescaling the image, or the ResampleImageFilter. Shrinker is faster.\n
  *    example: <tt>(ImagePyramidUseShrinkImageFilter "true")</tt>\n
  *    Default false, so by default the resampler is used.
+ * \parameter ImagePyramidUseCascadedLevels: Flag to specify if a resolution level may be computed
+ *    from the next finer level, instead of from the full resolution image. This is only done when
+ *    the rescale factors of the coarser level are multiples of those of the finer level, and the
+ *    smoothing sigmas are not smaller. The sigmas are corrected accordingly. Not used in combination
+ *    with ComputePyramidImagesPerResolution.\n
+ *    example: <tt>(ImagePyramidUseCascadedLevels "true")</tt>\n
+ *    Default false.
+ * \parameter ImagePyramidComputeLevelsInParallel: Flag to specify if resolution levels that are
+ *    computed from the full resolution image are computed concurrently. Not used in combination
+ *    with ComputePyramidImagesPerResolution.\n
+ *    example: <tt>(ImagePyramidComputeLevelsInParallel "true")</tt>\n
+ *    Default false.
  *
  * \ingroup ImagePyramids
  */
@@ -129,6 +141,9 @@ public:
   /** Update the current resolution level. */
   void BeforeEachResolution( void ) override;
 
+  /** Report the memory used for computing the pyramid. */
+  void AfterEachResolution( void ) override;
+
 protected:
 
   /** The constructor. */
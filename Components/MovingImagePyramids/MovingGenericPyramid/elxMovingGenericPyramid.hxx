@@ -153,6 +153,19 @@ MovingGenericPyramid< TElastix >
     "ComputePyramidImagesPerResolution", 0, false );
   this->SetComputeOnlyForCurrentLevel( computeThisResolution );
 
+  /** Decide whether or not to compute coarser levels from finer levels,
+   * and whether or not to compute independent levels concurrently.
+   */
+  bool useCascadedLevels = false;
+  this->m_Configuration->ReadParameter( useCascadedLevels,
+    "ImagePyramidUseCascadedLevels", 0, false );
+  this->SetUseCascadedLevels( useCascadedLevels );
+
+  bool computeLevelsInParallel = false;
+  this->m_Configuration->ReadParameter( computeLevelsInParallel,
+    "ImagePyramidComputeLevelsInParallel", 0, false );
+  this->SetComputeLevelsInParallel( computeLevelsInParallel );
+
 } // end SetMovingSchedule()
 
 
@@ -177,6 +190,26 @@ MovingGenericPyramid< TElastix >
 } // end BeforeEachResolution()
 
 
+/**
+ * ******************* AfterEachResolution ***********************
+ */
+
+template< class TElastix >
+void
+MovingGenericPyramid< TElastix >
+::AfterEachResolution( void )
+{
+  /** When all levels are computed at once, the memory is reported only once. */
+  const unsigned int level = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+  if( !this->GetComputeOnlyForCurrentLevel() && level > 0 ) { return; }
+
+  elxout << "  Peak memory used for computing the moving image pyramid: "
+         << static_cast< double >( this->GetPeakMemoryUsage() ) / 1048576.0
+         << " MB." << std::endl;
+
+} // end AfterEachResolution()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxMovingGenericPyramid_hxx
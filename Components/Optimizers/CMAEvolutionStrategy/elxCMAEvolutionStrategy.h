@@ -106,7 +106,18 @@ namespace elastix
  *    covariance matrix is updated. If 0, the optimizer estimates a value. The actual value used is
  *    reported back in the elastix.log file. This parameter can be specified for each resolution. \n
  *    example: <tt>(UpdateBDPeriod 0 0 50)</tt> \n
- *    Default: 0 (so, automatically determined).
+ *    Default: 0 (so, automatically determined).\n
+ * \parameter UseMultiThreadingForCovarianceMatrixAdaptation: whether the search directions of the
+ *    offspring and the covariance matrix update are computed multi-threaded. The cost function
+ *    values are still computed one after the other. The number of threads is set by the -threads
+ *    command line argument.\n
+ *    example: <tt>(UseMultiThreadingForCovarianceMatrixAdaptation "true")</tt> \n
+ *    Default: "false". Can be specified for each resolution.\n
+ * \parameter UseAsynchronousEigenDecomposition: whether the eigendecomposition of the covariance
+ *    matrix is computed in a separate thread, while the next generation is evaluated. That generation
+ *    then uses the eigendecomposition of one iteration earlier. Useful for large numbers of parameters.\n
+ *    example: <tt>(UseAsynchronousEigenDecomposition "true")</tt> \n
+ *    Default: "false". Can be specified for each resolution.
  *
  * \ingroup Optimizers
  */
@@ -208,6 +208,27 @@ CMAEvolutionStrategy< TElastix >
     "MinimumDeviation", this->GetComponentLabel(), level, 0 );
   this->SetMinimumDeviation( minimumDeviation );
 
+  /** Set UseMultiThreadingForCovarianceMatrixAdaptation */
+  bool useMultiThread = false;
+  this->m_Configuration->ReadParameter( useMultiThread,
+    "UseMultiThreadingForCovarianceMatrixAdaptation", this->GetComponentLabel(), level, 0 );
+  this->SetUseMultiThread( useMultiThread );
+  if( useMultiThread )
+  {
+    std::string tmp = this->m_Configuration->GetCommandLineArgument( "-threads" );
+    if( tmp != "" )
+    {
+      const unsigned int nrOfThreads = atoi( tmp.c_str() );
+      this->SetNumberOfWorkUnits( nrOfThreads );
+    }
+  }
+
+  /** Set UseAsynchronousEigenDecomposition */
+  bool useAsynchronousEigenDecomposition = false;
+  this->m_Configuration->ReadParameter( useAsynchronousEigenDecomposition,
+    "UseAsynchronousEigenDecomposition", this->GetComponentLabel(), level, 0 );
+  this->SetUseAsynchronousEigenDecomposition( useAsynchronousEigenDecomposition );
+
 } // end BeforeEachResolution
 
 
@@ -77,9 +77,25 @@ CMAEvolutionStrategyOptimizer::CMAEvolutionStrategyOptimizer()
   this->m_PositionToleranceMax       = 1e8;
   this->m_ValueTolerance             = 1e-12;
 
+  this->m_Threader                          = ThreaderType::New();
+  this->m_UseMultiThread                    = false;
+  this->m_UseAsynchronousEigenDecomposition = false;
+
 } // end constructor
 
 
+/**
+ * ******************** Destructor *************************
+ */
+
+CMAEvolutionStrategyOptimizer::~CMAEvolutionStrategyOptimizer()
+{
+  /** Wait for a running eigendecomposition, which writes to member data. */
+  this->DiscardPendingEigenDecomposition();
+
+} // end destructor
+
+
 /**
  * ******************* PrintSelf *********************
  */
@@ -125,6 +141,9 @@ CMAEvolutionStrategyOptimizer::PrintSelf( std::ostream & os, Indent indent ) con
   os << indent << "m_PositionToleranceMin: " << this->m_PositionToleranceMin << std::endl;
   os << indent << "m_PositionToleranceMax: " << this->m_PositionToleranceMax << std::endl;
   os << indent << "m_ValueTolerance: " << this->m_ValueTolerance << std::endl;
+  os << indent << "m_UseMultiThread: " << this->m_UseMultiThread << std::endl;
+  os << indent << "m_UseAsynchronousEigenDecomposition: "
+     << this->m_UseAsynchronousEigenDecomposition << std::endl;
 
   os << indent << "m_RecombinationWeights: " << this->m_RecombinationWeights << std::endl;
   os << indent << "m_C: " << this->m_C << std::endl;
@@ -151,6 +170,7 @@ CMAEvolutionStrategyOptimizer::StartOptimization()
   this->m_CurrentIteration = 0;
   this->m_Stop             = false;
   this->m_StopCondition    = Unknown;
+  this->DiscardPendingEigenDecomposition();
 
   /** Get the number of parameters; checks also if a cost function has been set at all.
   * if not: an exception is thrown */
@@ -273,6 +293,7 @@ CMAEvolutionStrategyOptimizer::StopOptimization()
 {
   itkDebugMacro( "StopOptimization" );
   this->m_Stop = true;
+  this->DiscardPendingEigenDecomposition();
   this->InvokeEvent( EndEvent() );
 } // end StopOptimization()
 
@@ -512,28 +533,52 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
   /** Clear the old values */
   this->m_CostFunctionValues.clear();
 
+  /** In the multi-threaded case, draw all realisations of N(0,I) first, in the
+   * same order as the single-threaded case, and compute the search directions
+   * in parallel. */
+  if( this->m_UseMultiThread )
+  {
+    for( unsigned int lam = 0; lam < lambda; ++lam )
+    {
+      for( unsigned int par = 0; par < N; ++par )
+      {
+        this->m_NormalizedSearchDirs[ lam ][ par ]
+          = this->m_RandomGenerator->GetNormalVariate();
+      }
+    }
+
+    MultiThreaderParameterType temp;
+    temp.t_Optimizer = this;
+    this->m_Threader->SetSingleMethod( ComputeSearchDirsThreaderCallback, &temp );
+    this->m_Threader->SingleMethodExecute();
+  }
+
   /** Fill the m_NormalizedSearchDirs and SearchDirs */
   unsigned int lam       = 0;
   unsigned int nrOfFails = 0;
   while( lam < lambda )
   {
-    /** draw from distribution N(0,I) */
-    for( unsigned int par = 0; par < N; ++par )
+    /** A failed evaluation is retried with a new sample, also in the multi-threaded case. */
+    if( !this->m_UseMultiThread || nrOfFails > 0 )
     {
-      this->m_NormalizedSearchDirs[ lam ][ par ]
-        = this->m_RandomGenerator->GetNormalVariate();
-    }
-    /** Make like it was drawn from N(0,C) */
-    if( this->GetUseCovarianceMatrixAdaptation() )
-    {
-      this->m_SearchDirs[ lam ] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[ lam ] );
-    }
-    else
-    {
-      this->m_SearchDirs[ lam ] = this->m_NormalizedSearchDirs[ lam ];
+      /** draw from distribution N(0,I) */
+      for( unsigned int par = 0; par < N; ++par )
+      {
+        this->m_NormalizedSearchDirs[ lam ][ par ]
+          = this->m_RandomGenerator->GetNormalVariate();
+      }
+      /** Make like it was drawn from N(0,C) */
+      if( this->GetUseCovarianceMatrixAdaptation() )
+      {
+        this->m_SearchDirs[ lam ] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[ lam ] );
+      }
+      else
+      {
+        this->m_SearchDirs[ lam ] = this->m_NormalizedSearchDirs[ lam ];
+      }
+      /** Make like it was drawn from N( 0, sigma^2 C ) */
+      this->m_SearchDirs[ lam ] *= this->m_CurrentSigma;
     }
-    /** Make like it was drawn from N( 0, sigma^2 C ) */
-    this->m_SearchDirs[ lam ] *= this->m_CurrentSigma;
 
     /** Compute the cost function */
     MeasureType costFunctionValue = 0.0;
@@ -573,6 +618,60 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
 } // end GenerateOffspring
 
 
+/**
+ * ************ ComputeSearchDirsThreaderCallback *********************
+ */
+
+ITK_THREAD_RETURN_TYPE
+CMAEvolutionStrategyOptimizer::ComputeSearchDirsThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                 threadID   = infoStruct->WorkUnitID;
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  /** Call the real implementation. */
+  temp->t_Optimizer->ThreadedComputeSearchDirs( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeSearchDirsThreaderCallback()
+
+
+/**
+ * ****************** ThreadedComputeSearchDirs *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::ThreadedComputeSearchDirs( ThreadIdType threadId )
+{
+  /** Compute the range of offspring for this thread. */
+  const unsigned int lambda  = this->m_PopulationSize;
+  const unsigned int subSize = static_cast< unsigned int >(
+    std::ceil( static_cast< double >( lambda )
+    / static_cast< double >( this->m_Threader->GetNumberOfWorkUnits() ) ) );
+  const unsigned int lam_begin = std::min< unsigned int >( threadId * subSize, lambda );
+  const unsigned int lam_end   = std::min< unsigned int >( ( threadId + 1 ) * subSize, lambda );
+
+  for( unsigned int lam = lam_begin; lam < lam_end; ++lam )
+  {
+    /** Make like it was drawn from N(0,C) */
+    if( this->GetUseCovarianceMatrixAdaptation() )
+    {
+      this->m_SearchDirs[ lam ] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[ lam ] );
+    }
+    else
+    {
+      this->m_SearchDirs[ lam ] = this->m_NormalizedSearchDirs[ lam ];
+    }
+    /** Make like it was drawn from N( 0, sigma^2 C ) */
+    this->m_SearchDirs[ lam ] *= this->m_CurrentSigma;
+  }
+
+} // end ThreadedComputeSearchDirs()
+
+
 /**
  * ****************** SortCostFunctionValues *********************
  */
@@ -758,10 +857,39 @@ CMAEvolutionStrategyOptimizer::UpdateC( void )
   {
     oldCfactor += ( c_cov * c_c * ( 2.0 - c_c ) / mu_cov );
   }
+  const double rankonefactor = c_cov / mu_cov;
+  const double rankmufactor  = c_cov * ( 1.0 - 1.0 / mu_cov );
+
+  /** Multi-threaded: all updates at once, in parallel over the rows of C. */
+  if( this->m_UseMultiThread )
+  {
+    /** Store the weighted search directions per parameter, so that the
+     * rank-mu update of each element is a dot product of two rows. */
+    this->m_WeightedSearchDirs.SetSize( N, mu );
+    for( unsigned int m = 0; m < mu; ++m )
+    {
+      const unsigned int     lam       = this->m_CostFunctionValues[ m ].second;
+      const double           factor    = std::sqrt( this->m_RecombinationWeights[ m ] ) / sigma;
+      const ParametersType & searchDir = this->m_SearchDirs[ lam ];
+      for( unsigned int i = 0; i < N; ++i )
+      {
+        this->m_WeightedSearchDirs[ i ][ m ] = factor * searchDir[ i ];
+      }
+    }
+
+    MultiThreaderParameterType temp;
+    temp.t_Optimizer     = this;
+    temp.t_OldCFactor    = oldCfactor;
+    temp.t_RankOneFactor = rankonefactor;
+    temp.t_RankMuFactor  = rankmufactor;
+    this->m_Threader->SetSingleMethod( UpdateCThreaderCallback, &temp );
+    this->m_Threader->SingleMethodExecute();
+    return;
+  }
+
   this->m_C *= oldCfactor;
 
   /** Do rank-one update */
-  const double rankonefactor = c_cov / mu_cov;
   for( unsigned int i = 0; i < N; ++i )
   {
     const double evolutionPath_i = this->m_EvolutionPath[ i ];
@@ -773,7 +901,6 @@ CMAEvolutionStrategyOptimizer::UpdateC( void )
   }
 
   /** Do rank-mu update */
-  const double rankmufactor = c_cov * ( 1.0 - 1.0 / mu_cov );
   for( unsigned int m = 0; m < mu; ++m )
   {
     const unsigned int lam               = this->m_CostFunctionValues[ m ].second;
@@ -794,6 +921,66 @@ CMAEvolutionStrategyOptimizer::UpdateC( void )
 } // end UpdateC
 
 
+/**
+ * ************ UpdateCThreaderCallback *********************
+ */
+
+ITK_THREAD_RETURN_TYPE
+CMAEvolutionStrategyOptimizer::UpdateCThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                 threadID   = infoStruct->WorkUnitID;
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  /** Call the real implementation. */
+  temp->t_Optimizer->ThreadedUpdateC( threadID, *temp );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end UpdateCThreaderCallback()
+
+
+/**
+ * ****************** ThreadedUpdateC *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::ThreadedUpdateC(
+  ThreadIdType threadId, const MultiThreaderParameterType & temp )
+{
+  const unsigned int N               = this->m_WeightedSearchDirs.rows();
+  const unsigned int mu              = this->m_WeightedSearchDirs.cols();
+  const unsigned int numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+
+  /** Only the upper triangle is computed, and mirrored. The rows are
+   * distributed cyclically over the threads, to balance the work. A thread
+   * only writes the upper triangle of its own rows and the mirrored lower
+   * triangle of its own columns, so there are no conflicts. */
+  for( unsigned int i = threadId; i < N; i += numberOfThreads )
+  {
+    const double * weightedSearchDir_i = this->m_WeightedSearchDirs[ i ];
+    const double   evolutionPath_i     = this->m_EvolutionPath[ i ];
+    for( unsigned int j = i; j < N; ++j )
+    {
+      const double * weightedSearchDir_j = this->m_WeightedSearchDirs[ j ];
+      double         rankmu              = 0.0;
+      for( unsigned int m = 0; m < mu; ++m )
+      {
+        rankmu += weightedSearchDir_i[ m ] * weightedSearchDir_j[ m ];
+      }
+      const double c_ij = temp.t_OldCFactor * this->m_C[ i ][ j ]
+        + temp.t_RankOneFactor * evolutionPath_i * this->m_EvolutionPath[ j ]
+        + temp.t_RankMuFactor * rankmu;
+      this->m_C[ i ][ j ] = c_ij;
+      this->m_C[ j ][ i ] = c_ij;
+    }
+  }
+
+} // end ThreadedUpdateC()
+
+
 /**
  * ****************** UpdateSigma *********************
  */
@@ -839,12 +1026,9 @@ CMAEvolutionStrategyOptimizer::UpdateBD( void )
   const unsigned int N      = numberOfParameters;
   const int          nextit = static_cast< int >( this->GetCurrentIteration() + 1 );
 
-  /** Update only every 'm_UpdateBDPeriod' iterations */
-  unsigned int periodover = nextit % this->m_UpdateBDPeriod;
-
-  if( !( this->GetUseCovarianceMatrixAdaptation() ) || ( periodover != 0 ) )
+  if( !( this->GetUseCovarianceMatrixAdaptation() ) )
   {
-    /** We don't need to update B and D */
+    /** We don't need B and D */
     return;
   }
 
@@ -853,11 +1037,49 @@ CMAEvolutionStrategyOptimizer::UpdateBD( void )
     EigenValueMatrixType,
     CovarianceMatrixType >                      EigenAnalysisType;
 
+  /** Collect an eigendecomposition that was started asynchronously in the
+   * previous update. */
+  unsigned int returncode = 0;
+  if( this->m_PendingEigenDecomposition.valid() )
+  {
+    returncode = this->m_PendingEigenDecomposition.get();
+    if( returncode != 0 )
+    {
+      itkExceptionMacro( << "EigenAnalysis failed while computing eigenvalue nr: " << returncode );
+    }
+    this->m_B = this->m_PendingB;
+    this->m_D = this->m_PendingD;
+    this->FinalizeBD();
+  }
+
+  /** Update only every 'm_UpdateBDPeriod' iterations */
+  unsigned int periodover = nextit % this->m_UpdateBDPeriod;
+  if( periodover != 0 )
+  {
+    /** We don't need to update B and D */
+    return;
+  }
+
+  /** Compute the eigendecomposition of a copy of C in a separate thread;
+   * it is collected in the next call of this function. */
+  if( this->m_UseAsynchronousEigenDecomposition )
+  {
+    this->m_PendingC = this->m_C;
+    this->m_PendingEigenDecomposition = std::async( std::launch::async, [ this, N ]()
+      {
+        EigenAnalysisType eigenAnalysis( N );
+        const unsigned int code = eigenAnalysis.ComputeEigenValuesAndVectors(
+          this->m_PendingC, this->m_PendingD, this->m_PendingB );
+        this->m_PendingB.inplace_transpose();
+        return code;
+      } );
+    return;
+  }
+
   /** In the itkEigenAnalysis only the upper triangle of the matrix will be accessed, so
    * we do not need to make sure the matrix is symmetric, like in the
    * matlab code. Just run the eigenAnalysis! */
   EigenAnalysisType eigenAnalysis( N );
-  unsigned int      returncode = 0;
   returncode = eigenAnalysis.ComputeEigenValuesAndVectors( this->m_C, this->m_D, this->m_B );
   if( returncode != 0 )
   {
@@ -867,6 +1089,22 @@ CMAEvolutionStrategyOptimizer::UpdateBD( void )
   /** itk eigen analysis returns eigen vectors in rows... */
   this->m_B.inplace_transpose();
 
+  this->FinalizeBD();
+
+} // end UpdateBD
+
+
+/**
+ * ****************** FinalizeBD *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::FinalizeBD( void )
+{
+  itkDebugMacro( "FinalizeBD" );
+
+  const unsigned int N = this->m_D.rows();
+
   /**  limit condition of C to 1e10 + 1, and avoid negative eigenvalues */
   const double largeNumber = 1e10;
   double       dmax        = this->m_D.diagonal().max_value();
@@ -907,7 +1145,23 @@ CMAEvolutionStrategyOptimizer::UpdateBD( void )
   this->m_CurrentMaximumD = this->m_D.diagonal().max_value();
   this->m_CurrentMinimumD = this->m_D.diagonal().min_value();
 
-} // end UpdateBD
+} // end FinalizeBD
+
+
+/**
+ * ************** DiscardPendingEigenDecomposition ****************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::DiscardPendingEigenDecomposition( void )
+{
+  if( this->m_PendingEigenDecomposition.valid() )
+  {
+    this->m_PendingEigenDecomposition.wait();
+    this->m_PendingEigenDecomposition = std::future< unsigned int >();
+  }
+
+} // end DiscardPendingEigenDecomposition()
 
 
 /**
@@ -23,10 +23,12 @@
 #include <vector>
 #include <utility>
 #include <deque>
+#include <future>
 
 #include "itkArray.h"
 #include "itkArray2D.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkPlatformMultiThreader.h"
 #include "vnl/vnl_diag_matrix.h"
 
 namespace itk
@@ -43,6 +45,17 @@ namespace itk
  *   - See also the Matlab code, cmaes.m, which you can download from the
  *     website mentioned above.
  *
+ * When UseMultiThread is set, the search directions of the offspring are
+ * computed in parallel, and the rank-one and rank-mu updates of the
+ * covariance matrix are computed in parallel over the rows of its upper
+ * triangle. The random numbers are still drawn sequentially, and the cost
+ * function is still evaluated sequentially, since it is not thread-safe.
+ *
+ * When UseAsynchronousEigenDecomposition is set, the eigendecomposition of
+ * the covariance matrix is computed in a separate thread, while the next
+ * generation is generated and evaluated. That generation is then sampled
+ * using B and D of the previous update, as if UpdateBDPeriod were one larger.
+ *
  * \ingroup Numerics Optimizers
  */
 
@@ -219,6 +232,22 @@ public:
   itkSetMacro( ValueTolerance, double );
   itkGetConstMacro( ValueTolerance, double );
 
+  /** Setting: whether the offspring generation and the covariance matrix
+   * update are multi-threaded. Default: false. */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+
+  /** Setting: whether the eigendecomposition of the covariance matrix is
+   * computed while the next generation is evaluated. Default: false. */
+  itkSetMacro( UseAsynchronousEigenDecomposition, bool );
+  itkGetConstMacro( UseAsynchronousEigenDecomposition, bool );
+
+  /** Set the number of threads. */
+  void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfWorkUnits( numberOfThreads );
+  }
+
 protected:
 
   typedef Array< double >               RecombinationWeightsType;
@@ -312,11 +341,29 @@ protected:
   /** D: sqrt(eigen values) */
   EigenValueMatrixType m_D;
 
+  /** Typedefs for multi-threading. */
+  typedef itk::PlatformMultiThreader ThreaderType;
+  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
+
+  ThreaderType::Pointer m_Threader;
+
+  /** The weighted search directions of the parents, divided by sigma,
+   * stored per parameter (N x mu), used by the threaded UpdateC. */
+  CovarianceMatrixType m_WeightedSearchDirs;
+
+  /** The eigendecomposition that is computed asynchronously, and the
+   * copy of C it is computed from. The future is declared after the
+   * matrices that the task writes, so that it is destroyed first. */
+  CovarianceMatrixType        m_PendingC;
+  CovarianceMatrixType        m_PendingB;
+  EigenValueMatrixType        m_PendingD;
+  std::future< unsigned int > m_PendingEigenDecomposition;
+
   /** Constructor */
   CMAEvolutionStrategyOptimizer();
 
   /** Destructor */
-  ~CMAEvolutionStrategyOptimizer() override{}
+  ~CMAEvolutionStrategyOptimizer() override;
 
   /** PrintSelf */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
@@ -382,6 +429,14 @@ protected:
   /** Update the eigen decomposition and m_CurrentMaximumD/m_CurrentMinimumD */
   virtual void UpdateBD( void );
 
+  /** Limit the condition of C, compute the square roots of the eigenvalues
+   * in m_D, and update m_CurrentMaximumD/m_CurrentMinimumD. Called by
+   * UpdateBD after the eigendecomposition. */
+  virtual void FinalizeBD( void );
+
+  /** Wait for an asynchronous eigendecomposition, and discard it. */
+  virtual void DiscardPendingEigenDecomposition( void );
+
   /** Some checks, to be sure no numerical errors occur
    * \li Adjust too low/high deviation that otherwise would violate
    * m_MinimumDeviation or m_MaximumDeviation.
@@ -422,6 +477,28 @@ private:
   double        m_PositionToleranceMax;
   double        m_PositionToleranceMin;
   double        m_ValueTolerance;
+  bool          m_UseMultiThread;
+  bool          m_UseAsynchronousEigenDecomposition;
+
+  /** Multi-threaded GenerateOffspring and UpdateC. */
+  struct MultiThreaderParameterType
+  {
+    Self * t_Optimizer;
+    double t_OldCFactor;
+    double t_RankOneFactor;
+    double t_RankMuFactor;
+  };
+
+  /** The callback functions. */
+  static ITK_THREAD_RETURN_TYPE ComputeSearchDirsThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE UpdateCThreaderCallback( void * arg );
+
+  /** The threaded implementation of the computation of the search directions. */
+  void ThreadedComputeSearchDirs( ThreadIdType threadId );
+
+  /** The threaded implementation of UpdateC(). */
+  void ThreadedUpdateC( ThreadIdType threadId, const MultiThreaderParameterType & temp );
 
 };
 
@@ -70,6 +70,13 @@ namespace elastix
  *   This flag can NOT be defined for each resolution. \n
  *   example: <tt>(ShowMetricValues "true" )</tt> \n
  *   Default value: "false". Note that turning this flag on increases computation time.
+ * \parameter UseConcurrentPerturbations: Whether the metric evaluates the perturbations of all
+ *   parameters in one call, concurrently and with the same samples. For transforms with a sparse
+ *   Jacobian, such as the B-spline, only the samples in the support of a parameter are then
+ *   recomputed. Metrics without support for concurrent evaluation evaluate them one after another.
+ *   Can be defined for each resolution. \n
+ *   example: <tt>(UseConcurrentPerturbations "true")</tt> \n
+ *   Default value: "false".
 
  *
  * \ingroup Optimizers
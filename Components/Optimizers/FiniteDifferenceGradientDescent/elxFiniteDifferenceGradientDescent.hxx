@@ -112,6 +112,12 @@ FiniteDifferenceGradientDescent< TElastix >
   this->SetParam_alpha( alpha );
   this->SetParam_gamma( gamma );
 
+  /** Set whether the perturbations are evaluated at once by the metric. */
+  bool useConcurrentPerturbations = false;
+  this->GetConfiguration()->ReadParameter( useConcurrentPerturbations,
+    "UseConcurrentPerturbations", this->GetComponentLabel(), level, 0 );
+  this->SetUseConcurrentPerturbations( useConcurrentPerturbations );
+
 } // end BeforeEachResolution
 
 
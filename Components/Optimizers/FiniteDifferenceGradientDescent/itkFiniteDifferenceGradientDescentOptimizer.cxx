@@ -47,7 +47,8 @@ FiniteDifferenceGradientDescentOptimizer
 
   this->m_GradientMagnitude   = 0.0;
   this->m_LearningRate        = 0.0;
-  this->m_ComputeCurrentValue = false;
+  this->m_ComputeCurrentValue        = false;
+  this->m_UseConcurrentPerturbations = false;
   this->m_Param_a             = 1.0;
   this->m_Param_c             = 1.0;
   this->m_Param_A             = 1.0;
@@ -78,6 +79,8 @@ FiniteDifferenceGradientDescentOptimizer
   os << indent << "StopCondition: "
      << this->m_StopCondition;
   os << std::endl;
+  os << indent << "UseConcurrentPerturbations: "
+     << this->m_UseConcurrentPerturbations << std::endl;
 
 } // end PrintSelf
 
@@ -127,6 +130,8 @@ FiniteDifferenceGradientDescentOptimizer
   unsigned int spaceDimension = 1;
 
   ParametersType param;
+  ParametersType perturbations;
+  DerivativeType differences;
   double         valueplus;
   double         valuemin;
 
@@ -168,20 +173,37 @@ FiniteDifferenceGradientDescentOptimizer
     /** Calculate the derivative; this may take a while... */
     try
     {
-      for( unsigned int j = 0; j < spaceDimension; j++ )
+      if( this->m_UseConcurrentPerturbations )
       {
-        param[ j ] += ck;
-        valueplus   = this->GetScaledValue( param );
-        param[ j ] -= 2.0 * ck;
-        valuemin    = this->GetScaledValue( param );
-        param[ j ] += ck;
+        /** Let the cost function evaluate all perturbations at once. */
+        perturbations.SetSize( spaceDimension );
+        perturbations.Fill( ck );
+        this->m_ScaledCostFunction->GetCentralDifferences( param, perturbations, differences );
+        for( unsigned int j = 0; j < spaceDimension; j++ )
+        {
+          const double gradient = differences[ j ] / ( 2.0 * ck );
+          this->m_Gradient[ j ] = gradient;
+
+          sumOfSquaredGradients += ( gradient * gradient );
+        }
+      }
+      else
+      {
+        for( unsigned int j = 0; j < spaceDimension; j++ )
+        {
+          param[ j ] += ck;
+          valueplus   = this->GetScaledValue( param );
+          param[ j ] -= 2.0 * ck;
+          valuemin    = this->GetScaledValue( param );
+          param[ j ] += ck;
 
-        const double gradient = ( valueplus - valuemin ) / ( 2.0 * ck );
-        this->m_Gradient[ j ] = gradient;
+          const double gradient = ( valueplus - valuemin ) / ( 2.0 * ck );
+          this->m_Gradient[ j ] = gradient;
 
-        sumOfSquaredGradients += ( gradient * gradient );
+          sumOfSquaredGradients += ( gradient * gradient );
 
-      }   // for j = 0 .. spaceDimension
+        } // for j = 0 .. spaceDimension
+      }
     }
     catch( ExceptionObject & err )
     {
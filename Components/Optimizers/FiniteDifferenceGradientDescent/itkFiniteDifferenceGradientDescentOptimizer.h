@@ -48,6 +48,13 @@ namespace itk
  * Note the similarities to the SimultaneousPerturbation optimizer and
  * the StandardGradientDescent optimizer.
  *
+ * If UseConcurrentPerturbations is true, the differences in the numerator
+ * are computed by the GetCentralDifferences() function of the scaled cost
+ * function. Image metrics that support concurrent evaluation then evaluate
+ * the perturbations concurrently, all with the same samples. For transforms
+ * with a sparse Jacobian, such as the B-spline, they only recompute the
+ * samples in the support of each parameter.
+ *
  * \ingroup Optimizers
  * \sa FiniteDifferenceGradientDescent
  */
@@ -128,6 +135,13 @@ public:
   itkSetMacro( ComputeCurrentValue, bool );
   itkBooleanMacro( ComputeCurrentValue );
 
+  /** Set/Get whether the perturbations are evaluated by the GetCentralDifferences()
+   * function of the cost function, instead of by 2N calls to GetValue(). Default: false.
+   */
+  itkGetConstMacro( UseConcurrentPerturbations, bool );
+  itkSetMacro( UseConcurrentPerturbations, bool );
+  itkBooleanMacro( UseConcurrentPerturbations );
+
   /** Get the CurrentStepLength, GradientMagnitude and LearningRate (a_k) */
   itkGetConstMacro( GradientMagnitude, double );
   itkGetConstMacro( LearningRate, double );
@@ -152,6 +166,9 @@ protected:
   */
   bool m_ComputeCurrentValue;
 
+  /** Evaluate the perturbations by GetCentralDifferences(). */
+  bool m_UseConcurrentPerturbations;
+
   // Functions to compute the parameters at iteration k.
   virtual double Compute_a( unsigned long k ) const;
 
@@ -23,6 +23,7 @@
 #include <map>
 
 #include "itkNDImageBase.h"
+#include "itkTimeProbe.h"
 
 namespace elastix
 {
@@ -48,6 +49,26 @@ namespace elastix
  *   This varies the second transform parameter in the range [-4.0 3.0] with steps of 1.0
  *   and the third parameter in the range [-1.0 1.0] with steps of 0.5. The names are used
  *   as column headers in the screen output.
+ * \parameter UseCoarseToFineSearch: Whether a hierarchical search is performed instead of
+ *   visiting all points of the search space. A coarse grid is evaluated first, after which
+ *   only the neighbourhoods of the best points are refined, halving the spacing each time.
+ *   Can be given for each resolution.\n
+ *   example: <tt>(UseCoarseToFineSearch "true")</tt> \n
+ *   Default value: "false".
+ * \parameter CoarseGridFactor: The spacing of the coarse grid, in number of steps of the
+ *   search space. Can be given for each resolution.\n
+ *   example: <tt>(CoarseGridFactor 8)</tt> \n
+ *   Default value: 4.
+ * \parameter NumberOfCellsToRefine: The number of best points whose neighbourhood is refined
+ *   at each level of the coarse-to-fine search. Can be given for each resolution.\n
+ *   example: <tt>(NumberOfCellsToRefine 16)</tt> \n
+ *   Default value: 8.
+ * \parameter LipschitzConstant: A bound on the change of the metric value per unit change of
+ *   the parameters. When larger than zero, cells that can not contain a better value than the
+ *   best one found so far are pruned as well. The bound is not checked: when the given constant
+ *   is too small, the optimum may be pruned. Can be given for each resolution.\n
+ *   example: <tt>(LipschitzConstant 0.5)</tt> \n
+ *   Default value: 0, which disables the bound.
  *
  * \ingroup Optimizers
  * \sa FullSearchOptimizer
@@ -116,6 +137,9 @@ public:
   /** Methods that have to be present everywhere.*/
   void BeforeRegistration( void ) override;
 
+  /** Override the superclass implementation, to time the search. */
+  void StartOptimization( void ) override;
+
   void BeforeEachResolution( void ) override;
 
   void AfterEachResolution( void ) override;
@@ -138,6 +162,9 @@ protected:
 
   DimensionNameMapType m_SearchSpaceDimensionNames;
 
+  /** The time spent on the search in the current resolution. */
+  itk::TimeProbe m_SearchTimer;
+
   /** Checks if an error generated while reading the search space
    * ranges from the parameter file is a real error. Prints some
    * error message if so.
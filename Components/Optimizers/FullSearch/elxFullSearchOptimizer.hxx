@@ -180,6 +180,31 @@ FullSearch< TElastix >
     this->m_OptimizationSurface->Allocate();
     /** \todo try/catch block around Allocate? */
 
+    /** Read the settings of the coarse-to-fine search. */
+    bool         useCoarseToFineSearch = false;
+    unsigned int coarseGridFactor      = 4;
+    unsigned int numberOfCellsToRefine = 8;
+    double       lipschitzConstant     = 0.0;
+    this->m_Configuration->ReadParameter( useCoarseToFineSearch,
+      "UseCoarseToFineSearch", this->GetComponentLabel(), level, 0 );
+    this->m_Configuration->ReadParameter( coarseGridFactor,
+      "CoarseGridFactor", this->GetComponentLabel(), level, 0 );
+    this->m_Configuration->ReadParameter( numberOfCellsToRefine,
+      "NumberOfCellsToRefine", this->GetComponentLabel(), level, 0 );
+    this->m_Configuration->ReadParameter( lipschitzConstant,
+      "LipschitzConstant", this->GetComponentLabel(), level, 0 );
+    this->SetUseCoarseToFineSearch( useCoarseToFineSearch );
+    this->SetCoarseGridFactor( coarseGridFactor );
+    this->SetNumberOfCellsToRefine( numberOfCellsToRefine );
+    this->SetLipschitzConstant( lipschitzConstant );
+
+    /** Points that are pruned by the coarse-to-fine search are not evaluated. */
+    if( useCoarseToFineSearch )
+    {
+      this->m_OptimizationSurface->FillBuffer(
+        itk::NumericTraits< float >::quiet_NaN() );
+    }
+
     /** Set the name of this image on disk. */
     std::string resultImageFormat = "mhd";
     this->m_Configuration->ReadParameter(
@@ -193,10 +218,20 @@ FullSearch< TElastix >
       << "." << resultImageFormat;
     this->m_OptimizationSurface->SetOutputFileName( makeString.str().c_str() );
 
-    elxout
-      << "Total number of iterations needed in this resolution: "
-      << this->GetNumberOfIterations()
-      << "." << std::endl;
+    if( useCoarseToFineSearch )
+    {
+      elxout
+        << "Number of points in the search space: "
+        << this->GetNumberOfIterations()
+        << "; a coarse-to-fine search is performed." << std::endl;
+    }
+    else
+    {
+      elxout
+        << "Total number of iterations needed in this resolution: "
+        << this->GetNumberOfIterations()
+        << "." << std::endl;
+    }
 
   }
   else
@@ -208,6 +243,31 @@ FullSearch< TElastix >
 } // end BeforeEachResolution()
 
 
+/**
+ * ***************** StartOptimization ***********************
+ */
+
+template< class TElastix >
+void
+FullSearch< TElastix >
+::StartOptimization( void )
+{
+  this->m_SearchTimer.Reset();
+  this->m_SearchTimer.Start();
+  try
+  {
+    this->Superclass1::StartOptimization();
+  }
+  catch( itk::ExceptionObject & )
+  {
+    this->m_SearchTimer.Stop();
+    throw;
+  }
+  this->m_SearchTimer.Stop();
+
+} // end StartOptimization()
+
+
 /**
  * ***************** AfterEachIteration *************************
  */
@@ -266,6 +326,24 @@ FullSearch< TElastix >
   /** Print the stopping condition */
   elxout << "Stopping condition: " << stopcondition << "." << std::endl;
 
+  /** Print the number of evaluations, and the evaluation speed. */
+  const double searchTime = this->m_SearchTimer.GetTotal();
+  elxout << "Number of metric evaluations: " << this->GetCurrentIteration()
+         << " in " << this->ConvertSecondsToDHMS( searchTime, 2 );
+  if( searchTime > 0.0 )
+  {
+    elxout << " (" << this->GetCurrentIteration() / searchTime
+           << " evaluations per second)";
+  }
+  elxout << "." << std::endl;
+  if( this->GetUseCoarseToFineSearch() )
+  {
+    elxout << "Number of grid points skipped by the coarse-to-fine search: "
+           << this->GetNumberOfSkippedGridPoints() << "." << std::endl;
+    elxout << "Number of candidate cells not refined because of the Lipschitz bound: "
+           << this->GetNumberOfCellsPrunedByBound() << "." << std::endl;
+  }
+
   /** Write the optimization surface to disk */
   bool writeSurfaceEachResolution = false;
   this->GetConfiguration()->ReadParameter( writeSurfaceEachResolution,
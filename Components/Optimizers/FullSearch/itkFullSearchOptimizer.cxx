@@ -25,6 +25,12 @@
 #include "itkMacro.h"
 #include "itkNumericTraits.h"
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
 namespace itk
 {
 
@@ -46,6 +52,13 @@ FullSearchOptimizer
   m_SearchSpace                   = 0;
   m_LastSearchSpaceChanges        = 0;
 
+  m_UseCoarseToFineSearch      = false;
+  m_CoarseGridFactor           = 4;
+  m_NumberOfCellsToRefine      = 8;
+  m_LipschitzConstant          = 0.0;
+  m_NumberOfSkippedGridPoints  = 0;
+  m_NumberOfCellsPrunedByBound = 0;
+
 }   //end constructor
 
 
@@ -80,7 +93,17 @@ FullSearchOptimizer
     m_BestValue = NumericTraits< double >::max();
   }
 
-  this->ResumeOptimization();
+  m_NumberOfSkippedGridPoints  = 0;
+  m_NumberOfCellsPrunedByBound = 0;
+
+  if( m_UseCoarseToFineSearch )
+  {
+    this->CoarseToFineSearch();
+  }
+  else
+  {
+    this->ResumeOptimization();
+  }
 
 }
 
@@ -249,6 +272,207 @@ FullSearchOptimizer
 } // end UpdateCurrentPosition
 
 
+/**
+ * ********************* EvaluateIndex **************************
+ */
+
+void
+FullSearchOptimizer
+::EvaluateIndex( const SearchSpaceIndexType & index )
+{
+  m_CurrentIndexInSearchSpace = index;
+  m_CurrentPointInSearchSpace = this->IndexToPoint( index );
+  this->SetCurrentPosition( this->PointToPosition( m_CurrentPointInSearchSpace ) );
+
+  try
+  {
+    m_Value = m_CostFunction->GetValue( this->GetCurrentPosition() );
+  }
+  catch( ExceptionObject & err )
+  {
+    m_StopCondition = MetricError;
+    StopOptimization();
+    throw err;
+  }
+
+  /** Check if the value is a minimum or maximum */
+  if( ( m_Value < m_BestValue )  ^  m_Maximize )
+  {
+    m_BestValue              = m_Value;
+    m_BestPointInSearchSpace = m_CurrentPointInSearchSpace;
+    m_BestIndexInSearchSpace = m_CurrentIndexInSearchSpace;
+  }
+
+  this->InvokeEvent( IterationEvent() );
+  m_CurrentIteration++;
+
+} // end EvaluateIndex()
+
+
+/**
+ * ********************* CoarseToFineSearch *********************
+ *
+ * Evaluates a coarse grid, and then refines the neighbourhoods of the
+ * best points found so far, halving the spacing at each level.
+ * The spacing is measured in search space steps, so the finest level
+ * coincides with the grid of the full search.
+ */
+
+void
+FullSearchOptimizer
+::CoarseToFineSearch( void )
+{
+  itkDebugMacro( "CoarseToFineSearch" );
+
+  m_Stop = false;
+  InvokeEvent( StartEvent() );
+
+  const unsigned int          searchSpaceDimension = this->GetNumberOfSearchSpaceDimensions();
+  const SearchSpaceSizeType & searchSpaceSize      = this->GetSearchSpaceSize();
+
+  /** The step sizes, needed for the radius of a cell. */
+  std::vector< double >   stepSizes( searchSpaceDimension );
+  SearchSpaceIteratorType it( m_SearchSpace->Begin() );
+  for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ssdim++ )
+  {
+    stepSizes[ ssdim ] = it.Value()[ 2 ];
+    it++;
+  }
+
+  /** The values evaluated so far, stored by their offset in the grid. */
+  typedef std::map< unsigned long, double > EvaluatedMapType;
+  EvaluatedMapType evaluated;
+
+  SearchSpaceIndexType index( searchSpaceDimension );
+  SearchSpaceIndexType centre( searchSpaceDimension );
+
+  /** Evaluate the point at index, if it is inside the grid and not yet evaluated. */
+  auto evaluate = [ & ]( void )
+  {
+    unsigned long offset = 0;
+    for( int ssdim = static_cast< int >( searchSpaceDimension ) - 1; ssdim >= 0; ssdim-- )
+    {
+      if( index[ ssdim ] < 0
+        || index[ ssdim ] >= static_cast< IndexValueType >( searchSpaceSize[ ssdim ] ) )
+      {
+        return;
+      }
+      offset = offset * searchSpaceSize[ ssdim ] + index[ ssdim ];
+    }
+    if( evaluated.count( offset ) == 0 )
+    {
+      this->EvaluateIndex( index );
+      evaluated[ offset ] = m_Value;
+    }
+  };
+
+  /** Evaluate the coarse grid. */
+  unsigned int spacing = m_CoarseGridFactor;
+  index.Fill( 0 );
+  bool done = searchSpaceDimension == 0;
+  while( !done && !m_Stop )
+  {
+    evaluate();
+
+    /** Next point of the coarse grid. The last point of each dimension is
+     * included, so that every point is within half the spacing of the
+     * coarse grid.
+     */
+    done = true;
+    for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ssdim++ )
+    {
+      const IndexValueType lastIndex = static_cast< IndexValueType >( searchSpaceSize[ ssdim ] ) - 1;
+      if( index[ ssdim ] < lastIndex )
+      {
+        index[ ssdim ] = std::min< IndexValueType >( index[ ssdim ] + spacing, lastIndex );
+        done = false;
+        break;
+      }
+      index[ ssdim ] = 0;
+    }
+  }
+
+  /** Refine the best cells, halving the spacing each level. */
+  unsigned long numberOfNeighbours = 1;
+  for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ssdim++ )
+  {
+    numberOfNeighbours *= 3;
+  }
+  while( spacing > 1 && !m_Stop )
+  {
+    spacing = ( spacing + 1 ) / 2;
+
+    /** Select the best points evaluated so far. */
+    typedef std::pair< double, unsigned long > CandidateType;
+    std::vector< CandidateType > candidates;
+    candidates.reserve( evaluated.size() );
+    for( EvaluatedMapType::const_iterator eit = evaluated.begin(); eit != evaluated.end(); ++eit )
+    {
+      candidates.push_back( CandidateType( m_Maximize ? -eit->second : eit->second, eit->first ) );
+    }
+    const std::size_t numberOfCandidates = std::min< std::size_t >(
+      m_NumberOfCellsToRefine, candidates.size() );
+    std::partial_sort( candidates.begin(), candidates.begin() + numberOfCandidates, candidates.end() );
+
+    /** The radius of the cells that are refined at this level. */
+    double radius = 0.0;
+    for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ssdim++ )
+    {
+      const double halfWidth = spacing * stepSizes[ ssdim ];
+      radius += halfWidth * halfWidth;
+    }
+    radius = std::sqrt( radius );
+    const double bestValue = m_Maximize ? -m_BestValue : m_BestValue;
+
+    for( std::size_t c = 0; c < numberOfCandidates && !m_Stop; ++c )
+    {
+      /** Skip cells that cannot contain a better point. */
+      if( m_LipschitzConstant > 0.0
+        && candidates[ c ].first - m_LipschitzConstant * radius >= bestValue )
+      {
+        m_NumberOfCellsPrunedByBound++;
+        continue;
+      }
+
+      /** Convert the offset to an index. */
+      unsigned long offset = candidates[ c ].second;
+      for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ssdim++ )
+      {
+        centre[ ssdim ] = offset % searchSpaceSize[ ssdim ];
+        offset         /= searchSpaceSize[ ssdim ];
+      }
+
+      /** Evaluate the neighbours at the current spacing. Neighbours outside
+       * the grid are moved to its border, so that the cell is covered.
+       */
+      for( unsigned long n = 0; n < numberOfNeighbours && !m_Stop; ++n )
+      {
+        unsigned long code = n;
+        for( unsigned int ssdim = 0; ssdim < searchSpaceDimension; ssdim++ )
+        {
+          const IndexValueType lastIndex = static_cast< IndexValueType >( searchSpaceSize[ ssdim ] ) - 1;
+          const IndexValueType neighbour = centre[ ssdim ]
+            + ( static_cast< IndexValueType >( code % 3 ) - 1 ) * spacing;
+          index[ ssdim ] = std::max< IndexValueType >( 0, std::min( neighbour, lastIndex ) );
+          code /= 3;
+        }
+        evaluate();
+      }
+    }
+  } // end while
+
+  /** All points that were not evaluated are skipped. */
+  m_NumberOfSkippedGridPoints = this->GetNumberOfIterations() - evaluated.size();
+
+  if( !m_Stop )
+  {
+    m_StopCondition = FullRangeSearched;
+    StopOptimization();
+  }
+
+} // end CoarseToFineSearch()
+
+
 /**
  * ********************* ProcessSearchSpaceChanges **************
  */
@@ -35,6 +35,27 @@ namespace itk
  * Optimizer that scans a subspace of the parameter space
  * and searches for the best parameters.
  *
+ * By default all points of the search space grid are visited. When
+ * UseCoarseToFineSearch is set, a hierarchical search is performed
+ * instead. First, a coarse grid is evaluated, which contains every
+ * CoarseGridFactor'th point of the search space in each dimension, and
+ * the last point. Then the spacing is halved repeatedly, and only the
+ * neighbourhoods of the NumberOfCellsToRefine best points evaluated so far
+ * are refined, until the spacing of the search space is reached. All other
+ * cells are pruned, so in general the search is a heuristic, which may miss
+ * the optimum of the full search.
+ *
+ * Optionally, a LipschitzConstant of the cost function (in units of
+ * the parameters) can be set. A cell is then also pruned when the bound
+ * value -/+ LipschitzConstant * radius shows that it cannot contain a
+ * point that is better than the best value found so far. This branch and
+ * bound relies entirely on the LipschitzConstant supplied by the user,
+ * which is not checked: if it is smaller than the true Lipschitz constant
+ * of the cost function, cells that contain the optimum may be pruned.
+ * When it is a valid bound, and NumberOfCellsToRefine is at least the
+ * number of evaluated points, the search finds the optimum of the full
+ * search, while skipping the cells that the bound excludes.
+ *
  * \todo This optimizer has similar functionality as the recently added
  * itkExhaustiveOptimizer. See if we can replace it by that optimizer,
  * or inherit from it.
@@ -191,6 +212,39 @@ public:
   /** Get Stop condition. */
   itkGetConstMacro( StopCondition, StopConditionType );
 
+  /** Set/Get whether the coarse-to-fine search is used. Default: false. */
+  itkSetMacro( UseCoarseToFineSearch, bool );
+  itkGetConstMacro( UseCoarseToFineSearch, bool );
+
+  /** Set/Get the spacing of the coarse grid, in number of search space
+   * steps. Default: 4.
+   */
+  itkSetClampMacro( CoarseGridFactor, unsigned int,
+    1, NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( CoarseGridFactor, unsigned int );
+
+  /** Set/Get the number of best cells that are refined at each level of
+   * the coarse-to-fine search. Default: 8.
+   */
+  itkSetClampMacro( NumberOfCellsToRefine, unsigned int,
+    1, NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( NumberOfCellsToRefine, unsigned int );
+
+  /** Set/Get a Lipschitz constant of the cost function, used to bound the
+   * value inside a cell. Zero (default) disables the bound.
+   */
+  itkSetMacro( LipschitzConstant, double );
+  itkGetConstMacro( LipschitzConstant, double );
+
+  /** Get the number of grid points that the coarse-to-fine search did not
+   * evaluate, and the number of candidate cells, summed over the levels,
+   * that were not refined because of the bound. The two are in different
+   * units: a skipped cell covers up to 3^dim grid points of its level, which
+   * may overlap with other cells.
+   */
+  itkGetConstMacro( NumberOfSkippedGridPoints, unsigned long );
+  itkGetConstMacro( NumberOfCellsPrunedByBound, unsigned long );
+
 protected:
 
   FullSearchOptimizer();
@@ -215,6 +269,21 @@ protected:
   unsigned long m_LastSearchSpaceChanges;
   virtual void ProcessSearchSpaceChanges( void );
 
+  /** Perform the coarse-to-fine search. */
+  virtual void CoarseToFineSearch( void );
+
+  /** Evaluate the cost function at an index of the search space, and
+   * update the best value. Used by the coarse-to-fine search.
+   */
+  virtual void EvaluateIndex( const SearchSpaceIndexType & index );
+
+  bool          m_UseCoarseToFineSearch;
+  unsigned int  m_CoarseGridFactor;
+  unsigned int  m_NumberOfCellsToRefine;
+  double        m_LipschitzConstant;
+  unsigned long m_NumberOfSkippedGridPoints;
+  unsigned long m_NumberOfCellsPrunedByBound;
+
 private:
 
   FullSearchOptimizer( const Self & ); // purposely not implemented
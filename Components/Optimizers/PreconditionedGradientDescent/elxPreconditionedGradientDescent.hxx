@@ -403,7 +403,7 @@ PreconditionedGradientDescent<TElastix>
   itk::TimeProbe timer;
   timer.Start();
 
-  PreconditionType H;
+  typename CompressedPreconditionType::Pointer H = CompressedPreconditionType::New();
 
   /* Get metric as metric with self Hessian. */
   const MetricWithSelfHessianType * metricWithSelfHessian = dynamic_cast<
@@ -418,7 +418,7 @@ PreconditionedGradientDescent<TElastix>
   elxout << "Computing SelfHessian." << std::endl;
   try
   {
-    metricWithSelfHessian->GetSelfHessian( this->GetCurrentPosition(), H );
+    metricWithSelfHessian->GetCompressedSelfHessian( this->GetCurrentPosition(), H );
   }
   catch( itk::ExceptionObject & err )
   {
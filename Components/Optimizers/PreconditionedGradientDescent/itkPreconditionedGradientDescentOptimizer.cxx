@@ -27,6 +27,8 @@
 #include "vnl/vnl_vector.h"
 #include "vnl/algo/vnl_sparse_symmetric_eigensystem.h"
 
+#include <cmath>
+
 namespace itk
 {
 /** Error handler for cholmod */
@@ -491,6 +493,119 @@ PreconditionedGradientDescentOptimizer
   /** Destroy precondition input, to save memory */
   precondition.set_size( 0, 0 );
 
+  /** Factorize */
+  this->CholmodFactorize( cPrecondition );
+
+  /** Release memory */
+  cholmod_free_sparse( &cPrecondition, this->m_CholmodCommon );
+
+} // end SetPreconditionMatrix()
+
+
+/**
+ * ************ SetPreconditionMatrix ****************************
+ */
+
+void
+PreconditionedGradientDescentOptimizer
+::SetPreconditionMatrix( CompressedPreconditionType * precondition )
+{
+  itkDebugMacro("SetPreconditionMatrix");
+
+  const size_t spaceDimension = static_cast<size_t>( precondition->GetNumberOfRows() );
+  const size_t nnz = static_cast<size_t>( precondition->GetNumberOfNonZeros() );
+
+  /** Check range of eigenvalues */
+  double maxDiag = 0;
+  for( unsigned int r = 0; r < spaceDimension; ++r )
+  {
+    maxDiag = vnl_math_max( maxDiag, precondition->GetDiagonalElement( r ) );
+  }
+
+  /** Estimate largest eigenvalue to 1 decimal digit precision, with the
+   * Lanczos method of the vnl_sparse_symmetric_eigensystem, as for the
+   * vnl_sparse_matrix. It works on a temporary vnl_sparse_matrix copy, with
+   * a small negligible fraction of maxDiag added to the diagonal; see the
+   * other SetPreconditionMatrix(). If eig fails (which it does quite
+   * regularly) use the maxDiag value.
+   */
+  double & largestEig = this->m_LargestEigenValue;
+  {
+    PreconditionType tmpPrecondition;
+    precondition->ConvertToVnlSparseMatrix( tmpPrecondition );
+    const double diagTemp = maxDiag * 1e-3;
+    for( unsigned int r = 0; r < spaceDimension; ++r )
+    {
+      tmpPrecondition( r, r ) += diagTemp;
+    }
+
+    const long ndigits = 1;
+    vnl_sparse_symmetric_eigensystem eig;
+    int errorCode = eig.CalculateNPairs( tmpPrecondition, 1, false, ndigits );
+    if( errorCode == 0 )
+    {
+      largestEig = eig.get_eigenvalue( 0 );
+    }
+    else
+    {
+      largestEig = maxDiag;
+    }
+  }
+
+  /** Add diagWeight * largestEig */
+  const double diagDef = this->m_DiagonalWeight * largestEig;
+  for( unsigned int r = 0; r < spaceDimension; ++r )
+  {
+    precondition->GetDiagonalElement( r ) += diagDef;
+  }
+
+  /** Store some information for the user: */
+  this->m_Sparsity = static_cast<double>( nnz ) /
+    static_cast<double>( spaceDimension * spaceDimension );
+
+  /** Wrap the arrays in a cholmod_sparse. The upper triangular part is
+   * stored row-based, which cholmod reads as the lower triangular part
+   * stored column-based; see the other SetPreconditionMatrix().
+   */
+  cholmod_sparse cPrecondition;
+  cPrecondition.nrow = spaceDimension;
+  cPrecondition.ncol = spaceDimension;
+  cPrecondition.nzmax = nnz;
+  cPrecondition.p = precondition->GetRowPointers();
+  cPrecondition.i = precondition->GetColumnIndices();
+  cPrecondition.nz = nullptr;
+  cPrecondition.x = precondition->GetValues();
+  cPrecondition.z = nullptr;
+  cPrecondition.stype = -1;
+  cPrecondition.itype = CHOLMOD_INT;
+  cPrecondition.xtype = CHOLMOD_REAL;
+  cPrecondition.dtype = CHOLMOD_DOUBLE;
+  cPrecondition.sorted = 1;
+  cPrecondition.packed = 1;
+
+  /** Factorize */
+  this->CholmodFactorize( &cPrecondition );
+
+} // end SetPreconditionMatrix()
+
+
+/**
+ * ************ CholmodFactorize ****************************
+ */
+
+void
+PreconditionedGradientDescentOptimizer
+::CholmodFactorize( cholmod_sparse * cPrecondition )
+{
+  const size_t spaceDimension = cPrecondition->nrow;
+
+  /** Release a previous factorization */
+  if( this->m_CholmodFactor )
+  {
+    cholmod_free_factor( &this->m_CholmodFactor, this->m_CholmodCommon );
+    this->m_CholmodFactor = 0;
+  }
+
   /** Prepare for factorization */
   this->m_CholmodFactor = cholmod_analyze( cPrecondition, this->m_CholmodCommon );
 
@@ -504,11 +619,10 @@ PreconditionedGradientDescentOptimizer
   /** Store condition number of user */
   this->m_ConditionNumber = cholmod_rcond( this->m_CholmodFactor, this->m_CholmodCommon );
 
-  /** Release memory */
-  cholmod_free_sparse( &cPrecondition, this->m_CholmodCommon );
-
   /** Prepare cholmod sparse structure for gradients */
   const int stypeg = 0;
+  const bool sorted = true;
+  const bool packed = true;
   if( this->m_CholmodGradient )
   {
     cholmod_free_sparse( &this->m_CholmodGradient, this->m_CholmodCommon );
@@ -518,7 +632,7 @@ PreconditionedGradientDescentOptimizer
     spaceDimension, 1, spaceDimension, sorted, packed,
     stypeg, CHOLMOD_REAL, this->m_CholmodCommon );
 
-} // end SetPreconditionMatrix()
+} // end CholmodFactorize()
 
 
 } // end namespace itk
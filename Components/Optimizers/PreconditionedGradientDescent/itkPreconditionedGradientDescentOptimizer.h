@@ -21,6 +21,7 @@
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
 #include "itkArray2D.h"
 #include "vnl/vnl_sparse_matrix.h"
+#include "itkCompressedSparseRowMatrix.h"
 #include "cholmod.h"
 
 namespace itk
@@ -83,6 +84,7 @@ public:
   //typedef vnl_symmetric_eigensystem<
   //  PreconditionValueType >                               EigenSystemType;
   typedef vnl_sparse_matrix< PreconditionValueType >      PreconditionType;
+  typedef CompressedSparseRowMatrix                       CompressedPreconditionType;
 
   /** Codes of stopping conditions
    * The MinimumStepSize stopcondition never occurs, but may
@@ -146,6 +148,13 @@ public:
    */
   virtual void SetPreconditionMatrix( PreconditionType & precondition );
 
+  /** Set the preconditioning matrix, in compressed sparse row format.
+   * The largest eigenvalue is estimated as for the vnl_sparse_matrix, on a
+   * temporary copy, and the arrays are handed to cholmod without copying.
+   * NB: this function modifies the diagonal of the input matrix.
+   */
+  virtual void SetPreconditionMatrix( CompressedPreconditionType * precondition );
+
   /** Temporary functions, for debugging */
   const cholmod_common * GetCholmodCommon( void ) const
   {
@@ -209,6 +218,11 @@ protected:
   virtual void CholmodSolve( const DerivativeType & gradient,
     DerivativeType & searchDirection, int solveType = CHOLMOD_A );
 
+  /** Factorize the precondition matrix, which is given in cholmod format,
+   * and prepare the cholmod structure for the gradients.
+   */
+  virtual void CholmodFactorize( cholmod_sparse * cPrecondition );
+
 private:
   PreconditionedGradientDescentOptimizer(const Self&); // purposely not implemented
   void operator=(const Self&); // purposely not implemented
@@ -648,6 +648,12 @@ PreconditionedStochasticGradientDescent< TElastix >
   elxout << "  Computing the preconditioner took "
     << this->ConvertSecondsToDHMS( timer_P.GetMean(), 6 )
     << std::endl;
+  elxout << "    of which the exact gradient took "
+    << this->ConvertSecondsToDHMS( preconditionerEstimator->GetGradientComputationTime(), 6 )
+    << ", and the Jacobian terms (" << preconditionerEstimator->GetNumberOfWorkUnits()
+    << " threads) took "
+    << this->ConvertSecondsToDHMS( preconditionerEstimator->GetJacobianComputationTime(), 6 )
+    << std::endl;
 
 #if 0
   elxout << std::scientific;
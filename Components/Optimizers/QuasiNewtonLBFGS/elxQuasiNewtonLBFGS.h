@@ -64,6 +64,14 @@ namespace elastix
  *    itk::MoreThuenteLineSearchOptimizer tries to satisfy.\n
  *    example: <tt>(LineSearchGradientTolerance 0.9 0.9 0.9)</tt> \n
  *    Default value: 0.9.\n
+ * \parameter NumberOfSpeculativeLineSearchSteps: The number of step lengths that the
+ *    itk::MoreThuenteLineSearchOptimizer evaluates at once. If larger than 1, each line
+ *    search iteration also evaluates candidate steps around the proposed step, concurrently,
+ *    and takes the first one that satisfies the Wolfe conditions. Only has an effect for
+ *    metrics that support concurrent evaluation: AdvancedMeanSquares and
+ *    AdvancedNormalizedCorrelation, or a combination of these.\n
+ *    example: <tt>(NumberOfSpeculativeLineSearchSteps 4 4 4)</tt> \n
+ *    Default value: 1.\n
  * \parameter GradientMagnitudeTolerance: Stopping criterion. See the documentation of the
  *    itk::QuasiNewtonLBFGSOptimizer for more information.\n
  *    example: <tt>(GradientMagnitudeTolerance 0.001 0.0001 0.000001)</tt> \n
@@ -260,6 +260,12 @@ QuasiNewtonLBFGS< TElastix >
     "LineSearchGradientTolerance", this->GetComponentLabel(), level, 0 );
   this->m_LineOptimizer->SetGradientTolerance( lineSearchGradientTolerance );
 
+  /** Set the NumberOfSpeculativeLineSearchSteps */
+  unsigned int numberOfSpeculativeLineSearchSteps = 1;
+  this->m_Configuration->ReadParameter( numberOfSpeculativeLineSearchSteps,
+    "NumberOfSpeculativeLineSearchSteps", this->GetComponentLabel(), level, 0 );
+  this->m_LineOptimizer->SetNumberOfSpeculativeSteps( numberOfSpeculativeLineSearchSteps );
+
   /** Set the GradientMagnitudeTolerance */
   double gradientMagnitudeTolerance = 0.000001;
   this->m_Configuration->ReadParameter( gradientMagnitudeTolerance,
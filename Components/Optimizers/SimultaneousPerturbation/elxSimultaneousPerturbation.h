@@ -20,6 +20,7 @@
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkSPSAOptimizer.h"
+#include "itkMultiPositionCostFunctionInterface.h"
 
 namespace elastix
 {
@@ -74,6 +75,13 @@ namespace elastix
  *   This flag can NOT be defined for each resolution. \n
  *   example: <tt>(ShowMetricValues "true" )</tt> \n
  *   Default value: "false". Note that turning this flag on increases computation time.
+ * \parameter UseConcurrentPerturbations: Whether the 2 * NumberOfPerturbations perturbed
+ *   positions of a gradient estimate are evaluated by the metric in one call, concurrently
+ *   and with the same samples. Metrics without support for concurrent evaluation evaluate
+ *   them one after another. The random perturbations are the same as without this option.
+ *   Can be defined for each resolution. \n
+ *   example: <tt>(UseConcurrentPerturbations "true")</tt> \n
+ *   Default value: "false".
  *
  *
  * \ingroup Optimizers
@@ -123,6 +131,12 @@ public:
 
   /** Typedef for the ParametersType. */
   typedef typename Superclass1::ParametersType ParametersType;
+  typedef Superclass1::DerivativeType          DerivativeType;
+
+  /** Typedefs for the evaluation at several positions. */
+  typedef itk::MultiPositionCostFunctionInterface           MultiPositionCostFunctionType;
+  typedef MultiPositionCostFunctionType::ParametersListType ParametersListType;
+  typedef MultiPositionCostFunctionType::MeasureListType    MeasureListType;
 
   /** Methods that take care of setting parameters and printing progress information.*/
   void BeforeRegistration( void ) override;
@@ -147,6 +161,16 @@ protected:
   ~SimultaneousPerturbation() override {}
 
   bool m_ShowMetricValues;
+  bool m_UseConcurrentPerturbations;
+
+  /** Override the gradient estimate of the superclass, to evaluate all
+   * perturbed positions in one call to GetValues() of the cost function,
+   * if UseConcurrentPerturbations is true and the cost function implements
+   * the MultiPositionCostFunctionInterface. The perturbations are drawn in
+   * the same order as in the superclass.
+   */
+  void ComputeGradient( const ParametersType & parameters,
+    DerivativeType & gradient ) override;
 
 private:
 
@@ -35,7 +35,8 @@ template< class TElastix >
 SimultaneousPerturbation< TElastix >
 ::SimultaneousPerturbation()
 {
-  this->m_ShowMetricValues = false;
+  this->m_ShowMetricValues           = false;
+  this->m_UseConcurrentPerturbations = false;
 } // end Constructor
 
 
@@ -116,6 +117,12 @@ SimultaneousPerturbation< TElastix >
   this->SetAlpha( alpha );
   this->SetGamma( gamma );
 
+  /** Set whether the perturbed positions are evaluated at once by the metric. */
+  bool useConcurrentPerturbations = false;
+  this->GetConfiguration()->ReadParameter( useConcurrentPerturbations,
+    "UseConcurrentPerturbations", this->GetComponentLabel(), level, 0 );
+  this->m_UseConcurrentPerturbations = useConcurrentPerturbations;
+
   /** Ignore the build-in stop criterion; it's quite ad hoc. */
   this->SetTolerance( 0.0 );
 
@@ -251,6 +258,69 @@ SimultaneousPerturbation< TElastix >
 } // end SetInitialPosition
 
 
+/**
+ * ******************* ComputeGradient ***********************
+ */
+
+template< class TElastix >
+void
+SimultaneousPerturbation< TElastix >
+::ComputeGradient( const ParametersType & parameters, DerivativeType & gradient )
+{
+  const MultiPositionCostFunctionType * multiPositionCostFunction
+    = dynamic_cast< const MultiPositionCostFunctionType * >( this->GetCostFunction() );
+  if( !this->m_UseConcurrentPerturbations || multiPositionCostFunction == nullptr )
+  {
+    this->Superclass1::ComputeGradient( parameters, gradient );
+    return;
+  }
+
+  const unsigned int spaceDimension        = parameters.GetSize();
+  const unsigned int numberOfPerturbations = this->GetNumberOfPerturbations();
+  const double       ck                    = this->Compute_c( this->GetCurrentIteration() );
+
+  /** Generate the (scaled) perturbation vectors, and the positions
+   * thetaplus and thetamin of each of them.
+   */
+  std::vector< DerivativeType > deltas( numberOfPerturbations );
+  ParametersListType            positions( 2 * numberOfPerturbations, parameters );
+  for( unsigned int q = 0; q < numberOfPerturbations; ++q )
+  {
+    this->GenerateDelta( spaceDimension );
+    deltas[ q ] = this->m_Delta;
+    for( unsigned int j = 0; j < spaceDimension; ++j )
+    {
+      positions[ 2 * q ][ j ]     += ck * this->m_Delta[ j ];
+      positions[ 2 * q + 1 ][ j ] -= ck * this->m_Delta[ j ];
+    }
+  }
+
+  /** Compute the cost function values at all positions. */
+  MeasureListType values;
+  multiPositionCostFunction->GetValues( positions, values );
+
+  /** Compute the gradient as an average of the estimates. */
+  gradient.SetSize( spaceDimension );
+  gradient.Fill( 0.0 );
+  for( unsigned int q = 0; q < numberOfPerturbations; ++q )
+  {
+    const double valuediff = ( values[ 2 * q ] - values[ 2 * q + 1 ] ) / ( 2.0 * ck );
+    for( unsigned int j = 0; j < spaceDimension; ++j )
+    {
+      gradient[ j ] += valuediff / deltas[ q ][ j ];
+    }
+  }
+
+  /** Apply the scaling, as the superclass does, and divide by the number of perturbations. */
+  const ScalesType & scales = this->GetScales();
+  for( unsigned int j = 0; j < spaceDimension; ++j )
+  {
+    gradient[ j ] /= ( vnl_math::sqr( scales[ j ] ) * static_cast< double >( numberOfPerturbations ) );
+  }
+
+} // end ComputeGradient
+
+
 } // end namespace elastix
 
 #endif // end #ifndef __elxSimultaneousPerturbation_hxx
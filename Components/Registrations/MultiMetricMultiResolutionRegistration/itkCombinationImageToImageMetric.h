@@ -112,10 +112,14 @@ public:
   typedef typename Superclass::DerivativeType             DerivativeType;
   typedef typename Superclass::DerivativeValueType        DerivativeValueType;
   typedef typename Superclass::ParametersType             ParametersType;
+  typedef typename Superclass::ParametersListType         ParametersListType;
+  typedef typename Superclass::MeasureListType            MeasureListType;
+  typedef typename Superclass::DerivativeListType         DerivativeListType;
 
   /** Some typedefs for computing the SelfHessian */
-  typedef typename Superclass::HessianValueType HessianValueType;
-  typedef typename Superclass::HessianType      HessianType;
+  typedef typename Superclass::HessianValueType      HessianValueType;
+  typedef typename Superclass::HessianType           HessianType;
+  typedef typename Superclass::CompressedHessianType CompressedHessianType;
 
   /**
   typedef typename Superclass::ImageSamplerType             ImageSamplerType;
@@ -390,11 +394,43 @@ public:
     MeasureType & value,
     DerivativeType & derivative ) const override;
 
+  /** Concurrent evaluation is supported if all sub metrics support it. */
+  bool GetSupportsConcurrentEvaluation( void ) const override;
+
+  /** Compute the value and derivative at several positions. Each sub metric
+   * evaluates all positions, after which they are combined per position, as
+   * in GetValueAndDerivative(). The stored metric values and derivatives,
+   * see GetMetricValue(), are not changed.
+   */
+  void GetValuesAndDerivatives(
+    const ParametersListType & positions,
+    MeasureListType & values,
+    DerivativeListType & derivatives ) const override;
+
+  /** Compute the value at several positions, combined as in GetValue(). */
+  void GetValues(
+    const ParametersListType & positions,
+    MeasureListType & values ) const override;
+
+  /** Compute the central differences. With fixed weights, these are the
+   * weighted sum of the central differences of the sub metrics. With
+   * relative weights, which depend on the values, GetValues() is used.
+   */
+  void GetCentralDifferences(
+    const ParametersType & position,
+    const ParametersType & perturbations,
+    DerivativeType & differences ) const override;
+
   /** Experimental feature: compute SelfHessian. */
   void GetSelfHessian(
     const TransformParametersType & parameters,
     HessianType & H ) const override;
 
+  /** Experimental feature: compute SelfHessian in compressed sparse row format. */
+  void GetCompressedSelfHessian(
+    const TransformParametersType & parameters,
+    CompressedHessianType * H ) const override;
+
   /** Method to return the latest modified time of this object or any of its
    * cached ivars.
    */
@@ -913,6 +913,201 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetValueAndDerivative()
 
 
+/**
+ * ********************* GetSupportsConcurrentEvaluation ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetSupportsConcurrentEvaluation( void ) const
+{
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    const MultiPositionCostFunctionInterface * metric
+      = dynamic_cast< const MultiPositionCostFunctionInterface * >( this->m_Metrics[ i ].GetPointer() );
+    if( metric == nullptr || !metric->GetSupportsConcurrentEvaluation() )
+    {
+      return false;
+    }
+  }
+  return this->m_NumberOfMetrics > 0;
+
+} // end GetSupportsConcurrentEvaluation()
+
+
+/**
+ * ********************* GetValuesAndDerivatives ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValuesAndDerivatives(
+  const ParametersListType & positions,
+  MeasureListType & values,
+  DerivativeListType & derivatives ) const
+{
+  const unsigned int numberOfPositions = positions.size();
+  values.resize( numberOfPositions );
+  derivatives.resize( numberOfPositions );
+
+  if( !this->GetSupportsConcurrentEvaluation() )
+  {
+    for( unsigned int k = 0; k < numberOfPositions; ++k )
+    {
+      this->GetValueAndDerivative( positions[ k ], values[ k ], derivatives[ k ] );
+    }
+    return;
+  }
+
+  /** Compute the values and derivatives of all metrics at all positions. */
+  std::vector< MeasureListType >    metricValues( this->m_NumberOfMetrics );
+  std::vector< DerivativeListType > metricDerivatives( this->m_NumberOfMetrics );
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    const MultiPositionCostFunctionInterface * metric
+      = dynamic_cast< const MultiPositionCostFunctionInterface * >( this->m_Metrics[ i ].GetPointer() );
+    metric->GetValuesAndDerivatives( positions, metricValues[ i ], metricDerivatives[ i ] );
+  }
+
+  /** Combine them per position, with the weights of GetFinalMetricWeight(),
+   * but with the derivative magnitudes at that position.
+   */
+  std::vector< double > magnitudes( this->m_NumberOfMetrics );
+  for( unsigned int k = 0; k < numberOfPositions; ++k )
+  {
+    for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      magnitudes[ i ] = metricDerivatives[ i ][ k ].magnitude();
+    }
+
+    values[ k ] = NumericTraits< MeasureType >::Zero;
+    derivatives[ k ].SetSize( this->GetNumberOfParameters() );
+    derivatives[ k ].Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      if( !this->m_UseMetric[ i ] )
+      {
+        continue;
+      }
+
+      double weight = 1.0;
+      if( !this->m_UseRelativeWeights )
+      {
+        weight = this->m_MetricWeights[ i ];
+      }
+      else if( magnitudes[ i ] > 1e-10 )
+      {
+        weight = this->m_MetricRelativeWeights[ i ] * magnitudes[ 0 ] / magnitudes[ i ];
+      }
+      values[ k ]      += weight * metricValues[ i ][ k ];
+      derivatives[ k ] += weight * metricDerivatives[ i ][ k ];
+    }
+  }
+
+} // end GetValuesAndDerivatives()
+
+
+/**
+ * ********************* GetValues ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValues(
+  const ParametersListType & positions,
+  MeasureListType & values ) const
+{
+  const unsigned int numberOfPositions = positions.size();
+  values.resize( numberOfPositions );
+
+  if( !this->GetSupportsConcurrentEvaluation() )
+  {
+    for( unsigned int k = 0; k < numberOfPositions; ++k )
+    {
+      values[ k ] = this->GetValue( positions[ k ] );
+    }
+    return;
+  }
+
+  /** Compute the values of all metrics at all positions. */
+  std::vector< MeasureListType > metricValues( this->m_NumberOfMetrics );
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    const MultiPositionCostFunctionInterface * metric
+      = dynamic_cast< const MultiPositionCostFunctionInterface * >( this->m_Metrics[ i ].GetPointer() );
+    metric->GetValues( positions, metricValues[ i ] );
+  }
+
+  /** Combine them per position, as in GetValue(). */
+  for( unsigned int k = 0; k < numberOfPositions; ++k )
+  {
+    values[ k ] = NumericTraits< MeasureType >::Zero;
+    for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+    {
+      if( !this->m_UseMetric[ i ] )
+      {
+        continue;
+      }
+
+      if( !this->m_UseRelativeWeights )
+      {
+        values[ k ] += this->m_MetricWeights[ i ] * metricValues[ i ][ k ];
+      }
+      else if( metricValues[ i ][ k ] > 1e-10 )
+      {
+        const double weight = this->m_MetricRelativeWeights[ i ]
+          * metricValues[ 0 ][ k ] / metricValues[ i ][ k ];
+        values[ k ] += weight * metricValues[ i ][ k ];
+      }
+    }
+  }
+
+} // end GetValues()
+
+
+/**
+ * ********************* GetCentralDifferences ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetCentralDifferences(
+  const ParametersType & position,
+  const ParametersType & perturbations,
+  DerivativeType & differences ) const
+{
+  /** With relative weights the combination is not linear. */
+  if( !this->GetSupportsConcurrentEvaluation() || this->m_UseRelativeWeights )
+  {
+    this->ComputeCentralDifferencesFromValues( position, perturbations, differences,
+      std::max( this->GetNumberOfWorkUnits() / 2, 1u ) );
+    return;
+  }
+
+  /** Sum the weighted central differences of the metrics. */
+  differences.SetSize( position.GetSize() );
+  differences.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  DerivativeType metricDifferences;
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    if( !this->m_UseMetric[ i ] )
+    {
+      continue;
+    }
+
+    const MultiPositionCostFunctionInterface * metric
+      = dynamic_cast< const MultiPositionCostFunctionInterface * >( this->m_Metrics[ i ].GetPointer() );
+    metric->GetCentralDifferences( position, perturbations, metricDifferences );
+    differences += this->m_MetricWeights[ i ] * metricDifferences;
+  }
+
+} // end GetCentralDifferences()
+
+
 /**
  * ********************* GetSelfHessian ****************************
  */
@@ -923,14 +1118,28 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 ::GetSelfHessian( const TransformParametersType & parameters,
   HessianType & H ) const
 {
-  /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0);
-  HessianType tmpH( this->GetNumberOfParameters(),
-  this->GetNumberOfParameters() );
+  typename CompressedHessianType::Pointer compressedH = CompressedHessianType::New();
+  this->GetCompressedSelfHessian( parameters, compressedH );
+  compressedH->ConvertToVnlSparseMatrix( H );
+
+} // end GetSelfHessian()
+
 
-  /** Add all metrics' selfhessians. */
+/**
+ * ********************* GetCompressedSelfHessian ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetCompressedSelfHessian( const TransformParametersType & parameters,
+  CompressedHessianType * H ) const
+{
+  /** Prepare Hessian: start with an empty matrix. */
+  H->SetIdentity( 0 );
+  typename CompressedHessianType::Pointer tmpH = CompressedHessianType::New();
+
+  /** Add all metrics' selfhessians; the rows are merged. */
   bool initialized = false;
   for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
   {
@@ -941,14 +1150,8 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
       if( metric )
       {
         initialized = true;
-        metric->GetSelfHessian( parameters, tmpH );
-
-        /** H=H+tmpH; \todo: maybe this can be done more efficiently. */
-        tmpH.reset();
-        while( tmpH.next() )
-        {
-          H( tmpH.getrow(), tmpH.getcolumn() ) += w * tmpH.value();
-        }
+        metric->GetCompressedSelfHessian( parameters, tmpH );
+        H->Add( tmpH, w );
 
       } // end if metric i exists
     } // end if use metric i
@@ -958,14 +1161,10 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
    * then return an identity matrix */
   if( !initialized )
   {
-    //H.fill_diagonal(1.0);
-    for( unsigned int j = 0; j < this->GetNumberOfParameters(); ++j )
-    {
-      H( j, j ) = 1.0;
-    }
+    H->SetIdentity( this->GetNumberOfParameters() );
   }
 
-} // end GetSelfHessian()
+} // end GetCompressedSelfHessian()
 
 
 /**
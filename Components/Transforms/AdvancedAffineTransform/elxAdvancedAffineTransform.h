@@ -62,6 +62,17 @@ namespace elastix
  *    transform. Should be one of {GeometricalCenter, CenterOfGravity, Origins, GeometryTop}.\n
  *    example: <tt>(AutomaticTransformInitializationMethod "CenterOfGravity")</tt> \n
  *    By default "GeometricalCenter" is assumed.\n
+ * \parameter UseRandomSamplingForCenteredTransformInitialization: for the
+ *    CenterOfGravity method, compute the moments from a random subsample of the
+ *    images instead of from a regular grid. \n
+ *    example: <tt>(UseRandomSamplingForCenteredTransformInitialization "true")</tt> \n
+ *    By default "false" is assumed.\n
+ * \parameter MaximumCenterOfGravityErrorForCenteredTransformInitialization: for the
+ *    CenterOfGravity method, the maximum estimated standard error of the centers of
+ *    gravity, in physical units. If the estimate is larger, the number of samples is
+ *    increased, up to all voxels. \n
+ *    example: <tt>(MaximumCenterOfGravityErrorForCenteredTransformInitialization 0.5)</tt> \n
+ *    By default 0 is assumed, which means that the number of samples is not increased.\n
  *
  * The transform parameters necessary for transformix, additionally defined by this class, are:
  * \transformparameter CenterOfRotation: stores the center of rotation as an index. \n
@@ -131,6 +142,7 @@ public:
   typedef typename Superclass2::ElastixType              ElastixType;
   typedef typename Superclass2::ElastixPointer           ElastixPointer;
   typedef typename Superclass2::ParameterMapType         ParameterMapType;
+  typedef typename Superclass2::NumericParameterMapType  NumericParameterMapType;
   typedef typename Superclass2::ConfigurationType        ConfigurationType;
   typedef typename Superclass2::ConfigurationPointer     ConfigurationPointer;
   typedef typename Superclass2::RegistrationType         RegistrationType;
@@ -206,7 +218,8 @@ public:
    * Creates the TransformParametersmap
    */
   void CreateTransformParametersMap(
-    const ParametersType & param, ParameterMapType * paramsMap ) const override;
+    const ParametersType & param, ParameterMapType * paramsMap,
+    NumericParameterMapType * numericParamsMap ) const override;
 
 protected:
 
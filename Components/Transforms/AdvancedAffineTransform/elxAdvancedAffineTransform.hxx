@@ -148,14 +148,15 @@ void
 AdvancedAffineTransformElastix< TElastix >
 ::CreateTransformParametersMap(
   const ParametersType & param,
-  ParameterMapType * paramsMap ) const
+  ParameterMapType * paramsMap,
+  NumericParameterMapType * numericParamsMap ) const
 {
   std::ostringstream         tmpStream;
   std::string                parameterName;
   std::vector< std::string > parameterValues;
 
   /** Call the CreateTransformParametersMap from the TransformBase. */
-  this->Superclass2::CreateTransformParametersMap( param, paramsMap );
+  this->Superclass2::CreateTransformParametersMap( param, paramsMap, numericParamsMap );
 
   /** Get the center of rotation point and write it to file. */
   InputPointType rotationPoint = this->m_AffineTransform->GetCenter();
@@ -309,6 +310,19 @@ AdvancedAffineTransformElastix< TElastix >
         "NumberOfSamplesForCenteredTransformInitialization", 0 );
       transformInitializer->SetNumberOfSamplesForCenteredTransformInitialization( nrofsamples );
 
+      /** Draw the samples randomly instead of on a grid, and optionally
+       * bound the estimated error of the centers of gravity.
+       */
+      bool useRandomSampling = false;
+      this->m_Configuration->ReadParameter( useRandomSampling,
+        "UseRandomSamplingForCenteredTransformInitialization", 0, false );
+      transformInitializer->SetUseRandomSampling( useRandomSampling );
+
+      double maximumError = 0.0;
+      this->m_Configuration->ReadParameter( maximumError,
+        "MaximumCenterOfGravityErrorForCenteredTransformInitialization", 0, false );
+      transformInitializer->SetMaximumCenterOfGravityError( maximumError );
+
       transformInitializer->MomentsOn();
     }
     else if( method == "Origins" )
@@ -327,6 +341,15 @@ AdvancedAffineTransformElastix< TElastix >
       transformInitializer->GeometryTopOn();
     }
     transformInitializer->InitializeTransform();
+
+    if( method == "CenterOfGravity" )
+    {
+      elxout << "  Estimated standard error of the centers of gravity: fixed "
+             << transformInitializer->GetFixedCalculator()->GetCenterOfGravityStandardError()
+             << ", moving "
+             << transformInitializer->GetMovingCalculator()->GetCenterOfGravityStandardError()
+             << std::endl;
+    }
   }
 
   /** Set the translation to zero, if no AutomaticTransformInitialization
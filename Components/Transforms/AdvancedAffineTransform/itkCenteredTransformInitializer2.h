@@ -167,6 +167,18 @@ public:
   itkSetMacro( LowerThresholdForCenterGravity, InputPixelType );
   itkSetMacro( CenterOfGravityUsesLowerThreshold, bool );
 
+  /** Use a random subsample of the images for the moments, instead of a
+   * regular grid. Default: false.
+   */
+  itkSetMacro( UseRandomSampling, bool );
+
+  /** The maximum estimated standard error of the centers of gravity, in
+   * physical units. When the estimate from the samples is larger, the
+   * moments are recomputed with more samples, up to all voxels. A value
+   * of zero (the default) disables this.
+   */
+  itkSetMacro( MaximumCenterOfGravityError, double );
+
   /** Initialize the transform using data from the images */
   virtual void InitializeTransform();
 
@@ -194,6 +206,15 @@ protected:
   SizeValueType  m_NumberOfSamplesForCenteredTransformInitialization;
   InputPixelType m_LowerThresholdForCenterGravity;
   bool           m_CenterOfGravityUsesLowerThreshold;
+  bool           m_UseRandomSampling;
+  double         m_MaximumCenterOfGravityError;
+
+  /** Compute the moments with the calculator, increasing the number of
+   * samples until the standard error of the center of gravity is below
+   * m_MaximumCenterOfGravityError.
+   */
+  template< class TCalculator >
+  void ComputeMoments( TCalculator * calculator, const SizeValueType numberOfPixels ) const;
 
 private:
 
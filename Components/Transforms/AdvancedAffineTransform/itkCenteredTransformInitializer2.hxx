@@ -37,6 +37,8 @@
 #include "itkCenteredTransformInitializer2.h"
 #include "itkImageMaskSpatialObject.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -53,6 +55,48 @@ CenteredTransformInitializer2< TTransform, TFixedImage, TMovingImage >
   this->m_CenterOfGravityUsesLowerThreshold = false;
   this->m_NumberOfSamplesForCenteredTransformInitialization = 10000;
   this->m_LowerThresholdForCenterGravity = 500;
+  this->m_UseRandomSampling           = false;
+  this->m_MaximumCenterOfGravityError = 0.0;
+}
+
+
+/** Compute the moments, with a bounded error of the center of gravity */
+template< class TTransform, class TFixedImage, class TMovingImage >
+template< class TCalculator >
+void
+CenteredTransformInitializer2< TTransform, TFixedImage, TMovingImage >
+::ComputeMoments( TCalculator * calculator, const SizeValueType numberOfPixels ) const
+{
+  calculator->SetUseRandomSampling( this->m_UseRandomSampling );
+
+  SizeValueType numberOfSamples = this->m_NumberOfSamplesForCenteredTransformInitialization;
+  while( true )
+  {
+    calculator->SetNumberOfSamplesForCenteredTransformInitialization( numberOfSamples );
+    calculator->Compute();
+
+    if( this->m_MaximumCenterOfGravityError <= 0.0 || numberOfSamples >= numberOfPixels )
+    {
+      break;
+    }
+
+    const typename TCalculator::VectorType error = calculator->GetCenterOfGravityStandardError();
+    double maximumError = 0.0;
+    for( unsigned int i = 0; i < TCalculator::ImageDimension; ++i )
+    {
+      maximumError = std::max( maximumError, static_cast< double >( error[ i ] ) );
+    }
+    if( maximumError <= this->m_MaximumCenterOfGravityError )
+    {
+      break;
+    }
+
+    /** The error decreases with the square root of the number of samples. */
+    const double ratio  = maximumError / this->m_MaximumCenterOfGravityError;
+    const double factor = std::max( 2.0, 1.1 * ratio * ratio );
+    numberOfSamples = static_cast< SizeValueType >( std::min(
+      factor * static_cast< double >( numberOfSamples ), static_cast< double >( numberOfPixels ) ) );
+  }
 }
 
 
@@ -123,9 +167,8 @@ CenteredTransformInitializer2< TTransform, TFixedImage, TMovingImage >
       m_FixedCalculator->SetCenterOfGravityUsesLowerThreshold( this->m_CenterOfGravityUsesLowerThreshold );
       m_FixedCalculator->SetLowerThresholdForCenterGravity( this->m_LowerThresholdForCenterGravity );
     }
-    m_FixedCalculator->SetNumberOfSamplesForCenteredTransformInitialization(
-      this->m_NumberOfSamplesForCenteredTransformInitialization );
-    m_FixedCalculator->Compute();
+    this->ComputeMoments( m_FixedCalculator.GetPointer(),
+      m_FixedImage->GetRequestedRegion().GetNumberOfPixels() );
 
     m_MovingCalculator->SetImage( m_MovingImage );
     m_MovingCalculator->SetSpatialObjectMask( movingMaskAsSpatialObject );
@@ -135,9 +178,8 @@ CenteredTransformInitializer2< TTransform, TFixedImage, TMovingImage >
       m_MovingCalculator->SetCenterOfGravityUsesLowerThreshold( this->m_CenterOfGravityUsesLowerThreshold );
       m_MovingCalculator->SetLowerThresholdForCenterGravity( this->m_LowerThresholdForCenterGravity );
     }
-    m_MovingCalculator->SetNumberOfSamplesForCenteredTransformInitialization(
-      this->m_NumberOfSamplesForCenteredTransformInitialization );
-    m_MovingCalculator->Compute();
+    this->ComputeMoments( m_MovingCalculator.GetPointer(),
+      m_MovingImage->GetRequestedRegion().GetNumberOfPixels() );
 
     typename FixedImageCalculatorType::VectorType fixedCenter = m_FixedCalculator->GetCenterOfGravity();
 
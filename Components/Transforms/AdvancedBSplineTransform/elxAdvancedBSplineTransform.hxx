@@ -641,14 +641,15 @@ void
 AdvancedBSplineTransform< TElastix >
 ::CreateTransformParametersMap(
   const ParametersType & param,
-  ParameterMapType * paramsMap ) const
+  ParameterMapType * paramsMap,
+  NumericParameterMapType * numericParamsMap ) const
 {
   std::ostringstream         tmpStream;
   std::string                parameterName;
   std::vector< std::string > parameterValues;
 
   /** Call the CreateTransformParametersMap from the TransformBase. */
-  this->Superclass2::CreateTransformParametersMap( param, paramsMap );
+  this->Superclass2::CreateTransformParametersMap( param, paramsMap, numericParamsMap );
 
   /** Add some BSplineTransform specific lines. */
 
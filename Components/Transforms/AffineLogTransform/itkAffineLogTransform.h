@@ -108,7 +108,9 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
-  /** Update the m_JacobianOfSpatialJacobian.  */
+  /** Update the m_JacobianOfSpatialJacobian, the matrix exponential of
+   * m_MatrixLogDomain, and the coefficients used by GetJacobian().
+   */
   virtual void PrecomputeJacobianOfSpatialJacobian( void );
 
 private:
@@ -118,6 +120,20 @@ private:
 
   MatrixType m_MatrixLogDomain;
 
+  /** The matrix exponential of m_MatrixLogDomain. It is only recomputed,
+   * together with its derivatives, when m_MatrixLogDomain changes.
+   */
+  MatrixType m_MatrixExponential;
+  bool       m_MatrixExponentialIsValid;
+
+  /** The derivatives of the matrix exponential with respect to the entries
+   * of m_MatrixLogDomain, ordered such that the Jacobian at a point p is a
+   * small matrix product:
+   * J( i, k ) = \sum_l m_JacobianCoefficients[ ( i * d * d + k ) * d + l ] * ( p - c )_l
+   * for the d * d matrix parameters k.
+   */
+  FixedArray< ScalarType, Dimension * Dimension * Dimension * Dimension > m_JacobianCoefficients;
+
 };
 
 }  // namespace itk
@@ -32,6 +32,7 @@ AffineLogTransform< TScalarType, Dimension >
   Superclass( ParametersDimension )
 {
   this->m_MatrixLogDomain.Fill( itk::NumericTraits< ScalarType >::Zero );
+  this->m_MatrixExponentialIsValid = false;
   this->PrecomputeJacobianOfSpatialJacobian();
 }
 
@@ -51,7 +52,11 @@ AffineLogTransform< TScalarType, Dimension >
   }
   this->SetOffset( off );
 
+  /** m_MatrixLogDomain is not known here, so SetParameters() should
+   * recompute the exponential.
+   */
   this->PrecomputeJacobianOfSpatialJacobian();
+  this->m_MatrixExponentialIsValid = false;
 }
 
 
@@ -63,6 +68,7 @@ AffineLogTransform< TScalarType, Dimension >
   Superclass( spaceDimension, parametersDimension )
 {
   this->m_MatrixLogDomain.Fill( itk::NumericTraits< ScalarType >::Zero );
+  this->m_MatrixExponentialIsValid = false;
   this->PrecomputeJacobianOfSpatialJacobian();
 }
 
@@ -76,22 +82,28 @@ AffineLogTransform< TScalarType, Dimension >
   itkDebugMacro( << "Setting parameters " << parameters );
   unsigned int k = 0; //Dummy loop index
 
-  MatrixType exponentMatrix;
+  MatrixType matrixLogDomain;
 
   for( unsigned int i = 0; i < Dimension; i++ )
   {
     for( unsigned int j = 0; j < Dimension; j++ )
     {
-      this->m_MatrixLogDomain( i, j ) = parameters[ k ];
-      k                              += 1;
+      matrixLogDomain( i, j ) = parameters[ k ];
+      k                      += 1;
     }
   }
 
-  exponentMatrix = vnl_matrix_exp( this->m_MatrixLogDomain.GetVnlMatrix() );
-
-  this->PrecomputeJacobianOfSpatialJacobian();
+  /** The matrix exponential and its derivatives only depend on the
+   * matrix part of the parameters, so they are only recomputed when
+   * that part changes.
+   */
+  if( !this->m_MatrixExponentialIsValid || matrixLogDomain != this->m_MatrixLogDomain )
+  {
+    this->m_MatrixLogDomain = matrixLogDomain;
+    this->PrecomputeJacobianOfSpatialJacobian();
+  }
 
-  this->SetVarMatrix( exponentMatrix );
+  this->SetVarMatrix( this->m_MatrixExponential );
 
   OutputVectorType off;
 
@@ -157,27 +169,38 @@ AffineLogTransform< TScalarType, Dimension >::GetJacobian( const InputPointType
   JacobianType & j,
   NonZeroJacobianIndicesType & nzji ) const
 {
-  unsigned int d = Dimension;
+  const unsigned int d  = Dimension;
+  const unsigned int d2 = Dimension * Dimension;
 
   j.SetSize( d, ParametersDimension );
-  j.Fill( itk::NumericTraits< ScalarType >::Zero );
 
-  const JacobianOfSpatialJacobianType & jsj = this->m_JacobianOfSpatialJacobian;
-  const InputVectorType                 pp  = p - this->GetCenter();
-  for( unsigned int dim = 0; dim < d * d; dim++ )
+  /** The derivatives with respect to the matrix parameters are a product of
+   * the precomputed coefficients and p - c.
+   */
+  const InputVectorType pp = p - this->GetCenter();
+  const ScalarType *    coefficients = this->m_JacobianCoefficients.GetDataPointer();
+  for( unsigned int i = 0; i < d; ++i )
   {
-    const InputVectorType column = jsj[ dim ] * pp;
-    for( unsigned int i = 0; i < d; ++i )
+    for( unsigned int dim = 0; dim < d2; ++dim )
     {
-      j( i, dim ) = column[ i ];
+      ScalarType sum = itk::NumericTraits< ScalarType >::Zero;
+      for( unsigned int l = 0; l < d; ++l )
+      {
+        sum += coefficients[ l ] * pp[ l ];
+      }
+      j( i, dim ) = sum;
+      coefficients += d;
     }
   }
 
   // compute derivatives for the translation part
-  const unsigned int blockOffset = d * d;
-  for( unsigned int dim = 0; dim < Dimension; dim++ )
+  const unsigned int blockOffset = d2;
+  for( unsigned int i = 0; i < d; ++i )
   {
-    j[ dim ][ blockOffset + dim ] = 1.0;
+    for( unsigned int dim = 0; dim < d; ++dim )
+    {
+      j( i, blockOffset + dim ) = ( i == dim ) ? 1.0 : 0.0;
+    }
   }
 
   nzji = this->m_NonZeroJacobianIndices;
@@ -255,6 +278,28 @@ AffineLogTransform< TScalarType, Dimension >
     }
   }
 
+  /** The top left block of B_bar is the exponential of A. */
+  for( unsigned int k = 0; k < d; k++ )
+  {
+    for( unsigned int l = 0; l < d; l++ )
+    {
+      this->m_MatrixExponential( k, l ) = B_bar( k, l );
+    }
+  }
+  this->m_MatrixExponentialIsValid = true;
+
+  /** Reorder the derivatives for GetJacobian(). */
+  for( unsigned int i = 0; i < d; i++ )
+  {
+    for( unsigned int par = 0; par < d * d; par++ )
+    {
+      for( unsigned int l = 0; l < d; l++ )
+      {
+        this->m_JacobianCoefficients[ ( i * d * d + par ) * d + l ] = jsj[ par ]( i, l );
+      }
+    }
+  }
+
   /** Translation parameters: */
   for( unsigned int par = d * d; par < ParametersDimension; ++par )
   {
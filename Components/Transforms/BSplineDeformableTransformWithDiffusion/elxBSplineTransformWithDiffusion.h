@@ -40,6 +40,7 @@
 #include "itkMaximumImageFilter.h"
 #include "itkImageRegionIterator.h"
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkPlatformMultiThreader.h"
 
 namespace elastix
 {
@@ -376,6 +377,21 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                // purposely not implemented
 
+  /** Typedefs for computing the deformation field multi-threaded. */
+  typedef itk::PlatformMultiThreader ThreaderType;
+  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
+
+  struct MultiThreaderParameterType
+  {
+    const Self * st_Self;
+  };
+
+  /** Compute the deformation field on a part of the deformation region. */
+  void ThreadedComputeDeformationField( const RegionType & regionForThread ) const;
+
+  /** Threader callback for computing the deformation field. */
+  static ITK_THREAD_RETURN_TYPE ComputeDeformationFieldThreaderCallback( void * arg );
+
   /** Member variables for diffusion. */
   DiffusionFilterPointer      m_Diffusion;
   VectorImagePointer          m_DeformationField;
@@ -23,6 +23,7 @@
 
 #include "itkBSplineResampleImageFunction.h"
 #include "itkBSplineDecompositionImageFilter.h"
+#include "itkImageRegionSplitterSlowDimension.h"
 
 #include <cmath>
 
@@ -1138,43 +1139,15 @@ BSplineTransformWithDiffusion< TElastix >
 
   /** ------------- 1: Create deformationField. ------------- */
 
-  /** First, create a dummyImage with the right region info, so
-   * that the TransformIndexToPhysicalPoint-functions will be right.
+  /** Calculate the TransformPoint of all voxels of the deformation field,
+   * multi-threaded over slabs of the deformation region.
    */
-  typename DummyImageType::Pointer dummyImage = DummyImageType::New();
-  dummyImage->SetRegions( this->m_DeformationRegion );
-  dummyImage->SetOrigin( this->m_DeformationOrigin );
-  dummyImage->SetSpacing( this->m_DeformationSpacing );
+  MultiThreaderParameterType parameters;
+  parameters.st_Self = this;
 
-  /** Setup an iterator over dummyImage and outputImage. */
-  DummyIteratorType       iter( dummyImage, this->m_DeformationRegion );
-  VectorImageIteratorType iterout( this->m_DeformationField, this->m_DeformationRegion );
-
-  /** Declare stuff. */
-  InputPointType  inputPoint;
-  OutputPointType outputPoint;
-  VectorType      diff_point;
-  IndexType       inputIndex;
-
-  /** Calculate the TransformPoint of all voxels of the image. */
-  iter.GoToBegin();
-  iterout.GoToBegin();
-  while( !iter.IsAtEnd() )
-  {
-    inputIndex = iter.GetIndex();
-    /** Transform the points to physical space. */
-    dummyImage->TransformIndexToPhysicalPoint( inputIndex, inputPoint );
-    /** Call TransformPoint. */
-    outputPoint = this->TransformPoint( inputPoint );
-    /** Calculate the difference. */
-    for( unsigned int i = 0; i < this->FixedImageDimension; i++ )
-    {
-      diff_point[ i ] = outputPoint[ i ] - inputPoint[ i ];
-    }
-    iterout.Set( diff_point );
-    ++iter;
-    ++iterout;
-  }
+  ThreaderType::Pointer threader = ThreaderType::New();
+  threader->SetSingleMethod( ComputeDeformationFieldThreaderCallback, &parameters );
+  threader->SingleMethodExecute();
 
   /** ------------- 2: Update the intermediary deformationFieldTransform. ------------- */
 
@@ -1444,6 +1417,73 @@ BSplineTransformWithDiffusion< TElastix >
 } // end DiffuseDeformationField()
 
 
+/**
+ * ************** ThreadedComputeDeformationField ***************
+ */
+
+template< class TElastix >
+void
+BSplineTransformWithDiffusion< TElastix >
+::ThreadedComputeDeformationField( const RegionType & regionForThread ) const
+{
+  VectorImageIteratorType iterout( this->m_DeformationField, regionForThread );
+
+  /** Declare stuff. */
+  InputPointType  inputPoint;
+  OutputPointType outputPoint;
+  VectorType      diff_point;
+
+  /** Calculate the TransformPoint of all voxels of the region. */
+  for( iterout.GoToBegin(); !iterout.IsAtEnd(); ++iterout )
+  {
+    /** Transform the index to physical space. */
+    this->m_DeformationField->TransformIndexToPhysicalPoint( iterout.GetIndex(), inputPoint );
+    /** Call TransformPoint. */
+    outputPoint = this->TransformPoint( inputPoint );
+    /** Calculate the difference. */
+    for( unsigned int i = 0; i < this->FixedImageDimension; i++ )
+    {
+      diff_point[ i ] = outputPoint[ i ] - inputPoint[ i ];
+    }
+    iterout.Set( diff_point );
+  }
+
+} // end ThreadedComputeDeformationField()
+
+
+/**
+ * *********** ComputeDeformationFieldThreaderCallback **********
+ */
+
+template< class TElastix >
+ITK_THREAD_RETURN_TYPE
+BSplineTransformWithDiffusion< TElastix >
+::ComputeDeformationFieldThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct      = static_cast< ThreadInfoType * >( arg );
+  const itk::ThreadIdType      threadId        = infoStruct->WorkUnitID;
+  const itk::ThreadIdType      numberOfThreads = infoStruct->NumberOfWorkUnits;
+  MultiThreaderParameterType * parameters
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  /** Split the region in slabs along the slowest dimension. */
+  typedef itk::ImageRegionSplitterSlowDimension RegionSplitterType;
+  RegionSplitterType::Pointer splitter        = RegionSplitterType::New();
+  RegionType                  regionForThread = parameters->st_Self->m_DeformationRegion;
+  const unsigned int          numberOfSplits  = splitter->GetSplit(
+    threadId, numberOfThreads, regionForThread );
+
+  if( threadId < numberOfSplits )
+  {
+    parameters->st_Self->ThreadedComputeDeformationField( regionForThread );
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeDeformationFieldThreaderCallback()
+
+
 /**
  * ******************* TransformPoint ******************
  */
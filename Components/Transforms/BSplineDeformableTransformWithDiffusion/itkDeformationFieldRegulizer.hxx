@@ -71,15 +71,9 @@ DeformationFieldRegulizer< TAnyITKTransform >
   }
 
   /** Set everything to zero. */
-  IteratorType it( intermediaryDeformationField,
-  intermediaryDeformationField->GetLargestPossibleRegion() );
   VectorPixelType vec;
   vec.Fill( NumericTraits< ScalarType >::ZeroValue() );
-  while( !it.IsAtEnd() )
-  {
-    it.Set( vec );
-    ++it;
-  }
+  intermediaryDeformationField->FillBuffer( vec );
 
   /** Set the deformation field in the transform. */
   this->m_IntermediaryDeformationFieldTransform
@@ -25,6 +25,7 @@
 #include "itkNumericTraits.h"
 
 #include "itkRescaleIntensityImageFilter.h"
+#include "itkPlatformMultiThreader.h"
 
 namespace itk
 {
@@ -37,6 +38,10 @@ namespace itk
  *
  * A mean filter is one of the family of linear filters.
  *
+ * The iterations are multi-threaded, and only the bounding box of the
+ * pixels with a coefficient c(x) of at least the minimum of the rescaled
+ * range is processed, since the other pixels are not changed by the filter.
+ *
  * \sa Image
  * \sa Neighborhood
  * \sa NeighborhoodOperator
@@ -127,19 +132,41 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
-  /** MeanImageFilter can be implemented as a multithreaded filter.
-   * Therefore, this implementation provides a ThreadedGenerateData()
-   * routine which is called for each processing thread. The output
-   * image data is allocated automatically by the superclass prior to
-   * calling ThreadedGenerateData().  ThreadedGenerateData can only
-   * write to the portion of the output image specified by the
-   * parameter "outputRegionForThread"
-   *
-   * \sa ImageToImageFilter::ThreadedGenerateData(),
-   *     ImageToImageFilter::GenerateData().
+  /** Perform the diffusion. Each iteration reads from one buffer and
+   * writes to the other, and is multi-threaded over slabs of the region
+   * that is changed by the filter.
    */
   void GenerateData( void ) override;
 
+  /** Typedefs for the multi-threaded iterations. */
+  typedef PlatformMultiThreader      ThreaderType;
+  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
+
+  struct MultiThreaderParameterType
+  {
+    const Self *           st_Self;
+    const InputImageType * st_Source;
+    InputImageType *       st_Destination;
+    InputImageRegionType   st_Region;
+    double                 st_MinimumCoefficient;
+  };
+
+  /** Compute the bounding box, in the index space of the input, of the
+   * pixels with a coefficient of at least minimumCoefficient. Returns
+   * false if there are no such pixels.
+   */
+  bool ComputeDiffusionRegion( const double minimumCoefficient,
+    InputImageRegionType & region ) const;
+
+  /** Perform one iteration on a part of the region. */
+  void ThreadedDiffuse( const InputImageType * source,
+    InputImageType * destination,
+    const InputImageRegionType & regionForThread,
+    const double minimumCoefficient ) const;
+
+  /** Threader callback for one iteration. */
+  static ITK_THREAD_RETURN_TYPE DiffuseThreaderCallback( void * arg );
+
 private:
 
   VectorMeanDiffusionImageFilter( const Self & );  // purposely not implemented
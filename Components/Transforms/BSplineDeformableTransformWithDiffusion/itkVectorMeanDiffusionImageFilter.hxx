@@ -21,11 +21,13 @@
 
 #include "itkVectorMeanDiffusionImageFilter.h"
 
-#include "itkNeighborhoodIterator.h"
+#include "itkConstNeighborhoodIterator.h"
 #include "itkImageRegionIterator.h"
-#include "itkImageRegionConstIterator.h"
-#include "itkZeroFluxNeumannBoundaryCondition.h"
-#include "itkProgressReporter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageAlgorithm.h"
+#include "itkImageRegionSplitterSlowDimension.h"
+
+#include <algorithm>
 
 namespace itk
 {
@@ -115,31 +117,14 @@ void
 VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
 ::GenerateData( void )
 {
-  // \todo to avoid all the copying we can create a vector of
-  // outputs of size this->GetNumberOfIterations(). The last
-  // output should point to this->GetOutput(). In order to avoid
-  // a big memory footprint, at some iteration k, memory of the
-  // former iteration should be released: output[ k - 1 ] = 0,
-  // and memory of the current iteration should only now be created:
-  // output[ k ] = InputImageType::New(); ...; output[ k ]->Allocate().
-  // Only for the last iteration: output[ k ]( this->GetOutput() ).
-
   /** Create feature image. */
   this->FilterGrayValueImage();
 
-  /** Declare things. */
-  unsigned int                                        i, j;
-  ZeroFluxNeumannBoundaryCondition< InputImageType >  nbc;
-  ZeroFluxNeumannBoundaryCondition< DoubleImageType > nbc2;
-  NeighborhoodIterator< InputImageType >              nit;
-  NeighborhoodIterator< DoubleImageType >             nit2;
-  VectorRealType                                      sum;
-
   /** Allocate output. */
   typename InputImageType::ConstPointer input( this->GetInput() );
   typename InputImageType::Pointer      output( this->GetOutput() );
-  typename InputImageType::Pointer outputtmp = InputImageType::New();
-  output->SetRegions( input->GetLargestPossibleRegion() );
+  const InputImageRegionType            largestRegion = input->GetLargestPossibleRegion();
+  output->SetRegions( largestRegion );
 
   try
   {
@@ -155,10 +140,34 @@ VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
     throw excp;
   }
 
-  /** Allocate a temporary output image. */
+  /** Copy input to output. */
+  ImageAlgorithm::Copy( input.GetPointer(), output.GetPointer(), largestRegion, largestRegion );
+
+  /** Pixels with c(x) below the minimum of the rescaled range are not
+   * filtered. Pixels at the minimum itself are filtered, with weight c(x).
+   */
+  const double minimumCoefficient
+    = static_cast< double >( this->m_RescaleFilter->GetOutputMinimum() );
+
+  /** Only the bounding box of the filtered pixels changes. Since the output
+   * outside this box equals the input, no padding is needed.
+   */
+  InputImageRegionType diffusionRegion;
+  if( this->GetNumberOfIterations() == 0
+    || !this->ComputeDiffusionRegion( minimumCoefficient, diffusionRegion ) )
+  {
+    return;
+  }
+
+  /** Allocate a temporary output image. Each iteration reads from one of
+   * output and outputtmp and writes to the other. The pixels that are read,
+   * i.e. the diffusion region padded by the radius, should hold the input.
+   */
+  typename InputImageType::Pointer outputtmp = InputImageType::New();
   outputtmp->SetSpacing( input->GetSpacing() );
   outputtmp->SetOrigin( input->GetOrigin() );
-  outputtmp->SetRegions( input->GetLargestPossibleRegion() );
+  outputtmp->SetDirection( input->GetDirection() );
+  outputtmp->SetRegions( largestRegion );
 
   try
   {
@@ -174,132 +183,190 @@ VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
     throw excp;
   }
 
-  // support progress methods/callbacks
-  //ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
+  InputImageRegionType paddedRegion = diffusionRegion;
+  paddedRegion.PadByRadius( this->m_Radius );
+  paddedRegion.Crop( largestRegion );
+  ImageAlgorithm::Copy( input.GetPointer(), outputtmp.GetPointer(), paddedRegion, paddedRegion );
 
-  /** Copy input to output. */
-  ImageRegionConstIterator< InputImageType > in_it(
-  input, input->GetLargestPossibleRegion() );
-  ImageRegionIterator< InputImageType > out_it(
-  output, input->GetLargestPossibleRegion() );
-  in_it.GoToBegin();
-  out_it.GoToBegin();
-  while( !in_it.IsAtEnd() )
+  /** Setup the threader. */
+  MultiThreaderParameterType parameters;
+  parameters.st_Self               = this;
+  parameters.st_Region             = diffusionRegion;
+  parameters.st_MinimumCoefficient = minimumCoefficient;
+
+  ThreaderType::Pointer threader = ThreaderType::New();
+  threader->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  threader->SetSingleMethod( DiffuseThreaderCallback, &parameters );
+
+  /** Loop over the number of iterations. The first source is chosen such
+   * that the last iteration writes to the output.
+   */
+  const unsigned int numberOfIterations = this->GetNumberOfIterations();
+  InputImageType *   source             = output.GetPointer();
+  InputImageType *   destination        = outputtmp.GetPointer();
+  if( numberOfIterations % 2 == 1 ) { std::swap( source, destination ); }
+  for( unsigned int k = 0; k < numberOfIterations; k++ )
   {
-    out_it.Set( in_it.Get() );
-    ++in_it;
-    ++out_it;
+    parameters.st_Source      = source;
+    parameters.st_Destination = destination;
+    threader->SingleMethodExecute();
+    std::swap( source, destination );
   }
 
-  /** Setup neighborhood iterator for the output deformation image. */
-  nit = NeighborhoodIterator< InputImageType >(
-    this->m_Radius, output, output->GetLargestPossibleRegion() );
-  unsigned int neighborhoodSize = nit.Size();
-  nit.OverrideBoundaryCondition( &nbc );
+} // end GenerateData()
 
-  /** Setup neighborhood iterator for the "stiffness coefficient" image. */
-  nit2 = NeighborhoodIterator< DoubleImageType >(
-    this->m_Radius, this->m_Cx, this->m_Cx->GetLargestPossibleRegion() );
-  nit2.OverrideBoundaryCondition( &nbc2 );
 
-  /** Setup iterator over outputtmp. */
-  ImageRegionIterator< InputImageType > oit(
-  outputtmp, input->GetLargestPossibleRegion() );
+/**
+ * ****************** ComputeDiffusionRegion ********************
+ */
 
-  /** Initialize c and ci. */
-  double c  = 0.0;
-  double ci = 0.0;
+template< class TInputImage, class TGrayValueImage >
+bool
+VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
+::ComputeDiffusionRegion( const double minimumCoefficient,
+  InputImageRegionType & region ) const
+{
+  const typename DoubleImageType::RegionType cxRegion
+    = this->m_Cx->GetLargestPossibleRegion();
+  const IndexType cxStart = cxRegion.GetIndex();
+
+  /** Compute the bounding box in the index space of m_Cx. */
+  IndexType minIndex = cxRegion.GetUpperIndex();
+  IndexType maxIndex = cxStart;
+  bool      found    = false;
 
-  /** Loop over the number of iterations. */
-  for( unsigned int k = 0; k < this->GetNumberOfIterations(); k++ )
+  ImageRegionConstIteratorWithIndex< DoubleImageType > it( this->m_Cx, cxRegion );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
   {
-    /** Reset the iterators. */
-    nit.GoToBegin();
-    nit2.GoToBegin();
-    oit.GoToBegin();
+    if( it.Get() < minimumCoefficient ) { continue; }
 
-    /** The actual work. */
-    while( !nit.IsAtEnd() )
+    const IndexType index = it.GetIndex();
+    for( unsigned int j = 0; j < InputImageDimension; j++ )
     {
-      /** Speed up: do not filter locations where c(x) = 0. */
-      if( nit2.GetCenterPixel() < 0.000001 )
-      {
-        /** Just copy input to output. */
-        oit.Set( nit.GetCenterPixel() );
-      }
-      else
-      {
-        /** Initialize the sum to 0. */
-        for( j = 0; j < InputImageDimension; j++ )
-        {
-          sum[ j ] = NumericTraits< double >::Zero;
-        }
-
-        /** Initialize sumc. */
-        double sumc = 0.0;
-
-        /** Calculate the weighted mean over the neighborhood.
-         * mean = SUthis->m_i{ ci * x_i } / SUthis->m_i{ ci }
-         */
-        for( i = 0; i < neighborhoodSize; ++i )
-        {
-          /** Get current pixel in this neighborhood. */
-          InputPixelType pix = nit.GetPixel( i );
-
-          /** Get ci-value on current index. */
-          ci = nit2.GetPixel( i );
-
-          /** Calculate SUthis->m_i{ ci } and SUthis->m_i{ ci * x_i }. */
-          sumc += ci;
-          for( j = 0; j < InputImageDimension; j++ )
-          {
-            sum[ j ] += ci * static_cast< double >( pix[ j ] );
-          }
-        }
-
-        /** Get the mean value by dividing by sumc. */
-        InputPixelType mean;
-        for( j = 0; j < InputImageDimension; j++ )
-        {
-          if( sumc < 0.00001 ) { mean[ j ] = 0.0; }
-          else { mean[ j ] = static_cast< ValueType >( sum[ j ] / sumc ); }
-        }
-
-        /** Get c. */
-        c = nit2.GetCenterPixel();
-
-        /** Set 'y = (1 - c) * x + c * mean' to the temporary output. */
-        InputPixelType value = nit.GetCenterPixel() * ( 1.0 - c ) + mean * c;
-
-        /** Set it. */
-        oit.Set( value );
-
-      } // end if c < 0.000001
-
-      /** Increase all iterators. */
-      ++nit;
-      ++nit2;
-      ++oit;
-      //progress.CompletedPixel();
-
-    } // end while
-
-    /** Copy outputtmp to output. */
-    if( this->GetNumberOfIterations() > 0 )
+      minIndex[ j ] = std::min( minIndex[ j ], index[ j ] );
+      maxIndex[ j ] = std::max( maxIndex[ j ], index[ j ] );
+    }
+    found = true;
+  }
+
+  if( !found ) { return false; }
+
+  /** Translate it to the index space of the input. */
+  const typename IndexType::OffsetType offset
+    = this->GetInput()->GetLargestPossibleRegion().GetIndex() - cxStart;
+  region.SetIndex( minIndex + offset );
+  region.SetUpperIndex( maxIndex + offset );
+
+  return true;
+
+} // end ComputeDiffusionRegion()
+
+
+/**
+ * ******************** ThreadedDiffuse *************************
+ */
+
+template< class TInputImage, class TGrayValueImage >
+void
+VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
+::ThreadedDiffuse( const InputImageType * source,
+  InputImageType * destination,
+  const InputImageRegionType & regionForThread,
+  const double minimumCoefficient ) const
+{
+  /** The corresponding region in the "stiffness coefficient" image. */
+  typename DoubleImageType::RegionType cxRegionForThread = regionForThread;
+  cxRegionForThread.SetIndex( regionForThread.GetIndex()
+    + ( this->m_Cx->GetLargestPossibleRegion().GetIndex()
+    - source->GetLargestPossibleRegion().GetIndex() ) );
+
+  /** Setup the iterators. The neighborhood iterators use a
+   * ZeroFluxNeumannBoundaryCondition by default.
+   */
+  ConstNeighborhoodIterator< InputImageType > nit(
+    this->m_Radius, source, regionForThread );
+  ConstNeighborhoodIterator< DoubleImageType > nit2(
+    this->m_Radius, this->m_Cx, cxRegionForThread );
+  ImageRegionIterator< InputImageType > oit( destination, regionForThread );
+  const unsigned int neighborhoodSize = nit.Size();
+
+  /** The actual work. */
+  VectorRealType sum;
+  for( nit.GoToBegin(), nit2.GoToBegin(), oit.GoToBegin(); !oit.IsAtEnd(); ++nit, ++nit2, ++oit )
+  {
+    /** Speed up: do not filter locations where c(x) is below the minimum. */
+    const double c = nit2.GetCenterPixel();
+    if( c < minimumCoefficient )
     {
-      out_it.GoToBegin();
-      oit.GoToBegin();
-      while( !out_it.IsAtEnd() )
+      /** Just copy input to output. */
+      oit.Set( nit.GetCenterPixel() );
+      continue;
+    }
+
+    /** Calculate the weighted mean over the neighborhood.
+     * mean = SUM_i{ ci * x_i } / SUM_i{ ci }
+     */
+    sum.Fill( NumericTraits< double >::Zero );
+    double sumc = 0.0;
+    for( unsigned int i = 0; i < neighborhoodSize; ++i )
+    {
+      const InputPixelType pix = nit.GetPixel( i );
+      const double         ci  = nit2.GetPixel( i );
+      sumc += ci;
+      for( unsigned int j = 0; j < InputImageDimension; j++ )
       {
-        out_it.Set( oit.Get() );
-        ++out_it;
-        ++oit;
+        sum[ j ] += ci * static_cast< double >( pix[ j ] );
       }
-    } // end if GetNumberOfIterations() > 0
+    }
 
-  } // end for NumberOfIterations
+    /** Get the mean value by dividing by sumc. */
+    InputPixelType mean;
+    for( unsigned int j = 0; j < InputImageDimension; j++ )
+    {
+      if( sumc < 0.00001 ) { mean[ j ] = 0.0; }
+      else { mean[ j ] = static_cast< ValueType >( sum[ j ] / sumc ); }
+    }
 
-} // end GenerateData()
+    /** Set 'y = (1 - c) * x + c * mean' to the temporary output. */
+    oit.Set( nit.GetCenterPixel() * ( 1.0 - c ) + mean * c );
+
+  } // end for
+
+} // end ThreadedDiffuse()
+
+
+/**
+ * ****************** DiffuseThreaderCallback *******************
+ */
+
+template< class TInputImage, class TGrayValueImage >
+ITK_THREAD_RETURN_TYPE
+VectorMeanDiffusionImageFilter< TInputImage, TGrayValueImage >
+::DiffuseThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct      = static_cast< ThreadInfoType * >( arg );
+  const ThreadIdType           threadId        = infoStruct->WorkUnitID;
+  const ThreadIdType           numberOfThreads = infoStruct->NumberOfWorkUnits;
+  MultiThreaderParameterType * parameters
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  /** Split the region in slabs along the slowest dimension. */
+  typedef ImageRegionSplitterSlowDimension RegionSplitterType;
+  RegionSplitterType::Pointer splitter = RegionSplitterType::New();
+  InputImageRegionType        regionForThread = parameters->st_Region;
+  const unsigned int          numberOfSplits  = splitter->GetSplit(
+    threadId, numberOfThreads, regionForThread );
+
+  if( threadId < numberOfSplits )
+  {
+    parameters->st_Self->ThreadedDiffuse( parameters->st_Source,
+      parameters->st_Destination, regionForThread, parameters->st_MinimumCoefficient );
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end DiffuseThreaderCallback()
 
 
 /**
@@ -182,6 +182,7 @@ public:
   /** Typedefs inherited from the superclass. */
   typedef typename Superclass1::ParametersType         ParametersType;
   typedef typename Superclass2::ParameterMapType       ParameterMapType;
+  typedef typename Superclass2::NumericParameterMapType NumericParameterMapType;
   typedef typename Superclass1::NumberOfParametersType NumberOfParametersType;
 
   /** Typedef's specific for the BSplineTransform. */
@@ -286,7 +287,8 @@ public:
 
   /** Function to create transform-parameters map */
   void CreateTransformParametersMap(
-    const ParametersType & param, ParameterMapType * paramsMap ) const override;
+    const ParametersType & param, ParameterMapType * paramsMap,
+    NumericParameterMapType * numericParamsMap ) const override;
 
 protected:
 
@@ -137,6 +137,7 @@ public:
   typedef typename Superclass2::ElastixType              ElastixType;
   typedef typename Superclass2::ElastixPointer           ElastixPointer;
   typedef typename Superclass2::ParameterMapType         ParameterMapType;
+  typedef typename Superclass2::NumericParameterMapType  NumericParameterMapType;
   typedef typename Superclass2::ConfigurationType        ConfigurationType;
   typedef typename Superclass2::ConfigurationPointer     ConfigurationPointer;
   typedef typename Superclass2::RegistrationType         RegistrationType;
@@ -210,7 +211,8 @@ public:
    * Creates the TransformParametersmap
    */
   void CreateTransformParametersMap(
-    const ParametersType & param, ParameterMapType * paramsMap ) const override;
+    const ParametersType & param, ParameterMapType * paramsMap,
+    NumericParameterMapType * numericParamsMap ) const override;
 
 protected:
 
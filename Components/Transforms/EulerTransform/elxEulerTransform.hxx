@@ -160,14 +160,15 @@ void
 EulerTransformElastix< TElastix >
 ::CreateTransformParametersMap(
   const ParametersType & param,
-  ParameterMapType * paramsMap ) const
+  ParameterMapType * paramsMap,
+  NumericParameterMapType * numericParamsMap ) const
 {
   std::ostringstream         tmpStream;
   std::string                parameterName;
   std::vector< std::string > parameterValues;
 
   /** Call the CreateTransformParametersMap from the TransformBase. */
-  this->Superclass2::CreateTransformParametersMap( param, paramsMap );
+  this->Superclass2::CreateTransformParametersMap( param, paramsMap, numericParamsMap );
 
   /** Get the center of rotation point and write it to file. */
   parameterName = "CenterOfRotationPoint";
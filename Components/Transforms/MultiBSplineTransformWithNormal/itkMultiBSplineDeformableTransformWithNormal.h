@@ -501,6 +501,25 @@ private:
 
   void PointToLabel( const InputPointType & p, int & l ) const;
 
+  /** Store the geometry and buffer of the label image, so that PointToLabel()
+   * is a direct lookup in the label buffer.
+   */
+  void UpdateLabelLookup( void );
+
+  /** Compute T_0(p) + T_l(p) - p for label l. Both transforms share the
+   * grid, so the weights and the support region are computed once.
+   */
+  void TransformPointWithLabel( const InputPointType & point,
+    const int lidx, OutputPointType & outputPoint ) const;
+
+  /** The label lookup. */
+  typedef typename ImageLabelType::DirectionType LabelPointToIndexType;
+  const unsigned char *                          m_LabelsBuffer;
+  typename ImageLabelType::RegionType            m_LabelsRegion;
+  typename ImageLabelType::PointType             m_LabelsOrigin;
+  LabelPointToIndexType                          m_LabelsPointToIndex;
+  OffsetValueType                                m_LabelsOffsetTable[ NDimensions ];
+
 };
 
 } // end namespace itk
@@ -28,6 +28,7 @@
 #include "itkAddImageFilter.h"
 #include "itkMaskImageFilter.h"
 #include "itkConstantPadImageFilter.h"
+#include "itkImageScanlineConstIterator.h"
 
 namespace itk
 {
@@ -41,6 +42,7 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
   this->m_NbLabels           = 0;
   this->m_Labels             = 0;
   this->m_LabelsInterpolator = 0;
+  this->m_LabelsBuffer       = nullptr;
   this->m_Trans.resize( 1 );
   // keep transform 0 to store parameters that are not kept here (GridSize, ...)
   this->m_Trans[ 0 ] = TransformType::New();
@@ -174,12 +176,35 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     }
     this->m_LabelsInterpolator = ImageLabelInterpolator::New();
     this->m_LabelsInterpolator->SetInputImage( this->m_Labels );
+    this->UpdateLabelLookup();
     // Restore settings
     this->SetFixedParameters( para );
   }
 }
 
 
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrder >
+::UpdateLabelLookup( void )
+{
+  this->m_LabelsBuffer = nullptr;
+  if( this->m_Labels.IsNull() )
+  {
+    return;
+  }
+
+  this->m_LabelsBuffer       = this->m_Labels->GetBufferPointer();
+  this->m_LabelsRegion       = this->m_Labels->GetBufferedRegion();
+  this->m_LabelsOrigin       = this->m_Labels->GetOrigin();
+  this->m_LabelsPointToIndex = this->m_Labels->GetPhysicalPointToIndexMatrix();
+  for( unsigned int i = 0; i < NDimensions; ++i )
+  {
+    this->m_LabelsOffsetTable[ i ] = this->m_Labels->GetOffsetTable()[ i ];
+  }
+}
+
+
 template< class TScalarType, unsigned int NDimensions >
 struct UpdateLocalBases_impl
 {
@@ -458,6 +483,9 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
   m_LocalBases->SetDirection( GetGridDirection() );
   m_LocalBases->Allocate();
   UpdateLocalBases_impl< TScalarType, NDimensions >::Do( this->m_LocalBases, this->m_LabelsNormals );
+
+  // The label image may have been updated since SetLabels()
+  this->UpdateLabelLookup();
 }
 
 
@@ -662,11 +690,104 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
 {
   l = 0;
   assert( this->m_Labels );
-  typename ImageLabelInterpolator::IndexType idx;
-  this->m_LabelsInterpolator->ConvertPointToNearestIndex( p, idx );
-  if( this->m_LabelsInterpolator->IsInsideBuffer( idx ) )
+  assert( this->m_LabelsBuffer );
+
+  // Nearest neighbor lookup, as in NearestNeighborInterpolateImageFunction
+  const typename ImageLabelType::IndexType & start = this->m_LabelsRegion.GetIndex();
+  const typename ImageLabelType::SizeType &  size  = this->m_LabelsRegion.GetSize();
+  OffsetValueType                            offset = 0;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    double sum = 0.0;
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      sum += this->m_LabelsPointToIndex[ i ][ j ] * ( p[ j ] - this->m_LabelsOrigin[ j ] );
+    }
+    const IndexValueType index = Math::RoundHalfIntegerUp< IndexValueType >( sum ) - start[ i ];
+    if( index < 0 || index >= static_cast< IndexValueType >( size[ i ] ) )
+    {
+      return;
+    }
+    offset += index * this->m_LabelsOffsetTable[ i ];
+  }
+  l = static_cast< int >( this->m_LabelsBuffer[ offset ] ) + 1;
+}
+
+
+template< class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrder >
+::TransformPointWithLabel( const InputPointType & point,
+  const int lidx, OutputPointType & outputPoint ) const
+{
+  outputPoint = point;
+  if( lidx == 0 )
   {
-    l = static_cast< int >( this->m_LabelsInterpolator->EvaluateAtIndex( idx ) ) + 1;
+    return;
+  }
+
+  const TransformType * normalTransform = this->m_Trans[ 0 ].GetPointer();
+  const TransformType * labelTransform  = this->m_Trans[ lidx ].GetPointer();
+  if( !normalTransform->m_CoefficientImages[ 0 ] || !labelTransform->m_CoefficientImages[ 0 ] )
+  {
+    outputPoint = normalTransform->TransformPoint( point )
+      + ( labelTransform->TransformPoint( point ) - point );
+    return;
+  }
+
+  // NOTE: if the support region does not lie totally within the grid
+  // both transforms have zero displacement
+  typename TransformType::ContinuousIndexType cindex;
+  normalTransform->TransformPointToContinuousGridIndex( point, cindex );
+  if( !normalTransform->InsideValidRegion( cindex ) )
+  {
+    return;
+  }
+
+  // Compute the interpolation weights once
+  typedef typename TransformType::WeightsType WeightsType;
+  const unsigned long                         numberOfWeights = TransformType::WeightsFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType             weightsArray[ numberOfWeights ];
+  WeightsType                                 weights( weightsArray, numberOfWeights, false );
+
+  typename TransformType::IndexType supportIndex;
+  normalTransform->m_WeightsFunction->ComputeStartIndex( cindex, supportIndex );
+  normalTransform->m_WeightsFunction->Evaluate( cindex, supportIndex, weights );
+
+  typename TransformType::RegionType supportRegion;
+  supportRegion.SetSize( normalTransform->m_SupportSize );
+  supportRegion.SetIndex( supportIndex );
+
+  // Correlate the sum of both coefficients with the weights
+  typedef ImageScanlineConstIterator< typename TransformType::ImageType > IteratorType;
+  IteratorType normalIterator[ SpaceDimension ];
+  IteratorType labelIterator[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    normalIterator[ j ] = IteratorType( normalTransform->m_CoefficientImages[ j ], supportRegion );
+    labelIterator[ j ]  = IteratorType( labelTransform->m_CoefficientImages[ j ], supportRegion );
+  }
+
+  unsigned long counter = 0;
+  while( !normalIterator[ 0 ].IsAtEnd() )
+  {
+    while( !normalIterator[ 0 ].IsAtEndOfLine() )
+    {
+      for( unsigned int j = 0; j < SpaceDimension; ++j )
+      {
+        outputPoint[ j ] += static_cast< ScalarType >( weights[ counter ]
+          * ( normalIterator[ j ].Value() + labelIterator[ j ].Value() ) );
+        ++normalIterator[ j ];
+        ++labelIterator[ j ];
+      }
+      ++counter;
+    }
+
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      normalIterator[ j ].NextLine();
+      labelIterator[ j ].NextLine();
+    }
   }
 }
 
@@ -678,12 +799,9 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
 {
   int lidx = 0;
   this->PointToLabel( point, lidx );
-  if( lidx == 0 )
-  {
-    return point;
-  }
 
-  OutputPointType res = m_Trans[ 0 ]->TransformPoint( point ) + ( m_Trans[ lidx ]->TransformPoint( point ) - point );
+  OutputPointType res;
+  this->TransformPointWithLabel( point, lidx, res );
   return res;
 }
 
@@ -753,13 +871,12 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
     return;
   }
 
-  JacobianType njac, ljac;
+  // The Jacobian of a B-spline transform does not depend on its coefficients,
+  // and all transforms share the grid, so it is computed once
+  JacobianType njac;
   njac.SetSize( SpaceDimension, nnzji );
-  ljac.SetSize( SpaceDimension, nnzji );
-
-  // nzji should be the same so keep only one
   m_Trans[ 0 ]->GetJacobian( ipp, njac, nonZeroJacobianIndices );
-  m_Trans[ lidx ]->GetJacobian( ipp, ljac, nonZeroJacobianIndices );
+  const JacobianType & ljac = njac;
 
   // Convert the physical point to a continuous index, which
   // is needed for the 'Evaluate()' functions below.
@@ -963,11 +1080,13 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
   }
 
   SpatialJacobianType           nsj, lsj;
-  JacobianOfSpatialJacobianType njsj, ljsj;
+  JacobianOfSpatialJacobianType njsj;
 
-  // nzji should be the same so keep only one
+  // The Jacobian of the spatial Jacobian does not depend on the coefficients,
+  // so for the label transform only the spatial Jacobian is needed
   m_Trans[ 0 ]->GetJacobianOfSpatialJacobian( ipp, nsj, njsj, nonZeroJacobianIndices );
-  m_Trans[ lidx ]->GetJacobianOfSpatialJacobian( ipp, lsj, ljsj, nonZeroJacobianIndices );
+  m_Trans[ lidx ]->GetSpatialJacobian( ipp, lsj );
+  const JacobianOfSpatialJacobianType & ljsj = njsj;
 
   typedef typename ImageBaseType::PixelContainer BaseContainer;
   const BaseContainer & bases = *m_LocalBases->GetPixelContainer();
@@ -1072,11 +1191,13 @@ MultiBSplineDeformableTransformWithNormal< TScalarType, NDimensions, VSplineOrde
   }
 
   SpatialHessianType           nsh, lsh;
-  JacobianOfSpatialHessianType njsh, ljsh;
+  JacobianOfSpatialHessianType njsh;
 
-  // nzji should be the same so keep only one
+  // The Jacobian of the spatial Hessian does not depend on the coefficients,
+  // so for the label transform only the spatial Hessian is needed
   m_Trans[ 0 ]->GetJacobianOfSpatialHessian( ipp, nsh, njsh, nonZeroJacobianIndices );
-  m_Trans[ lidx ]->GetJacobianOfSpatialHessian( ipp, lsh, ljsh, nonZeroJacobianIndices );
+  m_Trans[ lidx ]->GetSpatialHessian( ipp, lsh );
+  const JacobianOfSpatialHessianType & ljsh = njsh;
 
   typedef typename ImageBaseType::PixelContainer BaseContainer;
   const BaseContainer & bases = *m_LocalBases->GetPixelContainer();
@@ -228,6 +228,7 @@ public:
 
   /** Typedef that is used in the elastix dll version. */
   typedef typename Superclass2::ParameterMapType ParameterMapType;
+  typedef typename Superclass2::NumericParameterMapType NumericParameterMapType;
 
   /** Execute stuff before anything else is done:
    * \li Initialize the right BSplineTransform.
@@ -279,7 +280,8 @@ public:
    * also as a deformation field.
    */
   void CreateTransformParametersMap(
-    const ParametersType & param, ParameterMapType * paramsMap ) const override;
+    const ParametersType & param, ParameterMapType * paramsMap,
+    NumericParameterMapType * numericParamsMap ) const override;
 
   /** Set the scales of the edge B-spline coefficients to zero. */
   virtual void SetOptimizerScales( const unsigned int edgeWidth );
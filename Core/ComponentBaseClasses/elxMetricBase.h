@@ -23,6 +23,7 @@
 
 #include "elxBaseComponentSE.h"
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkSingleValuedPointSetToPointSetMetric.h"
 #include "itkImageGridSampler.h"
 #include "itkPointSet.h"
 
@@ -123,6 +124,8 @@ public:
     MovingImageDimension, MovingImageDimension,
     CoordinateRepresentationType, CoordinateRepresentationType,
     CoordinateRepresentationType > >                MovingPointSetType;
+  typedef itk::SingleValuedPointSetToPointSetMetric<
+    FixedPointSetType, MovingPointSetType >         PointSetMetricType;
 
   /** Typedefs for sampler support. */
   typedef typename AdvancedMetricType::ImageSamplerType ImageSamplerBaseType;
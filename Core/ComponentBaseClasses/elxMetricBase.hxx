@@ -182,6 +182,32 @@ MetricBase< TElastix >
 
   } // end advanced metric
 
+  /** Cast this to PointSetMetricType. */
+  PointSetMetricType * thisAsPointSetMetric
+    = dynamic_cast< PointSetMetricType * >( this );
+
+  /** Point set metrics loop over the points with multiple threads. */
+  if( thisAsPointSetMetric != 0 )
+  {
+    bool useMultiThreading = true;
+    this->GetConfiguration()->ReadParameter( useMultiThreading,
+      "UseMultiThreadingForMetrics", this->GetComponentLabel(), level, 0 );
+
+    if( !useMultiThreading )
+    {
+      thisAsPointSetMetric->SetNumberOfWorkUnits( 1 );
+    }
+    else
+    {
+      std::string tmp = this->m_Configuration->GetCommandLineArgument( "-threads" );
+      if( tmp != "" )
+      {
+        const unsigned int nrOfThreads = atoi( tmp.c_str() );
+        thisAsPointSetMetric->SetNumberOfWorkUnits( nrOfThreads );
+      }
+    }
+  } // end point set metric
+
 } // end BeforeEachResolutionBase()
 
 
@@ -24,6 +24,7 @@
 #include "elxBaseComponentSE.h"
 #include "itkAdvancedTransform.h"
 #include "itkAdvancedCombinationTransform.h"
+#include "itkTransformParametersBinaryFile.h"
 #include "elxComponentDatabase.h"
 #include "elxProgressCommand.h"
 
@@ -202,7 +203,10 @@ public:
   typedef typename OptimizerType::ScalesType          ScalesType;
 
   /** Typedef that is used in the elastix dll version. */
-  typedef typename ElastixType::ParameterMapType ParameterMapType;
+  typedef typename ElastixType::ParameterMapType        ParameterMapType;
+  typedef typename ElastixType::NumericParameterMapType NumericParameterMapType;
+  typedef typename ConfigurationType::NumericParameterValuesPointer
+    NumericParameterValuesPointer;
 
   /** Cast to ITKBaseType. */
   virtual ITKBaseType * GetAsITKBaseType( void )
@@ -265,9 +269,13 @@ public:
   /** Function to read transform-parameters from a file. */
   virtual void ReadFromFile( void );
 
-  /** Function to create transform-parameters map. */
-  virtual void CreateTransformParametersMap(
-    const ParametersType & param, ParameterMapType * paramsMap ) const;
+  /** Function to create transform-parameters map. When numericParamsMap is
+   * given, the TransformParameters are stored in it as a numeric buffer,
+   * instead of being converted to text in paramsMap.
+   */
+  virtual void CreateTransformParametersMap( const ParametersType & param,
+    ParameterMapType * paramsMap,
+    NumericParameterMapType * numericParamsMap ) const;
 
   /** Function to write transform-parameters to a file. */
   virtual void WriteToFile( const ParametersType & param ) const;
@@ -347,6 +355,9 @@ protected:
   void AutomaticScalesEstimationStackTransform(
     const unsigned int & numSubTransforms, ScalesType & scales ) const;
 
+  /** Typedef for the binary transform parameter file. */
+  typedef itk::TransformParametersBinaryFile BinaryParametersFileType;
+
   /** Member variables. */
   ParametersType * m_TransformParametersPointer;
   std::string      m_TransformParametersFileName;
@@ -362,6 +373,17 @@ private:
   /** Boolean to decide whether or not the transform parameters are written. */
   bool m_ReadWriteTransformParameters;
 
+  /** The binary parameter file that m_TransformParametersPointer refers to,
+   * when the parameters were read in binary format. Keeps the memory
+   * mapping alive.
+   */
+  BinaryParametersFileType::Pointer m_TransformParametersFile;
+
+  /** The numeric buffer that m_TransformParametersPointer refers to, when
+   * the parameters were passed in memory. Keeps the buffer alive.
+   */
+  NumericParameterValuesPointer m_TransformParametersBuffer;
+
   std::string GetInitialTransformParametersFileName( void ) const
   {
     if( !this->GetInitialTransform() )
@@ -416,19 +416,46 @@ TransformBase< TElastix >
     {
       delete this->m_TransformParametersPointer;
     }
+    this->m_TransformParametersFile    = nullptr;
+    this->m_TransformParametersBuffer  = nullptr;
     this->m_TransformParametersPointer = new ParametersType( numberOfParameters );
 
-    /** Read the TransformParameters. */
+    /** Read the TransformParameters. When they are passed in memory as a
+     * numeric buffer, the parameters refer directly to that buffer, which
+     * is kept alive by m_TransformParametersBuffer. The buffer is never
+     * written to: the transform only reads its parameters.
+     */
     std::size_t numberOfParametersFound = 0;
     std::vector< ValueType > vecPar;
-    if( useBinaryFormatForTransformationParameters )
+    const NumericParameterValuesPointer numericPar
+      = this->m_Configuration->GetNumericParameterValues( "TransformParameters" );
+    if( numericPar )
+    {
+      numberOfParametersFound = numericPar->size();
+      if( numberOfParametersFound == numberOfParameters )
+      {
+        this->m_TransformParametersPointer->SetData(
+          const_cast< ValueType * >( numericPar->data() ), numberOfParameters, false );
+        this->m_TransformParametersBuffer = numericPar;
+      }
+    }
+    else if( useBinaryFormatForTransformationParameters )
     {
+      /** The header, size and checksum are verified while reading. The
+       * parameters then refer directly to the (memory-mapped) file data,
+       * which is kept alive by m_TransformParametersFile.
+       */
       std::string dataFileName = "";
       this->m_Configuration->ReadParameter( dataFileName, "TransformParameters", 0 );
-      std::ifstream infile( dataFileName.c_str(), std::ios::in | std::ios::binary );
-      infile.read( reinterpret_cast<char *>( this->m_TransformParametersPointer->data_block() ), sizeof( ValueType ) * numberOfParameters );
-      numberOfParametersFound = infile.gcount() / sizeof( ValueType ); // for sanity check
-      infile.close();
+      BinaryParametersFileType::Pointer parametersFile = BinaryParametersFileType::New();
+      parametersFile->Read( dataFileName, numberOfParameters );
+      numberOfParametersFound = parametersFile->GetNumberOfValues(); // for sanity check
+      if( numberOfParametersFound == numberOfParameters )
+      {
+        this->m_TransformParametersPointer->SetData(
+          parametersFile->GetValues(), numberOfParameters, false );
+        this->m_TransformParametersFile = parametersFile;
+      }
     }
     else
     {
@@ -458,7 +485,7 @@ TransformBase< TElastix >
     }
 
     /** Copy to m_TransformParametersPointer. */
-    if( !useBinaryFormatForTransformationParameters )
+    if( !numericPar && !useBinaryFormatForTransformationParameters )
     {
       // NOTE: we could avoid this by directly reading into the transform parameters,
       // e.g. by overloading ReadParameter(), or use swap (?).
@@ -704,9 +731,7 @@ TransformBase< TElastix >
       dataFileName += ".dat";
       xout[ "transpar" ] << "(TransformParameters \"" << dataFileName << "\")" << std::endl;
 
-      std::ofstream outfile( dataFileName.c_str(), ios::out | ios::binary );
-      outfile.write( reinterpret_cast<const char *>( param.data_block() ), sizeof( ValueType ) * nrP );
-      outfile.close();
+      BinaryParametersFileType::Write( dataFileName, param.data_block(), nrP );
     }
     else
     {
@@ -868,7 +893,8 @@ void
 TransformBase< TElastix >
 ::CreateTransformParametersMap(
   const ParametersType & param,
-  ParameterMapType * paramsMap ) const
+  ParameterMapType * paramsMap,
+  NumericParameterMapType * numericParamsMap ) const
 {
   std::ostringstream         tmpStream;
   std::string                parameterName;
@@ -891,7 +917,17 @@ TransformBase< TElastix >
   parameterValues.clear();
 
   /** Write the parameters of this transform. */
-  if( this->m_ReadWriteTransformParameters )
+  if( this->m_ReadWriteTransformParameters && numericParamsMap )
+  {
+    /** Store the parameters as a numeric buffer, which is shared by all
+     * copies of the map; text is only created when the map is written
+     * to file. The buffer is a copy, since param changes when the
+     * optimisation continues.
+     */
+    ( *numericParamsMap )[ "TransformParameters" ]
+      = std::make_shared< const std::vector< double > >( param.begin(), param.end() );
+  }
+  else if( this->m_ReadWriteTransformParameters )
   {
     /** In this case, write in a normal way to the parameter file. */
     parameterName = "TransformParameters";
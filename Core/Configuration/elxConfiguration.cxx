@@ -165,7 +165,9 @@ Configuration
 
   /** Connect the parameter file reader to the interface. */
   this->m_ParameterMapInterface->SetParameterMap(
-    this->m_ParameterFileParser->GetParameterMap() );
+    this->m_ParameterFileParser->GetTextParameterMap() );
+  this->m_ParameterMapInterface->SetNumericParameterMap(
+    this->m_ParameterFileParser->GetNumericParameterMap() );
 
   /** Silently check in the parameter file if error messages should be printed. */
   this->m_ParameterMapInterface->SetPrintErrorMessages( false );
@@ -201,6 +203,7 @@ Configuration
   this->m_CommandLineArgumentMap = _arg;
 
   this->m_ParameterMapInterface->SetParameterMap( inputMap );
+  this->m_ParameterMapInterface->SetNumericParameterMap( NumericParameterMapType() );
 
   /** Silently check in the parameter file if error messages should be printed. */
   this->m_ParameterMapInterface->SetPrintErrorMessages( false );
@@ -217,6 +220,23 @@ Configuration
 } // end Initialize()
 
 
+/**
+ * ********************** Initialize ****************************
+ */
+
+int
+Configuration
+::Initialize( const CommandLineArgumentMapType & _arg,
+  ParameterFileParserType::ParameterMapType & inputMap,
+  const NumericParameterMapType & numericInputMap )
+{
+  const int returndummy = this->Initialize( _arg, inputMap );
+  this->m_ParameterMapInterface->SetNumericParameterMap( numericInputMap );
+  return returndummy;
+
+} // end Initialize()
+
+
 /**
  * ********************** IsInitialized ***************************
  */
@@ -73,6 +73,10 @@ public:
   typedef ParameterFileParserType::Pointer   ParameterFileParserPointer;
   typedef itk::ParameterMapInterface         ParameterMapInterfaceType;
   typedef ParameterMapInterfaceType::Pointer ParameterMapInterfacePointer;
+  typedef ParameterMapInterfaceType::NumericParameterMapType
+    NumericParameterMapType;
+  typedef ParameterMapInterfaceType::NumericParameterValuesPointer
+    NumericParameterValuesPointer;
 
   /** Get and Set CommandLine arguments into the argument map. */
   const std::string GetCommandLineArgument( const std::string & key ) const;
@@ -95,6 +99,13 @@ public:
   virtual int Initialize( const CommandLineArgumentMapType & _arg,
     ParameterFileParserType::ParameterMapType & inputMap );
 
+  /** Library version that also takes parameters stored as typed numeric
+   * buffers. These take precedence over text entries with the same name.
+   */
+  virtual int Initialize( const CommandLineArgumentMapType & _arg,
+    ParameterFileParserType::ParameterMapType & inputMap,
+    const NumericParameterMapType & numericInputMap );
+
   /** True, if Initialize was successfully called. */
   virtual bool IsInitialized( void ) const; //to elxconfigurationbase
 
@@ -141,6 +152,17 @@ public:
   }
 
 
+  /** Get the numeric buffer of a parameter, or a null pointer when the
+   * parameter was not passed as a numeric buffer.
+   */
+  NumericParameterValuesPointer GetNumericParameterValues(
+    const std::string & parameterName ) const
+  {
+    return this->m_ParameterMapInterface->GetNumericParameterValues(
+      parameterName );
+  }
+
+
   /** Read a parameter from the parameter file. */
   template< class T >
   bool ReadParameter( T & parameterValue, const std::string & parameterName,
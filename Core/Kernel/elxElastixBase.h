@@ -173,6 +173,7 @@ public:
 
   /** Typedef that is used in the elastix dll version. */
   typedef itk::ParameterMapInterface::ParameterMapType ParameterMapType;
+  typedef itk::ParameterMapInterface::NumericParameterMapType NumericParameterMapType;
 
   /** The itk class that ElastixTemplate is expected to inherit from
    * Of course ElastixTemplate also inherits from this class (ElastixBase).
@@ -361,6 +362,11 @@ public:
   /** Gets transformation parameters map. */
   virtual ParameterMapType GetTransformParametersMap( void ) const = 0;
 
+  /** Gets the part of the transformation parameters map that is stored as
+   * numeric buffers instead of text.
+   */
+  virtual NumericParameterMapType GetTransformParametersNumericMap( void ) const = 0;
+
   /** Set configuration vector. Library only. */
   virtual void SetConfigurations( std::vector< ConfigurationPointer > & configurations ) = 0;
 
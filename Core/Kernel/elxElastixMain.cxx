@@ -153,6 +153,7 @@ ElastixMain::ElastixMain()
   this->m_FinalTransform   = 0;
   this->m_InitialTransform = 0;
   this->m_TransformParametersMap.clear();
+  this->m_TransformParametersNumericMap.clear();
 
 } // end Constructor
 
@@ -232,6 +233,21 @@ void
 ElastixMain
 ::EnterCommandLineArguments( ArgumentMapType & argmap,
   std::vector< ParameterMapType > & inputMaps )
+{
+  this->EnterCommandLineArguments( argmap, inputMaps,
+    std::vector< NumericParameterMapType >() );
+} // end EnterCommandLineArguments()
+
+
+/**
+ * *************** EnterCommandLineArguments *******************
+ */
+
+void
+ElastixMain
+::EnterCommandLineArguments( ArgumentMapType & argmap,
+  std::vector< ParameterMapType > & inputMaps,
+  const std::vector< NumericParameterMapType > & numericInputMaps )
 {
   this->m_Configurations.clear();
   this->m_Configurations.resize( inputMaps.size() );
@@ -242,7 +258,10 @@ ElastixMain
      * command line parameters entered by the user.
      */
     this->m_Configurations[ i ] = ConfigurationType::New();
-    int dummy = this->m_Configurations[ i ]->Initialize( argmap, inputMaps[ i ] );
+    const NumericParameterMapType numericInputMap = i < numericInputMaps.size()
+      ? numericInputMaps[ i ] : NumericParameterMapType();
+    int dummy = this->m_Configurations[ i ]->Initialize( argmap, inputMaps[ i ],
+      numericInputMap );
     if( dummy )
     {
       xout[ "error" ] << "ERROR: Something went wrong during initialization of configuration object " << i << "." << std::endl;
@@ -419,6 +438,7 @@ ElastixMain::Run( void )
 
   /** Get the transformation parameter map */
   this->m_TransformParametersMap = this->GetElastixBase()->GetTransformParametersMap();
+  this->m_TransformParametersNumericMap = this->GetElastixBase()->GetTransformParametersNumericMap();
 
   /** Store the images in ElastixMain. */
   this->SetFixedImageContainer( this->GetElastixBase()->GetFixedImageContainer() );
@@ -1019,10 +1039,35 @@ ElastixMain::GetOriginalFixedImageDirectionFlat( void ) const
 ElastixMain::ParameterMapType
 ElastixMain::GetTransformParametersMap( void ) const
 {
-  return this->m_TransformParametersMap;
+  ParameterMapType transformParametersMap = this->m_TransformParametersMap;
+  itk::ParameterMapInterface::ConvertNumericParametersToText(
+    this->m_TransformParametersNumericMap, transformParametersMap );
+  return transformParametersMap;
 } // end GetTransformParametersMap()
 
 
+/**
+ * ****************** GetTransformParametersTextMap ******************
+ */
+
+ElastixMain::ParameterMapType
+ElastixMain::GetTransformParametersTextMap( void ) const
+{
+  return this->m_TransformParametersMap;
+} // end GetTransformParametersTextMap()
+
+
+/**
+ * **************** GetTransformParametersNumericMap ****************
+ */
+
+ElastixMain::NumericParameterMapType
+ElastixMain::GetTransformParametersNumericMap( void ) const
+{
+  return this->m_TransformParametersNumericMap;
+} // end GetTransformParametersNumericMap()
+
+
 /**
  * ******************** GetImageInformationFromFile ********************
  */
@@ -147,6 +147,7 @@ public:
 
   /** Typedef that is used in the elastix dll version. */
   typedef itk::ParameterMapInterface::ParameterMapType ParameterMapType;
+  typedef itk::ParameterMapInterface::NumericParameterMapType NumericParameterMapType;
 
   /** Set/Get functions for the description of the image type. */
   itkSetMacro( FixedImagePixelType,   PixelTypeDescriptionType );
@@ -248,6 +249,13 @@ public:
   virtual void EnterCommandLineArguments( ArgumentMapType & argmap,
     std::vector< ParameterMapType > & inputMaps );
 
+  /** Library version that also passes parameters stored as typed numeric
+   * buffers, such as the TransformParameters, without text conversion.
+   */
+  virtual void EnterCommandLineArguments( ArgumentMapType & argmap,
+    std::vector< ParameterMapType > & inputMaps,
+    const std::vector< NumericParameterMapType > & numericInputMaps );
+
   /** Start the registration
    * run() without command line parameters; it assumes that
    * EnterCommandLineParameters has been invoked already, or that
@@ -294,6 +302,16 @@ public:
   /** GetTransformParametersMap */
   virtual ParameterMapType GetTransformParametersMap( void ) const;
 
+  /** GetTransformParametersTextMap: like GetTransformParametersMap(), but
+   * without the parameters that are kept as shared numeric buffers.
+   */
+  virtual ParameterMapType GetTransformParametersTextMap( void ) const;
+
+  /** GetTransformParametersNumericMap: the parameters of the transform
+   * parameter map that are kept as shared numeric buffers.
+   */
+  virtual NumericParameterMapType GetTransformParametersNumericMap( void ) const;
+
   static void UnloadComponents( void );
 
 protected:
@@ -336,7 +354,8 @@ protected:
   /** Transformation parameters map containing parameters that is the
    *  result of registration.
    */
-  ParameterMapType m_TransformParametersMap;
+  ParameterMapType        m_TransformParametersMap;
+  NumericParameterMapType m_TransformParametersNumericMap;
 
   FlatDirectionCosinesType m_OriginalFixedImageDirection;
 
@@ -211,6 +211,7 @@ public:
 
   /** Typedef that is used in the elastix dll version. */
   typedef itk::ParameterMapInterface::ParameterMapType ParameterMapType;
+  typedef itk::ParameterMapInterface::NumericParameterMapType NumericParameterMapType;
 
   /** Functions to set/get pointers to the elastix components.
    * Get the components as pointers to elxBaseType.
@@ -375,8 +376,12 @@ protected:
   /** GetTransformParametersMap. */
   ParameterMapType GetTransformParametersMap( void ) const override;
 
+  /** GetTransformParametersNumericMap. */
+  NumericParameterMapType GetTransformParametersNumericMap( void ) const override;
+
   /** Stores transformation parameters map. */
-  ParameterMapType m_TransformParametersMap;
+  ParameterMapType        m_TransformParametersMap;
+  NumericParameterMapType m_TransformParametersNumericMap;
 
   /** Open the IterationInfoFile, where the table with iteration info is written to. */
   virtual void OpenIterationInfoFile( void );
@@ -63,6 +63,7 @@ ElastixTemplate< TFixedImage, TMovingImage >
   /** Initialize CurrentTransformParameterFileName. */
   this->m_CurrentTransformParameterFileName = "";
   this->m_TransformParametersMap.clear();
+  this->m_TransformParametersNumericMap.clear();
 
 } // end Constructor
 
@@ -972,6 +973,19 @@ ElastixTemplate< TFixedImage, TMovingImage >
 } // end GetTransformParametersMap()
 
 
+/**
+ * ************** GetTransformParametersNumericMap *****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+itk::ParameterMapInterface::NumericParameterMapType
+ElastixTemplate< TFixedImage, TMovingImage >
+::GetTransformParametersNumericMap( void ) const
+{
+  return this->m_TransformParametersNumericMap;
+} // end GetTransformParametersNumericMap()
+
+
 /**
  * ************** CreateTransformParametersMap ******************
  */
@@ -981,9 +995,12 @@ void
 ElastixTemplate< TFixedImage, TMovingImage >
 ::CreateTransformParametersMap( void )
 {
+  /** The transform parameters are stored as a shared numeric buffer. */
+  this->m_TransformParametersNumericMap.clear();
   this->GetElxTransformBase()->CreateTransformParametersMap(
     this->GetElxOptimizerBase()->GetAsITKBaseType()->GetCurrentPosition(),
-    &this->m_TransformParametersMap );
+    &this->m_TransformParametersMap,
+    &this->m_TransformParametersNumericMap );
   this->GetElxResampleInterpolatorBase()->CreateTransformParametersMap(
     &this->m_TransformParametersMap );
   this->GetElxResamplerBase()->CreateTransformParametersMap(
@@ -205,6 +205,21 @@ TransformixMain::Run(
 } // end Run()
 
 
+/**
+ * **************************** Run *****************************
+ */
+
+int
+TransformixMain::Run(
+  ArgumentMapType & argmap,
+  std::vector< ParameterMapType > & inputMaps,
+  const std::vector< NumericParameterMapType > & numericInputMaps )
+{
+  this->EnterCommandLineArguments( argmap, inputMaps, numericInputMaps );
+  return this->Run();
+} // end Run()
+
+
 /**
  * ********************* SetInputImage **************************
  */
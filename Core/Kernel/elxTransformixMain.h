@@ -85,7 +85,8 @@ public:
   typedef Superclass::ComponentLoaderPointer ComponentLoaderPointer;
 
   /** Typedef that is used in the elastix dll version. */
-  typedef Superclass::ParameterMapType ParameterMapType;
+  typedef Superclass::ParameterMapType        ParameterMapType;
+  typedef Superclass::NumericParameterMapType NumericParameterMapType;
 
   /** Overwrite Run() from base-class. */
   int Run( void ) override;
@@ -98,6 +99,12 @@ public:
   /** Run version for using transformix as library. */
   virtual int Run( ArgumentMapType & argmap, std::vector< ParameterMapType > & inputMaps );
 
+  /** Run version that also takes the numeric parameter buffers, such as
+   * the TransformParameters passed on by the ElastixFilter.
+   */
+  virtual int Run( ArgumentMapType & argmap, std::vector< ParameterMapType > & inputMaps,
+    const std::vector< NumericParameterMapType > & numericInputMaps );
+
   /** Get and Set input- and outputImage. */
   virtual void SetInputImageContainer(
     DataObjectContainerType * inputImageContainer );
@@ -69,6 +69,7 @@ public:
   typedef ParameterObjectType::ParameterMapType         ParameterMapType;
   typedef ParameterObjectType::ParameterMapVectorType   ParameterMapVectorType;
   typedef ParameterObjectType::ParameterValueVectorType ParameterValueVectorType;
+  typedef ParameterObjectType::NumericParameterMapVectorType NumericParameterMapVectorType;
   typedef ParameterObjectType::Pointer                  ParameterObjectPointer;
   typedef ParameterObjectType::ConstPointer             ParameterObjectConstPointer;
 
@@ -81,6 +81,7 @@ ElastixFilter< TFixedImage, TMovingImage >
   DataObjectContainerPointer resultImageContainer = nullptr;
   ElastixMainObjectPointer   transform            = nullptr;
   ParameterMapVectorType     transformParameterMapVector;
+  NumericParameterMapVectorType transformNumericParameterMapVector;
   FlatDirectionCosinesType   fixedImageOriginalDirection;
 
   // Split inputs into separate containers
@@ -262,7 +263,8 @@ ElastixFilter< TFixedImage, TMovingImage >
     resultImageContainer        = elastix->GetResultImageContainer();
     fixedImageOriginalDirection = elastix->GetOriginalFixedImageDirectionFlat();
 
-    transformParameterMapVector.push_back( elastix->GetTransformParametersMap() );
+    transformParameterMapVector.push_back( elastix->GetTransformParametersTextMap() );
+    transformNumericParameterMapVector.push_back( elastix->GetTransformParametersNumericMap() );
     if( i > 0 )
     {
       transformParameterMapVector[ i ][ "InitialTransformParametersFileName" ]
@@ -287,6 +289,7 @@ ElastixFilter< TFixedImage, TMovingImage >
   // Save parameter map
   ParameterObject::Pointer transformParameterObject = ParameterObject::New();
   transformParameterObject->SetParameterMap( transformParameterMapVector );
+  transformParameterObject->SetNumericParameterMap( transformNumericParameterMapVector );
   this->SetOutput( "TransformParameterObject", transformParameterObject );
 }
 
@@ -21,6 +21,8 @@
 #include "elxParameterObject.h"
 
 #include "itkFileTools.h"
+#include "itkParameterMapInterface.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <cmath>
@@ -49,6 +51,10 @@ ParameterObject
 ::SetParameterMap( const unsigned int& index, const ParameterMapType & parameterMap )
 {
   this->m_ParameterMap[ index ] = parameterMap;
+  if( index < this->m_NumericParameterMap.size() )
+  {
+    this->m_NumericParameterMap[ index ].clear();
+  }
 }
 
 
@@ -63,6 +69,7 @@ ParameterObject
   if( this->m_ParameterMap != parameterMap )
   {
     this->m_ParameterMap = parameterMap;
+    this->m_NumericParameterMap.clear();
     this->Modified();
   }
 }
@@ -85,11 +92,34 @@ ParameterObject
  * ********************* GetParameterMap *********************
  */
 
-const ParameterObject::ParameterMapType &
+ParameterObject::ParameterMapType
 ParameterObject
 ::GetParameterMap( const unsigned int& index ) const
 {
-  return this->m_ParameterMap[ index ];
+  ParameterMapType parameterMap = this->m_ParameterMap[ index ];
+  if( index < this->m_NumericParameterMap.size() )
+  {
+    itk::ParameterMapInterface::ConvertNumericParametersToText(
+      this->m_NumericParameterMap[ index ], parameterMap );
+  }
+  return parameterMap;
+}
+
+
+/**
+ * ********************* GetParameterMap *********************
+ */
+
+ParameterObject::ParameterMapVectorType
+ParameterObject
+::GetParameterMap( void ) const
+{
+  ParameterMapVectorType parameterMapVector;
+  for( unsigned int i = 0; i < this->m_ParameterMap.size(); ++i )
+  {
+    parameterMapVector.push_back( this->GetParameterMap( i ) );
+  }
+  return parameterMapVector;
 }
 
 
@@ -101,7 +131,7 @@ void
 ParameterObject
 ::SetParameter( const unsigned int& index, const ParameterKeyType& key, const ParameterValueType& value )
 {
-  this->m_ParameterMap[ index ][ key ] = ParameterValueVectorType(1, value);
+  this->SetParameter( index, key, ParameterValueVectorType( 1, value ) );
 }
 
 
@@ -114,6 +144,10 @@ ParameterObject
 ::SetParameter( const unsigned int& index, const ParameterKeyType& key, const ParameterValueVectorType& value )
 {
   this->m_ParameterMap[ index ][ key ] = value;
+  if( index < this->m_NumericParameterMap.size() )
+  {
+    this->m_NumericParameterMap[ index ].erase( key );
+  }
 }
 
 
@@ -149,10 +183,17 @@ ParameterObject
  * ********************* GetParameter *********************
  */
 
-const ParameterObject::ParameterValueVectorType&
+ParameterObject::ParameterValueVectorType
 ParameterObject
 ::GetParameter( const unsigned int& index, const ParameterKeyType& key )
 {
+  const NumericParameterValueVectorPointer numericValue = this->GetNumericParameter( index, key );
+  if( numericValue )
+  {
+    ParameterValueVectorType value;
+    itk::ParameterMapInterface::ConvertNumericParameterToText( *numericValue, value );
+    return value;
+  }
   return this->m_ParameterMap[ index ][ key ];
 }
 
@@ -166,6 +207,10 @@ ParameterObject
 ::RemoveParameter( const unsigned int& index, const ParameterKeyType& key )
 {
   this->m_ParameterMap[ index ].erase( key );
+  if( index < this->m_NumericParameterMap.size() )
+  {
+    this->m_NumericParameterMap[ index ].erase( key );
+  }
 }
 
 
@@ -183,6 +228,79 @@ ParameterObject
 }
 
 
+/**
+ * ********************* SetNumericParameter *********************
+ */
+
+void
+ParameterObject
+::SetNumericParameter( const unsigned int& index, const ParameterKeyType& key, const NumericParameterValueVectorPointer& value )
+{
+  if( index >= this->m_ParameterMap.size() )
+  {
+    itkExceptionMacro( "Parameter map index " << index << " is out of range." );
+  }
+
+  if( this->m_NumericParameterMap.size() < this->m_ParameterMap.size() )
+  {
+    this->m_NumericParameterMap.resize( this->m_ParameterMap.size() );
+  }
+
+  /** The numeric buffer replaces any text entry with the same key. */
+  this->m_NumericParameterMap[ index ][ key ] = value;
+  this->m_ParameterMap[ index ].erase( key );
+  this->Modified();
+}
+
+
+/**
+ * ********************* GetNumericParameter *********************
+ */
+
+ParameterObject::NumericParameterValueVectorPointer
+ParameterObject
+::GetNumericParameter( const unsigned int& index, const ParameterKeyType& key ) const
+{
+  if( index < this->m_NumericParameterMap.size() )
+  {
+    NumericParameterMapType::const_iterator it = this->m_NumericParameterMap[ index ].find( key );
+    if( it != this->m_NumericParameterMap[ index ].end() )
+    {
+      return it->second;
+    }
+  }
+  return NumericParameterValueVectorPointer();
+}
+
+
+/**
+ * ********************* SetNumericParameterMap *********************
+ */
+
+void
+ParameterObject
+::SetNumericParameterMap( const NumericParameterMapVectorType & numericParameterMap )
+{
+  if( numericParameterMap.size() > this->m_ParameterMap.size() )
+  {
+    itkExceptionMacro(
+      << "The number of numeric parameter maps (" << numericParameterMap.size() << ")"
+      << " exceeds the number of parameter maps (" << this->m_ParameterMap.size() << ")." );
+  }
+
+  this->m_NumericParameterMap = numericParameterMap;
+  for( unsigned int i = 0; i < this->m_NumericParameterMap.size(); ++i )
+  {
+    NumericParameterMapType::const_iterator it = this->m_NumericParameterMap[ i ].begin();
+    for( ; it != this->m_NumericParameterMap[ i ].end(); ++it )
+    {
+      this->m_ParameterMap[ i ].erase( it->first );
+    }
+  }
+  this->Modified();
+}
+
+
 /**
  * ********************* ReadParameterFile *********************
  */
@@ -194,7 +312,8 @@ ParameterObject
   ParameterFileParserPointer parameterFileParser = ParameterFileParserType::New();
   parameterFileParser->SetParameterFileName( parameterFileName );
   parameterFileParser->ReadParameterFile();
-  this->SetParameterMap( ParameterMapVectorType( 1, parameterFileParser->GetParameterMap() ) );
+  this->SetParameterMap( ParameterMapVectorType( 1, parameterFileParser->GetTextParameterMap() ) );
+  this->SetNumericParameterMap( NumericParameterMapVectorType( 1, parameterFileParser->GetNumericParameterMap() ) );
 }
 
 
@@ -212,6 +331,7 @@ ParameterObject
   }
 
   this->m_ParameterMap.clear();
+  this->m_NumericParameterMap.clear();
 
   for( unsigned int i = 0; i < parameterFileNameVector.size(); ++i )
   {
@@ -236,7 +356,14 @@ ParameterObject
   ParameterFileParserPointer parameterFileParser = ParameterFileParserType::New();
   parameterFileParser->SetParameterFileName( parameterFileName );
   parameterFileParser->ReadParameterFile();
-  this->m_ParameterMap.push_back( parameterFileParser->GetParameterMap() );
+  this->m_ParameterMap.push_back( parameterFileParser->GetTextParameterMap() );
+
+  /** Large numeric entries are kept as numeric buffers. */
+  if( !parameterFileParser->GetNumericParameterMap().empty() )
+  {
+    this->m_NumericParameterMap.resize( this->m_ParameterMap.size() );
+    this->m_NumericParameterMap.back() = parameterFileParser->GetNumericParameterMap();
+  }
 }
 
 
@@ -255,7 +382,7 @@ ParameterObject
     parameterFileNameVector.push_back( "ParametersFile." + std::to_string( i ) + ".txt" );
   }
 
-  this->WriteParameterFile( this->m_ParameterMap, parameterFileNameVector );
+  this->WriteParameterFile( this->GetParameterMap(), parameterFileNameVector );
 }
 
 
@@ -345,7 +472,7 @@ ParameterObject
       << " does not match the number of provided filenames (1). Please provide a vector of filenames." );
   }
 
-  this->WriteParameterFile( this->m_ParameterMap[ 0 ], parameterFileName );
+  this->WriteParameterFile( this->GetParameterMap( 0 ), parameterFileName );
 }
 
 
@@ -391,7 +518,7 @@ void
 ParameterObject
 ::WriteParameterFile( const ParameterFileNameVectorType & parameterFileNameVector )
 {
-  this->WriteParameterFile( this->m_ParameterMap, parameterFileNameVector );
+  this->WriteParameterFile( this->GetParameterMap(), parameterFileNameVector );
 }
 
 
@@ -517,11 +644,12 @@ ParameterObject
 {
   Superclass::PrintSelf( os, indent );
 
-  for( unsigned int i = 0; i < this->m_ParameterMap.size(); ++i )
+  const ParameterMapVectorType parameterMapVector = this->GetParameterMap();
+  for( unsigned int i = 0; i < parameterMapVector.size(); ++i )
   {
     os << "ParameterMap " << i << ": " << std::endl;
-    ParameterMapConstIterator parameterMapIterator    = this->m_ParameterMap[ i ].begin();
-    ParameterMapConstIterator parameterMapIteratorEnd = this->m_ParameterMap[ i ].end();
+    ParameterMapConstIterator parameterMapIterator    = parameterMapVector[ i ].begin();
+    ParameterMapConstIterator parameterMapIteratorEnd = parameterMapVector[ i ].end();
     while( parameterMapIterator != parameterMapIteratorEnd )
     {
       os << "  (" << parameterMapIterator->first;
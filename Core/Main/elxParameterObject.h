@@ -55,6 +55,10 @@ public:
   typedef ParameterFileNameVectorType::const_iterator            ParameterFileNameVectorConstIterator;
   typedef itk::ParameterFileParser                               ParameterFileParserType;
   typedef ParameterFileParserType::Pointer                       ParameterFileParserPointer;
+  typedef ParameterFileParserType::NumericParameterValuesType    NumericParameterValueVectorType;
+  typedef ParameterFileParserType::NumericParameterValuesPointer NumericParameterValueVectorPointer;
+  typedef ParameterFileParserType::NumericParameterMapType       NumericParameterMapType;
+  typedef std::vector< NumericParameterMapType >                 NumericParameterMapVectorType;
 
   /* Set/Get/Add parameter map or vector of parameter maps. */
   // TODO: Use itkSetMacro for ParameterMapVectorType
@@ -62,15 +66,31 @@ public:
   void SetParameterMap( const unsigned int& index, const ParameterMapType & parameterMap );
   void SetParameterMap( const ParameterMapVectorType & parameterMap );
   void AddParameterMap( const ParameterMapType & parameterMap );
-  const ParameterMapType& GetParameterMap( const unsigned int& index ) const;
-  itkGetConstReferenceMacro( ParameterMap, ParameterMapVectorType );
+  ParameterMapType GetParameterMap( const unsigned int& index ) const;
+  ParameterMapVectorType GetParameterMap( void ) const;
   unsigned int GetNumberOfParameterMaps() const { return this->m_ParameterMap.size(); }
 
+  /* Set/Get numeric parameters. Large numeric arrays, such as the
+   * TransformParameters produced by elastix, are stored as shared typed
+   * buffers next to the text parameters. They are converted to text only
+   * in the copies returned by GetParameterMap() and GetParameter(), and when
+   * a parameter file is written; the object itself is never modified by a
+   * conversion, so it can be read from several threads. */
+  void SetNumericParameter( const unsigned int& index, const ParameterKeyType& key, const NumericParameterValueVectorPointer& value );
+  NumericParameterValueVectorPointer GetNumericParameter( const unsigned int& index, const ParameterKeyType& key ) const;
+  void SetNumericParameterMap( const NumericParameterMapVectorType & numericParameterMap );
+  itkGetConstReferenceMacro( NumericParameterMap, NumericParameterMapVectorType );
+
+  /* Get the text parameter maps without converting the numeric parameters.
+   * Use together with GetNumericParameterMap() to pass the parameters on
+   * without text conversion. */
+  const ParameterMapVectorType& GetTextParameterMap( void ) const { return this->m_ParameterMap; }
+
   void SetParameter( const unsigned int& index, const ParameterKeyType& key, const ParameterValueType& value );
   void SetParameter( const unsigned int& index, const ParameterKeyType& key, const ParameterValueVectorType& value );
   void SetParameter( const ParameterKeyType& key, const ParameterValueType& value );
   void SetParameter( const ParameterKeyType& key, const ParameterValueVectorType& value );
-  const ParameterValueVectorType& GetParameter( const unsigned int& index, const ParameterKeyType& key);
+  ParameterValueVectorType GetParameter( const unsigned int& index, const ParameterKeyType& key );
   void RemoveParameter( const unsigned int& index, const ParameterKeyType& key );
   void RemoveParameter( const ParameterKeyType& key );
 
@@ -95,7 +115,8 @@ protected:
 
 private:
 
-  ParameterMapVectorType m_ParameterMap;
+  ParameterMapVectorType        m_ParameterMap;
+  NumericParameterMapVectorType m_NumericParameterMap;
 
 };
 
@@ -64,6 +64,7 @@ public:
   typedef ParameterObjectType::ParameterMapVectorType   ParameterMapVectorType;
   typedef ParameterObjectType::ParameterMapType         ParameterMapType;
   typedef ParameterObjectType::ParameterValueVectorType ParameterValueVectorType;
+  typedef ParameterObjectType::NumericParameterMapVectorType NumericParameterMapVectorType;
   typedef typename ParameterObjectType::Pointer         ParameterObjectPointer;
   typedef typename ParameterObjectType::ConstPointer    ParameterObjectConstPointer;
 
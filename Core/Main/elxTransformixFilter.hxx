@@ -173,7 +173,10 @@ TransformixFilter< TMovingImage >
 
   // Get ParameterMap
   ParameterObjectPointer transformParameterObject = itkDynamicCastInDebugMode< ParameterObject * >( this->GetInput( "TransformParameterObject" ) );
-  ParameterMapVectorType transformParameterMapVector = transformParameterObject->GetParameterMap();
+  // Numeric parameters (e.g. the TransformParameters) are passed on as shared
+  // buffers, without converting them to text.
+  ParameterMapVectorType        transformParameterMapVector = transformParameterObject->GetTextParameterMap();
+  NumericParameterMapVectorType transformNumericParameterMapVector = transformParameterObject->GetNumericParameterMap();
 
   // Assert user did not set empty parameter map
   if( transformParameterMapVector.size() == 0 )
@@ -202,7 +205,7 @@ TransformixFilter< TMovingImage >
   unsigned int isError = 0;
   try
   {
-    isError = transformix->Run( argumentMap, transformParameterMapVector );
+    isError = transformix->Run( argumentMap, transformParameterMapVector, transformNumericParameterMapVector );
   }
   catch( itk::ExceptionObject & e )
   {
@@ -279,9 +282,10 @@ TransformixFilter< TMovingImage >
   itkAssertInDebugAndIgnoreInReleaseMacro( outputPtr != ITK_NULLPTR );
   itkAssertInDebugAndIgnoreInReleaseMacro( outputOutputDeformationFieldPtr != ITK_NULLPTR );
 
-  // Get world coordinate system from the last map
+  // Get world coordinate system from the last map. These entries are text,
+  // so the (numeric) transform parameters need not be converted.
   const unsigned int lastIndex = transformParameterObjectPtr->GetNumberOfParameterMaps() - 1;
-  const ParameterMapType transformParameterMap = transformParameterObjectPtr->GetParameterMap( lastIndex );
+  const ParameterMapType & transformParameterMap = transformParameterObjectPtr->GetTextParameterMap()[ lastIndex ];
 
   ParameterMapType::const_iterator spacingMapIter = transformParameterMap.find( "Spacing" );
   if( spacingMapIter == transformParameterMap.end() )
@@ -0,0 +1,337 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImage.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// This test checks the evaluation contexts of the AdvancedImageToImageMetric,
+// for the metrics that support them: AdvancedMeanSquares and
+// AdvancedNormalizedCorrelation, with and without SubtractMean. For an
+// affine transform, which has a dense Jacobian, and a B-spline transform,
+// which has a sparse one, it checks that
+// - GetValuesAndDerivatives() at several positions equals SetParameters()
+//   followed by GetValueAndDerivative() at each of them,
+// - GetValues() equals GetValue() at each of them,
+// - the transform of the metric keeps the parameters of the last call to
+//   GetValueAndDerivative(), as documented, and
+// - GetCentralDifferences() equals the differences of 2N calls to GetValue().
+//   With the B-spline transform, it only evaluates the samples in the
+//   support of each parameter, as used by FiniteDifferenceGradientDescent
+//   and SimultaneousPerturbation.
+// This is done with one and with several threads.
+
+namespace
+{
+
+const unsigned int Dimension = 2;
+typedef float                                        PixelType;
+typedef itk::Image< PixelType, Dimension >           ImageType;
+typedef itk::AdvancedCombinationTransform< double, Dimension >
+                                                     CombinationTransformType;
+typedef itk::AdvancedMatrixOffsetTransformBase< double, Dimension, Dimension >
+                                                     AffineTransformType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >
+                                                     BSplineTransformType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, double, double >                        InterpolatorType;
+typedef itk::ImageFullSampler< ImageType >           SamplerType;
+typedef CombinationTransformType::ParametersType     ParametersType;
+
+const unsigned int NumberOfPositions = 3;
+
+/** Create an image with two Gaussian blobs, shifted by ( dx, dy ). */
+ImageType::Pointer
+CreateImage( const double dx, const double dy )
+{
+  ImageType::SizeType size;
+  size[ 0 ] = 40; size[ 1 ] = 36;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    const double x = it.GetIndex()[ 0 ] - dx;
+    const double y = it.GetIndex()[ 1 ] - dy;
+    const double r1 = ( x - 15.0 ) * ( x - 15.0 ) + ( y - 16.0 ) * ( y - 16.0 );
+    const double r2 = ( x - 26.0 ) * ( x - 26.0 ) + ( y - 20.0 ) * ( y - 20.0 );
+    it.Set( static_cast< PixelType >( 100.0 * std::exp( -r1 / 40.0 ) + 50.0 * std::exp( -r2 / 20.0 ) ) );
+  }
+  return image;
+}
+
+
+/** An affine transform, at positions around the identity. */
+CombinationTransformType::Pointer
+CreateAffineTransform( std::vector< ParametersType > & positions )
+{
+  AffineTransformType::Pointer        affine = AffineTransformType::New();
+  AffineTransformType::InputPointType center;
+  center[ 0 ] = 20.0; center[ 1 ] = 18.0;
+  affine->SetCenter( center );
+
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( affine );
+
+  positions.assign( NumberOfPositions, affine->GetParameters() );
+  for( unsigned int k = 0; k < NumberOfPositions; ++k )
+  {
+    positions[ k ][ 0 ] += 0.02 * k;
+    positions[ k ][ 1 ] -= 0.01 * k;
+    positions[ k ][ 2 ] += 0.015;
+    positions[ k ][ 3 ] -= 0.01 * k;
+    positions[ k ][ 4 ] += 0.5 + 0.3 * k;
+    positions[ k ][ 5 ] -= 0.7 * k;
+  }
+  return transform;
+}
+
+
+/** A B-spline transform on a coarse grid, at random positions. */
+CombinationTransformType::Pointer
+CreateBSplineTransform( std::vector< ParametersType > & positions )
+{
+  BSplineTransformType::Pointer bspline = BSplineTransformType::New();
+
+  BSplineTransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( 9 );
+  BSplineTransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  BSplineTransformType::SpacingType gridSpacing;
+  gridSpacing.Fill( 6.0 );
+  BSplineTransformType::OriginType gridOrigin;
+  gridOrigin.Fill( -6.0 );
+  bspline->SetGridRegion( gridRegion );
+  bspline->SetGridSpacing( gridSpacing );
+  bspline->SetGridOrigin( gridOrigin );
+
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bspline );
+
+  positions.assign( NumberOfPositions, ParametersType( bspline->GetNumberOfParameters() ) );
+  for( unsigned int k = 0; k < NumberOfPositions; ++k )
+  {
+    for( unsigned int i = 0; i < positions[ k ].GetSize(); ++i )
+    {
+      positions[ k ][ i ] = 0.8 * std::sin( 0.7 * i + 1.9 * k );
+    }
+  }
+  return transform;
+}
+
+
+bool
+AreEqual( const double a, const double b, const double scale )
+{
+  return std::abs( a - b ) <= 1e-9 * std::max( 1.0, scale );
+}
+
+
+template< class TMetric >
+bool
+TestMetric( const char * name, typename TMetric::Pointer metric,
+  const bool isAffine, const unsigned int numberOfWorkUnits )
+{
+  ImageType::Pointer fixedImage  = CreateImage( 0.0, 0.0 );
+  ImageType::Pointer movingImage = CreateImage( 1.3, -0.8 );
+
+  std::vector< ParametersType >     positions;
+  CombinationTransformType::Pointer transform = isAffine
+    ? CreateAffineTransform( positions ) : CreateBSplineTransform( positions );
+
+  /** Sample the centre of the fixed image. */
+  ImageType::RegionType sampleRegion = fixedImage->GetLargestPossibleRegion();
+  sampleRegion.SetIndex( 0, 6 ); sampleRegion.SetIndex( 1, 5 );
+  sampleRegion.SetSize( 0, 28 ); sampleRegion.SetSize( 1, 26 );
+  SamplerType::Pointer sampler = SamplerType::New();
+  sampler->SetInput( fixedImage );
+  sampler->SetInputImageRegion( sampleRegion );
+
+  metric->SetFixedImage( fixedImage );
+  metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+  metric->SetMovingImage( movingImage );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( InterpolatorType::New() );
+  metric->SetImageSampler( sampler );
+  metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+  metric->SetUseMultiThread( numberOfWorkUnits > 1 );
+  metric->Initialize();
+
+  const std::string settings = std::string( name ) + ( isAffine ? ", affine" : ", B-spline" )
+    + ( numberOfWorkUnits > 1 ? ", multi-threaded" : ", single-threaded" );
+  bool success = true;
+  if( !metric->GetSupportsConcurrentEvaluation() )
+  {
+    std::cerr << "ERROR: " << settings << ": no support for concurrent evaluation." << std::endl;
+    return false;
+  }
+
+  /** The reference: one position after another. */
+  typename TMetric::MeasureListType    referenceValues( NumberOfPositions );
+  typename TMetric::DerivativeListType referenceDerivatives( NumberOfPositions );
+  for( unsigned int k = 0; k < NumberOfPositions; ++k )
+  {
+    metric->GetValueAndDerivative( positions[ k ], referenceValues[ k ], referenceDerivatives[ k ] );
+  }
+
+  /** The evaluation contexts, after putting the transform back at the first position. */
+  metric->GetValueAndDerivative( positions[ 0 ], referenceValues[ 0 ], referenceDerivatives[ 0 ] );
+  typename TMetric::MeasureListType    values;
+  typename TMetric::DerivativeListType derivatives;
+  metric->GetValuesAndDerivatives( positions, values, derivatives );
+  typename TMetric::MeasureListType valuesOnly;
+  metric->GetValues( positions, valuesOnly );
+
+  for( unsigned int k = 0; k < NumberOfPositions; ++k )
+  {
+    const double scale = referenceDerivatives[ k ].inf_norm();
+    std::cerr << settings << ": position " << k << ": value " << referenceValues[ k ]
+              << ", largest derivative " << scale << std::endl;
+    if( !AreEqual( values[ k ], referenceValues[ k ], std::abs( referenceValues[ k ] ) )
+      || !AreEqual( valuesOnly[ k ], referenceValues[ k ], std::abs( referenceValues[ k ] ) ) )
+    {
+      std::cerr << "ERROR: " << settings << ": the value at position " << k << " is "
+                << values[ k ] << " (GetValuesAndDerivatives) and " << valuesOnly[ k ]
+                << " (GetValues), expected " << referenceValues[ k ] << std::endl;
+      success = false;
+    }
+    if( derivatives[ k ].GetSize() != referenceDerivatives[ k ].GetSize() )
+    {
+      std::cerr << "ERROR: " << settings << ": the derivative at position " << k
+                << " has the wrong size." << std::endl;
+      success = false;
+      continue;
+    }
+    for( unsigned int i = 0; i < derivatives[ k ].GetSize(); ++i )
+    {
+      if( !AreEqual( derivatives[ k ][ i ], referenceDerivatives[ k ][ i ], scale ) )
+      {
+        std::cerr << "ERROR: " << settings << ": derivative " << i << " at position " << k
+                  << " is " << derivatives[ k ][ i ] << ", expected "
+                  << referenceDerivatives[ k ][ i ] << std::endl;
+        success = false;
+      }
+    }
+  }
+
+  /** The transform of the metric is left at the last serial evaluation. */
+  const ParametersType & parameters = transform->GetParameters();
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    if( parameters[ i ] != positions[ 0 ][ i ] )
+    {
+      std::cerr << "ERROR: " << settings << ": the transform of the metric was changed." << std::endl;
+      success = false;
+      break;
+    }
+  }
+
+  /** The central differences, which are computed on the local support of
+   * each parameter for the B-spline, against 2N calls to GetValue().
+   */
+  const ParametersType & position = positions[ 1 ];
+  ParametersType         perturbations( position.GetSize() );
+  for( unsigned int j = 0; j < perturbations.GetSize(); ++j )
+  {
+    perturbations[ j ] = isAffine && j < 4 ? 0.001 * ( 1 + j % 3 ) : 0.05 * ( 1 + j % 3 );
+  }
+  typename TMetric::DerivativeType differences;
+  metric->GetCentralDifferences( position, perturbations, differences );
+  for( unsigned int j = 0; j < perturbations.GetSize(); ++j )
+  {
+    ParametersType testPoint = position;
+    testPoint[ j ] = position[ j ] + perturbations[ j ];
+    const double valuep1 = metric->GetValue( testPoint );
+    testPoint[ j ] = position[ j ] - perturbations[ j ];
+    const double valuep0  = metric->GetValue( testPoint );
+    const double expected = valuep1 - valuep0;
+    if( !AreEqual( differences[ j ], expected, std::abs( referenceValues[ 1 ] ) ) )
+    {
+      std::cerr << "ERROR: " << settings << ": central difference " << j << " is "
+                << differences[ j ] << ", GetValue() gives " << expected << std::endl;
+      success = false;
+    }
+  }
+
+  return success;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  typedef itk::AdvancedMeanSquaresImageToImageMetric< ImageType, ImageType >           MeanSquaresType;
+  typedef itk::AdvancedNormalizedCorrelationImageToImageMetric< ImageType, ImageType > NormalizedCorrelationType;
+
+  bool success = true;
+  try
+  {
+    const unsigned int workUnits[ 2 ] = { 1, 4 };
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      for( unsigned int a = 0; a < 2; ++a )
+      {
+        const bool isAffine = a == 0;
+        success &= TestMetric< MeanSquaresType >( "AdvancedMeanSquares",
+          MeanSquaresType::New(), isAffine, workUnits[ t ] );
+
+        for( unsigned int m = 0; m < 2; ++m )
+        {
+          NormalizedCorrelationType::Pointer metric = NormalizedCorrelationType::New();
+          metric->SetSubtractMean( m == 1 );
+          success &= TestMetric< NormalizedCorrelationType >(
+            m == 1 ? "AdvancedNormalizedCorrelation, SubtractMean" : "AdvancedNormalizedCorrelation",
+            metric, isAffine, workUnits[ t ] );
+        }
+      }
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
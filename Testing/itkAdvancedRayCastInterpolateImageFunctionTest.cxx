@@ -0,0 +1,176 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkIdentityTransform.h"
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test checks that the Siddon ray traversal of the
+// AdvancedRayCastInterpolateImageFunction gives the same line integrals as
+// the default ray casting, which interpolates bilinearly. For a constant
+// volume both should be equal; for a smooth volume they may only differ by
+// the interpolation error. Both are also checked with the precomputed ray
+// cast geometry.
+
+namespace
+{
+
+const unsigned int Dimension = 3;
+typedef float                                           PixelType;
+typedef itk::Image< PixelType, Dimension >              ImageType;
+typedef itk::AdvancedRayCastInterpolateImageFunction<
+  ImageType, double >                                   InterpolatorType;
+typedef InterpolatorType::InputPointType                InputPointType;
+typedef InterpolatorType::PointType                     PointType;
+typedef itk::IdentityTransform< double, Dimension >     TransformType;
+
+/** Create a volume centred at the origin, as is assumed by the ray caster.
+ * Without smoothFunction the volume is constant, otherwise it is a wide
+ * Gaussian blob.
+ */
+ImageType::Pointer
+CreateVolume( const bool smoothFunction )
+{
+  ImageType::SizeType    size;
+  ImageType::SpacingType spacing;
+  ImageType::PointType   origin;
+  size[ 0 ] = 40; size[ 1 ] = 30; size[ 2 ] = 20;
+  spacing[ 0 ] = 1.0; spacing[ 1 ] = 1.5; spacing[ 2 ] = 2.0;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    origin[ d ] = -0.5 * ( size[ d ] - 1 ) * spacing[ d ];
+  }
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    double value = 10.0;
+    if( smoothFunction )
+    {
+      const ImageType::IndexType index = it.GetIndex();
+      const double               x     = index[ 0 ] - 20.0;
+      const double               y     = index[ 1 ] - 15.0;
+      const double               z     = index[ 2 ] - 10.0;
+      value = 100.0 * std::exp( -( x * x / 400.0 + y * y / 300.0 + z * z / 200.0 ) );
+    }
+    it.Set( static_cast< PixelType >( value ) );
+  }
+  return image;
+}
+
+
+/** Cast a few rays, nearly parallel to each of the axes, with and without
+ * Siddon, and compare the integrals.
+ */
+bool
+CompareRays( const char * name, const ImageType * image, const double tolerance,
+  const bool precomputeGeometry )
+{
+  const unsigned int numberOfRays = 5;
+  const double       focalPoints[ 5 ][ 3 ] = {
+    { 0.0, 0.0, -990.0 }, { 0.0, 0.0, -990.0 }, { 0.0, 0.0, -990.0 },
+    { -990.0, 0.0, 0.0 }, { 0.0, -990.0, 0.0 } };
+  const double rayPoints[ 5 ][ 3 ] = {
+    { 5.0, 3.0, 10.0 }, { -8.0, 6.0, 10.0 }, { 2.0, -4.0, 10.0 },
+    { 10.0, 4.0, -3.0 }, { -3.0, 8.0, 6.0 } };
+
+  bool success = true;
+  for( unsigned int i = 0; i < numberOfRays; ++i )
+  {
+    InputPointType focalPoint;
+    PointType      point;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      focalPoint[ d ] = focalPoints[ i ][ d ];
+      point[ d ]      = rayPoints[ i ][ d ];
+    }
+
+    double integrals[ 2 ];
+    for( unsigned int siddon = 0; siddon < 2; ++siddon )
+    {
+      InterpolatorType::Pointer interpolator = InterpolatorType::New();
+      interpolator->SetInputImage( image );
+      interpolator->SetTransform( TransformType::New() );
+      interpolator->SetFocalPoint( focalPoint );
+      interpolator->SetThreshold( 0.0 );
+      interpolator->SetUseSiddonRayTraversal( siddon == 1 );
+      if( precomputeGeometry )
+      {
+        interpolator->PrecomputeRayCastGeometry();
+      }
+      integrals[ siddon ] = interpolator->Evaluate( point );
+    }
+
+    const double relativeDifference
+      = std::abs( integrals[ 1 ] - integrals[ 0 ] ) / std::abs( integrals[ 0 ] );
+    std::cerr << name << ", ray " << i << ": ray casting = " << integrals[ 0 ]
+              << ", Siddon = " << integrals[ 1 ] << std::endl;
+    if( !( integrals[ 0 ] > 0.0 ) || relativeDifference > tolerance )
+    {
+      std::cerr << "ERROR: " << name << ", ray " << i
+                << ": relative difference " << relativeDifference
+                << " exceeds " << tolerance << std::endl;
+      success = false;
+    }
+  }
+  return success;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    ImageType::Pointer constantVolume = CreateVolume( false );
+    ImageType::Pointer smoothVolume   = CreateVolume( true );
+    for( unsigned int precompute = 0; precompute < 2; ++precompute )
+    {
+      success &= CompareRays( "constant volume", constantVolume, 1e-5, precompute == 1 );
+      success &= CompareRays( "smooth volume", smoothVolume, 0.05, precompute == 1 );
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,212 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAffineLogTransform.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test compares the Jacobian of the AffineLogTransform, which is a small
+// product of the cached derivatives of the matrix exponential and p - c, with
+// the per-point path that multiplies the full Jacobian of the spatial Jacobian
+// with p - c. It also times SetParameters() with an unchanged and a changed
+// matrix part, and checks the Jacobian against finite differences.
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension = 3;
+  typedef double ScalarType;
+
+  /** The number of points. Distinguish between Debug and Release mode. */
+#ifndef NDEBUG
+  unsigned int N = static_cast< unsigned int >( 1e4 );
+#else
+  unsigned int N = static_cast< unsigned int >( 1e6 );
+#endif
+  if( argc > 1 )
+  {
+    N = static_cast< unsigned int >( atoi( argv[ 1 ] ) );
+  }
+  std::cerr << "N = " << N << std::endl;
+
+  /** Typedefs. */
+  typedef itk::AffineLogTransform< ScalarType, Dimension > TransformType;
+  typedef TransformType::ParametersType                    ParametersType;
+  typedef TransformType::InputPointType                    InputPointType;
+  typedef TransformType::OutputPointType                   OutputPointType;
+  typedef TransformType::InputVectorType                   InputVectorType;
+  typedef TransformType::JacobianType                      JacobianType;
+  typedef TransformType::JacobianOfSpatialJacobianType     JacobianOfSpatialJacobianType;
+  typedef TransformType::NonZeroJacobianIndicesType        NonZeroJacobianIndicesType;
+
+  /** Create the transform. */
+  TransformType::Pointer transform = TransformType::New();
+  InputPointType         center;
+  center[ 0 ] = 10.0; center[ 1 ] = -5.0; center[ 2 ] = 20.0;
+  transform->SetCenter( center );
+
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     parameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = 0.05 * std::sin( 1.0 + i );
+  }
+  transform->SetParameters( parameters );
+
+  /** Generate the points. */
+  std::vector< InputPointType > points( 1000 );
+  for( unsigned int n = 0; n < points.size(); ++n )
+  {
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      points[ n ][ i ] = 100.0 * std::sin( 0.1 * n + i );
+    }
+  }
+
+  JacobianType                  jacobian, jacobianPerPoint;
+  JacobianOfSpatialJacobianType jsj;
+  NonZeroJacobianIndicesType    nzji;
+  double                        sum = 0.0;
+
+  /** Time the per-point path. */
+  itk::TimeProbe perPointTimer;
+  perPointTimer.Start();
+  for( unsigned int n = 0; n < N; ++n )
+  {
+    const InputPointType & p = points[ n % points.size() ];
+    transform->GetJacobianOfSpatialJacobian( p, jsj, nzji );
+    jacobianPerPoint.SetSize( Dimension, numberOfParameters );
+    jacobianPerPoint.Fill( 0.0 );
+    const InputVectorType pp = p - transform->GetCenter();
+    for( unsigned int dim = 0; dim < Dimension * Dimension; ++dim )
+    {
+      const InputVectorType column = jsj[ dim ] * pp;
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        jacobianPerPoint( i, dim ) = column[ i ];
+      }
+    }
+    for( unsigned int dim = 0; dim < Dimension; ++dim )
+    {
+      jacobianPerPoint( dim, Dimension * Dimension + dim ) = 1.0;
+    }
+    sum += jacobianPerPoint( 0, 0 );
+  }
+  perPointTimer.Stop();
+
+  /** Time the cached path. */
+  itk::TimeProbe cachedTimer;
+  cachedTimer.Start();
+  for( unsigned int n = 0; n < N; ++n )
+  {
+    transform->GetJacobian( points[ n % points.size() ], jacobian, nzji );
+    sum += jacobian( 0, 0 );
+  }
+  cachedTimer.Stop();
+
+  /** Time SetParameters(), with only the translation changing, and with
+   * the matrix part changing.
+   */
+  const unsigned int numberOfUpdates = N / 100 + 1;
+  ParametersType     newParameters  = parameters;
+  itk::TimeProbe     unchangedTimer, changedTimer;
+  unchangedTimer.Start();
+  for( unsigned int n = 0; n < numberOfUpdates; ++n )
+  {
+    newParameters[ numberOfParameters - 1 ] = parameters[ numberOfParameters - 1 ] + 1e-3 * n;
+    transform->SetParameters( newParameters );
+  }
+  unchangedTimer.Stop();
+  changedTimer.Start();
+  for( unsigned int n = 0; n < numberOfUpdates; ++n )
+  {
+    newParameters[ 0 ] = parameters[ 0 ] + 1e-6 * n;
+    transform->SetParameters( newParameters );
+  }
+  changedTimer.Stop();
+
+  /** Report timings. */
+  std::cerr << std::setprecision( 4 );
+  std::cerr << "GetJacobian, per-point path: " << perPointTimer.GetMean() << " s" << std::endl;
+  std::cerr << "GetJacobian, cached path:    " << cachedTimer.GetMean() << " s" << std::endl;
+  std::cerr << "Speedup: " << perPointTimer.GetMean() / cachedTimer.GetMean() << std::endl;
+  std::cerr << "SetParameters, unchanged matrix: "
+            << unchangedTimer.GetMean() / numberOfUpdates * 1e6 << " us per call" << std::endl;
+  std::cerr << "SetParameters, changed matrix:   "
+            << changedTimer.GetMean() / numberOfUpdates * 1e6 << " us per call" << std::endl;
+  std::cerr << "(dummy " << sum << ")" << std::endl;
+
+  /** Check that both paths give the same Jacobian, and compare it with
+   * finite differences of TransformPoint().
+   */
+  transform->SetParameters( parameters );
+  const double delta = 1e-6;
+  for( unsigned int n = 0; n < points.size(); n += 97 )
+  {
+    const InputPointType & p = points[ n ];
+    transform->GetJacobian( p, jacobian, nzji );
+    transform->GetJacobianOfSpatialJacobian( p, jsj, nzji );
+    const InputVectorType pp = p - transform->GetCenter();
+    for( unsigned int dim = 0; dim < Dimension * Dimension; ++dim )
+    {
+      const InputVectorType column = jsj[ dim ] * pp;
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        if( std::abs( column[ i ] - jacobian( i, dim ) ) > 1e-10 * ( 1.0 + std::abs( column[ i ] ) ) )
+        {
+          std::cerr << "ERROR: the cached Jacobian differs from the per-point Jacobian at point "
+                    << n << ", parameter " << dim << "." << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+
+    for( unsigned int par = 0; par < numberOfParameters; ++par )
+    {
+      ParametersType plus = parameters, minus = parameters;
+      plus[ par ]  += delta;
+      minus[ par ] -= delta;
+      transform->SetParameters( plus );
+      const OutputPointType pPlus = transform->TransformPoint( p );
+      transform->SetParameters( minus );
+      const OutputPointType pMinus = transform->TransformPoint( p );
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        const double fd = ( pPlus[ i ] - pMinus[ i ] ) / ( 2.0 * delta );
+        if( std::abs( fd - jacobian( i, par ) ) > 1e-4 * ( 1.0 + std::abs( fd ) ) )
+        {
+          std::cerr << "ERROR: the Jacobian differs from finite differences at point "
+                    << n << ", parameter " << par << ": " << jacobian( i, par )
+                    << " vs " << fd << "." << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+    transform->SetParameters( parameters );
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,240 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCMAEvolutionStrategyOptimizer.h"
+
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkSingleValuedCostFunction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test checks that the multi-threaded search directions and covariance
+// matrix update of the CMAEvolutionStrategyOptimizer equal the
+// single-threaded ones. Both optimizers start from the same seed of the
+// random number generator and run a few iterations on an ill-conditioned
+// quadratic cost function. The search directions of the last generation,
+// the covariance matrix, the step size and the position are compared. The
+// multi-threaded covariance matrix update sums in a different order, so
+// the comparison allows for rounding errors.
+
+namespace
+{
+
+const unsigned int NumberOfParameters = 7;
+
+/** f(x) = sum_i (i+1) (x_i - 1 + 0.3 x_{i-1})^2 */
+class TestCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+
+  typedef TestCostFunction              Self;
+  typedef itk::SingleValuedCostFunction Superclass;
+  typedef itk::SmartPointer< Self >     Pointer;
+  itkNewMacro( Self );
+
+  MeasureType GetValue( const ParametersType & parameters ) const override
+  {
+    double value = 0.0;
+    for( unsigned int i = 0; i < NumberOfParameters; ++i )
+    {
+      const double r = parameters[ i ] - 1.0 + ( i > 0 ? 0.3 * parameters[ i - 1 ] : 0.0 );
+      value += ( i + 1.0 ) * r * r;
+    }
+    return value;
+  }
+
+
+  void GetDerivative( const ParametersType &, DerivativeType & ) const override
+  {
+    itkExceptionMacro( << "Not implemented" );
+  }
+
+
+  unsigned int GetNumberOfParameters( void ) const override
+  {
+    return NumberOfParameters;
+  }
+
+
+protected:
+
+  TestCostFunction() {}
+  ~TestCostFunction() override {}
+};
+
+/** Give access to the search directions and the covariance matrix. */
+class TestOptimizer : public itk::CMAEvolutionStrategyOptimizer
+{
+public:
+
+  typedef TestOptimizer                      Self;
+  typedef itk::CMAEvolutionStrategyOptimizer Superclass;
+  typedef itk::SmartPointer< Self >          Pointer;
+  itkNewMacro( Self );
+
+  typedef Superclass::ParameterContainerType ParameterContainerType;
+  typedef Superclass::CovarianceMatrixType   CovarianceMatrixType;
+
+  const ParameterContainerType & GetSearchDirs( void ) const
+  {
+    return this->m_SearchDirs;
+  }
+
+
+  const CovarianceMatrixType & GetC( void ) const
+  {
+    return this->m_C;
+  }
+
+
+protected:
+
+  TestOptimizer() {}
+  ~TestOptimizer() override {}
+};
+
+TestOptimizer::Pointer
+Optimize( const bool useMultiThread )
+{
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::GetInstance()->SetSeed( 5678 );
+
+  TestOptimizer::ParametersType initialPosition( NumberOfParameters );
+  initialPosition.Fill( 0.0 );
+
+  TestCostFunction::Pointer costFunction = TestCostFunction::New();
+  TestOptimizer::Pointer    optimizer    = TestOptimizer::New();
+  optimizer->SetCostFunction( costFunction );
+  optimizer->SetInitialPosition( initialPosition );
+  optimizer->SetMaximumNumberOfIterations( 8 );
+  optimizer->SetInitialSigma( 0.5 );
+  optimizer->SetPositionToleranceMin( 0.0 );
+  optimizer->SetPositionToleranceMax( 0.0 );
+  optimizer->SetValueTolerance( 0.0 );
+  optimizer->SetUseMultiThread( useMultiThread );
+  optimizer->SetNumberOfWorkUnits( 3 );
+  optimizer->StartOptimization();
+  return optimizer;
+}
+
+
+bool
+AreClose( const double a, const double b, const double scale )
+{
+  return std::abs( a - b ) <= 1e-10 * scale;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    TestOptimizer::Pointer serial   = Optimize( false );
+    TestOptimizer::Pointer threaded = Optimize( true );
+
+    std::cerr << "Single-threaded: " << serial->GetCurrentIteration() << " iterations, value "
+              << serial->GetCurrentValue() << ", sigma " << serial->GetCurrentSigma() << std::endl;
+    std::cerr << "Multi-threaded:  " << threaded->GetCurrentIteration() << " iterations, value "
+              << threaded->GetCurrentValue() << ", sigma " << threaded->GetCurrentSigma() << std::endl;
+
+    if( serial->GetCurrentIteration() != threaded->GetCurrentIteration()
+      || !AreClose( serial->GetCurrentSigma(), threaded->GetCurrentSigma(), serial->GetCurrentSigma() ) )
+    {
+      std::cerr << "ERROR: the number of iterations or the step size differs." << std::endl;
+      success = false;
+    }
+
+    /** The search directions of the last generation. */
+    const TestOptimizer::ParameterContainerType & serialDirs   = serial->GetSearchDirs();
+    const TestOptimizer::ParameterContainerType & threadedDirs = threaded->GetSearchDirs();
+    double                                        dirScale     = 0.0;
+    for( std::size_t lam = 0; lam < serialDirs.size(); ++lam )
+    {
+      dirScale = std::max( dirScale, serialDirs[ lam ].inf_norm() );
+    }
+    for( std::size_t lam = 0; lam < serialDirs.size() && lam < threadedDirs.size(); ++lam )
+    {
+      for( unsigned int i = 0; i < NumberOfParameters; ++i )
+      {
+        if( !AreClose( serialDirs[ lam ][ i ], threadedDirs[ lam ][ i ], dirScale ) )
+        {
+          std::cerr << "ERROR: search direction " << lam << " differs at " << i << ": "
+                    << threadedDirs[ lam ][ i ] << " (multi-threaded), "
+                    << serialDirs[ lam ][ i ] << " (single-threaded)." << std::endl;
+          success = false;
+        }
+      }
+    }
+    if( serialDirs.size() != threadedDirs.size() )
+    {
+      std::cerr << "ERROR: the number of search directions differs." << std::endl;
+      success = false;
+    }
+
+    /** The covariance matrix. */
+    const TestOptimizer::CovarianceMatrixType & serialC   = serial->GetC();
+    const TestOptimizer::CovarianceMatrixType & threadedC = threaded->GetC();
+    const double                                cScale    = serialC.absolute_value_max();
+    for( unsigned int i = 0; i < NumberOfParameters; ++i )
+    {
+      for( unsigned int j = 0; j < NumberOfParameters; ++j )
+      {
+        if( !AreClose( serialC[ i ][ j ], threadedC[ i ][ j ], cScale ) )
+        {
+          std::cerr << "ERROR: the covariance matrix differs at (" << i << "," << j << "): "
+                    << threadedC[ i ][ j ] << " (multi-threaded), "
+                    << serialC[ i ][ j ] << " (single-threaded)." << std::endl;
+          success = false;
+        }
+      }
+    }
+
+    /** The final position. */
+    const TestOptimizer::ParametersType & serialPosition   = serial->GetCurrentPosition();
+    const TestOptimizer::ParametersType & threadedPosition = threaded->GetCurrentPosition();
+    for( unsigned int i = 0; i < NumberOfParameters; ++i )
+    {
+      if( !AreClose( serialPosition[ i ], threadedPosition[ i ], 1.0 ) )
+      {
+        std::cerr << "ERROR: the position differs at " << i << ": " << threadedPosition[ i ]
+                  << " (multi-threaded), " << serialPosition[ i ] << " (single-threaded)." << std::endl;
+        success = false;
+      }
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,232 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCompressedSparseRowMatrix.h"
+
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// This test checks the assembly of the SelfHessian in compressed sparse row
+// format, as done by AdvancedMeanSquaresImageToImageMetric::
+// GetCompressedSelfHessian(), against the vnl_sparse_matrix assembly of
+// GetSelfHessian() in earlier versions of elastix:
+//   H( nzji[ i ], nzji[ j ] ) += J[ i ] * J[ j ], for j >= i,
+// skipping contributions with a magnitude below 1e-14. The samples are
+// added in several chunks, with one and with several threads, so that the
+// reuse of the scratch space of the threads over the chunks is tested. Some
+// samples are left out, as the metric does for samples outside the mask.
+
+namespace
+{
+
+typedef itk::CompressedSparseRowMatrix  MatrixType;
+typedef MatrixType::VnlSparseMatrixType VnlSparseMatrixType;
+typedef MatrixType::ValueType           ValueType;
+
+const unsigned int NumberOfRows                   = 97;
+const unsigned int NumberOfNonZeroJacobianIndices = 12;
+const unsigned int NumberOfSamples                = 500;
+const unsigned int NumberOfChunks                 = 4;
+const double       Threshold                      = 1e-14;
+
+struct SampleType
+{
+  bool                                   m_Valid;
+  MatrixType::NonZeroJacobianIndicesType m_Indices;
+  std::vector< ValueType >               m_Jacobian;
+};
+
+/** Random samples, each with sorted non-zero Jacobian indices, as the
+ * B-spline transform gives. Some Jacobian values are very small. */
+std::vector< SampleType >
+CreateSamples( void )
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 2468 );
+
+  std::vector< SampleType > samples( NumberOfSamples );
+  for( unsigned int s = 0; s < NumberOfSamples; ++s )
+  {
+    SampleType & sample = samples[ s ];
+    sample.m_Valid = randomNum->GetUniformVariate( 0.0, 1.0 ) > 0.1;
+
+    /** A local support: consecutive indices, with a random gap. */
+    const unsigned int first = randomNum->GetIntegerVariate( NumberOfRows - 2 * NumberOfNonZeroJacobianIndices );
+    const unsigned int gap   = randomNum->GetIntegerVariate( NumberOfNonZeroJacobianIndices );
+    sample.m_Indices.resize( NumberOfNonZeroJacobianIndices );
+    sample.m_Jacobian.resize( NumberOfNonZeroJacobianIndices );
+    for( unsigned int i = 0; i < NumberOfNonZeroJacobianIndices; ++i )
+    {
+      sample.m_Indices[ i ]  = first + i + ( i >= NumberOfNonZeroJacobianIndices / 2 ? gap : 0 );
+      sample.m_Jacobian[ i ] = randomNum->GetUniformVariate( -1.0, 1.0 );
+      if( i % 5 == 4 )
+      {
+        sample.m_Jacobian[ i ] *= 1e-8;
+      }
+    }
+  }
+  return samples;
+}
+
+
+/** The reference: the vnl_sparse_matrix assembly. */
+void
+ComputeReference( const std::vector< SampleType > & samples, VnlSparseMatrixType & H )
+{
+  H.set_size( NumberOfRows, NumberOfRows );
+  for( unsigned int s = 0; s < samples.size(); ++s )
+  {
+    const SampleType & sample = samples[ s ];
+    if( !sample.m_Valid )
+    {
+      continue;
+    }
+    for( unsigned int i = 0; i < NumberOfNonZeroJacobianIndices; ++i )
+    {
+      for( unsigned int j = i; j < NumberOfNonZeroJacobianIndices; ++j )
+      {
+        const double value = sample.m_Jacobian[ i ] * sample.m_Jacobian[ j ];
+        if( ( value < Threshold ) && ( value > -Threshold ) )
+        {
+          continue;
+        }
+        H( sample.m_Indices[ i ], sample.m_Indices[ j ] ) += value;
+      }
+    }
+  }
+}
+
+
+/** The compressed sparse row assembly, in chunks. */
+MatrixType::Pointer
+Assemble( const std::vector< SampleType > & samples, const unsigned int numberOfThreads )
+{
+  MatrixType::Pointer H = MatrixType::New();
+  H->InitializeAssembly( NumberOfRows, NumberOfNonZeroJacobianIndices, 1, numberOfThreads, Threshold );
+
+  const unsigned int samplesPerChunk = ( NumberOfSamples + NumberOfChunks - 1 ) / NumberOfChunks;
+  for( unsigned int chunkBegin = 0; chunkBegin < NumberOfSamples; chunkBegin += samplesPerChunk )
+  {
+    const unsigned int chunkEnd = std::min( chunkBegin + samplesPerChunk, NumberOfSamples );
+    H->BeginChunk( chunkEnd - chunkBegin );
+    for( unsigned int s = chunkBegin; s < chunkEnd; ++s )
+    {
+      if( samples[ s ].m_Valid )
+      {
+        H->SetSampleJacobian( s - chunkBegin, samples[ s ].m_Indices, samples[ s ].m_Jacobian.data() );
+      }
+    }
+    H->AddChunk();
+  }
+  H->FinishAssembly();
+  return H;
+}
+
+
+/** Compare the upper triangle, and check that the rows are sorted with the
+ * diagonal element first. */
+bool
+Compare( const char * name, const MatrixType * H, const VnlSparseMatrixType & reference )
+{
+  bool                          success       = true;
+  const MatrixType::IndexType * rowPointers   = H->GetRowPointers();
+  const MatrixType::IndexType * columnIndices = H->GetColumnIndices();
+  const ValueType *             values        = H->GetValues();
+
+  if( H->GetNumberOfRows() != NumberOfRows )
+  {
+    std::cerr << "ERROR: " << name << ": the number of rows is " << H->GetNumberOfRows() << std::endl;
+    return false;
+  }
+
+  for( unsigned int r = 0; r < NumberOfRows; ++r )
+  {
+    std::vector< ValueType > row( NumberOfRows, 0.0 );
+    for( MatrixType::IndexType i = rowPointers[ r ]; i < rowPointers[ r + 1 ]; ++i )
+    {
+      const MatrixType::IndexType c = columnIndices[ i ];
+      if( ( i == rowPointers[ r ] && c != static_cast< MatrixType::IndexType >( r ) )
+        || ( i > rowPointers[ r ] && c <= columnIndices[ i - 1 ] ) )
+      {
+        std::cerr << "ERROR: " << name << ": the columns of row " << r << " are not sorted." << std::endl;
+        success = false;
+      }
+      row[ c ] = values[ i ];
+    }
+    for( unsigned int c = 0; c < NumberOfRows; ++c )
+    {
+      const double expected = reference.get( r, c );
+      if( std::abs( row[ c ] - expected ) > 1e-12 * std::max( 1.0, std::abs( expected ) ) )
+      {
+        std::cerr << "ERROR: " << name << ": H(" << r << "," << c << ") = " << row[ c ]
+                  << ", expected " << expected << std::endl;
+        success = false;
+      }
+    }
+  }
+  return success;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    const std::vector< SampleType > samples = CreateSamples();
+
+    VnlSparseMatrixType reference;
+    ComputeReference( samples, reference );
+
+    MatrixType::Pointer H1 = Assemble( samples, 1 );
+    MatrixType::Pointer H3 = Assemble( samples, 3 );
+    std::cerr << "Number of nonzeros: " << H1->GetNumberOfNonZeros() << std::endl;
+    success &= Compare( "1 thread", H1, reference );
+    success &= Compare( "3 threads", H3, reference );
+
+    /** The conversion to and from a vnl_sparse_matrix. */
+    VnlSparseMatrixType converted;
+    H3->ConvertToVnlSparseMatrix( converted );
+    MatrixType::Pointer H4 = MatrixType::New();
+    H4->ConvertFromVnlSparseMatrix( converted );
+    success &= Compare( "converted", H4, reference );
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
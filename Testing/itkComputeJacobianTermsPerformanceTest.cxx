@@ -0,0 +1,191 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkComputeJacobianTerms.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImage.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test computes the Jacobian terms for the automatic parameter estimation
+// of ASGD, for a 3D B-spline transform, with ComputeSingleThreaded() and with
+// the multi-threaded Compute(), using one thread and the default number of
+// threads. It reports the timings and checks that the terms are equal.
+
+namespace
+{
+
+bool
+CheckTerm( const char * name, const double reference, const double value )
+{
+  if( std::abs( value - reference ) > 1e-8 * ( std::abs( reference ) + 1e-12 ) )
+  {
+    std::cerr << "ERROR: " << name << " differs: single-threaded = " << reference
+              << ", multi-threaded = " << value << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int Dimension   = 3;
+  const unsigned int SplineOrder = 3;
+
+  /** The image size in each dimension. Distinguish between Debug and Release mode. */
+#ifndef NDEBUG
+  unsigned int imageSize = 32;
+#else
+  unsigned int imageSize = 96;
+#endif
+  if( argc > 1 )
+  {
+    imageSize = static_cast< unsigned int >( atoi( argv[ 1 ] ) );
+  }
+
+  /** Typedefs. */
+  typedef itk::Image< short, Dimension > ImageType;
+  typedef itk::AdvancedBSplineDeformableTransform<
+    double, Dimension, SplineOrder >                        TransformType;
+  typedef itk::ComputeJacobianTerms< ImageType, TransformType > ComputeJacobianTermsType;
+  typedef TransformType::ParametersType                         ParametersType;
+  typedef ImageType::RegionType                                 GridRegionType;
+  typedef ImageType::SizeType                                   GridSizeType;
+  typedef ImageType::SpacingType                                GridSpacingType;
+  typedef ImageType::PointType                                  GridOriginType;
+  typedef ImageType::DirectionType                              GridDirectionType;
+
+  /** Create the fixed image. */
+  ImageType::Pointer    image = ImageType::New();
+  ImageType::RegionType region;
+  ImageType::SizeType   size;
+  size.Fill( imageSize );
+  region.SetSize( size );
+  image->SetRegions( region );
+  image->Allocate();
+  image->FillBuffer( 0 );
+
+  /** Create a B-spline transform with a grid spacing of 8 voxels, covering the image. */
+  const double    gridSpacingValue = 8.0;
+  GridSpacingType gridSpacing;
+  gridSpacing.Fill( gridSpacingValue );
+  GridOriginType gridOrigin;
+  gridOrigin.Fill( -gridSpacingValue );
+  GridSizeType gridSize;
+  gridSize.Fill( static_cast< unsigned int >( std::ceil( imageSize / gridSpacingValue ) ) + SplineOrder );
+  GridRegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  GridDirectionType gridDirection;
+  gridDirection.SetIdentity();
+
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridDirection( gridDirection );
+
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     parameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = std::sin( 0.1 * i );
+  }
+  transform->SetParameters( parameters );
+
+  /** The settings of AdaptiveStochasticGradientDescent. */
+  const itk::SizeValueType numberOfJacobianMeasurements
+    = std::max( static_cast< itk::SizeValueType >( 1000 ),
+    static_cast< itk::SizeValueType >( 2 * numberOfParameters ) );
+  std::cerr << "Image size = " << imageSize
+            << ", number of parameters = " << numberOfParameters
+            << ", number of Jacobian measurements = " << numberOfJacobianMeasurements
+            << std::endl;
+
+  ComputeJacobianTermsType::Pointer computeJacobianTerms = ComputeJacobianTermsType::New();
+  computeJacobianTerms->SetFixedImage( image );
+  computeJacobianTerms->SetFixedImageRegion( image->GetBufferedRegion() );
+  computeJacobianTerms->SetTransform( transform );
+  computeJacobianTerms->SetMaxBandCovSize( 192 );
+  computeJacobianTerms->SetNumberOfBandStructureSamples( 10 );
+  computeJacobianTerms->SetNumberOfJacobianMeasurements( numberOfJacobianMeasurements );
+  computeJacobianTerms->SetUseScales( false );
+
+  /** Single-threaded. */
+  double         TrC0 = 0.0, TrCC0 = 0.0, maxJJ0 = 0.0, maxJCJ0 = 0.0;
+  itk::TimeProbe singleTimer;
+  singleTimer.Start();
+  computeJacobianTerms->ComputeSingleThreaded( TrC0, TrCC0, maxJJ0, maxJCJ0 );
+  singleTimer.Stop();
+
+  /** Multi-threaded, with one thread. */
+  const itk::ThreadIdType numberOfThreads = computeJacobianTerms->GetNumberOfWorkUnits();
+  double                  TrC1 = 0.0, TrCC1 = 0.0, maxJJ1 = 0.0, maxJCJ1 = 0.0;
+  itk::TimeProbe          oneThreadTimer;
+  computeJacobianTerms->SetNumberOfWorkUnits( 1 );
+  oneThreadTimer.Start();
+  computeJacobianTerms->Compute( TrC1, TrCC1, maxJJ1, maxJCJ1 );
+  oneThreadTimer.Stop();
+
+  /** Multi-threaded, with the default number of threads. */
+  double         TrC2 = 0.0, TrCC2 = 0.0, maxJJ2 = 0.0, maxJCJ2 = 0.0;
+  itk::TimeProbe multiThreadTimer;
+  computeJacobianTerms->SetNumberOfWorkUnits( numberOfThreads );
+  multiThreadTimer.Start();
+  computeJacobianTerms->Compute( TrC2, TrCC2, maxJJ2, maxJCJ2 );
+  multiThreadTimer.Stop();
+
+  /** Report timings. */
+  std::cerr << std::setprecision( 4 );
+  std::cerr << "ComputeSingleThreaded():    " << singleTimer.GetMean() << " s" << std::endl;
+  std::cerr << "Compute(), 1 thread:        " << oneThreadTimer.GetMean() << " s" << std::endl;
+  std::cerr << "Compute(), " << numberOfThreads << " threads:       "
+            << multiThreadTimer.GetMean() << " s" << std::endl;
+  std::cerr << "Speedup: " << singleTimer.GetMean() / multiThreadTimer.GetMean() << std::endl;
+
+  /** Check that all versions give the same terms. */
+  std::cerr << std::setprecision( 10 );
+  std::cerr << "TrC = " << TrC0 << ", TrCC = " << TrCC0
+            << ", maxJJ = " << maxJJ0 << ", maxJCJ = " << maxJCJ0 << std::endl;
+  bool success = true;
+  success &= CheckTerm( "TrC (1 thread)", TrC0, TrC1 );
+  success &= CheckTerm( "TrCC (1 thread)", TrCC0, TrCC1 );
+  success &= CheckTerm( "maxJJ (1 thread)", maxJJ0, maxJJ1 );
+  success &= CheckTerm( "maxJCJ (1 thread)", maxJCJ0, maxJCJ1 );
+  success &= CheckTerm( "TrC", TrC0, TrC2 );
+  success &= CheckTerm( "TrCC", TrCC0, TrCC2 );
+  success &= CheckTerm( "maxJJ", maxJJ0, maxJJ2 );
+  success &= CheckTerm( "maxJCJ", maxJCJ0, maxJCJ2 );
+  if( !success || TrC0 <= 0.0 )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
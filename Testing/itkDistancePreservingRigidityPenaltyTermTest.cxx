@@ -0,0 +1,398 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkDistancePreservingRigidityPenaltyTerm.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkBSplineKernelFunction.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+//-------------------------------------------------------------------------------------
+// This test compares the value and derivative of the
+// DistancePreservingRigidityPenaltyTerm, which precomputes the point pairs
+// and uses GetJacobian() of the B-spline transform, with the implementation
+// of earlier versions of elastix, which searched the 3x3x3 neighbourhood of
+// every penalty grid point in each evaluation and computed the B-spline
+// weights with its own knot kernel. The penalty grid is a small 3D image
+// with:
+// - a rigid region in the interior of the grid,
+// - a rigid region that touches the border of the grid. Earlier versions
+//   read the segmentation outside the grid for its neighbours; the reference
+//   counts them as background, as the penalty term does now,
+// - a region with a rigidity index of 6 or more, which only counts in the
+//   number of rigid grid points, and
+// - an isolated rigid grid point, which has no pairs.
+// This is done single-threaded and multi-threaded.
+
+namespace
+{
+
+const unsigned int Dimension = 3;
+typedef float                                                     PixelType;
+typedef itk::Image< PixelType, Dimension >                        ImageType;
+typedef itk::DistancePreservingRigidityPenaltyTerm< ImageType, double >
+                                                                  PenaltyType;
+typedef PenaltyType::SegmentedImageType                           SegmentedImageType;
+typedef itk::AdvancedCombinationTransform< double, Dimension >    CombinationTransformType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >
+                                                                  BSplineTransformType;
+typedef itk::LinearInterpolateImageFunction< ImageType, double >  InterpolatorType;
+typedef CombinationTransformType::ParametersType                  ParametersType;
+typedef PenaltyType::DerivativeType                               DerivativeType;
+
+/** The sampled segmented image, which defines the penalty grid. */
+SegmentedImageType::Pointer
+CreateSegmentedImage( void )
+{
+  SegmentedImageType::SizeType size;
+  size[ 0 ] = 10; size[ 1 ] = 9; size[ 2 ] = 8;
+  SegmentedImageType::SpacingType spacing;
+  spacing[ 0 ] = 2.0; spacing[ 1 ] = 2.0; spacing[ 2 ] = 3.0;
+  SegmentedImageType::PointType origin;
+  origin[ 0 ] = 1.0; origin[ 1 ] = 2.0; origin[ 2 ] = -1.0;
+
+  SegmentedImageType::Pointer image = SegmentedImageType::New();
+  image->SetRegions( size );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< SegmentedImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    const SegmentedImageType::IndexType index = it.GetIndex();
+    const double                        x     = index[ 0 ] - 5.5;
+    const double                        y     = index[ 1 ] - 4.0;
+    const double                        z     = index[ 2 ] - 4.0;
+    short                               label = 0;
+    if( x * x + y * y + 2.0 * z * z < 7.0 )
+    {
+      label = 1; // interior
+    }
+    else if( index[ 0 ] < 2 && index[ 1 ] > 3 )
+    {
+      label = 2; // touches the border
+    }
+    else if( index[ 0 ] > 7 && index[ 1 ] < 2 && index[ 2 ] > 4 )
+    {
+      label = 7; // not rigid, but counted in the number of rigid grid points
+    }
+    else if( index[ 0 ] == 8 && index[ 1 ] == 7 && index[ 2 ] == 1 )
+    {
+      label = 3; // isolated
+    }
+    it.Set( label );
+  }
+  return image;
+}
+
+
+/** A B-spline transform of which the valid region covers the penalty grid. */
+CombinationTransformType::Pointer
+CreateTransform( BSplineTransformType::Pointer & bspline, ParametersType & position )
+{
+  bspline = BSplineTransformType::New();
+
+  BSplineTransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( 8 );
+  BSplineTransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  BSplineTransformType::SpacingType gridSpacing;
+  gridSpacing.Fill( 6.0 );
+  BSplineTransformType::OriginType gridOrigin;
+  gridOrigin.Fill( -8.0 );
+  bspline->SetGridRegion( gridRegion );
+  bspline->SetGridSpacing( gridSpacing );
+  bspline->SetGridOrigin( gridOrigin );
+
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bspline );
+
+  position.SetSize( bspline->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < position.GetSize(); ++i )
+  {
+    position[ i ] = 0.4 * std::sin( 0.37 * i + 0.5 );
+  }
+  return transform;
+}
+
+
+/** The rigidity index of a grid point, with grid points outside the grid as background. */
+unsigned int
+GetRigidityIndex( const SegmentedImageType * image, const SegmentedImageType::IndexType & index )
+{
+  if( !image->GetBufferedRegion().IsInside( index ) )
+  {
+    return 0;
+  }
+  return static_cast< unsigned int >( image->GetPixel( index ) );
+}
+
+
+/** The penalty term of earlier versions of elastix. */
+void
+ComputeReference( const SegmentedImageType * segmentedImage,
+  const CombinationTransformType * transform, const BSplineTransformType * bspline,
+  double & value, DerivativeType & derivative )
+{
+  const SegmentedImageType::RegionType region = segmentedImage->GetBufferedRegion();
+
+  /** The B-spline knot image. */
+  const ParametersType fixedParameters = bspline->GetFixedParameters();
+  unsigned int         knotSize[ Dimension ];
+  double               knotOrigin[ Dimension ];
+  double               knotSpacing[ Dimension ];
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    knotSize[ d ]    = static_cast< unsigned int >( fixedParameters[ d ] );
+    knotOrigin[ d ]  = fixedParameters[ Dimension + d ];
+    knotSpacing[ d ] = fixedParameters[ 2 * Dimension + d ];
+  }
+  const unsigned int numberOfParametersPerDimension = knotSize[ 0 ] * knotSize[ 1 ] * knotSize[ 2 ];
+
+  itk::BSplineKernelFunction< 3 >::Pointer bSplineKernel = itk::BSplineKernelFunction< 3 >::New();
+
+  unsigned int numberOfRigidGrids = 0;
+  itk::ImageRegionConstIteratorWithIndex< SegmentedImageType > it( segmentedImage, region );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    if( static_cast< unsigned int >( it.Get() ) > 0 )
+    {
+      ++numberOfRigidGrids;
+    }
+  }
+
+  value      = 0.0;
+  derivative = DerivativeType( bspline->GetNumberOfParameters() );
+  derivative.Fill( 0.0 );
+
+  SegmentedImageType::IndexType neighborIndex;
+  SegmentedImageType::PointType point, neighborPoint;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const SegmentedImageType::IndexType index      = it.GetIndex();
+    const unsigned int                  pixelValue = static_cast< unsigned int >( it.Get() );
+    if( pixelValue == 0 || pixelValue >= 6 )
+    {
+      continue;
+    }
+
+    /** Count the neighbours with the same rigidity index, the center included. */
+    unsigned int numberOfRigidGridsNeighbor = 0;
+    for( int k = -1; k <= 1; ++k )
+    {
+      for( int j = -1; j <= 1; ++j )
+      {
+        for( int i = -1; i <= 1; ++i )
+        {
+          neighborIndex[ 0 ] = index[ 0 ] + i;
+          neighborIndex[ 1 ] = index[ 1 ] + j;
+          neighborIndex[ 2 ] = index[ 2 ] + k;
+          if( GetRigidityIndex( segmentedImage, neighborIndex ) == pixelValue )
+          {
+            ++numberOfRigidGridsNeighbor;
+          }
+        }
+      }
+    }
+    if( numberOfRigidGridsNeighbor <= 1 )
+    {
+      continue;
+    }
+
+    segmentedImage->TransformIndexToPhysicalPoint( index, point );
+    const CombinationTransformType::OutputPointType xf = transform->TransformPoint( point );
+    const double weight = 1.0 / numberOfRigidGridsNeighbor / numberOfRigidGrids;
+
+    for( int k = -1; k <= 1; ++k )
+    {
+      for( int j = -1; j <= 1; ++j )
+      {
+        for( int i = -1; i <= 1; ++i )
+        {
+          neighborIndex[ 0 ] = index[ 0 ] + i;
+          neighborIndex[ 1 ] = index[ 1 ] + j;
+          neighborIndex[ 2 ] = index[ 2 ] + k;
+          if( GetRigidityIndex( segmentedImage, neighborIndex ) != pixelValue )
+          {
+            continue;
+          }
+          segmentedImage->TransformIndexToPhysicalPoint( neighborIndex, neighborPoint );
+          const CombinationTransformType::OutputPointType xn = transform->TransformPoint( neighborPoint );
+
+          const double dX = neighborPoint.SquaredEuclideanDistanceTo( point );
+          const double dx = xn.SquaredEuclideanDistanceTo( xf );
+          value += ( dx - dX ) * ( dx - dX ) * weight;
+
+          /** The B-spline weights of both points, with the knot kernel. */
+          double derivativeTerm[ Dimension ];
+          double t[ Dimension ], tNeighbor[ Dimension ];
+          double start[ Dimension ], startNeighbor[ Dimension ];
+          for( unsigned int d = 0; d < Dimension; ++d )
+          {
+            derivativeTerm[ d ] = 4.0 * ( dx - dX ) * ( xn[ d ] - xf[ d ] ) * weight;
+            t[ d ]              = ( point[ d ] - knotOrigin[ d ] ) / knotSpacing[ d ];
+            tNeighbor[ d ]      = ( neighborPoint[ d ] - knotOrigin[ d ] ) / knotSpacing[ d ];
+            start[ d ]          = std::floor( t[ d ] ) - 1.0;
+            startNeighbor[ d ]  = std::floor( tNeighbor[ d ] ) - 1.0;
+          }
+          for( unsigned int kk = 0; kk < 4; ++kk )
+          {
+            for( unsigned int jj = 0; jj < 4; ++jj )
+            {
+              for( unsigned int ii = 0; ii < 4; ++ii )
+              {
+                const double m  = start[ 0 ] + ii, n = start[ 1 ] + jj, p = start[ 2 ] + kk;
+                const double nm = startNeighbor[ 0 ] + ii, nn = startNeighbor[ 1 ] + jj, np = startNeighbor[ 2 ] + kk;
+
+                const double du_dC_neighbor = bSplineKernel->Evaluate( tNeighbor[ 0 ] - nm )
+                  * bSplineKernel->Evaluate( tNeighbor[ 1 ] - nn ) * bSplineKernel->Evaluate( tNeighbor[ 2 ] - np );
+                const unsigned int par1 = static_cast< unsigned int >( nm ) + knotSize[ 0 ] * static_cast< unsigned int >( nn )
+                  + knotSize[ 0 ] * knotSize[ 1 ] * static_cast< unsigned int >( np );
+
+                const double du_dC = bSplineKernel->Evaluate( t[ 0 ] - m )
+                  * bSplineKernel->Evaluate( t[ 1 ] - n ) * bSplineKernel->Evaluate( t[ 2 ] - p );
+                const unsigned int par2 = static_cast< unsigned int >( m ) + knotSize[ 0 ] * static_cast< unsigned int >( n )
+                  + knotSize[ 0 ] * knotSize[ 1 ] * static_cast< unsigned int >( p );
+
+                for( unsigned int d = 0; d < Dimension; ++d )
+                {
+                  derivative[ par1 + d * numberOfParametersPerDimension ] += derivativeTerm[ d ] * du_dC_neighbor;
+                  derivative[ par2 + d * numberOfParametersPerDimension ] -= derivativeTerm[ d ] * du_dC;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+
+bool
+AreEqual( const double a, const double b, const double scale )
+{
+  return std::abs( a - b ) <= 1e-10 * std::max( 1.0, scale );
+}
+
+
+bool
+TestPenalty( const unsigned int numberOfWorkUnits )
+{
+  SegmentedImageType::Pointer segmentedImage = CreateSegmentedImage();
+
+  /** The fixed and moving image are not used by the penalty, but are required by the metric. */
+  ImageType::Pointer image = ImageType::New();
+  image->CopyInformation( segmentedImage );
+  image->SetRegions( segmentedImage->GetLargestPossibleRegion() );
+  image->Allocate();
+  image->FillBuffer( 0.0 );
+
+  BSplineTransformType::Pointer     bspline;
+  ParametersType                    position;
+  CombinationTransformType::Pointer transform = CreateTransform( bspline, position );
+
+  PenaltyType::Pointer penalty = PenaltyType::New();
+  penalty->SetFixedImage( image );
+  penalty->SetFixedImageRegion( image->GetBufferedRegion() );
+  penalty->SetMovingImage( image );
+  penalty->SetInterpolator( InterpolatorType::New() );
+  penalty->SetTransform( transform );
+  penalty->SetSegmentedImage( segmentedImage );
+  penalty->SetSampledSegmentedImage( segmentedImage );
+  penalty->SetNumberOfWorkUnits( numberOfWorkUnits );
+  penalty->SetUseMultiThread( numberOfWorkUnits > 1 );
+  penalty->Initialize();
+
+  const std::string settings = numberOfWorkUnits > 1 ? "multi-threaded" : "single-threaded";
+  std::cerr << settings << ": " << penalty->GetNumberOfRigidGrids() << " rigid grid points, "
+            << penalty->GetNumberOfPointPairs() << " point pairs." << std::endl;
+
+  double         value = 0.0;
+  DerivativeType derivative;
+  penalty->GetValueAndDerivative( position, value, derivative );
+  const double valueOnly = penalty->GetValue( position );
+
+  double         expectedValue = 0.0;
+  DerivativeType expectedDerivative;
+  transform->SetParameters( position );
+  ComputeReference( segmentedImage, transform, bspline, expectedValue, expectedDerivative );
+
+  bool success = true;
+  if( expectedValue == 0.0 )
+  {
+    std::cerr << "ERROR: " << settings << ": the reference penalty is zero." << std::endl;
+    success = false;
+  }
+  if( !AreEqual( value, expectedValue, expectedValue ) || !AreEqual( valueOnly, expectedValue, expectedValue ) )
+  {
+    std::cerr << "ERROR: " << settings << ": the value is " << value << " (GetValueAndDerivative), "
+              << valueOnly << " (GetValue), expected " << expectedValue << "." << std::endl;
+    success = false;
+  }
+  const double scale = expectedDerivative.inf_norm();
+  for( unsigned int j = 0; j < expectedDerivative.GetSize(); ++j )
+  {
+    if( !AreEqual( derivative[ j ], expectedDerivative[ j ], scale ) )
+    {
+      std::cerr << "ERROR: " << settings << ": derivative " << j << " is " << derivative[ j ]
+                << ", expected " << expectedDerivative[ j ] << "." << std::endl;
+      success = false;
+    }
+  }
+
+  return success;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    success &= TestPenalty( 1 );
+    success &= TestPenalty( 3 );
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
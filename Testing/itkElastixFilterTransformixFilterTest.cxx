@@ -0,0 +1,194 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "elxElastixFilter.h"
+#include "elxParameterObject.h"
+#include "elxTransformixFilter.h"
+
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+//-------------------------------------------------------------------------------------
+// This test checks the in-memory hand-off of the transform parameters from the
+// ElastixFilter to the TransformixFilter. The ElastixFilter passes the
+// TransformParameters as a numeric buffer, which the TransformixFilter uses
+// without converting it to text. The result should equal that of the
+// file-based path, in which the transform parameter file is written and read
+// back. Since the parameter file stores the parameters with a limited
+// precision, the images are compared with a small tolerance.
+
+namespace
+{
+
+const unsigned int Dimension = 2;
+typedef float                                                  PixelType;
+typedef itk::Image< PixelType, Dimension >                     ImageType;
+typedef elastix::ElastixFilter< ImageType, ImageType >         ElastixFilterType;
+typedef elastix::TransformixFilter< ImageType >                TransformixFilterType;
+typedef elastix::ParameterObject                               ParameterObjectType;
+typedef ParameterObjectType::ParameterMapType                  ParameterMapType;
+typedef ParameterObjectType::ParameterValueVectorType          ParameterValueVectorType;
+
+/** Create an image with a Gaussian blob at the given centre. */
+ImageType::Pointer
+CreateImage( const double centerX, const double centerY )
+{
+  ImageType::SizeType size;
+  size[ 0 ] = 64; size[ 1 ] = 56;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               x     = index[ 0 ] - centerX;
+    const double               y     = index[ 1 ] - centerY;
+    it.Set( static_cast< PixelType >( 100.0 * std::exp( -( x * x / 120.0 + y * y / 60.0 ) ) ) );
+  }
+  return image;
+}
+
+
+/** Apply the transform parameters to the moving image with transformix. */
+ImageType::Pointer
+ApplyTransform( ImageType * movingImage, ParameterObjectType * transformParameterObject )
+{
+  TransformixFilterType::Pointer transformixFilter = TransformixFilterType::New();
+  transformixFilter->SetMovingImage( movingImage );
+  transformixFilter->SetTransformParameterObject( transformParameterObject );
+  transformixFilter->LogToConsoleOff();
+  transformixFilter->LogToFileOff();
+  transformixFilter->Update();
+  return transformixFilter->GetOutput();
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  if( argc != 2 )
+  {
+    std::cerr << "ERROR: You should specify the output directory." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string parameterFileName = std::string( argv[ 1 ] )
+    + "/TransformParameters.ElastixFilterTransformixFilterTest.txt";
+
+  bool success = true;
+  try
+  {
+    ImageType::Pointer fixedImage  = CreateImage( 30.0, 28.0 );
+    ImageType::Pointer movingImage = CreateImage( 33.0, 26.0 );
+
+    /** Register with a B-spline transform, which has many parameters. */
+    ParameterMapType parameterMap = ParameterObjectType::GetDefaultParameterMap( "bspline", 1, 16.0 );
+    parameterMap[ "MaximumNumberOfIterations" ] = ParameterValueVectorType( 1, "32" );
+    ParameterObjectType::Pointer parameterObject = ParameterObjectType::New();
+    parameterObject->SetParameterMap( parameterMap );
+
+    ElastixFilterType::Pointer elastixFilter = ElastixFilterType::New();
+    elastixFilter->SetFixedImage( fixedImage );
+    elastixFilter->SetMovingImage( movingImage );
+    elastixFilter->SetParameterObject( parameterObject );
+    elastixFilter->LogToConsoleOff();
+    elastixFilter->LogToFileOff();
+    elastixFilter->Update();
+
+    /** The TransformParameters should be handed off as a numeric buffer,
+     * and be converted to text on request only.
+     */
+    ParameterObjectType::Pointer transformParameterObject = elastixFilter->GetTransformParameterObject();
+    const ParameterObjectType::NumericParameterValueVectorPointer numericParameters
+      = transformParameterObject->GetNumericParameter( 0, "TransformParameters" );
+    if( !numericParameters )
+    {
+      std::cerr << "ERROR: The TransformParameters are not passed as a numeric buffer." << std::endl;
+      success = false;
+    }
+    else
+    {
+      if( transformParameterObject->GetTextParameterMap()[ 0 ].count( "TransformParameters" ) != 0 )
+      {
+        std::cerr << "ERROR: The TransformParameters are also converted to text." << std::endl;
+        success = false;
+      }
+      if( transformParameterObject->GetParameterMap( 0 )[ "TransformParameters" ].size()
+        != numericParameters->size() )
+      {
+        std::cerr << "ERROR: GetParameterMap() does not contain the TransformParameters." << std::endl;
+        success = false;
+      }
+    }
+
+    /** Apply the transform, in memory and through a parameter file. */
+    ImageType::Pointer inMemoryResult = ApplyTransform( movingImage, transformParameterObject );
+
+    transformParameterObject->WriteParameterFile( parameterFileName );
+    ParameterObjectType::Pointer readParameterObject = ParameterObjectType::New();
+    readParameterObject->ReadParameterFile( parameterFileName );
+    ImageType::Pointer fromFileResult = ApplyTransform( movingImage, readParameterObject );
+
+    /** Compare the results. */
+    double maximumDifference = 0.0;
+    itk::ImageRegionConstIterator< ImageType > it1( inMemoryResult, inMemoryResult->GetLargestPossibleRegion() );
+    itk::ImageRegionConstIterator< ImageType > it2( fromFileResult, fromFileResult->GetLargestPossibleRegion() );
+    for( ; !it1.IsAtEnd() && !it2.IsAtEnd(); ++it1, ++it2 )
+    {
+      maximumDifference = std::max( maximumDifference,
+        static_cast< double >( std::abs( it1.Get() - it2.Get() ) ) );
+    }
+    std::cerr << "Maximum difference between the in-memory and the file-based result: "
+              << maximumDifference << std::endl;
+
+    if( inMemoryResult->GetLargestPossibleRegion() != fromFileResult->GetLargestPossibleRegion() )
+    {
+      std::cerr << "ERROR: The in-memory and the file-based result differ in size." << std::endl;
+      success = false;
+    }
+    if( maximumDifference > 1e-2 )
+    {
+      std::cerr << "ERROR: The in-memory result differs from the file-based result." << std::endl;
+      success = false;
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
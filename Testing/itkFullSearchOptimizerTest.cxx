@@ -0,0 +1,164 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkFullSearchOptimizer.h"
+
+#include "itkSingleValuedCostFunction.h"
+
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test checks the branch and bound of the coarse-to-fine search of the
+// FullSearchOptimizer. The cost function has many local optima, and a known
+// Lipschitz constant. When the LipschitzConstant that is given to the
+// optimizer is a valid bound, and all evaluated points are candidates for
+// refinement, the coarse-to-fine search should find the same optimum as the
+// full search, while evaluating fewer points. This is tested for several
+// coarse grid factors, for minimization and maximization. The search space
+// sizes are chosen such that the last point is not on the coarse grid.
+
+namespace
+{
+
+/** f(x,y) = sin(3x) + cos(2y) + 0.1 (x^2 + y^2) + 0.05 x y, with a gradient
+ * of at most sqrt( (3 + 0.85 + 0.17)^2 + (2 + 0.68 + 0.22)^2 ) < 5 on the
+ * search space.
+ */
+class TestCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+
+  typedef TestCostFunction              Self;
+  typedef itk::SingleValuedCostFunction Superclass;
+  typedef itk::SmartPointer< Self >     Pointer;
+  itkNewMacro( Self );
+
+  MeasureType GetValue( const ParametersType & parameters ) const override
+  {
+    const double x = parameters[ 0 ];
+    const double y = parameters[ 1 ];
+    return std::sin( 3.0 * x ) + std::cos( 2.0 * y ) + 0.1 * ( x * x + y * y ) + 0.05 * x * y;
+  }
+
+
+  void GetDerivative( const ParametersType &, DerivativeType & ) const override
+  {
+    itkExceptionMacro( << "Not implemented" );
+  }
+
+
+  unsigned int GetNumberOfParameters( void ) const override
+  {
+    return 2;
+  }
+
+
+protected:
+
+  TestCostFunction() {}
+  ~TestCostFunction() override {}
+};
+
+typedef itk::FullSearchOptimizer OptimizerType;
+
+const double LipschitzConstant = 5.0;
+
+OptimizerType::Pointer
+Search( const bool maximize, const bool useCoarseToFineSearch, const unsigned int coarseGridFactor )
+{
+  TestCostFunction::Pointer costFunction = TestCostFunction::New();
+
+  OptimizerType::ParametersType initialPosition( 2 );
+  initialPosition.Fill( 0.0 );
+
+  OptimizerType::Pointer optimizer = OptimizerType::New();
+  optimizer->SetCostFunction( costFunction );
+  optimizer->SetInitialPosition( initialPosition );
+  optimizer->SetMaximize( maximize );
+  optimizer->AddSearchDimension( 0, -4.0, 4.25, 0.125 );
+  optimizer->AddSearchDimension( 1, -3.0, 3.375, 0.125 );
+  optimizer->SetUseCoarseToFineSearch( useCoarseToFineSearch );
+  optimizer->SetCoarseGridFactor( coarseGridFactor );
+  optimizer->SetNumberOfCellsToRefine( optimizer->GetNumberOfIterations() );
+  optimizer->SetLipschitzConstant( LipschitzConstant );
+  optimizer->StartOptimization();
+  return optimizer;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    for( unsigned int m = 0; m < 2; ++m )
+    {
+      const bool             maximize   = m == 1;
+      OptimizerType::Pointer fullSearch = Search( maximize, false, 1 );
+      std::cerr << ( maximize ? "maximize" : "minimize" ) << ": full search: best value "
+                << fullSearch->GetBestValue() << " at " << fullSearch->GetBestIndexInSearchSpace()
+                << ", " << fullSearch->GetCurrentIteration() << " evaluations" << std::endl;
+
+      const unsigned int coarseGridFactors[ 3 ] = { 3, 4, 8 };
+      for( unsigned int f = 0; f < 3; ++f )
+      {
+        OptimizerType::Pointer coarseToFine = Search( maximize, true, coarseGridFactors[ f ] );
+        std::cerr << "  coarse grid factor " << coarseGridFactors[ f ] << ": best value "
+                  << coarseToFine->GetBestValue() << " at " << coarseToFine->GetBestIndexInSearchSpace()
+                  << ", " << coarseToFine->GetCurrentIteration() << " evaluations, "
+                  << coarseToFine->GetNumberOfSkippedGridPoints() << " grid points skipped, "
+                  << coarseToFine->GetNumberOfCellsPrunedByBound() << " cells pruned by the bound"
+                  << std::endl;
+
+        if( coarseToFine->GetBestValue() != fullSearch->GetBestValue()
+          || coarseToFine->GetBestIndexInSearchSpace() != fullSearch->GetBestIndexInSearchSpace() )
+        {
+          std::cerr << "ERROR: the coarse-to-fine search with a valid Lipschitz bound misses the optimum."
+                    << std::endl;
+          success = false;
+        }
+        if( coarseToFine->GetNumberOfCellsPrunedByBound() == 0
+          || coarseToFine->GetNumberOfSkippedGridPoints() == 0
+          || coarseToFine->GetNumberOfSkippedGridPoints() + coarseToFine->GetCurrentIteration()
+          != fullSearch->GetCurrentIteration() )
+        {
+          std::cerr << "ERROR: the number of skipped grid points or pruned cells is wrong." << std::endl;
+          success = false;
+        }
+      }
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
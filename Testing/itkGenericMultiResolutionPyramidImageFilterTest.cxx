@@ -0,0 +1,169 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGenericMultiResolutionPyramidImageFilter.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test checks that computing the levels of the
+// GenericMultiResolutionPyramidImageFilter concurrently
+// (ComputeLevelsInParallel) gives the same levels as computing them one
+// after the other, with and without cascading, and both for the resampler
+// and for the shrinker.
+
+namespace
+{
+
+const unsigned int Dimension = 3;
+typedef float                                      PixelType;
+typedef itk::Image< PixelType, Dimension >         ImageType;
+typedef itk::GenericMultiResolutionPyramidImageFilter<
+  ImageType, ImageType >                           PyramidType;
+typedef PyramidType::RescaleScheduleType           RescaleScheduleType;
+typedef PyramidType::SmoothingScheduleType         SmoothingScheduleType;
+typedef itk::ImageRegionConstIterator< ImageType > ConstIteratorType;
+
+PyramidType::Pointer
+CreatePyramid( const ImageType * input, const bool useShrinkImageFilter,
+  const bool useCascadedLevels, const bool computeLevelsInParallel )
+{
+  const unsigned int    numberOfLevels = 4;
+  RescaleScheduleType   rescaleSchedule( numberOfLevels, Dimension );
+  SmoothingScheduleType smoothingSchedule( numberOfLevels, Dimension );
+  const unsigned int    factors[ numberOfLevels ] = { 6, 4, 2, 1 };
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
+  {
+    const unsigned int factor = factors[ level ];
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      rescaleSchedule[ level ][ d ]   = factor;
+      smoothingSchedule[ level ][ d ] = 0.5 * factor + 0.1 * d;
+    }
+  }
+
+  PyramidType::Pointer pyramid = PyramidType::New();
+  pyramid->SetInput( input );
+  pyramid->SetNumberOfLevels( numberOfLevels );
+  pyramid->SetRescaleSchedule( rescaleSchedule );
+  pyramid->SetSmoothingSchedule( smoothingSchedule );
+  pyramid->SetUseShrinkImageFilter( useShrinkImageFilter );
+  pyramid->SetComputeOnlyForCurrentLevel( false );
+  pyramid->SetUseCascadedLevels( useCascadedLevels );
+  pyramid->SetComputeLevelsInParallel( computeLevelsInParallel );
+  pyramid->SetNumberOfWorkUnits( 4 );
+  pyramid->Update();
+  return pyramid;
+}
+
+
+bool
+CompareLevels( const char * name, const PyramidType * reference, const PyramidType * pyramid )
+{
+  for( unsigned int level = 0; level < reference->GetNumberOfLevels(); ++level )
+  {
+    const ImageType * referenceLevel = reference->GetOutput( level );
+    const ImageType * testLevel      = pyramid->GetOutput( level );
+    if( referenceLevel->GetLargestPossibleRegion() != testLevel->GetLargestPossibleRegion() )
+    {
+      std::cerr << "ERROR: " << name << ": level " << level
+                << " has a different size." << std::endl;
+      return false;
+    }
+
+    ConstIteratorType itRef( referenceLevel, referenceLevel->GetLargestPossibleRegion() );
+    ConstIteratorType itTest( testLevel, testLevel->GetLargestPossibleRegion() );
+    for( ; !itRef.IsAtEnd(); ++itRef, ++itTest )
+    {
+      if( itTest.Get() != itRef.Get() )
+      {
+        std::cerr << "ERROR: " << name << ": level " << level << " differs at "
+                  << itRef.GetIndex() << ": serial = " << itRef.Get()
+                  << ", parallel = " << itTest.Get() << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  /** Create an input image with random values. */
+  ImageType::SizeType size;
+  size[ 0 ] = 40; size[ 1 ] = 36; size[ 2 ] = 30;
+  ImageType::Pointer input = ImageType::New();
+  input->SetRegions( size );
+  input->Allocate();
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 12345 );
+  itk::ImageRegionIterator< ImageType > it( input, input->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    it.Set( static_cast< PixelType >( randomNum->GetUniformVariate( 0.0, 100.0 ) ) );
+  }
+
+  bool success = true;
+  try
+  {
+    for( unsigned int shrink = 0; shrink < 2; ++shrink )
+    {
+      const bool useShrinkImageFilter = shrink == 1;
+      std::cerr << "UseShrinkImageFilter = " << useShrinkImageFilter << std::endl;
+
+      /** Serial reference, computed by the original pipeline. */
+      PyramidType::Pointer serial   = CreatePyramid( input, useShrinkImageFilter, false, false );
+      PyramidType::Pointer parallel = CreatePyramid( input, useShrinkImageFilter, false, true );
+      success &= CompareLevels( "ComputeLevelsInParallel", serial, parallel );
+
+      /** Cascading: level 0 (factor 6) and level 3 are computed from the
+       * input, concurrently, level 2 is cascaded from level 3, and level 1
+       * from level 2.
+       */
+      PyramidType::Pointer cascadedSerial   = CreatePyramid( input, useShrinkImageFilter, true, false );
+      PyramidType::Pointer cascadedParallel = CreatePyramid( input, useShrinkImageFilter, true, true );
+      success &= CompareLevels( "UseCascadedLevels + ComputeLevelsInParallel",
+        cascadedSerial, cascadedParallel );
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
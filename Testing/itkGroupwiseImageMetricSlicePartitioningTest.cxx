@@ -0,0 +1,210 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkPCAMetric_F_multithreaded.h"
+#include "itkVarianceOverLastDimensionImageMetric.h"
+
+#include "itkAdvancedTranslationTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImage.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkStackTransform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test checks the groupwise metrics VarianceOverLastDimensionImageMetric
+// and PCAMetric with a StackTransform. In that case the multi-threaded
+// derivative is partitioned over the last dimension positions, when there
+// are at least as many positions as threads. The test compares the value
+// and the derivative
+// - single-threaded (the reference),
+// - multi-threaded, with fewer threads than positions, which partitions the
+//   positions over the threads, and
+// - multi-threaded, with more threads than positions, which partitions the
+//   samples over the threads.
+
+namespace
+{
+
+const unsigned int Dimension         = 3;
+const unsigned int NumberOfPositions = 6;
+typedef float                                                  PixelType;
+typedef itk::Image< PixelType, Dimension >                     ImageType;
+typedef itk::StackTransform< double, Dimension, Dimension >    TransformType;
+typedef itk::AdvancedTranslationTransform< double, Dimension - 1 > SubTransformType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, double, double >                                  InterpolatorType;
+typedef itk::ImageFullSampler< ImageType >                     SamplerType;
+typedef TransformType::ParametersType                          ParametersType;
+
+/** Create a 2D+t image: a Gaussian blob that moves over time, plus noise. */
+ImageType::Pointer
+CreateImage( void )
+{
+  ImageType::SizeType size;
+  size[ 0 ] = 24; size[ 1 ] = 20; size[ 2 ] = NumberOfPositions;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 12345 );
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               x     = index[ 0 ] - 11.0 - 0.7 * index[ 2 ];
+    const double               y     = index[ 1 ] - 9.0 + 0.4 * index[ 2 ];
+    const double               value = 100.0 * std::exp( -( x * x + y * y ) / 30.0 )
+      + randomNum->GetUniformVariate( 0.0, 5.0 );
+    it.Set( static_cast< PixelType >( value ) );
+  }
+  return image;
+}
+
+
+bool
+AreEqual( const double a, const double b, const double tolerance )
+{
+  return std::abs( a - b ) <= tolerance * std::max( 1.0, std::max( std::abs( a ), std::abs( b ) ) );
+}
+
+
+template< class TMetric >
+void
+ComputeValueAndDerivative( const ImageType * image, const bool useMultiThread,
+  const unsigned int numberOfWorkUnits, double & value,
+  typename TMetric::DerivativeType & derivative )
+{
+  /** A stack of translations, one per position. */
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetNumberOfSubTransforms( NumberOfPositions );
+  transform->SetStackOrigin( 0.0 );
+  transform->SetStackSpacing( 1.0 );
+  transform->SetAllSubTransforms( SubTransformType::New() );
+
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = 0.1 * std::sin( 1.3 * i );
+  }
+
+  /** Sample the first position; the metrics expand the samples over the
+   * last dimension themselves.
+   */
+  ImageType::RegionType sampleRegion = image->GetLargestPossibleRegion();
+  sampleRegion.SetSize( Dimension - 1, 1 );
+  SamplerType::Pointer sampler = SamplerType::New();
+  sampler->SetInput( image );
+  sampler->SetInputImageRegion( sampleRegion );
+
+  typename TMetric::Pointer metric = TMetric::New();
+  metric->SetFixedImage( image );
+  metric->SetFixedImageRegion( image->GetBufferedRegion() );
+  metric->SetMovingImage( image );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( InterpolatorType::New() );
+  metric->SetImageSampler( sampler );
+  metric->SetSubtractMean( true );
+  metric->SetTransformIsStackTransform( true );
+  metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+  metric->SetUseMultiThread( useMultiThread );
+  metric->Initialize();
+
+  /** Evaluate twice, to check that the derivative is reset. */
+  metric->GetValueAndDerivative( parameters, value, derivative );
+  metric->GetValueAndDerivative( parameters, value, derivative );
+}
+
+
+template< class TMetric >
+bool
+TestMetric( const char * name, const ImageType * image )
+{
+  const char * settingNames[ 3 ] = {
+    "single-threaded", "multi-threaded, partitioned over positions", "multi-threaded, partitioned over samples" };
+  double                           values[ 3 ];
+  typename TMetric::DerivativeType derivatives[ 3 ];
+  ComputeValueAndDerivative< TMetric >( image, false, 1, values[ 0 ], derivatives[ 0 ] );
+  ComputeValueAndDerivative< TMetric >( image, true, NumberOfPositions / 2, values[ 1 ], derivatives[ 1 ] );
+  ComputeValueAndDerivative< TMetric >( image, true, NumberOfPositions + 2, values[ 2 ], derivatives[ 2 ] );
+
+  std::cerr << name << ": value = " << values[ 0 ] << ", derivative = " << derivatives[ 0 ] << std::endl;
+
+  bool         success   = true;
+  const double tolerance = 1e-6;
+  const double scale     = std::max( derivatives[ 0 ].inf_norm(), 1e-12 );
+  for( unsigned int s = 1; s < 3; ++s )
+  {
+    if( !AreEqual( values[ s ], values[ 0 ], tolerance ) )
+    {
+      std::cerr << "ERROR: " << name << ": value " << values[ s ] << " (" << settingNames[ s ]
+                << ") differs from " << values[ 0 ] << " (" << settingNames[ 0 ] << ")" << std::endl;
+      success = false;
+    }
+    for( unsigned int i = 0; i < derivatives[ s ].GetSize(); ++i )
+    {
+      if( std::abs( derivatives[ s ][ i ] - derivatives[ 0 ][ i ] ) > tolerance * scale )
+      {
+        std::cerr << "ERROR: " << name << ": derivative " << i << " = " << derivatives[ s ][ i ]
+                  << " (" << settingNames[ s ] << ") differs from " << derivatives[ 0 ][ i ]
+                  << " (" << settingNames[ 0 ] << ")" << std::endl;
+        success = false;
+      }
+    }
+  }
+  return success;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    ImageType::Pointer image = CreateImage();
+    success &= TestMetric< itk::VarianceOverLastDimensionImageMetric< ImageType, ImageType > >(
+      "VarianceOverLastDimension", image );
+    success &= TestMetric< itk::PCAMetric< ImageType, ImageType > >( "PCAMetric", image );
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
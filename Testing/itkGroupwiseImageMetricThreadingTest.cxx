@@ -0,0 +1,201 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkPCAMetric2.h"
+#include "itkSumOfPairwiseCorrelationCoefficientsMetric.h"
+#include "itkVarianceOverLastDimensionImageMetric.h"
+
+#include "itkAdvancedTranslationTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImage.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test checks that the groupwise metrics PCAMetric2,
+// SumOfPairwiseCorrelationCoefficientsMetric and
+// VarianceOverLastDimensionImageMetric give the same value and derivative
+// - single-threaded, with one work unit,
+// - single-threaded, with the samples partitioned over four work units, and
+// - multi-threaded, with four threads.
+// The last two use the same partitioning and should be equal up to the order
+// of the accumulation; the first checks that combining the partial results
+// of the threads gives the result of a single pass over all samples.
+
+namespace
+{
+
+const unsigned int Dimension = 3;
+typedef float                                                PixelType;
+typedef itk::Image< PixelType, Dimension >                   ImageType;
+typedef itk::AdvancedTranslationTransform< double, Dimension > TransformType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, double, double >                                InterpolatorType;
+typedef itk::ImageFullSampler< ImageType >                   SamplerType;
+typedef TransformType::ParametersType                        ParametersType;
+
+/** Create a 2D+t image: a Gaussian blob that moves over time, plus noise. */
+ImageType::Pointer
+CreateImage( void )
+{
+  ImageType::SizeType size;
+  size[ 0 ] = 24; size[ 1 ] = 20; size[ 2 ] = 6;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 12345 );
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               x     = index[ 0 ] - 11.0 - 0.7 * index[ 2 ];
+    const double               y     = index[ 1 ] - 9.0 + 0.4 * index[ 2 ];
+    const double               value = 100.0 * std::exp( -( x * x + y * y ) / 30.0 )
+      + randomNum->GetUniformVariate( 0.0, 5.0 );
+    it.Set( static_cast< PixelType >( value ) );
+  }
+  return image;
+}
+
+
+bool
+AreEqual( const double a, const double b, const double tolerance )
+{
+  return std::abs( a - b ) <= tolerance * std::max( 1.0, std::max( std::abs( a ), std::abs( b ) ) );
+}
+
+
+template< class TMetric >
+void
+ComputeValueAndDerivative( const ImageType * image, const bool useMultiThread,
+  const unsigned int numberOfWorkUnits, double & value,
+  typename TMetric::DerivativeType & derivative )
+{
+  ParametersType parameters( TransformType::SpaceDimension );
+  parameters[ 0 ] = 0.3;
+  parameters[ 1 ] = -0.2;
+  parameters[ 2 ] = 0.0;
+
+  TransformType::Pointer transform = TransformType::New();
+
+  SamplerType::Pointer sampler = SamplerType::New();
+  sampler->SetInput( image );
+
+  typename TMetric::Pointer metric = TMetric::New();
+  metric->SetFixedImage( image );
+  metric->SetFixedImageRegion( image->GetBufferedRegion() );
+  metric->SetMovingImage( image );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( InterpolatorType::New() );
+  metric->SetImageSampler( sampler );
+  metric->SetSubtractMean( false );
+  metric->SetTransformIsStackTransform( false );
+  metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+  metric->SetUseMultiThread( useMultiThread );
+  metric->Initialize();
+
+  /** Evaluate twice, to check that the per-thread variables are reset. */
+  metric->GetValueAndDerivative( parameters, value, derivative );
+  metric->GetValueAndDerivative( parameters, value, derivative );
+  if( !AreEqual( metric->GetValue( parameters ), value, 1e-12 ) )
+  {
+    itkGenericExceptionMacro( << "GetValue() differs from GetValueAndDerivative()" );
+  }
+}
+
+
+template< class TMetric >
+bool
+TestMetric( const char * name, const ImageType * image )
+{
+  const char * settingNames[ 3 ] = {
+    "single-threaded, 1 work unit", "single-threaded, 4 work units", "multi-threaded, 4 work units" };
+  double                            values[ 3 ];
+  typename TMetric::DerivativeType derivatives[ 3 ];
+  ComputeValueAndDerivative< TMetric >( image, false, 1, values[ 0 ], derivatives[ 0 ] );
+  ComputeValueAndDerivative< TMetric >( image, false, 4, values[ 1 ], derivatives[ 1 ] );
+  ComputeValueAndDerivative< TMetric >( image, true, 4, values[ 2 ], derivatives[ 2 ] );
+
+  std::cerr << name << ": value = " << values[ 0 ] << ", derivative = " << derivatives[ 0 ] << std::endl;
+
+  bool success = true;
+  for( unsigned int s = 1; s < 3; ++s )
+  {
+    const double tolerance = ( s == 1 ) ? 1e-6 : 1e-12;
+    if( !AreEqual( values[ s ], values[ s - 1 ], tolerance ) )
+    {
+      std::cerr << "ERROR: " << name << ": value " << values[ s ] << " (" << settingNames[ s ]
+                << ") differs from " << values[ s - 1 ] << " (" << settingNames[ s - 1 ] << ")" << std::endl;
+      success = false;
+    }
+    const double scale = std::max( derivatives[ s - 1 ].inf_norm(), 1e-12 );
+    for( unsigned int i = 0; i < derivatives[ s ].GetSize(); ++i )
+    {
+      if( std::abs( derivatives[ s ][ i ] - derivatives[ s - 1 ][ i ] ) > tolerance * scale )
+      {
+        std::cerr << "ERROR: " << name << ": derivative " << i << " = " << derivatives[ s ][ i ]
+                  << " (" << settingNames[ s ] << ") differs from " << derivatives[ s - 1 ][ i ]
+                  << " (" << settingNames[ s - 1 ] << ")" << std::endl;
+        success = false;
+      }
+    }
+  }
+  return success;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    ImageType::Pointer image = CreateImage();
+    success &= TestMetric< itk::PCAMetric2< ImageType, ImageType > >( "PCAMetric2", image );
+    success &= TestMetric< itk::SumOfPairwiseCorrelationCoefficientsMetric< ImageType, ImageType > >(
+      "SumOfPairwiseCorrelationCoefficients", image );
+    success &= TestMetric< itk::VarianceOverLastDimensionImageMetric< ImageType, ImageType > >(
+      "VarianceOverLastDimension", image );
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,304 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkListSampleCArray.h"
+#include "itkANNkDTree.h"
+#include "itkANNBruteForceTree.h"
+#include "itkANNStandardTreeSearch.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+#include "itkTimeProbesCollectorBase.h"
+
+// Multi-threading using ITK threads
+#include "itkPlatformMultiThreader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Compares the construction and the k-NN queries of the kD-tree with the
+// brute force search, and the multi-threaded kD-tree queries and tree
+// construction with the single-threaded ones, as done in the
+// KNNGraphAlphaMutualInformationImageToImageMetric.
+
+typedef itk::Array< double >                                                MeasurementVectorType;
+typedef itk::Statistics::ListSampleCArray< MeasurementVectorType, double > ListSampleType;
+typedef itk::BinaryTreeBase< ListSampleType >                               BinaryTreeType;
+typedef itk::ANNkDTree< ListSampleType >                                    ANNkDTreeType;
+typedef itk::ANNBruteForceTree< ListSampleType >                            ANNBruteForceTreeType;
+typedef itk::ANNStandardTreeSearch< ListSampleType >                        ANNStandardTreeSearchType;
+typedef ANNStandardTreeSearchType::IndexArrayType                           IndexArrayType;
+typedef ANNStandardTreeSearchType::DistanceArrayType                        DistanceArrayType;
+typedef itk::PlatformMultiThreader                                          ThreaderType;
+typedef ThreaderType::WorkUnitInfo                                          ThreadInfoType;
+
+/** Data shared with the threads. */
+struct ThreaderParameterType
+{
+  ANNStandardTreeSearchType *     st_Searcher;
+  ListSampleType *                st_Queries;
+  unsigned int                    st_K;
+  std::vector< double > *         st_Distances;
+  std::vector< BinaryTreeType * > st_Trees;
+};
+
+/** Let each thread search the neighbours of a contiguous range of query points. */
+itk::ITK_THREAD_RETURN_TYPE
+SearchThreaderCallback( void * arg )
+{
+  ThreadInfoType *        infoStruct  = static_cast< ThreadInfoType * >( arg );
+  const unsigned int      threadId    = infoStruct->WorkUnitID;
+  const unsigned int      nrOfThreads = infoStruct->NumberOfWorkUnits;
+  ThreaderParameterType * temp        = static_cast< ThreaderParameterType * >( infoStruct->UserData );
+
+  const unsigned long numberOfQueries = temp->st_Queries->GetActualSize();
+  const unsigned long nrOfQueriesPerThread
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( numberOfQueries )
+    / static_cast< double >( nrOfThreads ) ) );
+  unsigned long pos_begin = nrOfQueriesPerThread * threadId;
+  unsigned long pos_end   = nrOfQueriesPerThread * ( threadId + 1 );
+  pos_begin = ( pos_begin > numberOfQueries ) ? numberOfQueries : pos_begin;
+  pos_end   = ( pos_end > numberOfQueries ) ? numberOfQueries : pos_end;
+
+  MeasurementVectorType z;
+  IndexArrayType        indices;
+  DistanceArrayType     distances;
+  for( unsigned long i = pos_begin; i < pos_end; ++i )
+  {
+    temp->st_Queries->GetMeasurementVector( i, z );
+    temp->st_Searcher->Search( z, indices, distances );
+    for( unsigned int p = 0; p < temp->st_K; ++p )
+    {
+      ( *temp->st_Distances )[ i * temp->st_K + p ] = distances[ p ];
+    }
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end SearchThreaderCallback()
+
+
+/** Let thread t generate the trees t, t + T, t + 2T, ... */
+itk::ITK_THREAD_RETURN_TYPE
+GenerateTreesThreaderCallback( void * arg )
+{
+  ThreadInfoType *        infoStruct  = static_cast< ThreadInfoType * >( arg );
+  const unsigned int      threadId    = infoStruct->WorkUnitID;
+  const unsigned int      nrOfThreads = infoStruct->NumberOfWorkUnits;
+  ThreaderParameterType * temp        = static_cast< ThreaderParameterType * >( infoStruct->UserData );
+
+  for( std::size_t i = threadId; i < temp->st_Trees.size(); i += nrOfThreads )
+  {
+    temp->st_Trees[ i ]->GenerateTree();
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GenerateTreesThreaderCallback()
+
+
+/** Search the neighbours of all query points in a single thread. */
+void
+SearchSingleThreaded( ThreaderParameterType & parameters )
+{
+  MeasurementVectorType z;
+  IndexArrayType        indices;
+  DistanceArrayType     distances;
+  for( unsigned long i = 0; i < parameters.st_Queries->GetActualSize(); ++i )
+  {
+    parameters.st_Queries->GetMeasurementVector( i, z );
+    parameters.st_Searcher->Search( z, indices, distances );
+    for( unsigned int p = 0; p < parameters.st_K; ++p )
+    {
+      ( *parameters.st_Distances )[ i * parameters.st_K + p ] = distances[ p ];
+    }
+  }
+
+} // end SearchSingleThreaded()
+
+
+/** Create a list sample with uniformly distributed random points. */
+ListSampleType::Pointer
+CreateRandomListSample( const unsigned long n, const unsigned int dim )
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+
+  ListSampleType::Pointer listSample = ListSampleType::New();
+  listSample->SetMeasurementVectorSize( dim );
+  listSample->Resize( n );
+  for( unsigned long i = 0; i < n; ++i )
+  {
+    for( unsigned int d = 0; d < dim; ++d )
+    {
+      listSample->SetMeasurement( i, d, randomGenerator->GetUniformVariate( 0.0, 100.0 ) );
+    }
+  }
+  listSample->SetActualSize( n );
+
+  return listSample;
+
+} // end CreateRandomListSample()
+
+
+/** Return the largest absolute difference between two sets of distances. */
+double
+MaximumDifference( const std::vector< double > & a, const std::vector< double > & b )
+{
+  double maxDiff = 0.0;
+  for( std::size_t i = 0; i < a.size(); ++i )
+  {
+    maxDiff = std::max( maxDiff, std::abs( a[ i ] - b[ i ] ) );
+  }
+  return maxDiff;
+
+} // end MaximumDifference()
+
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  std::cerr << std::fixed << std::showpoint << std::setprecision( 8 );
+
+  /** Test parameters, similar to a registration with two 1D features. */
+  const unsigned int  dim             = 2;
+  const unsigned int  k               = 5;
+  const unsigned long numberOfQueries = 2000;
+  std::vector< unsigned long > numberOfPoints;
+  numberOfPoints.push_back( 1000 );
+  numberOfPoints.push_back( 5000 );
+  numberOfPoints.push_back( 20000 );
+
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::GetInstance()->SetSeed( 1 );
+
+  ThreaderType::Pointer threader = ThreaderType::New();
+  std::cerr << "Number of threads = " << threader->GetNumberOfWorkUnits() << "\n" << std::endl;
+
+  for( unsigned int s = 0; s < numberOfPoints.size(); ++s )
+  {
+    const unsigned long n = numberOfPoints[ s ];
+    std::cerr << "Number of points = " << n << std::endl;
+
+    itk::TimeProbesCollectorBase timeCollector;
+
+    ListSampleType::Pointer points  = CreateRandomListSample( n, dim );
+    ListSampleType::Pointer queries = CreateRandomListSample( numberOfQueries, dim );
+
+    /** Generate the trees. */
+    ANNkDTreeType::Pointer kDTree = ANNkDTreeType::New();
+    kDTree->SetBucketSize( 5 );
+    kDTree->SetSplittingRule( "ANN_KD_SL_MIDPT" );
+    kDTree->SetSample( points );
+    timeCollector.Start( "kD-tree build" );
+    kDTree->GenerateTree();
+    timeCollector.Stop( "kD-tree build" );
+
+    ANNBruteForceTreeType::Pointer bruteForceTree = ANNBruteForceTreeType::New();
+    bruteForceTree->SetSample( points );
+    timeCollector.Start( "brute force build" );
+    bruteForceTree->GenerateTree();
+    timeCollector.Stop( "brute force build" );
+
+    ANNStandardTreeSearchType::Pointer kDSearcher = ANNStandardTreeSearchType::New();
+    kDSearcher->SetKNearestNeighbors( k );
+    kDSearcher->SetErrorBound( 0.0 );
+    kDSearcher->SetBinaryTree( kDTree );
+
+    ANNStandardTreeSearchType::Pointer bruteForceSearcher = ANNStandardTreeSearchType::New();
+    bruteForceSearcher->SetKNearestNeighbors( k );
+    bruteForceSearcher->SetErrorBound( 0.0 );
+    bruteForceSearcher->SetBinaryTree( bruteForceTree );
+
+    /** Query the trees. */
+    std::vector< double > distancesBruteForce( numberOfQueries * k );
+    std::vector< double > distancesSingleThreaded( numberOfQueries * k );
+    std::vector< double > distancesMultiThreaded( numberOfQueries * k );
+
+    ThreaderParameterType parameters;
+    parameters.st_Queries = queries.GetPointer();
+    parameters.st_K       = k;
+
+    parameters.st_Searcher  = bruteForceSearcher.GetPointer();
+    parameters.st_Distances = &distancesBruteForce;
+    timeCollector.Start( "brute force query (st)" );
+    SearchSingleThreaded( parameters );
+    timeCollector.Stop( "brute force query (st)" );
+
+    parameters.st_Searcher  = kDSearcher.GetPointer();
+    parameters.st_Distances = &distancesSingleThreaded;
+    timeCollector.Start( "kD-tree query (st)" );
+    SearchSingleThreaded( parameters );
+    timeCollector.Stop( "kD-tree query (st)" );
+
+    parameters.st_Distances = &distancesMultiThreaded;
+    threader->SetSingleMethod( SearchThreaderCallback, &parameters );
+    timeCollector.Start( "kD-tree query (mt)" );
+    threader->SingleMethodExecute();
+    timeCollector.Stop( "kD-tree query (mt)" );
+
+    /** Generate a fixed, moving and joint tree concurrently, and query one. */
+    ListSampleType::Pointer points2 = CreateRandomListSample( n, dim );
+    ListSampleType::Pointer points3 = CreateRandomListSample( n, dim );
+    ANNkDTreeType::Pointer  tree1   = ANNkDTreeType::New();
+    ANNkDTreeType::Pointer  tree2   = ANNkDTreeType::New();
+    ANNkDTreeType::Pointer  tree3   = ANNkDTreeType::New();
+    tree1->SetSample( points );
+    tree2->SetSample( points2 );
+    tree3->SetSample( points3 );
+    parameters.st_Trees.push_back( tree1.GetPointer() );
+    parameters.st_Trees.push_back( tree2.GetPointer() );
+    parameters.st_Trees.push_back( tree3.GetPointer() );
+
+    threader->SetSingleMethod( GenerateTreesThreaderCallback, &parameters );
+    timeCollector.Start( "3 kD-trees build (mt)" );
+    threader->SingleMethodExecute();
+    timeCollector.Stop( "3 kD-trees build (mt)" );
+
+    std::vector< double > distancesConcurrentTree( numberOfQueries * k );
+    kDSearcher->SetBinaryTree( tree1 );
+    parameters.st_Distances = &distancesConcurrentTree;
+    SearchSingleThreaded( parameters );
+
+    /** Report timings for this number of points. */
+    timeCollector.Report();
+    std::cerr << std::endl;
+
+    /** Check the results. */
+    const double diffBruteForce     = MaximumDifference( distancesBruteForce, distancesSingleThreaded );
+    const double diffMultiThreaded  = MaximumDifference( distancesSingleThreaded, distancesMultiThreaded );
+    const double diffConcurrentTree = MaximumDifference( distancesSingleThreaded, distancesConcurrentTree );
+    std::cerr << "max |kD-tree - brute force|            = " << diffBruteForce << std::endl;
+    std::cerr << "max |kD-tree (st) - kD-tree (mt)|      = " << diffMultiThreaded << std::endl;
+    std::cerr << "max |kD-tree - concurrently built tree| = " << diffConcurrentTree << "\n" << std::endl;
+
+    if( diffBruteForce > 1e-10 || diffMultiThreaded != 0.0 || diffConcurrentTree != 0.0 )
+    {
+      std::cerr << "ERROR: the kD-tree results differ." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  } // end loop over number of points
+
+  return EXIT_SUCCESS;
+
+} // end main
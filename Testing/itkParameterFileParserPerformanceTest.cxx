@@ -0,0 +1,165 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkParameterFileParser.h"
+#include "itkParameterMapInterface.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+
+#include <itksys/SystemTools.hxx>
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test writes a transform parameter file similar to the ones written
+// by elastix for a 3D B-spline transform, and compares reading it in two ways:
+// 1) the text path: all values are stored as strings in the parameter map,
+//    and converted one by one with ParameterMapInterface::ReadParameter();
+// 2) the numeric path: the TransformParameters are parsed directly into a
+//    numeric buffer, which is copied at once.
+
+int
+main( int argc, char * argv[] )
+{
+  /** The number of control points in each dimension. Distinguish between
+   * Debug and Release mode.
+   */
+#ifndef NDEBUG
+  unsigned int gridSize = 20;
+#else
+  unsigned int gridSize = 80;
+#endif
+  if( argc > 1 )
+  {
+    gridSize = static_cast< unsigned int >( atoi( argv[ 1 ] ) );
+  }
+  const unsigned int Dimension          = 3;
+  const unsigned int numberOfParameters = Dimension * gridSize * gridSize * gridSize;
+  std::cerr << "Grid size = " << gridSize
+            << ", number of parameters = " << numberOfParameters << std::endl;
+
+  /** Write the transform parameter file. */
+  const std::string fileName = "ParameterFileParserPerformanceTest.txt";
+  std::vector< double > groundTruth( numberOfParameters );
+  {
+    std::ofstream file( fileName.c_str() );
+    file << "(Transform \"BSplineTransform\")\n";
+    file << "(NumberOfParameters " << numberOfParameters << ")\n";
+    file << "(TransformParameters";
+    file << std::setprecision( 10 );
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
+    {
+      groundTruth[ i ] = 5.0 * std::sin( 0.001 * i ) - 1.0e-4 * ( i % 7 );
+      file << " " << groundTruth[ i ];
+    }
+    file << ")\n";
+    file << "(InitialTransformParametersFileName \"NoInitialTransform\")\n";
+    file << "(GridSize " << gridSize << " " << gridSize << " " << gridSize << ")\n";
+    file << "(GridSpacing 10.0000000000 10.0000000000 10.0000000000)\n";
+    file << "(BSplineTransformSplineOrder 3)\n";
+  }
+
+  typedef itk::ParameterFileParser   ParserType;
+  typedef itk::ParameterMapInterface InterfaceType;
+  std::vector< double > textResult( numberOfParameters, 0.0 );
+  std::vector< double > numericResult( numberOfParameters, 0.0 );
+  std::string           errorMessage;
+
+  /** Text path. */
+  itk::TimeProbe textParseTimer, textConvertTimer;
+  {
+    ParserType::Pointer parser = ParserType::New();
+    parser->SetParameterFileName( fileName );
+    parser->SetLargeParameterThreshold( 0 );
+    textParseTimer.Start();
+    parser->ReadParameterFile();
+    textParseTimer.Stop();
+
+    InterfaceType::Pointer parameterMapInterface = InterfaceType::New();
+    textConvertTimer.Start();
+    parameterMapInterface->SetParameterMap( parser->GetParameterMap() );
+    parameterMapInterface->ReadParameter( textResult, "TransformParameters",
+      0, numberOfParameters - 1, true, errorMessage );
+    textConvertTimer.Stop();
+  }
+
+  /** Numeric path. */
+  itk::TimeProbe numericParseTimer, numericConvertTimer;
+  {
+    ParserType::Pointer parser = ParserType::New();
+    parser->SetParameterFileName( fileName );
+    numericParseTimer.Start();
+    parser->ReadParameterFile();
+    numericParseTimer.Stop();
+
+    InterfaceType::Pointer parameterMapInterface = InterfaceType::New();
+    numericConvertTimer.Start();
+    parameterMapInterface->SetParameterMap( parser->GetTextParameterMap() );
+    parameterMapInterface->SetNumericParameterMap( parser->GetNumericParameterMap() );
+    InterfaceType::NumericParameterValuesPointer values
+      = parameterMapInterface->GetNumericParameterValues( "TransformParameters" );
+    if( values )
+    {
+      std::copy( values->begin(), values->end(), numericResult.begin() );
+    }
+    numericConvertTimer.Stop();
+
+    if( !values )
+    {
+      std::cerr << "ERROR: the TransformParameters were not stored as a numeric buffer."
+                << std::endl;
+      itksys::SystemTools::RemoveFile( fileName );
+      return EXIT_FAILURE;
+    }
+  }
+
+  itksys::SystemTools::RemoveFile( fileName );
+
+  /** Report timings. */
+  std::cerr << std::setprecision( 4 );
+  std::cerr << "Text path:    parsing " << textParseTimer.GetMean()
+            << " s, conversion " << textConvertTimer.GetMean() << " s" << std::endl;
+  std::cerr << "Numeric path: parsing " << numericParseTimer.GetMean()
+            << " s, conversion " << numericConvertTimer.GetMean() << " s" << std::endl;
+  std::cerr << "Speedup: "
+            << ( textParseTimer.GetMean() + textConvertTimer.GetMean() )
+    / ( numericParseTimer.GetMean() + numericConvertTimer.GetMean() )
+            << std::endl;
+
+  /** Check that both paths give the same values. */
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    const double tolerance = 1e-9 * ( 1.0 + std::abs( groundTruth[ i ] ) );
+    if( std::abs( textResult[ i ] - numericResult[ i ] ) > 1e-12 * ( 1.0 + std::abs( textResult[ i ] ) )
+      || std::abs( numericResult[ i ] - groundTruth[ i ] ) > tolerance )
+    {
+      std::cerr << "ERROR: parameter " << i << " differs: text = " << textResult[ i ]
+                << ", numeric = " << numericResult[ i ]
+                << ", written = " << groundTruth[ i ] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,340 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "itkParzenWindowNormalizedMutualInformationImageToImageMetric.h"
+
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImage.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRandomSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// This test checks the cache of the fixed Parzen window values of the
+// ParzenWindowHistogramImageToImageMetric, for ParzenWindowMutualInformation,
+// with and without explicit PDF derivatives, and for
+// ParzenWindowNormalizedMutualInformation. With
+// UsePrecomputedFixedImageMarginalPDF off, it checks that
+// - GetValue() and GetValueAndDerivative() give the same results with and
+//   without UseFixedParzenValuesCache, also at a position where part of the
+//   samples map outside the moving image,
+// - the cache is built for the full sampler, and not when it is switched
+//   off, and
+// - the cache is not built for a sampler that selects new samples.
+// With UsePrecomputedFixedImageMarginalPDF on, it checks that the value is
+// unchanged at a position where all samples map inside the moving image.
+// This is done with one and with several threads.
+
+namespace
+{
+
+const unsigned int Dimension = 2;
+typedef float                                        PixelType;
+typedef itk::Image< PixelType, Dimension >           ImageType;
+typedef itk::AdvancedCombinationTransform< double, Dimension >
+                                                     CombinationTransformType;
+typedef itk::AdvancedMatrixOffsetTransformBase< double, Dimension, Dimension >
+                                                     AffineTransformType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, double, double >                        InterpolatorType;
+typedef itk::ImageFullSampler< ImageType >           FullSamplerType;
+typedef itk::ImageRandomSampler< ImageType >         RandomSamplerType;
+typedef itk::ImageSamplerBase< ImageType >           SamplerBaseType;
+typedef CombinationTransformType::ParametersType     ParametersType;
+
+const unsigned int NumberOfPositions = 3;
+
+/** A metric that tells whether its fixed Parzen values cache is valid. */
+template< class TMetric >
+class InspectedMetric : public TMetric
+{
+public:
+
+  typedef InspectedMetric           Self;
+  typedef TMetric                   Superclass;
+  typedef itk::SmartPointer< Self > Pointer;
+
+  itkNewMacro( Self );
+
+  bool GetFixedParzenValuesCacheIsValid( void ) const
+  {
+    return this->m_FixedParzenValuesCacheIsValid;
+  }
+
+protected:
+
+  InspectedMetric() {}
+  ~InspectedMetric() override {}
+};
+
+/** Create an image with two Gaussian blobs, shifted by ( dx, dy ). */
+ImageType::Pointer
+CreateImage( const double dx, const double dy )
+{
+  ImageType::SizeType size;
+  size[ 0 ] = 40; size[ 1 ] = 36;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    const double x = it.GetIndex()[ 0 ] - dx;
+    const double y = it.GetIndex()[ 1 ] - dy;
+    const double r1 = ( x - 15.0 ) * ( x - 15.0 ) + ( y - 16.0 ) * ( y - 16.0 );
+    const double r2 = ( x - 26.0 ) * ( x - 26.0 ) + ( y - 20.0 ) * ( y - 20.0 );
+    it.Set( static_cast< PixelType >( 100.0 * std::exp( -r1 / 40.0 ) + 50.0 * std::exp( -r2 / 20.0 ) ) );
+  }
+  return image;
+}
+
+
+/** An affine transform, at positions around the identity. At the last
+ * position the translation is larger than the margin of the sample region,
+ * so that part of the samples map outside the moving image.
+ */
+CombinationTransformType::Pointer
+CreateAffineTransform( std::vector< ParametersType > & positions )
+{
+  AffineTransformType::Pointer        affine = AffineTransformType::New();
+  AffineTransformType::InputPointType center;
+  center[ 0 ] = 20.0; center[ 1 ] = 18.0;
+  affine->SetCenter( center );
+
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( affine );
+
+  positions.assign( NumberOfPositions, affine->GetParameters() );
+  for( unsigned int k = 0; k < NumberOfPositions; ++k )
+  {
+    positions[ k ][ 0 ] += 0.02 * k;
+    positions[ k ][ 1 ] -= 0.01 * k;
+    positions[ k ][ 2 ] += 0.015;
+    positions[ k ][ 3 ] -= 0.01 * k;
+    positions[ k ][ 4 ] += 0.5 + 0.3 * k;
+    positions[ k ][ 5 ] -= 0.7 * k;
+  }
+  positions[ NumberOfPositions - 1 ][ 4 ] += 8.0;
+  return transform;
+}
+
+
+bool
+AreEqual( const double a, const double b, const double scale )
+{
+  return std::abs( a - b ) <= 1e-10 * std::max( 1.0, scale );
+}
+
+
+/** Configure a metric, on its own transform, interpolator and sampler. */
+template< class TMetric >
+typename InspectedMetric< TMetric >::Pointer
+CreateMetric( const ImageType * fixedImage, const ImageType * movingImage,
+  SamplerBaseType * sampler, const bool explicitPDFDerivatives,
+  const bool useCache, const bool usePrecomputedMarginal,
+  const unsigned int numberOfWorkUnits, std::vector< ParametersType > & positions )
+{
+  typename InspectedMetric< TMetric >::Pointer metric = InspectedMetric< TMetric >::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+  metric->SetMovingImage( movingImage );
+  metric->SetTransform( CreateAffineTransform( positions ) );
+  metric->SetInterpolator( InterpolatorType::New() );
+  metric->SetImageSampler( sampler );
+  metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+  metric->SetUseMultiThread( numberOfWorkUnits > 1 );
+  metric->SetNumberOfFixedHistogramBins( 24 );
+  metric->SetNumberOfMovingHistogramBins( 24 );
+  metric->SetFixedKernelBSplineOrder( 3 );
+  metric->SetMovingKernelBSplineOrder( 3 );
+  metric->SetUseDerivative( true );
+  metric->SetUseExplicitPDFDerivatives( explicitPDFDerivatives );
+  metric->SetUseFixedParzenValuesCache( useCache );
+  metric->SetUsePrecomputedFixedImageMarginalPDF( usePrecomputedMarginal );
+  metric->Initialize();
+  return metric;
+}
+
+
+template< class TMetric >
+bool
+TestMetric( const char * name, const bool explicitPDFDerivatives,
+  const unsigned int numberOfWorkUnits )
+{
+  typedef InspectedMetric< TMetric >          MetricType;
+  typedef typename MetricType::MeasureType    MeasureType;
+  typedef typename MetricType::DerivativeType DerivativeType;
+
+  ImageType::Pointer fixedImage  = CreateImage( 0.0, 0.0 );
+  ImageType::Pointer movingImage = CreateImage( 1.3, -0.8 );
+
+  /** Sample the centre of the fixed image. */
+  ImageType::RegionType sampleRegion = fixedImage->GetLargestPossibleRegion();
+  sampleRegion.SetIndex( 0, 6 ); sampleRegion.SetIndex( 1, 5 );
+  sampleRegion.SetSize( 0, 28 ); sampleRegion.SetSize( 1, 26 );
+  FullSamplerType::Pointer sampler = FullSamplerType::New();
+  sampler->SetInput( fixedImage );
+  sampler->SetInputImageRegion( sampleRegion );
+
+  std::vector< ParametersType > positions;
+  typename MetricType::Pointer  uncached = CreateMetric< TMetric >( fixedImage, movingImage,
+    sampler, explicitPDFDerivatives, false, false, numberOfWorkUnits, positions );
+  typename MetricType::Pointer cached = CreateMetric< TMetric >( fixedImage, movingImage,
+    sampler, explicitPDFDerivatives, true, false, numberOfWorkUnits, positions );
+  typename MetricType::Pointer precomputed = CreateMetric< TMetric >( fixedImage, movingImage,
+    sampler, explicitPDFDerivatives, true, true, numberOfWorkUnits, positions );
+
+  const std::string settings = std::string( name )
+    + ( explicitPDFDerivatives ? ", explicit PDF derivatives" : "" )
+    + ( numberOfWorkUnits > 1 ? ", multi-threaded" : ", single-threaded" );
+  bool success = true;
+
+  for( unsigned int k = 0; k < NumberOfPositions; ++k )
+  {
+    const MeasureType referenceValue = uncached->GetValue( positions[ k ] );
+    MeasureType       referenceValueAndDerivative = 0.0;
+    DerivativeType    referenceDerivative;
+    uncached->GetValueAndDerivative( positions[ k ], referenceValueAndDerivative, referenceDerivative );
+
+    const MeasureType value = cached->GetValue( positions[ k ] );
+    MeasureType       valueAndDerivative = 0.0;
+    DerivativeType    derivative;
+    cached->GetValueAndDerivative( positions[ k ], valueAndDerivative, derivative );
+
+    const double scale = referenceDerivative.inf_norm();
+    std::cerr << settings << ": position " << k << ": value " << referenceValue
+              << ", largest derivative " << scale << std::endl;
+    if( !AreEqual( value, referenceValue, std::abs( referenceValue ) )
+      || !AreEqual( valueAndDerivative, referenceValueAndDerivative, std::abs( referenceValue ) ) )
+    {
+      std::cerr << "ERROR: " << settings << ": the cached value at position " << k << " is "
+                << value << " (GetValue) and " << valueAndDerivative
+                << " (GetValueAndDerivative), expected " << referenceValue << " and "
+                << referenceValueAndDerivative << std::endl;
+      success = false;
+    }
+    if( derivative.GetSize() != referenceDerivative.GetSize() )
+    {
+      std::cerr << "ERROR: " << settings << ": the cached derivative at position " << k
+                << " has the wrong size." << std::endl;
+      success = false;
+      continue;
+    }
+    for( unsigned int i = 0; i < derivative.GetSize(); ++i )
+    {
+      if( !AreEqual( derivative[ i ], referenceDerivative[ i ], scale ) )
+      {
+        std::cerr << "ERROR: " << settings << ": cached derivative " << i << " at position " << k
+                  << " is " << derivative[ i ] << ", expected " << referenceDerivative[ i ] << std::endl;
+        success = false;
+      }
+    }
+  }
+
+  /** The cache is only used when it is switched on. */
+  if( !cached->GetFixedParzenValuesCacheIsValid() )
+  {
+    std::cerr << "ERROR: " << settings << ": the cache was not built." << std::endl;
+    success = false;
+  }
+  if( uncached->GetFixedParzenValuesCacheIsValid() )
+  {
+    std::cerr << "ERROR: " << settings << ": the cache was built while switched off." << std::endl;
+    success = false;
+  }
+
+  /** The precomputed marginal equals the marginal of the joint histogram
+   * as long as all samples map inside the moving image.
+   */
+  const MeasureType precomputedValue = precomputed->GetValue( positions[ 0 ] );
+  const MeasureType referenceValue   = uncached->GetValue( positions[ 0 ] );
+  if( !AreEqual( precomputedValue, referenceValue, std::abs( referenceValue ) ) )
+  {
+    std::cerr << "ERROR: " << settings << ": the value with the precomputed fixed marginal is "
+              << precomputedValue << ", expected " << referenceValue << std::endl;
+    success = false;
+  }
+
+  /** A sampler that selects new samples on every update is not cached. */
+  RandomSamplerType::Pointer randomSampler = RandomSamplerType::New();
+  randomSampler->SetInput( fixedImage );
+  randomSampler->SetInputImageRegion( sampleRegion );
+  randomSampler->SetNumberOfSamples( 200 );
+  typename MetricType::Pointer random = CreateMetric< TMetric >( fixedImage, movingImage,
+    randomSampler, explicitPDFDerivatives, true, false, numberOfWorkUnits, positions );
+  random->GetValue( positions[ 0 ] );
+  if( random->GetFixedParzenValuesCacheIsValid() )
+  {
+    std::cerr << "ERROR: " << settings << ": the cache was built for a random sampler." << std::endl;
+    success = false;
+  }
+
+  return success;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric< ImageType, ImageType >
+    MutualInformationType;
+  typedef itk::ParzenWindowNormalizedMutualInformationImageToImageMetric< ImageType, ImageType >
+    NormalizedMutualInformationType;
+
+  bool success = true;
+  try
+  {
+    const unsigned int workUnits[ 2 ] = { 1, 3 };
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      success &= TestMetric< MutualInformationType >( "ParzenWindowMutualInformation",
+        true, workUnits[ t ] );
+      success &= TestMetric< MutualInformationType >( "ParzenWindowMutualInformation",
+        false, workUnits[ t ] );
+      success &= TestMetric< NormalizedMutualInformationType >(
+        "ParzenWindowNormalizedMutualInformation", true, workUnits[ t ] );
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
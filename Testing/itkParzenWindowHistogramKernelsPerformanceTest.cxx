@@ -0,0 +1,365 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkParzenWindowHistogramKernels.h"
+#include "itkBSplineKernelFunction2.h"
+#include "itkBSplineDerivativeKernelFunction2.h"
+#include "itkArray.h"
+#include "itkArray2D.h"
+#include "itkImage.h"
+#include "itkImageScanlineIterator.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// This test compares the kernels of the Parzen window mutual information
+// metric with the loops they replace: the Parzen window update of the joint
+// histogram, written with an ImageScanlineIterator, the PRatio weighted sum
+// of the derivative, written on an Array2D, and the accumulation of the joint
+// histograms of the threads. The moving kernel is a cubic B-spline and the
+// fixed kernel a zero order B-spline, as in the default settings of
+// AdvancedMattesMutualInformation. It reports the speedups for 32, 64 and
+// 128 histogram bins, and checks that the results are equal.
+
+namespace
+{
+
+typedef double                                     PDFValueType;
+typedef itk::Image< PDFValueType, 2 >              JointPDFType;
+typedef JointPDFType::RegionType                   JointPDFRegionType;
+typedef JointPDFType::IndexType                    JointPDFIndexType;
+typedef JointPDFType::SizeType                     JointPDFSizeType;
+typedef itk::Array< PDFValueType >                 ParzenValueContainerType;
+typedef itk::Array2D< PDFValueType >               PRatioArrayType;
+typedef itk::BSplineKernelFunction2< 0 >           FixedKernelType;
+typedef itk::BSplineKernelFunction2< 3 >           MovingKernelType;
+typedef itk::BSplineDerivativeKernelFunction2< 3 > DerivativeMovingKernelType;
+typedef itk::ParzenWindowHistogramKernels          KernelsType;
+
+/** The Parzen window of a sample: the lowest affected bins and the terms. */
+struct SampleType
+{
+  itk::OffsetValueType fixedIndex;
+  itk::OffsetValueType movingIndex;
+  double               fixedTerm;
+  double               movingTerm;
+};
+
+bool
+CheckArrays( const char * name, const PDFValueType * reference,
+  const PDFValueType * values, const itk::SizeValueType size )
+{
+  for( itk::SizeValueType i = 0; i < size; ++i )
+  {
+    if( std::abs( values[ i ] - reference[ i ] ) > 1e-9 * ( std::abs( reference[ i ] ) + 1.0 ) )
+    {
+      std::cerr << "ERROR: " << name << " differs at " << i << ": reference = "
+                << reference[ i ] << ", kernel = " << values[ i ] << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  /** The number of samples. Distinguish between Debug and Release mode. */
+#ifndef NDEBUG
+  unsigned int numberOfSamples = 20000;
+#else
+  unsigned int numberOfSamples = 1000000;
+#endif
+  if( argc > 1 )
+  {
+    numberOfSamples = static_cast< unsigned int >( atoi( argv[ 1 ] ) );
+  }
+  const unsigned int numberOfParameters = 12;
+  const unsigned int numberOfThreads    = 8;
+  const unsigned int fixedWindowSize    = 1;
+  const unsigned int movingWindowSize   = 4;
+  const double       et                 = 1.0;
+
+  FixedKernelType::Pointer            fixedKernel            = FixedKernelType::New();
+  MovingKernelType::Pointer           movingKernel           = MovingKernelType::New();
+  DerivativeMovingKernelType::Pointer derivativeMovingKernel = DerivativeMovingKernelType::New();
+
+  std::cerr << "Number of samples = " << numberOfSamples
+            << ", number of parameters = " << numberOfParameters << std::endl;
+
+  bool               success               = true;
+  const unsigned int numberOfBinsList[ 3 ] = { 32, 64, 128 };
+  for( unsigned int b = 0; b < 3; ++b )
+  {
+    const unsigned int       numberOfBins = numberOfBinsList[ b ];
+    const itk::SizeValueType jointPDFSize = numberOfBins * numberOfBins;
+
+    /** Create the samples; values are mapped to [2, numberOfBins - 3], as in
+     * the metric, which leaves room for the Parzen windows.
+     */
+    std::vector< SampleType > samples( numberOfSamples );
+    for( unsigned int s = 0; s < numberOfSamples; ++s )
+    {
+      const double range = numberOfBins - 5.0;
+      samples[ s ].fixedTerm   = 2.0 + range * ( 0.5 + 0.5 * std::sin( 0.37 * s ) );
+      samples[ s ].movingTerm  = 2.0 + range * ( 0.5 + 0.5 * std::sin( 0.11 * s + 1.0 ) );
+      samples[ s ].fixedIndex  = static_cast< itk::OffsetValueType >( std::floor( samples[ s ].fixedTerm + 0.5 ) );
+      samples[ s ].movingIndex = static_cast< itk::OffsetValueType >( std::floor( samples[ s ].movingTerm - 1.0 ) );
+    }
+
+    /** The joint histogram, as an image. */
+    JointPDFRegionType jointPDFRegion;
+    JointPDFSizeType   jointPDFRegionSize;
+    jointPDFRegionSize[ 0 ] = numberOfBins;
+    jointPDFRegionSize[ 1 ] = numberOfBins;
+    jointPDFRegion.SetSize( jointPDFRegionSize );
+    JointPDFType::Pointer jointPDF = JointPDFType::New();
+    jointPDF->SetRegions( jointPDFRegion );
+    jointPDF->Allocate();
+    jointPDF->FillBuffer( 0.0 );
+
+    JointPDFRegionType jointPDFWindow;
+    JointPDFSizeType   jointPDFWindowSize;
+    jointPDFWindowSize[ 0 ] = movingWindowSize;
+    jointPDFWindowSize[ 1 ] = fixedWindowSize;
+    jointPDFWindow.SetSize( jointPDFWindowSize );
+
+    /** Reference Parzen window update, with an iterator and heap allocated Parzen values. */
+    itk::TimeProbe referenceUpdateTimer;
+    referenceUpdateTimer.Start();
+    for( unsigned int s = 0; s < numberOfSamples; ++s )
+    {
+      const SampleType &       sample = samples[ s ];
+      ParzenValueContainerType fixedParzenValues( fixedWindowSize );
+      ParzenValueContainerType movingParzenValues( movingWindowSize );
+      fixedKernel->Evaluate( sample.fixedIndex - sample.fixedTerm, fixedParzenValues.data_block() );
+      movingKernel->Evaluate( sample.movingIndex - sample.movingTerm, movingParzenValues.data_block() );
+
+      JointPDFIndexType pdfWindowIndex;
+      pdfWindowIndex[ 0 ] = sample.movingIndex;
+      pdfWindowIndex[ 1 ] = sample.fixedIndex;
+      jointPDFWindow.SetIndex( pdfWindowIndex );
+      itk::ImageScanlineIterator< JointPDFType > it( jointPDF, jointPDFWindow );
+      for( unsigned int f = 0; f < fixedWindowSize; ++f )
+      {
+        const double fv = fixedParzenValues[ f ];
+        for( unsigned int m = 0; m < movingWindowSize; ++m )
+        {
+          it.Value() += fv * movingParzenValues[ m ];
+          ++it;
+        }
+        it.NextLine();
+      }
+    }
+    referenceUpdateTimer.Stop();
+
+    /** Parzen window update with the kernel, into a plain array. */
+    KernelsType::AlignedArrayType jointPDFArray( jointPDFSize, 0.0 );
+    itk::TimeProbe                kernelUpdateTimer;
+    kernelUpdateTimer.Start();
+    for( unsigned int s = 0; s < numberOfSamples; ++s )
+    {
+      const SampleType & sample = samples[ s ];
+      PDFValueType       fixedParzenValues[ KernelsType::MaximumWindowSize ];
+      PDFValueType       movingParzenValues[ KernelsType::MaximumWindowSize ];
+      fixedKernel->Evaluate( sample.fixedIndex - sample.fixedTerm, fixedParzenValues );
+      movingKernel->Evaluate( sample.movingIndex - sample.movingTerm, movingParzenValues );
+      KernelsType::UpdateJointPDF( jointPDFArray.data(), numberOfBins,
+        sample.fixedIndex, fixedParzenValues, fixedWindowSize,
+        sample.movingIndex, movingParzenValues, movingWindowSize );
+    }
+    kernelUpdateTimer.Stop();
+
+    success &= CheckArrays( "joint histogram", jointPDF->GetBufferPointer(),
+      jointPDFArray.data(), jointPDFSize );
+
+    /** A PRatio array with arbitrary values. */
+    PRatioArrayType pRatioArray( numberOfBins, numberOfBins );
+    for( unsigned int f = 0; f < numberOfBins; ++f )
+    {
+      for( unsigned int m = 0; m < numberOfBins; ++m )
+      {
+        pRatioArray[ f ][ m ] = std::cos( 0.1 * f + 0.03 * m );
+      }
+    }
+    ParzenValueContainerType imageJacobian( numberOfParameters );
+    for( unsigned int mu = 0; mu < numberOfParameters; ++mu )
+    {
+      imageJacobian[ mu ] = std::sin( 0.5 * mu + 0.1 );
+    }
+
+    /** Reference derivative, as the PRatio weighted sum on the Array2D. */
+    ParzenValueContainerType referenceDerivative( numberOfParameters );
+    referenceDerivative.Fill( 0.0 );
+    itk::TimeProbe referenceDerivativeTimer;
+    referenceDerivativeTimer.Start();
+    for( unsigned int s = 0; s < numberOfSamples; ++s )
+    {
+      const SampleType &       sample = samples[ s ];
+      ParzenValueContainerType fixedParzenValues( fixedWindowSize );
+      ParzenValueContainerType derivativeMovingParzenValues( movingWindowSize );
+      fixedKernel->Evaluate( sample.fixedIndex - sample.fixedTerm, fixedParzenValues.data_block() );
+      derivativeMovingKernel->Evaluate( sample.movingIndex - sample.movingTerm,
+        derivativeMovingParzenValues.data_block() );
+
+      PDFValueType sum = 0.0;
+      for( unsigned int f = 0; f < fixedWindowSize; ++f )
+      {
+        const double fv_et = fixedParzenValues[ f ] / et;
+        for( unsigned int m = 0; m < movingWindowSize; ++m )
+        {
+          sum += pRatioArray[ f + sample.fixedIndex ][ m + sample.movingIndex ]
+            * fv_et * derivativeMovingParzenValues[ m ];
+        }
+      }
+      for( unsigned int mu = 0; mu < numberOfParameters; ++mu )
+      {
+        referenceDerivative[ mu ] += imageJacobian[ mu ] * sum;
+      }
+    }
+    referenceDerivativeTimer.Stop();
+
+    /** Derivative with the kernels. */
+    ParzenValueContainerType derivative( numberOfParameters );
+    derivative.Fill( 0.0 );
+    itk::TimeProbe kernelDerivativeTimer;
+    kernelDerivativeTimer.Start();
+    for( unsigned int s = 0; s < numberOfSamples; ++s )
+    {
+      const SampleType & sample = samples[ s ];
+      PDFValueType       fixedParzenValues[ KernelsType::MaximumWindowSize ];
+      PDFValueType       derivativeMovingParzenValues[ KernelsType::MaximumWindowSize ];
+      fixedKernel->Evaluate( sample.fixedIndex - sample.fixedTerm, fixedParzenValues );
+      derivativeMovingKernel->Evaluate( sample.movingIndex - sample.movingTerm,
+        derivativeMovingParzenValues );
+
+      const PDFValueType sum = KernelsType::ComputePRatioWeightedSum(
+        pRatioArray.data_block(), numberOfBins,
+        sample.fixedIndex, fixedParzenValues, fixedWindowSize,
+        sample.movingIndex, derivativeMovingParzenValues, movingWindowSize ) / et;
+      KernelsType::AddScaledJacobian( derivative.data_block(),
+        imageJacobian.data_block(), numberOfParameters, sum );
+    }
+    kernelDerivativeTimer.Stop();
+
+    success &= CheckArrays( "derivative", referenceDerivative.data_block(),
+      derivative.data_block(), numberOfParameters );
+
+    /** Reference accumulation of the joint histograms of the threads, with iterators. */
+    typedef itk::ImageScanlineIterator< JointPDFType > JointPDFIteratorType;
+    std::vector< JointPDFType::Pointer >         threadJointPDFs( numberOfThreads );
+    std::vector< KernelsType::AlignedArrayType > threadJointPDFArrays( numberOfThreads );
+    std::vector< const PDFValueType * >          threadJointPDFPointers( numberOfThreads );
+    for( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+      threadJointPDFs[ t ] = JointPDFType::New();
+      threadJointPDFs[ t ]->SetRegions( jointPDFRegion );
+      threadJointPDFs[ t ]->Allocate();
+      threadJointPDFArrays[ t ].resize( jointPDFSize );
+      for( itk::SizeValueType i = 0; i < jointPDFSize; ++i )
+      {
+        threadJointPDFs[ t ]->GetBufferPointer()[ i ] = std::sin( 0.01 * i + t );
+        threadJointPDFArrays[ t ][ i ]                = std::sin( 0.01 * i + t );
+      }
+      threadJointPDFPointers[ t ] = threadJointPDFArrays[ t ].data();
+      if( reinterpret_cast< std::uintptr_t >( threadJointPDFPointers[ t ] ) % ITK_CACHE_LINE_ALIGNMENT != 0 )
+      {
+        std::cerr << "ERROR: joint histogram array of thread " << t << " is not aligned." << std::endl;
+        success = false;
+      }
+    }
+
+    const unsigned int numberOfAccumulations = std::max( 1u, numberOfSamples / 1000 );
+    itk::TimeProbe     referenceAccumulateTimer;
+    referenceAccumulateTimer.Start();
+    for( unsigned int r = 0; r < numberOfAccumulations; ++r )
+    {
+      JointPDFIteratorType                it( jointPDF, jointPDFRegion );
+      std::vector< JointPDFIteratorType > itT( numberOfThreads );
+      for( unsigned int t = 0; t < numberOfThreads; ++t )
+      {
+        itT[ t ] = JointPDFIteratorType( threadJointPDFs[ t ], jointPDFRegion );
+      }
+      while( !it.IsAtEnd() )
+      {
+        while( !it.IsAtEndOfLine() )
+        {
+          PDFValueType sum = 0.0;
+          for( unsigned int t = 0; t < numberOfThreads; ++t )
+          {
+            sum += itT[ t ].Value();
+            ++itT[ t ];
+          }
+          it.Set( sum );
+          ++it;
+        }
+        it.NextLine();
+        for( unsigned int t = 0; t < numberOfThreads; ++t )
+        {
+          itT[ t ].NextLine();
+        }
+      }
+    }
+    referenceAccumulateTimer.Stop();
+
+    itk::TimeProbe kernelAccumulateTimer;
+    kernelAccumulateTimer.Start();
+    for( unsigned int r = 0; r < numberOfAccumulations; ++r )
+    {
+      KernelsType::SumArrays( jointPDFArray.data(),
+        threadJointPDFPointers.data(), numberOfThreads, jointPDFSize );
+    }
+    kernelAccumulateTimer.Stop();
+
+    success &= CheckArrays( "accumulated joint histogram", jointPDF->GetBufferPointer(),
+      jointPDFArray.data(), jointPDFSize );
+
+    /** Report timings. */
+    std::cerr << std::setprecision( 4 );
+    std::cerr << numberOfBins << " bins:" << std::endl;
+    std::cerr << "  Parzen window update:   reference " << referenceUpdateTimer.GetMean()
+              << " s, kernel " << kernelUpdateTimer.GetMean() << " s, speedup "
+              << referenceUpdateTimer.GetMean() / kernelUpdateTimer.GetMean() << std::endl;
+    std::cerr << "  PRatio derivative:      reference " << referenceDerivativeTimer.GetMean()
+              << " s, kernel " << kernelDerivativeTimer.GetMean() << " s, speedup "
+              << referenceDerivativeTimer.GetMean() / kernelDerivativeTimer.GetMean() << std::endl;
+    std::cerr << "  Accumulate " << numberOfThreads << " threads:  reference "
+              << referenceAccumulateTimer.GetMean()
+              << " s, kernel " << kernelAccumulateTimer.GetMean() << " s, speedup "
+              << referenceAccumulateTimer.GetMean() / kernelAccumulateTimer.GetMean() << std::endl;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
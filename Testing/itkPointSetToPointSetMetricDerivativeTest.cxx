@@ -0,0 +1,524 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCorrespondingPointsEuclideanDistancePointMetric.h"
+#include "itkStatisticalShapePointPenalty.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkPointSet.h"
+
+#include <vnl/algo/vnl_svd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+//-------------------------------------------------------------------------------------
+// This test checks the multi-threaded point loops of the
+// CorrespondingPointsEuclideanDistancePointMetric and the
+// StatisticalShapePointPenalty, with an affine transform, which has a dense
+// Jacobian, and a B-spline transform, which has a sparse one.
+// - The derivative of the CorrespondingPointsEuclideanDistancePointMetric is
+//   compared with central differences of GetValue().
+// - The value and derivative of the StatisticalShapePointPenalty are compared
+//   with a reference that builds d(proposal)/dmu for every parameter, as done
+//   by earlier versions of elastix, and multiplies it with the inverse of the
+//   regularized covariance. This is done for the full covariance model
+//   (ShapeModelCalculation 0) and for the decomposed ones (1 without and 2
+//   with NormalizedShapeModel), which give the same Mahalanobis distance for
+//   a covariance matrix of full rank.
+// - Without NormalizedShapeModel, the derivative of the
+//   StatisticalShapePointPenalty is also compared with central differences.
+//   With NormalizedShapeModel it is not: the derivative of the l2-norm of
+//   earlier versions, a^T a' / ( l * sqrt(n) ), is kept, and the reference
+//   above checks that the derivative is propagated back through the
+//   centroid and size normalization as before.
+// All this is done with one and with several threads.
+
+namespace
+{
+
+const unsigned int Dimension = 3;
+typedef itk::PointSet< double, Dimension > PointSetType;
+typedef itk::CorrespondingPointsEuclideanDistancePointMetric<
+  PointSetType, PointSetType >             CorrespondingPointsMetricType;
+typedef itk::StatisticalShapePointPenalty<
+  PointSetType, PointSetType >             ShapePenaltyType;
+typedef itk::AdvancedCombinationTransform< double, Dimension >
+                                           CombinationTransformType;
+typedef itk::AdvancedMatrixOffsetTransformBase< double, Dimension, Dimension >
+                                           AffineTransformType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >
+                                           BSplineTransformType;
+typedef CombinationTransformType::ParametersType ParametersType;
+typedef vnl_vector< double >                     VnlVectorType;
+typedef vnl_matrix< double >                     VnlMatrixType;
+
+const unsigned int NumberOfPoints     = 40;
+const double       ShrinkageIntensity = 0.3;
+const double       BaseVariance       = 2.0;
+const double       CentroidVariance   = 4.0;
+const double       SizeVariance       = 0.5;
+
+/** Points on a deformed ellipse, in the centre of the B-spline grid. */
+PointSetType::Pointer
+CreateFixedPointSet( void )
+{
+  PointSetType::Pointer pointSet = PointSetType::New();
+  for( unsigned int i = 0; i < NumberOfPoints; ++i )
+  {
+    PointSetType::PointType point;
+    point[ 0 ] = 15.0 + 8.0 * std::cos( 0.5 * i ) * ( 1.0 + 0.1 * std::sin( 1.0 * i ) );
+    point[ 1 ] = 15.0 + 6.0 * std::sin( 0.5 * i );
+    point[ 2 ] = 15.0 + 7.0 * std::sin( 0.23 * i + 0.4 );
+    pointSet->SetPoint( i, point );
+  }
+  return pointSet;
+}
+
+
+/** Corresponding points at a distance of at least one from the transformed fixed points. */
+PointSetType::Pointer
+CreateMovingPointSet( const PointSetType * fixedPointSet )
+{
+  PointSetType::Pointer pointSet = PointSetType::New();
+  for( unsigned int i = 0; i < NumberOfPoints; ++i )
+  {
+    PointSetType::PointType point = fixedPointSet->GetPoint( i );
+    point[ 0 ] += 3.0 + std::sin( 1.3 * i );
+    point[ 1 ] += 1.2 * std::cos( 0.9 * i ) - 0.6;
+    point[ 2 ] += 0.9 * std::sin( 0.4 * i + 1.0 );
+    pointSet->SetPoint( i, point );
+  }
+  return pointSet;
+}
+
+
+/** An affine transform, at a position near the identity. */
+CombinationTransformType::Pointer
+CreateAffineTransform( ParametersType & position )
+{
+  AffineTransformType::Pointer        affine = AffineTransformType::New();
+  AffineTransformType::InputPointType center;
+  center.Fill( 15.0 );
+  affine->SetCenter( center );
+
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( affine );
+
+  position = affine->GetParameters();
+  for( unsigned int i = 0; i < position.GetSize(); ++i )
+  {
+    position[ i ] += ( i < Dimension * Dimension ? 0.02 : 0.3 ) * std::sin( 1.0 + i );
+  }
+  return transform;
+}
+
+
+/** A B-spline transform on a coarse grid, at a random position. */
+CombinationTransformType::Pointer
+CreateBSplineTransform( ParametersType & position )
+{
+  BSplineTransformType::Pointer bspline = BSplineTransformType::New();
+
+  BSplineTransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( 5 );
+  BSplineTransformType::RegionType gridRegion;
+  gridRegion.SetSize( gridSize );
+  BSplineTransformType::SpacingType gridSpacing;
+  gridSpacing.Fill( 12.0 );
+  BSplineTransformType::OriginType gridOrigin;
+  gridOrigin.Fill( -10.0 );
+  bspline->SetGridRegion( gridRegion );
+  bspline->SetGridSpacing( gridSpacing );
+  bspline->SetGridOrigin( gridOrigin );
+
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bspline );
+
+  position.SetSize( bspline->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < position.GetSize(); ++i )
+  {
+    position[ i ] = 0.5 * std::sin( 0.7 * i + 0.3 );
+  }
+  return transform;
+}
+
+
+/** A symmetric positive definite covariance matrix, 0.5 I + B B^T / 8. */
+VnlMatrixType
+CreateCovarianceMatrix( const unsigned int size )
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 1357 );
+
+  VnlMatrixType B( size, 8 );
+  for( unsigned int i = 0; i < size; ++i )
+  {
+    for( unsigned int j = 0; j < 8; ++j )
+    {
+      B( i, j ) = randomNum->GetUniformVariate( -1.0, 1.0 );
+    }
+  }
+  VnlMatrixType covariance = B * B.transpose() / 8.0;
+  for( unsigned int i = 0; i < size; ++i )
+  {
+    covariance( i, i ) += 0.5;
+  }
+  return covariance;
+}
+
+
+/** The transformed points x and their derivatives dx/dmu, as a dense matrix. */
+void
+TransformPoints( const CombinationTransformType * transform, const PointSetType * pointSet,
+  VnlVectorType & x, VnlMatrixType & dx )
+{
+  const unsigned int shapeLength = Dimension * NumberOfPoints;
+  x.set_size( shapeLength );
+  dx.set_size( shapeLength, transform->GetNumberOfParameters() );
+  dx.fill( 0.0 );
+
+  CombinationTransformType::JacobianType               jacobian;
+  CombinationTransformType::NonZeroJacobianIndicesType nzji;
+  for( unsigned int i = 0; i < NumberOfPoints; ++i )
+  {
+    const PointSetType::PointType                   point       = pointSet->GetPoint( i );
+    const CombinationTransformType::OutputPointType mappedPoint = transform->TransformPoint( point );
+    transform->GetJacobian( point, jacobian, nzji );
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      x[ i * Dimension + d ] = mappedPoint[ d ];
+      for( unsigned int k = 0; k < nzji.size(); ++k )
+      {
+        dx( i * Dimension + d, nzji[ k ] ) = jacobian( d, k );
+      }
+    }
+  }
+}
+
+
+/** The proposal vector [ q, c, l ] of the normalized shape model and its
+ * derivative, with the l2-norm derivative of earlier versions of elastix.
+ */
+void
+NormalizeShape( const VnlVectorType & x, const VnlMatrixType & dx,
+  VnlVectorType & proposal, VnlMatrixType & dProposal )
+{
+  const unsigned int shapeLength        = Dimension * NumberOfPoints;
+  const unsigned int numberOfParameters = dx.cols();
+  proposal.set_size( shapeLength + Dimension + 1 );
+  dProposal.set_size( shapeLength + Dimension + 1, numberOfParameters );
+
+  /** The centroid c and the aligned shape a = x - c. */
+  VnlVectorType a  = x;
+  VnlMatrixType da = dx;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    double        c  = 0.0;
+    VnlVectorType dc( numberOfParameters, 0.0 );
+    for( unsigned int i = 0; i < NumberOfPoints; ++i )
+    {
+      c  += x[ i * Dimension + d ];
+      dc += dx.get_row( i * Dimension + d );
+    }
+    c  /= NumberOfPoints;
+    dc /= NumberOfPoints;
+    for( unsigned int i = 0; i < NumberOfPoints; ++i )
+    {
+      a[ i * Dimension + d ] -= c;
+      da.set_row( i * Dimension + d, da.get_row( i * Dimension + d ) - dc );
+    }
+    proposal[ shapeLength + d ] = c;
+    dProposal.set_row( shapeLength + d, dc );
+  }
+
+  /** The l2-norm l and the normalized shape q = a / l. */
+  const double        l  = std::sqrt( a.squared_magnitude() / NumberOfPoints );
+  const VnlVectorType dl = da.transpose() * a / ( l * std::sqrt( static_cast< double >( NumberOfPoints ) ) );
+  proposal.update( a / l, 0 );
+  proposal[ shapeLength + Dimension ] = l;
+  dProposal.update( da / l - outer_product( a, dl ) / ( l * l ), 0, 0 );
+  dProposal.set_row( shapeLength + Dimension, dl );
+}
+
+
+/** The inverse of the regularized covariance matrix. */
+VnlMatrixType
+InvertRegularizedCovariance( const VnlMatrixType & covariance, const bool normalized )
+{
+  const unsigned int shapeLength = Dimension * NumberOfPoints;
+  VnlMatrixType      regularized = ( 1.0 - ShrinkageIntensity ) * covariance;
+  for( unsigned int i = 0; i < shapeLength; ++i )
+  {
+    regularized( i, i ) += ShrinkageIntensity * BaseVariance;
+  }
+  if( normalized )
+  {
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      regularized( shapeLength + d, shapeLength + d ) += ShrinkageIntensity * CentroidVariance;
+    }
+    regularized( shapeLength + Dimension, shapeLength + Dimension ) += ShrinkageIntensity * SizeVariance;
+  }
+  return vnl_svd< double >( regularized ).inverse();
+}
+
+
+/** The reference value and derivative of the StatisticalShapePointPenalty. */
+void
+ComputeShapePenaltyReference( const CombinationTransformType * transform, const PointSetType * pointSet,
+  const VnlVectorType & meanVector, const VnlMatrixType & inverseCovariance, const bool normalized,
+  double & value, VnlVectorType & derivative )
+{
+  VnlVectorType x, proposal;
+  VnlMatrixType dx, dProposal;
+  TransformPoints( transform, pointSet, x, dx );
+  if( normalized )
+  {
+    NormalizeShape( x, dx, proposal, dProposal );
+  }
+  else
+  {
+    proposal  = x;
+    dProposal = dx;
+  }
+
+  const VnlVectorType diff     = proposal - meanVector;
+  const VnlVectorType gradient = inverseCovariance * diff;
+  value      = std::sqrt( dot_product( diff, gradient ) );
+  derivative = dProposal.transpose() * gradient / value;
+}
+
+
+bool
+AreEqual( const double a, const double b, const double tolerance, const double scale )
+{
+  return std::abs( a - b ) <= tolerance * std::max( 1.0, scale );
+}
+
+
+/** Compare the value and derivative of the metric with the expected ones. */
+bool
+CompareDerivative( const std::string & settings, const char * what,
+  const double value, const itk::Array< double > & derivative,
+  const double expectedValue, const VnlVectorType & expectedDerivative, const double tolerance )
+{
+  bool success = true;
+  if( !AreEqual( value, expectedValue, 1e-9, std::abs( expectedValue ) ) )
+  {
+    std::cerr << "ERROR: " << settings << ": the value is " << value
+              << ", expected " << expectedValue << " (" << what << ")." << std::endl;
+    success = false;
+  }
+  const double scale = expectedDerivative.inf_norm();
+  for( unsigned int j = 0; j < expectedDerivative.size(); ++j )
+  {
+    if( !AreEqual( derivative[ j ], expectedDerivative[ j ], tolerance, scale ) )
+    {
+      std::cerr << "ERROR: " << settings << ": derivative " << j << " is " << derivative[ j ]
+                << ", expected " << expectedDerivative[ j ] << " (" << what << ")." << std::endl;
+      success = false;
+    }
+  }
+  return success;
+}
+
+
+/** Central differences of GetValue(). */
+template< class TMetric >
+VnlVectorType
+ComputeCentralDifferences( const TMetric * metric, const ParametersType & position )
+{
+  const double  delta = 1e-6;
+  VnlVectorType differences( position.GetSize() );
+  for( unsigned int j = 0; j < position.GetSize(); ++j )
+  {
+    ParametersType plus  = position;
+    ParametersType minus = position;
+    plus[ j ]  += delta;
+    minus[ j ] -= delta;
+    differences[ j ] = ( metric->GetValue( plus ) - metric->GetValue( minus ) ) / ( 2.0 * delta );
+  }
+  return differences;
+}
+
+
+bool
+TestCorrespondingPointsMetric( const bool isAffine, const unsigned int numberOfWorkUnits )
+{
+  PointSetType::Pointer fixedPointSet  = CreateFixedPointSet();
+  PointSetType::Pointer movingPointSet = CreateMovingPointSet( fixedPointSet );
+
+  ParametersType                    position;
+  CombinationTransformType::Pointer transform = isAffine
+    ? CreateAffineTransform( position ) : CreateBSplineTransform( position );
+
+  CorrespondingPointsMetricType::Pointer metric = CorrespondingPointsMetricType::New();
+  metric->SetFixedPointSet( fixedPointSet );
+  metric->SetMovingPointSet( movingPointSet );
+  metric->SetTransform( transform );
+  metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+  metric->Initialize();
+
+  const std::string settings = std::string( "CorrespondingPointsEuclideanDistance" )
+    + ( isAffine ? ", affine" : ", B-spline" )
+    + ( numberOfWorkUnits > 1 ? ", multi-threaded" : ", single-threaded" );
+
+  double                                       value = 0.0;
+  CorrespondingPointsMetricType::DerivativeType derivative;
+  metric->GetValueAndDerivative( position, value, derivative );
+
+  const VnlVectorType differences = ComputeCentralDifferences( metric.GetPointer(), position );
+  return CompareDerivative( settings, "central differences",
+    value, derivative, metric->GetValue( position ), differences, 1e-6 );
+}
+
+
+bool
+TestShapePenalty( const int shapeModelCalculation, const bool normalized,
+  const bool isAffine, const unsigned int numberOfWorkUnits )
+{
+  PointSetType::Pointer fixedPointSet = CreateFixedPointSet();
+
+  ParametersType                    position;
+  CombinationTransformType::Pointer transform = isAffine
+    ? CreateAffineTransform( position ) : CreateBSplineTransform( position );
+
+  /** The mean shape: the fixed points, normalized if needed. */
+  VnlVectorType meanVector;
+  {
+    VnlVectorType x( Dimension * NumberOfPoints );
+    VnlMatrixType dx( Dimension * NumberOfPoints, 1, 0.0 );
+    for( unsigned int i = 0; i < NumberOfPoints; ++i )
+    {
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        x[ i * Dimension + d ] = fixedPointSet->GetPoint( i )[ d ];
+      }
+    }
+    if( normalized )
+    {
+      VnlMatrixType dProposal;
+      NormalizeShape( x, dx, meanVector, dProposal );
+    }
+    else
+    {
+      meanVector = x;
+    }
+  }
+  const VnlMatrixType covariance = CreateCovarianceMatrix( meanVector.size() );
+
+  /** The metric deletes the model when it is destroyed. */
+  ShapePenaltyType::Pointer metric = ShapePenaltyType::New();
+  metric->SetFixedPointSet( fixedPointSet );
+  metric->SetMovingPointSet( fixedPointSet );
+  metric->SetTransform( transform );
+  metric->SetMeanVector( new VnlVectorType( meanVector ) );
+  metric->SetCovarianceMatrix( new VnlMatrixType( covariance ) );
+  metric->SetShapeModelCalculation( shapeModelCalculation );
+  metric->SetNormalizedShapeModel( normalized );
+  metric->SetShrinkageIntensity( ShrinkageIntensity );
+  metric->SetBaseVariance( BaseVariance );
+  metric->SetCentroidXVariance( CentroidVariance );
+  metric->SetCentroidYVariance( CentroidVariance );
+  metric->SetCentroidZVariance( CentroidVariance );
+  metric->SetSizeVariance( SizeVariance );
+  metric->SetCutOffValue( 0.0 );
+  metric->SetCutOffSharpness( 2.0 );
+  metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+  metric->Initialize();
+
+  const std::string settings = std::string( "StatisticalShapePenalty, ShapeModelCalculation " )
+    + std::to_string( shapeModelCalculation )
+    + ( normalized ? ", normalized" : "" )
+    + ( isAffine ? ", affine" : ", B-spline" )
+    + ( numberOfWorkUnits > 1 ? ", multi-threaded" : ", single-threaded" );
+
+  double                           value = 0.0;
+  ShapePenaltyType::DerivativeType derivative;
+  metric->GetValueAndDerivative( position, value, derivative );
+
+  bool success = true;
+  if( !AreEqual( metric->GetValue( position ), value, 1e-12, std::abs( value ) ) )
+  {
+    std::cerr << "ERROR: " << settings << ": GetValue() differs from GetValueAndDerivative()." << std::endl;
+    success = false;
+  }
+
+  double        expectedValue = 0.0;
+  VnlVectorType expectedDerivative;
+  transform->SetParameters( position );
+  ComputeShapePenaltyReference( transform, fixedPointSet, meanVector,
+    InvertRegularizedCovariance( covariance, normalized ), normalized,
+    expectedValue, expectedDerivative );
+  success &= CompareDerivative( settings, "reference",
+    value, derivative, expectedValue, expectedDerivative, 1e-8 );
+
+  if( !normalized )
+  {
+    const VnlVectorType differences = ComputeCentralDifferences( metric.GetPointer(), position );
+    success &= CompareDerivative( settings, "central differences",
+      value, derivative, expectedValue, differences, 1e-6 );
+  }
+
+  return success;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    for( unsigned int numberOfWorkUnits = 1; numberOfWorkUnits <= 3; numberOfWorkUnits += 2 )
+    {
+      for( unsigned int t = 0; t < 2; ++t )
+      {
+        const bool isAffine = ( t == 0 );
+        success &= TestCorrespondingPointsMetric( isAffine, numberOfWorkUnits );
+        success &= TestShapePenalty( 0, false, isAffine, numberOfWorkUnits );
+        success &= TestShapePenalty( 1, false, isAffine, numberOfWorkUnits );
+        success &= TestShapePenalty( 0, true, isAffine, numberOfWorkUnits );
+        success &= TestShapePenalty( 2, true, isAffine, numberOfWorkUnits );
+      }
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,259 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGradientDifferenceImageToImageMetric2.h"
+#include "itkNormalizedGradientCorrelationImageToImageMetric.h"
+#include "itkPatternIntensityImageToImageMetric.h"
+
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedEuler3DTransform.h"
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkResampleImageFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+// This test checks the 2D-3D metrics that compute their derivative by central
+// differences of DRRs: GradientDifference, NormalizedGradientCorrelation and
+// PatternIntensity. For each metric it checks that
+// - the derivative equals the central differences of GetValue(), and
+// - the value and the derivative are the same when the perturbations are
+//   evaluated concurrently, on the perturbation pipelines, as when they are
+//   evaluated one after the other, on the pipeline of the metric.
+
+namespace
+{
+
+const unsigned int Dimension = 3;
+typedef float                                       PixelType;
+typedef itk::Image< PixelType, Dimension >          ImageType;
+typedef itk::AdvancedEuler3DTransform< double >     EulerTransformType;
+typedef itk::AdvancedCombinationTransform< double, Dimension >
+                                                    CombinationTransformType;
+typedef itk::AdvancedRayCastInterpolateImageFunction<
+  ImageType, double >                               RayCastInterpolatorType;
+typedef EulerTransformType::ParametersType          ParametersType;
+typedef itk::Array< double >                        ScalesType;
+
+/** Create a volume centred at the origin, as is assumed by the ray caster,
+ * with two Gaussian blobs.
+ */
+ImageType::Pointer
+CreateVolume( void )
+{
+  ImageType::SizeType  size;
+  ImageType::PointType origin;
+  size.Fill( 32 );
+  origin.Fill( -15.5 );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->SetOrigin( origin );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    ImageType::PointType point;
+    image->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    const double r1 = ( point[ 0 ] - 4.0 ) * ( point[ 0 ] - 4.0 )
+      + ( point[ 1 ] + 2.0 ) * ( point[ 1 ] + 2.0 ) + point[ 2 ] * point[ 2 ];
+    const double r2 = ( point[ 0 ] + 5.0 ) * ( point[ 0 ] + 5.0 )
+      + ( point[ 1 ] - 6.0 ) * ( point[ 1 ] - 6.0 ) + ( point[ 2 ] - 3.0 ) * ( point[ 2 ] - 3.0 );
+    it.Set( static_cast< PixelType >( 100.0 * std::exp( -r1 / 30.0 ) + 60.0 * std::exp( -r2 / 15.0 ) ) );
+  }
+  return image;
+}
+
+
+/** Create the ray caster with its transform: a combination transform whose
+ * current transform carries the parameters of the metric, as set up by the
+ * elastix RayCastInterpolator.
+ */
+RayCastInterpolatorType::Pointer
+CreateRayCaster( EulerTransformType * eulerTransform )
+{
+  CombinationTransformType::Pointer combinationTransform = CombinationTransformType::New();
+  combinationTransform->SetCurrentTransform( eulerTransform );
+
+  RayCastInterpolatorType::InputPointType focalPoint;
+  focalPoint[ 0 ] = 0.0; focalPoint[ 1 ] = 0.0; focalPoint[ 2 ] = -100.0;
+
+  RayCastInterpolatorType::Pointer rayCaster = RayCastInterpolatorType::New();
+  rayCaster->SetTransform( combinationTransform );
+  rayCaster->SetFocalPoint( focalPoint );
+  rayCaster->SetThreshold( 0.0 );
+  return rayCaster;
+}
+
+
+/** Create the fixed image: a DRR of the volume with the identity transform,
+ * on a detector at z = 100.
+ */
+ImageType::Pointer
+CreateFixedImage( const ImageType * volume )
+{
+  EulerTransformType::Pointer      eulerTransform = EulerTransformType::New();
+  RayCastInterpolatorType::Pointer rayCaster      = CreateRayCaster( eulerTransform );
+
+  ImageType::SizeType  size;
+  ImageType::PointType origin;
+  size[ 0 ] = 40; size[ 1 ] = 40; size[ 2 ] = 1;
+  origin[ 0 ] = -19.5; origin[ 1 ] = -19.5; origin[ 2 ] = 100.0;
+
+  typedef itk::ResampleImageFilter< ImageType, ImageType > ResamplerType;
+  ResamplerType::Pointer resampler = ResamplerType::New();
+  resampler->SetInput( volume );
+  resampler->SetTransform( rayCaster->GetTransform() );
+  resampler->SetInterpolator( rayCaster );
+  resampler->SetSize( size );
+  resampler->SetOutputOrigin( origin );
+  resampler->SetDefaultPixelValue( 0 );
+  resampler->Update();
+  return resampler->GetOutput();
+}
+
+
+bool
+AreEqual( const double a, const double b, const double tolerance )
+{
+  return std::abs( a - b ) <= tolerance * std::max( 1.0, std::max( std::abs( a ), std::abs( b ) ) );
+}
+
+
+template< class TMetric >
+bool
+TestMetric( const char * name, const ImageType * fixedImage, const ImageType * volume )
+{
+  ParametersType parameters( 6 );
+  parameters[ 0 ] = 0.02; parameters[ 1 ] = -0.01; parameters[ 2 ] = 0.03;
+  parameters[ 3 ] = 1.0;  parameters[ 4 ] = -0.5;  parameters[ 5 ] = 0.8;
+
+  ScalesType scales( 6 );
+  scales[ 0 ] = scales[ 1 ] = scales[ 2 ] = 100.0;
+  scales[ 3 ] = scales[ 4 ] = scales[ 5 ] = 1.0;
+
+  double                          values[ 2 ];
+  typename TMetric::DerivativeType derivatives[ 2 ];
+  bool                            success = true;
+  for( unsigned int threaded = 0; threaded < 2; ++threaded )
+  {
+    EulerTransformType::Pointer      eulerTransform = EulerTransformType::New();
+    RayCastInterpolatorType::Pointer rayCaster      = CreateRayCaster( eulerTransform );
+
+    typename TMetric::Pointer metric = TMetric::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetMovingImage( volume );
+    metric->SetTransform( eulerTransform );
+    metric->SetInterpolator( rayCaster );
+    metric->SetScales( scales );
+    metric->SetNumberOfWorkUnits( 4 );
+    metric->SetUseMultiThread( threaded == 1 );
+    metric->Initialize();
+
+    metric->GetValueAndDerivative( parameters, values[ threaded ], derivatives[ threaded ] );
+    if( !AreEqual( metric->GetValue( parameters ), values[ threaded ], 1e-12 ) )
+    {
+      std::cerr << "ERROR: " << name << ": GetValue() differs from GetValueAndDerivative()." << std::endl;
+      success = false;
+    }
+
+    /** The derivative should be the central differences of GetValue(). */
+    if( threaded == 0 )
+    {
+      for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+      {
+        const double   delta     = metric->GetDerivativeDelta() / std::sqrt( scales[ i ] );
+        ParametersType testPoint = parameters;
+        testPoint[ i ] = parameters[ i ] - delta;
+        const double valuep0 = metric->GetValue( testPoint );
+        testPoint[ i ] = parameters[ i ] + delta;
+        const double valuep1 = metric->GetValue( testPoint );
+        const double expected = ( valuep1 - valuep0 ) / ( 2.0 * delta );
+        if( !AreEqual( derivatives[ 0 ][ i ], expected, 1e-10 ) )
+        {
+          std::cerr << "ERROR: " << name << ": derivative " << i << " = "
+                    << derivatives[ 0 ][ i ] << ", central differences give "
+                    << expected << std::endl;
+          success = false;
+        }
+      }
+    }
+  }
+
+  std::cerr << name << ": value = " << values[ 0 ] << ", derivative = " << derivatives[ 0 ] << std::endl;
+
+  /** The concurrent evaluation should give the same value and derivative. */
+  if( !AreEqual( values[ 0 ], values[ 1 ], 1e-12 ) )
+  {
+    std::cerr << "ERROR: " << name << ": threaded value " << values[ 1 ]
+              << " differs from the single-threaded value " << values[ 0 ] << std::endl;
+    success = false;
+  }
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    if( !AreEqual( derivatives[ 0 ][ i ], derivatives[ 1 ][ i ], 1e-10 ) )
+    {
+      std::cerr << "ERROR: " << name << ": threaded derivative " << i << " = "
+                << derivatives[ 1 ][ i ] << ", single-threaded "
+                << derivatives[ 0 ][ i ] << std::endl;
+      success = false;
+    }
+  }
+  return success;
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    ImageType::Pointer volume     = CreateVolume();
+    ImageType::Pointer fixedImage = CreateFixedImage( volume );
+
+    success &= TestMetric< itk::GradientDifferenceImageToImageMetric< ImageType, ImageType > >(
+      "GradientDifference", fixedImage, volume );
+    success &= TestMetric< itk::NormalizedGradientCorrelationImageToImageMetric< ImageType, ImageType > >(
+      "NormalizedGradientCorrelation", fixedImage, volume );
+    success &= TestMetric< itk::PatternIntensityImageToImageMetric< ImageType, ImageType > >(
+      "PatternIntensity", fixedImage, volume );
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
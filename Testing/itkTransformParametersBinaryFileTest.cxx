@@ -0,0 +1,198 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkTransformParametersBinaryFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// This test checks the binary transform parameter file:
+// - values that are written are read back unchanged, also when the file is
+//   overwritten while a previous version is still mapped,
+// - a file in which a byte is flipped is rejected by the checksum,
+// - a raw file without header, as written by older versions, is read,
+// - a file written on a machine with the other byte order is read.
+
+namespace
+{
+
+typedef itk::TransformParametersBinaryFile BinaryFileType;
+typedef BinaryFileType::ValueType          ValueType;
+typedef std::vector< char >                BytesType;
+
+const std::size_t HeaderSize = 64;
+
+std::vector< ValueType >
+CreateValues( const unsigned int numberOfValues, const double offset )
+{
+  std::vector< ValueType > values( numberOfValues );
+  for( unsigned int i = 0; i < numberOfValues; ++i )
+  {
+    values[ i ] = offset + 0.37 * i - 1.0e-3 * i * i;
+  }
+  return values;
+}
+
+
+BytesType
+ReadBytes( const std::string & fileName )
+{
+  std::ifstream infile( fileName.c_str(), std::ios::in | std::ios::binary );
+  return BytesType( std::istreambuf_iterator< char >( infile ), std::istreambuf_iterator< char >() );
+}
+
+
+void
+WriteBytes( const std::string & fileName, const BytesType & bytes )
+{
+  std::ofstream outfile( fileName.c_str(), std::ios::out | std::ios::binary );
+  outfile.write( bytes.data(), bytes.size() );
+}
+
+
+/** Check that the file has the expected values. */
+bool
+CheckValues( const char * name, const BinaryFileType * file, const std::vector< ValueType > & expected )
+{
+  if( file->GetNumberOfValues() != expected.size() || file->GetValues() == nullptr
+    || !std::equal( expected.begin(), expected.end(), file->GetValues() ) )
+  {
+    std::cerr << "ERROR: " << name << ": the values that are read differ from the values that were written."
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+} // end namespace
+
+int
+main( int argc, char * argv[] )
+{
+  if( argc != 2 )
+  {
+    std::cerr << "ERROR: You should specify the output directory." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string fileName = std::string( argv[ 1 ] ) + "/TransformParametersBinaryFileTest.dat";
+
+  const unsigned int             numberOfValues = 1000;
+  const std::vector< ValueType > values         = CreateValues( numberOfValues, 0.0 );
+  const std::vector< ValueType > otherValues    = CreateValues( numberOfValues, 5.0 );
+
+  bool success = true;
+  try
+  {
+    /** Round trip. */
+    BinaryFileType::Write( fileName, values.data(), numberOfValues );
+    BinaryFileType::Pointer file = BinaryFileType::New();
+    file->Read( fileName, numberOfValues );
+    success &= CheckValues( "round trip", file, values );
+    std::cerr << "round trip: memory-mapped = " << file->GetIsMemoryMapped() << std::endl;
+
+    /** Overwriting the file should not affect the values that are mapped. */
+    BinaryFileType::Write( fileName, otherValues.data(), numberOfValues );
+    success &= CheckValues( "mapped file after overwriting", file, values );
+    BinaryFileType::Pointer otherFile = BinaryFileType::New();
+    otherFile->Read( fileName, numberOfValues );
+    success &= CheckValues( "overwritten file", otherFile, otherValues );
+
+    /** A different number of values is reported, not read. */
+    BinaryFileType::Pointer wrongSizeFile = BinaryFileType::New();
+    wrongSizeFile->Read( fileName, numberOfValues + 1 );
+    if( wrongSizeFile->GetNumberOfValues() != numberOfValues || wrongSizeFile->GetValues() != nullptr )
+    {
+      std::cerr << "ERROR: a file with an unexpected number of values is not reported." << std::endl;
+      success = false;
+    }
+
+    /** A flipped byte should be rejected by the checksum. */
+    BinaryFileType::Write( fileName, values.data(), numberOfValues );
+    BytesType bytes = ReadBytes( fileName );
+    bytes[ HeaderSize + 8 * 123 + 5 ] ^= 0x10;
+    WriteBytes( fileName, bytes );
+    bool exceptionThrown = false;
+    try
+    {
+      BinaryFileType::Pointer corruptFile = BinaryFileType::New();
+      corruptFile->Read( fileName, numberOfValues );
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      std::cerr << "flipped byte: " << e.GetDescription() << std::endl;
+      exceptionThrown = true;
+    }
+    if( !exceptionThrown )
+    {
+      std::cerr << "ERROR: a file with a flipped byte is not rejected." << std::endl;
+      success = false;
+    }
+
+    /** A raw file without header, as written by older versions. */
+    BytesType legacyBytes( reinterpret_cast< const char * >( values.data() ),
+      reinterpret_cast< const char * >( values.data() + numberOfValues ) );
+    WriteBytes( fileName, legacyBytes );
+    BinaryFileType::Pointer legacyFile = BinaryFileType::New();
+    legacyFile->Read( fileName, numberOfValues );
+    success &= CheckValues( "file without header", legacyFile, values );
+
+    /** A file written with the other byte order: swap the fields of the
+     * header after the magic string, and the values. The checksum is over
+     * the bytes as stored, so it is recomputed over the swapped values.
+     */
+    BinaryFileType::Write( fileName, values.data(), numberOfValues );
+    bytes = ReadBytes( fileName );
+    for( std::size_t offset = 8; offset < 24; offset += 4 )
+    {
+      std::reverse( bytes.begin() + offset, bytes.begin() + offset + 4 );
+    }
+    std::reverse( bytes.begin() + 24, bytes.begin() + 32 );
+    for( std::size_t offset = HeaderSize; offset < bytes.size(); offset += 8 )
+    {
+      std::reverse( bytes.begin() + offset, bytes.begin() + offset + 8 );
+    }
+    uint64_t checksum = BinaryFileType::ComputeChecksum( bytes.data() + HeaderSize, bytes.size() - HeaderSize );
+    char *   checksumBytes = reinterpret_cast< char * >( &checksum );
+    std::reverse( checksumBytes, checksumBytes + 8 );
+    std::copy( checksumBytes, checksumBytes + 8, bytes.begin() + 32 );
+    WriteBytes( fileName, bytes );
+    BinaryFileType::Pointer swappedFile = BinaryFileType::New();
+    swappedFile->Read( fileName, numberOfValues );
+    success &= CheckValues( "byte-swapped file", swappedFile, values );
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
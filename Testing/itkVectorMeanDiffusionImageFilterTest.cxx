@@ -0,0 +1,259 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkVectorMeanDiffusionImageFilter.h"
+
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkVector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// This test checks the VectorMeanDiffusionImageFilter:
+// - the result of the multi-threaded filter is the same for one and for
+//   several work units, and
+// - it equals a straightforward single-threaded implementation, which
+//   filters the whole image in every iteration.
+// The grey value image has a region at its minimum, where the coefficient
+// c(x) equals the minimum of the rescaled range, and a region with larger
+// values, so that the bounding box of the filtered pixels is tested as well.
+
+namespace
+{
+
+const unsigned int Dimension = 2;
+typedef itk::Vector< float, Dimension >       VectorType;
+typedef itk::Image< VectorType, Dimension >   VectorImageType;
+typedef itk::Image< short, Dimension >        GrayValueImageType;
+typedef itk::VectorMeanDiffusionImageFilter<
+  VectorImageType, GrayValueImageType >       FilterType;
+
+const unsigned int SizeX              = 30;
+const unsigned int SizeY              = 24;
+const unsigned int NumberOfIterations = 3;
+
+/** Create a random vector image. */
+VectorImageType::Pointer
+CreateVectorImage( void )
+{
+  VectorImageType::SizeType size;
+  size[ 0 ] = SizeX; size[ 1 ] = SizeY;
+
+  VectorImageType::Pointer image = VectorImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 12345 );
+
+  itk::ImageRegionIteratorWithIndex< VectorImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    VectorType value;
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      value[ j ] = static_cast< float >( randomNum->GetUniformVariate( -5.0, 5.0 ) );
+    }
+    it.Set( value );
+  }
+  return image;
+}
+
+
+/** Create a grey value image that is zero, except for a block with a ramp. */
+GrayValueImageType::Pointer
+CreateGrayValueImage( void )
+{
+  GrayValueImageType::SizeType size;
+  size[ 0 ] = SizeX; size[ 1 ] = SizeY;
+
+  GrayValueImageType::Pointer image = GrayValueImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< GrayValueImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    const GrayValueImageType::IndexType index = it.GetIndex();
+    short                               value = 0;
+    if( index[ 0 ] >= 8 && index[ 0 ] < 22 && index[ 1 ] >= 5 && index[ 1 ] < 16 )
+    {
+      value = static_cast< short >( 10 + 20 * index[ 0 ] + 7 * index[ 1 ] );
+    }
+    it.Set( value );
+  }
+  return image;
+}
+
+
+/** A straightforward implementation of the filter: every iteration filters
+ * all pixels with a coefficient of at least the minimum of the rescaled
+ * range, with a zero-flux Neumann boundary condition.
+ */
+std::vector< VectorType >
+ComputeReference( const VectorImageType * input, const GrayValueImageType * grayValueImage )
+{
+  const double outputMinimum = 0.000001;
+  const double outputMaximum = 0.999999;
+
+  std::vector< VectorType > values( SizeX * SizeY );
+  std::vector< double >     grayValues( SizeX * SizeY );
+  itk::ImageRegionConstIteratorWithIndex< VectorImageType > it( input, input->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    values[ it.GetIndex()[ 1 ] * SizeX + it.GetIndex()[ 0 ] ] = it.Get();
+    grayValues[ it.GetIndex()[ 1 ] * SizeX + it.GetIndex()[ 0 ] ]
+      = grayValueImage->GetPixel( it.GetIndex() );
+  }
+
+  /** Rescale the grey values, as the RescaleIntensityImageFilter does. */
+  const double minimum = *std::min_element( grayValues.begin(), grayValues.end() );
+  const double maximum = *std::max_element( grayValues.begin(), grayValues.end() );
+  const double scale   = ( outputMaximum - outputMinimum ) / ( maximum - minimum );
+  const double shift   = outputMinimum / scale - minimum;
+  std::vector< double > cx( grayValues.size() );
+  for( std::size_t i = 0; i < cx.size(); ++i )
+  {
+    cx[ i ] = ( grayValues[ i ] + shift ) * scale;
+  }
+
+  std::vector< VectorType > result = values;
+  for( unsigned int k = 0; k < NumberOfIterations; ++k )
+  {
+    for( int y = 0; y < static_cast< int >( SizeY ); ++y )
+    {
+      for( int x = 0; x < static_cast< int >( SizeX ); ++x )
+      {
+        const double c = cx[ y * SizeX + x ];
+        if( c < outputMinimum )
+        {
+          result[ y * SizeX + x ] = values[ y * SizeX + x ];
+          continue;
+        }
+
+        double sum[ Dimension ] = { 0.0, 0.0 };
+        double sumc             = 0.0;
+        for( int dy = -1; dy <= 1; ++dy )
+        {
+          for( int dx = -1; dx <= 1; ++dx )
+          {
+            const int    xi = std::min( std::max( x + dx, 0 ), static_cast< int >( SizeX ) - 1 );
+            const int    yi = std::min( std::max( y + dy, 0 ), static_cast< int >( SizeY ) - 1 );
+            const double ci = cx[ yi * SizeX + xi ];
+            sumc += ci;
+            for( unsigned int j = 0; j < Dimension; ++j )
+            {
+              sum[ j ] += ci * values[ yi * SizeX + xi ][ j ];
+            }
+          }
+        }
+        for( unsigned int j = 0; j < Dimension; ++j )
+        {
+          const double mean = sumc < 0.00001 ? 0.0 : sum[ j ] / sumc;
+          result[ y * SizeX + x ][ j ]
+            = static_cast< float >( values[ y * SizeX + x ][ j ] * ( 1.0 - c ) + mean * c );
+        }
+      }
+    }
+    values = result;
+  }
+  return result;
+}
+
+
+VectorImageType::Pointer
+ApplyFilter( VectorImageType * input, GrayValueImageType * grayValueImage,
+  const unsigned int numberOfWorkUnits )
+{
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( input );
+  filter->SetGrayValueImage( grayValueImage );
+  filter->SetNumberOfIterations( NumberOfIterations );
+  filter->SetNumberOfWorkUnits( numberOfWorkUnits );
+  filter->Update();
+  return filter->GetOutput();
+}
+
+
+} // end namespace
+
+int
+main( void )
+{
+  bool success = true;
+  try
+  {
+    VectorImageType::Pointer    input          = CreateVectorImage();
+    GrayValueImageType::Pointer grayValueImage = CreateGrayValueImage();
+
+    VectorImageType::Pointer serialOutput   = ApplyFilter( input, grayValueImage, 1 );
+    VectorImageType::Pointer threadedOutput = ApplyFilter( input, grayValueImage, 4 );
+    const std::vector< VectorType > reference = ComputeReference( input, grayValueImage );
+
+    double maximumDifference = 0.0;
+    itk::ImageRegionConstIteratorWithIndex< VectorImageType > it1(
+      serialOutput, serialOutput->GetLargestPossibleRegion() );
+    itk::ImageRegionConstIteratorWithIndex< VectorImageType > it2(
+      threadedOutput, threadedOutput->GetLargestPossibleRegion() );
+    for( ; !it1.IsAtEnd(); ++it1, ++it2 )
+    {
+      const VectorImageType::IndexType index = it1.GetIndex();
+      if( it1.Get() != it2.Get() )
+      {
+        std::cerr << "ERROR: the result at " << index << " is " << it2.Get()
+                  << " with 4 work units, and " << it1.Get() << " with 1 work unit." << std::endl;
+        success = false;
+      }
+      const VectorType expected = reference[ index[ 1 ] * SizeX + index[ 0 ] ];
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        maximumDifference = std::max( maximumDifference,
+          static_cast< double >( std::abs( it1.Get()[ j ] - expected[ j ] ) ) );
+      }
+    }
+
+    std::cerr << "Maximum difference with the reference implementation: "
+              << maximumDifference << std::endl;
+    if( maximumDifference > 1e-5 )
+    {
+      std::cerr << "ERROR: the result differs from the reference implementation." << std::endl;
+      success = false;
+    }
+  }
+  catch( itk::ExceptionObject & e )
+  {
+    std::cerr << "ERROR: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main